@@ -16,7 +16,9 @@
 #include "arch/probe.h"
 
 /* flags we export */
+int ceph_arch_intel_avx2 = 0;
 int ceph_arch_intel_pclmul = 0;
+int ceph_arch_intel_aesni = 0;
 int ceph_arch_intel_sse42 = 0;
 int ceph_arch_intel_sse41 = 0;
 int ceph_arch_intel_ssse3 = 0;
@@ -46,11 +48,39 @@ static void do_cpuid(unsigned int *eax, unsigned int *ebx, unsigned int *ecx,
 /* http://en.wikipedia.org/wiki/CPUID#EAX.3D1:_Processor_Info_and_Feature_Bits */
 
 #define CPUID_PCLMUL	(1 << 1)
+#define CPUID_AESNI	(1 << 25)
 #define CPUID_SSE42	(1 << 20)
 #define CPUID_SSE41	(1 << 19)
 #define CPUID_SSSE3	(1 << 9)
 #define CPUID_SSE3	(1)
 #define CPUID_SSE2	(1 << 26)
+#define CPUID_OSXSAVE	(1 << 27)
+#define CPUID_AVX	(1 << 28)
+
+/* http://en.wikipedia.org/wiki/CPUID#EAX.3D7.2C_ECX.3D0:_Extended_Features */
+
+#define CPUID_LEAF7_AVX2	(1 << 5)
+
+/* leaf 7 needs ecx cleared before cpuid */
+static void do_cpuid_leaf7(unsigned int *ebx)
+{
+        unsigned int eax = 7, ecx = 0, edx;
+
+        asm("cpuid"
+                : "+a" (eax), "=b" (*ebx), "+c" (ecx), "=d" (edx));
+}
+
+/* has the OS enabled ymm state saves? */
+static unsigned long long do_xgetbv(void)
+{
+        unsigned int eax, edx;
+
+        /* xgetbv, spelled out for older assemblers */
+        asm volatile(".byte 0x0f,0x01,0xd0"
+                : "=a" (eax), "=d" (edx)
+                : "c" (0));
+        return eax | ((unsigned long long)edx << 32);
+}
 
 int ceph_arch_intel_probe(void)
 {
@@ -60,6 +90,9 @@ int ceph_arch_intel_probe(void)
 	if ((ecx & CPUID_PCLMUL) != 0) {
 		ceph_arch_intel_pclmul = 1;
 	}
+	if ((ecx & CPUID_AESNI) != 0) {
+		ceph_arch_intel_aesni = 1;
+	}
 	if ((ecx & CPUID_SSE42) != 0) {
 		ceph_arch_intel_sse42 = 1;
 	}
@@ -75,6 +108,15 @@ int ceph_arch_intel_probe(void)
 	if ((edx & CPUID_SSE2) != 0) {
 	        ceph_arch_intel_sse2 = 1;
 	}
+	if ((ecx & CPUID_OSXSAVE) != 0 &&
+	    (ecx & CPUID_AVX) != 0 &&
+	    (do_xgetbv() & 0x6) == 0x6) {
+		unsigned int ebx7;
+		do_cpuid_leaf7(&ebx7);
+		if ((ebx7 & CPUID_LEAF7_AVX2) != 0) {
+			ceph_arch_intel_avx2 = 1;
+		}
+	}
 
 	return 0;
 }
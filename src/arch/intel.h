@@ -5,7 +5,9 @@
 extern "C" {
 #endif
 
+extern int ceph_arch_intel_avx2;   /* true if we have AVX2 features */
 extern int ceph_arch_intel_pclmul; /* true if we have PCLMUL features */
+extern int ceph_arch_intel_aesni;  /* true if we have AES-NI features */
 extern int ceph_arch_intel_sse42;  /* true if we have sse 4.2 features */
 extern int ceph_arch_intel_sse41;  /* true if we have sse 4.1 features */
 extern int ceph_arch_intel_ssse3;  /* true if we have ssse 3 features */
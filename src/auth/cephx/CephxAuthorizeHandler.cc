@@ -1,5 +1,6 @@
 #include "CephxProtocol.h"
 #include "CephxAuthorizeHandler.h"
+#include "common/Clock.h"
 #include "common/dout.h"
 
 #define dout_subsys ceph_subsys_auth
@@ -17,6 +18,33 @@ bool CephxAuthorizeHandler::verify_authorizer(CephContext *cct, KeyStore *keys,
     return false;
   }
 
+  double cache_ttl = cct->_conf->auth_authorizer_cache_ttl;
+  uint32_t hash = 0;
+  if (cache_ttl > 0) {
+    hash = authorizer_data.crc32c(0);
+    Mutex::Locker l(cache_lock);
+    utime_t now = ceph_clock_now(cct);
+    pair<multimap<uint32_t, CachedAuthorizer>::iterator,
+	 multimap<uint32_t, CachedAuthorizer>::iterator> range =
+      cache.equal_range(hash);
+    for (multimap<uint32_t, CachedAuthorizer>::iterator p = range.first;
+	 p != range.second; ++p) {
+      if (p->second.expires < now)
+	continue;
+      if (p->second.data.contents_equal(authorizer_data)) {
+	authorizer_reply = p->second.reply;
+	entity_name = p->second.entity_name;
+	global_id = p->second.global_id;
+	caps_info = p->second.caps_info;
+	session_key = p->second.session_key;
+	if (auid) *auid = p->second.auid;
+	ldout(cct, 20) << "verify authorizer cache hit for " << entity_name
+		       << " global_id " << global_id << dendl;
+	return true;
+      }
+    }
+  }
+
   CephXServiceTicketInfo auth_ticket_info;
 
   bool isvalid = cephx_verify_authorizer(cct, keys, iter, auth_ticket_info, authorizer_reply);
@@ -27,6 +55,35 @@ bool CephxAuthorizeHandler::verify_authorizer(CephContext *cct, KeyStore *keys,
     global_id = auth_ticket_info.ticket.global_id;
     session_key = auth_ticket_info.session_key;
     if (auid) *auid = auth_ticket_info.ticket.auid;
+
+    if (cache_ttl > 0) {
+      Mutex::Locker l(cache_lock);
+      utime_t now = ceph_clock_now(cct);
+      if (cache.size() >= (size_t)cct->_conf->auth_authorizer_cache_size) {
+	// drop expired entries; if the cache is still full, skip caching
+	// rather than evicting entries a storm is actively reusing
+	multimap<uint32_t, CachedAuthorizer>::iterator p = cache.begin();
+	while (p != cache.end()) {
+	  if (p->second.expires < now)
+	    cache.erase(p++);
+	  else
+	    ++p;
+	}
+      }
+      if (cache.size() < (size_t)cct->_conf->auth_authorizer_cache_size) {
+	CachedAuthorizer& c = cache.insert(
+	  make_pair(hash, CachedAuthorizer()))->second;
+	c.data = authorizer_data;
+	c.reply = authorizer_reply;
+	c.entity_name = entity_name;
+	c.global_id = global_id;
+	c.caps_info = caps_info;
+	c.session_key = session_key;
+	c.auid = auth_ticket_info.ticket.auid;
+	c.expires = now;
+	c.expires += cache_ttl;
+      }
+    }
   }
 
   return isvalid;
@@ -16,15 +16,42 @@
 #define CEPH_CEPHXAUTHORIZEHANDLER_H
 
 #include "auth/AuthAuthorizeHandler.h"
+#include "include/utime.h"
 
 class CephContext;
 
 struct CephxAuthorizeHandler : public AuthAuthorizeHandler {
+  CephxAuthorizeHandler()
+    : cache_lock("CephxAuthorizeHandler::cache_lock") {}
+
   bool verify_authorizer(CephContext *cct, KeyStore *keys,
 			 bufferlist& authorizer_data, bufferlist& authorizer_reply,
                          EntityName& entity_name, uint64_t& global_id,
 			 AuthCapsInfo& caps_info, CryptoKey& session_key, uint64_t *auid = NULL);
   int authorizer_session_crypto();
+
+private:
+  /*
+   * Short-TTL cache of successfully verified authorizers, keyed by a
+   * crc of the authorizer blob (the full blob is compared on a hit),
+   * so a reconnect storm re-admits known clients without redoing the
+   * cephx crypto.  Replaying an identical blob within the TTL yields
+   * the same accept the protocol would have granted anyway; rotating
+   * service keys bound the window like they do for the slow path.
+   */
+  struct CachedAuthorizer {
+    bufferlist data;
+    bufferlist reply;
+    EntityName entity_name;
+    uint64_t global_id;
+    AuthCapsInfo caps_info;
+    CryptoKey session_key;
+    uint64_t auid;
+    utime_t expires;
+  };
+
+  Mutex cache_lock;
+  multimap<uint32_t, CachedAuthorizer> cache;
 };
 
 
@@ -45,18 +45,32 @@ int CephxSessionHandler::_calc_signature(Message *m, uint64_t *psig)
     mswab32(header.crc), mswab32(footer.front_crc),
     mswab32(footer.middle_crc), mswab32(footer.data_crc)
   };
-  bufferlist bl_plaintext;
-  bl_plaintext.append(buffer::create_static(sizeof(sigblock), (char*)&sigblock));
+  if (aesni_sig) {
+    // the signature is the first 8 bytes of the first CBC ciphertext
+    // block, which depends only on the first 16 plaintext bytes, so a
+    // single block encryption with the cached key schedule is enough
+    unsigned char c[16];
+    cephx_aesni_cbc_first_block(aesni_key_sched,
+				(const unsigned char *)CEPH_AES_IV,
+				(const unsigned char *)&sigblock, c);
+    uint64_t sig;
+    memcpy(&sig, c, sizeof(sig));
+    *psig = le64_to_cpu(sig);
+  } else {
+    bufferlist bl_plaintext;
+    bl_plaintext.append(buffer::create_static(sizeof(sigblock),
+					      (char*)&sigblock));
+
+    bufferlist bl_ciphertext;
+    if (key.encrypt(cct, bl_plaintext, bl_ciphertext, NULL) < 0) {
+      lderr(cct) << __func__ << " failed to encrypt signature block" << dendl;
+      return -1;
+    }
 
-  bufferlist bl_ciphertext;
-  if (key.encrypt(cct, bl_plaintext, bl_ciphertext, NULL) < 0) {
-    lderr(cct) << __func__ << " failed to encrypt signature block" << dendl;
-    return -1;
+    bufferlist::iterator ci = bl_ciphertext.begin();
+    ::decode(*psig, ci);
   }
 
-  bufferlist::iterator ci = bl_ciphertext.begin();
-  ::decode(*psig, ci);
-
   ldout(cct, 10) << __func__ << " seq " << m->get_seq()
 		 << " front_crc_ = " << footer.front_crc
 		 << " middle_crc = " << footer.middle_crc
@@ -15,17 +15,32 @@
 
 #include "auth/AuthSessionHandler.h"
 #include "auth/Auth.h"
+#include "arch/probe.h"
+#include "arch/intel.h"
+#include "cephx_sign_aesni.h"
 
 class CephContext;
 class Message;
 
 class CephxSessionHandler  : public AuthSessionHandler {
   uint64_t features;
+  bool aesni_sig;  ///< fast signing path usable for this session key
+  unsigned char aesni_key_sched[CEPHX_AESNI_SCHED_SIZE];
 
 public:
   CephxSessionHandler(CephContext *cct_, CryptoKey session_key, uint64_t features)
     : AuthSessionHandler(cct_, CEPH_AUTH_CEPHX, session_key),
-      features(features) {}
+      features(features) {
+    // expand the key schedule once per session instead of letting the
+    // crypto library re-derive it for every message signature
+    ceph_arch_probe();
+    aesni_sig = cephx_aesni_compiled() && ceph_arch_intel_aesni &&
+      key.get_type() == CEPH_CRYPTO_AES &&
+      key.get_secret().length() == 16;
+    if (aesni_sig)
+      cephx_aesni_expand_key((const unsigned char *)key.get_secret().c_str(),
+			     aesni_key_sched);
+  }
   ~CephxSessionHandler() {}
   
   bool no_security() {
@@ -0,0 +1,107 @@
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "cephx_sign_aesni.h"
+
+#if defined(__x86_64__) && \
+    (defined(__clang__) || \
+     (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+
+/* the target attribute lets this file build without -maes; the caller
+ * gates on the runtime cpuid probe before using any of it */
+
+#include <wmmintrin.h>
+#include <emmintrin.h>
+
+int cephx_aesni_compiled(void)
+{
+	return 1;
+}
+
+__attribute__((target("aes,sse2")))
+static __m128i expand_step(__m128i key, __m128i keygened)
+{
+	keygened = _mm_shuffle_epi32(keygened, _MM_SHUFFLE(3, 3, 3, 3));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	return _mm_xor_si128(key, keygened);
+}
+
+#define EXPAND_ROUND(out, n, k, rcon)				\
+	do {							\
+		k = expand_step(k, _mm_aeskeygenassist_si128(k, rcon)); \
+		_mm_storeu_si128((out) + (n), k);		\
+	} while (0)
+
+__attribute__((target("aes,sse2")))
+void cephx_aesni_expand_key(const unsigned char *key, unsigned char *sched)
+{
+	__m128i *s = (__m128i *)sched;
+	__m128i k = _mm_loadu_si128((const __m128i *)key);
+
+	_mm_storeu_si128(s, k);
+	EXPAND_ROUND(s, 1, k, 0x01);
+	EXPAND_ROUND(s, 2, k, 0x02);
+	EXPAND_ROUND(s, 3, k, 0x04);
+	EXPAND_ROUND(s, 4, k, 0x08);
+	EXPAND_ROUND(s, 5, k, 0x10);
+	EXPAND_ROUND(s, 6, k, 0x20);
+	EXPAND_ROUND(s, 7, k, 0x40);
+	EXPAND_ROUND(s, 8, k, 0x80);
+	EXPAND_ROUND(s, 9, k, 0x1b);
+	EXPAND_ROUND(s, 10, k, 0x36);
+}
+
+__attribute__((target("aes,sse2")))
+void cephx_aesni_cbc_first_block(const unsigned char *sched,
+				 const unsigned char *iv,
+				 const unsigned char *plain,
+				 unsigned char *out)
+{
+	const __m128i *s = (const __m128i *)sched;
+	__m128i b;
+	int i;
+
+	b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)plain),
+			  _mm_loadu_si128((const __m128i *)iv));
+	b = _mm_xor_si128(b, _mm_loadu_si128(s));
+	for (i = 1; i < 10; i++)
+		b = _mm_aesenc_si128(b, _mm_loadu_si128(s + i));
+	b = _mm_aesenclast_si128(b, _mm_loadu_si128(s + 10));
+	_mm_storeu_si128((__m128i *)out, b);
+}
+
+#else /* !x86_64 or compiler without the target attribute */
+
+int cephx_aesni_compiled(void)
+{
+	return 0;
+}
+
+void cephx_aesni_expand_key(const unsigned char *key, unsigned char *sched)
+{
+	(void)key;
+	(void)sched;
+}
+
+void cephx_aesni_cbc_first_block(const unsigned char *sched,
+				 const unsigned char *iv,
+				 const unsigned char *plain,
+				 unsigned char *out)
+{
+	(void)sched;
+	(void)iv;
+	(void)plain;
+	(void)out;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef CEPH_CEPHX_SIGN_AESNI_H
+#define CEPH_CEPHX_SIGN_AESNI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CEPHX_AESNI_SCHED_SIZE (11 * 16)
+
+/* non-zero if this build carries the AES-NI signing path; the caller
+ * must additionally check ceph_arch_intel_aesni at runtime */
+extern int cephx_aesni_compiled(void);
+
+/* expand a 128-bit AES key into an 11-round schedule, once per session */
+extern void cephx_aesni_expand_key(const unsigned char *key,
+				   unsigned char *sched);
+
+/* out = AES(sched, iv ^ plain): the first ciphertext block of a CBC
+ * stream, which is all a cephx signature uses */
+extern void cephx_aesni_cbc_first_block(const unsigned char *sched,
+					const unsigned char *iv,
+					const unsigned char *plain,
+					unsigned char *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
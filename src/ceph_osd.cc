@@ -469,6 +469,13 @@ int main(int argc, const char **argv)
 					     getpid());
   if (!ms_public || !ms_cluster || !ms_hbclient || !ms_hb_back_server || !ms_hb_front_server || !ms_objecter)
     exit(1);
+  if (!g_conf->ms_cluster_crc_data) {
+    // backend fabric is trusted to provide payload integrity; the
+    // footer NOCRC flag tells peers not to expect a data crc, so each
+    // side only needs its own cluster messenger configured.  header
+    // crcs are kept.
+    ms_cluster->crcflags &= ~MSG_CRC_DATA;
+  }
   ms_cluster->set_cluster_protocol(CEPH_OSD_PROTOCOL);
   ms_hbclient->set_cluster_protocol(CEPH_OSD_PROTOCOL);
   ms_hb_back_server->set_cluster_protocol(CEPH_OSD_PROTOCOL);
@@ -2714,6 +2714,27 @@ void Client::resend_unsafe_requests(MetaSession *session)
   }
 }
 
+void Client::flush_mdlog_sync()
+{
+  if (mds_requests.empty())
+    return;
+  for (map<mds_rank_t,MetaSession*>::iterator p = mds_sessions.begin();
+       p != mds_sessions.end();
+       ++p)
+    flush_mdlog(p->second);
+}
+
+void Client::flush_mdlog(MetaSession *session)
+{
+  // the safe replies we are about to wait for only go out when the mds
+  // commits its log; ask it to do that now instead of on its next
+  // periodic flush.  only send to an mds new enough to know the op.
+  if (session->con->has_feature(CEPH_FEATURE_SERVER_JEWEL)) {
+    MClientSession *m = new MClientSession(CEPH_SESSION_REQUEST_FLUSH_MDLOG);
+    session->con->send_message(m);
+  }
+}
+
 void Client::wait_unsafe_requests()
 {
   list<MetaRequest*> last_unsafe_reqs;
@@ -2722,6 +2743,7 @@ void Client::wait_unsafe_requests()
        ++p) {
     MetaSession *s = p->second;
     if (!s->unsafe_requests.empty()) {
+      flush_mdlog(s);
       MetaRequest *req = s->unsafe_requests.back();
       req->get();
       last_unsafe_reqs.push_back(req);
@@ -7094,6 +7116,11 @@ int Client::_readdir_get_frag(dir_result_t *dirp)
   req->set_inode(diri.get());
   req->head.args.readdir.frag = fg;
   req->head.args.readdir.flags = CEPH_READDIR_REPLY_BITFLAGS;
+  // each entry comes back with attrs, caps and a dentry lease, so a
+  // bigger reply means fewer round trips for the stats that follow;
+  // let the admin trade reply size against mds latency here.
+  req->head.args.readdir.max_entries = cct->_conf->client_readdir_max_entries;
+  req->head.args.readdir.max_bytes = cct->_conf->client_readdir_max_bytes;
   if (dirp->last_name.length()) {
     req->path2.set_path(dirp->last_name.c_str());
   }
@@ -8773,6 +8800,8 @@ int Client::_fsync(Inode *in, bool syncdataonly)
   } else ldout(cct, 10) << "no metadata needs to commit" << dendl;
 
   if (!syncdataonly && !in->unsafe_ops.empty()) {
+    flush_mdlog_sync();
+
     MetaRequest *req = in->unsafe_ops.back();
     ldout(cct, 15) << "waiting on unsafe requests, last tid " << req->get_tid() <<  dendl;
 
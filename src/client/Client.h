@@ -346,6 +346,8 @@ protected:
   void send_reconnect(MetaSession *s);
   void resend_unsafe_requests(MetaSession *s);
   void wait_unsafe_requests();
+  void flush_mdlog_sync();
+  void flush_mdlog(MetaSession *session);
 
   // mds requests
   ceph_tid_t last_tid;
@@ -113,6 +113,8 @@ static void fuse_ll_lookup(fuse_req_t req, fuse_ino_t parent, const char *name)
   int r;
 
   memset(&fe, 0, sizeof(fe));
+  fe.attr_timeout = cfuse->client->cct->_conf->fuse_attr_timeout;
+  fe.entry_timeout = cfuse->client->cct->_conf->fuse_entry_timeout;
   r = cfuse->client->ll_lookup(i1, name, &fe.attr, &i2, ctx->uid, ctx->gid);
   if (r >= 0) {
     fe.ino = cfuse->make_fake_ino(fe.attr.st_ino, fe.attr.st_dev);
@@ -149,7 +151,7 @@ static void fuse_ll_getattr(fuse_req_t req, fuse_ino_t ino,
       == 0) {
     stbuf.st_ino = cfuse->make_fake_ino(stbuf.st_ino, stbuf.st_dev);
     stbuf.st_rdev = new_encode_dev(stbuf.st_rdev);
-    fuse_reply_attr(req, &stbuf, 0);
+    fuse_reply_attr(req, &stbuf, cfuse->client->cct->_conf->fuse_attr_timeout);
   } else
     fuse_reply_err(req, ENOENT);
 
@@ -177,7 +179,7 @@ static void fuse_ll_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr,
 
   int r = cfuse->client->ll_setattr(in, attr, mask, ctx->uid, ctx->gid);
   if (r == 0)
-    fuse_reply_attr(req, attr, 0);
+    fuse_reply_attr(req, attr, cfuse->client->cct->_conf->fuse_attr_timeout);
   else
     fuse_reply_err(req, -r);
 
@@ -307,6 +309,8 @@ static void fuse_ll_mknod(fuse_req_t req, fuse_ino_t parent, const char *name,
   struct fuse_entry_param fe;
 
   memset(&fe, 0, sizeof(fe));
+  fe.attr_timeout = cfuse->client->cct->_conf->fuse_attr_timeout;
+  fe.entry_timeout = cfuse->client->cct->_conf->fuse_entry_timeout;
 
   int r = cfuse->client->ll_mknod(i1, name, mode, new_decode_dev(rdev),
 				  &fe.attr, &i2, ctx->uid, ctx->gid);
@@ -332,6 +336,8 @@ static void fuse_ll_mkdir(fuse_req_t req, fuse_ino_t parent, const char *name,
   struct fuse_entry_param fe;
 
   memset(&fe, 0, sizeof(fe));
+  fe.attr_timeout = cfuse->client->cct->_conf->fuse_attr_timeout;
+  fe.entry_timeout = cfuse->client->cct->_conf->fuse_entry_timeout;
 
 #ifdef HAVE_SYS_SYNCFS
   if (cfuse->fino_snap(parent) == CEPH_SNAPDIR &&
@@ -403,6 +409,8 @@ static void fuse_ll_symlink(fuse_req_t req, const char *existing,
   struct fuse_entry_param fe;
 
   memset(&fe, 0, sizeof(fe));
+  fe.attr_timeout = cfuse->client->cct->_conf->fuse_attr_timeout;
+  fe.entry_timeout = cfuse->client->cct->_conf->fuse_entry_timeout;
 
   int r = cfuse->client->ll_symlink(i1, name, existing, &fe.attr, &i2, ctx->uid,
 				    ctx->gid);
@@ -444,6 +452,8 @@ static void fuse_ll_link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent,
   struct fuse_entry_param fe;
 
   memset(&fe, 0, sizeof(fe));
+  fe.attr_timeout = cfuse->client->cct->_conf->fuse_attr_timeout;
+  fe.entry_timeout = cfuse->client->cct->_conf->fuse_entry_timeout;
   
   int r = cfuse->client->ll_link(in, nin, newname, &fe.attr, ctx->uid,
 				 ctx->gid);
@@ -491,9 +501,16 @@ static void fuse_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
   Fh *fh = reinterpret_cast<Fh*>(fi->fh);
   bufferlist bl;
   int r = cfuse->client->ll_read(fh, off, size, &bl);
-  if (r >= 0)
-    fuse_reply_buf(req, bl.c_str(), bl.length());
-  else
+  if (r >= 0) {
+    // reply with an iov over the bufferlist segments instead of
+    // flattening them with c_str(), which memcpys the whole read.
+    // fuse prepends one iovec of its own for the reply header.
+    if (bl.get_num_buffers() > IOV_MAX - 1)
+      bl.rebuild();
+    std::vector<iovec> iov;
+    bl.prepare_iov(&iov);
+    fuse_reply_iov(req, iov.empty() ? NULL : &iov[0], iov.size());
+  } else
     fuse_reply_err(req, -r);
 }
 
@@ -668,6 +685,8 @@ static void fuse_ll_create(fuse_req_t req, fuse_ino_t parent, const char *name,
   Fh *fh = NULL;
 
   memset(&fe, 0, sizeof(fe));
+  fe.attr_timeout = cfuse->client->cct->_conf->fuse_attr_timeout;
+  fe.entry_timeout = cfuse->client->cct->_conf->fuse_entry_timeout;
 
   // pass &i2 for the created inode so that ll_create takes an initial ll_ref
   int r = cfuse->client->ll_create(i1, name, mode, fi->flags, &fe.attr, &i2,
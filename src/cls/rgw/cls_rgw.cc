@@ -25,6 +25,7 @@ CLS_NAME(rgw)
 cls_handle_t h_class;
 cls_method_handle_t h_rgw_bucket_init_index;
 cls_method_handle_t h_rgw_bucket_set_tag_timeout;
+cls_method_handle_t h_rgw_set_bucket_resharding;
 cls_method_handle_t h_rgw_bucket_list;
 cls_method_handle_t h_rgw_bucket_check_index;
 cls_method_handle_t h_rgw_bucket_rebuild_index;
@@ -416,6 +417,33 @@ static int read_bucket_header(cls_method_context_t hctx, struct rgw_bucket_dir_h
   return 0;
 }
 
+/* bucket index entries are stored with a compact fixed-layout header in
+ * front of the regular encoding, so scans can filter without paying for a
+ * full decode; rgw_bucket_dir_entry::decode() skips the header */
+static void encode_dir_entry(struct rgw_bucket_dir_entry& entry, bufferlist& bl)
+{
+  rgw_bucket_dir_entry_compact_header h;
+  h.from_entry(entry);
+  h.encode(bl);
+  ::encode(entry, bl);
+}
+
+static bool peek_compact_header(bufferlist& bl,
+                                struct rgw_bucket_dir_entry_compact_header *h)
+{
+  if (!bl.length() ||
+      (unsigned char)*bl.begin() != RGW_BUCKET_DIRENT_COMPACT_MAGIC) {
+    return false;
+  }
+  bufferlist::iterator iter = bl.begin();
+  try {
+    h->decode(iter);
+  } catch (buffer::error& err) {
+    return false;
+  }
+  return true;
+}
+
 int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
   bufferlist::iterator iter = in->begin();
@@ -463,13 +491,6 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
       }
 
       bufferlist& entrybl = kiter->second;
-      bufferlist::iterator eiter = entrybl.begin();
-      try {
-        ::decode(entry, eiter);
-      } catch (buffer::error& err) {
-        CLS_LOG(1, "ERROR: rgw_bucket_list(): failed to decode entry, key=%s\n", kiter->first.c_str());
-        return -EINVAL;
-      }
 
       cls_rgw_obj_key key;
       uint64_t ver;
@@ -478,6 +499,33 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
       start_key = kiter->first;
       CLS_LOG(20, "start_key=%s len=%lu", start_key.c_str(), start_key.size());
 
+      /* filter on the compact header before decoding the whole entry;
+       * entries skipped here, or only counted toward truncation, never
+       * pay for the full decode */
+      struct rgw_bucket_dir_entry_compact_header ch;
+      if (peek_compact_header(entrybl, &ch)) {
+        if (!rgw_bucket_dir_entry::is_valid_flags(ch.flags)) {
+          CLS_LOG(20, "entry %s[%s] is not valid\n", key.name.c_str(), key.instance.c_str());
+          continue;
+        }
+        if (!op.list_versions && !rgw_bucket_dir_entry::is_visible_flags(ch.flags)) {
+          CLS_LOG(20, "entry %s[%s] is not visible\n", key.name.c_str(), key.instance.c_str());
+          continue;
+        }
+        if (m.size() >= op.num_entries) {
+          left_to_read--;
+          continue;
+        }
+      }
+
+      bufferlist::iterator eiter = entrybl.begin();
+      try {
+        ::decode(entry, eiter);
+      } catch (buffer::error& err) {
+        CLS_LOG(1, "ERROR: rgw_bucket_list(): failed to decode entry, key=%s\n", kiter->first.c_str());
+        return -EINVAL;
+      }
+
       if (!entry.is_valid()) {
         CLS_LOG(20, "entry %s[%s] is not valid\n", key.name.c_str(), key.instance.c_str());
         continue;
@@ -641,6 +689,29 @@ int rgw_bucket_set_tag_timeout(cls_method_context_t hctx, bufferlist *in, buffer
   return write_bucket_header(hctx, &header);
 }
 
+int rgw_set_bucket_resharding(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  rgw_cls_set_bucket_resharding_op op;
+  bufferlist::iterator iter = in->begin();
+  try {
+    ::decode(op, iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_set_bucket_resharding(): failed to decode request\n");
+    return -EINVAL;
+  }
+
+  struct rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_set_bucket_resharding(): failed to read header\n");
+    return rc;
+  }
+
+  header.reshard_status = op.reshard_status;
+
+  return write_bucket_header(hctx, &header);
+}
+
 static int read_key_entry(cls_method_context_t hctx, cls_rgw_obj_key& key, string *idx, struct rgw_bucket_dir_entry *entry,
                           bool special_delete_marker_name = false);
 
@@ -697,6 +768,11 @@ int rgw_bucket_prepare_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     return rc;
   }
 
+  if (header.resharding()) {
+    CLS_LOG(10, "rgw_bucket_prepare_op(): bucket is resharding, rejecting op\n");
+    return -CLS_RGW_ERR_BUSY_RESHARDING;
+  }
+
   if (op.log_op) {
     rc = log_index_operation(hctx, op.key, op.op, op.tag, entry.meta.mtime,
                              entry.ver, info.state, header.ver, header.max_marker, op.bilog_flags, NULL, NULL);
@@ -706,7 +782,7 @@ int rgw_bucket_prepare_op(cls_method_context_t hctx, bufferlist *in, bufferlist
 
   // write out new key to disk
   bufferlist info_bl;
-  ::encode(entry, info_bl);
+  encode_dir_entry(entry, info_bl);
   rc = cls_cxx_map_set_val(hctx, idx, &info_bl);
   if (rc < 0)
     return rc;
@@ -812,6 +888,11 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     return -EINVAL;
   }
 
+  if (header.resharding()) {
+    CLS_LOG(10, "rgw_bucket_complete_op(): bucket is resharding, rejecting op\n");
+    return -CLS_RGW_ERR_BUSY_RESHARDING;
+  }
+
   struct rgw_bucket_dir_entry entry;
   bool ondisk = true;
 
@@ -862,7 +943,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
 
     if (op.tag.size()) {
       bufferlist new_key_bl;
-      ::encode(entry, new_key_bl);
+      encode_dir_entry(entry, new_key_bl);
       return cls_cxx_map_set_val(hctx, idx, &new_key_bl);
     } else {
       return 0;
@@ -885,7 +966,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
       } else {
         entry.exists = false;
         bufferlist new_key_bl;
-        ::encode(entry, new_key_bl);
+        encode_dir_entry(entry, new_key_bl);
 	int ret = cls_cxx_map_set_val(hctx, idx, &new_key_bl);
 	if (ret < 0)
 	  return ret;
@@ -906,7 +987,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
       stats.total_size += meta.accounted_size;
       stats.total_size_rounded += get_rounded_size(meta.accounted_size);
       bufferlist new_key_bl;
-      ::encode(entry, new_key_bl);
+      encode_dir_entry(entry, new_key_bl);
       int ret = cls_cxx_map_set_val(hctx, idx, &new_key_bl);
       if (ret < 0)
 	return ret;
@@ -964,6 +1045,14 @@ static int write_entry(cls_method_context_t hctx, T& entry, const string& key)
   return cls_cxx_map_set_val(hctx, key, &bl);
 }
 
+/* dir entries get the compact header in front of the regular encoding */
+static int write_entry(cls_method_context_t hctx, struct rgw_bucket_dir_entry& entry, const string& key)
+{
+  bufferlist bl;
+  encode_dir_entry(entry, bl);
+  return cls_cxx_map_set_val(hctx, key, &bl);
+}
+
 static int read_olh(cls_method_context_t hctx,cls_rgw_obj_key& obj_key, struct rgw_bucket_olh_entry *olh_data_entry, string *index_key, bool *found)
 {
   cls_rgw_obj_key olh_key;
@@ -1387,6 +1476,17 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
     return -EINVAL;
   }
 
+  struct rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_link_olh(): failed to read header\n");
+    return rc;
+  }
+  if (header.resharding()) {
+    CLS_LOG(10, "rgw_bucket_link_olh(): bucket is resharding, rejecting op\n");
+    return -CLS_RGW_ERR_BUSY_RESHARDING;
+  }
+
   BIVerObjEntry obj(hctx, op.key);
   BIOLHEntry olh(hctx, op.key);
 
@@ -1519,13 +1619,6 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
     return ret;
   }
 
-  struct rgw_bucket_dir_header header;
-  ret = read_bucket_header(hctx, &header);
-  if (ret < 0) {
-    CLS_LOG(1, "ERROR: rgw_bucket_unlink_instance(): failed to read header\n");
-    return ret;
-  }
-
   if (op.log_op) {
     rgw_bucket_dir_entry& entry = obj.get_dir_entry();
 
@@ -1567,6 +1660,17 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
     return -EINVAL;
   }
 
+  struct rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_unlink_instance(): failed to read header\n");
+    return rc;
+  }
+  if (header.resharding()) {
+    CLS_LOG(10, "rgw_bucket_unlink_instance(): bucket is resharding, rejecting op\n");
+    return -CLS_RGW_ERR_BUSY_RESHARDING;
+  }
+
   cls_rgw_obj_key dest_key = op.key;
   if (dest_key.instance == "null") {
     dest_key.instance.clear();
@@ -1675,13 +1779,6 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
     return ret;
   }
 
-  struct rgw_bucket_dir_header header;
-  ret = read_bucket_header(hctx, &header);
-  if (ret < 0) {
-    CLS_LOG(1, "ERROR: rgw_bucket_unlink_instance(): failed to read header\n");
-    return ret;
-  }
-
   if (op.log_op) {
     rgw_bucket_entry_ver ver;
     ver.epoch = (op.olh_epoch ? op.olh_epoch : olh.get_epoch());
@@ -1881,6 +1978,11 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx, bufferlist *in, bufferlis
     return rc;
   }
 
+  if (header.resharding()) {
+    CLS_LOG(10, "rgw_dir_suggest_changes(): bucket is resharding, rejecting op\n");
+    return -CLS_RGW_ERR_BUSY_RESHARDING;
+  }
+
   timespan tag_timeout(header.tag_timeout ? header.tag_timeout : CEPH_RGW_TAG_TIMEOUT);
 
   bufferlist::iterator in_iter = in->begin();
@@ -1965,7 +2067,7 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx, bufferlist *in, bufferlis
         header_changed = true;
         cur_change.index_ver = header.ver;
         bufferlist cur_state_bl;
-        ::encode(cur_change, cur_state_bl);
+        encode_dir_entry(cur_change, cur_state_bl);
         ret = cls_cxx_map_set_val(hctx, cur_change_key, &cur_state_bl);
         if (ret < 0)
 	  return ret;
@@ -3384,6 +3486,7 @@ void __cls_init()
   /* bucket index */
   cls_register_cxx_method(h_class, "bucket_init_index", CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_init_index, &h_rgw_bucket_init_index);
   cls_register_cxx_method(h_class, "bucket_set_tag_timeout", CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_set_tag_timeout, &h_rgw_bucket_set_tag_timeout);
+  cls_register_cxx_method(h_class, "set_bucket_resharding", CLS_METHOD_RD | CLS_METHOD_WR, rgw_set_bucket_resharding, &h_rgw_set_bucket_resharding);
   cls_register_cxx_method(h_class, "bucket_list", CLS_METHOD_RD, rgw_bucket_list, &h_rgw_bucket_list);
   cls_register_cxx_method(h_class, "bucket_check_index", CLS_METHOD_RD, rgw_bucket_check_index, &h_rgw_bucket_check_index);
   cls_register_cxx_method(h_class, "bucket_rebuild_index", CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_rebuild_index, &h_rgw_bucket_rebuild_index);
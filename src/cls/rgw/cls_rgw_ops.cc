@@ -384,3 +384,15 @@ void cls_rgw_bi_log_list_ret::generate_test_instances(list<cls_rgw_bi_log_list_r
   ls.back()->entries.push_back(rgw_bi_log_entry());
   ls.back()->truncated = true;
 }
+
+void rgw_cls_set_bucket_resharding_op::dump(Formatter *f) const
+{
+  f->dump_unsigned("reshard_status", reshard_status);
+}
+
+void rgw_cls_set_bucket_resharding_op::generate_test_instances(list<rgw_cls_set_bucket_resharding_op*>& ls)
+{
+  ls.push_back(new rgw_cls_set_bucket_resharding_op);
+  ls.push_back(new rgw_cls_set_bucket_resharding_op);
+  ls.back()->reshard_status = CLS_RGW_RESHARD_IN_PROGRESS;
+}
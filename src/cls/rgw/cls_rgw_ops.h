@@ -1095,4 +1095,25 @@ struct cls_rgw_lc_list_entries_ret {
 };
 WRITE_CLASS_ENCODER(cls_rgw_lc_list_entries_ret)
 
+struct rgw_cls_set_bucket_resharding_op
+{
+  uint8_t reshard_status;
+
+  rgw_cls_set_bucket_resharding_op() : reshard_status(CLS_RGW_RESHARD_NONE) {}
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(reshard_status, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(1, bl);
+    ::decode(reshard_status, bl);
+    DECODE_FINISH(bl);
+  }
+  void dump(Formatter *f) const;
+  static void generate_test_instances(list<rgw_cls_set_bucket_resharding_op*>& ls);
+};
+WRITE_CLASS_ENCODER(rgw_cls_set_bucket_resharding_op)
+
 #endif /* CEPH_CLS_RGW_OPS_H */
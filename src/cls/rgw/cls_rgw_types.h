@@ -275,6 +275,13 @@ WRITE_CLASS_ENCODER(cls_rgw_obj_key)
 #define RGW_BUCKET_DIRENT_FLAG_DELETE_MARKER 0x4    /* delete marker */
 #define RGW_BUCKET_DIRENT_FLAG_VER_MARKER    0x8    /* object is versioned, a placeholder for the plain entry */
 
+/* entries stored in the bucket index may carry a compact fixed-layout header
+ * in front of the regular encoding; the magic byte cannot collide with a
+ * regular encoding, which always starts with a small struct_v */
+#define RGW_BUCKET_DIRENT_COMPACT_MAGIC   0xCE
+#define RGW_BUCKET_DIRENT_COMPACT_VERSION 1
+#define RGW_BUCKET_DIRENT_COMPACT_SIZE    28
+
 struct rgw_bucket_dir_entry {
   cls_rgw_obj_key key;
   rgw_bucket_entry_ver ver;
@@ -307,6 +314,12 @@ struct rgw_bucket_dir_entry {
     ENCODE_FINISH(bl);
   }
   void decode(bufferlist::iterator &bl) {
+    /* values written to the bucket index carry a compact header in front of
+     * the regular encoding; skip it here so every reader keeps working on
+     * both the old and the new on-disk format */
+    if (!bl.end() && (unsigned char)*bl == RGW_BUCKET_DIRENT_COMPACT_MAGIC) {
+      bl.advance(RGW_BUCKET_DIRENT_COMPACT_SIZE);
+    }
     DECODE_START_LEGACY_COMPAT_LEN(6, 3, 3, bl);
     ::decode(key.name, bl);
     ::decode(ver.epoch, bl);
@@ -337,16 +350,21 @@ struct rgw_bucket_dir_entry {
     DECODE_FINISH(bl);
   }
 
-  bool is_current() {
+  static bool is_current_flags(uint16_t flags) {
     int test_flags = RGW_BUCKET_DIRENT_FLAG_VER | RGW_BUCKET_DIRENT_FLAG_CURRENT;
     return (flags & RGW_BUCKET_DIRENT_FLAG_VER) == 0 ||
            (flags & test_flags) == test_flags;
   }
-  bool is_delete_marker() { return (flags & RGW_BUCKET_DIRENT_FLAG_DELETE_MARKER) != 0; }
-  bool is_visible() {
-    return is_current() && !is_delete_marker();
+  static bool is_delete_marker_flags(uint16_t flags) { return (flags & RGW_BUCKET_DIRENT_FLAG_DELETE_MARKER) != 0; }
+  static bool is_visible_flags(uint16_t flags) {
+    return is_current_flags(flags) && !is_delete_marker_flags(flags);
   }
-  bool is_valid() { return (flags & RGW_BUCKET_DIRENT_FLAG_VER_MARKER) == 0; }
+  static bool is_valid_flags(uint16_t flags) { return (flags & RGW_BUCKET_DIRENT_FLAG_VER_MARKER) == 0; }
+
+  bool is_current() { return is_current_flags(flags); }
+  bool is_delete_marker() { return is_delete_marker_flags(flags); }
+  bool is_visible() { return is_visible_flags(flags); }
+  bool is_valid() { return is_valid_flags(flags); }
 
   void dump(Formatter *f) const;
   void decode_json(JSONObj *obj);
@@ -354,6 +372,71 @@ struct rgw_bucket_dir_entry {
 };
 WRITE_CLASS_ENCODER(rgw_bucket_dir_entry)
 
+/*
+ * Fixed-layout header prepended to bucket index entry values at storage
+ * time.  It mirrors the few fields index scans care about, so listing can
+ * filter on flags and stat an entry (name, size, mtime) without decoding
+ * the whole rgw_bucket_dir_entry.  The regular encoding follows unchanged
+ * and rgw_bucket_dir_entry::decode() skips the header transparently, so
+ * values written without it by older daemons keep working, and bi
+ * export/import round-trips both formats safely.
+ */
+struct rgw_bucket_dir_entry_compact_header {
+  __u16 flags;
+  __u8 exists;
+  __u8 category;
+  __u16 name_off;    /* offset of the key name chars from the value start */
+  __u32 name_len;
+  uint64_t size;
+  uint64_t mtime_ns;
+
+  rgw_bucket_dir_entry_compact_header() :
+    flags(0), exists(0), category(0), name_off(0), name_len(0),
+    size(0), mtime_ns(0) {}
+
+  void from_entry(const rgw_bucket_dir_entry& entry) {
+    flags = entry.flags;
+    exists = entry.exists;
+    category = entry.meta.category;
+    /* header, then the entry's start marker (6) and string length (4)
+     * precede the name chars */
+    name_off = RGW_BUCKET_DIRENT_COMPACT_SIZE + 6 + 4;
+    name_len = entry.key.name.size();
+    size = entry.meta.size;
+    mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        entry.meta.mtime.time_since_epoch()).count();
+  }
+
+  void encode(bufferlist& bl) const {
+    ::encode((__u8)RGW_BUCKET_DIRENT_COMPACT_MAGIC, bl);
+    ::encode((__u8)RGW_BUCKET_DIRENT_COMPACT_VERSION, bl);
+    ::encode(flags, bl);
+    ::encode(exists, bl);
+    ::encode(category, bl);
+    ::encode(name_off, bl);
+    ::encode(name_len, bl);
+    ::encode(size, bl);
+    ::encode(mtime_ns, bl);
+  }
+  void decode(bufferlist::iterator& bl) {
+    __u8 magic, version;
+    ::decode(magic, bl);
+    ::decode(version, bl);
+    if (magic != RGW_BUCKET_DIRENT_COMPACT_MAGIC ||
+        version != RGW_BUCKET_DIRENT_COMPACT_VERSION) {
+      throw buffer::error();
+    }
+    ::decode(flags, bl);
+    ::decode(exists, bl);
+    ::decode(category, bl);
+    ::decode(name_off, bl);
+    ::decode(name_len, bl);
+    ::decode(size, bl);
+    ::decode(mtime_ns, bl);
+  }
+};
+WRITE_CLASS_ENCODER(rgw_bucket_dir_entry_compact_header)
+
 enum BIIndexType {
   InvalidIdx    = 0,
   PlainIdx      = 1,
@@ -565,22 +648,34 @@ struct rgw_bucket_category_stats {
 };
 WRITE_CLASS_ENCODER(rgw_bucket_category_stats)
 
+/* resharding state of a bucket index shard object; while a shard is
+ * IN_PROGRESS all index write ops on it fail with
+ * -CLS_RGW_ERR_BUSY_RESHARDING, and the caller is expected to refresh the
+ * bucket instance info and retry against the new shard set */
+#define CLS_RGW_RESHARD_NONE         0
+#define CLS_RGW_RESHARD_IN_PROGRESS  1
+
+#define CLS_RGW_ERR_BUSY_RESHARDING  2300
+
 struct rgw_bucket_dir_header {
   map<uint8_t, rgw_bucket_category_stats> stats;
   uint64_t tag_timeout;
   uint64_t ver;
   uint64_t master_ver;
   string max_marker;
+  uint8_t reshard_status;
 
-  rgw_bucket_dir_header() : tag_timeout(0), ver(0), master_ver(0) {}
+  rgw_bucket_dir_header() : tag_timeout(0), ver(0), master_ver(0),
+                            reshard_status(CLS_RGW_RESHARD_NONE) {}
 
   void encode(bufferlist &bl) const {
-    ENCODE_START(5, 2, bl);
+    ENCODE_START(6, 2, bl);
     ::encode(stats, bl);
     ::encode(tag_timeout, bl);
     ::encode(ver, bl);
     ::encode(master_ver, bl);
     ::encode(max_marker, bl);
+    ::encode(reshard_status, bl);
     ENCODE_FINISH(bl);
   }
   void decode(bufferlist::iterator &bl) {
@@ -600,8 +695,18 @@ struct rgw_bucket_dir_header {
     if (struct_v >= 5) {
       ::decode(max_marker, bl);
     }
+    if (struct_v >= 6) {
+      ::decode(reshard_status, bl);
+    } else {
+      reshard_status = CLS_RGW_RESHARD_NONE;
+    }
     DECODE_FINISH(bl);
   }
+
+  bool resharding() const {
+    return reshard_status == CLS_RGW_RESHARD_IN_PROGRESS;
+  }
+
   void dump(Formatter *f) const;
   static void generate_test_instances(list<rgw_bucket_dir_header*>& o);
 };
@@ -4,6 +4,9 @@
 #ifndef CEPH_OS_BLUESTORE_CHECKSUMMER
 #define CEPH_OS_BLUESTORE_CHECKSUMMER
 
+#include <utility>
+#include <vector>
+
 #include "include/buffer.h"
 #include "xxHash/xxhash.h"
 
@@ -181,6 +184,47 @@ public:
     Alg::fini(&state);
     return -1;  // no errors
   }
+
+  /// verify a set of discontiguous extents of the same csum run in one
+  /// pass, sharing the algorithm state (and thus any SIMD setup cost)
+  /// across all of them.  each extent is (offset, data); offsets are in
+  /// the same space as the csum_data vector.
+  template<class Alg>
+  static int verify_extents(
+    size_t csum_block_size,
+    const std::vector<std::pair<size_t, const bufferlist*>> &extents,
+    const bufferptr& csum_data
+    ) {
+    typename Alg::state_t state;
+    Alg::init(&state);
+
+    int bad = -1;  // no errors
+    for (auto& e : extents) {
+      size_t offset = e.first;
+      const bufferlist& bl = *e.second;
+      size_t length = bl.length();
+      assert(length % csum_block_size == 0);
+      bufferlist::const_iterator p = bl.begin();
+
+      const typename Alg::value_t *pv =
+	reinterpret_cast<const typename Alg::value_t*>(csum_data.c_str());
+      pv += offset / csum_block_size;
+      size_t pos = offset;
+      while (length > 0) {
+	typename Alg::value_t v = Alg::calc(state, csum_block_size, p);
+	if (*pv != v) {
+	  bad = pos;
+	  goto out;
+	}
+	++pv;
+	pos += csum_block_size;
+	length -= csum_block_size;
+      }
+    }
+  out:
+    Alg::fini(&state);
+    return bad;
+  }
 };
 
 #endif
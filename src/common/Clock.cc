@@ -43,3 +43,56 @@ time_t ceph_clock_gettime(CephContext *cct)
     ret += ((time_t)cct->_conf->clock_offset);
   return ret;
 }
+
+utime_t ceph_clock_now_coarse(CephContext *cct)
+{
+#if defined(CLOCK_REALTIME_COARSE)
+  // Linux systems have _COARSE clocks.
+  struct timespec tp;
+  clock_gettime(CLOCK_REALTIME_COARSE, &tp);
+  utime_t n(tp);
+  if (cct)
+    n += cct->_conf->clock_offset;
+  return n;
+#elif defined(CLOCK_REALTIME_FAST)
+  // BSD systems have _FAST clocks.
+  struct timespec tp;
+  clock_gettime(CLOCK_REALTIME_FAST, &tp);
+  utime_t n(tp);
+  if (cct)
+    n += cct->_conf->clock_offset;
+  return n;
+#else
+  return ceph_clock_now(cct);
+#endif
+}
+
+// __thread wants a trivial type, so cache the raw timespec, not a
+// utime_t
+static __thread struct timespec clock_recent_ts = { 0, 0 };
+
+void ceph_clock_refresh()
+{
+#if defined(CLOCK_REALTIME_COARSE)
+  clock_gettime(CLOCK_REALTIME_COARSE, &clock_recent_ts);
+#elif defined(CLOCK_REALTIME_FAST)
+  clock_gettime(CLOCK_REALTIME_FAST, &clock_recent_ts);
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  clock_recent_ts.tv_sec = tv.tv_sec;
+  clock_recent_ts.tv_nsec = tv.tv_usec * 1000;
+#endif
+}
+
+utime_t ceph_clock_recent(CephContext *cct)
+{
+  if (clock_recent_ts.tv_sec == 0) {
+    // this thread never refreshes; don't hand out a stale stamp
+    return ceph_clock_now_coarse(cct);
+  }
+  utime_t n(clock_recent_ts);
+  if (cct)
+    n += cct->_conf->clock_offset;
+  return n;
+}
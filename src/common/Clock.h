@@ -24,4 +24,21 @@ class CephContext;
 extern utime_t ceph_clock_now(CephContext *cct);
 extern time_t ceph_clock_gettime(CephContext *cct);
 
+/* Cheaper tiers for hot paths that only need a stamp, not a precise
+ * measurement.  For measuring intervals, see Cycles.h.
+ *
+ * ceph_clock_now_coarse reads the kernel's coarse clock (last-tick
+ * resolution, typically 1-4ms, no hardware clock read); use it for
+ * stamps that feed dumps, warnings and second-scale timeouts.
+ *
+ * ceph_clock_recent returns a per-thread cached coarse stamp,
+ * refreshed by ceph_clock_refresh.  Worker threads get a refresh per
+ * work item via HeartbeatMap::reset_timeout, so under such a loop it
+ * is at most one item stale; a thread that never refreshes falls back
+ * to ceph_clock_now_coarse.
+ */
+extern utime_t ceph_clock_now_coarse(CephContext *cct);
+extern utime_t ceph_clock_recent(CephContext *cct);
+extern void ceph_clock_refresh();
+
 #endif
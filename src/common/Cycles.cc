@@ -186,6 +186,26 @@ uint64_t Cycles::to_nanoseconds(uint64_t cycles, double cycles_per_sec)
   return (uint64_t) (1e09*static_cast<double>(cycles)/cycles_per_sec + 0.5);
 }
 
+/**
+ * Given an elapsed time measured in cycles, return a utime_t for the
+ * corresponding interval, suitable for feeding PerfCounters::tinc().
+ * Cycles::init() must have been called.
+ * \param cycles
+ *      Difference between the results of two calls to rdtsc.
+ * \param cycles_per_sec
+ *      Optional parameter to specify the frequency of the counter that #cycles
+ *      was taken from. Useful when converting a remote machine's tick counter
+ *      to seconds. The default value of 0 will use the local processor's
+ *      computed counter frequency.
+ * \return
+ *      The interval corresponding to cycles (rounded to nanoseconds).
+ */
+utime_t Cycles::to_utime(uint64_t cycles, double cycles_per_sec)
+{
+  uint64_t ns = to_nanoseconds(cycles, cycles_per_sec);
+  return utime_t(ns / 1000000000ull, ns % 1000000000ull);
+}
+
 /**
  * Given a number of nanoseconds, return an approximate number of
  * cycles for an equivalent time length.
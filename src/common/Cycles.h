@@ -32,6 +32,8 @@
 #ifndef CEPH_CYCLES_H
 #define CEPH_CYCLES_H
 
+#include "include/utime.h"
+
 /**
  * This class provides static methods that read the fine-grain CPU
  * cycle counter and translate between cycle-level times and absolute
@@ -89,6 +91,7 @@ class Cycles {
   static uint64_t from_seconds(double seconds, double cycles_per_sec = 0);
   static uint64_t to_microseconds(uint64_t cycles, double cycles_per_sec = 0);
   static uint64_t to_nanoseconds(uint64_t cycles, double cycles_per_sec = 0);
+  static utime_t to_utime(uint64_t cycles, double cycles_per_sec = 0);
   static uint64_t from_nanoseconds(uint64_t ns, double cycles_per_sec = 0);
   static void sleep(uint64_t us);
 
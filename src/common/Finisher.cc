@@ -105,3 +105,46 @@ void *Finisher::finisher_thread_entry()
   return 0;
 }
 
+ShardedFinisher::ShardedFinisher(CephContext *cct, const string &name,
+				 const string &tn, int n)
+{
+  assert(n > 0);
+  for (int i = 0; i < n; ++i) {
+    ostringstream oss;
+    oss << name << "-" << i;
+    finishers.push_back(new Finisher(cct, oss.str(), tn));
+  }
+}
+
+ShardedFinisher::~ShardedFinisher()
+{
+  for (vector<Finisher*>::iterator p = finishers.begin();
+       p != finishers.end();
+       ++p)
+    delete *p;
+}
+
+void ShardedFinisher::start()
+{
+  for (vector<Finisher*>::iterator p = finishers.begin();
+       p != finishers.end();
+       ++p)
+    (*p)->start();
+}
+
+void ShardedFinisher::stop()
+{
+  for (vector<Finisher*>::iterator p = finishers.begin();
+       p != finishers.end();
+       ++p)
+    (*p)->stop();
+}
+
+void ShardedFinisher::wait_for_empty()
+{
+  for (vector<Finisher*>::iterator p = finishers.begin();
+       p != finishers.end();
+       ++p)
+    (*p)->wait_for_empty();
+}
+
@@ -22,6 +22,7 @@
 
 #include "HeartbeatMap.h"
 #include "ceph_context.h"
+#include "common/Clock.h"
 #include "common/errno.h"
 #include "common/valgrind.h"
 
@@ -100,6 +101,11 @@ void HeartbeatMap::reset_timeout(heartbeat_handle_d *h, time_t grace, time_t sui
   time_t now = time(NULL);
   _check(h, "reset_timeout", now);
 
+  // every worker loop resets its timeout once per work item, which
+  // makes this the natural place to refresh the thread's cached stamp
+  // (see ceph_clock_recent)
+  ceph_clock_refresh();
+
   h->timeout.set(now + grace);
   h->grace = grace;
 
@@ -347,7 +347,10 @@ version_t LogClient::queue(LogEntry &entry)
   log_queue.push_back(entry);
 
   if (is_mon) {
-    _send_to_mon();
+    // keep a single MLog in flight; anything that queues up behind it
+    // is batched into one message when its ack arrives
+    if (log_queue.front().seq > last_log_sent)
+      _send_to_mon();
   }
 
   return entry.seq;
@@ -368,6 +371,11 @@ bool LogClient::handle_log_ack(MLogAck *m)
     ldout(cct,10) << " logged " << entry << dendl;
     q = log_queue.erase(q);
   }
+
+  if (is_mon && last_log > last_log_sent) {
+    // flush the batch that accumulated behind the acked message
+    _send_to_mon();
+  }
   return true;
 }
 
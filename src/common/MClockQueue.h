@@ -0,0 +1,279 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef MCLOCK_QUEUE_H
+#define MCLOCK_QUEUE_H
+
+#include "common/Formatter.h"
+#include "common/Clock.h"
+#include "OpQueue.h"
+
+#include <map>
+#include <list>
+#include <vector>
+#include <limits>
+#include <functional>
+
+/**
+ * reservation/weight/limit triple for one scheduling class.
+ *
+ * reservation and limit are in ops per second (0 means none); weight is
+ * a dimensionless share used to apportion capacity beyond reservations.
+ */
+struct mclock_qos_spec {
+  double reservation;
+  double weight;
+  double limit;
+};
+
+/**
+ * mClock-style QoS queue
+ *
+ * Simplified single-server variant of the mClock scheduler (Gulati et
+ * al., OSDI'10).  The caller supplies a classifier mapping each item to
+ * a scheduling class (e.g. client, recovery, scrub, snaptrim) and a qos
+ * spec per class.  Every op is stamped at enqueue with reservation,
+ * proportional and limit tags derived from its class's spec and the
+ * tags of the op queued before it; dequeue serves the smallest
+ * reservation tag that has come due, and otherwise the smallest
+ * proportional tag among classes under their limit.  The queue is
+ * work-conserving: if every backlogged class is at its limit, the
+ * smallest proportional tag is served anyway, so limits shape relative
+ * order rather than leaving the device idle.
+ *
+ * enqueue_strict bypasses tagging entirely and is served in strict
+ * priority order ahead of all tagged ops, mirroring the other OpQueue
+ * implementations.
+ */
+template <typename T, typename K>
+class MClockQueue : public OpQueue<T, K> {
+
+  struct Tag {
+    double r, p, l;
+    Tag() : r(0), p(0), l(0) {}
+  };
+
+  struct Item {
+    K cl;
+    T item;
+    Tag tag;
+    Item(K c, T& i, const Tag& t) : cl(c), item(i), tag(t) {}
+  };
+
+  struct ClassState {
+    std::list<Item> q;	///< FIFO within a scheduling class
+    Tag prev;		///< tags of the most recently enqueued op
+  };
+
+  std::vector<mclock_qos_spec> specs;
+  std::vector<ClassState> classes;
+  std::function<unsigned(const T&)> classify;
+  unsigned tagged_size;
+
+  /// strict-priority ops (peering etc.) bypass qos tagging; highest
+  /// priority first
+  std::map<unsigned, std::list<std::pair<K, T> >,
+	   std::greater<unsigned> > strict;
+  unsigned strict_size;
+
+  static double now() {
+    return ceph_clock_now(NULL);
+  }
+
+  Tag next_tag(unsigned c, double t) const {
+    const mclock_qos_spec &spec = specs[c];
+    const Tag &prev = classes[c].prev;
+    Tag tag;
+    tag.r = spec.reservation > 0 ?
+      std::max(t, prev.r + 1.0 / spec.reservation) :
+      std::numeric_limits<double>::max();
+    tag.p = std::max(t, prev.p) + (spec.weight > 0 ? 1.0 / spec.weight : 1.0);
+    tag.l = spec.limit > 0 ? std::max(t, prev.l + 1.0 / spec.limit) : t;
+    return tag;
+  }
+
+ public:
+  MClockQueue(const std::vector<mclock_qos_spec>& s,
+	      std::function<unsigned(const T&)> c)
+    : specs(s), classes(s.size()), classify(c),
+      tagged_size(0), strict_size(0) {}
+
+  unsigned length() const override final {
+    return strict_size + tagged_size;
+  }
+
+  bool empty() const override final {
+    return !(strict_size + tagged_size);
+  }
+
+  void enqueue_strict(K cl, unsigned priority, T item) override final {
+    strict[priority].push_back(std::make_pair(cl, item));
+    ++strict_size;
+  }
+
+  void enqueue_strict_front(K cl, unsigned priority, T item) override final {
+    strict[priority].push_front(std::make_pair(cl, item));
+    ++strict_size;
+  }
+
+  void enqueue(K cl, unsigned priority, unsigned cost, T item) override final {
+    unsigned c = classify(item);
+    assert(c < classes.size());
+    ClassState &cs = classes[c];
+    Tag tag = next_tag(c, now());
+    cs.prev = tag;
+    cs.q.push_back(Item(cl, item, tag));
+    ++tagged_size;
+  }
+
+  void enqueue_front(K cl, unsigned priority, unsigned cost,
+		     T item) override final {
+    unsigned c = classify(item);
+    assert(c < classes.size());
+    // requeued ops keep a zero tag so they are eligible immediately and
+    // sort ahead of everything stamped with a real timestamp
+    classes[c].q.push_front(Item(cl, item, Tag()));
+    ++tagged_size;
+  }
+
+  T dequeue() override final {
+    assert(strict_size + tagged_size > 0);
+    if (strict_size) {
+      typename decltype(strict)::iterator i = strict.begin();
+      T ret = i->second.front().second;
+      i->second.pop_front();
+      if (i->second.empty())
+	strict.erase(i);
+      --strict_size;
+      return ret;
+    }
+    double t = now();
+    // reservation phase: smallest reservation tag that has come due
+    int best = -1;
+    for (unsigned c = 0; c < classes.size(); ++c) {
+      if (classes[c].q.empty())
+	continue;
+      const Tag &tag = classes[c].q.front().tag;
+      if (tag.r <= t &&
+	  (best < 0 || tag.r < classes[best].q.front().tag.r))
+	best = c;
+    }
+    if (best < 0) {
+      // proportional phase: smallest proportional tag under its limit;
+      // if everything is capped, ignore limits rather than idle
+      int fallback = -1;
+      for (unsigned c = 0; c < classes.size(); ++c) {
+	if (classes[c].q.empty())
+	  continue;
+	const Tag &tag = classes[c].q.front().tag;
+	if (tag.l <= t &&
+	    (best < 0 || tag.p < classes[best].q.front().tag.p))
+	  best = c;
+	if (fallback < 0 || tag.p < classes[fallback].q.front().tag.p)
+	  fallback = c;
+      }
+      if (best < 0)
+	best = fallback;
+    }
+    assert(best >= 0);
+    ClassState &cs = classes[best];
+    T ret = cs.q.front().item;
+    cs.q.pop_front();
+    --tagged_size;
+    return ret;
+  }
+
+  void remove_by_filter(std::function<bool (T)> f) override final {
+    for (typename decltype(strict)::iterator p = strict.begin();
+	 p != strict.end(); ) {
+      for (typename std::list<std::pair<K, T> >::iterator i =
+	     p->second.end(); i != p->second.begin(); ) {
+	--i;
+	if (f(i->second)) {
+	  i = p->second.erase(i);
+	  --strict_size;
+	}
+      }
+      if (p->second.empty())
+	strict.erase(p++);
+      else
+	++p;
+    }
+    for (unsigned c = 0; c < classes.size(); ++c) {
+      std::list<Item> &q = classes[c].q;
+      for (typename std::list<Item>::iterator i = q.end();
+	   i != q.begin(); ) {
+	--i;
+	if (f(i->item)) {
+	  i = q.erase(i);
+	  --tagged_size;
+	}
+      }
+    }
+  }
+
+  void remove_by_class(K k, std::list<T> *out) override final {
+    for (typename decltype(strict)::iterator p = strict.begin();
+	 p != strict.end(); ) {
+      for (typename std::list<std::pair<K, T> >::iterator i =
+	     p->second.end(); i != p->second.begin(); ) {
+	--i;
+	if (i->first == k) {
+	  if (out)
+	    out->push_front(i->second);
+	  i = p->second.erase(i);
+	  --strict_size;
+	}
+      }
+      if (p->second.empty())
+	strict.erase(p++);
+      else
+	++p;
+    }
+    for (unsigned c = 0; c < classes.size(); ++c) {
+      std::list<Item> &q = classes[c].q;
+      for (typename std::list<Item>::iterator i = q.end();
+	   i != q.begin(); ) {
+	--i;
+	if (i->cl == k) {
+	  if (out)
+	    out->push_front(i->item);
+	  i = q.erase(i);
+	  --tagged_size;
+	}
+      }
+    }
+  }
+
+  void dump(ceph::Formatter *f) const override final {
+    f->dump_int("strict_size", strict_size);
+    f->dump_int("tagged_size", tagged_size);
+    f->open_array_section("classes");
+    for (unsigned c = 0; c < classes.size(); ++c) {
+      f->open_object_section("class");
+      f->dump_unsigned("class", c);
+      f->dump_float("reservation", specs[c].reservation);
+      f->dump_float("weight", specs[c].weight);
+      f->dump_float("limit", specs[c].limit);
+      f->dump_unsigned("size", classes[c].q.size());
+      if (!classes[c].q.empty()) {
+	const Tag &tag = classes[c].q.front().tag;
+	f->dump_float("head_proportional_tag", tag.p);
+	f->dump_float("head_limit_tag", tag.l);
+      }
+      f->close_section();
+    }
+    f->close_section();
+  }
+};
+
+#endif
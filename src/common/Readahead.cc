@@ -11,12 +11,8 @@ Readahead::Readahead()
     m_readahead_max_bytes(NO_LIMIT),
     m_alignments(),
     m_lock("Readahead::m_lock"),
-    m_nr_consec_read(0),
-    m_consec_read_bytes(0),
-    m_last_pos(0),
-    m_readahead_pos(0),
-    m_readahead_trigger_pos(0),
-    m_readahead_size(0),
+    m_streams(1),
+    m_tick(0),
     m_pending(0),
     m_pending_lock("Readahead::m_pending_lock") {
 }
@@ -26,66 +22,121 @@ Readahead::~Readahead() {
 
 Readahead::extent_t Readahead::update(const vector<extent_t>& extents, uint64_t limit) {
   m_lock.Lock();
+  Stream *s = NULL;
   for (vector<extent_t>::const_iterator p = extents.begin(); p != extents.end(); ++p) {
-    _observe_read(p->first, p->second);
+    s = _observe_read(p->first, p->second);
   }
-  if (m_readahead_pos >= limit|| m_last_pos >= limit) {
+  if (!s || s->readahead_pos >= limit || s->last_pos >= limit) {
     m_lock.Unlock();
     return extent_t(0, 0);
   }
-  pair<uint64_t, uint64_t> extent = _compute_readahead(limit);
+  pair<uint64_t, uint64_t> extent = _compute_readahead(s, limit);
   m_lock.Unlock();
   return extent;
 }
 
 Readahead::extent_t Readahead::update(uint64_t offset, uint64_t length, uint64_t limit) {
   m_lock.Lock();
-  _observe_read(offset, length);
-  if (m_readahead_pos >= limit || m_last_pos >= limit) {
+  Stream *s = _observe_read(offset, length);
+  if (s->readahead_pos >= limit || s->last_pos >= limit) {
     m_lock.Unlock();
     return extent_t(0, 0);
   }
-  extent_t extent = _compute_readahead(limit);
+  extent_t extent = _compute_readahead(s, limit);
   m_lock.Unlock();
   return extent;
 }
 
-void Readahead::_observe_read(uint64_t offset, uint64_t length) {
-  if (offset == m_last_pos) {
-    m_nr_consec_read++;
-    m_consec_read_bytes += length;
-  } else {
-    m_nr_consec_read = 0;
-    m_consec_read_bytes = 0;
-    m_readahead_trigger_pos = 0;
-    m_readahead_size = 0;
-    m_readahead_pos = 0;
+Readahead::Stream *Readahead::_observe_read(uint64_t offset, uint64_t length) {
+  ++m_tick;
+
+  // continuation of a known stream?
+  for (vector<Stream>::iterator p = m_streams.begin(); p != m_streams.end(); ++p) {
+    if (offset == p->last_pos + p->stride) {
+      if (p->stride) {
+	p->stride_confirmed = true;
+      }
+      p->nr_consec_read++;
+      p->consec_read_bytes += length;
+      p->last_pos = offset + length;
+      p->last_use = m_tick;
+      return &*p;
+    }
+  }
+
+  // does this read establish a stride on an active stream?  only pick
+  // up gaps comparable to the request size: prefetching a contiguous
+  // window over a strided scan only pays off while the holes are
+  // comparable to the data actually read.
+  if (m_streams.size() > 1) {
+    Stream *best = NULL;
+    uint64_t best_gap = 0;
+    for (vector<Stream>::iterator p = m_streams.begin(); p != m_streams.end(); ++p) {
+      if (p->last_use == 0 || offset <= p->last_pos) {
+	continue;
+      }
+      uint64_t gap = offset - p->last_pos;
+      if (gap > length * 4) {
+	continue;
+      }
+      if (!best || gap < best_gap) {
+	best = &*p;
+	best_gap = gap;
+      }
+    }
+    if (best) {
+      best->stride = best_gap;
+      best->stride_confirmed = false;
+      // retrain with this read as the first of the strided run
+      best->nr_consec_read = 1;
+      best->consec_read_bytes = length;
+      best->last_pos = offset + length;
+      best->readahead_pos = 0;
+      best->readahead_trigger_pos = 0;
+      best->readahead_size = 0;
+      best->last_use = m_tick;
+      return best;
+    }
   }
-  m_last_pos = offset + length;
+
+  // no match; evict the least recently used stream and start over
+  Stream *victim = &m_streams.front();
+  for (vector<Stream>::iterator p = m_streams.begin(); p != m_streams.end(); ++p) {
+    if (p->last_use < victim->last_use) {
+      victim = &*p;
+    }
+  }
+  *victim = Stream();
+  victim->last_pos = offset + length;
+  victim->last_use = m_tick;
+  return victim;
 }
 
-Readahead::extent_t Readahead::_compute_readahead(uint64_t limit) {
+Readahead::extent_t Readahead::_compute_readahead(Stream *s, uint64_t limit) {
   uint64_t readahead_offset = 0;
   uint64_t readahead_length = 0;
-  if (m_nr_consec_read >= m_trigger_requests) {
+  if (s->stride && !s->stride_confirmed) {
+    return extent_t(0, 0);
+  }
+  if (s->nr_consec_read >= m_trigger_requests) {
     // currently reading sequentially
-    if (m_last_pos >= m_readahead_trigger_pos) {
+    if (s->last_pos >= s->readahead_trigger_pos) {
       // need to read ahead
-      if (m_readahead_size == 0) {
+      if (s->readahead_size == 0) {
 	// initial readahead trigger
-	m_readahead_size = m_consec_read_bytes;
-	m_readahead_pos = m_last_pos;
+	s->readahead_size = s->consec_read_bytes;
+	s->readahead_pos = s->last_pos;
       } else {
 	// continuing readahead trigger
-	m_readahead_size *= 2;
-	if (m_last_pos > m_readahead_pos) {
-	  m_readahead_pos = m_last_pos;
+	s->readahead_size *= 2;
+	if (s->last_pos > s->readahead_pos) {
+	  s->readahead_pos = s->last_pos;
 	}
       }
-      m_readahead_size = MAX(m_readahead_size, m_readahead_min_bytes);
-      m_readahead_size = MIN(m_readahead_size, m_readahead_max_bytes);
-      readahead_offset = m_readahead_pos;
-      readahead_length = m_readahead_size;
+      s->readahead_size = MAX(s->readahead_size, m_readahead_min_bytes);
+      s->readahead_size = MIN(s->readahead_size, m_readahead_max_bytes);
+      readahead_offset = s->readahead_pos;
+      readahead_length = s->readahead_size;
 
       // Snap to the first alignment possible
       uint64_t readahead_end = readahead_offset + readahead_length;
@@ -110,12 +161,12 @@ Readahead::extent_t Readahead::_compute_readahead(uint64_t limit) {
 	// Note that m_readahead_size should remain unadjusted.
       }
 
-      if (m_readahead_pos + readahead_length > limit) {
-	readahead_length = limit - m_readahead_pos;
+      if (s->readahead_pos + readahead_length > limit) {
+	readahead_length = limit - s->readahead_pos;
       }
 
-      m_readahead_trigger_pos = m_readahead_pos + readahead_length / 2;
-      m_readahead_pos += readahead_length;
+      s->readahead_trigger_pos = s->readahead_pos + readahead_length / 2;
+      s->readahead_pos += readahead_length;
     }
   }
   return extent_t(readahead_offset, readahead_length);
@@ -168,6 +219,15 @@ void Readahead::set_trigger_requests(int trigger_requests) {
   m_lock.Unlock();
 }
 
+void Readahead::set_max_streams(int max_streams) {
+  assert(max_streams >= 1);
+  m_lock.Lock();
+  m_streams.clear();
+  m_streams.resize(max_streams);
+  m_tick = 0;
+  m_lock.Unlock();
+}
+
 uint64_t Readahead::get_min_readahead_size(void) {
   Mutex::Locker lock(m_lock);
   return m_readahead_min_bytes;
@@ -78,6 +78,16 @@ public:
    */
   void set_trigger_requests(int trigger_requests);
 
+  /**
+     Sets the maximum number of independent access streams to track.
+     The default is 1, which behaves exactly like the classic detector.
+     With more than one stream, interleaved sequential readers are tracked
+     separately instead of defeating each other, and constant-stride
+     patterns are detected and prefetched once the stride has repeated.
+     Changing the stream count resets all detector state.
+   */
+  void set_max_streams(int max_streams);
+
   /**
      Gets the minimum size of a readahead request, in bytes.
    */
@@ -107,17 +117,53 @@ public:
   void set_alignments(const std::vector<uint64_t> &alignments);
 
 private:
+  /// State for one tracked access stream
+  struct Stream {
+    /// Number of consecutive read requests in this stream
+    int nr_consec_read;
+
+    /// Number of bytes read in this stream's current run
+    uint64_t consec_read_bytes;
+
+    /// Position of the read stream
+    uint64_t last_pos;
+
+    /// Gap between the end of one read and the start of the next (0 = sequential)
+    uint64_t stride;
+
+    /// True once a nonzero stride has repeated
+    bool stride_confirmed;
+
+    /// Position of the readahead stream
+    uint64_t readahead_pos;
+
+    /// When readahead is already triggered and the read stream crosses this point, readahead is continued
+    uint64_t readahead_trigger_pos;
+
+    /// Size of the next readahead request (barring changes due to alignment, etc.)
+    uint64_t readahead_size;
+
+    /// Tick of the last matching request, for LRU eviction
+    uint64_t last_use;
+
+    Stream()
+      : nr_consec_read(0), consec_read_bytes(0), last_pos(0), stride(0),
+	stride_confirmed(false), readahead_pos(0), readahead_trigger_pos(0),
+	readahead_size(0), last_use(0) {}
+  };
+
   /**
-     Records that a read request has been received.
+     Records that a read request has been received, matching it to (or
+     starting) a stream.  Returns the stream the request landed in.
      m_lock must be held while calling.
    */
-  void _observe_read(uint64_t offset, uint64_t length);
+  Stream *_observe_read(uint64_t offset, uint64_t length);
 
   /**
-     Computes the next readahead request.
+     Computes the next readahead request for the given stream.
      m_lock must be held while calling.
   */
-  extent_t _compute_readahead(uint64_t limit);
+  extent_t _compute_readahead(Stream *s, uint64_t limit);
 
   /// Number of sequential requests necessary to trigger readahead
   int m_trigger_requests;
@@ -134,23 +180,11 @@ private:
   /// Held while reading/modifying any state except m_pending
   Mutex m_lock;
 
-  /// Number of consecutive read requests in the current sequential stream
-  int m_nr_consec_read;
-
-  /// Number of bytes read in the current sequenial stream
-  uint64_t m_consec_read_bytes;
-
-  /// Position of the read stream
-  uint64_t m_last_pos;
-
-  /// Position of the readahead stream
-  uint64_t m_readahead_pos;
-
-  /// When readahead is already triggered and the read stream crosses this point, readahead is continued
-  uint64_t m_readahead_trigger_pos;
+  /// Tracked access streams; index 0 always exists
+  std::vector<Stream> m_streams;
 
-  /// Size of the next readahead request (barring changes due to alignment, etc.)
-  uint64_t m_readahead_size;
+  /// Request counter used to age streams for LRU eviction
+  uint64_t m_tick;
 
   /// Number of pending readahead requests, as determined by inc_pending() and dec_pending()
   int m_pending;
@@ -30,9 +30,11 @@ enum {
   l_throttle_last,
 };
 
-Throttle::Throttle(CephContext *cct, const std::string& n, int64_t m, bool _use_perf)
+Throttle::Throttle(CephContext *cct, const std::string& n, int64_t m,
+		   bool _use_perf, Throttle *p)
   : cct(cct), name(n), logger(NULL),
     max(m),
+    parent(p),
     lock("Throttle::lock"),
     use_perf(_use_perf)
 {
@@ -97,7 +99,10 @@ bool Throttle::_wait(int64_t c)
   if (_should_wait(c) || !cond.empty()) { // always wait behind other waiters.
     Cond *cv = new Cond;
     cond.push_back(cv);
-    do {
+    waiters.inc();
+    // recheck now that we have advertised ourselves; a lock-free put()
+    // that saw no waiters may have freed slots since the check above
+    while (_should_wait(c) || cv != cond.front()) {
       if (!waited) {
 	ldout(cct, 2) << "_wait waiting..." << dendl;
 	if (logger)
@@ -105,7 +110,7 @@ bool Throttle::_wait(int64_t c)
       }
       waited = true;
       cv->Wait(lock);
-    } while (_should_wait(c) || cv != cond.front());
+    }
 
     if (waited) {
       ldout(cct, 3) << "_wait finished waiting" << dendl;
@@ -117,6 +122,7 @@ bool Throttle::_wait(int64_t c)
 
     delete cv;
     cond.pop_front();
+    waiters.dec();
 
     // wake up the next guy
     if (!cond.empty())
@@ -142,15 +148,14 @@ bool Throttle::wait(int64_t m)
 
 int64_t Throttle::take(int64_t c)
 {
+  if (parent)
+    parent->take(c);
   if (0 == max.read()) {
     return 0;
   }
   assert(c >= 0);
   ldout(cct, 10) << "take " << c << dendl;
-  {
-    Mutex::Locker l(lock);
-    count.add(c);
-  }
+  count.add(c);
   if (logger) {
     logger->inc(l_throttle_take);
     logger->inc(l_throttle_take_sum, c);
@@ -162,13 +167,27 @@ int64_t Throttle::take(int64_t c)
 bool Throttle::get(int64_t c, int64_t m)
 {
   if (0 == max.read() && 0 == m) {
-    return false;
+    return parent ? parent->get(c) : false;
   }
 
   assert(c >= 0);
   ldout(cct, 10) << "get " << c << " (" << count.read() << " -> " << (count.read() + c) << ")" << dendl;
   bool waited = false;
-  {
+  bool got = false;
+  if (0 == m) {
+    // fast path: grab the slots with a cas as long as nobody is queued;
+    // anyone queued stays FIFO through the slow path below
+    while (!waiters.read()) {
+      int64_t cur = count.read();
+      if (_should_wait(c, cur))
+	break;
+      if (count.compare_and_swap(cur, cur + c)) {
+	got = true;
+	break;
+      }
+    }
+  }
+  if (!got) {
     Mutex::Locker l(lock);
     if (m) {
       assert(m > 0);
@@ -182,6 +201,8 @@ bool Throttle::get(int64_t c, int64_t m)
     logger->inc(l_throttle_get_sum, c);
     logger->set(l_throttle_val, count.read());
   }
+  if (parent && parent->get(c))
+    waited = true;
   return waited;
 }
 
@@ -191,49 +212,73 @@ bool Throttle::get(int64_t c, int64_t m)
 bool Throttle::get_or_fail(int64_t c)
 {
   if (0 == max.read()) {
-    return true;
+    return parent ? parent->get_or_fail(c) : true;
   }
 
   assert (c >= 0);
-  Mutex::Locker l(lock);
-  if (_should_wait(c) || !cond.empty()) {
+  bool got = false;
+  while (!waiters.read()) {
+    int64_t cur = count.read();
+    if (_should_wait(c, cur))
+      break;
+    if (count.compare_and_swap(cur, cur + c)) {
+      got = true;
+      break;
+    }
+  }
+  if (got && parent && !parent->get_or_fail(c)) {
+    _put_local(c);
+    got = false;
+  }
+  if (!got) {
     ldout(cct, 10) << "get_or_fail " << c << " failed" << dendl;
     if (logger) {
       logger->inc(l_throttle_get_or_fail_fail);
     }
     return false;
-  } else {
-    ldout(cct, 10) << "get_or_fail " << c << " success (" << count.read() << " -> " << (count.read() + c) << ")" << dendl;
-    count.add(c);
-    if (logger) {
-      logger->inc(l_throttle_get_or_fail_success);
-      logger->inc(l_throttle_get);
-      logger->inc(l_throttle_get_sum, c);
-      logger->set(l_throttle_val, count.read());
-    }
-    return true;
   }
+  ldout(cct, 10) << "get_or_fail " << c << " success (" << (count.read() - c) << " -> " << count.read() << ")" << dendl;
+  if (logger) {
+    logger->inc(l_throttle_get_or_fail_success);
+    logger->inc(l_throttle_get);
+    logger->inc(l_throttle_get_sum, c);
+    logger->set(l_throttle_val, count.read());
+  }
+  return true;
 }
 
 int64_t Throttle::put(int64_t c)
 {
+  if (parent)
+    parent->put(c);
   if (0 == max.read()) {
     return 0;
   }
 
   assert(c >= 0);
   ldout(cct, 10) << "put " << c << " (" << count.read() << " -> " << (count.read()-c) << ")" << dendl;
-  Mutex::Locker l(lock);
+  return _put_local(c);
+}
+
+int64_t Throttle::_put_local(int64_t c)
+{
   if (c) {
-    if (!cond.empty())
-      cond.front()->SignalOne();
     assert(((int64_t)count.read()) >= c); //if count goes negative, we failed somewhere!
     count.sub(c);
+    int64_t after = count.read();
     if (logger) {
       logger->inc(l_throttle_put);
       logger->inc(l_throttle_put_sum, c);
-      logger->set(l_throttle_val, count.read());
+      logger->set(l_throttle_val, after);
+    }
+    // count.sub() orders before this read, so either a queued getter
+    // sees the new count or we see it on the waiter list
+    if (waiters.read()) {
+      Mutex::Locker l(lock);
+      if (!cond.empty())
+	cond.front()->SignalOne();
     }
+    return after;
   }
   return count.read();
 }
@@ -24,32 +24,45 @@ class PerfCounters;
  * This class defines the maximum number of slots currently taken away. The
  * excessive requests for more of them are delayed, until some slots are put
  * back, so @p get_current() drops below the limit after fulfills the requests.
+ *
+ * As long as nobody is blocked the get/put paths work on the atomic budget
+ * counter alone and never take the lock; the lock and the waiter list are
+ * engaged only on exhaustion. A Throttle may also be given a parent to draw
+ * slots from as well, so a per-client child under a shared parent caps each
+ * client without adding any lock acquisition to the common case.
  */
 class Throttle {
   CephContext *cct;
   const std::string name;
   PerfCounters *logger;
   ceph::atomic_t count, max;
+  ceph::atomic_t waiters;  ///< threads queued on cond, mirrored outside the
+			   ///< lock so the fast paths can test for them
+  Throttle *parent;
   Mutex lock;
   list<Cond*> cond;
   const bool use_perf;
 
 public:
-  Throttle(CephContext *cct, const std::string& n, int64_t m = 0, bool _use_perf = true);
+  Throttle(CephContext *cct, const std::string& n, int64_t m = 0,
+	   bool _use_perf = true, Throttle *parent = NULL);
   ~Throttle();
 
 private:
   void _reset_max(int64_t m);
-  bool _should_wait(int64_t c) const {
+  bool _should_wait(int64_t c, int64_t cur) const {
     int64_t m = max.read();
-    int64_t cur = count.read();
     return
       m &&
       ((c <= m && cur + c > m) || // normally stay under max
        (c >= m && cur > m));     // except for large c
   }
+  bool _should_wait(int64_t c) const {
+    return _should_wait(c, count.read());
+  }
 
   bool _wait(int64_t c);
+  int64_t _put_local(int64_t c);
 
 public:
   /**
@@ -195,3 +195,167 @@ void SafeTimer::dump(const char *caller) const
        ++s)
     ldout(cct,10) << " " << s->first << "->" << s->second << dendl;
 }
+
+
+class TimerWheelThread : public Thread {
+  TimerWheel *parent;
+public:
+  explicit TimerWheelThread(TimerWheel *w) : parent(w) {}
+  void *entry() {
+    parent->timer_thread();
+    return NULL;
+  }
+};
+
+TimerWheel::TimerWheel(CephContext *cct_, Mutex &l, uint32_t tick, uint32_t slots)
+  : cct(cct_), lock(l),
+    thread(NULL),
+    wheel(slots),
+    tick(tick),
+    stopping(false)
+{
+  assert(tick > 0);
+  assert(slots > 0);
+}
+
+TimerWheel::~TimerWheel()
+{
+  assert(thread == NULL);
+}
+
+void TimerWheel::init()
+{
+  ldout(cct,10) << "init" << dendl;
+  utime_t now = ceph_clock_now(cct);
+  next_expire = utime_t(now.sec() - now.sec() % tick, 0);
+  thread = new TimerWheelThread(this);
+  thread->create("timer_wheel");
+}
+
+void TimerWheel::shutdown()
+{
+  ldout(cct,10) << "shutdown" << dendl;
+  if (thread) {
+    assert(lock.is_locked());
+    cancel_all_events();
+    stopping = true;
+    cond.Signal();
+    lock.Unlock();
+    thread->join();
+    lock.Lock();
+    delete thread;
+    thread = NULL;
+  }
+}
+
+void TimerWheel::timer_thread()
+{
+  lock.Lock();
+  ldout(cct,10) << "timer_thread starting" << dendl;
+  while (!stopping) {
+    utime_t now = ceph_clock_now(cct);
+
+    // gather everything due in one batch; entries that hash to these
+    // slots but belong to a later rotation are skipped in place
+    slot_t due;
+    while (next_expire <= now) {
+      slot_t &slot = wheel[slot_of(next_expire)];
+      slot_t::iterator p = slot.begin();
+      while (p != slot.end()) {
+	if (p->first <= now) {
+	  events.erase(p->second);
+	  due.push_back(*p);
+	  p = slot.erase(p);
+	} else {
+	  ++p;
+	}
+      }
+      next_expire += tick;
+    }
+
+    for (slot_t::iterator p = due.begin(); p != due.end(); ++p) {
+      ldout(cct,10) << "timer_thread executing " << p->second << dendl;
+      // may drop and retake the lock; cancels racing with the batch
+      // are handled by the callbacks themselves (see header)
+      p->second->complete(0);
+    }
+
+    // recheck stopping in case a callback dropped the lock
+    if (stopping)
+      break;
+
+    ldout(cct,20) << "timer_thread going to sleep" << dendl;
+    cond.WaitUntil(lock, next_expire);
+    ldout(cct,20) << "timer_thread awake" << dendl;
+  }
+  ldout(cct,10) << "timer_thread exiting" << dendl;
+  lock.Unlock();
+}
+
+void TimerWheel::add_event_after(double seconds, Context *callback)
+{
+  assert(lock.is_locked());
+
+  utime_t when = ceph_clock_now(cct);
+  when += seconds;
+  add_event_at(when, callback);
+}
+
+void TimerWheel::add_event_at(utime_t when, Context *callback)
+{
+  assert(lock.is_locked());
+  ldout(cct,10) << "add_event_at " << when << " -> " << callback << dendl;
+
+  // a deadline in the past still goes in the next slot to sweep, so
+  // it fires on the next tick rather than a full rotation later
+  utime_t effective = when;
+  if (effective < next_expire)
+    effective = next_expire;
+  unsigned s = slot_of(effective);
+  wheel[s].push_back(std::make_pair(when, callback));
+  slot_t::iterator i = wheel[s].end();
+  --i;
+
+  bool inserted = events.insert(
+    std::make_pair(callback, std::make_pair(s, i))).second;
+  /* If you hit this, you tried to insert the same Context* twice. */
+  assert(inserted);
+
+  // no cond signal: the thread sweeps every tick regardless
+}
+
+bool TimerWheel::cancel_event(Context *callback)
+{
+  assert(lock.is_locked());
+
+  ceph::unordered_map<Context*, std::pair<unsigned, slot_t::iterator> >::iterator p =
+    events.find(callback);
+  if (p == events.end()) {
+    ldout(cct,10) << "cancel_event " << callback << " not found" << dendl;
+    return false;
+  }
+
+  ldout(cct,10) << "cancel_event " << p->second.second->first
+		<< " -> " << callback << dendl;
+  delete p->first;
+
+  wheel[p->second.first].erase(p->second.second);
+  events.erase(p);
+  return true;
+}
+
+void TimerWheel::cancel_all_events()
+{
+  ldout(cct,10) << "cancel_all_events" << dendl;
+  assert(lock.is_locked());
+
+  while (!events.empty()) {
+    ceph::unordered_map<Context*, std::pair<unsigned, slot_t::iterator> >::iterator p =
+      events.begin();
+    ldout(cct,10) << " cancelled " << p->second.second->first
+		  << " -> " << p->first << dendl;
+    delete p->first;
+    wheel[p->second.first].erase(p->second.second);
+    events.erase(p);
+  }
+}
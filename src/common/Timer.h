@@ -18,12 +18,16 @@
 #include "Cond.h"
 #include "Mutex.h"
 #include "RWLock.h"
+#include "include/unordered_map.h"
 
+#include <list>
 #include <map>
+#include <vector>
 
 class CephContext;
 class Context;
 class SafeTimerThread;
+class TimerWheelThread;
 
 class SafeTimer
 {
@@ -94,4 +98,78 @@ public:
 
 };
 
+/**
+ * TimerWheel
+ *
+ * Hashed timer wheel with the same external-lock semantics as
+ * SafeTimer (safe_callbacks): events are added and cancelled with the
+ * lock held, callbacks are invoked with the lock held, and a
+ * cancelled event that was found is deleted by cancel_event.
+ *
+ * Arm and cancel are O(1) and never wake the expiry thread, which
+ * sweeps one slot per tick and fires everything due in a batch.  The
+ * trade-off is that events fire up to one tick late, so this is only
+ * suitable for coarse timeouts (e.g. watch expiry), not for precise
+ * scheduling.
+ *
+ * Unlike SafeTimer, a cancel can lose a race with an event that is
+ * already in the expiry batch; such an event is not deleted by
+ * cancel_event (which returns false) and will still be completed, so
+ * callbacks must tolerate firing after a failed cancel, as the watch
+ * CancelableContexts already do.
+ */
+class TimerWheel
+{
+  // This class isn't supposed to be copied
+  TimerWheel(const TimerWheel &rhs);
+  TimerWheel& operator=(const TimerWheel &rhs);
+
+  CephContext *cct;
+  Mutex& lock;
+  Cond cond;
+
+  friend class TimerWheelThread;
+  TimerWheelThread *thread;
+
+  void timer_thread();
+
+  typedef std::list<std::pair<utime_t, Context*> > slot_t;
+  // slot = (deadline / tick) % slots; entries whose turn has not yet
+  // come stay in the slot for a later rotation
+  std::vector<slot_t> wheel;
+  ceph::unordered_map<Context*, std::pair<unsigned, slot_t::iterator> > events;
+  const uint32_t tick;    ///< seconds per slot
+  utime_t next_expire;    ///< start of the next slot to sweep
+  bool stopping;
+
+  unsigned slot_of(utime_t t) const {
+    return (t.sec() / tick) % wheel.size();
+  }
+
+public:
+  TimerWheel(CephContext *cct, Mutex &l, uint32_t tick=1, uint32_t slots=128);
+  ~TimerWheel();
+
+  /* Call with the event_lock UNLOCKED. */
+  void init();
+  void shutdown();
+
+  /* Schedule an event in the future
+   * Call with the event_lock LOCKED */
+  void add_event_after(double seconds, Context *callback);
+  void add_event_at(utime_t when, Context *callback);
+
+  /* Cancel an event.
+   * Call with the event_lock LOCKED
+   *
+   * Returns true if the callback was cancelled (and deleted).
+   * Returns false if it was not found; it may be about to fire.
+   */
+  bool cancel_event(Context *callback);
+
+  /* Cancel all events.
+   * Call with the event_lock LOCKED */
+  void cancel_all_events();
+};
+
 #endif
@@ -65,10 +65,26 @@ void OpHistory::cleanup(utime_t now)
   }
 }
 
-void OpHistory::dump_ops(utime_t now, Formatter *f)
+void OpHistory::get_arrived(utime_t now, set<pair<utime_t, TrackedOpRef> > *out)
 {
   Mutex::Locker history_lock(ops_history_lock);
   cleanup(now);
+  out->insert(arrived.begin(), arrived.end());
+}
+
+bool OpTracker::dump_historic_ops(Formatter *f)
+{
+  if (!tracking_enabled)
+    return false;
+
+  utime_t now = ceph_clock_now(cct);
+  // merge the per-shard rings, sorted by arrival
+  set<pair<utime_t, TrackedOpRef> > arrived;
+  for (uint32_t i = 0; i < num_optracker_shards; i++) {
+    ShardedTrackingData* sdata = sharded_in_flight_list[i];
+    assert(NULL != sdata);
+    sdata->history_sharded.get_arrived(now, &arrived);
+  }
   f->open_object_section("OpHistory");
   f->dump_int("num to keep", history_size);
   f->dump_int("duration to keep", history_duration);
@@ -85,22 +101,11 @@ void OpHistory::dump_ops(utime_t now, Formatter *f)
     f->close_section();
   }
   f->close_section();
-}
-
-bool OpTracker::dump_historic_ops(Formatter *f)
-{
-  RWLock::RLocker l(lock);
-  if (!tracking_enabled)
-    return false;
-
-  utime_t now = ceph_clock_now(cct);
-  history.dump_ops(now, f);
   return true;
 }
 
 bool OpTracker::dump_ops_in_flight(Formatter *f, bool print_only_blocked)
 {
-  RWLock::RLocker l(lock);
   if (!tracking_enabled)
     return false;
 
@@ -133,7 +138,6 @@ bool OpTracker::dump_ops_in_flight(Formatter *f, bool print_only_blocked)
 
 bool OpTracker::register_inflight_op(xlist<TrackedOp*>::item *i)
 {
-  RWLock::RLocker l(lock);
   if (!tracking_enabled)
     return false;
 
@@ -164,18 +168,16 @@ void OpTracker::unregister_inflight_op(TrackedOp *i)
   }
   i->_unregistered();
 
-  RWLock::RLocker l(lock);
   if (!tracking_enabled)
     delete i;
   else {
-    utime_t now = ceph_clock_now(cct);
-    history.insert(now, TrackedOpRef(i));
+    utime_t now = ceph_clock_now_coarse(cct);
+    sdata->history_sharded.insert(now, TrackedOpRef(i));
   }
 }
 
 bool OpTracker::check_ops_in_flight(std::vector<string> &warning_vector, int *slow)
 {
-  RWLock::RLocker l(lock);
   if (!tracking_enabled)
     return false;
 
@@ -293,6 +295,11 @@ void OpTracker::mark_event(TrackedOp *op, const string &dest, utime_t time)
 void OpTracker::_mark_event(TrackedOp *op, const string &evt,
 			    utime_t time)
 {
+  if (trace_sample_rate) {
+    uint64_t id = op->get_trace_id();
+    if (id && id % trace_sample_rate == 0)
+      _trace_event(op, id, evt, time);
+  }
   dout(5);
   *_dout  <<  "seq: " << op->seq
 	  << ", time: " << time << ", event: " << evt
@@ -302,6 +309,64 @@ void OpTracker::_mark_event(TrackedOp *op, const string &evt,
      
 }
 
+void OpTracker::_trace_event(TrackedOp *op, uint64_t id, const string &evt,
+			     utime_t time)
+{
+  Mutex::Locker l(trace_lock);
+  if (!trace_history_size)
+    return;
+  map<uint64_t, OpTrace>::iterator p = traces.find(id);
+  if (p == traces.end()) {
+    p = traces.insert(make_pair(id, OpTrace())).first;
+    op->get_trace_id(&p->second.id_desc);
+    trace_order.push_back(id);
+    // trim the oldest; the entry we just appended is at the back, so
+    // it always survives
+    while (trace_order.size() > trace_history_size) {
+      traces.erase(trace_order.front());
+      trace_order.pop_front();
+    }
+  }
+  p->second.events.push_back(make_pair(time, evt));
+}
+
+bool OpTracker::dump_op_traces(Formatter *f)
+{
+  Mutex::Locker l(trace_lock);
+  if (!trace_sample_rate)
+    return false;
+
+  f->open_object_section("op_traces");
+  f->dump_unsigned("sample_rate", trace_sample_rate);
+  f->dump_unsigned("num_traces", traces.size());
+  f->open_array_section("traces");
+  for (deque<uint64_t>::const_iterator o = trace_order.begin();
+       o != trace_order.end();
+       ++o) {
+    map<uint64_t, OpTrace>::const_iterator p = traces.find(*o);
+    if (p == traces.end())
+      continue;
+    f->open_object_section("trace");
+    f->dump_unsigned("trace_id", p->first);
+    f->dump_string("reqid", p->second.id_desc);
+    f->open_array_section("events");
+    for (list<pair<utime_t, string> >::const_iterator e =
+	   p->second.events.begin();
+	 e != p->second.events.end();
+	 ++e) {
+      f->open_object_section("event");
+      f->dump_stream("time") << e->first;
+      f->dump_string("event", e->second);
+      f->close_section();
+    }
+    f->close_section();
+    f->close_section();
+  }
+  f->close_section();
+  f->close_section();
+  return true;
+}
+
 void OpTracker::RemoveOnDelete::operator()(TrackedOp *op) {
   if (!op->is_tracked) {
     op->_unregistered();
@@ -318,7 +383,7 @@ void TrackedOp::mark_event(const string &event)
   if (!is_tracked)
     return;
 
-  utime_t now = ceph_clock_now(g_ceph_context);
+  utime_t now = ceph_clock_now_coarse(g_ceph_context);
   {
     Mutex::Locker l(lock);
     events.push_back(make_pair(now, event));
@@ -21,7 +21,6 @@
 #include "include/xlist.h"
 #include "msg/Message.h"
 #include "include/memory.h"
-#include "common/RWLock.h"
 #include <atomic>
 
 class TrackedOp;
@@ -45,7 +44,7 @@ public:
     assert(duration.empty());
   }
   void insert(utime_t now, TrackedOpRef op);
-  void dump_ops(utime_t now, Formatter *f);
+  void get_arrived(utime_t now, set<pair<utime_t, TrackedOpRef> > *out);
   void on_shutdown();
   void set_size_and_duration(uint32_t new_size, uint32_t new_duration) {
     history_size = new_size;
@@ -66,25 +65,46 @@ class OpTracker {
   struct ShardedTrackingData {
     Mutex ops_in_flight_lock_sharded;
     xlist<TrackedOp *> ops_in_flight_sharded;
+    OpHistory history_sharded;
     explicit ShardedTrackingData(string lock_name):
         ops_in_flight_lock_sharded(lock_name.c_str()) {}
   };
   vector<ShardedTrackingData*> sharded_in_flight_list;
   uint32_t num_optracker_shards;
-  OpHistory history;
+  uint32_t history_size;
+  uint32_t history_duration;
   float complaint_time;
   int log_threshold;
+
+  /// sampled per-op event timelines, keyed by the op's cross-daemon
+  /// trace id (see TrackedOp::get_trace_id), so the dumps from a
+  /// client, a primary and its replicas line up on the same key
+  Mutex trace_lock;
+  uint32_t trace_sample_rate;   ///< trace 1 in N identified ops; 0 = off
+  uint32_t trace_history_size;  ///< completed timelines to keep
+  struct OpTrace {
+    string id_desc;             ///< human-readable identity (the reqid)
+    list<pair<utime_t, string> > events;
+  };
+  map<uint64_t, OpTrace> traces;
+  deque<uint64_t> trace_order;  ///< insertion order, for trimming
+
   void _mark_event(TrackedOp *op, const string &evt, utime_t now);
-  bool tracking_enabled;
-  RWLock       lock;
+  void _trace_event(TrackedOp *op, uint64_t id, const string &evt,
+		    utime_t now);
+  // Transitions without locks being held; the only cross-shard state
+  atomic<bool> tracking_enabled;
 
 public:
   CephContext *cct;
-  OpTracker(CephContext *cct_, bool tracking, uint32_t num_shards) : seq(0), 
+  OpTracker(CephContext *cct_, bool tracking, uint32_t num_shards) : seq(0),
                                      num_optracker_shards(num_shards),
+				     history_size(0), history_duration(0),
 				     complaint_time(0), log_threshold(0),
-				     tracking_enabled(tracking),
-				     lock("OpTracker::lock"), cct(cct_) {
+				     trace_lock("OpTracker::trace_lock"),
+				     trace_sample_rate(0),
+				     trace_history_size(0),
+				     tracking_enabled(tracking), cct(cct_) {
 
     for (uint32_t i = 0; i < num_optracker_shards; i++) {
       char lock_name[32] = {0};
@@ -99,14 +119,28 @@ public:
     log_threshold = threshold;
   }
   void set_history_size_and_duration(uint32_t new_size, uint32_t new_duration) {
-    history.set_size_and_duration(new_size, new_duration);
+    history_size = new_size;
+    history_duration = new_duration;
+    // each shard keeps its slice of the ring; dump merges them
+    uint32_t per_shard = num_optracker_shards ?
+      new_size / num_optracker_shards : new_size;
+    if (new_size && !per_shard)
+      per_shard = 1;
+    for (uint32_t i = 0; i < num_optracker_shards; i++)
+      sharded_in_flight_list[i]->history_sharded.set_size_and_duration(
+	per_shard, new_duration);
   }
   void set_tracking(bool enable) {
-    RWLock::WLocker l(lock);
     tracking_enabled = enable;
   }
+  void set_trace_sample_rate_and_size(uint32_t rate, uint32_t size) {
+    Mutex::Locker l(trace_lock);
+    trace_sample_rate = rate;
+    trace_history_size = size;
+  }
   bool dump_ops_in_flight(Formatter *f, bool print_only_blocked=false);
   bool dump_historic_ops(Formatter *f);
+  bool dump_op_traces(Formatter *f);
   bool register_inflight_op(xlist<TrackedOp*>::item *i);
   void unregister_inflight_op(TrackedOp *i);
 
@@ -122,10 +156,11 @@ public:
    */
   bool check_ops_in_flight(std::vector<string> &warning_strings, int *slow = NULL);
   void mark_event(TrackedOp *op, const string &evt,
-                          utime_t time = ceph_clock_now(g_ceph_context));
+                          utime_t time = ceph_clock_now_coarse(g_ceph_context));
 
   void on_shutdown() {
-    history.on_shutdown();
+    for (uint32_t i = 0; i < num_optracker_shards; i++)
+      sharded_in_flight_list[i]->history_sharded.on_shutdown();
   }
   ~OpTracker() {
     while (!sharded_in_flight_list.empty()) {
@@ -178,6 +213,12 @@ protected:
   virtual void _event_marked() {}
   /// return a unique descriptor of the Op; eg the message it's attached to
   virtual void _dump_op_descriptor_unlocked(ostream& stream) const = 0;
+  /// stable id correlating this op across daemons for sampled tracing,
+  /// or 0 if the op has no cross-daemon identity; if desc is non-NULL
+  /// it is filled with a human-readable form of that identity
+  virtual uint64_t get_trace_id(std::string *desc = NULL) const {
+    return 0;
+  }
   /// called when the last non-OpTracker reference is dropped
   virtual void _unregistered() {};
 
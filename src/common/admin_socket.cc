@@ -17,6 +17,7 @@
 #include "common/Thread.h"
 #include "common/admin_socket.h"
 #include "common/admin_socket_client.h"
+#include "common/Clock.h"
 #include "common/config.h"
 #include "common/cmdparse.h"
 #include "common/dout.h"
@@ -109,7 +110,7 @@ AdminSocket::AdminSocket(CephContext *cct)
     m_sock_fd(-1),
     m_shutdown_rd_fd(-1),
     m_shutdown_wr_fd(-1),
-    in_hook(false),
+    m_hooks_in_flight(0),
     m_lock("AdminSocket::m_lock"),
     m_version_hook(NULL),
     m_help_hook(NULL),
@@ -299,6 +300,65 @@ void AdminSocket::chown(uid_t uid, gid_t gid)
   }
 }
 
+/**
+ * Runs one accepted command to completion and writes the response.
+ * Each instance owns its connection fd and closes it when done.
+ */
+class AdminSocket::CommandThread : public Thread {
+  AdminSocket *m_as;
+  int m_fd;
+  string m_command;
+  cmdmap_t m_cmdmap;
+  string m_format;
+public:
+  bool done;   ///< set (under m_as->m_lock) when entry() finishes
+
+  CommandThread(AdminSocket *as, int fd, const string &command,
+		const cmdmap_t &cmdmap, const string &format)
+    : m_as(as), m_fd(fd), m_command(command), m_cmdmap(cmdmap),
+      m_format(format), done(false) {}
+
+  void *entry() {
+    m_as->execute_command(m_fd, m_command, m_cmdmap, m_format);
+    VOID_TEMP_FAILURE_RETRY(close(m_fd));
+    Mutex::Locker l(m_as->m_lock);
+    done = true;
+    return NULL;
+  }
+};
+
+/**
+ * Join and delete finished command threads; with join_all, block on
+ * the stragglers too (shutdown path, after the listener has stopped
+ * spawning new ones).
+ */
+void AdminSocket::reap_command_threads(bool join_all)
+{
+  std::list<CommandThread*> reap;
+  {
+    Mutex::Locker l(m_lock);
+    for (std::list<CommandThread*>::iterator p = m_command_threads.begin();
+	 p != m_command_threads.end(); ) {
+      if (join_all || (*p)->done) {
+	reap.push_back(*p);
+	p = m_command_threads.erase(p);
+      } else {
+	++p;
+      }
+    }
+  }
+  for (std::list<CommandThread*>::iterator p = reap.begin();
+       p != reap.end();
+       ++p) {
+    (*p)->join();
+    delete *p;
+  }
+}
+
+// enough for a host's worth of pollers; beyond this we fall back to
+// running the command on the listener thread like we always did
+#define ADMIN_SOCKET_MAX_COMMAND_THREADS 8
+
 bool AdminSocket::do_accept()
 {
   struct sockaddr_un address;
@@ -356,8 +416,6 @@ bool AdminSocket::do_accept()
     pos++;
   }
 
-  bool rval = false;
-
   map<string, cmd_vartype> cmdmap;
   string format;
   vector<string> cmdvec;
@@ -374,6 +432,30 @@ bool AdminSocket::do_accept()
     format = "json-pretty";
   cmd_getval(m_cct, cmdmap, "prefix", c);
 
+  // hand the command off to its own thread so a slow dump doesn't
+  // stall the listener (and everyone polling behind it)
+  reap_command_threads(false);
+  m_lock.Lock();
+  if (m_command_threads.size() < ADMIN_SOCKET_MAX_COMMAND_THREADS) {
+    CommandThread *t = new CommandThread(this, connection_fd, c, cmdmap,
+					 format);
+    m_command_threads.push_back(t);
+    m_lock.Unlock();
+    t->create("admin_cmd");
+    return true;
+  }
+  m_lock.Unlock();
+
+  bool rval = execute_command(connection_fd, c, cmdmap, format);
+  VOID_TEMP_FAILURE_RETRY(close(connection_fd));
+  return rval;
+}
+
+bool AdminSocket::execute_command(int connection_fd, const string &c,
+				  cmdmap_t &cmdmap, const string &format)
+{
+  bool rval = false;
+
   m_lock.Lock();
   map<string,AdminSocketHook*>::iterator p;
   string match = c;
@@ -381,7 +463,7 @@ bool AdminSocket::do_accept()
     p = m_hooks.find(match);
     if (p != m_hooks.end())
       break;
-    
+
     // drop right-most word
     size_t pos = match.rfind(' ');
     if (pos == std::string::npos) {
@@ -395,33 +477,61 @@ bool AdminSocket::do_accept()
   bufferlist out;
   if (p == m_hooks.end()) {
     lderr(m_cct) << "AdminSocket: request '" << c << "' not defined" << dendl;
+    m_lock.Unlock();
   } else {
     string args;
     if (match != c) {
       args = c.substr(match.length() + 1);
     }
-
-    // Drop lock to avoid cycles in cases where the hook takes
-    // the same lock that was held during calls to register/unregister,
-    // and set in_hook to allow unregister to wait for us before
-    // removing this hook.
-    in_hook = true;
     auto match_hook = p->second;
+
+    // pure dumps may be served from a short-lived cache, so a host's
+    // worth of monitoring agents only runs the expensive dump once
+    // per TTL instead of once per poll
+    double cache_ttl = m_cct->_conf->admin_socket_cache_ttl;
+    bool cache = cache_ttl > 0 && match_hook->cacheable(match);
+    string cache_key = c + "|" + format;
+    bool success = true;
+    bool cached = false;
+    if (cache) {
+      map<string, CachedOutput>::iterator q = m_cached_output.find(cache_key);
+      if (q != m_cached_output.end() &&
+	  ceph_clock_now(m_cct) - q->second.stamp < cache_ttl) {
+	out = q->second.out;
+	cached = true;
+      }
+    }
+    if (!cached) {
+      // Drop lock to avoid cycles in cases where the hook takes
+      // the same lock that was held during calls to register/unregister,
+      // and count hooks in flight to allow unregister to wait for us
+      // before removing this hook.
+      m_hooks_in_flight++;
+      m_lock.Unlock();
+      success = match_hook->call(match, cmdmap, format, out);
+      m_lock.Lock();
+      m_hooks_in_flight--;
+      in_hook_cond.SignalAll();
+      if (success && cache) {
+	CachedOutput& co = m_cached_output[cache_key];
+	co.stamp = ceph_clock_now(m_cct);
+	co.out = out;
+      }
+    }
     m_lock.Unlock();
-    bool success = match_hook->call(match, cmdmap, format, out);
-    m_lock.Lock();
-    in_hook = false;
-    in_hook_cond.Signal();
 
     if (!success) {
       ldout(m_cct, 0) << "AdminSocket: request '" << match << "' args '" << args
-		      << "' to " << p->second << " failed" << dendl;
+		      << "' to " << match_hook << " failed" << dendl;
       out.append("failed");
     } else {
       ldout(m_cct, 5) << "AdminSocket: request '" << match << "' '" << args
-		       << "' to " << p->second
+		       << "' to " << match_hook
 		       << " returned " << out.length() << " bytes" << dendl;
     }
+    // write the response without any lock held; write_fd streams the
+    // bufferlist out in chunks, so a slow reader only blocks its own
+    // command thread
     uint32_t len = htonl(out.length());
     int ret = safe_write(connection_fd, &len, sizeof(len));
     if (ret < 0) {
@@ -432,9 +542,7 @@ bool AdminSocket::do_accept()
 	rval = true;
     }
   }
-  m_lock.Unlock();
 
-  VOID_TEMP_FAILURE_RETRY(close(connection_fd));
   return rval;
 }
 
@@ -466,10 +574,10 @@ int AdminSocket::unregister_command(std::string command)
     m_descs.erase(command);
     m_help.erase(command);
 
-    // If we are currently processing a command, wait for it to
-    // complete in case it referenced the hook that we are
+    // If we are currently processing commands, wait for them to
+    // complete in case one referenced the hook that we are
     // unregistering.
-    if (in_hook) {
+    while (m_hooks_in_flight > 0) {
       in_hook_cond.Wait(m_lock);
     }
 
@@ -612,6 +720,9 @@ void AdminSocket::shutdown()
     lderr(m_cct) << "AdminSocket::shutdown: error: " << err << dendl;
   }
 
+  // the listener is gone, so no new command threads; wait out the rest
+  reap_command_threads(true);
+
   VOID_TEMP_FAILURE_RETRY(close(m_sock_fd));
 
   unregister_command("version");
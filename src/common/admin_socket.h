@@ -18,9 +18,11 @@
 #include "common/Thread.h"
 #include "common/Mutex.h"
 
+#include <list>
 #include <string>
 #include <map>
-#include "include/buffer_fwd.h"
+#include "include/buffer.h"
+#include "include/utime.h"
 #include "common/cmdparse.h"
 #include "common/Cond.h"
 
@@ -33,6 +35,15 @@ class AdminSocketHook {
 public:
   virtual bool call(std::string command, cmdmap_t &cmdmap, std::string format,
 		    bufferlist& out) = 0;
+  /**
+   * true if the output for this command is a pure dump that may be
+   * served from a short-lived cache (admin_socket_cache_ttl), so
+   * frequent pollers don't re-run an expensive dump every time.
+   * Commands with side effects must return false (the default).
+   */
+  virtual bool cacheable(const std::string &command) const {
+    return false;
+  }
   virtual ~AdminSocketHook() {}
 };
 
@@ -91,6 +102,9 @@ private:
 
   void *entry();
   bool do_accept();
+  bool execute_command(int connection_fd, const std::string &c,
+		       cmdmap_t &cmdmap, const std::string &format);
+  void reap_command_threads(bool join_all);
 
   CephContext *m_cct;
   std::string m_path;
@@ -98,15 +112,28 @@ private:
   int m_shutdown_rd_fd;
   int m_shutdown_wr_fd;
 
-  bool in_hook;
+  int m_hooks_in_flight;
   Cond in_hook_cond;
-  Mutex m_lock;    // protects m_hooks, m_descs, m_help
+  Mutex m_lock;    // protects m_hooks, m_descs, m_help, the cache and
+		   // the command thread list
   AdminSocketHook *m_version_hook, *m_help_hook, *m_getdescs_hook;
 
   std::map<std::string,AdminSocketHook*> m_hooks;
   std::map<std::string,std::string> m_descs;
   std::map<std::string,std::string> m_help;
 
+  /// each accepted command runs on its own short-lived thread, so a
+  /// slow dump doesn't stall the listener or the next poller
+  class CommandThread;
+  std::list<CommandThread*> m_command_threads;
+
+  /// recent output of cacheable commands, keyed by command + format
+  struct CachedOutput {
+    utime_t stamp;
+    bufferlist out;
+  };
+  std::map<std::string, CachedOutput> m_cached_output;
+
   friend class AdminSocketTest;
   friend class HelpHook;
   friend class GetdescsHook;
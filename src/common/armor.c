@@ -59,6 +59,30 @@ int ceph_armor_line_break(char *dst, const char *dst_end, const char *src, const
 	while (src < end) {
 		unsigned char a;
 
+		/* bulk path: emit whole four-character groups with plain
+		 * table lookups while there is a full input group and
+		 * room in dst, without the per-byte bounds checks */
+		while (end - src >= 3 && dst_end - dst >= 4 &&
+		       (!line_width || line + 4 <= line_width)) {
+			unsigned char b = src[1], c = src[2];
+			a = src[0];
+			dst[0] = pem_key[a >> 2];
+			dst[1] = pem_key[((a & 3) << 4) | (b >> 4)];
+			dst[2] = pem_key[((b & 15) << 2) | (c >> 6)];
+			dst[3] = pem_key[c & 63];
+			src += 3;
+			dst += 4;
+			olen += 4;
+			line += 4;
+			if (line_width && line == line_width) {
+				line = 0;
+				SET_DST('\n');
+				olen++;
+			}
+		}
+		if (src >= end)
+			break;
+
 		a = *src++;
 		SET_DST(encode_bits(a >> 2));
 		if (src < end) {
@@ -135,3 +135,34 @@ void compressible_bloom_filter::generate_test_instances(list<compressible_bloom_
   ls.back()->compress(20);
   ls.back()->insert("boogggg");
 }
+
+
+void blocked_bloom_filter::encode(bufferlist& bl) const
+{
+  ENCODE_START(1, 1, bl);
+  bloom_filter::encode(bl);
+  ENCODE_FINISH(bl);
+}
+
+void blocked_bloom_filter::decode(bufferlist::iterator& p)
+{
+  DECODE_START(1, p);
+  bloom_filter::decode(p);
+  DECODE_FINISH(p);
+}
+
+void blocked_bloom_filter::dump(Formatter *f) const
+{
+  bloom_filter::dump(f);
+}
+
+void blocked_bloom_filter::generate_test_instances(list<blocked_bloom_filter*>& ls)
+{
+  ls.push_back(new blocked_bloom_filter(10, .5, 1));
+  ls.push_back(new blocked_bloom_filter(10, .5, 1));
+  ls.back()->insert((uint32_t)1);
+  ls.back()->insert((uint32_t)2);
+  ls.push_back(new blocked_bloom_filter(50, .5, 1));
+  for (uint32_t i = 0; i < 5; ++i)
+    ls.back()->insert(i);
+}
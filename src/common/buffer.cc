@@ -100,6 +100,17 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
     return buffer_cached_crc_adjusted.read();
   }
 
+  static atomic64_t buffer_aligned_pool_hits;
+  static atomic64_t buffer_aligned_pool_misses;
+  const bool buffer_no_aligned_pool = get_env_bool("CEPH_BUFFER_NO_ALIGNED_POOL");
+
+  uint64_t buffer::get_aligned_pool_hits() {
+    return buffer_aligned_pool_hits.read();
+  }
+  uint64_t buffer::get_aligned_pool_misses() {
+    return buffer_aligned_pool_misses.read();
+  }
+
   static atomic_t buffer_c_str_accesses;
   static bool buffer_track_c_str = get_env_bool("CEPH_BUFFER_TRACK");
 
@@ -337,28 +348,124 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
     }
   };
 
+  /*
+   * per-thread pool of recycled page-aligned allocations.  the OSD data
+   * path allocates and frees page-aligned buffers constantly; recycling
+   * them in small per-thread free lists keeps steady-state IO off
+   * posix_memalign entirely.  buffers are binned into power-of-two size
+   * classes from one page up to (page << 5); anything else goes straight
+   * to the heap.  retention is bounded per thread by both a per-class
+   * slot count and a total byte cap, and a thread's cache is freed when
+   * the thread exits.  buffers may be returned by a different thread
+   * than allocated them; they simply migrate between pools.
+   */
+  static const unsigned buffer_pool_classes = 6;
+  static const unsigned buffer_pool_per_class = 16;
+  static const unsigned buffer_pool_max_bytes = 2u << 20;  // per thread
+
+  struct buffer_aligned_pool {
+    void *free_list[buffer_pool_classes][buffer_pool_per_class];
+    unsigned count[buffer_pool_classes];
+    unsigned bytes;
+  };
+
+  static pthread_key_t buffer_pool_key;
+  static pthread_once_t buffer_pool_once = PTHREAD_ONCE_INIT;
+  static __thread buffer_aligned_pool *buffer_pool = NULL;
+
+  static void buffer_pool_destroy(void *p) {
+    buffer_aligned_pool *pool = static_cast<buffer_aligned_pool*>(p);
+    for (unsigned c = 0; c < buffer_pool_classes; ++c)
+      while (pool->count[c])
+	::free(pool->free_list[c][--pool->count[c]]);
+    ::free(pool);
+    // allocations from later tsd destructors will recreate the pool
+    buffer_pool = NULL;
+  }
+
+  static void buffer_pool_key_init() {
+    pthread_key_create(&buffer_pool_key, buffer_pool_destroy);
+  }
+
+  static buffer_aligned_pool *buffer_pool_tls() {
+    if (!buffer_pool) {
+      pthread_once(&buffer_pool_once, buffer_pool_key_init);
+      buffer_pool =
+	static_cast<buffer_aligned_pool*>(::calloc(1, sizeof(buffer_aligned_pool)));
+      if (buffer_pool)
+	pthread_setspecific(buffer_pool_key, buffer_pool);
+    }
+    return buffer_pool;
+  }
+
+  static unsigned buffer_pool_class_size(int c) {
+    return CEPH_PAGE_SIZE << c;
+  }
+
+  /// size class for (len, align), or -1 if the pool does not cover it
+  static int buffer_pool_class(unsigned len, unsigned align) {
+    if (buffer_no_aligned_pool ||
+	align != CEPH_PAGE_SIZE ||
+	len == 0)
+      return -1;
+    for (unsigned c = 0; c < buffer_pool_classes; ++c)
+      if (len <= buffer_pool_class_size(c))
+	return c;
+    return -1;
+  }
+
+  static char *buffer_pool_get(int cls) {
+    buffer_aligned_pool *pool = buffer_pool_tls();
+    if (!pool || !pool->count[cls]) {
+      buffer_aligned_pool_misses.inc();
+      return 0;
+    }
+    buffer_aligned_pool_hits.inc();
+    pool->bytes -= buffer_pool_class_size(cls);
+    return static_cast<char*>(pool->free_list[cls][--pool->count[cls]]);
+  }
+
+  static bool buffer_pool_put(int cls, char *data) {
+    buffer_aligned_pool *pool = buffer_pool_tls();
+    if (!pool ||
+	pool->count[cls] >= buffer_pool_per_class ||
+	pool->bytes + buffer_pool_class_size(cls) > buffer_pool_max_bytes)
+      return false;
+    pool->free_list[cls][pool->count[cls]++] = data;
+    pool->bytes += buffer_pool_class_size(cls);
+    return true;
+  }
+
   class buffer::raw_posix_aligned : public buffer::raw {
     unsigned align;
+    int pool_class;  ///< pool size class, or -1 if heap allocated
   public:
     raw_posix_aligned(unsigned l, unsigned _align) : raw(l) {
       align = _align;
       assert((align >= sizeof(void *)) && (align & (align - 1)) == 0);
+      pool_class = buffer_pool_class(len, align);
+      if (pool_class < 0 || !(data = buffer_pool_get(pool_class))) {
+	// allocate the full class size so the buffer can be recycled
+	unsigned alloc_len =
+	  pool_class >= 0 ? buffer_pool_class_size(pool_class) : len;
 #ifdef DARWIN
-      data = (char *) valloc (len);
+	data = (char *) valloc (alloc_len);
 #else
-      data = 0;
-      int r = ::posix_memalign((void**)(void*)&data, align, len);
-      if (r)
-	throw bad_alloc();
+	data = 0;
+	int r = ::posix_memalign((void**)(void*)&data, align, alloc_len);
+	if (r)
+	  throw bad_alloc();
 #endif /* DARWIN */
-      if (!data)
-	throw bad_alloc();
+	if (!data)
+	  throw bad_alloc();
+      }
       inc_total_alloc(len);
       inc_history_alloc(len);
       bdout << "raw_posix_aligned " << this << " alloc " << (void *)data << " l=" << l << ", align=" << align << " total_alloc=" << buffer::get_total_alloc() << bendl;
     }
     ~raw_posix_aligned() {
-      ::free((void*)data);
+      if (pool_class < 0 || !buffer_pool_put(pool_class, data))
+	::free((void*)data);
       dec_total_alloc(len);
       bdout << "raw_posix_aligned " << this << " free " << (void *)data << " " << buffer::get_total_alloc() << bendl;
     }
@@ -1713,13 +1820,40 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
     last_p.copy_in(len, src);
   }
 
+  // double the previous append_buffer, up to a cap, so encode-heavy
+  // paths that feed a long stream of small appends into one list do
+  // O(log n) allocations instead of one per allocation unit
+  unsigned buffer::list::append_buffer_next_alloc() const
+  {
+    unsigned prev = append_buffer.have_raw() ? append_buffer.raw_length() : 0;
+    if (prev < CEPH_BUFFER_APPEND_SIZE)
+      return CEPH_BUFFER_APPEND_SIZE;
+    unsigned total = ROUND_UP_TO(2 * (prev + sizeof(raw_combined)),
+				 CEPH_BUFFER_ALLOC_UNIT);
+    if (total > 16 * CEPH_BUFFER_ALLOC_UNIT)
+      total = 16 * CEPH_BUFFER_ALLOC_UNIT;
+    return total - sizeof(raw_combined);
+  }
+
+  // make sure the next (at least) prealloc appended bytes land in a
+  // single buffer.  with a size estimate in hand an encoder can turn a
+  // long stream of small appends into one allocation up front.
+  void buffer::list::reserve(size_t prealloc)
+  {
+    if (append_buffer.unused_tail_length() < prealloc) {
+      size_t alen = MAX(prealloc, (size_t)append_buffer_next_alloc());
+      append_buffer = raw_combined::create(alen);
+      append_buffer.set_length(0);   // unused, so far.
+    }
+  }
+
   void buffer::list::append(char c)
   {
     // put what we can into the existing append_buffer.
     unsigned gap = append_buffer.unused_tail_length();
     if (!gap) {
       // make a new append_buffer!
-      append_buffer = raw_combined::create(CEPH_BUFFER_APPEND_SIZE);
+      append_buffer = raw_combined::create(append_buffer_next_alloc());
       append_buffer.set_length(0);   // unused, so far.
     }
     append(append_buffer, append_buffer.append(c) - 1, 1);	// add segment to the list
@@ -1741,11 +1875,13 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
       if (len == 0)
         break;  // done!
       
-      // make a new append_buffer.  fill out a complete page, factoring in the
-      // raw_combined overhead.
+      // make a new append_buffer.  fill out complete pages, factoring in
+      // the raw_combined overhead, and never shrink below the doubling
+      // growth track.
       size_t need = ROUND_UP_TO(len, sizeof(size_t)) + sizeof(raw_combined);
       size_t alen = ROUND_UP_TO(need, CEPH_BUFFER_ALLOC_UNIT) -
 	sizeof(raw_combined);
+      alen = MAX(alen, (size_t)append_buffer_next_alloc());
       append_buffer = raw_combined::create(alen);
       append_buffer.set_length(0);   // unused, so far.
     }
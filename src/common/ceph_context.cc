@@ -312,6 +312,16 @@ public:
     m_cct->do_command(command, cmdmap, format, &out);
     return true;
   }
+
+  bool cacheable(const std::string& command) const {
+    // the counter dumps are what monitoring agents poll, and they are
+    // pure reads; everything else here (perf reset, config set, log
+    // reopen, ...) has side effects
+    return command == "perfcounters_dump" || command == "1" ||
+      command == "perf dump" ||
+      command == "perfcounters_schema" || command == "2" ||
+      command == "perf schema";
+  }
 };
 
 void CephContext::do_command(std::string command, cmdmap_t& cmdmap,
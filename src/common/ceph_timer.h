@@ -19,7 +19,10 @@
 #include <functional>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include <boost/intrusive/list.hpp>
 #include <boost/intrusive/set.hpp>
 
 #include "ceph_time.h"
@@ -301,9 +304,231 @@ namespace ceph {
 	}
       }
     }; // timer
+
+    using boost::intrusive::list;
+    using boost::intrusive::list_member_hook;
+    using boost::intrusive::auto_unlink;
+
+    // A hashed timer wheel with the same interface as the timer above
+    // (id on add, cancel by id), for events that are armed and
+    // cancelled at high frequency but tolerate coarse resolution.
+    //
+    // Arm and cancel are O(1) — a slot push/unlink plus a hash table
+    // update — instead of two ordered-set operations, and arming
+    // never wakes the sweeper thread, which visits one slot per tick
+    // and fires everything due in a batch.  The price is that events
+    // fire up to one tick late, so this is only suitable for coarse
+    // deadlines like op timeouts, not for precise scheduling.
+    //
+    // Like the timer above, cancel_event can lose the race with an
+    // event already handed to the sweeper; it then returns false and
+    // the event still executes.
+
+    template <class TC>
+    class wheel_timer {
+      // auto_unlink so cancel can unhook an entry in O(1) without
+      // knowing which slot it landed in
+      typedef list_member_hook<link_mode<auto_unlink> > lh;
+
+      struct event {
+	typename TC::time_point t;
+	uint64_t id;
+	std::function<void()> f;
+
+	lh wheel_link;
+
+	event(typename TC::time_point _t, uint64_t _id,
+	      std::function<void()>&& _f) : t(_t), id(_id), f(_f) {}
+      };
+
+      typedef list<event,
+		   member_hook<event, lh, &event::wheel_link>,
+		   constant_time_size<false> > slot_list;
+
+      // slot = (deadline / tick) % slots; entries whose turn has not
+      // yet come stay in the slot for a later rotation
+      std::vector<slot_list> wheel;
+      std::unordered_map<uint64_t, event*> events;
+      const typename TC::duration tick;
+      typename TC::time_point next_sweep;
+
+      std::mutex lock;
+      using lock_guard = std::lock_guard<std::mutex>;
+      using unique_lock = std::unique_lock<std::mutex>;
+      std::condition_variable cond;
+
+      uint64_t next_id{ 0 };
+
+      bool suspended;
+      std::thread thread;
+
+      size_t slot_of(typename TC::time_point t) const {
+	return (t.time_since_epoch() / tick) % wheel.size();
+      }
+
+      static typename TC::time_point align(typename TC::time_point t,
+					   typename TC::duration tick) {
+	return typename TC::time_point(tick * (t.time_since_epoch() / tick));
+      }
+
+      void timer_thread() {
+	unique_lock l(lock);
+	while (!suspended) {
+	  typename TC::time_point now = TC::now();
+
+	  // gather everything due in one batch; entries that hash to
+	  // these slots but belong to a later rotation stay in place
+	  slot_list due;
+	  while (next_sweep <= now) {
+	    slot_list& slot = wheel[slot_of(next_sweep)];
+	    typename slot_list::iterator p = slot.begin();
+	    while (p != slot.end()) {
+	      if (p->t <= now) {
+		event& e = *p;
+		p = slot.erase(p);
+		events.erase(e.id);
+		due.push_back(e);
+	      } else {
+		++p;
+	      }
+	    }
+	    next_sweep += tick;
+	  }
+
+	  while (!due.empty()) {
+	    event& e = due.front();
+	    due.pop_front();
+	    l.unlock();
+	    e.f();
+	    l.lock();
+	    delete &e;
+	  }
+
+	  if (suspended)
+	    break;
+
+	  if (events.empty())
+	    cond.wait(l);
+	  else
+	    cond.wait_until(l, next_sweep);
+	}
+      }
+
+  public:
+      wheel_timer(typename TC::duration tick = std::chrono::milliseconds(100),
+		  size_t slots = 512)
+	: wheel(slots), tick(tick) {
+	lock_guard l(lock);
+	next_sweep = align(TC::now(), tick) + tick;
+	suspended = false;
+	thread = std::thread(&wheel_timer::timer_thread, this);
+      }
+
+      wheel_timer(const wheel_timer &) = delete;
+      wheel_timer& operator=(const wheel_timer &) = delete;
+
+      ~wheel_timer() {
+	suspend();
+	cancel_all_events();
+      }
+
+      // Suspend operation of the timer (and let its thread die).
+      void suspend() {
+	unique_lock l(lock);
+	if (suspended)
+	  return;
+
+	suspended = true;
+	cond.notify_one();
+	l.unlock();
+	thread.join();
+      }
+
+      // Resume operation of the timer. (Must have been previously
+      // suspended.)
+      void resume() {
+	unique_lock l(lock);
+	if (!suspended)
+	  return;
+
+	suspended = false;
+	assert(!thread.joinable());
+	thread = std::thread(&wheel_timer::timer_thread, this);
+      }
+
+      // Schedule an event in the relative future
+      template<typename Callable, typename... Args>
+      uint64_t add_event(typename TC::duration duration,
+			 Callable&& f, Args&&... args) {
+	typename TC::time_point when = TC::now();
+	when += duration;
+	return add_event(when,
+			 std::forward<Callable>(f),
+			 std::forward<Args>(args)...);
+      }
+
+      // Schedule an event in the absolute future.  Never wakes the
+      // sweeper: it visits every slot within a tick of the deadline
+      // anyway.
+      template<typename Callable, typename... Args>
+      uint64_t add_event(typename TC::time_point when,
+			 Callable&& f, Args&&... args) {
+	lock_guard l(lock);
+	if (events.empty()) {
+	  /* The sweeper is parked and next_sweep may be far in the
+	   * past; with no entries hashed anywhere it is safe to skip
+	   * the idle slots rather than replay them. */
+	  next_sweep = align(TC::now(), tick) + tick;
+	  cond.notify_one();
+	}
+	event& e = *(new event(
+		       when, ++next_id,
+		       std::forward<std::function<void()> >(
+			 std::bind(std::forward<Callable>(f),
+				   std::forward<Args>(args)...))));
+	// a deadline already behind the sweep point goes in the next
+	// slot to be visited, so it fires on the next tick
+	typename TC::time_point effective = when;
+	if (effective < next_sweep)
+	  effective = next_sweep;
+	wheel[slot_of(effective)].push_back(e);
+	events[e.id] = &e;
+	return e.id;
+      }
+
+      // Cancel an event. If the event has already come and gone (or
+      // you never submitted it) you will receive false. Otherwise you
+      // will receive true and it is guaranteed the event will not
+      // execute.
+      bool cancel_event(const uint64_t id) {
+	lock_guard l(lock);
+	auto p = events.find(id);
+	if (p == events.end()) {
+	  return false;
+	}
+
+	event* e = p->second;
+	e->wheel_link.unlink();
+	events.erase(p);
+	delete e;
+
+	return true;
+      }
+
+      // Remove all events from the queue.
+      void cancel_all_events() {
+	lock_guard l(lock);
+	for (auto& p : events) {
+	  p.second->wheel_link.unlink();
+	  delete p.second;
+	}
+	events.clear();
+      }
+    }; // wheel_timer
   }; // timer_detail
 
   using timer_detail::timer;
+  using timer_detail::wheel_timer;
 }; // ceph
 
 #endif
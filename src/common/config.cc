@@ -936,6 +936,7 @@ int md_config_t::set_val_impl(const char *val, const config_option *opt)
   int ret = set_val_raw(val, opt);
   if (ret)
     return ret;
+  generation.inc();
   changed.insert(opt->name);
   return 0;
 }
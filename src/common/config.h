@@ -23,6 +23,7 @@
 #include "common/ConfUtils.h"
 #include "common/entity_name.h"
 #include "common/Mutex.h"
+#include "include/atomic.h"
 #include "log/SubsystemMap.h"
 #include "common/config_obs.h"
 #include "msg/msg_types.h"
@@ -64,6 +65,11 @@ extern const char *CEPH_CONF_FILE_DEFAULT;
  * configuration obserever which receives callbacks when a value changes. These
  * callbacks take place under the md_config_t lock.
  *
+ * Subsystems on hot paths should copy the options they care about into a
+ * local struct from their observer callback and read that instead of the
+ * config object; get_generation() gives a lock-free staleness check for
+ * such a snapshot (it ticks whenever any value is written).
+ *
  * To prevent serious problems resulting from thread-safety issues, we disallow
  * changing std::string configuration values after
  * md_config_t::internal_safe_to_start_threads becomes true. You can still
@@ -246,6 +252,12 @@ public:
 #undef SUBSYS
 #undef DEFAULT_SUBSYS
 
+  /// monotonically increasing count of value writes; lets holders of an
+  /// observer-refreshed snapshot check for staleness without the lock
+  uint64_t get_generation() const {
+    return generation.read();
+  }
+
   unsigned get_osd_pool_default_min_size() const {
     return osd_pool_default_min_size ?
       MIN(osd_pool_default_min_size, osd_pool_default_size) :
@@ -258,6 +270,10 @@ public:
    * hold this lock when calling configuration observers.  */
   mutable Mutex lock;
 
+private:
+  ceph::atomic64_t generation;  ///< see get_generation()
+public:
+
   friend class test_md_config_t;
 };
 
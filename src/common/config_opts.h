@@ -27,6 +27,7 @@ OPTION(lockdep, OPT_BOOL, false)
 OPTION(lockdep_force_backtrace, OPT_BOOL, false) // always gather current backtrace at every lock
 OPTION(run_dir, OPT_STR, "/var/run/ceph")       // the "/var/run/ceph" dir, created on daemon startup
 OPTION(admin_socket, OPT_STR, "$run_dir/$cluster-$name.asok") // default changed by common_preinit()
+OPTION(admin_socket_cache_ttl, OPT_DOUBLE, 2.0) // serve repeated cacheable dumps (e.g. perf dump) from cache for this many seconds; 0 = off
 OPTION(crushtool, OPT_STR, "crushtool") // crushtool utility path
 
 OPTION(daemonize, OPT_BOOL, false) // default changed by common_preinit()
@@ -97,6 +98,8 @@ OPTION(xio_max_conns_per_portal, OPT_INT, 32) // max xio_connections per portal/
 OPTION(xio_transport_type, OPT_STR, "rdma") // xio transport type: {rdma or tcp}
 OPTION(xio_max_send_inline, OPT_INT, 512) // xio maximum threshold to send inline
 
+OPTION(compressor_zstd_level, OPT_INT, 3)     // zstd compression level
+OPTION(compressor_zstd_dict_path, OPT_STR, "") // optional shared dictionary (e.g. from 'zstd --train' on sampled objects)
 OPTION(async_compressor_enabled, OPT_BOOL, false)
 OPTION(async_compressor_type, OPT_STR, "snappy")
 OPTION(async_compressor_threads, OPT_INT, 2)
@@ -175,6 +178,11 @@ OPTION(ms_initial_backoff, OPT_DOUBLE, .2)
 OPTION(ms_max_backoff, OPT_DOUBLE, 15.0)
 OPTION(ms_crc_data, OPT_BOOL, true)
 OPTION(ms_crc_header, OPT_BOOL, true)
+// software crc32c on message payloads crossing the osd cluster network.
+// turn off when the backend fabric already provides strong integrity;
+// ms_crc_data still governs the public network and ms_crc_header always
+// covers the message envelope.
+OPTION(ms_cluster_crc_data, OPT_BOOL, true)
 OPTION(ms_die_on_bad_msg, OPT_BOOL, false)
 OPTION(ms_die_on_unhandled_msg, OPT_BOOL, false)
 OPTION(ms_die_on_old_message, OPT_BOOL, false)     // assert if we get a dup incoming message and shouldn't have (may be triggered by pre-541cd3c64be0dfa04e8a2df39422e0eb9541a428 code)
@@ -196,6 +204,9 @@ OPTION(ms_inject_delay_max, OPT_DOUBLE, 1)         // seconds
 OPTION(ms_inject_delay_probability, OPT_DOUBLE, 0) // range [0, 1]
 OPTION(ms_inject_internal_delays, OPT_DOUBLE, 0)   // seconds
 OPTION(ms_dump_on_send, OPT_BOOL, false)           // hexdump msg to log on send
+OPTION(ms_compress_data, OPT_BOOL, false)          // compress message data segments on the wire (both peers must support it)
+OPTION(ms_compress_data_min_size, OPT_U64, 4096)   // don't bother compressing data segments smaller than this
+OPTION(ms_compress_data_type, OPT_STR, "snappy")   // compressor plugin for outgoing message data
 OPTION(ms_dump_corrupt_message_level, OPT_INT, 1)  // debug level to hexdump undecodeable messages at
 OPTION(ms_async_op_threads, OPT_INT, 3)            // number of worker processing threads for async messenger created on init
 OPTION(ms_async_max_op_threads, OPT_INT, 5)        // max number of worker processing threads for async messenger
@@ -207,6 +218,18 @@ OPTION(ms_async_set_affinity, OPT_BOOL, true)
 // core
 OPTION(ms_async_affinity_cores, OPT_STR, "")
 OPTION(ms_async_send_inline, OPT_BOOL, true)
+// busy-poll worker event loops with zero timeout for this many microseconds
+// after the last activity before falling back to a blocking wait.  Burns a
+// core per worker while active; pair with ms_async_affinity_cores.  0 = off.
+OPTION(ms_async_busy_poll_us, OPT_U64, 0)
+// traffic rate (bytes/sec) on a worker that weighs as much as one extra
+// connection when placing new connections.  0 = place on connection count only.
+OPTION(ms_async_worker_bytes_per_conn, OPT_U64, 1048576)
+// hold a small flush for up to this many microseconds when writes are
+// arriving back to back, so consecutive messages and acks share one
+// sendmsg.  Only kicks in on busy connections; an idle connection still
+// flushes immediately.  0 = off.
+OPTION(ms_async_send_cork_us, OPT_U64, 50)
 
 OPTION(inject_early_sigterm, OPT_BOOL, false)
 
@@ -216,6 +239,7 @@ OPTION(mon_sync_fs_threshold, OPT_INT, 5)   // sync() when writing this many obj
 OPTION(mon_compact_on_start, OPT_BOOL, false)  // compact leveldb on ceph-mon start
 OPTION(mon_compact_on_bootstrap, OPT_BOOL, false)  // trigger leveldb compaction on bootstrap
 OPTION(mon_compact_on_trim, OPT_BOOL, true)       // compact (a prefix) when we trim old states
+OPTION(mon_compact_min_tombstones, OPT_INT, 2048) // defer trim compactions until this many keys were erased from the prefix
 OPTION(mon_osd_cache_size, OPT_INT, 10)  // the size of osdmaps cache, not to rely on underlying store's cache
 
 OPTION(mon_tick_interval, OPT_INT, 5)
@@ -286,6 +310,8 @@ OPTION(mon_slurp_bytes, OPT_INT, 256*1024)    // limit size of slurp messages
 OPTION(mon_client_bytes, OPT_U64, 100ul << 20)  // client msg data allowed in memory (in bytes)
 OPTION(mon_daemon_bytes, OPT_U64, 400ul << 20)  // mds, osd message memory cap (in bytes)
 OPTION(mon_max_log_entries_per_event, OPT_INT, 4096)
+OPTION(mon_max_log_bytes_per_event, OPT_U64, 1048576) // cap log bytes per paxos commit
+OPTION(mon_log_summarize_duplicates, OPT_BOOL, true) // collapse repeated cluster log messages
 OPTION(mon_reweight_min_pgs_per_osd, OPT_U64, 10)   // min pgs per osd for reweight-by-pg command
 OPTION(mon_reweight_min_bytes_per_osd, OPT_U64, 100*1024*1024)   // min bytes per osd for reweight-by-utilization command
 OPTION(mon_reweight_max_osds, OPT_INT, 4)   // max osds to change per reweight-by-* command
@@ -357,6 +383,8 @@ OPTION(cephx_service_require_signatures, OPT_BOOL, false)
 OPTION(cephx_sign_messages, OPT_BOOL, true)  // Default to signing session messages if supported
 OPTION(auth_mon_ticket_ttl, OPT_DOUBLE, 60*60*12)
 OPTION(auth_service_ticket_ttl, OPT_DOUBLE, 60*60)
+OPTION(auth_authorizer_cache_ttl, OPT_DOUBLE, 30)  // seconds to remember verified authorizers (0 = off)
+OPTION(auth_authorizer_cache_size, OPT_INT, 4096)  // max cached verified authorizers
 OPTION(auth_debug, OPT_BOOL, false)          // if true, assert when weird things happen
 OPTION(mon_client_hunt_interval, OPT_DOUBLE, 3.0)   // try new mon every N seconds until we connect
 OPTION(mon_client_ping_interval, OPT_DOUBLE, 10.0)  // ping every N seconds
@@ -376,6 +404,8 @@ OPTION(client_trace, OPT_STR, "")
 OPTION(client_readahead_min, OPT_LONGLONG, 128*1024)  // readahead at _least_ this much.
 OPTION(client_readahead_max_bytes, OPT_LONGLONG, 0)  // default unlimited
 OPTION(client_readahead_max_periods, OPT_LONGLONG, 4)  // as multiple of file layout period (object size * num stripes)
+OPTION(client_readdir_max_entries, OPT_U32, 0)  // max entries to ask the mds for per readdir reply, 0 = no limit
+OPTION(client_readdir_max_bytes, OPT_U32, 0)  // max readdir reply size to ask the mds for, 0 = mds default (512 KB)
 OPTION(client_snapdir, OPT_STR, ".snap")
 OPTION(client_mountpoint, OPT_STR, "/")
 OPTION(client_mount_uid, OPT_INT, -1)
@@ -413,6 +443,8 @@ OPTION(fuse_debug, OPT_BOOL, false)
 OPTION(fuse_multithreaded, OPT_BOOL, true)
 OPTION(fuse_require_active_mds, OPT_BOOL, true) // if ceph_fuse requires active mds server
 OPTION(fuse_syncfs_on_mksnap, OPT_BOOL, true)
+OPTION(fuse_attr_timeout, OPT_DOUBLE, 0.0)   // seconds the kernel may cache attributes; relies on the invalidate cb for coherence when nonzero
+OPTION(fuse_entry_timeout, OPT_DOUBLE, 0.0)  // seconds the kernel may cache dentries
 
 OPTION(client_try_dentry_invalidate, OPT_BOOL, true) // the client should try to use dentry invaldation instead of remounting, on kernels it believes that will work for
 OPTION(client_die_on_failed_remount, OPT_BOOL, true)
@@ -429,6 +461,7 @@ OPTION(objecter_timeout, OPT_DOUBLE, 10.0)    // before we ask for a map
 OPTION(objecter_inflight_op_bytes, OPT_U64, 1024*1024*100) // max in-flight data (both directions)
 OPTION(objecter_inflight_ops, OPT_U64, 1024)               // max in-flight ios
 OPTION(objecter_completion_locks_per_session, OPT_U64, 32) // num of completion locks per each session, for serializing same object responses
+OPTION(objecter_session_op_shards, OPT_INT, 16) // num of tid-hashed shards for each session's op map, so replies contend per shard
 OPTION(objecter_inject_no_watch_ping, OPT_BOOL, false)   // suppress watch pings
 OPTION(objecter_retry_writes_after_first_reply, OPT_BOOL, false)   // ignore the first reply for each write, and resend the osd op instead
 
@@ -439,6 +472,7 @@ OPTION(journaler_allow_split_entries, OPT_BOOL, true)
 OPTION(journaler_write_head_interval, OPT_INT, 15)
 OPTION(journaler_prefetch_periods, OPT_INT, 10)   // * journal object size
 OPTION(journaler_prezero_periods, OPT_INT, 5)     // * journal object size
+OPTION(journaler_prezero_periods_max, OPT_INT, 64) // cap for the adaptive zeroing window
 OPTION(journaler_batch_interval, OPT_DOUBLE, .001)   // seconds.. max add latency we artificially incur
 OPTION(journaler_batch_max, OPT_U64, 0)  // max bytes we'll delay flushing; disable, for now....
 OPTION(mds_data, OPT_STR, "/var/lib/ceph/mds/$cluster-$id")
@@ -454,6 +488,8 @@ OPTION(mds_enforce_unique_name, OPT_BOOL, true)
 OPTION(mds_blacklist_interval, OPT_FLOAT, 24.0*60.0)  // how long to blacklist failed nodes
 OPTION(mds_session_timeout, OPT_FLOAT, 60)    // cap bits and leases time out if client idle
 OPTION(mds_sessionmap_keys_per_op, OPT_U32, 1024)    // how many sessions should I try to load/store in a single OMAP operation?
+OPTION(mds_dir_keys_per_op, OPT_U32, 16384)    // max dentries to read from a dirfrag in a single OMAP operation
+OPTION(mds_traverse_prefetch, OPT_BOOL, true)  // speculatively fetch remaining path components during traversal
 OPTION(mds_revoke_cap_timeout, OPT_FLOAT, 60)    // detect clients which aren't revoking caps
 OPTION(mds_recall_state_timeout, OPT_FLOAT, 60)    // detect clients which aren't trimming caps
 OPTION(mds_freeze_tree_timeout, OPT_FLOAT, 30)    // detecting freeze tree deadlock
@@ -470,6 +506,7 @@ OPTION(mds_default_dir_hash, OPT_INT, CEPH_STR_HASH_RJENKINS)
 OPTION(mds_log, OPT_BOOL, true)
 OPTION(mds_log_pause, OPT_BOOL, false)
 OPTION(mds_log_skip_corrupt_events, OPT_BOOL, false)
+OPTION(mds_log_replay_queue_events, OPT_INT, 128)  // decoded events queued ahead of replay apply, 0 to decode and apply in one thread
 OPTION(mds_log_max_events, OPT_INT, -1)
 OPTION(mds_log_events_per_segment, OPT_INT, 1024)
 OPTION(mds_log_segment_size, OPT_INT, 0)  // segment size for mds log, default to default file_layout_t
@@ -499,6 +536,7 @@ OPTION(mds_bal_need_min, OPT_FLOAT, .8)       // take within this range of what
 OPTION(mds_bal_need_max, OPT_FLOAT, 1.2)
 OPTION(mds_bal_midchunk, OPT_FLOAT, .3)       // any sub bigger than this taken in full
 OPTION(mds_bal_minchunk, OPT_FLOAT, .001)     // never take anything smaller than this
+OPTION(mds_bal_max_export_size, OPT_U64, 100000) // descend into subtrees with more entries (rstat) than this instead of exporting them whole, 0 to disable
 OPTION(mds_bal_target_removal_min, OPT_INT, 5) // min balance iterations before old target is removed
 OPTION(mds_bal_target_removal_max, OPT_INT, 10) // max balance iterations before old target is removed
 OPTION(mds_replay_interval, OPT_FLOAT, 1.0) // time to wait before starting replay again
@@ -552,6 +590,7 @@ OPTION(mds_mon_shutdown_timeout, OPT_DOUBLE, 5)
 
 // Maximum number of concurrent stray files to purge
 OPTION(mds_max_purge_files, OPT_U32, 64)
+OPTION(mds_max_purge_bypass, OPT_U32, 64)  // how many small purges may jump ahead of one blocked on the ops budget, 0 = strict fifo
 // Maximum number of concurrent RADOS ops to issue in purging
 OPTION(mds_max_purge_ops, OPT_U32, 8192)
 // Maximum number of concurrent RADOS ops to issue in purging, scaled by PG count
@@ -561,6 +600,7 @@ OPTION(mds_root_ino_uid, OPT_INT, 0) // The UID of / on new filesystems
 OPTION(mds_root_ino_gid, OPT_INT, 0) // The GID of / on new filesystems
 
 OPTION(mds_max_scrub_ops_in_progress, OPT_INT, 5) // the number of simultaneous scrubs allowed
+OPTION(mds_scrub_backtrace_fetch_batch, OPT_INT, 64) // backtraces read per bulk fetch ahead of scrub
 
 // Maximum number of damaged frags/dentries before whole MDS rank goes damaged
 OPTION(mds_damage_table_max_entries, OPT_INT, 10000)
@@ -665,6 +705,10 @@ OPTION(osd_hit_set_namespace, OPT_STR, ".ceph-internal") // rados namespace for
 // conservative default throttling values
 OPTION(osd_tier_promote_max_objects_sec, OPT_U64, 25)
 OPTION(osd_tier_promote_max_bytes_sec, OPT_U64, 5 * 1024*1024)
+// scale the promote targets down when the average proxied read takes
+// longer than this, on the theory that the base tier is already
+// struggling to keep up; 0 disables the latency-based backoff
+OPTION(osd_tier_promote_base_read_lat_ms, OPT_DOUBLE, 50)
 
 OPTION(osd_tier_default_cache_mode, OPT_STR, "writeback")
 OPTION(osd_tier_default_cache_hit_set_count, OPT_INT, 4)
@@ -678,6 +722,7 @@ OPTION(osd_tier_default_cache_hit_set_search_last_n, OPT_INT, 1)
 OPTION(osd_map_dedup, OPT_BOOL, true)
 OPTION(osd_map_max_advance, OPT_INT, 150) // make this < cache_size!
 OPTION(osd_map_cache_size, OPT_INT, 200)
+OPTION(osd_map_cache_shards, OPT_INT, 8) // map cache shards; epoch lookups on different shards use different locks
 OPTION(osd_map_message_max, OPT_INT, 100)  // max maps per MOSDMap message
 OPTION(osd_map_share_max_epochs, OPT_INT, 100)  // cap on # of inc maps we send to peers, clients
 OPTION(osd_inject_bad_map_crc_probability, OPT_FLOAT, 0)
@@ -687,10 +732,12 @@ OPTION(osd_max_markdown_period , OPT_INT, 600)
 OPTION(osd_max_markdown_count, OPT_INT, 5)
 
 OPTION(osd_op_threads, OPT_INT, 2)    // 0 == no threading
+OPTION(osd_peering_threads, OPT_INT, 2) // threads advancing pg peering state machines
 OPTION(osd_peering_wq_batch_size, OPT_U64, 20)
 OPTION(osd_op_pq_max_tokens_per_priority, OPT_U64, 4194304)
 OPTION(osd_op_pq_min_cost, OPT_U64, 65536)
 OPTION(osd_disk_threads, OPT_INT, 1)
+OPTION(osd_pg_load_threads, OPT_INT, 4)  // threads reading pg metadata/logs at startup
 OPTION(osd_disk_thread_ioprio_class, OPT_STR, "") // rt realtime be best effort idle
 OPTION(osd_disk_thread_ioprio_priority, OPT_INT, -1) // 0-7
 OPTION(osd_recovery_threads, OPT_INT, 1)
@@ -699,6 +746,21 @@ OPTION(osd_op_num_threads_per_shard, OPT_INT, 2)
 OPTION(osd_op_num_shards, OPT_INT, 5)
 OPTION(osd_op_queue, OPT_STR, "wpq") // PrioritzedQueue (prio), Weighted Priority Queue (wpq), or debug_random
 OPTION(osd_op_queue_cut_off, OPT_STR, "low") // Min priority to go to strict queue. (low, high, debug_random)
+OPTION(osd_op_wq_max_spin, OPT_U64, 0) // max iterations an op worker busy-polls its shard inbox before sleeping (0 = off)
+// qos knobs for osd_op_queue = "mclock": reservation and limit are in
+// ops/sec (0 = none), weight is a dimensionless share
+OPTION(osd_op_queue_mclock_client_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_client_wgt, OPT_DOUBLE, 500)
+OPTION(osd_op_queue_mclock_client_lim, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_recovery_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_recovery_wgt, OPT_DOUBLE, 100)
+OPTION(osd_op_queue_mclock_recovery_lim, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_scrub_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_scrub_wgt, OPT_DOUBLE, 50)
+OPTION(osd_op_queue_mclock_scrub_lim, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_snaptrim_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_snaptrim_wgt, OPT_DOUBLE, 50)
+OPTION(osd_op_queue_mclock_snaptrim_lim, OPT_DOUBLE, 0)
 
 // Set to true for testing.  Users should NOT set this.
 // If set to true even after reading enough shards to
@@ -726,6 +788,7 @@ OPTION(osd_heartbeat_addr, OPT_ADDR, entity_addr_t())
 OPTION(osd_heartbeat_interval, OPT_INT, 6)       // (seconds) how often we ping peers
 OPTION(osd_heartbeat_grace, OPT_INT, 20)         // (seconds) how long before we decide a peer has failed
 OPTION(osd_heartbeat_min_peers, OPT_INT, 10)     // minimum number of peers
+OPTION(osd_heartbeat_peers_per_host, OPT_INT, 0) // max hb peers on any one remote host (0 = no cap)
 OPTION(osd_heartbeat_use_min_delay_socket, OPT_BOOL, false) // prio the heartbeat tcp socket and set dscp as CS6 on it if true
 
 // max number of parallel snap trims/pg
@@ -740,6 +803,7 @@ OPTION(osd_mon_report_interval_max, OPT_INT, 600)
 OPTION(osd_mon_report_interval_min, OPT_INT, 5)  // pg stats, failures, up_thru, boot.
 OPTION(osd_mon_report_max_in_flight, OPT_INT, 2)  // max updates in flight
 OPTION(osd_pg_stat_report_interval_max, OPT_INT, 500)  // report pg stats for any given pg at least this often
+OPTION(osd_mon_pg_stat_deltas, OPT_BOOL, false)  // report steady-state pg stats as deltas; requires mons that understand them
 OPTION(osd_mon_ack_timeout, OPT_INT, 30) // time out a mon if it doesn't ack stats
 OPTION(osd_stats_ack_timeout_factor, OPT_DOUBLE, 2.0) // multiples of mon_ack_timeout
 OPTION(osd_stats_ack_timeout_decay, OPT_DOUBLE, .9)
@@ -750,6 +814,7 @@ OPTION(osd_recovery_delay_start, OPT_FLOAT, 0)
 OPTION(osd_recovery_max_active, OPT_U64, 3)
 OPTION(osd_recovery_max_single_start, OPT_U64, 1)
 OPTION(osd_recovery_max_chunk, OPT_U64, 8<<20)  // max size of push chunk
+OPTION(osd_recovery_push_readahead, OPT_BOOL, true) // read the next push chunk while the previous one is in flight
 OPTION(osd_recovery_max_omap_entries_per_chunk, OPT_U64, 64000) // max number of omap entries per chunk; 0 to disable limit
 OPTION(osd_copyfrom_max_chunk, OPT_U64, 8<<20)   // max size of a COPYFROM chunk
 OPTION(osd_push_per_object_cost, OPT_U64, 1000)  // push cost per object
@@ -766,12 +831,14 @@ OPTION(osd_scrub_interval_randomize_ratio, OPT_FLOAT, 0.5) // randomize the sche
 OPTION(osd_scrub_chunk_min, OPT_INT, 5)
 OPTION(osd_scrub_chunk_max, OPT_INT, 25)
 OPTION(osd_scrub_sleep, OPT_FLOAT, 0)   // sleep between [deep]scrub ops
+OPTION(osd_scrub_max_preemptions, OPT_INT, 5)  // redo a scrub chunk this many times for a client write before blocking it
 OPTION(osd_scrub_auto_repair, OPT_BOOL, false)   // whether auto-repair inconsistencies upon deep-scrubbing
 OPTION(osd_scrub_auto_repair_num_errors, OPT_U32, 5)   // only auto-repair when number of errors is below this threshold
 OPTION(osd_deep_scrub_interval, OPT_FLOAT, 60*60*24*7) // once a week
 OPTION(osd_deep_scrub_randomize_ratio, OPT_FLOAT, 0.15) // scrubs will randomly become deep scrubs at this rate (0.15 -> 15% of scrubs are deep)
 OPTION(osd_deep_scrub_stride, OPT_INT, 524288)
 OPTION(osd_deep_scrub_update_digest_min_age, OPT_INT, 2*60*60)   // objects must be this old (seconds) before we update the whole-object digest on scrub
+OPTION(osd_deep_scrub_skip_unmodified, OPT_BOOL, false) // trust stored whole-object digests for objects not written since the last deep scrub instead of re-reading them; trades bit rot detection latency for read bandwidth, and should be disabled before running a repair
 OPTION(osd_scan_list_ping_tp_interval, OPT_U64, 100)
 OPTION(osd_class_dir, OPT_STR, CEPH_LIBDIR "/rados-classes") // where rados plugins are stored
 OPTION(osd_open_classes_on_start, OPT_BOOL, true)
@@ -791,6 +858,10 @@ OPTION(osd_pg_epoch_persisted_max_stale, OPT_U32, 150) // make this < map_cache_
 OPTION(osd_min_pg_log_entries, OPT_U32, 3000)  // number of entries to keep in the pg log when trimming it
 OPTION(osd_max_pg_log_entries, OPT_U32, 10000) // max entries, say when degraded, before we trim
 OPTION(osd_pg_log_trim_min, OPT_U32, 100)
+// pack runs of new pg log entries into one omap value of up to this many
+// entries (0 = one omap key per entry; note that logs written with this
+// enabled cannot be read by code that predates the segment format)
+OPTION(osd_pg_log_segment_entries, OPT_U32, 0)
 OPTION(osd_op_complaint_time, OPT_FLOAT, 30) // how many seconds old makes an op complaint-worthy
 OPTION(osd_command_max_records, OPT_INT, 256)
 OPTION(osd_max_pg_blocked_by, OPT_U32, 16)    // max peer osds to report that are blocking our progress
@@ -812,11 +883,14 @@ OPTION(osd_enable_op_tracker, OPT_BOOL, true) // enable/disable OSD op tracking
 OPTION(osd_num_op_tracker_shard, OPT_U32, 32) // The number of shards for holding the ops
 OPTION(osd_op_history_size, OPT_U32, 20)    // Max number of completed ops to track
 OPTION(osd_op_history_duration, OPT_U32, 600) // Oldest completed op to track
+OPTION(osd_op_trace_sample_rate, OPT_U32, 0) // trace 1 in N client ops through the op tracker (0 = off); requires osd_enable_op_tracker
+OPTION(osd_op_trace_history_size, OPT_U32, 256) // sampled op timelines kept for dump_op_traces
 OPTION(osd_target_transaction_size, OPT_INT, 30)     // to adjust various transactions that batch smaller items
 OPTION(osd_failsafe_full_ratio, OPT_FLOAT, .97) // what % full makes an OSD "full" (failsafe)
 OPTION(osd_failsafe_nearfull_ratio, OPT_FLOAT, .90) // what % full makes an OSD near full (failsafe)
 
 OPTION(osd_pg_object_context_cache_count, OPT_INT, 64)
+OPTION(osd_pg_object_context_cache_shards, OPT_INT, 4) // obc cache shards per pg; lookups and ref-drop cleanups on different objects use different locks
 OPTION(osd_tracing, OPT_BOOL, false) // true if LTTng-UST tracepoints should be enabled
 
 // determines whether PGLog::check() compares written out log to stored log
@@ -851,6 +925,17 @@ OPTION(rocksdb_log_to_ceph_log, OPT_BOOL, true)  // log to ceph log
 OPTION(rocksdb_cache_size, OPT_INT, 128*1024*1024)  // default rocksdb cache size
 OPTION(rocksdb_cache_shard_bits, OPT_INT, 4)  // rocksdb block cache shard bits, 4 bit -> 16 shards
 OPTION(rocksdb_block_size, OPT_INT, 4*1024)  // default rocksdb block size
+// let concurrent writers insert into the memtable in parallel instead of
+// serializing behind the write thread (requires the skiplist memtable)
+OPTION(rocksdb_concurrent_memtable_write, OPT_BOOL, true)
+OPTION(rocksdb_write_thread_adaptive_yield, OPT_BOOL, true)
+// merge concurrent submit_transaction callers into one WriteBatch so the
+// WAL sees fewer, larger writes
+OPTION(rocksdb_group_commit, OPT_BOOL, false)
+// "prefix[=cf options][;prefix...]": give each listed key prefix its own
+// column family with independent memtables and compaction; must be chosen
+// when the store is created
+OPTION(rocksdb_column_families, OPT_STR, "")
 // rocksdb options that will be used for omap(if omap_backend is rocksdb)
 OPTION(filestore_rocksdb_options, OPT_STR, "")
 // rocksdb options that will be used in monstore
@@ -895,10 +980,12 @@ OPTION(osd_max_attr_size, OPT_U64, 0)
 
 OPTION(osd_objectstore, OPT_STR, "filestore")  // ObjectStore backend type
 OPTION(osd_objectstore_tracing, OPT_BOOL, false) // true if LTTng-UST tracepoints should be enabled
+OPTION(osd_objectstore_trace_file, OPT_STR, "") // binary trace of queued transactions, replayable with ceph_objectstore_tracereplay
 // Override maintaining compatibility with older OSDs
 // Set to true for testing.  Users should NOT set this.
 OPTION(osd_debug_override_acting_compat, OPT_BOOL, false)
 OPTION(osd_objectstore_fuse, OPT_BOOL, false)
+OPTION(osd_stack_sampler_hz, OPT_INT, 0) // >0: run the in-process stack sampler continuously at this frequency
 
 OPTION(osd_bench_small_size_max_iops, OPT_U32, 100) // 100 IOPS
 OPTION(osd_bench_large_size_max_throughput, OPT_U64, 100 << 20) // 100 MB/s
@@ -918,12 +1005,16 @@ OPTION(bdev_aio, OPT_BOOL, true)
 OPTION(bdev_aio_poll_ms, OPT_INT, 250)  // milliseconds
 OPTION(bdev_aio_max_queue_depth, OPT_INT, 32)
 OPTION(bdev_block_size, OPT_INT, 4096)
+OPTION(bdev_enable_discard, OPT_BOOL, false)  // issue async discards for released extents
+OPTION(bdev_discard_max_bytes, OPT_U64, 128*1024*1024)  // split larger discards into pieces of at most this
+OPTION(bdev_discard_sleep, OPT_FLOAT, 0)  // seconds to sleep between discard pieces (rate limit)
 
 // if yes, osd will unbind all NVMe devices from kernel driver and bind them
 // to the uio_pci_generic driver. The purpose is to prevent the case where
 // NVMe driver is loaded while osd is running.
 OPTION(bdev_nvme_unbind_from_kernel, OPT_BOOL, false)
 OPTION(bdev_nvme_retry_count, OPT_INT, -1) // -1 means by default which is 4
+OPTION(bdev_nvme_poll_max_completions, OPT_INT, 32) // completions reaped per poll
 
 OPTION(bluefs_alloc_size, OPT_U64, 1048576)
 OPTION(bluefs_max_prefetch, OPT_U64, 1048576)
@@ -931,7 +1022,11 @@ OPTION(bluefs_min_log_runway, OPT_U64, 1048576)  // alloc when we get this low
 OPTION(bluefs_max_log_runway, OPT_U64, 4194304)  // alloc this much at a time
 OPTION(bluefs_log_compact_min_ratio, OPT_FLOAT, 5.0)      // before we consider
 OPTION(bluefs_log_compact_min_size, OPT_U64, 16*1048576)  // before we consider
+OPTION(bluefs_compact_log_sync, OPT_BOOL, false)  // sync or async log compaction?
 OPTION(bluefs_min_flush_size, OPT_U64, 65536)  // ignore flush until its this big
+OPTION(bluefs_migrate_files, OPT_BOOL, false)  // move files between bdevs by heat
+OPTION(bluefs_migrate_hot_read_count, OPT_U64, 64)  // reads before we promote
+OPTION(bluefs_migrate_db_min_free_ratio, OPT_FLOAT, .05)  // demote below this
 
 OPTION(bluestore_bluefs, OPT_BOOL, true)
 OPTION(bluestore_bluefs_env_mirror, OPT_BOOL, false) // mirror to normal Env for debug
@@ -975,11 +1070,18 @@ OPTION(bluestore_compression_max_blob_size, OPT_U32, 4*1024*1024)
  * And ask for compressing at least 12.5%(1/8) off, by default.
  */
 OPTION(bluestore_compression_required_ratio, OPT_DOUBLE, .875)
+OPTION(bluestore_compression_async, OPT_BOOL, false) // compress blobs on a thread pool
+OPTION(bluestore_compression_max_rejects, OPT_INT, 4) // consecutive rejected blobs before an object is treated as incompressible
 OPTION(bluestore_cache_type, OPT_STR, "2q")   // lru, 2q
 OPTION(bluestore_onode_cache_size, OPT_U32, 16*1024)
 OPTION(bluestore_buffer_cache_size, OPT_U32, 512*1024*1024)
+OPTION(bluestore_cache_trim_interval, OPT_DOUBLE, .2)
+OPTION(bluestore_cache_autotune, OPT_BOOL, false) // resize onode/buffer split from hit rates
+OPTION(bluestore_cache_autotune_chunk, OPT_U64, 16*1024*1024) // bytes moved per adjustment
+OPTION(bluestore_cache_autotune_onode_cost, OPT_U32, 4*1024) // approx bytes per cached onode
 OPTION(bluestore_kvbackend, OPT_STR, "rocksdb")
-OPTION(bluestore_allocator, OPT_STR, "bitmap")     // stupid | bitmap
+OPTION(bluestore_allocator, OPT_STR, "bitmap")     // stupid | bitmap | sharded
+OPTION(bluestore_sharded_alloc_regions, OPT_INT, 16) // device regions for sharded allocator
 OPTION(bluestore_freelist_type, OPT_STR, "bitmap") // extent | bitmap
 OPTION(bluestore_freelist_blocks_per_key, OPT_INT, 128)
 OPTION(bluestore_bitmapallocator_blocks_per_zone, OPT_INT, 1024) // must be power of 2 aligned, e.g., 512, 1024, 2048...
@@ -1043,18 +1145,31 @@ OPTION(filestore_wbthrottle_xfs_inodes_start_flusher, OPT_U64, 500)
 /// These must be less than the fd limit
 OPTION(filestore_wbthrottle_btrfs_inodes_hard_limit, OPT_U64, 5000)
 OPTION(filestore_wbthrottle_xfs_inodes_hard_limit, OPT_U64, 5000)
+// scale the limits above from measured flush latency so fast devices keep
+// more writeback in flight and slow devices flush earlier
+OPTION(filestore_wbthrottle_adaptive, OPT_BOOL, false)
+OPTION(filestore_wbthrottle_adaptive_target_latency, OPT_FLOAT, .05) // seconds per flush
+OPTION(filestore_wbthrottle_adaptive_scale_min, OPT_FLOAT, .25)
+OPTION(filestore_wbthrottle_adaptive_scale_max, OPT_FLOAT, 4.0)
 
 //Introduce a O_DSYNC write in the filestore
 OPTION(filestore_odsync_write, OPT_BOOL, false)
 
 // Tests index failure paths
 OPTION(filestore_index_retry_probability, OPT_DOUBLE, 0)
+// entries in the per-collection hash -> subdir path memoization cache
+// used by HashIndex::_lookup; 0 disables it
+OPTION(filestore_index_path_cache_size, OPT_U64, 4096)
 
 // Allow object read error injection
 OPTION(filestore_debug_inject_read_err, OPT_BOOL, false)
 
 OPTION(filestore_debug_omap_check, OPT_BOOL, 0) // Expensive debugging check on sync
 OPTION(filestore_omap_header_cache_size, OPT_INT, 1024)
+// flatten omap parent chains at least this deep on write (0 = never)
+OPTION(filestore_omap_flatten_depth, OPT_INT, 2)
+// give up flattening a chain holding more than this many keys
+OPTION(filestore_omap_flatten_max_keys, OPT_U64, 8192)
 
 // Use omap for xattrs for attrs over
 // filestore_max_inline_xattr_size or
@@ -1088,6 +1203,7 @@ OPTION(filestore_max_alloc_hint_size, OPT_U64, 1ULL << 20) // bytes
 
 OPTION(filestore_max_sync_interval, OPT_DOUBLE, 5)    // seconds
 OPTION(filestore_min_sync_interval, OPT_DOUBLE, .01)  // seconds
+OPTION(filestore_journal_target_fill, OPT_DOUBLE, .5) // commit early past this journal fill fraction (0 = fixed intervals)
 OPTION(filestore_btrfs_snap, OPT_BOOL, true)
 OPTION(filestore_btrfs_clone_range, OPT_BOOL, true)
 OPTION(filestore_zfs_snap, OPT_BOOL, false) // zfsonlinux is still unstable
@@ -1131,6 +1247,9 @@ OPTION(filestore_queue_low_threshhold, OPT_DOUBLE, 0.3)
 OPTION(filestore_queue_high_threshhold, OPT_DOUBLE, 0.9)
 
 OPTION(filestore_op_threads, OPT_INT, 2)
+// apply ops concurrently when they touch disjoint objects; ordering is
+// preserved per object (and for collection-level ops) instead of per sequencer
+OPTION(filestore_apply_object_ordering, OPT_BOOL, false)
 OPTION(filestore_op_thread_timeout, OPT_INT, 60)
 OPTION(filestore_op_thread_suicide_timeout, OPT_INT, 180)
 OPTION(filestore_commit_timeout, OPT_FLOAT, 600)
@@ -1191,11 +1310,13 @@ OPTION(rbd_cache_max_dirty_age, OPT_FLOAT, 1.0)      // seconds in cache before
 OPTION(rbd_cache_max_dirty_object, OPT_INT, 0)       // dirty limit for objects - set to 0 for auto calculate from rbd_cache_size
 OPTION(rbd_cache_block_writes_upfront, OPT_BOOL, false) // whether to block writes to the cache before the aio_write call completes (true), or block before the aio completion is called (false)
 OPTION(rbd_concurrent_management_ops, OPT_INT, 10) // how many operations can be in flight for a management operation like deleting or resizing an image
+OPTION(rbd_concurrent_diff_ops, OPT_INT, 128) // how many list-snaps calls can be in flight during diff-iterate; these are cheap metadata reads, so the window can be much wider than for management ops
 OPTION(rbd_balance_snap_reads, OPT_BOOL, false)
 OPTION(rbd_localize_snap_reads, OPT_BOOL, false)
 OPTION(rbd_balance_parent_reads, OPT_BOOL, false)
 OPTION(rbd_localize_parent_reads, OPT_BOOL, true)
 OPTION(rbd_readahead_trigger_requests, OPT_INT, 10) // number of sequential requests necessary to trigger readahead
+OPTION(rbd_readahead_max_streams, OPT_INT, 4) // number of interleaved sequential/strided read streams to track per image; 1 = classic single-stream detector
 OPTION(rbd_readahead_max_bytes, OPT_LONGLONG, 512 * 1024) // set to 0 to disable readahead
 OPTION(rbd_readahead_disable_after_bytes, OPT_LONGLONG, 50 * 1024 * 1024) // how many bytes are read in total before readahead is disabled
 OPTION(rbd_clone_copy_on_read, OPT_BOOL, false)
@@ -1254,6 +1375,8 @@ OPTION(rbd_journal_max_payload_bytes, OPT_U32, 16384) // maximum journal payload
 OPTION(rbd_mirror_journal_commit_age, OPT_DOUBLE, 5) // commit time interval, seconds
 OPTION(rbd_mirror_journal_poll_age, OPT_DOUBLE, 5) // maximum age (in seconds) between successive journal polls
 OPTION(rbd_mirror_journal_max_fetch_bytes, OPT_U32, 32768) // maximum bytes to read from each journal data object per fetch
+OPTION(rbd_mirror_journal_object_fetch_window, OPT_U32, 16) // journal data objects to read ahead of the replay position
+OPTION(rbd_mirror_journal_max_prefetch_bytes, OPT_U64, 32 << 20) // pause journal read-ahead above this many fetched but unreplayed bytes
 OPTION(rbd_mirror_sync_point_update_age, OPT_DOUBLE, 30) // number of seconds between each update of the image sync point object number
 OPTION(rbd_mirror_concurrent_image_syncs, OPT_U32, 5) // maximum number of image syncs in parallel
 
@@ -1278,6 +1401,10 @@ OPTION(rgw_override_bucket_index_max_shards, OPT_U32, 0)
  * Represents the maximum AIO pending requests for the bucket index object shards.
  */
 OPTION(rgw_bucket_index_max_aio, OPT_U32, 8)
+// max # of concurrent shard listing ops when listing a sharded bucket; a
+// listing can't return until every shard has answered, so fetching the
+// shards' pages in parallel directly cuts listing latency
+OPTION(rgw_bucket_index_list_max_aio, OPT_U32, 128)
 
 /**
  * whether or not the quota/gc threads should be started
@@ -1291,6 +1418,8 @@ OPTION(rgw_data, OPT_STR, "/var/lib/ceph/radosgw/$cluster-$id")
 OPTION(rgw_enable_apis, OPT_STR, "s3, s3website, swift, swift_auth, admin")
 OPTION(rgw_cache_enabled, OPT_BOOL, true)   // rgw cache enabled
 OPTION(rgw_cache_lru_size, OPT_INT, 10000)   // num of entries in rgw cache
+OPTION(rgw_cache_shards, OPT_INT, 16)  // num of locking shards in rgw cache
+OPTION(rgw_obj_data_cache_size, OPT_U64, 0)  // bytes of memory to cache immutable object data chunks in, 0 disables
 OPTION(rgw_socket_path, OPT_STR, "")   // path to unix domain socket, if not specified, rgw will not run as external fcgi
 OPTION(rgw_host, OPT_STR, "")  // host for radosgw, can be an IP, default is 0.0.0.0
 OPTION(rgw_port, OPT_STR, "")  // port to listen, format as "8080" "5000", if not specified, rgw will not run external fcgi
@@ -1302,6 +1431,16 @@ OPTION(rgw_lifecycle_thread, OPT_INT, 1) //start lifecycle thread number per rad
 OPTION(rgw_lifecycle_work_time, OPT_STR, "00:00-06:00") //job process lc  at 00:00-06:00s
 OPTION(rgw_lc_lock_max_time, OPT_INT, 60)  // total run time for a single gc processor work
 OPTION(rgw_lc_max_objs, OPT_INT, 32)
+OPTION(rgw_lc_del_threads, OPT_INT, 8)  // number of concurrent object removals per lifecycle shard
+OPTION(rgw_dynamic_resharding, OPT_BOOL, true)  // reshard bucket indexes automatically when shards grow too large
+OPTION(rgw_max_objs_per_shard, OPT_INT, 100000)  // entry count per index shard that triggers a reshard
+OPTION(rgw_reshard_thread_interval, OPT_INT, 600)  // seconds between reshard queue processing rounds
+OPTION(rgw_reshard_bucket_lock_duration, OPT_INT, 120)  // seconds writers keep retrying while a bucket is resharding
+OPTION(rgw_data_sync_spawn_window, OPT_INT, 20)  // max concurrent entries processed per data log shard during sync
+OPTION(rgw_bucket_sync_spawn_window, OPT_INT, 20)  // max concurrent object fetches per bucket shard during sync
+OPTION(rgw_sync_log_fetch_entries, OPT_INT, 1000)  // datalog/bilog entries to request from the source zone per fetch
+OPTION(rgw_bilog_trim_interval, OPT_INT, 1800)  // seconds between background bilog trim passes, 0 to disable
+OPTION(rgw_multi_obj_del_threads, OPT_INT, 8)  // number of concurrent object removals per multi-object delete request
 OPTION(rgw_script_uri, OPT_STR, "") // alternative value for SCRIPT_URI if not set in request
 OPTION(rgw_request_uri, OPT_STR,  "") // alternative value for REQUEST_URI if not set in request
 OPTION(rgw_swift_url, OPT_STR, "")             // the swift url, being published by the internal swift auth
@@ -1322,6 +1461,7 @@ OPTION(rgw_keystone_api_version, OPT_INT, 2) // Version of Keystone API to use (
 OPTION(rgw_keystone_accepted_roles, OPT_STR, "Member, admin")  // roles required to serve requests
 OPTION(rgw_keystone_accepted_admin_roles, OPT_STR, "") // list of roles allowing an user to gain admin privileges
 OPTION(rgw_keystone_token_cache_size, OPT_INT, 10000)  // max number of entries in keystone token cache
+OPTION(rgw_keystone_token_cache_negative_ttl, OPT_INT, 10)  // seconds to cache rejected tokens, 0 to disable
 OPTION(rgw_keystone_revocation_interval, OPT_INT, 15 * 60)  // seconds between tokens revocation check
 OPTION(rgw_keystone_verify_ssl, OPT_BOOL, true) // should we try to verify keystone's ssl
 OPTION(rgw_keystone_implicit_tenants, OPT_BOOL, false)  // create new users in their own tenants of the same name
@@ -1401,12 +1541,22 @@ OPTION(rgw_gc_max_objs, OPT_INT, 32)
 OPTION(rgw_gc_obj_min_wait, OPT_INT, 2 * 3600)    // wait time before object may be handled by gc
 OPTION(rgw_gc_processor_max_time, OPT_INT, 3600)  // total run time for a single gc processor work
 OPTION(rgw_gc_processor_period, OPT_INT, 3600)  // gc processor cycle time
+OPTION(rgw_gc_processor_threads, OPT_INT, 1)  // number of concurrent gc processor threads; shards are arbitrated by the per-shard lock
+OPTION(rgw_gc_max_concurrent_io, OPT_INT, 10)  // max concurrent object removals while processing a gc chain
 OPTION(rgw_s3_success_create_obj_status, OPT_INT, 0) // alternative success status response for create-obj (0 - default)
 OPTION(rgw_resolve_cname, OPT_BOOL, false)  // should rgw try to resolve hostname as a dns cname record
 OPTION(rgw_obj_stripe_size, OPT_INT, 4 << 20)
 OPTION(rgw_extended_http_attrs, OPT_STR, "") // list of extended attrs that can be set on objects (beyond the default)
 OPTION(rgw_exit_timeout_secs, OPT_INT, 120) // how many seconds to wait for process to go down before exiting unconditionally
 OPTION(rgw_get_obj_window_size, OPT_INT, 16 << 20) // window size in bytes for single get obj request
+OPTION(rgw_put_obj_min_window_size, OPT_INT, 16 << 20) // min window size in bytes for data writes of a single put obj request
+OPTION(rgw_put_obj_max_window_size, OPT_INT, 64 << 20) // max window size in bytes for data writes of a single put obj request
+OPTION(rgw_put_obj_digest_thread, OPT_BOOL, true) // compute the md5 of large uploads on a separate thread
+// issue the bucket index prepare concurrently with the head object write
+// instead of in front of it, saving a round trip per object write; if the
+// prepare then fails after the head already landed it is retried once, and
+// on a persistent failure the index can lag the head until reconciled
+OPTION(rgw_bucket_index_overlap_prepare, OPT_BOOL, false)
 OPTION(rgw_get_obj_max_req_size, OPT_INT, 4 << 20) // max length of a single get obj rados op
 OPTION(rgw_relaxed_s3_bucket_names, OPT_BOOL, false) // enable relaxed bucket name rules for US region buckets
 OPTION(rgw_defer_to_bucket_acls, OPT_STR, "") // if the user has bucket perms, use those before key perms (recurse and full_control)
@@ -1415,6 +1565,9 @@ OPTION(rgw_md_log_max_shards, OPT_INT, 64) // max shards for metadata log
 OPTION(rgw_num_zone_opstate_shards, OPT_INT, 128) // max shards for keeping inter-region copy progress info
 OPTION(rgw_opstate_ratelimit_sec, OPT_INT, 30) // min time between opstate updates on a single upload (0 for disabling ratelimit)
 OPTION(rgw_curl_wait_timeout_ms, OPT_INT, 1000) // timeout for certain curl calls
+OPTION(rgw_curl_handle_pool_size, OPT_INT, 16) // max idle curl easy handles kept for reuse (keepalive connections stay warm)
+OPTION(rgw_curl_max_cached_connections, OPT_INT, 64) // max keepalive connections cached by each curl multi handle
+OPTION(rgw_curl_pipelining, OPT_BOOL, false) // enable http pipelining on curl multi handles (peers must handle it correctly)
 OPTION(rgw_copy_obj_progress, OPT_BOOL, true) // should dump progress during long copy operations?
 OPTION(rgw_copy_obj_progress_every_bytes, OPT_INT, 1024 * 1024) // min bytes between copy progress output
 OPTION(rgw_obj_tombstone_cache_size, OPT_INT, 1000) // how many objects in tombstone cache, which is used in multi-zone sync to keep
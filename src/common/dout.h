@@ -52,7 +52,8 @@ public:
 
 #define dout_impl(cct, sub, v)						\
   do {									\
-  if (cct->_conf->subsys.should_gather(sub, v)) {			\
+  if ((v) <= CEPH_MAX_DEBUG_LEVEL &&					\
+      cct->_conf->subsys.should_gather(sub, v)) {			\
     if (0) {								\
       char __array[((v >= -1) && (v <= 200)) ? 0 : -1] __attribute__((unused)); \
     }									\
@@ -73,7 +74,8 @@ public:
 #define lgeneric_derr(cct) dout_impl(cct, ceph_subsys_, -1) *_dout
 
 #define ldlog_p1(cct, sub, lvl)                 \
-  (cct->_conf->subsys.should_gather((sub), (lvl)))
+  ((lvl) <= CEPH_MAX_DEBUG_LEVEL &&             \
+   cct->_conf->subsys.should_gather((sub), (lvl)))
 
 // NOTE: depend on magic value in _ASSERT_H so that we detect when
 // /usr/include/assert.h clobbers our fancier version.
@@ -30,12 +30,29 @@
 #define SGL_QUOTE_XESCAPE		"&apos;"
 #define DBL_QUOTE_XESCAPE		"&quot;"
 
+/* True for the (rare) characters escape_xml_attr() has to rewrite; the
+ * bulk loops below copy whole runs of everything else in one go. */
+static int xml_needs_escape(unsigned char c)
+{
+	return c == '<' || c == '&' || c == '>' || c == '\'' || c == '"' ||
+		((c < 0x20) && (c != 0x09) && (c != 0x0a)) || (c == 0x7f);
+}
+
 int escape_xml_attr_len(const char *buf)
 {
 	const char *b;
 	int ret = 0;
 	for (b = buf; *b; ++b) {
 		unsigned char c = *b;
+		if (!xml_needs_escape(c)) {
+			const char *start = b;
+			do {
+				++b;
+			} while (*b && !xml_needs_escape((unsigned char)*b));
+			ret += b - start;
+			--b;
+			continue;
+		}
 		switch (c) {
 		case '<':
 			ret += SSTRL(LESS_THAN_XESCAPE);
@@ -53,14 +70,8 @@ int escape_xml_attr_len(const char *buf)
 			ret += SSTRL(DBL_QUOTE_XESCAPE);
 			break;
 		default:
-			// Escape control characters.
-			if (((c < 0x20) && (c != 0x09) && (c != 0x0a)) ||
-				    (c == 0x7f)) {
-				ret += 6;
-			}
-			else {
-				ret++;
-			}
+			// Escaped control characters.
+			ret += 6;
 		}
 	}
 	// leave room for null terminator
@@ -74,6 +85,16 @@ void escape_xml_attr(const char *buf, char *out)
 	const char *b;
 	for (b = buf; *b; ++b) {
 		unsigned char c = *b;
+		if (!xml_needs_escape(c)) {
+			const char *start = b;
+			do {
+				++b;
+			} while (*b && !xml_needs_escape((unsigned char)*b));
+			memcpy(o, start, b - start);
+			o += b - start;
+			--b;
+			continue;
+		}
 		switch (c) {
 		case '<':
 			// cppcheck-suppress sizeofDivisionMemfunc
@@ -101,15 +122,9 @@ void escape_xml_attr(const char *buf, char *out)
 			o += SSTRL(DBL_QUOTE_XESCAPE);
 			break;
 		default:
-			// Escape control characters.
-			if (((c < 0x20) && (c != 0x09) && (c != 0x0a)) ||
-				    (c == 0x7f)) {
-				snprintf(o, 7, "&#x%02x;", c);
-				o += 6;
-			}
-			else {
-				*o++ = c;
-			}
+			// Escaped control characters.
+			snprintf(o, 7, "&#x%02x;", c);
+			o += 6;
 			break;
 		}
 	}
@@ -123,6 +138,12 @@ void escape_xml_attr(const char *buf, char *out)
 #define TAB_JESCAPE "\\t"
 #define NEWLINE_JESCAPE "\\n"
 
+static int json_needs_escape(unsigned char c)
+{
+	return c == '"' || c == '\\' || c == '/' || c == '\t' || c == '\n' ||
+		(c < 0x20) || (c == 0x7f);
+}
+
 int escape_json_attr_len(const char *buf, int src_len)
 {
 	const char *b;
@@ -130,6 +151,18 @@ int escape_json_attr_len(const char *buf, int src_len)
 	int i;
 	for (i = 0, b = buf; i < src_len; ++i, ++b) {
 		unsigned char c = *b;
+		if (!json_needs_escape(c)) {
+			int start = i;
+			do {
+				++i;
+				++b;
+			} while (i < src_len &&
+				 !json_needs_escape((unsigned char)*b));
+			ret += i - start;
+			--i;
+			--b;
+			continue;
+		}
 		switch (c) {
 		case '"':
 			ret += SSTRL(DBL_QUOTE_JESCAPE);
@@ -147,13 +180,8 @@ int escape_json_attr_len(const char *buf, int src_len)
 			ret += SSTRL(NEWLINE_JESCAPE);
 			break;
 		default:
-			// Escape control characters.
-			if ((c < 0x20) || (c == 0x7f)) {
-				ret += 6;
-			}
-			else {
-				ret++;
-			}
+			// Escaped control characters.
+			ret += 6;
 		}
 	}
 	// leave room for null terminator
@@ -168,6 +196,19 @@ void escape_json_attr(const char *buf, int src_len, char *out)
 	int i;
 	for (i = 0, b = buf; i < src_len; ++i, ++b) {
 		unsigned char c = *b;
+		if (!json_needs_escape(c)) {
+			const char *start = b;
+			do {
+				++i;
+				++b;
+			} while (i < src_len &&
+				 !json_needs_escape((unsigned char)*b));
+			memcpy(o, start, b - start);
+			o += b - start;
+			--i;
+			--b;
+			continue;
+		}
 		switch (c) {
 		case '"':
 			// cppcheck-suppress sizeofDivisionMemfunc
@@ -195,14 +236,9 @@ void escape_json_attr(const char *buf, int src_len, char *out)
 			o += SSTRL(NEWLINE_JESCAPE);
 			break;
 		default:
-			// Escape control characters.
-			if ((c < 0x20) || (c == 0x7f)) {
-				snprintf(o, 7, "\\u%04x", c);
-				o += 6;
-			}
-			else {
-				*o++ = c;
-			}
+			// Escaped control characters.
+			snprintf(o, 7, "\\u%04x", c);
+			o += 6;
 			break;
 		}
 	}
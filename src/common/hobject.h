@@ -275,6 +275,16 @@ public:
 
   bool parse(const string& s);
 
+  size_t estimate_encoded_size() const {
+    return ENCODE_HEADER_SIZE +
+      ::estimate_encoded_size(key) +
+      ::estimate_encoded_size(oid.name) +
+      sizeof(snapid_t) +
+      sizeof(hash) +
+      sizeof(__u8) +           // max
+      ::estimate_encoded_size(nspace) +
+      sizeof(pool);
+  }
   void encode(bufferlist& bl) const;
   void decode(bufferlist::iterator& bl);
   void decode(json_spirit::Value& v);
@@ -259,6 +259,7 @@ int ObjBencher::aio_bench(
   data.min_latency = 9999.0; // this better be higher than initial latency!
   data.max_latency = 0;
   data.avg_latency = 0;
+  memset(data.lat_histogram, 0, sizeof(data.lat_histogram));
   data.object_contents = contentsChars;
   lock.Unlock();
 
@@ -352,6 +353,72 @@ static T vec_stddev(vector<T>& v)
   return sqrt(stddev);
 }
 
+void ObjBencher::track_latency(double lat)
+{
+  uint64_t usec = (uint64_t)(lat * 1000000.0);
+  int bucket = 0;
+  while (usec > 1 && bucket < BENCH_LAT_BUCKETS - 1) {
+    usec >>= 1;
+    bucket++;
+  }
+  data.lat_histogram[bucket]++;
+}
+
+double ObjBencher::latency_percentile(double percentile) const
+{
+  uint64_t total = 0;
+  for (int i = 0; i < BENCH_LAT_BUCKETS; i++)
+    total += data.lat_histogram[i];
+  if (total == 0)
+    return 0.0;
+
+  uint64_t target = (uint64_t)(total * percentile / 100.0);
+  if (target >= total)
+    target = total - 1;
+
+  uint64_t seen = 0;
+  for (int i = 0; i < BENCH_LAT_BUCKETS; i++) {
+    seen += data.lat_histogram[i];
+    if (seen > target) {
+      // middle of the [2^i, 2^(i+1)) usec bucket
+      return (double)(3ull << i) / 2.0 / 1000000.0;
+    }
+  }
+  return data.max_latency;
+}
+
+int ObjBencher::pick_rand_index(int num_objects) const
+{
+  switch (rand_dist) {
+  case RAND_DIST_ZIPF:
+    {
+      // log-uniform approximation of a zipfian popularity curve: each
+      // power-of-two band of object ranks gets an equal share of the
+      // traffic, so a handful of objects soak up most of the ops
+      double u = (double)rand() / RAND_MAX;
+      int idx = (int)std::exp(u * std::log((double)num_objects + 1.0)) - 1;
+      if (idx >= num_objects)
+	idx = num_objects - 1;
+      if (idx < 0)
+	idx = 0;
+      return idx;
+    }
+  case RAND_DIST_HOTSPOT:
+    {
+      // 90% of the ops land on the hottest 10% of the objects
+      int hot = num_objects / 10;
+      if (hot < 1)
+	hot = 1;
+      if (rand() % 100 < 90 || hot == num_objects)
+	return rand() % hot;
+      return hot + rand() % (num_objects - hot);
+    }
+  case RAND_DIST_UNIFORM:
+  default:
+    return rand() % num_objects;
+  }
+}
+
 int ObjBencher::fetch_bench_metadata(const std::string& metadata_file,
 				     uint64_t *op_size, uint64_t* object_size,
 				     int* num_objects, int* prevPid) {
@@ -506,6 +573,7 @@ int ObjBencher::write_bench(int secondsToRun,
     total_latency += data.cur_latency;
     if( data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
+    track_latency(data.cur_latency);
     ++data.finished;
     data.avg_latency = total_latency / data.finished;
     --data.in_flight;
@@ -548,6 +616,7 @@ int ObjBencher::write_bench(int secondsToRun,
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
+    track_latency(data.cur_latency);
     ++data.finished;
     data.avg_latency = total_latency / data.finished;
     --data.in_flight;
@@ -584,7 +653,11 @@ int ObjBencher::write_bench(int secondsToRun,
        << "Average Latency(s):     " << data.avg_latency << std::endl
        << "Stddev Latency(s):      " << vec_stddev(data.history.latency) << std::endl
        << "Max latency(s):         " << data.max_latency << std::endl
-       << "Min latency(s):         " << data.min_latency << std::endl;
+       << "Min latency(s):         " << data.min_latency << std::endl
+       << "P50 latency(s):         " << latency_percentile(50) << std::endl
+       << "P90 latency(s):         " << latency_percentile(90) << std::endl
+       << "P99 latency(s):         " << latency_percentile(99) << std::endl
+       << "P99.9 latency(s):       " << latency_percentile(99.9) << std::endl;
   } else {
     formatter->dump_format("total_time_run", "%f", (double)timePassed);
     formatter->dump_format("total_writes_made", "%d", data.finished);
@@ -602,6 +675,10 @@ int ObjBencher::write_bench(int secondsToRun,
     formatter->dump_format("stddev_latency", "%f", vec_stddev(data.history.latency));
     formatter->dump_format("max_latency:", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    formatter->dump_format("latency_p50", "%f", latency_percentile(50));
+    formatter->dump_format("latency_p90", "%f", latency_percentile(90));
+    formatter->dump_format("latency_p99", "%f", latency_percentile(99));
+    formatter->dump_format("latency_p999", "%f", latency_percentile(99.9));
   }
   //write object size/number data for read benchmarks
   ::encode(data.object_size, b_write);
@@ -752,6 +829,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
+    track_latency(data.cur_latency);
     ++data.finished;
     data.avg_latency = total_latency / data.finished;
     --data.in_flight;
@@ -788,6 +866,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
+    track_latency(data.cur_latency);
     ++data.finished;
     data.avg_latency = total_latency / data.finished;
     --data.in_flight;
@@ -829,7 +908,11 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
        << "Min IOPS:             " << data.idata.min_iops << std::endl
        << "Average Latency(s):   " << data.avg_latency << std::endl
        << "Max latency(s):       " << data.max_latency << std::endl
-       << "Min latency(s):       " << data.min_latency << std::endl;
+       << "Min latency(s):       " << data.min_latency << std::endl
+       << "P50 latency(s):       " << latency_percentile(50) << std::endl
+       << "P90 latency(s):       " << latency_percentile(90) << std::endl
+       << "P99 latency(s):       " << latency_percentile(99) << std::endl
+       << "P99.9 latency(s):     " << latency_percentile(99.9) << std::endl;
   } else {
     formatter->dump_format("total_time_run", "%f", (double)runtime);
     formatter->dump_format("total_reads_made", "%d", data.finished);
@@ -843,6 +926,10 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
     formatter->dump_format("average_latency", "%f", data.avg_latency);
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    formatter->dump_format("latency_p50", "%f", latency_percentile(50));
+    formatter->dump_format("latency_p90", "%f", latency_percentile(90));
+    formatter->dump_format("latency_p99", "%f", latency_percentile(99));
+    formatter->dump_format("latency_p999", "%f", latency_percentile(99.9));
   }
 
   completions_done();
@@ -883,6 +970,11 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
   if (data.op_size)
     writes_per_object = data.object_size / data.op_size;
 
+  // mixed writes clobber the deterministic object contents, so the
+  // read-side verification can't work in that mode
+  if (write_percent > 0)
+    no_verify = true;
+
   srand (time(NULL));
 
   r = completions_init(concurrentios);
@@ -968,6 +1060,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
+    track_latency(data.cur_latency);
     ++data.finished;
     data.avg_latency = total_latency / data.finished;
     --data.in_flight;
@@ -982,7 +1075,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
       }
     } 
 
-    rand_id = rand() % num_objects;
+    rand_id = pick_rand_index(num_objects);
     newName = generate_object_name(rand_id / writes_per_object, pid);
     index[slot] = rand_id;
     release_completion(slot);
@@ -993,8 +1086,17 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     //start new read and check data if requested
     start_times[slot] = ceph_clock_now(g_ceph_context);
     create_completion(slot, _aio_cb, (void *)&lc);
-    r = aio_read(newName, slot, contents[slot], data.op_size,
-		 data.op_size * (rand_id % writes_per_object));
+    if (write_percent > 0 && (rand() % 100) < write_percent) {
+      // mixed workload: overwrite the chunk instead of reading it
+      snprintf(data.object_contents, data.op_size, "I'm the %16dth op!", rand_id);
+      bufferlist wbl;
+      wbl.append(data.object_contents, data.op_size);
+      r = aio_write(newName, slot, wbl, data.op_size,
+		    data.op_size * (rand_id % writes_per_object));
+    } else {
+      r = aio_read(newName, slot, contents[slot], data.op_size,
+		   data.op_size * (rand_id % writes_per_object));
+    }
     if (r < 0) {
       goto ERR;
     }
@@ -1021,6 +1123,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
+    track_latency(data.cur_latency);
     ++data.finished;
     data.avg_latency = total_latency / data.finished;
     --data.in_flight;
@@ -1062,7 +1165,11 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
        << "Min IOPS:             " << data.idata.min_iops << std::endl
        << "Average Latency(s):   " << data.avg_latency << std::endl
        << "Max latency(s):       " << data.max_latency << std::endl
-       << "Min latency(s):       " << data.min_latency << std::endl;
+       << "Min latency(s):       " << data.min_latency << std::endl
+       << "P50 latency(s):       " << latency_percentile(50) << std::endl
+       << "P90 latency(s):       " << latency_percentile(90) << std::endl
+       << "P99 latency(s):       " << latency_percentile(99) << std::endl
+       << "P99.9 latency(s):     " << latency_percentile(99.9) << std::endl;
   } else {
     formatter->dump_format("total_time_run", "%f", (double)runtime);
     formatter->dump_format("total_reads_made", "%d", data.finished);
@@ -1076,6 +1183,10 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     formatter->dump_format("average_latency", "%f", data.avg_latency);
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    formatter->dump_format("latency_p50", "%f", latency_percentile(50));
+    formatter->dump_format("latency_p90", "%f", latency_percentile(90));
+    formatter->dump_format("latency_p99", "%f", latency_percentile(99));
+    formatter->dump_format("latency_p999", "%f", latency_percentile(99.9));
   }
   completions_done();
 
@@ -34,6 +34,9 @@ struct bench_history {
   vector<long> iops;
 };
 
+// power-of-two microsecond buckets; enough to cover any sane latency
+#define BENCH_LAT_BUCKETS 64
+
 struct bench_data {
   bool done; //is the benchmark is done
   uint64_t object_size; //the size of the objects
@@ -45,6 +48,7 @@ struct bench_data {
   double min_latency;
   double max_latency;
   double avg_latency;
+  uint64_t lat_histogram[BENCH_LAT_BUCKETS]; // log2(usec) latency buckets
   struct bench_interval_data idata; // data that is updated by time intervals and not by events
   struct bench_history history; // data history, used to calculate stddev
   utime_t cur_latency; //latency of last completed transaction
@@ -56,6 +60,11 @@ const int OP_WRITE     = 1;
 const int OP_SEQ_READ  = 2;
 const int OP_RAND_READ = 3;
 
+// object selection distributions for the rand benchmark
+const int RAND_DIST_UNIFORM = 0;
+const int RAND_DIST_ZIPF    = 1;
+const int RAND_DIST_HOTSPOT = 2;
+
 // Object is composed of <oid,namespace>
 typedef std::pair<std::string, std::string> Object;
 
@@ -82,6 +91,13 @@ protected:
   int clean_up(int num_objects, int prevPid, int concurrentios);
   bool more_objects_matching_prefix(const std::string& prefix, std::list<Object>* name);
 
+  int rand_dist = RAND_DIST_UNIFORM;
+  int write_percent = 0; // % of rand benchmark ops issued as writes
+
+  void track_latency(double lat);
+  double latency_percentile(double percentile) const;
+  int pick_rand_index(int num_objects) const;
+
   virtual int completions_init(int concurrentios) = 0;
   virtual void completions_done() = 0;
 
@@ -122,6 +138,23 @@ public:
   void set_outstream(ostream& os) {
     outstream = &os;
   }
+  int set_rand_dist(const std::string& name) {
+    if (name == "uniform")
+      rand_dist = RAND_DIST_UNIFORM;
+    else if (name == "zipf")
+      rand_dist = RAND_DIST_ZIPF;
+    else if (name == "hotspot")
+      rand_dist = RAND_DIST_HOTSPOT;
+    else
+      return -EINVAL;
+    return 0;
+  }
+  int set_write_percent(int percent) {
+    if (percent < 0 || percent > 100)
+      return -EINVAL;
+    write_percent = percent;
+    return 0;
+  }
   int clean_up_slow(const std::string& prefix, int concurrentios);
 };
 
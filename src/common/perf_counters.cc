@@ -15,6 +15,7 @@
 #include "include/int_types.h"
 
 #include "common/perf_counters.h"
+#include "common/Clock.h"
 #include "common/dout.h"
 #include "common/errno.h"
 #include "common/Formatter.h"
@@ -136,6 +137,11 @@ void PerfCountersCollection::dump_formatted(
 
 PerfCounters::~PerfCounters()
 {
+  for (perf_counter_data_vec_t::iterator d = m_data.begin();
+       d != m_data.end(); ++d) {
+    delete d->histogram;
+    d->histogram = NULL;
+  }
 }
 
 void PerfCounters::inc(int idx, uint64_t amt)
@@ -148,13 +154,16 @@ void PerfCounters::inc(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
+  PerfCounters::perf_counter_data_any_d::stripe_d& s = data.stripe();
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount.inc();
-    data.u64.add(amt);
-    data.avgcount2.inc();
+    s.avgcount.inc();
+    s.u64.add(amt);
+    s.avgcount2.inc();
   } else {
-    data.u64.add(amt);
+    s.u64.add(amt);
   }
+  if (data.type & PERFCOUNTER_HISTOGRAM)
+    data.histogram->record(amt);
 }
 
 void PerfCounters::dec(int idx, uint64_t amt)
@@ -168,7 +177,7 @@ void PerfCounters::dec(int idx, uint64_t amt)
   assert(!(data.type & PERFCOUNTER_LONGRUNAVG));
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  data.u64.sub(amt);
+  data.stripe().u64.sub(amt);
 }
 
 void PerfCounters::set(int idx, uint64_t amt)
@@ -182,14 +191,14 @@ void PerfCounters::set(int idx, uint64_t amt)
   if (!(data.type & PERFCOUNTER_U64))
     return;
 
-  ANNOTATE_BENIGN_RACE_SIZED(&data.u64, sizeof(data.u64),
+  ANNOTATE_BENIGN_RACE_SIZED(&data.stripes, sizeof(data.stripes),
                              "perf counter atomic");
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount.inc();
-    data.u64.set(amt);
-    data.avgcount2.inc();
+    data.stripes[0].avgcount.inc();
+    data.set_u64(amt);
+    data.stripes[0].avgcount2.inc();
   } else {
-    data.u64.set(amt);
+    data.set_u64(amt);
   }
 }
 
@@ -203,7 +212,7 @@ uint64_t PerfCounters::get(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return 0;
-  return data.u64.read();
+  return data.read_u64();
 }
 
 void PerfCounters::tinc(int idx, utime_t amt)
@@ -216,13 +225,16 @@ void PerfCounters::tinc(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
+  PerfCounters::perf_counter_data_any_d::stripe_d& s = data.stripe();
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount.inc();
-    data.u64.add(amt.to_nsec());
-    data.avgcount2.inc();
+    s.avgcount.inc();
+    s.u64.add(amt.to_nsec());
+    s.avgcount2.inc();
   } else {
-    data.u64.add(amt.to_nsec());
+    s.u64.add(amt.to_nsec());
   }
+  if (data.type & PERFCOUNTER_HISTOGRAM)
+    data.histogram->record(amt.to_nsec());
 }
 
 void PerfCounters::tinc(int idx, ceph::timespan amt)
@@ -235,13 +247,16 @@ void PerfCounters::tinc(int idx, ceph::timespan amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
+  PerfCounters::perf_counter_data_any_d::stripe_d& s = data.stripe();
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount.inc();
-    data.u64.add(amt.count());
-    data.avgcount2.inc();
+    s.avgcount.inc();
+    s.u64.add(amt.count());
+    s.avgcount2.inc();
   } else {
-    data.u64.add(amt.count());
+    s.u64.add(amt.count());
   }
+  if (data.type & PERFCOUNTER_HISTOGRAM)
+    data.histogram->record(amt.count());
 }
 
 void PerfCounters::tset(int idx, utime_t amt)
@@ -254,7 +269,7 @@ void PerfCounters::tset(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  data.u64.set(amt.to_nsec());
+  data.set_u64(amt.to_nsec());
   if (data.type & PERFCOUNTER_LONGRUNAVG)
     assert(0);
 }
@@ -269,7 +284,7 @@ utime_t PerfCounters::tget(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return utime_t();
-  uint64_t v = data.u64.read();
+  uint64_t v = data.read_u64();
   return utime_t(v / 1000000000ull, v % 1000000000ull);
 }
 
@@ -300,12 +315,112 @@ void PerfCounters::reset()
   }
 }
 
+/// estimated value at the given percentile: the midpoint of the log2
+/// bucket the percentile rank falls into
+double PerfCounters::hist_percentile(const uint64_t *buckets, uint64_t total,
+    double percentile)
+{
+  if (!total)
+    return 0.0;
+  uint64_t rank = (uint64_t)(total * percentile);
+  uint64_t seen = 0;
+  for (unsigned i = 0; i < PERF_HISTOGRAM_BUCKETS; ++i) {
+    seen += buckets[i];
+    if (seen > rank)
+      return (double)(3ull << i) / 2.0;
+  }
+  return (double)(3ull << (PERF_HISTOGRAM_BUCKETS - 1)) / 2.0;
+}
+
+void PerfCounters::dump_hist_percentiles(Formatter *f,
+    const perf_counter_data_any_d &d, const uint64_t *buckets)
+{
+  uint64_t total = 0;
+  for (unsigned i = 0; i < PERF_HISTOGRAM_BUCKETS; ++i)
+    total += buckets[i];
+  f->dump_unsigned("count", total);
+
+  static const struct {
+    const char *name;
+    double p;
+  } pcts[] = {
+    { "p50", 0.50 }, { "p90", 0.90 }, { "p99", 0.99 }, { "p999", 0.999 },
+  };
+  for (unsigned i = 0; i < sizeof(pcts) / sizeof(pcts[0]); ++i) {
+    double v = hist_percentile(buckets, total, pcts[i].p);
+    if (d.type & PERFCOUNTER_TIME) {
+      // recorded in nanoseconds, reported in seconds like the other
+      // time counters
+      f->dump_float(pcts[i].name, v / 1000000000.0);
+    } else {
+      f->dump_unsigned(pcts[i].name, (uint64_t)v);
+    }
+  }
+}
+
+void PerfCounters::dump_histogram(Formatter *f, perf_counter_data_any_d &d,
+    utime_t now)
+{
+  perf_histogram_d *h = d.histogram;
+  uint64_t cur[PERF_HISTOGRAM_BUCKETS];
+  h->read(cur);
+
+  Mutex::Locker lck(m_lock);
+
+  // roll the snapshot ring at most every ~10s; doing it only here
+  // keeps window bookkeeping entirely off the write path, at the cost
+  // of windows only being as regular as the polling -- which is why
+  // each one reports the duration it actually covers
+  if (!h->num_snaps ||
+      now - h->snaps[0].stamp >= utime_t(10, 0)) {
+    memmove(&h->snaps[1], &h->snaps[0],
+	    (PERF_HISTOGRAM_SNAPS - 1) * sizeof(h->snaps[0]));
+    h->snaps[0].stamp = now;
+    memcpy(h->snaps[0].buckets, cur, sizeof(cur));
+    if (h->num_snaps < PERF_HISTOGRAM_SNAPS)
+      h->num_snaps++;
+  }
+
+  f->open_object_section("histogram");
+  f->open_object_section("lifetime");
+  dump_hist_percentiles(f, d, cur);
+  f->close_section();
+
+  static const struct {
+    const char *name;
+    int secs;
+  } windows[] = {
+    { "window_10s", 10 }, { "window_60s", 60 },
+  };
+  for (unsigned w = 0; w < sizeof(windows) / sizeof(windows[0]); ++w) {
+    // newest snapshot at least as old as the requested window, or the
+    // oldest one we have
+    int snap = -1;
+    for (int i = 0; i < h->num_snaps; ++i) {
+      snap = i;
+      if (now - h->snaps[i].stamp >= utime_t(windows[w].secs, 0))
+	break;
+    }
+    if (snap < 0 || h->snaps[snap].stamp == now)
+      continue;
+    uint64_t delta[PERF_HISTOGRAM_BUCKETS];
+    for (unsigned i = 0; i < PERF_HISTOGRAM_BUCKETS; ++i)
+      delta[i] = cur[i] - h->snaps[snap].buckets[i];
+    f->open_object_section(windows[w].name);
+    f->dump_float("duration", (double)(now - h->snaps[snap].stamp));
+    dump_hist_percentiles(f, d, delta);
+    f->close_section();
+  }
+  f->close_section();
+}
+
 void PerfCounters::dump_formatted(Formatter *f, bool schema,
     const std::string &counter)
 {
+  utime_t now = ceph_clock_now(m_cct);
   f->open_object_section(m_name.c_str());
-  
-  for (perf_counter_data_vec_t::const_iterator d = m_data.begin();
+
+  for (perf_counter_data_vec_t::iterator d = m_data.begin();
        d != m_data.end(); ++d) {
     if (!counter.empty() && counter != d->name) {
       // Optionally filter on counter name
@@ -343,9 +458,11 @@ void PerfCounters::dump_formatted(Formatter *f, bool schema,
 	} else {
 	  assert(0);
 	}
+	if (d->type & PERFCOUNTER_HISTOGRAM)
+	  dump_histogram(f, *d, now);
 	f->close_section();
       } else {
-	uint64_t v = d->u64.read();
+	uint64_t v = d->read_u64();
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned(d->name, v);
 	} else if (d->type & PERFCOUNTER_TIME) {
@@ -421,6 +538,20 @@ void PerfCountersBuilder::add_time_avg(int idx, const char *name,
   add_impl(idx, name, description, nick, PERFCOUNTER_TIME | PERFCOUNTER_LONGRUNAVG);
 }
 
+void PerfCountersBuilder::add_u64_hist(int idx, const char *name,
+    const char *description, const char *nick)
+{
+  add_impl(idx, name, description, nick,
+	   PERFCOUNTER_U64 | PERFCOUNTER_LONGRUNAVG | PERFCOUNTER_HISTOGRAM);
+}
+
+void PerfCountersBuilder::add_time_hist(int idx, const char *name,
+    const char *description, const char *nick)
+{
+  add_impl(idx, name, description, nick,
+	   PERFCOUNTER_TIME | PERFCOUNTER_LONGRUNAVG | PERFCOUNTER_HISTOGRAM);
+}
+
 void PerfCountersBuilder::add_impl(int idx, const char *name,
     const char *description, const char *nick, int ty)
 {
@@ -434,6 +565,8 @@ void PerfCountersBuilder::add_impl(int idx, const char *name,
   data.description = description;
   data.nick = nick;
   data.type = (enum perfcounter_type_d)ty;
+  if (ty & PERFCOUNTER_HISTOGRAM)
+    data.histogram = new PerfCounters::perf_histogram_d;
 }
 
 PerfCounters *PerfCountersBuilder::create_perf_counters()
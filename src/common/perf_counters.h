@@ -39,6 +39,7 @@ enum perfcounter_type_d
   PERFCOUNTER_U64 = 0x2,
   PERFCOUNTER_LONGRUNAVG = 0x4,
   PERFCOUNTER_COUNTER = 0x8,
+  PERFCOUNTER_HISTOGRAM = 0x10,
 };
 
 /*
@@ -64,6 +65,12 @@ enum perfcounter_type_d
  * For the time average, it returns the current value and
  * the "avgcount" member when read off. avgcount is incremented when you call
  * tinc. Calling tset on an average is an error and will assert out.
+ *
+ * A counter may additionally carry a log2 histogram of the recorded
+ * values (add_u64_hist/add_time_hist).  The hot path only bumps one
+ * striped bucket; percentiles over the whole lifetime and over the
+ * most recent ~10s/~60s are computed lazily when the counter is
+ * dumped, from snapshots of the buckets taken at dump time.
  */
 class PerfCounters
 {
@@ -114,6 +121,69 @@ private:
   PerfCounters(const PerfCounters &rhs);
   PerfCounters& operator=(const PerfCounters &rhs);
 
+  enum {
+    /// counter values are striped over this many slots, each kept on
+    /// its own cache line, so writers on different threads increment
+    /// without ping-ponging one line; readers sum the stripes
+    PERF_COUNTER_STRIPES = 8,
+    /// log2 buckets; bucket i counts values in [2^i, 2^(i+1))
+    PERF_HISTOGRAM_BUCKETS = 64,
+    /// ring of bucket snapshots kept for windowed percentiles
+    PERF_HISTOGRAM_SNAPS = 8
+  };
+
+  /// the stripe a given thread writes to; shared by the scalar
+  /// stripes and the histogram buckets
+  static unsigned stripe_index() {
+    unsigned long t = (unsigned long)pthread_self();
+    return ((t >> 12) ^ (t >> 20)) & (PERF_COUNTER_STRIPES - 1);
+  }
+
+  /// log2 histogram of recorded values, striped like the scalar
+  /// counters.  Snapshots are rolled at dump time (never on the write
+  /// path), so the windows are only as regular as the polling; each
+  /// window is reported with the duration it actually covers.
+  struct perf_histogram_d {
+    struct hist_stripe_d {
+      atomic64_t buckets[PERF_HISTOGRAM_BUCKETS];
+    } stripes[PERF_COUNTER_STRIPES];
+
+    struct snap_d {
+      utime_t stamp;
+      uint64_t buckets[PERF_HISTOGRAM_BUCKETS];
+    } snaps[PERF_HISTOGRAM_SNAPS];   ///< [0] is the newest
+    int num_snaps;
+
+    perf_histogram_d() : num_snaps(0) {}
+
+    static unsigned bucket_of(uint64_t v) {
+      if (!v)
+	return 0;
+      return 63 - __builtin_clzll(v);
+    }
+
+    void record(uint64_t v) {
+      stripes[stripe_index()].buckets[bucket_of(v)].inc();
+    }
+
+    /// sum the stripes into out[PERF_HISTOGRAM_BUCKETS]
+    void read(uint64_t *out) const {
+      for (unsigned b = 0; b < PERF_HISTOGRAM_BUCKETS; ++b) {
+	uint64_t v = 0;
+	for (unsigned i = 0; i < PERF_COUNTER_STRIPES; ++i)
+	  v += stripes[i].buckets[b].read();
+	out[b] = v;
+      }
+    }
+
+    void reset() {
+      for (unsigned i = 0; i < PERF_COUNTER_STRIPES; ++i)
+	for (unsigned b = 0; b < PERF_HISTOGRAM_BUCKETS; ++b)
+	  stripes[i].buckets[b].set(0);
+      num_snaps = 0;
+    }
+  };
+
   /** Represents a PerfCounters data element. */
   struct perf_counter_data_any_d {
     perf_counter_data_any_d()
@@ -121,37 +191,71 @@ private:
         description(NULL),
         nick(NULL),
 	type(PERFCOUNTER_NONE),
-	u64(0),
-	avgcount(0),
-	avgcount2(0)
+	histogram(NULL)
     {}
     perf_counter_data_any_d(const perf_counter_data_any_d& other)
       : name(other.name),
         description(other.description),
         nick(other.nick),
 	type(other.type),
-	u64(other.u64.read()) {
+	histogram(other.histogram) {
       pair<uint64_t,uint64_t> a = other.read_avg();
-      u64.set(a.first);
-      avgcount.set(a.second);
-      avgcount2.set(a.second);
+      stripes[0].u64.set(a.first);
+      stripes[0].avgcount.set(a.second);
+      stripes[0].avgcount2.set(a.second);
     }
 
     const char *name;
     const char *description;
     const char *nick;
     enum perfcounter_type_d type;
-    atomic64_t u64;
-    atomic64_t avgcount;
-    atomic64_t avgcount2;
+    /// allocated by add_impl for PERFCOUNTER_HISTOGRAM counters and
+    /// freed by ~PerfCounters; the vector holding us is sized before
+    /// any element is populated, so element copies never see a live
+    /// histogram
+    perf_histogram_d *histogram;
+
+    struct stripe_d {
+      atomic64_t u64;
+      atomic64_t avgcount;
+      atomic64_t avgcount2;
+      // keep each stripe on its own cache line
+      char pad[3 * sizeof(atomic64_t) >= 64 ? 1 :
+	       64 - 3 * sizeof(atomic64_t)];
+      stripe_d() : u64(0), avgcount(0), avgcount2(0) {}
+    } stripes[PERF_COUNTER_STRIPES];
+
+    /// the stripe this thread writes to
+    stripe_d& stripe() {
+      return stripes[stripe_index()];
+    }
+
+    /// read the summed value (counters and gauges)
+    uint64_t read_u64() const {
+      uint64_t v = 0;
+      for (unsigned i = 0; i < PERF_COUNTER_STRIPES; ++i)
+	v += stripes[i].u64.read();
+      return v;
+    }
+
+    /// point-set the value: collapse all stripes into the first
+    void set_u64(uint64_t v) {
+      for (unsigned i = 1; i < PERF_COUNTER_STRIPES; ++i)
+	stripes[i].u64.set(0);
+      stripes[0].u64.set(v);
+    }
 
     void reset()
     {
       if (type != PERFCOUNTER_U64) {
-	u64.set(0);
-	avgcount.set(0);
-	avgcount2.set(0);
+	for (unsigned i = 0; i < PERF_COUNTER_STRIPES; ++i) {
+	  stripes[i].u64.set(0);
+	  stripes[i].avgcount.set(0);
+	  stripes[i].avgcount2.set(0);
+	}
       }
+      if (histogram)
+	histogram->reset();
     }
 
     perf_counter_data_any_d& operator=(const perf_counter_data_any_d& other) {
@@ -159,25 +263,46 @@ private:
       description = other.description;
       nick = other.nick;
       type = other.type;
+      histogram = other.histogram;
       pair<uint64_t,uint64_t> a = other.read_avg();
-      u64.set(a.first);
-      avgcount.set(a.second);
-      avgcount2.set(a.second);
+      for (unsigned i = 1; i < PERF_COUNTER_STRIPES; ++i) {
+	stripes[i].u64.set(0);
+	stripes[i].avgcount.set(0);
+	stripes[i].avgcount2.set(0);
+      }
+      stripes[0].u64.set(a.first);
+      stripes[0].avgcount.set(a.second);
+      stripes[0].avgcount2.set(a.second);
       return *this;
     }
 
-    /// read <sum, count> safely
+    /// read <sum, count> safely; each stripe's pair is internally
+    /// consistent, the sum across stripes is as torn as the old
+    /// single-slot read was against concurrent writers
     pair<uint64_t,uint64_t> read_avg() const {
-      uint64_t sum, count;
-      do {
-	count = avgcount.read();
-	sum = u64.read();
-      } while (avgcount2.read() != count);
+      uint64_t sum = 0, count = 0;
+      for (unsigned i = 0; i < PERF_COUNTER_STRIPES; ++i) {
+	uint64_t s, c;
+	do {
+	  c = stripes[i].avgcount.read();
+	  s = stripes[i].u64.read();
+	} while (stripes[i].avgcount2.read() != c);
+	sum += s;
+	count += c;
+      }
       return make_pair(sum, count);
     }
   };
   typedef std::vector<perf_counter_data_any_d> perf_counter_data_vec_t;
 
+  void dump_histogram(ceph::Formatter *f, perf_counter_data_any_d &d,
+		      utime_t now);
+  void dump_hist_percentiles(ceph::Formatter *f,
+			     const perf_counter_data_any_d &d,
+			     const uint64_t *buckets);
+  static double hist_percentile(const uint64_t *buckets, uint64_t total,
+				double percentile);
+
   CephContext *m_cct;
   int m_lower_bound;
   int m_upper_bound;
@@ -253,6 +378,10 @@ public:
       const char *description=NULL, const char *nick = NULL);
   void add_time_avg(int key, const char *name,
       const char *description=NULL, const char *nick = NULL);
+  void add_u64_hist(int key, const char *name,
+      const char *description=NULL, const char *nick = NULL);
+  void add_time_hist(int key, const char *name,
+      const char *description=NULL, const char *nick = NULL);
   PerfCounters* create_perf_counters();
 private:
   PerfCountersBuilder(const PerfCountersBuilder &rhs);
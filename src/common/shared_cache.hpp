@@ -19,6 +19,7 @@
 #include <list>
 #include <memory>
 #include <utility>
+#include <vector>
 #include "common/Mutex.h"
 #include "common/Cond.h"
 #include "include/unordered_map.h"
@@ -194,13 +195,16 @@ public:
     }
   }
 
-  // Returns K key s.t. key <= k for all currently cached k,v
+  // Returns K key s.t. key <= k for all currently cached k,v; a
+  // default-constructed K if nothing is cached
   K cached_key_lower_bound() {
     Mutex::Locker l(lock);
+    if (weak_refs.empty())
+      return K();
     return weak_refs.begin()->first;
   }
 
-  VPtr lower_bound(const K& key) {
+  VPtr lower_bound(const K& key, K *actual = NULL) {
     VPtr val;
     list<VPtr> to_release;
     {
@@ -218,6 +222,8 @@ public:
 	val = i->second.first.lock();
 	if (val) {
 	  lru_add(i->first, val, &to_release);
+	  if (actual)
+	    *actual = i->first;
 	} else {
 	  retry = true;
 	}
@@ -365,4 +371,158 @@ public:
   friend class SharedLRUTest;
 };
 
+/**
+ * ShardedSharedLRU
+ *
+ * Hash-sharded wrapper around SharedLRU, in the same spirit as the
+ * FDCache registry: keys are spread over N independent SharedLRU
+ * instances so lookups and ref-drop cleanups on different keys do not
+ * funnel through a single mutex.  get_next() stitches the shards'
+ * sorted key spaces back together, so iteration still sees keys in
+ * comparator order.
+ */
+template <class K, class V, class C = std::less<K>, class H = std::hash<K> >
+class ShardedSharedLRU {
+  typedef ceph::shared_ptr<V> VPtr;
+  vector<SharedLRU<K, V, C, H>*> shards;
+  H hash;
+
+  SharedLRU<K, V, C, H> &shard(const K &key) {
+    return *shards[hash(key) % shards.size()];
+  }
+
+public:
+  ShardedSharedLRU(CephContext *cct, size_t max_size, size_t num_shards) {
+    assert(num_shards > 0);
+    size_t per_shard = std::max<size_t>(max_size / num_shards, 1);
+    for (size_t i = 0; i < num_shards; ++i)
+      shards.push_back(new SharedLRU<K, V, C, H>(cct, per_shard));
+  }
+
+  ~ShardedSharedLRU() {
+    while (!shards.empty()) {
+      delete shards.back();
+      shards.pop_back();
+    }
+  }
+
+  VPtr lookup(const K &key) {
+    return shard(key).lookup(key);
+  }
+
+  VPtr lookup_or_create(const K &key) {
+    return shard(key).lookup_or_create(key);
+  }
+
+  VPtr add(const K &key, V *value, bool *existed = NULL) {
+    return shard(key).add(key, value, existed);
+  }
+
+  void set_size(size_t max_size) {
+    size_t per_shard = std::max<size_t>(max_size / shards.size(), 1);
+    for (size_t i = 0; i < shards.size(); ++i)
+      shards[i]->set_size(per_shard);
+  }
+
+  /// smallest key currently cached by any shard; K() if all are empty
+  K cached_key_lower_bound() {
+    C comp = get_comparator();
+    K best = K();
+    bool found = false;
+    for (size_t i = 0; i < shards.size(); ++i) {
+      K candidate = shards[i]->cached_key_lower_bound();
+      if (candidate == K())   // shard is (or just became) empty
+	continue;
+      if (!found || comp(candidate, best)) {
+	best = candidate;
+	found = true;
+      }
+    }
+    return best;
+  }
+
+  /**
+   * Cross-shard equivalent of SharedLRU::lower_bound: the value at
+   * the smallest cached key >= @p key, else the value at the largest
+   * cached key.  The "nearest key" is only as precise as a racing
+   * eviction allows, which is all callers (osdmap dedup) need.
+   */
+  VPtr lower_bound(const K &key) {
+    C comp = get_comparator();
+    VPtr best_ge, best_lt;
+    K best_ge_key = K(), best_lt_key = K();
+    for (size_t i = 0; i < shards.size(); ++i) {
+      K actual = K();
+      VPtr candidate = shards[i]->lower_bound(key, &actual);
+      if (!candidate)
+	continue;
+      if (!comp(actual, key)) {   // actual >= key
+	if (!best_ge || comp(actual, best_ge_key)) {
+	  best_ge = candidate;
+	  best_ge_key = actual;
+	}
+      } else {
+	if (!best_lt || comp(best_lt_key, actual)) {
+	  best_lt = candidate;
+	  best_lt_key = actual;
+	}
+      }
+    }
+    return best_ge ? best_ge : best_lt;
+  }
+
+  void clear() {
+    for (size_t i = 0; i < shards.size(); ++i)
+      shards[i]->clear();
+  }
+
+  void clear(const K &key) {
+    shard(key).clear(key);
+  }
+
+  void purge(const K &key) {
+    shard(key).purge(key);
+  }
+
+  bool empty() {
+    for (size_t i = 0; i < shards.size(); ++i) {
+      if (!shards[i]->empty())
+	return false;
+    }
+    return true;
+  }
+
+  C get_comparator() {
+    return shards[0]->get_comparator();
+  }
+
+  void reset_comparator(C comp) {
+    for (size_t i = 0; i < shards.size(); ++i)
+      shards[i]->reset_comparator(comp);
+  }
+
+  void set_cct(CephContext *c) {
+    for (size_t i = 0; i < shards.size(); ++i)
+      shards[i]->set_cct(c);
+  }
+
+  bool get_next(const K &key, pair<K, VPtr> *next) {
+    pair<K, VPtr> best;
+    bool found = false;
+    C comp = get_comparator();
+    for (size_t i = 0; i < shards.size(); ++i) {
+      pair<K, VPtr> candidate;
+      if (shards[i]->get_next(key, &candidate)) {
+	if (!found || comp(candidate.first, best.first)) {
+	  best = candidate;
+	  found = true;
+	}
+      }
+    }
+    if (found && next)
+      *next = best;
+    return found;
+  }
+};
+
 #endif
@@ -28,6 +28,14 @@ AsyncCompressor::AsyncCompressor(CephContext *c):
   compress_wq(this, c->_conf->async_compressor_thread_timeout, c->_conf->async_compressor_thread_suicide_timeout, &compress_tp) {
 }
 
+AsyncCompressor::AsyncCompressor(CephContext *c, CompressorRef comp):
+  compressor(comp), cct(c),
+  job_id(0),
+  compress_tp(cct, "AsyncCompressor::compressor_tp", "tp_async_compr", cct->_conf->async_compressor_threads, "async_compressor_threads"),
+  job_lock("AsyncCompressor::job_lock"),
+  compress_wq(this, c->_conf->async_compressor_thread_timeout, c->_conf->async_compressor_thread_suicide_timeout, &compress_tp) {
+}
+
 void AsyncCompressor::init()
 {
   ldout(cct, 10) << __func__ << dendl;
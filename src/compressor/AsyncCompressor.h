@@ -109,6 +109,9 @@ class AsyncCompressor {
 
  public:
   explicit AsyncCompressor(CephContext *c);
+  // compress/decompress with a caller-provided compressor instead of
+  // async_compressor_type
+  AsyncCompressor(CephContext *c, CompressorRef comp);
   virtual ~AsyncCompressor() {}
 
   int get_cpuid(int id) {
@@ -0,0 +1,122 @@
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+// -----------------------------------------------------------------------------
+#include "common/debug.h"
+#include "common/config.h"
+#include "ZstdCompressor.h"
+// -----------------------------------------------------------------------------
+
+#include <zstd.h>
+
+// -----------------------------------------------------------------------------
+#define dout_subsys ceph_subsys_compressor
+#undef dout_prefix
+#define dout_prefix _prefix(_dout)
+// -----------------------------------------------------------------------------
+
+static ostream&
+_prefix(std::ostream* _dout)
+{
+  return *_dout << "ZstdCompressor: ";
+}
+// -----------------------------------------------------------------------------
+
+ZstdCompressor::ZstdCompressor()
+  : Compressor("zstd"),
+    level(g_conf->compressor_zstd_level)
+{
+  const string &path = g_conf->compressor_zstd_dict_path;
+  if (path.length()) {
+    string err;
+    if (dict.read_file(path.c_str(), &err) < 0) {
+      dout(1) << "failed to load dictionary " << path << ": " << err
+	      << ", compressing without one" << dendl;
+      dict.clear();
+    } else {
+      dout(10) << "loaded " << dict.length() << " byte dictionary from "
+	       << path << dendl;
+    }
+  }
+}
+
+int ZstdCompressor::compress(const bufferlist &in, bufferlist &out)
+{
+  bufferlist &src = const_cast<bufferlist&>(in);
+  size_t bound = ZSTD_compressBound(src.length());
+  bufferptr ptr = buffer::create_page_aligned(bound);
+
+  size_t r;
+  if (dict.length()) {
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    if (!cctx) {
+      dout(1) << "Compression error: cannot create context" << dendl;
+      return -1;
+    }
+    r = ZSTD_compress_usingDict(cctx, ptr.c_str(), bound,
+				src.c_str(), src.length(),
+				dict.c_str(), dict.length(), level);
+    ZSTD_freeCCtx(cctx);
+  } else {
+    r = ZSTD_compress(ptr.c_str(), bound, src.c_str(), src.length(), level);
+  }
+  if (ZSTD_isError(r)) {
+    dout(1) << "Compression error: " << ZSTD_getErrorName(r) << dendl;
+    return -1;
+  }
+  out.append(ptr, 0, r);
+  return 0;
+}
+
+int ZstdCompressor::decompress(const bufferlist &in, bufferlist &out)
+{
+  bufferlist::iterator i = const_cast<bufferlist&>(in).begin();
+  return decompress(i, in.length(), out);
+}
+
+int ZstdCompressor::decompress(bufferlist::iterator &p,
+			       size_t compressed_len,
+			       bufferlist &out)
+{
+  bufferlist tmp;
+  size_t remaining = MIN((size_t)p.get_remaining(), compressed_len);
+  p.copy(remaining, tmp);
+  const char *src = tmp.c_str();
+
+  unsigned long long dst_len = ZSTD_getDecompressedSize(src, tmp.length());
+  if (dst_len == 0) {
+    // only frames produced by streaming compression lack a content
+    // size, and this plugin always writes one
+    dout(1) << "Decompression error: unknown content size" << dendl;
+    return -1;
+  }
+  bufferptr ptr = buffer::create_page_aligned(dst_len);
+
+  size_t r;
+  if (dict.length()) {
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    if (!dctx) {
+      dout(1) << "Decompression error: cannot create context" << dendl;
+      return -1;
+    }
+    r = ZSTD_decompress_usingDict(dctx, ptr.c_str(), dst_len,
+				  src, tmp.length(),
+				  dict.c_str(), dict.length());
+    ZSTD_freeDCtx(dctx);
+  } else {
+    r = ZSTD_decompress(ptr.c_str(), dst_len, src, tmp.length());
+  }
+  if (ZSTD_isError(r)) {
+    dout(1) << "Decompression error: " << ZSTD_getErrorName(r) << dendl;
+    return -1;
+  }
+  out.append(ptr, 0, r);
+  return 0;
+}
@@ -1094,7 +1094,31 @@ public:
     for (int i=0; i<numrep; i++)
       out[i] = rawout[i];
   }
-  
+
+  /**
+   * run one rule against a batch of inputs
+   *
+   * Equivalent to calling do_rule() once per input, but the mapper
+   * lock is taken and the scratch area set up only once, and the rule
+   * and bucket data stay cache-hot across the whole batch.  Intended
+   * for map-wide computations that evaluate many pgs of one pool.
+   */
+  void do_rule_batch(int rule, const vector<int>& x,
+		     vector<vector<int> > *out, int maxout,
+		     const vector<__u32>& weight) const {
+    Mutex::Locker l(mapper_lock);
+    int rawout[maxout];
+    int scratch[maxout * 3];
+    out->resize(x.size());
+    for (unsigned i = 0; i < x.size(); ++i) {
+      int numrep = crush_do_rule(crush, rule, x[i], rawout, maxout,
+				 &weight[0], weight.size(), scratch);
+      if (numrep < 0)
+	numrep = 0;
+      (*out)[i].assign(rawout, rawout + numrep);
+    }
+  }
+
   bool check_crush_rule(int ruleset, int type, int size,  ostream& ss) {
    
     assert(crush);    
@@ -21,6 +21,7 @@
 # include "crush_compat.h"
 # include "crush.h"
 # include "hash.h"
+# include "mapper_simd.h"
 #endif
 #include "crush_ln_table.h"
 
@@ -302,6 +303,11 @@ static int bucket_straw2_choose(struct crush_bucket_straw2 *bucket,
 	unsigned int w;
 	__s64 ln, draw, high_draw = 0;
 
+#ifndef __KERNEL__
+	if (crush_straw2_avx2_usable(&bucket->h))
+		return crush_straw2_choose_avx2(bucket, x, r);
+#endif
+
 	for (i = 0; i < bucket->h.size; i++) {
 		w = bucket->item_weights[i];
 		if (w) {
@@ -0,0 +1,257 @@
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2016 Inktank Storage, Inc.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "crush_compat.h"
+#include "mapper_simd.h"
+#include "hash.h"
+#include "arch/intel.h"
+
+/*
+ * AVX2 straw2 selection.
+ *
+ * bucket_straw2_choose() in mapper.c hashes every item and walks the
+ * fixed-point log table once per item per replica; for wide buckets
+ * this is the hottest function in the mapper.  Here the jenkins hash
+ * and the log evaluation run eight items at a time; only the final
+ * divide by the 16.16 weight and the argmax stay scalar, so the
+ * result is bit-identical to the scalar loop (which it must be --
+ * placement depends on it).
+ *
+ * The hash mix, seed and log computation are frozen, wire-visible
+ * algorithms duplicated from hash.c and mapper.c; they must never
+ * change there or here independently.
+ */
+
+#if defined(__x86_64__) && \
+	((defined(__GNUC__) && __GNUC__ >= 5) || defined(__clang__))
+# define HAVE_STRAW2_AVX2 1
+#endif
+
+#ifdef HAVE_STRAW2_AVX2
+
+#include <immintrin.h>
+#include "crush_ln_table.h"
+
+/* must match crush_hash_seed and crush_hashmix() in hash.c */
+#define STRAW2_HASH_SEED 1315423911
+
+#define VEC_HASHMIX(a, b, c) do {					\
+	a = _mm256_sub_epi32(a, b);  a = _mm256_sub_epi32(a, c);	\
+	a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 13));		\
+	b = _mm256_sub_epi32(b, c);  b = _mm256_sub_epi32(b, a);	\
+	b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 8));		\
+	c = _mm256_sub_epi32(c, a);  c = _mm256_sub_epi32(c, b);	\
+	c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 13));		\
+	a = _mm256_sub_epi32(a, b);  a = _mm256_sub_epi32(a, c);	\
+	a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 12));		\
+	b = _mm256_sub_epi32(b, c);  b = _mm256_sub_epi32(b, a);	\
+	b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 16));		\
+	c = _mm256_sub_epi32(c, a);  c = _mm256_sub_epi32(c, b);	\
+	c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 5));		\
+	a = _mm256_sub_epi32(a, b);  a = _mm256_sub_epi32(a, c);	\
+	a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 3));		\
+	b = _mm256_sub_epi32(b, c);  b = _mm256_sub_epi32(b, a);	\
+	b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 10));		\
+	c = _mm256_sub_epi32(c, a);  c = _mm256_sub_epi32(c, b);	\
+	c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 15));		\
+} while (0)
+
+/* identical to crush_ln() in mapper.c; used for the tail items */
+static __u64 crush_ln_scalar(unsigned int xin)
+{
+	unsigned int x = xin, x1;
+	int iexpon, index1, index2;
+	__u64 RH, LH, LL, xl64, result;
+
+	x++;
+
+	/* normalize input */
+	iexpon = 15;
+	while (!(x & 0x18000)) {
+		x <<= 1;
+		iexpon--;
+	}
+
+	index1 = (x >> 8) << 1;
+	/* RH ~ 2^56/index1 */
+	RH = __RH_LH_tbl[index1 - 256];
+	/* LH ~ 2^48 * log2(index1/256) */
+	LH = __RH_LH_tbl[index1 + 1 - 256];
+
+	/* RH*x ~ 2^48 * (2^15 + xf), xf<2^8 */
+	xl64 = (__s64)x * RH;
+	xl64 >>= 48;
+	x1 = xl64;
+
+	result = iexpon;
+	result <<= (12 + 32);
+
+	index2 = x1 & 0xff;
+	/* LL ~ 2^48*log2(1.0+index2/2^15) */
+	LL = __LL_tbl[index2];
+
+	LH = LH + LL;
+
+	LH >>= (48 - 12 - 32);
+	result += LH;
+
+	return result;
+}
+
+/*
+ * the 64-bit half of crush_ln() for four lanes: table gathers, the
+ * RH refinement multiply, and the final assembly of the result
+ */
+__attribute__((target("avx2")))
+static inline void straw2_ln_4(__m128i idx4, __m128i xn4, __m128i iexp4,
+			       __s64 *out)
+{
+	__m256i idx64 = _mm256_cvtepu32_epi64(idx4);
+	__m256i xn64 = _mm256_cvtepu32_epi64(xn4);
+	__m256i iexp64 = _mm256_cvtepu32_epi64(iexp4);
+	__m256i rh = _mm256_i64gather_epi64(
+		(const long long *)__RH_LH_tbl, idx64, 8);
+	__m256i lh = _mm256_i64gather_epi64(
+		(const long long *)__RH_LH_tbl,
+		_mm256_add_epi64(idx64, _mm256_set1_epi64x(1)), 8);
+	/* xn * rh: 17 bits by 56 bits, assembled from 32x32 products */
+	__m256i lo = _mm256_mul_epu32(rh, xn64);
+	__m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(rh, 32), xn64);
+	__m256i xl = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+	__m256i idx2 = _mm256_and_si256(_mm256_srli_epi64(xl, 48),
+					_mm256_set1_epi64x(0xff));
+	__m256i ll = _mm256_i64gather_epi64(
+		(const long long *)__LL_tbl, idx2, 8);
+	__m256i res = _mm256_add_epi64(
+		_mm256_slli_epi64(iexp64, 44),
+		_mm256_srli_epi64(_mm256_add_epi64(lh, ll), 4));
+
+	/* shift into [-2^48, 0), matching the scalar draw */
+	res = _mm256_sub_epi64(res, _mm256_set1_epi64x(0x1000000000000ll));
+	_mm256_storeu_si256((__m256i *)out, res);
+}
+
+/* crush_ln(u[lane]) - 2^48 for eight lanes of u in [0, 0xffff] */
+__attribute__((target("avx2")))
+static inline void straw2_ln_8(__m256i u, __s64 *lns)
+{
+	__m256i xv = _mm256_add_epi32(u, _mm256_set1_epi32(1));
+	/* floor(log2(x)) via the float exponent; exact for x <= 2^16 */
+	__m256i fexp = _mm256_castps_si256(_mm256_cvtepi32_ps(xv));
+	__m256i msb = _mm256_sub_epi32(_mm256_srli_epi32(fexp, 23),
+				       _mm256_set1_epi32(127));
+	/* normalize so bit 15 (or 16) is the top set bit */
+	__m256i shift = _mm256_max_epi32(
+		_mm256_sub_epi32(_mm256_set1_epi32(15), msb),
+		_mm256_setzero_si256());
+	__m256i iexpon = _mm256_sub_epi32(_mm256_set1_epi32(15), shift);
+	__m256i xn = _mm256_sllv_epi32(xv, shift);
+	__m256i idx = _mm256_sub_epi32(
+		_mm256_slli_epi32(_mm256_srli_epi32(xn, 8), 1),
+		_mm256_set1_epi32(256));
+
+	straw2_ln_4(_mm256_castsi256_si128(idx),
+		    _mm256_castsi256_si128(xn),
+		    _mm256_castsi256_si128(iexpon), lns);
+	straw2_ln_4(_mm256_extracti128_si256(idx, 1),
+		    _mm256_extracti128_si256(xn, 1),
+		    _mm256_extracti128_si256(iexpon, 1), lns + 4);
+}
+
+int crush_straw2_avx2_usable(const struct crush_bucket *h)
+{
+	return ceph_arch_intel_avx2 &&
+		h->hash == CRUSH_HASH_RJENKINS1 &&
+		h->size >= 8;
+}
+
+__attribute__((target("avx2")))
+int crush_straw2_choose_avx2(const struct crush_bucket_straw2 *bucket,
+			     int x, int r)
+{
+	unsigned int size = bucket->h.size;
+	unsigned int n = size & ~7u;
+	unsigned int i, j, high = 0;
+	unsigned int u, w;
+	__s64 ln, draw, high_draw = 0;
+	__s64 lns[8];
+
+	for (i = 0; i < n; i += 8) {
+		__m256i vb = _mm256_loadu_si256(
+			(const __m256i *)&bucket->h.items[i]);
+		__m256i va = _mm256_set1_epi32(x);
+		__m256i vc = _mm256_set1_epi32(r);
+		__m256i vh = _mm256_xor_si256(
+			_mm256_set1_epi32(STRAW2_HASH_SEED),
+			_mm256_xor_si256(_mm256_xor_si256(va, vb), vc));
+		__m256i vx = _mm256_set1_epi32(231232);
+		__m256i vy = _mm256_set1_epi32(1232);
+
+		/* crush_hash32_rjenkins1_3(), eight items at a time */
+		VEC_HASHMIX(va, vb, vh);
+		VEC_HASHMIX(vc, vx, vh);
+		VEC_HASHMIX(vy, va, vh);
+		VEC_HASHMIX(vb, vx, vh);
+		VEC_HASHMIX(vy, vc, vh);
+
+		straw2_ln_8(_mm256_and_si256(vh, _mm256_set1_epi32(0xffff)),
+			    lns);
+
+		for (j = 0; j < 8; j++) {
+			w = bucket->item_weights[i + j];
+			if (w)
+				draw = div64_s64(lns[j], w);
+			else
+				draw = S64_MIN;
+			if ((i + j) == 0 || draw > high_draw) {
+				high = i + j;
+				high_draw = draw;
+			}
+		}
+	}
+
+	/* tail items, scalar */
+	for (; i < size; i++) {
+		w = bucket->item_weights[i];
+		if (w) {
+			u = crush_hash32_3(bucket->h.hash, x,
+					   bucket->h.items[i], r);
+			u &= 0xffff;
+			ln = crush_ln_scalar(u) - 0x1000000000000ll;
+			draw = div64_s64(ln, w);
+		} else {
+			draw = S64_MIN;
+		}
+
+		if (i == 0 || draw > high_draw) {
+			high = i;
+			high_draw = draw;
+		}
+	}
+	return bucket->h.items[high];
+}
+
+#else /* HAVE_STRAW2_AVX2 */
+
+int crush_straw2_avx2_usable(const struct crush_bucket *h)
+{
+	return 0;
+}
+
+int crush_straw2_choose_avx2(const struct crush_bucket_straw2 *bucket,
+			     int x, int r)
+{
+	/* not reached; crush_straw2_avx2_usable() is always false here */
+	return bucket->h.items[0];
+}
+
+#endif /* HAVE_STRAW2_AVX2 */
@@ -0,0 +1,40 @@
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2016 Inktank Storage, Inc.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_CRUSH_MAPPER_SIMD_H
+#define CEPH_CRUSH_MAPPER_SIMD_H
+
+#include "crush.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Optional vectorized straw2 bucket selection.
+ *
+ * crush_straw2_choose_avx2() picks exactly the same item the scalar
+ * loop in mapper.c would; the draws are computed eight items at a
+ * time over the fixed-point log table.  Callers must check
+ * crush_straw2_avx2_usable() first, which tests the runtime cpu
+ * probe, the bucket's hash type, and whether the bucket is wide
+ * enough to be worth the setup.
+ */
+extern int crush_straw2_avx2_usable(const struct crush_bucket *h);
+extern int crush_straw2_choose_avx2(const struct crush_bucket_straw2 *bucket,
+				    int x, int r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -127,6 +127,38 @@ int ErasureCode::encode(const set<int> &want_to_encode,
   return 0;
 }
 
+int ErasureCode::encode_scatter(const set<int> &want_to_encode,
+                                const bufferlist &in,
+                                map<int, bufferlist> *encoded)
+{
+  unsigned int k = get_data_chunk_count();
+  unsigned int m = get_chunk_count() - k;
+  unsigned blocksize = get_chunk_size(in.length());
+  assert(in.length() == blocksize * k);
+  bufferlist prepared = in;
+
+  for (unsigned int i = 0; i < k; i++) {
+    bufferlist &chunk = (*encoded)[chunk_index(i)];
+    chunk.substr_of(prepared, i * blocksize, blocksize);
+    chunk.rebuild_aligned_size_and_memory(blocksize, SIMD_ALIGN);
+    assert(chunk.is_contiguous());
+  }
+  for (unsigned int i = k; i < k + m; i++) {
+    map<int, bufferlist>::iterator chunk = encoded->find(chunk_index(i));
+    assert(chunk != encoded->end());
+    assert(chunk->second.length() == blocksize);
+    assert(chunk->second.is_contiguous());
+  }
+  int err = encode_chunks(want_to_encode, encoded);
+  if (err)
+    return err;
+  for (unsigned int i = 0; i < k + m; i++) {
+    if (want_to_encode.count(i) == 0)
+      encoded->erase(i);
+  }
+  return 0;
+}
+
 int ErasureCode::encode_chunks(const set<int> &want_to_encode,
                                map<int, bufferlist> *encoded)
 {
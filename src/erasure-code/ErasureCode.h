@@ -67,6 +67,10 @@ namespace ceph {
                        const bufferlist &in,
                        map<int, bufferlist> *encoded);
 
+    virtual int encode_scatter(const set<int> &want_to_encode,
+                               const bufferlist &in,
+                               map<int, bufferlist> *encoded);
+
     virtual int encode_chunks(const set<int> &want_to_encode,
                               map<int, bufferlist> *encoded);
 
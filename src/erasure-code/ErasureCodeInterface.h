@@ -355,6 +355,36 @@ namespace ceph {
                        const bufferlist &in,
                        map<int, bufferlist> *encoded) = 0;
 
+    /**
+     * Encode the content of **in** like **encode** does, but scatter
+     * the coding chunks directly into buffers provided by the caller
+     * instead of allocating them.
+     *
+     * On entry the **encoded** map must contain one entry for each
+     * coding chunk index: a contiguous buffer of
+     * get_chunk_size(in.length()) bytes, aligned as required by the
+     * implementation, which is written in place. The caller may carve
+     * these buffers out of the memory that will back the messages or
+     * transactions carrying the chunks, so that no intermediate copy
+     * of the coding chunks is made.
+     *
+     * The data chunk entries are created by the method and point into
+     * the **in** parameter whenever its memory layout allows it: the
+     * caller must not modify **in** afterwards. **in** must contain
+     * exactly get_data_chunk_count() * get_chunk_size(in.length())
+     * bytes, i.e. the caller is responsible for padding.
+     *
+     * Chunks not listed in **want_to_encode** are removed from
+     * **encoded** before returning, as with **encode**.
+     *
+     * @param [in] want_to_encode chunk indexes to be encoded
+     * @param [in] in data to be encoded, padded to a full stripe
+     * @param [in,out] encoded map chunk indexes to chunk data
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_scatter(const set<int> &want_to_encode,
+                               const bufferlist &in,
+                               map<int, bufferlist> *encoded) = 0;
 
     virtual int encode_chunks(const set<int> &want_to_encode,
                               map<int, bufferlist> *encoded) = 0;
@@ -115,6 +115,11 @@ namespace buffer CEPH_BUFFER_API {
   /// enable/disable tracking of cached crcs
   void track_cached_crc(bool b);
 
+  /// count of aligned allocations served from the per-thread pool
+  uint64_t get_aligned_pool_hits();
+  /// count of aligned allocations that fell through to the heap
+  uint64_t get_aligned_pool_misses();
+
   /// count of calls to buffer::ptr::c_str()
   int get_c_str_accesses();
   /// enable/disable tracking of buffer::ptr::c_str() calls
@@ -264,6 +269,8 @@ namespace buffer CEPH_BUFFER_API {
     unsigned _memcopy_count; //the total of memcopy using rebuild().
     ptr append_buffer;  // where i put small appends.
 
+    unsigned append_buffer_next_alloc() const;
+
   public:
     class iterator;
 
@@ -550,6 +557,7 @@ namespace buffer CEPH_BUFFER_API {
     void copy_in(unsigned off, unsigned len, const char *src, bool crc_reset);
     void copy_in(unsigned off, unsigned len, const list& src);
 
+    void reserve(size_t prealloc);
     void append(char c);
     void append(const char *data, unsigned len);
     void append(const std::string& s) {
@@ -304,7 +304,8 @@ enum {
 	CEPH_SESSION_FORCE_RO,
     // A response to REQUEST_OPEN indicating that the client should
     // permanently desist from contacting the MDS
-	CEPH_SESSION_REJECT
+	CEPH_SESSION_REJECT,
+	CEPH_SESSION_REQUEST_FLUSH_MDLOG
 };
 
 extern const char *ceph_session_op_name(int op);
@@ -287,6 +287,29 @@ inline void decode(T &o, bufferlist& bl)
 }
 
 
+// -----------------------------
+// two-phase encode support
+//
+// A hot encoder can first compute a cheap upper bound on its encoded
+// size, bl.reserve() the whole thing, and then encode into a single
+// preallocated buffer with no reallocation mid-stream.  These mirror
+// the encode() arithmetic for common leaf types; composite types add
+// an estimate_encoded_size() member next to encode().  Estimates only
+// need to be upper bounds, never exact.
+
+// struct_v + struct_compat + length, as written by ENCODE_START
+#define ENCODE_HEADER_SIZE (2 * sizeof(__u8) + sizeof(__u32))
+
+inline size_t estimate_encoded_size(const std::string& s)
+{
+  return sizeof(__u32) + s.size();
+}
+inline size_t estimate_encoded_size(const bufferlist& bl)
+{
+  return sizeof(__u32) + bl.length();
+}
+
+
 // -----------------------------
 // STL container types
 
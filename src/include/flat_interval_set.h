@@ -0,0 +1,590 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2004-2006 Sage Weil <sage@newdream.net>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_FLAT_INTERVAL_SET_H
+#define CEPH_FLAT_INTERVAL_SET_H
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <ostream>
+
+#include "encoding.h"
+#include "assert.h"
+
+#ifndef MIN
+# define MIN(a,b)  ((a)<=(b) ? (a):(b))
+#endif
+#ifndef MAX
+# define MAX(a,b)  ((a)>=(b) ? (a):(b))
+#endif
+
+/*
+ * interval_set backed by a flat sorted vector instead of std::map.
+ *
+ * Sets that are built up, scanned and thrown away at high rate (the
+ * recovery/backfill push structures) pay a map node allocation per
+ * interval and chase pointers on every scan; here the intervals are
+ * contiguous in memory, so building and walking a typical set of a
+ * handful of extents touches one cache line and does a single
+ * allocation.  Mutations in the middle are O(n) memmoves, which is
+ * the right trade for small n.
+ *
+ * The encoding is identical to interval_set<T> (count + sorted
+ * (start, len) pairs), so a flat set can replace a map-backed one in
+ * wire or disk structures without a compat change.  The set
+ * operations (insert, subtract, intersection_of, union_of, subset_of,
+ * span_of) are templated on the other set's type and only require
+ * const_iterators with get_start()/get_len(), so they interoperate
+ * with interval_set<T> and btree_interval_set<T>.
+ */
+template<typename T>
+class flat_interval_set {
+ public:
+  typedef std::vector<std::pair<T,T> > map_t;
+
+  class const_iterator;
+
+  class iterator : public std::iterator <std::forward_iterator_tag, T>
+  {
+    public:
+        explicit iterator(typename map_t::iterator iter)
+          : _iter(iter)
+        { }
+
+        bool operator==(const iterator& rhs) const {
+          return (_iter == rhs._iter);
+        }
+
+        bool operator!=(const iterator& rhs) const {
+          return (_iter != rhs._iter);
+        }
+
+        // Dereference this iterator to get a pair.
+        std::pair < T, T > &operator*() {
+                return *_iter;
+        }
+
+        // Return the interval start.
+        T get_start() const {
+                return _iter->first;
+        }
+
+        // Return the interval length.
+        T get_len() const {
+                return _iter->second;
+        }
+
+        // Set the interval length.
+        void set_len(T len) {
+                _iter->second = len;
+        }
+
+        // Preincrement
+        iterator &operator++()
+        {
+                ++_iter;
+                return *this;
+        }
+
+        // Postincrement
+        iterator operator++(int)
+        {
+                iterator prev(_iter);
+                ++_iter;
+                return prev;
+        }
+
+    friend class flat_interval_set<T>::const_iterator;
+
+    protected:
+        typename map_t::iterator _iter;
+    friend class flat_interval_set<T>;
+  };
+
+  class const_iterator : public std::iterator <std::forward_iterator_tag, T>
+  {
+    public:
+        explicit const_iterator(typename map_t::const_iterator iter)
+          : _iter(iter)
+        { }
+
+        const_iterator(const iterator &i)
+	  : _iter(i._iter)
+        { }
+
+        bool operator==(const const_iterator& rhs) const {
+          return (_iter == rhs._iter);
+        }
+
+        bool operator!=(const const_iterator& rhs) const {
+          return (_iter != rhs._iter);
+        }
+
+        // Dereference this iterator to get a pair.
+        std::pair < T, T > operator*() const {
+                return *_iter;
+        }
+
+        // Return the interval start.
+        T get_start() const {
+                return _iter->first;
+        }
+
+        // Return the interval length.
+        T get_len() const {
+                return _iter->second;
+        }
+
+        // Preincrement
+        const_iterator &operator++()
+        {
+                ++_iter;
+                return *this;
+        }
+
+        // Postincrement
+        const_iterator operator++(int)
+        {
+                const_iterator prev(_iter);
+                ++_iter;
+                return prev;
+        }
+
+    protected:
+        typename map_t::const_iterator _iter;
+  };
+
+  flat_interval_set() : _size(0) {}
+
+  int num_intervals() const
+  {
+    return m.size();
+  }
+
+  iterator begin() {
+    return iterator(m.begin());
+  }
+
+  iterator lower_bound(T start) {
+    return iterator(find_inc(start));
+  }
+
+  iterator end() {
+    return iterator(m.end());
+  }
+
+  const_iterator begin() const {
+    return const_iterator(m.begin());
+  }
+
+  const_iterator lower_bound(T start) const {
+    return const_iterator(find_inc(start));
+  }
+
+  const_iterator end() const {
+    return const_iterator(m.end());
+  }
+
+  // helpers
+ private:
+  static bool start_cmp(const std::pair<T,T>& p, T start) {
+    return p.first < start;
+  }
+
+  // first interval that contains or starts after @start
+  typename map_t::iterator find_inc(T start) {
+    typename map_t::iterator p =
+      std::lower_bound(m.begin(), m.end(), start, start_cmp);
+    if (p != m.begin() &&
+        (p == m.end() || p->first > start)) {
+      p--;   // might overlap?
+      if (p->first + p->second <= start)
+        p++; // it doesn't.
+    }
+    return p;
+  }
+
+  typename map_t::const_iterator find_inc(T start) const {
+    typename map_t::const_iterator p =
+      std::lower_bound(m.begin(), m.end(), start, start_cmp);
+    if (p != m.begin() &&
+        (p == m.end() || p->first > start)) {
+      p--;   // might overlap?
+      if (p->first + p->second <= start)
+        p++; // it doesn't.
+    }
+    return p;
+  }
+
+  // first interval that contains, touches, or starts after @start
+  typename map_t::iterator find_adj(T start) {
+    typename map_t::iterator p =
+      std::lower_bound(m.begin(), m.end(), start, start_cmp);
+    if (p != m.begin() &&
+        (p == m.end() || p->first > start)) {
+      p--;   // might touch?
+      if (p->first + p->second < start)
+        p++; // it doesn't.
+    }
+    return p;
+  }
+
+ public:
+  bool operator==(const flat_interval_set& other) const {
+    return _size == other._size && m == other.m;
+  }
+
+  int size() const {
+    return _size;
+  }
+
+  void encode(bufferlist& bl) const {
+    // identical to the map<T,T> encoding of interval_set
+    ::encode(m, bl);
+  }
+  void encode_nohead(bufferlist& bl) const {
+    ::encode_nohead(m, bl);
+  }
+  void decode(bufferlist::iterator& bl) {
+    ::decode(m, bl);
+    _size = 0;
+    for (typename map_t::const_iterator p = m.begin();
+         p != m.end();
+         p++)
+      _size += p->second;
+  }
+  void decode_nohead(int n, bufferlist::iterator& bl) {
+    ::decode_nohead(n, m, bl);
+    _size = 0;
+    for (typename map_t::const_iterator p = m.begin();
+         p != m.end();
+         p++)
+      _size += p->second;
+  }
+
+  void clear() {
+    m.clear();
+    _size = 0;
+  }
+
+  bool contains(T i, T *pstart=0, T *plen=0) const {
+    typename map_t::const_iterator p = find_inc(i);
+    if (p == m.end()) return false;
+    if (p->first > i) return false;
+    if (p->first+p->second <= i) return false;
+    assert(p->first <= i && p->first+p->second > i);
+    if (pstart)
+      *pstart = p->first;
+    if (plen)
+      *plen = p->second;
+    return true;
+  }
+  bool contains(T start, T len) const {
+    typename map_t::const_iterator p = find_inc(start);
+    if (p == m.end()) return false;
+    if (p->first > start) return false;
+    if (p->first+p->second <= start) return false;
+    assert(p->first <= start && p->first+p->second > start);
+    if (p->first+p->second < start+len) return false;
+    return true;
+  }
+  bool intersects(T start, T len) const {
+    flat_interval_set a;
+    a.insert(start, len);
+    flat_interval_set i;
+    i.intersection_of( *this, a );
+    if (i.empty()) return false;
+    return true;
+  }
+
+  // outer range of set
+  bool empty() const {
+    return m.empty();
+  }
+  T range_start() const {
+    assert(!empty());
+    return m.front().first;
+  }
+  T range_end() const {
+    assert(!empty());
+    return m.back().first + m.back().second;
+  }
+
+  // interval start after p (where p not in set)
+  bool starts_after(T i) const {
+    assert(!contains(i));
+    typename map_t::const_iterator p = find_inc(i);
+    if (p == m.end()) return false;
+    return true;
+  }
+  T start_after(T i) const {
+    assert(!contains(i));
+    typename map_t::const_iterator p = find_inc(i);
+    return p->first;
+  }
+
+  // interval end that contains start
+  T end_after(T start) const {
+    assert(contains(start));
+    typename map_t::const_iterator p = find_inc(start);
+    return p->first+p->second;
+  }
+
+  void insert(T val) {
+    insert(val, 1);
+  }
+
+  void insert(T start, T len, T *pstart=0, T *plen=0) {
+    assert(len > 0);
+    _size += len;
+    typename map_t::iterator p = find_adj(start);
+    if (p == m.end()) {
+      m.push_back(std::make_pair(start, len));   // new interval
+      if (pstart)
+	*pstart = start;
+      if (plen)
+	*plen = len;
+    } else {
+      if (p->first < start) {
+        assert(p->first + p->second == start);
+        p->second += len;               // append to end
+
+        typename map_t::iterator n = p + 1;
+        if (n != m.end() &&
+            start+len == n->first) {   // combine with next, too!
+          p->second += n->second;
+          m.erase(n);
+        }
+	if (pstart)
+	  *pstart = p->first;
+	if (plen)
+	  *plen = p->second;
+      } else {
+        if (start+len == p->first) {
+          p->first = start;            // append to front
+          p->second += len;
+	  if (pstart)
+	    *pstart = start;
+	  if (plen)
+	    *plen = p->second;
+        } else {
+          assert(p->first > start+len);
+          m.insert(p, std::make_pair(start, len));  // new interval
+	  if (pstart)
+	    *pstart = start;
+	  if (plen)
+	    *plen = len;
+        }
+      }
+    }
+  }
+
+  void swap(flat_interval_set<T>& other) {
+    m.swap(other.m);
+    std::swap(_size, other._size);
+  }
+
+  // erase the interval under i; unlike the map-backed erase this
+  // follows the vector idiom and returns the iterator to the next
+  // interval, since erasing invalidates everything after i.
+  iterator erase(const iterator &i) {
+    _size -= i.get_len();
+    assert(_size >= 0);
+    return iterator(m.erase(i._iter));
+  }
+
+  void erase(T val) {
+    erase(val, 1);
+  }
+
+  void erase(T start, T len) {
+    typename map_t::iterator p = find_inc(start);
+
+    _size -= len;
+    assert(_size >= 0);
+
+    assert(p != m.end());
+    assert(p->first <= start);
+
+    T before = start - p->first;
+    assert(p->second >= before+len);
+    T after = p->second - before - len;
+
+    if (before) {
+      p->second = before;        // shorten bit before
+      if (after)
+	m.insert(p + 1, std::make_pair(start + len, after));
+    } else {
+      if (after) {
+	p->first = start + len;
+	p->second = after;
+      } else {
+	m.erase(p);
+      }
+    }
+  }
+
+  template<typename S>
+  void subtract(const S &a) {
+    for (typename S::const_iterator p = a.begin();
+         p != a.end();
+         ++p)
+      erase(p.get_start(), p.get_len());
+  }
+
+  // the extra template parameter keeps this overload from capturing
+  // the scalar insert(T) calls above
+  template<typename S, typename = typename S::const_iterator>
+  void insert(const S &a) {
+    for (typename S::const_iterator p = a.begin();
+         p != a.end();
+         ++p)
+      insert(p.get_start(), p.get_len());
+  }
+
+  template<typename S1, typename S2>
+  void intersection_of(const S1 &a, const S2 &b) {
+    assert((const void*)&a != (const void*)this);
+    assert((const void*)&b != (const void*)this);
+    clear();
+
+    typename S1::const_iterator pa = a.begin();
+    typename S2::const_iterator pb = b.begin();
+
+    while (pa != a.end() && pb != b.end()) {
+      // passing?
+      if (pa.get_start() + pa.get_len() <= pb.get_start())
+        { ++pa;  continue; }
+      if (pb.get_start() + pb.get_len() <= pa.get_start())
+        { ++pb;  continue; }
+      T start = MAX(pa.get_start(), pb.get_start());
+      T en = MIN(pa.get_start()+pa.get_len(), pb.get_start()+pb.get_len());
+      assert(en > start);
+      insert(start, en-start);
+      if (pa.get_start()+pa.get_len() > pb.get_start()+pb.get_len())
+        ++pb;
+      else
+        ++pa;
+    }
+  }
+  template<typename S>
+  void intersection_of(const S& b) {
+    flat_interval_set a;
+    swap(a);
+    intersection_of(a, b);
+  }
+
+  template<typename S1, typename S2>
+  void union_of(const S1 &a, const S2 &b) {
+    assert((const void*)&a != (const void*)this);
+    assert((const void*)&b != (const void*)this);
+    clear();
+
+    // a - (a*b)
+    flat_interval_set ab;
+    ab.intersection_of(a, b);
+    insert(a);
+    subtract(ab);
+
+    // + b
+    insert(b);
+  }
+  template<typename S>
+  void union_of(const S &b) {
+    flat_interval_set a;
+    swap(a);
+    union_of(a, b);
+  }
+
+  template<typename S>
+  bool subset_of(const S &big) const {
+    for (typename map_t::const_iterator i = m.begin();
+         i != m.end();
+         i++)
+      if (!big.contains(i->first, i->second)) return false;
+    return true;
+  }
+
+  /*
+   * build a subset of @other, starting at or after @start, and including
+   * @len worth of values, skipping holes.  e.g.,
+   *  span_of([5~10,20~5], 8, 5) -> [8~2,20~3]
+   */
+  template<typename S>
+  void span_of(const S &other, T start, T len) {
+    clear();
+    typename S::const_iterator p = other.lower_bound(start);
+    if (p == other.end())
+      return;
+    if (p.get_start() < start) {
+      if (p.get_start() + p.get_len() < start)
+	return;
+      if (p.get_start() + p.get_len() < start + len) {
+	T howmuch = p.get_len() - (start - p.get_start());
+	insert(start, howmuch);
+	len -= howmuch;
+	++p;
+      } else {
+	insert(start, len);
+	return;
+      }
+    }
+    while (p != other.end() && len > 0) {
+      if (p.get_len() < len) {
+	insert(p.get_start(), p.get_len());
+	len -= p.get_len();
+	++p;
+      } else {
+	insert(p.get_start(), len);
+	return;
+      }
+    }
+  }
+
+private:
+  // data
+  int64_t _size;
+  map_t m;   // sorted (start, len) pairs
+};
+
+
+template<class T>
+inline std::ostream& operator<<(std::ostream& out, const flat_interval_set<T> &s) {
+  out << "[";
+  const char *prequel = "";
+  for (typename flat_interval_set<T>::const_iterator i = s.begin();
+       i != s.end();
+       ++i)
+  {
+    out << prequel << i.get_start() << "~" << i.get_len();
+    prequel = ",";
+  }
+  out << "]";
+  return out;
+}
+
+template<class T>
+inline void encode(const flat_interval_set<T>& s, bufferlist& bl)
+{
+  s.encode(bl);
+}
+template<class T>
+inline void decode(flat_interval_set<T>& s, bufferlist::iterator& p)
+{
+  s.decode(p);
+}
+
+#endif
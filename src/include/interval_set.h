@@ -18,6 +18,7 @@
 
 #include <iterator>
 #include <map>
+#include <memory>
 #include <ostream>
 
 #include "encoding.h"
@@ -156,23 +157,23 @@ class interval_set {
 
   int num_intervals() const
   {
-    return m.size();
+    return read().size();
   }
 
   typename interval_set<T>::iterator begin() {
-    return typename interval_set<T>::iterator(m.begin());
+    return typename interval_set<T>::iterator(write().begin());
   }
 
   typename interval_set<T>::iterator lower_bound(T start) {
-    return typename interval_set<T>::iterator(find_inc_m(start));
+    return typename interval_set<T>::iterator(find_inc_m(write(), start));
   }
 
   typename interval_set<T>::iterator end() {
-    return typename interval_set<T>::iterator(m.end());
+    return typename interval_set<T>::iterator(write().end());
   }
 
   typename interval_set<T>::const_iterator begin() const {
-    return typename interval_set<T>::const_iterator(m.begin());
+    return typename interval_set<T>::const_iterator(read().begin());
   }
 
   typename interval_set<T>::const_iterator lower_bound(T start) const {
@@ -180,58 +181,82 @@ class interval_set {
   }
 
   typename interval_set<T>::const_iterator end() const {
-    return typename interval_set<T>::const_iterator(m.end());
+    return typename interval_set<T>::const_iterator(read().end());
   }
 
   // helpers
  private:
+  // The interval map is shared copy-on-write: copying an interval_set
+  // just bumps a ref on the map, and the first mutation of a shared
+  // set (including any non-const iterator access) detaches a private
+  // copy.  This makes copying a large set (e.g. a SnapSet full of
+  // clone_overlap maps) O(1).  The usual CoW caveat applies: a
+  // non-const iterator is invalidated if the set is copied while the
+  // iterator is live.
+  static const std::map<T,T>& empty_map() {
+    static const std::map<T,T> e;
+    return e;
+  }
+  const std::map<T,T>& read() const {
+    return m ? *m : empty_map();
+  }
+  std::map<T,T>& write() {
+    if (!m)
+      m = std::make_shared<std::map<T,T> >();
+    else if (!m.unique())
+      m = std::make_shared<std::map<T,T> >(*m);
+    return *m;
+  }
+
   typename std::map<T,T>::const_iterator find_inc(T start) const {
-    typename std::map<T,T>::const_iterator p = m.lower_bound(start);  // p->first >= start
-    if (p != m.begin() &&
-        (p == m.end() || p->first > start)) {
+    const std::map<T,T>& mm = read();
+    typename std::map<T,T>::const_iterator p = mm.lower_bound(start);  // p->first >= start
+    if (p != mm.begin() &&
+        (p == mm.end() || p->first > start)) {
       p--;   // might overlap?
       if (p->first + p->second <= start)
         p++; // it doesn't.
     }
     return p;
   }
-  
-  typename std::map<T,T>::iterator find_inc_m(T start) {
-    typename std::map<T,T>::iterator p = m.lower_bound(start);
-    if (p != m.begin() &&
-        (p == m.end() || p->first > start)) {
+
+  static typename std::map<T,T>::iterator find_inc_m(std::map<T,T>& mm, T start) {
+    typename std::map<T,T>::iterator p = mm.lower_bound(start);
+    if (p != mm.begin() &&
+        (p == mm.end() || p->first > start)) {
       p--;   // might overlap?
       if (p->first + p->second <= start)
         p++; // it doesn't.
     }
     return p;
   }
-  
+
   typename std::map<T,T>::const_iterator find_adj(T start) const {
-    typename std::map<T,T>::const_iterator p = m.lower_bound(start);
-    if (p != m.begin() &&
-        (p == m.end() || p->first > start)) {
+    const std::map<T,T>& mm = read();
+    typename std::map<T,T>::const_iterator p = mm.lower_bound(start);
+    if (p != mm.begin() &&
+        (p == mm.end() || p->first > start)) {
       p--;   // might touch?
       if (p->first + p->second < start)
         p++; // it doesn't.
     }
     return p;
   }
-  
-  typename std::map<T,T>::iterator find_adj_m(T start) {
-    typename std::map<T,T>::iterator p = m.lower_bound(start);
-    if (p != m.begin() &&
-        (p == m.end() || p->first > start)) {
+
+  static typename std::map<T,T>::iterator find_adj_m(std::map<T,T>& mm, T start) {
+    typename std::map<T,T>::iterator p = mm.lower_bound(start);
+    if (p != mm.begin() &&
+        (p == mm.end() || p->first > start)) {
       p--;   // might touch?
       if (p->first + p->second < start)
         p++; // it doesn't.
     }
     return p;
   }
-  
+
  public:
   bool operator==(const interval_set& other) const {
-    return _size == other._size && m == other.m;
+    return _size == other._size && (m == other.m || read() == other.read());
   }
 
   int size() const {
@@ -239,36 +264,38 @@ class interval_set {
   }
 
   void encode(bufferlist& bl) const {
-    ::encode(m, bl);
+    ::encode(read(), bl);
   }
   void encode_nohead(bufferlist& bl) const {
-    ::encode_nohead(m, bl);
+    ::encode_nohead(read(), bl);
   }
   void decode(bufferlist::iterator& bl) {
-    ::decode(m, bl);
+    m = std::make_shared<std::map<T,T> >();
+    ::decode(*m, bl);
     _size = 0;
-    for (typename std::map<T,T>::const_iterator p = m.begin();
-         p != m.end();
+    for (typename std::map<T,T>::const_iterator p = m->begin();
+         p != m->end();
          p++)
       _size += p->second;
   }
   void decode_nohead(int n, bufferlist::iterator& bl) {
-    ::decode_nohead(n, m, bl);
+    m = std::make_shared<std::map<T,T> >();
+    ::decode_nohead(n, *m, bl);
     _size = 0;
-    for (typename std::map<T,T>::const_iterator p = m.begin();
-         p != m.end();
+    for (typename std::map<T,T>::const_iterator p = m->begin();
+         p != m->end();
          p++)
       _size += p->second;
   }
 
   void clear() {
-    m.clear();
+    m.reset();
     _size = 0;
   }
 
   bool contains(T i, T *pstart=0, T *plen=0) const {
     typename std::map<T,T>::const_iterator p = find_inc(i);
-    if (p == m.end()) return false;
+    if (p == read().end()) return false;
     if (p->first > i) return false;
     if (p->first+p->second <= i) return false;
     assert(p->first <= i && p->first+p->second > i);
@@ -280,7 +307,7 @@ class interval_set {
   }
   bool contains(T start, T len) const {
     typename std::map<T,T>::const_iterator p = find_inc(start);
-    if (p == m.end()) return false;
+    if (p == read().end()) return false;
     if (p->first > start) return false;
     if (p->first+p->second <= start) return false;
     assert(p->first <= start && p->first+p->second > start);
@@ -298,16 +325,16 @@ class interval_set {
 
   // outer range of set
   bool empty() const {
-    return m.empty();
+    return read().empty();
   }
   T range_start() const {
     assert(!empty());
-    typename std::map<T,T>::const_iterator p = m.begin();
+    typename std::map<T,T>::const_iterator p = read().begin();
     return p->first;
   }
   T range_end() const {
     assert(!empty());
-    typename std::map<T,T>::const_iterator p = m.end();
+    typename std::map<T,T>::const_iterator p = read().end();
     p--;
     return p->first+p->second;
   }
@@ -316,7 +343,7 @@ class interval_set {
   bool starts_after(T i) const {
     assert(!contains(i));
     typename std::map<T,T>::const_iterator p = find_inc(i);
-    if (p == m.end()) return false;
+    if (p == read().end()) return false;
     return true;
   }
   T start_after(T i) const {
@@ -340,29 +367,30 @@ class interval_set {
     //cout << "insert " << start << "~" << len << endl;
     assert(len > 0);
     _size += len;
-    typename std::map<T,T>::iterator p = find_adj_m(start);
-    if (p == m.end()) {
-      m[start] = len;                  // new interval
+    std::map<T,T>& mm = write();
+    typename std::map<T,T>::iterator p = find_adj_m(mm, start);
+    if (p == mm.end()) {
+      mm[start] = len;                 // new interval
       if (pstart)
 	*pstart = start;
       if (plen)
 	*plen = len;
     } else {
       if (p->first < start) {
-        
+
         if (p->first + p->second != start) {
           //cout << "p is " << p->first << "~" << p->second << ", start is " << start << ", len is " << len << endl;
           assert(0);
         }
-        
+
         p->second += len;               // append to end
-        
+
         typename std::map<T,T>::iterator n = p;
         n++;
-        if (n != m.end() && 
+        if (n != mm.end() &&
             start+len == n->first) {   // combine with next, too!
           p->second += n->second;
-          m.erase(n);
+          mm.erase(n);
         }
 	if (pstart)
 	  *pstart = p->first;
@@ -370,15 +398,15 @@ class interval_set {
 	  *plen = p->second;
       } else {
         if (start+len == p->first) {
-          m[start] = len + p->second;  // append to front 
+          mm[start] = len + p->second; // append to front
 	  if (pstart)
 	    *pstart = start;
 	  if (plen)
 	    *plen = len + p->second;
-          m.erase(p);
+          mm.erase(p);
         } else {
           assert(p->first > start+len);
-          m[start] = len;              // new interval
+          mm[start] = len;             // new interval
 	  if (pstart)
 	    *pstart = start;
 	  if (plen)
@@ -391,12 +419,15 @@ class interval_set {
   void swap(interval_set<T>& other) {
     m.swap(other.m);
     std::swap(_size, other._size);
-  }    
-  
+  }
+
   void erase(iterator &i) {
+    // i was obtained through a non-const accessor, which detached us,
+    // so the map must still be private to this set.
+    assert(m && m.unique());
     _size -= i.get_len();
     assert(_size >= 0);
-    m.erase(i._iter);
+    m->erase(i._iter);
   }
 
   void erase(T val) {
@@ -404,37 +435,38 @@ class interval_set {
   }
 
   void erase(T start, T len) {
-    typename std::map<T,T>::iterator p = find_inc_m(start);
+    std::map<T,T>& mm = write();
+    typename std::map<T,T>::iterator p = find_inc_m(mm, start);
 
     _size -= len;
     assert(_size >= 0);
 
-    assert(p != m.end());
+    assert(p != mm.end());
     assert(p->first <= start);
 
     T before = start - p->first;
     assert(p->second >= before+len);
     T after = p->second - before - len;
-    
-    if (before) 
+
+    if (before)
       p->second = before;        // shorten bit before
     else
-      m.erase(p);
+      mm.erase(p);
     if (after)
-      m[start+len] = after;
+      mm[start+len] = after;
   }
 
 
   void subtract(const interval_set &a) {
-    for (typename std::map<T,T>::const_iterator p = a.m.begin();
-         p != a.m.end();
+    for (typename std::map<T,T>::const_iterator p = a.read().begin();
+         p != a.read().end();
          p++)
       erase(p->first, p->second);
   }
 
   void insert(const interval_set &a) {
-    for (typename std::map<T,T>::const_iterator p = a.m.begin();
-         p != a.m.end();
+    for (typename std::map<T,T>::const_iterator p = a.read().begin();
+         p != a.read().end();
          p++)
       insert(p->first, p->second);
   }
@@ -445,10 +477,10 @@ class interval_set {
     assert(&b != this);
     clear();
 
-    typename std::map<T,T>::const_iterator pa = a.m.begin();
-    typename std::map<T,T>::const_iterator pb = b.m.begin();
-    
-    while (pa != a.m.end() && pb != b.m.end()) {
+    typename std::map<T,T>::const_iterator pa = a.read().begin();
+    typename std::map<T,T>::const_iterator pb = b.read().begin();
+
+    while (pa != a.read().end() && pb != b.read().end()) {
       // passing?
       if (pa->first + pa->second <= pb->first) 
         { pa++;  continue; }
@@ -474,10 +506,10 @@ class interval_set {
     assert(&a != this);
     assert(&b != this);
     clear();
-    
+
     //cout << "union_of" << endl;
 
-    // a
+    // a (shared until we subtract/insert below)
     m = a.m;
     _size = a._size;
 
@@ -497,12 +529,12 @@ class interval_set {
   }
 
   bool subset_of(const interval_set &big) const {
-    for (typename std::map<T,T>::const_iterator i = m.begin();
-         i != m.end();
-         i++) 
+    for (typename std::map<T,T>::const_iterator i = read().begin();
+         i != read().end();
+         i++)
       if (!big.contains(i->first, i->second)) return false;
     return true;
-  }  
+  }
 
   /*
    * build a subset of @other, starting at or after @start, and including
@@ -512,7 +544,7 @@ class interval_set {
   void span_of(const interval_set &other, T start, T len) {
     clear();
     typename std::map<T,T>::const_iterator p = other.find_inc(start);
-    if (p == other.m.end())
+    if (p == other.read().end())
       return;
     if (p->first < start) {
       if (p->first + p->second < start)
@@ -527,7 +559,7 @@ class interval_set {
 	return;
       }
     }
-    while (p != other.m.end() && len > 0) {
+    while (p != other.read().end() && len > 0) {
       if (p->second < len) {
 	insert(p->first, p->second);
 	len -= p->second;
@@ -542,7 +574,7 @@ class interval_set {
 private:
   // data
   int64_t _size;
-  std::map<T,T> m;   // map start -> len
+  std::shared_ptr<std::map<T,T> > m;   // map start -> len; NULL == empty
 };
 
 
@@ -114,7 +114,42 @@ class LRUList {
     assert(len>0);
     len--;
   }
-  
+
+  // move up to n items from our tail to the head of 'to', preserving
+  // their relative order, without reinserting them one by one
+  void splice_tail(uint32_t n, LRUList& to) {
+    if (n > len)
+      n = len;
+    if (n == 0)
+      return;
+
+    LRUObject *chain_tail = tail;
+    LRUObject *chain_head = tail;
+    chain_head->lru_list = &to;
+    for (uint32_t i = 1; i < n; i++) {
+      chain_head = chain_head->lru_prev;
+      chain_head->lru_list = &to;
+    }
+
+    // detach the chain from us
+    tail = chain_head->lru_prev;
+    if (tail)
+      tail->lru_next = NULL;
+    else
+      head = NULL;
+    len -= n;
+
+    // attach it at the head of 'to'
+    chain_head->lru_prev = NULL;
+    chain_tail->lru_next = to.head;
+    if (to.head)
+      to.head->lru_prev = chain_head;
+    else
+      to.tail = chain_tail;
+    to.head = chain_head;
+    to.len += n;
+  }
+
 };
 
 
@@ -208,16 +243,12 @@ class LRU {
 
     unsigned toplen = lru_top.get_length();
     unsigned topwant = (unsigned)(lru_midpoint * ((double)lru_max - lru_num_pinned));
-    while (toplen > 0 && 
-           toplen > topwant) {
-      // remove from tail of top, stick at head of bot
-      // FIXME: this could be way more efficient by moving a whole chain of items.
-
-      LRUObject *o = lru_top.get_tail();
-      lru_top.remove(o);
-      lru_bot.insert_head(o);
-      toplen--;
-    }
+    if (toplen <= topwant)
+      return;
+
+    // demote the excess from the tail of top to the head of bot with a
+    // single splice instead of moving the items one by one
+    lru_top.splice_tail(toplen - topwant, lru_bot);
   }
 
 
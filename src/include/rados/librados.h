@@ -1754,6 +1754,55 @@ CEPH_RADOS_API int rados_aio_create_completion(void *cb_arg,
                                                rados_callback_t cb_safe,
 				               rados_completion_t *pc);
 
+/**
+ * Request direct callback invocation for a completion
+ *
+ * By default the complete and safe callbacks are invoked from a
+ * dedicated callback thread, which costs two context switches per
+ * operation. With this flag set they are invoked directly in the
+ * context of the internal thread that received the reply.
+ *
+ * @warning The callbacks MUST NOT block and MUST NOT call back into
+ * librados synchronously (e.g. rados_aio_wait_for_complete() or any
+ * synchronous I/O), or the client's entire I/O path will stall.
+ *
+ * @param c completion to modify
+ * @returns 0
+ */
+CEPH_RADOS_API int rados_aio_set_inline_completion(rados_completion_t c);
+
+/**
+ * Mark a completion for delivery through rados_aio_reap()
+ *
+ * Instead of (or in addition to) invoking callbacks, a reapable
+ * completion is queued on its cluster handle once the operation has
+ * reached its final state (complete for reads, safe for writes), and
+ * can be picked up in batches with rados_aio_reap().
+ *
+ * @note Do not call rados_aio_release() on a reapable completion
+ * until it has been reaped.
+ *
+ * @param c completion to modify
+ * @returns 0
+ */
+CEPH_RADOS_API int rados_aio_set_reapable(rados_completion_t c);
+
+/**
+ * Reap finished asynchronous operations, io_getevents()-style
+ *
+ * Fills in up to max completions that were marked reapable and have
+ * since reached their final state. Does not block; returns 0 if
+ * nothing has finished. The caller still owns each returned
+ * completion and must call rados_aio_release() on it as usual.
+ *
+ * @param cluster cluster handle the operations were issued on
+ * @param comps where to store the finished completions
+ * @param max size of the comps array
+ * @returns number of completions stored
+ */
+CEPH_RADOS_API int rados_aio_reap(rados_t cluster, rados_completion_t *comps,
+                                  int max);
+
 /**
  * Block until an operation completes
  *
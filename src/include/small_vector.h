@@ -0,0 +1,239 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_SMALL_VECTOR_H
+#define CEPH_SMALL_VECTOR_H
+
+#include "include/assert.h"
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+/**
+ * small_vector - a vector with inline storage for the first N elements
+ *
+ * Keeps up to N elements in the object itself and only falls back to
+ * the heap when it grows past that, so small, short-lived vectors on
+ * hot paths (e.g. the 1-2 OSDOps of a typical rados operation) cost no
+ * allocations at all.  Deliberately implements only the subset of the
+ * std::vector interface the callers need.
+ */
+template <typename T, std::size_t N>
+class small_vector {
+ public:
+  typedef T value_type;
+  typedef T* iterator;
+  typedef const T* const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  small_vector() : m_data(inline_data()), m_size(0), m_capacity(N) {}
+  explicit small_vector(std::size_t n) : small_vector() {
+    resize(n);
+  }
+  small_vector(const small_vector &other) : small_vector() {
+    assign(other.begin(), other.end());
+  }
+  small_vector(small_vector &&other) : small_vector() {
+    take_contents(std::move(other));
+  }
+  ~small_vector() {
+    destroy_elements();
+    release_storage();
+  }
+
+  small_vector &operator=(const small_vector &other) {
+    if (this != &other) {
+      assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+  small_vector &operator=(small_vector &&other) {
+    if (this != &other) {
+      destroy_elements();
+      release_storage();
+      take_contents(std::move(other));
+    }
+    return *this;
+  }
+
+  template <typename Iter>
+  void assign(Iter first, Iter last) {
+    destroy_elements();
+    reserve(std::distance(first, last));
+    for (; first != last; ++first) {
+      new (m_data + m_size) T(*first);
+      ++m_size;
+    }
+  }
+
+  std::size_t size() const {
+    return m_size;
+  }
+  bool empty() const {
+    return m_size == 0;
+  }
+
+  T &operator[](std::size_t i) {
+    return m_data[i];
+  }
+  const T &operator[](std::size_t i) const {
+    return m_data[i];
+  }
+
+  T &back() {
+    assert(m_size > 0);
+    return m_data[m_size - 1];
+  }
+  const T &back() const {
+    assert(m_size > 0);
+    return m_data[m_size - 1];
+  }
+
+  iterator begin() {
+    return m_data;
+  }
+  iterator end() {
+    return m_data + m_size;
+  }
+  const_iterator begin() const {
+    return m_data;
+  }
+  const_iterator end() const {
+    return m_data + m_size;
+  }
+  reverse_iterator rbegin() {
+    return reverse_iterator(end());
+  }
+  reverse_iterator rend() {
+    return reverse_iterator(begin());
+  }
+
+  void reserve(std::size_t n) {
+    if (n <= m_capacity) {
+      return;
+    }
+    std::size_t new_capacity = m_capacity * 2;
+    if (new_capacity < n) {
+      new_capacity = n;
+    }
+    T *new_data = static_cast<T*>(::operator new(new_capacity * sizeof(T)));
+    for (std::size_t i = 0; i < m_size; ++i) {
+      new (new_data + i) T(std::move(m_data[i]));
+      m_data[i].~T();
+    }
+    release_storage();
+    m_data = new_data;
+    m_capacity = new_capacity;
+  }
+
+  void resize(std::size_t n) {
+    if (n < m_size) {
+      do {
+	m_data[--m_size].~T();
+      } while (m_size > n);
+      return;
+    }
+    reserve(n);
+    while (m_size < n) {
+      new (m_data + m_size) T();
+      ++m_size;
+    }
+  }
+
+  void push_back(const T &v) {
+    reserve(m_size + 1);
+    new (m_data + m_size) T(v);
+    ++m_size;
+  }
+  void push_back(T &&v) {
+    reserve(m_size + 1);
+    new (m_data + m_size) T(std::move(v));
+    ++m_size;
+  }
+  void pop_back() {
+    assert(m_size > 0);
+    m_data[--m_size].~T();
+  }
+
+  void clear() {
+    destroy_elements();
+  }
+
+  void swap(small_vector &other) {
+    small_vector tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+ private:
+  T *inline_data() {
+    return reinterpret_cast<T*>(&m_inline);
+  }
+  bool is_inline() const {
+    return m_data == const_cast<small_vector*>(this)->inline_data();
+  }
+
+  void destroy_elements() {
+    while (m_size > 0) {
+      m_data[--m_size].~T();
+    }
+  }
+  void release_storage() {
+    if (!is_inline()) {
+      ::operator delete(m_data);
+      m_data = inline_data();
+      m_capacity = N;
+    }
+  }
+
+  // assumes *this holds no elements and owns no heap storage
+  void take_contents(small_vector &&other) {
+    if (!other.is_inline()) {
+      m_data = other.m_data;
+      m_size = other.m_size;
+      m_capacity = other.m_capacity;
+      other.m_data = other.inline_data();
+      other.m_size = 0;
+      other.m_capacity = N;
+      return;
+    }
+    for (std::size_t i = 0; i < other.m_size; ++i) {
+      new (m_data + i) T(std::move(other.m_data[i]));
+    }
+    m_size = other.m_size;
+    other.destroy_elements();
+  }
+
+  typename std::aligned_storage<sizeof(T[N]), alignof(T)>::type m_inline;
+  T *m_data;
+  std::size_t m_size;
+  std::size_t m_capacity;
+};
+
+template <typename T, std::size_t N>
+inline std::ostream& operator<<(std::ostream& out, const small_vector<T, N>& v)
+{
+  out << "[";
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    if (i)
+      out << ",";
+    out << v[i];
+  }
+  out << "]";
+  return out;
+}
+
+#endif // CEPH_SMALL_VECTOR_H
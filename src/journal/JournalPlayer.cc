@@ -84,6 +84,7 @@ JournalPlayer::~JournalPlayer() {
     Mutex::Locker locker(m_lock);
     assert(m_shut_down);
     assert(m_fetch_object_numbers.empty());
+    assert(m_prefetch_object_numbers.empty());
     assert(!m_watch_scheduled);
   }
   m_replay_handler->put();
@@ -320,6 +321,9 @@ int JournalPlayer::process_prefetch(uint64_t object_number) {
   ldout(m_cct, 10) << "switching to playback mode" << dendl;
   m_state = STATE_PLAYBACK;
 
+  // start reading ahead of the replay position
+  prefetch_window();
+
   // if we have a valid commit position, our read should start with
   // the next consistent journal entry in the sequence
   if (m_commit_position_valid) {
@@ -591,17 +595,47 @@ bool JournalPlayer::remove_empty_object_player(const ObjectPlayerPtr &player) {
   m_watch_step = WATCH_STEP_FETCH_CURRENT;
 
   uint64_t next_object_num = player->get_object_number() + splay_width;
+  auto pre_it = m_prefetch_players.find(next_object_num);
+  if (pre_it != m_prefetch_players.end()) {
+    ObjectPlayerPtr next_player = pre_it->second;
+    m_object_players[next_object_num % splay_width] = next_player;
+
+    if (m_prefetch_object_numbers.count(next_object_num) > 0) {
+      // read-ahead still in flight -- it will complete as a normal fetch
+      ldout(m_cct, 10) << __func__ << ": waiting on in-flight read-ahead of "
+                       << next_player->get_oid() << dendl;
+      assert(m_fetch_object_numbers.count(next_object_num) == 0);
+      m_fetch_object_numbers.insert(next_object_num);
+      return true;
+    }
+
+    ldout(m_cct, 10) << __func__ << ": promoting prefetched "
+                     << next_player->get_oid() << dendl;
+    uint64_t fetched_bytes = next_player->get_fetched_bytes();
+    assert(m_prefetch_bytes >= fetched_bytes);
+    m_prefetch_bytes -= fetched_bytes;
+    m_prefetch_players.erase(pre_it);
+
+    prefetch_window();
+    remove_empty_object_player(next_player);
+    return true;
+  }
+
   fetch(next_object_num);
   return true;
 }
 
-void JournalPlayer::fetch(uint64_t object_num) {
-  assert(m_lock.is_locked());
-
-  ObjectPlayerPtr object_player(new ObjectPlayer(
+ObjectPlayerPtr JournalPlayer::create_object_player(uint64_t object_num) {
+  return ObjectPlayerPtr(new ObjectPlayer(
     m_ioctx, m_object_oid_prefix, object_num, m_journal_metadata->get_timer(),
     m_journal_metadata->get_timer_lock(), m_journal_metadata->get_order(),
     m_journal_metadata->get_settings().max_fetch_bytes));
+}
+
+void JournalPlayer::fetch(uint64_t object_num) {
+  assert(m_lock.is_locked());
+
+  ObjectPlayerPtr object_player = create_object_player(object_num);
 
   uint8_t splay_width = m_journal_metadata->get_splay_width();
   m_object_players[object_num % splay_width] = object_player;
@@ -642,6 +676,103 @@ void JournalPlayer::handle_fetched(uint64_t object_num, int r) {
   process_state(object_num, r);
 }
 
+void JournalPlayer::prefetch_window() {
+  assert(m_lock.is_locked());
+  if (m_state != STATE_PLAYBACK) {
+    return;
+  }
+
+  auto &settings = m_journal_metadata->get_settings();
+  uint64_t window = settings.object_fetch_window;
+  if (window == 0) {
+    return;
+  } else if (settings.max_prefetch_bytes > 0 &&
+             m_prefetch_bytes >= settings.max_prefetch_bytes) {
+    ldout(m_cct, 20) << __func__ << ": read-ahead above high water mark"
+                     << dendl;
+    return;
+  }
+
+  // issue reads for objects ahead of each splay offset's replay position
+  // so advancing to the next object doesn't cost a round-trip; entries
+  // are decoded as each read completes
+  uint8_t splay_width = m_journal_metadata->get_splay_width();
+  uint64_t active_set = m_journal_metadata->get_active_set();
+  for (auto &player_pair : m_object_players) {
+    uint64_t object_num = player_pair.second->get_object_number();
+    for (uint64_t i = 1; i <= window; ++i) {
+      uint64_t candidate_num = object_num + (i * splay_width);
+      if (candidate_num / splay_width > active_set) {
+        // objects beyond the active set don't exist yet
+        break;
+      } else if (m_prefetch_players.count(candidate_num) > 0 ||
+                 m_fetch_object_numbers.count(candidate_num) > 0) {
+        continue;
+      }
+
+      prefetch_object(candidate_num);
+      if (settings.max_prefetch_bytes > 0 &&
+          m_prefetch_bytes >= settings.max_prefetch_bytes) {
+        return;
+      }
+    }
+  }
+}
+
+void JournalPlayer::prefetch_object(uint64_t object_num) {
+  assert(m_lock.is_locked());
+  assert(m_prefetch_object_numbers.count(object_num) == 0);
+
+  ObjectPlayerPtr object_player = create_object_player(object_num);
+  m_prefetch_players[object_num] = object_player;
+  m_prefetch_object_numbers.insert(object_num);
+
+  ldout(m_cct, 10) << __func__ << ": " << object_player->get_oid() << dendl;
+  object_player->fetch(new C_PrefetchFetch(this, object_num));
+}
+
+void JournalPlayer::handle_prefetched(uint64_t object_num, int r) {
+  ldout(m_cct, 10) << __func__ << ": "
+                   << utils::get_object_name(m_object_oid_prefix, object_num)
+                   << ": r=" << r << dendl;
+
+  Mutex::Locker locker(m_lock);
+  assert(m_prefetch_object_numbers.count(object_num) == 1);
+  m_prefetch_object_numbers.erase(object_num);
+
+  bool promoted = (m_fetch_object_numbers.count(object_num) == 1);
+  if (promoted) {
+    m_fetch_object_numbers.erase(object_num);
+    m_prefetch_players.erase(object_num);
+  }
+
+  if (m_shut_down) {
+    m_prefetch_players.erase(object_num);
+    return;
+  }
+
+  if (promoted) {
+    // the replay position caught up to this object while its read-ahead
+    // was still in flight -- complete it as a normal fetch
+    if (r == 0) {
+      ObjectPlayerPtr object_player = get_object_player(object_num);
+      remove_empty_object_player(object_player);
+    }
+    process_state(object_num, r);
+    return;
+  }
+
+  if (r < 0) {
+    // drop the player: the object will be fetched again on demand and the
+    // error surfaced through the replay path
+    m_prefetch_players.erase(object_num);
+    return;
+  }
+
+  m_prefetch_bytes += m_prefetch_players[object_num]->get_fetched_bytes();
+  prefetch_window();
+}
+
 void JournalPlayer::refetch(bool immediate) {
   ldout(m_cct, 10) << __func__ << dendl;
   assert(m_lock.is_locked());
@@ -73,6 +73,20 @@ private:
     }
   };
 
+  struct C_PrefetchFetch : public Context {
+    JournalPlayer *player;
+    uint64_t object_num;
+    C_PrefetchFetch(JournalPlayer *p, uint64_t o) : player(p), object_num(o) {
+      player->m_async_op_tracker.start_op();
+    }
+    virtual ~C_PrefetchFetch() {
+      player->m_async_op_tracker.finish_op();
+    }
+    virtual void finish(int r) {
+      player->handle_prefetched(object_num, r);
+    }
+  };
+
   struct C_Watch : public Context {
     JournalPlayer *player;
     uint64_t object_num;
@@ -116,6 +130,11 @@ private:
   PrefetchSplayOffsets m_prefetch_splay_offsets;
   SplayedObjectPlayers m_object_players;
 
+  // objects fetched (or fetching) ahead of the replay position
+  std::map<uint64_t, ObjectPlayerPtr> m_prefetch_players;
+  ObjectNumbers m_prefetch_object_numbers;
+  uint64_t m_prefetch_bytes = 0;
+
   bool m_commit_position_valid = false;
   ObjectPosition m_commit_position;
   SplayedObjectPositions m_commit_positions;
@@ -139,11 +158,17 @@ private:
   int process_prefetch(uint64_t object_number);
   int process_playback(uint64_t object_number);
 
+  ObjectPlayerPtr create_object_player(uint64_t object_num);
+
   void fetch(uint64_t object_num);
   void fetch(const ObjectPlayerPtr &object_player);
   void handle_fetched(uint64_t object_num, int r);
   void refetch(bool immediate);
 
+  void prefetch_window();
+  void prefetch_object(uint64_t object_num);
+  void handle_prefetched(uint64_t object_num, int r);
+
   void schedule_watch(bool immediate);
   void handle_watch(uint64_t object_num, int r);
   void handle_watch_assert_active(int r);
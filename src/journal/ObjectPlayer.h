@@ -47,6 +47,10 @@ public:
   inline uint64_t get_object_number() const {
     return m_object_num;
   }
+  inline uint64_t get_fetched_bytes() const {
+    Mutex::Locker locker(m_lock);
+    return m_read_off;
+  }
 
   void fetch(Context *on_finish);
   void watch(Context *on_fetch, double interval);
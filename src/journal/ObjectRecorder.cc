@@ -211,11 +211,19 @@ bool ObjectRecorder::flush_appends(bool force) {
     return true;
   }
 
-  if (m_append_buffers.empty() ||
-      (!force &&
-       m_size + m_pending_bytes < m_soft_max_size &&
-       (m_flush_interval > 0 && m_append_buffers.size() < m_flush_interval) &&
-       (m_flush_bytes > 0 && m_pending_bytes < m_flush_bytes))) {
+  if (m_append_buffers.empty()) {
+    return false;
+  }
+
+  // group commit: each configured limit triggers a flush on its own,
+  // and a configured limit that hasn't been reached holds appends back
+  // (the age timer bounds the added latency).  with no limits
+  // configured at all, every append is flushed immediately.
+  if (!force &&
+      m_size + m_pending_bytes < m_soft_max_size &&
+      (m_flush_interval == 0 || m_append_buffers.size() < m_flush_interval) &&
+      (m_flush_bytes == 0 || m_pending_bytes < m_flush_bytes) &&
+      (m_flush_interval > 0 || m_flush_bytes > 0 || m_flush_age > 0)) {
     return false;
   }
 
@@ -12,6 +12,10 @@ struct Settings {
   double commit_interval = 5;         ///< commit position throttle (in secs)
   uint64_t max_fetch_bytes = 0;       ///< 0 implies no limit
   uint64_t max_payload_bytes = 0;     ///< 0 implies object size limit
+  uint64_t object_fetch_window = 0;   ///< objects to read ahead of the replay
+                                      ///  position (0 implies none)
+  uint64_t max_prefetch_bytes = 0;    ///< pause read-ahead above this many
+                                      ///  unreplayed bytes (0 implies no limit)
 };
 
 } // namespace journal
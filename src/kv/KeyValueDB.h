@@ -8,6 +8,7 @@
 #include <set>
 #include <map>
 #include <string>
+#include <vector>
 #include "include/memory.h"
 #include <boost/scoped_ptr.hpp>
 #include "include/encoding.h"
@@ -153,6 +154,17 @@ public:
     }
     return r;
   }
+  virtual int get(
+    const std::string &prefix,             ///< [in] prefix
+    const std::vector<std::string> &keys,  ///< [in] keys, in order
+    std::vector<bufferlist> *out) {  ///< [out] values; empty if not found
+    out->clear();
+    out->resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      get(prefix, keys[i], &(*out)[i]);
+    }
+    return 0;
+  }
 
   class GenericIteratorImpl {
   public:
@@ -195,6 +207,10 @@ public:
   };
   typedef ceph::shared_ptr< WholeSpaceIteratorImpl > WholeSpaceIterator;
 
+  // Methods are virtual so backends that keep a prefix in its own
+  // keyspace (e.g. a rocksdb column family) can return a dedicated
+  // iterator from get_iterator(prefix) instead of a filtered
+  // whole-space one.
   class IteratorImpl : public GenericIteratorImpl {
     const std::string prefix;
     WholeSpaceIterator generic_iter;
@@ -203,57 +219,57 @@ public:
       prefix(prefix), generic_iter(iter) { }
     virtual ~IteratorImpl() { }
 
-    int seek_to_first() {
+    virtual int seek_to_first() {
       return generic_iter->seek_to_first(prefix);
     }
-    int seek_to_last() {
+    virtual int seek_to_last() {
       return generic_iter->seek_to_last(prefix);
     }
-    int upper_bound(const std::string &after) {
+    virtual int upper_bound(const std::string &after) {
       return generic_iter->upper_bound(prefix, after);
     }
-    int lower_bound(const std::string &to) {
+    virtual int lower_bound(const std::string &to) {
       return generic_iter->lower_bound(prefix, to);
     }
-    bool valid() {
+    virtual bool valid() {
       if (!generic_iter->valid())
 	return false;
       return generic_iter->raw_key_is_prefixed(prefix);
     }
     // Note that next() and prev() shouldn't validate iters,
     // it's responsibility of caller to ensure they're valid.
-    int next(bool validate=true) {
+    virtual int next(bool validate=true) {
       if (validate) {
         if (valid())
           return generic_iter->next();
         return status();
       } else {
-        return generic_iter->next();  
-      }      
+        return generic_iter->next();
+      }
     }
-    
-    int prev(bool validate=true) {
+
+    virtual int prev(bool validate=true) {
       if (validate) {
         if (valid())
           return generic_iter->prev();
         return status();
       } else {
-        return generic_iter->prev();  
-      }      
+        return generic_iter->prev();
+      }
     }
-    std::string key() {
+    virtual std::string key() {
       return generic_iter->key();
     }
-    std::pair<std::string, std::string> raw_key() {
+    virtual std::pair<std::string, std::string> raw_key() {
       return generic_iter->raw_key();
     }
-    bufferlist value() {
+    virtual bufferlist value() {
       return generic_iter->value();
     }
-    bufferptr value_as_ptr() {
+    virtual bufferptr value_as_ptr() {
       return generic_iter->value_as_ptr();
     }
-    int status() {
+    virtual int status() {
       return generic_iter->status();
     }
   };
@@ -264,7 +280,7 @@ public:
     return _get_iterator();
   }
 
-  Iterator get_iterator(const std::string &prefix) {
+  virtual Iterator get_iterator(const std::string &prefix) {
     return std::make_shared<IteratorImpl>(prefix, get_iterator());
   }
 
@@ -320,6 +336,18 @@ public:
     return -EOPNOTSUPP;
   }
 
+  /**
+   * Keep a prefix in its own keyspace (e.g. a rocksdb column family)
+   * with backend-specific tuning, instead of string-prepending it onto
+   * every key; this needs to be done BEFORE the DB is opened.  Keys in
+   * such a prefix are only reachable through get()/get_iterator(prefix)
+   * and transactions, not through whole-space iterators.
+   */
+  virtual int set_column_family(const std::string& prefix,
+				const std::string& options) {
+    return -EOPNOTSUPP;
+  }
+
 protected:
   /// List of matching prefixes and merge operators
   std::vector<std::pair<std::string,
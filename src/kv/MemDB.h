@@ -22,6 +22,7 @@
 #include "include/encoding_btree.h"
 #include "KeyValueDB.h"
 #include "osd/osd_types.h"
+#include "common/RWLock.h"
 
 using std::string;
 #define KEY_DELIM '\0' 
@@ -29,7 +30,9 @@ using std::string;
 class MemDB : public KeyValueDB
 {
   typedef std::pair<std::pair<std::string, std::string>, bufferlist> ms_op_t;
-  std::mutex m_lock;
+  // reader/writer lock: gets and iterator steps only take the read side,
+  // so lookups scale across cores instead of serializing on one mutex
+  RWLock m_lock;
   uint64_t m_total_bytes;
   uint64_t m_allocated_bytes;
 
@@ -51,7 +54,7 @@ class MemDB : public KeyValueDB
 
 public:
   MemDB(CephContext *c, const string &path, void *p) :
-    m_cct(c), m_priv(p), m_db_path(path)
+    m_lock("MemDB::m_lock"), m_cct(c), m_priv(p), m_db_path(path)
   {
     //Nothing as of now
   }
@@ -131,11 +134,11 @@ public:
       btree::btree_map<string, bufferptr>::iterator m_iter;
       std::pair<string, bufferlist> m_key_value;
       btree::btree_map<std::string, bufferptr> *m_btree_p;
-      std::mutex *m_btree_lock_p;
+      RWLock *m_btree_lock_p;
 
   public:
     MDBWholeSpaceIteratorImpl(btree::btree_map<std::string, bufferptr> *btree_p,
-                             std::mutex *btree_lock_p) {
+                             RWLock *btree_lock_p) {
         m_btree_p = btree_p;
         m_btree_lock_p = btree_lock_p;
     }
@@ -166,12 +169,12 @@ public:
   };
 
   uint64_t get_estimated_size(std::map<std::string,uint64_t> &extra) {
-      std::lock_guard<std::mutex> l(m_lock);
+      RWLock::RLocker l(m_lock);
       return m_allocated_bytes;
   };
 
   int get_statfs(struct store_statfs_t *buf) {
-    std::lock_guard<std::mutex> l(m_lock);
+    RWLock::RLocker l(m_lock);
     buf->reset();
     buf->total = m_total_bytes;
     buf->allocated = m_allocated_bytes;
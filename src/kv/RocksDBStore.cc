@@ -83,6 +83,37 @@ class RocksDBStore::MergeOperatorRouter : public rocksdb::AssociativeMergeOperat
 
 };
 
+//
+// Per-column-family variant of the above: keys inside a column family
+// carry no prefix, so dispatch straight to the one operator registered
+// for that prefix.
+//
+class RocksDBStore::MergeOperatorSingle : public rocksdb::AssociativeMergeOperator {
+  std::shared_ptr<KeyValueDB::MergeOperator> mop;
+  string op_name;
+  public:
+  explicit MergeOperatorSingle(std::shared_ptr<KeyValueDB::MergeOperator> o)
+    : mop(o), op_name(o->name()) {}
+
+  const char *Name() const {
+    return op_name.c_str();
+  }
+
+  virtual bool Merge(const rocksdb::Slice& key,
+                     const rocksdb::Slice* existing_value,
+                     const rocksdb::Slice& value,
+                     std::string* new_value,
+                     rocksdb::Logger* logger) const {
+    if (existing_value) {
+      mop->merge(existing_value->data(), existing_value->size(),
+		 value.data(), value.size(), new_value);
+    } else {
+      mop->merge_nonexistent(value.data(), value.size(), new_value);
+    }
+    return true;
+  }
+};
+
 int RocksDBStore::set_merge_operator(
   const string& prefix,
   std::shared_ptr<KeyValueDB::MergeOperator> mop)
@@ -93,6 +124,16 @@ int RocksDBStore::set_merge_operator(
   return 0;
 }
 
+int RocksDBStore::set_column_family(
+  const string& prefix,
+  const string& options)
+{
+  // If you fail here, it's because you can't do this on an open database
+  assert(db == nullptr);
+  cf_requests[prefix] = options;
+  return 0;
+}
+
 class CephRocksdbLogger : public rocksdb::Logger {
   CephContext *cct;
 public:
@@ -244,6 +285,11 @@ int RocksDBStore::do_open(ostream &out, bool create_if_missing)
     }
   }
   opt.create_if_missing = create_if_missing;
+  // let the write group insert into the memtable in parallel; with the
+  // default skiplist memtable this lets commit throughput scale past a
+  // single writer thread
+  opt.allow_concurrent_memtable_write = g_conf->rocksdb_concurrent_memtable_write;
+  opt.enable_write_thread_adaptive_yield = g_conf->rocksdb_write_thread_adaptive_yield;
   if (g_conf->rocksdb_separate_wal_dir) {
     opt.wal_dir = path + ".wal";
   }
@@ -289,10 +335,115 @@ int RocksDBStore::do_open(ostream &out, bool create_if_missing)
            << " num of cache shards to " << (1 << g_conf->rocksdb_cache_shard_bits) << dendl;
 
   opt.merge_operator.reset(new MergeOperatorRouter(*this));
-  status = rocksdb::DB::Open(opt, path, &db);
-  if (!status.ok()) {
-    derr << status.ToString() << dendl;
-    return -EINVAL;
+
+  // column families requested through set_column_family() or config
+  {
+    list<string> cfs;
+    get_str_list(g_conf->rocksdb_column_families, ";", cfs);
+    for (auto& c : cfs) {
+      size_t pos = c.find('=');
+      string prefix = c.substr(0, pos);
+      string cf_opts = (pos == string::npos) ? string() : c.substr(pos + 1);
+      if (!cf_requests.count(prefix))
+	cf_requests[prefix] = cf_opts;
+    }
+  }
+
+  if (cf_requests.empty()) {
+    status = rocksdb::DB::Open(opt, path, &db);
+    if (!status.ok()) {
+      derr << status.ToString() << dendl;
+      return -EINVAL;
+    }
+  } else {
+    // build per-cf options: inherit the base options, apply the
+    // per-prefix option string, and route merges straight to the
+    // prefix's operator (cf keys carry no prefix for the router to
+    // dispatch on)
+    auto build_cf_opt = [&](const string& prefix, const string& opt_str,
+			    rocksdb::ColumnFamilyOptions *cf_opt) -> int {
+      rocksdb::ColumnFamilyOptions base(opt);
+      if (opt_str.length()) {
+	rocksdb::Status r =
+	  rocksdb::GetColumnFamilyOptionsFromString(base, opt_str, cf_opt);
+	if (!r.ok()) {
+	  derr << __func__ << " invalid cf options for " << prefix << ": "
+	       << opt_str << dendl;
+	  return -EINVAL;
+	}
+      } else {
+	*cf_opt = base;
+      }
+      cf_opt->merge_operator.reset();
+      for (auto& q : merge_ops) {
+	if (q.first == prefix)
+	  cf_opt->merge_operator.reset(new MergeOperatorSingle(q.second));
+      }
+      return 0;
+    };
+
+    std::set<string> existing_cfs;
+    {
+      std::vector<std::string> existing;
+      rocksdb::Status r = rocksdb::DB::ListColumnFamilies(
+	rocksdb::DBOptions(opt), path, &existing);
+      if (r.ok())
+	existing_cfs.insert(existing.begin(), existing.end());
+      // else: db does not exist yet; only the default family will
+    }
+
+    std::vector<rocksdb::ColumnFamilyDescriptor> descs;
+    std::vector<string> desc_prefixes;
+    descs.push_back(rocksdb::ColumnFamilyDescriptor(
+		      rocksdb::kDefaultColumnFamilyName,
+		      rocksdb::ColumnFamilyOptions(opt)));
+    desc_prefixes.push_back(string());
+    for (auto& p : cf_requests) {
+      if (!existing_cfs.count(p.first))
+	continue;  // created below
+      rocksdb::ColumnFamilyOptions cf_opt;
+      int r = build_cf_opt(p.first, p.second, &cf_opt);
+      if (r < 0)
+	return r;
+      descs.push_back(rocksdb::ColumnFamilyDescriptor(p.first, cf_opt));
+      desc_prefixes.push_back(p.first);
+    }
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    status = rocksdb::DB::Open(opt, path, descs, &handles, &db);
+    if (!status.ok()) {
+      derr << status.ToString() << dendl;
+      return -EINVAL;
+    }
+    assert(handles.size() == desc_prefixes.size());
+    for (unsigned i = 0; i < handles.size(); ++i) {
+      cf_all_handles.push_back(handles[i]);
+      if (desc_prefixes[i].length())
+	cf_handles[desc_prefixes[i]] = handles[i];
+    }
+    for (auto& p : cf_requests) {
+      if (cf_handles.count(p.first))
+	continue;
+      if (!create_if_missing) {
+	derr << __func__ << " column family " << p.first
+	     << " does not exist in store; it must be selected at mkfs time"
+	     << dendl;
+	return -EINVAL;
+      }
+      rocksdb::ColumnFamilyOptions cf_opt;
+      int r = build_cf_opt(p.first, p.second, &cf_opt);
+      if (r < 0)
+	return r;
+      rocksdb::ColumnFamilyHandle *h = nullptr;
+      status = db->CreateColumnFamily(cf_opt, p.first, &h);
+      if (!status.ok()) {
+	derr << __func__ << " failed to create column family " << p.first
+	     << ": " << status.ToString() << dendl;
+	return -EINVAL;
+      }
+      dout(10) << __func__ << " created column family " << p.first << dendl;
+      cf_all_handles.push_back(h);
+      cf_handles[p.first] = h;
+    }
   }
 
   PerfCountersBuilder plb(g_ceph_context, "rocksdb", l_rocksdb_first, l_rocksdb_last);
@@ -306,6 +457,8 @@ int RocksDBStore::do_open(ostream &out, bool create_if_missing)
   plb.add_u64_counter(l_rocksdb_compact_range, "compact_range", "Compactions by range");
   plb.add_u64_counter(l_rocksdb_compact_queue_merge, "compact_queue_merge", "Mergings of ranges in compaction queue");
   plb.add_u64(l_rocksdb_compact_queue_len, "compact_queue_len", "Length of compaction queue");
+  plb.add_u64_counter(l_rocksdb_group_commit_batches, "group_commit_batches", "Group commit writes");
+  plb.add_u64_avg(l_rocksdb_group_commit_batch_txns, "group_commit_batch_txns", "Transactions per group commit write");
   logger = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 
@@ -355,22 +508,112 @@ void RocksDBStore::close()
     compact_queue_lock.Unlock();
   }
 
+  // drop column family handles before the db goes away
+  for (auto h : cf_all_handles)
+    delete h;
+  cf_all_handles.clear();
+  cf_handles.clear();
+
   if (logger)
     cct->get_perfcounters_collection()->remove(logger);
 }
 
+namespace {
+/// replays one WriteBatch into another so the group commit leader can
+/// merge follower transactions using only the public rocksdb api
+class WriteBatchAppender : public rocksdb::WriteBatch::Handler {
+  rocksdb::WriteBatch *out;
+public:
+  explicit WriteBatchAppender(rocksdb::WriteBatch *o) : out(o) {}
+  void Put(const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+    out->Put(key, value);
+  }
+  void Delete(const rocksdb::Slice& key) override {
+    out->Delete(key);
+  }
+  void SingleDelete(const rocksdb::Slice& key) override {
+    out->SingleDelete(key);
+  }
+  void Merge(const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+    out->Merge(key, value);
+  }
+};
+}
+
+int RocksDBStore::_submit_transaction(rocksdb::WriteBatch *bat, bool sync)
+{
+  if (!g_conf->rocksdb_group_commit) {
+    rocksdb::WriteOptions woptions;
+    woptions.sync = sync;
+    woptions.disableWAL = disableWAL;
+    rocksdb::Status s = db->Write(woptions, bat);
+    return s.ok() ? 0 : -1;
+  }
+
+  GroupCommitItem item(bat, sync);
+  group_commit_lock.Lock();
+  group_commit_queue.push_back(&item);
+  while (!item.done &&
+	 (group_commit_writing || group_commit_queue.front() != &item))
+    group_commit_cond.Wait(group_commit_lock);
+  if (item.done) {
+    // a leader wrote our batch for us
+    int r = item.result;
+    group_commit_lock.Unlock();
+    return r;
+  }
+
+  // we are the leader; take everything queued so far
+  group_commit_writing = true;
+  list<GroupCommitItem*> batch;
+  batch.swap(group_commit_queue);
+  rocksdb::WriteBatch merged;
+  rocksdb::WriteBatch *to_write = bat;
+  bool batch_sync = sync;
+  if (batch.size() > 1) {
+    WriteBatchAppender appender(&merged);
+    for (list<GroupCommitItem*>::iterator p = batch.begin();
+	 p != batch.end();
+	 ++p) {
+      rocksdb::Status s = (*p)->bat->Iterate(&appender);
+      assert(s.ok());
+      batch_sync = batch_sync || (*p)->sync;
+    }
+    to_write = &merged;
+  }
+  group_commit_lock.Unlock();
+
+  rocksdb::WriteOptions woptions;
+  woptions.sync = batch_sync;
+  woptions.disableWAL = disableWAL;
+  rocksdb::Status s = db->Write(woptions, to_write);
+  int result = s.ok() ? 0 : -1;
+
+  group_commit_lock.Lock();
+  for (list<GroupCommitItem*>::iterator p = batch.begin();
+       p != batch.end();
+       ++p) {
+    (*p)->result = result;
+    (*p)->done = true;
+  }
+  group_commit_writing = false;
+  group_commit_cond.SignalAll();
+  group_commit_lock.Unlock();
+  logger->inc(l_rocksdb_group_commit_batches);
+  logger->inc(l_rocksdb_group_commit_batch_txns, batch.size());
+  return result;
+}
+
 int RocksDBStore::submit_transaction(KeyValueDB::Transaction t)
 {
   utime_t start = ceph_clock_now(g_ceph_context);
   RocksDBTransactionImpl * _t =
     static_cast<RocksDBTransactionImpl *>(t.get());
-  rocksdb::WriteOptions woptions;
-  woptions.disableWAL = disableWAL;
-  rocksdb::Status s = db->Write(woptions, _t->bat);
+  int r = _submit_transaction(_t->bat, false);
   utime_t lat = ceph_clock_now(g_ceph_context) - start;
   logger->inc(l_rocksdb_txns);
   logger->tinc(l_rocksdb_submit_latency, lat);
-  return s.ok() ? 0 : -1;
+  return r;
 }
 
 int RocksDBStore::submit_transaction_sync(KeyValueDB::Transaction t)
@@ -378,14 +621,11 @@ int RocksDBStore::submit_transaction_sync(KeyValueDB::Transaction t)
   utime_t start = ceph_clock_now(g_ceph_context);
   RocksDBTransactionImpl * _t =
     static_cast<RocksDBTransactionImpl *>(t.get());
-  rocksdb::WriteOptions woptions;
-  woptions.sync = true;
-  woptions.disableWAL = disableWAL;
-  rocksdb::Status s = db->Write(woptions, _t->bat);
+  int r = _submit_transaction(_t->bat, true);
   utime_t lat = ceph_clock_now(g_ceph_context) - start;
   logger->inc(l_rocksdb_txns_sync);
   logger->tinc(l_rocksdb_submit_sync_latency, lat);
-  return s.ok() ? 0 : -1;
+  return r;
 }
 int RocksDBStore::get_info_log_level(string info_log_level)
 {
@@ -418,40 +658,59 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   const string &k,
   const bufferlist &to_set_bl)
 {
-  string key = combine_strings(prefix, k);
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
+  string key = cf ? k : combine_strings(prefix, k);
 
   // bufferlist::c_str() is non-constant, so we can't call c_str()
   if (to_set_bl.is_contiguous() && to_set_bl.length() > 0) {
-    bat->Put(rocksdb::Slice(key),
-	     rocksdb::Slice(to_set_bl.buffers().front().c_str(),
-			    to_set_bl.length()));
+    rocksdb::Slice val(to_set_bl.buffers().front().c_str(),
+		       to_set_bl.length());
+    if (cf)
+      bat->Put(cf, rocksdb::Slice(key), val);
+    else
+      bat->Put(rocksdb::Slice(key), val);
   } else {
     // make a copy
-    bufferlist val = to_set_bl;
-    bat->Put(rocksdb::Slice(key),
-	     rocksdb::Slice(val.c_str(), val.length()));
+    bufferlist bl = to_set_bl;
+    rocksdb::Slice val(bl.c_str(), bl.length());
+    if (cf)
+      bat->Put(cf, rocksdb::Slice(key), val);
+    else
+      bat->Put(rocksdb::Slice(key), val);
   }
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const string &k)
 {
-  bat->Delete(combine_strings(prefix, k));
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
+  if (cf)
+    bat->Delete(cf, rocksdb::Slice(k));
+  else
+    bat->Delete(combine_strings(prefix, k));
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rm_single_key(const string &prefix,
 					                 const string &k)
 {
-  bat->SingleDelete(combine_strings(prefix, k));
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
+  if (cf)
+    bat->SingleDelete(cf, rocksdb::Slice(k));
+  else
+    bat->SingleDelete(combine_strings(prefix, k));
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix)
 {
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
   KeyValueDB::Iterator it = db->get_iterator(prefix);
   for (it->seek_to_first();
        it->valid();
        it->next()) {
-    bat->Delete(combine_strings(prefix, it->key()));
+    if (cf)
+      bat->Delete(cf, rocksdb::Slice(it->key()));
+    else
+      bat->Delete(combine_strings(prefix, it->key()));
   }
 }
 
@@ -460,18 +719,25 @@ void RocksDBStore::RocksDBTransactionImpl::merge(
   const string &k,
   const bufferlist &to_set_bl)
 {
-  string key = combine_strings(prefix, k);
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
+  string key = cf ? k : combine_strings(prefix, k);
 
   // bufferlist::c_str() is non-constant, so we can't call c_str()
   if (to_set_bl.is_contiguous() && to_set_bl.length() > 0) {
-    bat->Merge(rocksdb::Slice(key),
-	       rocksdb::Slice(to_set_bl.buffers().front().c_str(),
-			    to_set_bl.length()));
+    rocksdb::Slice val(to_set_bl.buffers().front().c_str(),
+		       to_set_bl.length());
+    if (cf)
+      bat->Merge(cf, rocksdb::Slice(key), val);
+    else
+      bat->Merge(rocksdb::Slice(key), val);
   } else {
     // make a copy
-    bufferlist val = to_set_bl;
-    bat->Merge(rocksdb::Slice(key),
-	     rocksdb::Slice(val.c_str(), val.length()));
+    bufferlist bl = to_set_bl;
+    rocksdb::Slice val(bl.c_str(), bl.length());
+    if (cf)
+      bat->Merge(cf, rocksdb::Slice(key), val);
+    else
+      bat->Merge(rocksdb::Slice(key), val);
   }
 }
 
@@ -482,11 +748,17 @@ int RocksDBStore::get(
     std::map<string, bufferlist> *out)
 {
   utime_t start = ceph_clock_now(g_ceph_context);
+  rocksdb::ColumnFamilyHandle *cf = get_cf_handle(prefix);
   for (std::set<string>::const_iterator i = keys.begin();
        i != keys.end(); ++i) {
     std::string value;
-    std::string bound = combine_strings(prefix, *i);
-    auto status = db->Get(rocksdb::ReadOptions(), rocksdb::Slice(bound), &value);
+    rocksdb::Status status;
+    if (cf) {
+      status = db->Get(rocksdb::ReadOptions(), cf, rocksdb::Slice(*i), &value);
+    } else {
+      std::string bound = combine_strings(prefix, *i);
+      status = db->Get(rocksdb::ReadOptions(), rocksdb::Slice(bound), &value);
+    }
     if (status.ok())
       (*out)[*i].append(value);
   }
@@ -506,8 +778,13 @@ int RocksDBStore::get(
   int r = 0;
   string value, k;
   rocksdb::Status s;
-  k = combine_strings(prefix, key);
-  s = db->Get(rocksdb::ReadOptions(), rocksdb::Slice(k), &value);
+  rocksdb::ColumnFamilyHandle *cf = get_cf_handle(prefix);
+  if (cf) {
+    s = db->Get(rocksdb::ReadOptions(), cf, rocksdb::Slice(key), &value);
+  } else {
+    k = combine_strings(prefix, key);
+    s = db->Get(rocksdb::ReadOptions(), rocksdb::Slice(k), &value);
+  }
   if (s.ok()) {
     out->append(value);
   } else {
@@ -519,6 +796,48 @@ int RocksDBStore::get(
   return r;
 }
 
+int RocksDBStore::get(
+    const string &prefix,
+    const std::vector<string> &keys,
+    std::vector<bufferlist> *out)
+{
+  utime_t start = ceph_clock_now(g_ceph_context);
+  rocksdb::ColumnFamilyHandle *cf = get_cf_handle(prefix);
+  std::vector<std::string> bounds;  // keeps slice memory alive w/o a cf
+  std::vector<rocksdb::Slice> slices;
+  slices.reserve(keys.size());
+  if (cf) {
+    for (auto& k : keys) {
+      slices.push_back(rocksdb::Slice(k));
+    }
+  } else {
+    bounds.reserve(keys.size());
+    for (auto& k : keys) {
+      bounds.push_back(combine_strings(prefix, k));
+      slices.push_back(rocksdb::Slice(bounds.back()));
+    }
+  }
+  std::vector<std::string> values;
+  std::vector<rocksdb::Status> statuses;
+  if (cf) {
+    std::vector<rocksdb::ColumnFamilyHandle*> cfs(keys.size(), cf);
+    statuses = db->MultiGet(rocksdb::ReadOptions(), cfs, slices, &values);
+  } else {
+    statuses = db->MultiGet(rocksdb::ReadOptions(), slices, &values);
+  }
+  out->clear();
+  out->resize(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (statuses[i].ok()) {
+      (*out)[i].append(values[i]);
+    }
+  }
+  utime_t lat = ceph_clock_now(g_ceph_context) - start;
+  logger->inc(l_rocksdb_gets);
+  logger->tinc(l_rocksdb_get_latency, lat);
+  return 0;
+}
+
 string RocksDBStore::combine_strings(const string &prefix, const string &value)
 {
   string out = prefix;
@@ -559,6 +878,8 @@ void RocksDBStore::compact()
   logger->inc(l_rocksdb_compact);
   rocksdb::CompactRangeOptions options;
   db->CompactRange(options, nullptr, nullptr);
+  for (auto& p : cf_handles)
+    db->CompactRange(options, p.second, nullptr, nullptr);
 }
 
 
@@ -751,6 +1072,81 @@ string RocksDBStore::past_prefix(const string &prefix)
   return limit;
 }
 
+//
+// Iterator over one column family; keys there carry no prefix, so this
+// runs on the cf's own keyspace directly.
+//
+class CFIteratorImpl : public KeyValueDB::IteratorImpl {
+  string prefix;
+  rocksdb::Iterator *dbiter;
+public:
+  CFIteratorImpl(const string& p, rocksdb::Iterator *iter)
+    : KeyValueDB::IteratorImpl(p, KeyValueDB::WholeSpaceIterator()),
+      prefix(p), dbiter(iter) {}
+  ~CFIteratorImpl() {
+    delete dbiter;
+  }
+
+  int seek_to_first() override {
+    dbiter->SeekToFirst();
+    return dbiter->status().ok() ? 0 : -1;
+  }
+  int seek_to_last() override {
+    dbiter->SeekToLast();
+    return dbiter->status().ok() ? 0 : -1;
+  }
+  int upper_bound(const string &after) override {
+    lower_bound(after);
+    if (valid() && (key() == after))
+      next();
+    return dbiter->status().ok() ? 0 : -1;
+  }
+  int lower_bound(const string &to) override {
+    rocksdb::Slice slice_bound(to);
+    dbiter->Seek(slice_bound);
+    return dbiter->status().ok() ? 0 : -1;
+  }
+  bool valid() override {
+    return dbiter->Valid();
+  }
+  int next(bool validate=true) override {
+    if (valid())
+      dbiter->Next();
+    return dbiter->status().ok() ? 0 : -1;
+  }
+  int prev(bool validate=true) override {
+    if (valid())
+      dbiter->Prev();
+    return dbiter->status().ok() ? 0 : -1;
+  }
+  string key() override {
+    return dbiter->key().ToString();
+  }
+  pair<string,string> raw_key() override {
+    return make_pair(prefix, key());
+  }
+  bufferlist value() override {
+    return RocksDBStore::to_bufferlist(dbiter->value());
+  }
+  bufferptr value_as_ptr() override {
+    rocksdb::Slice val = dbiter->value();
+    return bufferptr(val.data(), val.size());
+  }
+  int status() override {
+    return dbiter->status().ok() ? 0 : -1;
+  }
+};
+
+KeyValueDB::Iterator RocksDBStore::get_iterator(const string& prefix)
+{
+  rocksdb::ColumnFamilyHandle *cf = get_cf_handle(prefix);
+  if (cf) {
+    return std::make_shared<CFIteratorImpl>(
+      prefix, db->NewIterator(rocksdb::ReadOptions(), cf));
+  }
+  return KeyValueDB::get_iterator(prefix);
+}
+
 RocksDBStore::WholeSpaceIterator RocksDBStore::_get_iterator()
 {
   return std::make_shared<RocksDBWholeSpaceIteratorImpl>(
@@ -38,6 +38,15 @@ struct librados::AioCompletionImpl {
   rados_callback_t callback_complete, callback_safe;
   void *callback_complete_arg, *callback_safe_arg;
 
+  // invoke callbacks directly in the context of the thread that
+  // received the reply, instead of bouncing them through the client
+  // Finisher; such callbacks must not block and must not call back
+  // into librados synchronously
+  bool inline_completion;
+  // deliver through RadosClient::reap_aio_completions() once the
+  // operation has reached its final state
+  bool reap;
+
   // for read
   bool is_read;
   bufferlist bl;
@@ -56,6 +65,7 @@ struct librados::AioCompletionImpl {
 			callback_safe(0),
 			callback_complete_arg(0),
 			callback_safe_arg(0),
+			inline_completion(false), reap(false),
 			is_read(false), blp(nullptr), out_buf(nullptr),
 			io(NULL), aio_write_seq(0), aio_write_list_item(this) { }
 
@@ -73,6 +83,18 @@ struct librados::AioCompletionImpl {
     lock.Unlock();
     return 0;
   }
+  int set_inline_completion(bool inl) {
+    lock.Lock();
+    inline_completion = inl;
+    lock.Unlock();
+    return 0;
+  }
+  int set_reapable(bool r) {
+    lock.Lock();
+    reap = r;
+    lock.Unlock();
+    return 0;
+  }
   int wait_for_complete() {
     lock.Lock();
     while (!ack)
@@ -111,13 +111,26 @@ struct C_aio_linger_Complete : public Context {
     c->safe = true;
     c->cond.Signal();
 
+    Context *complete_cb = NULL, *safe_cb = NULL;
     if (c->callback_complete) {
-      c->io->client->finisher.queue(new C_AioComplete(c));
+      if (c->inline_completion)
+	complete_cb = new C_AioComplete(c);
+      else
+	c->io->client->finisher.queue(new C_AioComplete(c));
     }
     if (c->callback_safe) {
-      c->io->client->finisher.queue(new C_AioSafe(c));
+      if (c->inline_completion)
+	safe_cb = new C_AioSafe(c);
+      else
+	c->io->client->finisher.queue(new C_AioSafe(c));
     }
+    if (c->reap)
+      c->io->client->queue_aio_reap(c);
     c->put_unlock();
+    if (complete_cb)
+      complete_cb->complete(0);
+    if (safe_cb)
+      safe_cb->complete(0);
   }
 };
 
@@ -260,6 +273,7 @@ void librados::IoCtxImpl::queue_aio_write(AioCompletionImpl *c)
 void librados::IoCtxImpl::complete_aio_write(AioCompletionImpl *c)
 {
   ldout(client->cct, 20) << "complete_aio_write " << c << dendl;
+  std::list<Context*> inline_cbs;
   aio_write_list_lock.Lock();
   assert(c->io == this);
   c->aio_write_list_item.remove_myself();
@@ -276,7 +290,10 @@ void librados::IoCtxImpl::complete_aio_write(AioCompletionImpl *c)
     ldout(client->cct, 20) << " waking waiters on seq " << waiters->first << dendl;
     for (std::list<AioCompletionImpl*>::iterator it = waiters->second.begin();
 	 it != waiters->second.end(); ++it) {
-      client->finisher.queue(new C_AioCompleteAndSafe(*it));
+      if ((*it)->inline_completion)
+	inline_cbs.push_back(new C_AioCompleteAndSafe(*it));
+      else
+	client->finisher.queue(new C_AioCompleteAndSafe(*it));
       (*it)->put();
     }
     aio_write_waiters.erase(waiters++);
@@ -284,6 +301,10 @@ void librados::IoCtxImpl::complete_aio_write(AioCompletionImpl *c)
 
   aio_write_cond.Signal();
   aio_write_list_lock.Unlock();
+  while (!inline_cbs.empty()) {
+    inline_cbs.front()->complete(0);
+    inline_cbs.pop_front();
+  }
   put();
 }
 
@@ -291,18 +312,26 @@ void librados::IoCtxImpl::flush_aio_writes_async(AioCompletionImpl *c)
 {
   ldout(client->cct, 20) << "flush_aio_writes_async " << this
 			 << " completion " << c << dendl;
-  Mutex::Locker l(aio_write_list_lock);
-  ceph_tid_t seq = aio_write_seq;
-  if (aio_write_list.empty()) {
-    ldout(client->cct, 20) << "flush_aio_writes_async no writes. (tid "
-			   << seq << ")" << dendl;
-    client->finisher.queue(new C_AioCompleteAndSafe(c));
-  } else {
-    ldout(client->cct, 20) << "flush_aio_writes_async " << aio_write_list.size()
-			   << " writes in flight; waiting on tid " << seq << dendl;
-    c->get();
-    aio_write_waiters[seq].push_back(c);
+  Context *inline_cb = NULL;
+  {
+    Mutex::Locker l(aio_write_list_lock);
+    ceph_tid_t seq = aio_write_seq;
+    if (aio_write_list.empty()) {
+      ldout(client->cct, 20) << "flush_aio_writes_async no writes. (tid "
+			     << seq << ")" << dendl;
+      if (c->inline_completion)
+	inline_cb = new C_AioCompleteAndSafe(c);
+      else
+	client->finisher.queue(new C_AioCompleteAndSafe(c));
+    } else {
+      ldout(client->cct, 20) << "flush_aio_writes_async " << aio_write_list.size()
+			     << " writes in flight; waiting on tid " << seq << dendl;
+      c->get();
+      aio_write_waiters[seq].push_back(c);
+    }
   }
+  if (inline_cb)
+    inline_cb->complete(0);
 }
 
 void librados::IoCtxImpl::flush_aio_writes()
@@ -1683,14 +1712,27 @@ void librados::IoCtxImpl::C_aio_Ack::finish(int r)
     c->rval = c->blp->length();
   }
 
+  Context *complete_cb = NULL, *safe_cb = NULL;
   if (c->callback_complete) {
-    c->io->client->finisher.queue(new C_AioComplete(c));
+    if (c->inline_completion)
+      complete_cb = new C_AioComplete(c);
+    else
+      c->io->client->finisher.queue(new C_AioComplete(c));
   }
   if (c->is_read && c->callback_safe) {
-    c->io->client->finisher.queue(new C_AioSafe(c));
+    if (c->inline_completion)
+      safe_cb = new C_AioSafe(c);
+    else
+      c->io->client->finisher.queue(new C_AioSafe(c));
   }
+  if (c->reap && c->is_read)
+    c->io->client->queue_aio_reap(c);
 
   c->put_unlock();
+  if (complete_cb)
+    complete_cb->complete(0);
+  if (safe_cb)
+    safe_cb->complete(0);
 }
 
 ///////////////////////////// C_aio_stat_Ack ////////////////////////////
@@ -1714,11 +1756,19 @@ void librados::IoCtxImpl::C_aio_stat_Ack::finish(int r)
     *pmtime = real_clock::to_time_t(mtime);
   }
 
+  Context *complete_cb = NULL;
   if (c->callback_complete) {
-    c->io->client->finisher.queue(new C_AioComplete(c));
+    if (c->inline_completion)
+      complete_cb = new C_AioComplete(c);
+    else
+      c->io->client->finisher.queue(new C_AioComplete(c));
   }
+  if (c->reap)
+    c->io->client->queue_aio_reap(c);
 
   c->put_unlock();
+  if (complete_cb)
+    complete_cb->complete(0);
 }
 
 ///////////////////////////// C_aio_stat2_Ack ////////////////////////////
@@ -1742,11 +1792,19 @@ void librados::IoCtxImpl::C_aio_stat2_Ack::finish(int r)
     *pts = real_clock::to_timespec(mtime);
   }
 
+  Context *complete_cb = NULL;
   if (c->callback_complete) {
-    c->io->client->finisher.queue(new C_AioComplete(c));
+    if (c->inline_completion)
+      complete_cb = new C_AioComplete(c);
+    else
+      c->io->client->finisher.queue(new C_AioComplete(c));
   }
+  if (c->reap)
+    c->io->client->queue_aio_reap(c);
 
   c->put_unlock();
+  if (complete_cb)
+    complete_cb->complete(0);
 }
 
 //////////////////////////// C_aio_Safe ////////////////////////////////
@@ -1766,13 +1824,21 @@ void librados::IoCtxImpl::C_aio_Safe::finish(int r)
   c->safe = true;
   c->cond.Signal();
 
+  Context *safe_cb = NULL;
   if (c->callback_safe) {
-    c->io->client->finisher.queue(new C_AioSafe(c));
+    if (c->inline_completion)
+      safe_cb = new C_AioSafe(c);
+    else
+      c->io->client->finisher.queue(new C_AioSafe(c));
   }
+  if (c->reap)
+    c->io->client->queue_aio_reap(c);
 
   c->io->complete_aio_write(c);
 
   c->put_unlock();
+  if (safe_cb)
+    safe_cb->complete(0);
 }
 
 void librados::IoCtxImpl::object_list_slice(
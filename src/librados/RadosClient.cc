@@ -75,6 +75,7 @@ librados::RadosClient::RadosClient(CephContext *cct_)
     timer(cct, lock),
     refcnt(1),
     log_last_version(0), log_cb(NULL), log_cb_arg(NULL),
+    reap_lock("librados::RadosClient::reap_lock"),
     finisher(cct)
 {
 }
@@ -343,6 +344,12 @@ void librados::RadosClient::shutdown()
     finisher.wait_for_empty();
     finisher.stop();
   }
+  reap_lock.Lock();
+  while (!reap_queue.empty()) {
+    reap_queue.front()->put();
+    reap_queue.pop_front();
+  }
+  reap_lock.Unlock();
   state = DISCONNECTED;
   instance_id = 0;
   timer.shutdown();   // will drop+retake lock
@@ -391,13 +398,26 @@ struct C_aio_watch_flush_Complete : public Context {
     c->safe = true;
     c->cond.Signal();
 
+    Context *complete_cb = NULL, *safe_cb = NULL;
     if (c->callback_complete) {
-      client->finisher.queue(new librados::C_AioComplete(c));
+      if (c->inline_completion)
+	complete_cb = new librados::C_AioComplete(c);
+      else
+	client->finisher.queue(new librados::C_AioComplete(c));
     }
     if (c->callback_safe) {
-      client->finisher.queue(new librados::C_AioSafe(c));
+      if (c->inline_completion)
+	safe_cb = new librados::C_AioSafe(c);
+      else
+	client->finisher.queue(new librados::C_AioSafe(c));
     }
+    if (c->reap)
+      client->queue_aio_reap(c);
     c->put_unlock();
+    if (complete_cb)
+      complete_cb->complete(0);
+    if (safe_cb)
+      safe_cb->complete(0);
   }
 };
 
@@ -410,6 +430,32 @@ int librados::RadosClient::async_watch_flush(AioCompletionImpl *c)
   return 0;
 }
 
+void librados::RadosClient::queue_aio_reap(AioCompletionImpl *c)
+{
+  // called with c->lock held, once c has reached its final state; the
+  // queue holds its own reference until the completion is reaped
+  c->_get();
+  Mutex::Locker l(reap_lock);
+  reap_queue.push_back(c);
+}
+
+int librados::RadosClient::reap_aio_completions(AioCompletionImpl **comps,
+						int max)
+{
+  int n = 0;
+  reap_lock.Lock();
+  while (n < max && !reap_queue.empty()) {
+    comps[n++] = reap_queue.front();
+    reap_queue.pop_front();
+  }
+  reap_lock.Unlock();
+  // drop the queue's references; the caller's own reference keeps
+  // each completion valid
+  for (int i = 0; i < n; ++i)
+    comps[i]->put();
+  return n;
+}
+
 uint64_t librados::RadosClient::get_instance_id()
 {
   return instance_id;
@@ -71,6 +71,9 @@ private:
   void *log_cb_arg;
   string log_watch;
 
+  Mutex reap_lock;
+  std::list<AioCompletionImpl*> reap_queue;
+
   int wait_for_osdmap();
 
 public:
@@ -85,6 +88,9 @@ public:
   int watch_flush();
   int async_watch_flush(AioCompletionImpl *c);
 
+  void queue_aio_reap(AioCompletionImpl *c);
+  int reap_aio_completions(AioCompletionImpl **comps, int max);
+
   uint64_t get_instance_id();
 
   int wait_for_latest_osdmap();
@@ -4259,6 +4259,24 @@ extern "C" int rados_aio_create_completion(void *cb_arg,
   return 0;
 }
 
+extern "C" int rados_aio_set_inline_completion(rados_completion_t c)
+{
+  return ((librados::AioCompletionImpl*)c)->set_inline_completion(true);
+}
+
+extern "C" int rados_aio_set_reapable(rados_completion_t c)
+{
+  return ((librados::AioCompletionImpl*)c)->set_reapable(true);
+}
+
+extern "C" int rados_aio_reap(rados_t cluster, rados_completion_t *comps,
+			      int max)
+{
+  librados::RadosClient *client = (librados::RadosClient *)cluster;
+  return client->reap_aio_completions(
+    (librados::AioCompletionImpl **)comps, max);
+}
+
 extern "C" int rados_aio_wait_for_complete(rados_completion_t c)
 {
   tracepoint(librados, rados_aio_wait_for_complete_enter, c);
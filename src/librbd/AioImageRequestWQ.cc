@@ -146,7 +146,7 @@ void AioImageRequestWQ::aio_write(AioCompletion *c, uint64_t off, uint64_t len,
   }
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
-  if (m_image_ctx.non_blocking_aio || writes_blocked()) {
+  if (m_image_ctx.non_blocking_aio || writes_blocked() || is_lock_required()) {
     queue(new AioImageWrite<>(m_image_ctx, c, off, len, buf, op_flags));
   } else {
     c->start_op();
@@ -172,7 +172,7 @@ void AioImageRequestWQ::aio_discard(AioCompletion *c, uint64_t off,
   }
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
-  if (m_image_ctx.non_blocking_aio || writes_blocked()) {
+  if (m_image_ctx.non_blocking_aio || writes_blocked() || is_lock_required()) {
     queue(new AioImageDiscard<>(m_image_ctx, c, off, len));
   } else {
     c->start_op();
@@ -196,7 +196,8 @@ void AioImageRequestWQ::aio_flush(AioCompletion *c, bool native_async) {
   }
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
-  if (m_image_ctx.non_blocking_aio || writes_blocked() || !writes_empty()) {
+  if (m_image_ctx.non_blocking_aio || writes_blocked() || !writes_empty() ||
+      is_lock_required()) {
     queue(new AioImageFlush<>(m_image_ctx, c));
   } else {
     AioImageRequest<>::aio_flush(&m_image_ctx, c);
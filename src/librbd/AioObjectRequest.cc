@@ -612,7 +612,11 @@ void AioObjectWrite::send_write() {
                          << m_object_off << "~" << m_object_len
                          << " object exist " << m_object_exist
                          << " write_full " << write_full << dendl;
-  if (write_full && !has_parent()) {
+  if (write_full && (!has_parent() || m_snaps.empty())) {
+    // no-op if the object doesn't have a parent.  if it does, the write
+    // fully overwrites the object and, without any child snapshots,
+    // nothing can ever read the parent data through this object -- so
+    // skip the copyup (and its read of the full parent block)
     send_write_op(false);
   } else {
     AbstractAioObjectWrite::send_write();
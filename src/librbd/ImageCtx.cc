@@ -287,6 +287,7 @@ struct C_InvalidateCache : public Context {
     }
 
     readahead.set_trigger_requests(readahead_trigger_requests);
+    readahead.set_max_streams(readahead_max_streams);
     readahead.set_max_readahead_size(readahead_max_bytes);
   }
 
@@ -916,6 +917,7 @@ struct C_InvalidateCache : public Context {
         "rbd_balance_parent_reads", false)(
         "rbd_localize_parent_reads", false)(
         "rbd_readahead_trigger_requests", false)(
+        "rbd_readahead_max_streams", false)(
         "rbd_readahead_max_bytes", false)(
         "rbd_readahead_disable_after_bytes", false)(
         "rbd_clone_copy_on_read", false)(
@@ -970,6 +972,7 @@ struct C_InvalidateCache : public Context {
     ASSIGN_OPTION(balance_parent_reads);
     ASSIGN_OPTION(localize_parent_reads);
     ASSIGN_OPTION(readahead_trigger_requests);
+    ASSIGN_OPTION(readahead_max_streams);
     ASSIGN_OPTION(readahead_max_bytes);
     ASSIGN_OPTION(readahead_disable_after_bytes);
     ASSIGN_OPTION(clone_copy_on_read);
@@ -168,6 +168,7 @@ namespace librbd {
     bool balance_parent_reads;
     bool localize_parent_reads;
     uint32_t readahead_trigger_requests;
+    uint32_t readahead_max_streams;
     uint64_t readahead_max_bytes;
     uint64_t readahead_disable_after_bytes;
     bool clone_copy_on_read;
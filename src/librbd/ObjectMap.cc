@@ -30,7 +30,7 @@
 namespace librbd {
 
 ObjectMap::ObjectMap(ImageCtx &image_ctx, uint64_t snap_id)
-  : m_image_ctx(image_ctx), m_snap_id(snap_id)
+  : m_image_ctx(image_ctx), m_snap_id(snap_id), m_update_in_flight(false)
 {
 }
 
@@ -238,10 +238,100 @@ void ObjectMap::aio_update(uint64_t snap_id, uint64_t start_object_no,
                            uint64_t end_object_no, uint8_t new_state,
                            const boost::optional<uint8_t> &current_state,
                            Context *on_finish) {
+  if (snap_id != m_snap_id) {
+    // out-of-band update to a snapshot object map (copyup) -- not batched
+    object_map::UpdateRequest *req = new object_map::UpdateRequest(
+      m_image_ctx, &m_object_map, snap_id, start_object_no, end_object_no,
+      new_state, current_state, on_finish);
+    req->send();
+    return;
+  }
+
+  assert(m_image_ctx.snap_lock.is_locked());
+  assert(m_image_ctx.object_map_lock.is_wlocked());
+
+  // while an update is in-flight, queue behind it so that bursts of
+  // per-object updates can be coalesced into ranged cls calls
+  m_pending_updates.push_back(UpdateOperation(start_object_no, end_object_no,
+                                              new_state, current_state,
+                                              on_finish));
+  if (!m_update_in_flight) {
+    send_pending_updates();
+  }
+}
+
+void ObjectMap::send_pending_updates() {
+  assert(m_image_ctx.snap_lock.is_locked());
+  assert(m_image_ctx.object_map_lock.is_wlocked());
+  assert(!m_update_in_flight);
+  assert(!m_pending_updates.empty());
+  CephContext *cct = m_image_ctx.cct;
+
+  UpdateOperation update = m_pending_updates.front();
+  m_pending_updates.pop_front();
+
+  std::list<Context *> update_contexts;
+  if (update.on_finish != nullptr) {
+    update_contexts.push_back(update.on_finish);
+  }
+
+  // coalesce the longest run of queued updates that share the same state
+  // transition and extend the range; stop at the first that doesn't to
+  // preserve the submission order of conflicting updates
+  while (!m_pending_updates.empty()) {
+    UpdateOperation &next_update = m_pending_updates.front();
+    if (next_update.new_state != update.new_state ||
+        next_update.current_state != update.current_state ||
+        next_update.start_object_no > update.end_object_no ||
+        next_update.end_object_no < update.start_object_no) {
+      break;
+    }
+
+    update.start_object_no = MIN(update.start_object_no,
+                                 next_update.start_object_no);
+    update.end_object_no = MAX(update.end_object_no,
+                               next_update.end_object_no);
+    if (next_update.on_finish != nullptr) {
+      update_contexts.push_back(next_update.on_finish);
+    }
+    m_pending_updates.pop_front();
+  }
+
+  ldout(cct, 20) << &m_image_ctx << " send_pending_updates: start="
+                 << update.start_object_no << ", end="
+                 << update.end_object_no << ", contexts="
+                 << update_contexts.size() << dendl;
+
+  m_update_in_flight = true;
+  Context *ctx = new FunctionContext(
+    [this, update_contexts](int r) {
+      handle_update_flushed(r, update_contexts);
+    });
+
   object_map::UpdateRequest *req = new object_map::UpdateRequest(
-    m_image_ctx, &m_object_map, snap_id, start_object_no, end_object_no,
-    new_state, current_state, on_finish);
+    m_image_ctx, &m_object_map, m_snap_id, update.start_object_no,
+    update.end_object_no, update.new_state, update.current_state, ctx);
   req->send();
 }
 
+void ObjectMap::handle_update_flushed(int r,
+                                      std::list<Context *> update_contexts) {
+  ldout(m_image_ctx.cct, 20) << &m_image_ctx << " handle_update_flushed: r="
+                             << r << dendl;
+  {
+    RWLock::RLocker snap_locker(m_image_ctx.snap_lock);
+    RWLock::WLocker object_map_locker(m_image_ctx.object_map_lock);
+    m_update_in_flight = false;
+    if (!m_pending_updates.empty()) {
+      send_pending_updates();
+    }
+  }
+
+  // complete the callers outside of the locks since they might restart
+  // their state machines in-line
+  for (auto ctx : update_contexts) {
+    ctx->complete(r);
+  }
+}
+
 } // namespace librbd
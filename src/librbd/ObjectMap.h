@@ -8,6 +8,7 @@
 #include "include/rbd/object_map_types.h"
 #include "common/bit_vector.hpp"
 #include <boost/optional.hpp>
+#include <list>
 
 class Context;
 class RWLock;
@@ -62,10 +63,33 @@ public:
   void snapshot_remove(uint64_t snap_id, Context *on_finish);
 
 private:
+  struct UpdateOperation {
+    uint64_t start_object_no;
+    uint64_t end_object_no;
+    uint8_t new_state;
+    boost::optional<uint8_t> current_state;
+    Context *on_finish;
+
+    UpdateOperation(uint64_t start_object_no, uint64_t end_object_no,
+                    uint8_t new_state,
+                    const boost::optional<uint8_t> &current_state,
+                    Context *on_finish)
+      : start_object_no(start_object_no), end_object_no(end_object_no),
+        new_state(new_state), current_state(current_state),
+        on_finish(on_finish) {
+    }
+  };
+
   ImageCtx &m_image_ctx;
   ceph::BitVector<2> m_object_map;
   uint64_t m_snap_id;
 
+  bool m_update_in_flight;
+  std::list<UpdateOperation> m_pending_updates;
+
+  void send_pending_updates();
+  void handle_update_flushed(int r, std::list<Context *> update_contexts);
+
 };
 
 } // namespace librbd
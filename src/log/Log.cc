@@ -51,7 +51,8 @@ Log::Log(SubsystemMap *s)
     m_subs(s),
     m_queue_mutex_holder(0),
     m_flush_mutex_holder(0),
-    m_new(), m_recent(),
+    m_new_head(NULL), m_new_len(0), m_flusher_waiting(false),
+    m_recent(),
     m_fd(-1),
     m_uid(0),
     m_gid(0),
@@ -91,6 +92,11 @@ Log::~Log()
   }
 
   assert(!is_started());
+  {
+    // drop anything submitted but never flushed
+    EntryQueue t;
+    _take_new(&t);
+  }
   if (m_fd >= 0)
     VOID_TEMP_FAILURE_RETRY(::close(m_fd));
 
@@ -213,20 +219,34 @@ void Log::stop_graylog()
 
 void Log::submit_entry(Entry *e)
 {
-  pthread_mutex_lock(&m_queue_mutex);
-  m_queue_mutex_holder = pthread_self();
-
   if (m_inject_segv)
     *(volatile int *)(0) = 0xdead;
 
   // wait for flush to catch up
-  while (m_new.m_len > m_max_new)
-    pthread_cond_wait(&m_cond_loggers, &m_queue_mutex);
+  if (__atomic_load_n(&m_new_len, __ATOMIC_RELAXED) > m_max_new) {
+    pthread_mutex_lock(&m_queue_mutex);
+    m_queue_mutex_holder = pthread_self();
+    while (__atomic_load_n(&m_new_len, __ATOMIC_RELAXED) > m_max_new)
+      pthread_cond_wait(&m_cond_loggers, &m_queue_mutex);
+    m_queue_mutex_holder = 0;
+    pthread_mutex_unlock(&m_queue_mutex);
+  }
 
-  m_new.enqueue(e);
-  pthread_cond_signal(&m_cond_flusher);
-  m_queue_mutex_holder = 0;
-  pthread_mutex_unlock(&m_queue_mutex);
+  // lock-free push; the flusher collects the list with an exchange
+  // and restores submission order
+  e->m_next = __atomic_load_n(&m_new_head, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&m_new_head, &e->m_next, e, false,
+				      __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    ;
+  __atomic_add_fetch(&m_new_len, 1, __ATOMIC_SEQ_CST);
+
+  // the flusher sets m_flusher_waiting before rechecking m_new_head,
+  // so either it sees our entry or we see the flag and signal
+  if (__atomic_load_n(&m_flusher_waiting, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&m_queue_mutex);
+    pthread_cond_signal(&m_cond_flusher);
+    pthread_mutex_unlock(&m_queue_mutex);
+  }
 }
 
 
@@ -268,17 +288,41 @@ Entry *Log::create_entry(int level, int subsys, size_t* expected_size)
   }
 }
 
+void Log::_take_new(EntryQueue *t)
+{
+  // grab the whole lock-free list and restore submission order
+  Entry *head = __atomic_exchange_n(&m_new_head, (Entry*)NULL,
+				    __ATOMIC_ACQUIRE);
+  Entry *rev = NULL;
+  int n = 0;
+  while (head) {
+    Entry *next = head->m_next;
+    head->m_next = rev;
+    rev = head;
+    head = next;
+    n++;
+  }
+  while (rev) {
+    Entry *next = rev->m_next;
+    rev->m_next = NULL;
+    t->enqueue(rev);
+    rev = next;
+  }
+  if (n) {
+    __atomic_sub_fetch(&m_new_len, n, __ATOMIC_SEQ_CST);
+    // wake any loggers stalled on m_max_new
+    pthread_mutex_lock(&m_queue_mutex);
+    pthread_cond_broadcast(&m_cond_loggers);
+    pthread_mutex_unlock(&m_queue_mutex);
+  }
+}
+
 void Log::flush()
 {
   pthread_mutex_lock(&m_flush_mutex);
   m_flush_mutex_holder = pthread_self();
-  pthread_mutex_lock(&m_queue_mutex);
-  m_queue_mutex_holder = pthread_self();
   EntryQueue t;
-  t.swap(m_new);
-  pthread_cond_broadcast(&m_cond_loggers);
-  m_queue_mutex_holder = 0;
-  pthread_mutex_unlock(&m_queue_mutex);
+  _take_new(&t);
   _flush(&t, &m_recent, false);
 
   // trim
@@ -382,14 +426,8 @@ void Log::dump_recent()
   pthread_mutex_lock(&m_flush_mutex);
   m_flush_mutex_holder = pthread_self();
 
-  pthread_mutex_lock(&m_queue_mutex);
-  m_queue_mutex_holder = pthread_self();
-
   EntryQueue t;
-  t.swap(m_new);
-
-  m_queue_mutex_holder = 0;
-  pthread_mutex_unlock(&m_queue_mutex);
+  _take_new(&t);
   _flush(&t, &m_recent, false);
 
   EntryQueue old;
@@ -447,7 +485,7 @@ void *Log::entry()
   pthread_mutex_lock(&m_queue_mutex);
   m_queue_mutex_holder = pthread_self();
   while (!m_stop) {
-    if (!m_new.empty()) {
+    if (__atomic_load_n(&m_new_head, __ATOMIC_RELAXED)) {
       m_queue_mutex_holder = 0;
       pthread_mutex_unlock(&m_queue_mutex);
       flush();
@@ -456,7 +494,12 @@ void *Log::entry()
       continue;
     }
 
-    pthread_cond_wait(&m_cond_flusher, &m_queue_mutex);
+    // advertise that we are about to sleep, then recheck; submitters
+    // push before testing the flag, so we cannot sleep over an entry
+    __atomic_store_n(&m_flusher_waiting, true, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&m_new_head, __ATOMIC_SEQ_CST))
+      pthread_cond_wait(&m_cond_flusher, &m_queue_mutex);
+    __atomic_store_n(&m_flusher_waiting, false, __ATOMIC_SEQ_CST);
   }
   m_queue_mutex_holder = 0;
   pthread_mutex_unlock(&m_queue_mutex);
@@ -31,7 +31,12 @@ class Log : private Thread
   pthread_t m_queue_mutex_holder;
   pthread_t m_flush_mutex_holder;
 
-  EntryQueue m_new;    ///< new entries
+  Entry *m_new_head;   ///< new entries; lock-free LIFO, submitters push
+		       ///< with a cas and the flusher takes the whole
+		       ///< list with an exchange
+  int m_new_len;       ///< number of entries on m_new_head
+  bool m_flusher_waiting; ///< flusher advertised it is about to sleep
+
   EntryQueue m_recent; ///< recent (less new) entries we've already written at low detail
 
   std::string m_log_file;
@@ -55,6 +60,7 @@ class Log : private Thread
 
   void *entry();
 
+  void _take_new(EntryQueue *t);
   void _flush(EntryQueue *q, EntryQueue *requeue, bool crash);
 
   void _log_message(const char *s, bool crash);
@@ -9,6 +9,14 @@
 
 #include "include/assert.h"
 
+// Debug statements with a level above this ceiling are compiled out
+// entirely; see should_gather<>() below and dout_impl.  The default
+// keeps them all.  Release builds that want hot-path douts to cost
+// nothing can build with e.g. -DCEPH_MAX_DEBUG_LEVEL=1.
+#ifndef CEPH_MAX_DEBUG_LEVEL
+#define CEPH_MAX_DEBUG_LEVEL 200
+#endif
+
 namespace ceph {
 namespace log {
 
@@ -63,6 +71,19 @@ public:
     return level <= m_subsys[sub].gather_level ||
       level <= m_subsys[sub].log_level;
   }
+
+  // Variant for call sites where the subsystem and level are known at
+  // compile time: levels above the compiled-in ceiling short-circuit
+  // to a constant false, so the whole statement is dead code the
+  // compiler removes; below it the usual runtime check against the
+  // (adjustable) configured levels applies.
+  template <unsigned SubV, int LvlV>
+  bool should_gather() {
+    static_assert(LvlV >= -1 && LvlV <= 200, "invalid debug level");
+    if (LvlV > CEPH_MAX_DEBUG_LEVEL)
+      return false;
+    return should_gather(SubV, LvlV);
+  }
 };
 
 }
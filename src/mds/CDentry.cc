@@ -162,8 +162,9 @@ void CDentry::_mark_dirty(LogSegment *ls)
     get(PIN_DIRTY);
     assert(ls);
   }
-  if (ls) 
+  if (ls)
     ls->dirty_dentries.push_back(&item_dirty);
+  dir->dirty_dentries.push_back(&item_dir_dirty);
 }
 
 void CDentry::mark_dirty(version_t pv, LogSegment *ls) 
@@ -194,6 +195,7 @@ void CDentry::mark_clean()
   put(PIN_DIRTY);
   
   item_dirty.remove_myself();
+  item_dir_dirty.remove_myself();
 
   clear_new();
 }    
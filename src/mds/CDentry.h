@@ -152,6 +152,7 @@ protected:
 
 public:
   elist<CDentry*>::item item_dirty;
+  elist<CDentry*>::item item_dir_dirty;
   elist<CDentry*>::item item_stray;
 
 protected:
@@ -180,6 +181,7 @@ public:
     dir(0),
     version(0), projected_version(0),
     item_dirty(this),
+    item_dir_dirty(this),
     lock(this, &lock_type),
     versionlock(this, &versionlock_type) {
     g_num_dn++;
@@ -192,6 +194,7 @@ public:
     dir(0),
     version(0), projected_version(0),
     item_dirty(this),
+    item_dir_dirty(this),
     lock(this, &lock_type),
     versionlock(this, &versionlock_type) {
     g_num_dn++;
@@ -188,7 +188,9 @@ CDir::CDir(CInode *in, frag_t fg, MDCache *mdcache, bool auth) :
   scrub_infop(NULL),
   num_head_items(0), num_head_null(0),
   num_snap_items(0), num_snap_null(0),
-  num_dirty(0), committing_version(0), committed_version(0),
+  num_dirty(0),
+  dirty_dentries(member_offset(CDentry, item_dir_dirty)),
+  committing_version(0), committed_version(0),
   dir_auth_pins(0), request_pins(0),
   dir_rep(REP_NONE),
   pop_me(ceph_clock_now(g_ceph_context)),
@@ -846,8 +848,10 @@ void CDir::steal_dentry(CDentry *dn)
     dn->dir->adjust_nested_auth_pins(-ap, -dap, NULL);
   }
 
-  if (dn->is_dirty()) 
+  if (dn->is_dirty()) {
     num_dirty++;
+    dirty_dentries.push_back(&dn->item_dir_dirty);
+  }
 
   dn->dir = this;
 }
@@ -1487,22 +1491,60 @@ void CDir::fetch(MDSInternalContextBase *c, const std::set<dentry_key_t>& keys)
   _omap_fetch(c, keys);
 }
 
+class C_IO_Dir_OMAP_FetchedMore : public CDirIOContext {
+  MDSInternalContextBase *fin;
+public:
+  bufferlist hdrbl;  ///< carried over from the first batch
+  map<string, bufferlist> omap;      ///< carry-over from previous batches
+  map<string, bufferlist> omap_more; ///< new batch
+  int ret;
+  C_IO_Dir_OMAP_FetchedMore(CDir *d, MDSInternalContextBase *f) :
+    CDirIOContext(d), fin(f), ret(0) { }
+  void finish(int r) {
+    // a full batch implies there may be more keys after the last one
+    bool more = (r >= 0 &&
+		 omap_more.size() == (size_t)g_conf->mds_dir_keys_per_op);
+
+    // merge results
+    if (omap.empty()) {
+      omap.swap(omap_more);
+    } else {
+      omap.insert(omap_more.begin(), omap_more.end());
+    }
+
+    if (more) {
+      dir->_omap_fetch_more(hdrbl, omap, fin);
+    } else {
+      dir->_omap_fetched(hdrbl, omap, !fin, r);
+      if (fin)
+	fin->complete(r);
+    }
+  }
+};
+
 class C_IO_Dir_OMAP_Fetched : public CDirIOContext {
   MDSInternalContextBase *fin;
 public:
+  bool paged;  ///< reading the whole dirfrag in bounded batches?
   bufferlist hdrbl;
   map<string, bufferlist> omap;
   bufferlist btbl;
   int ret1, ret2, ret3;
 
   C_IO_Dir_OMAP_Fetched(CDir *d, MDSInternalContextBase *f) :
-    CDirIOContext(d), fin(f), ret1(0), ret2(0), ret3(0) { }
+    CDirIOContext(d), fin(f), paged(false), ret1(0), ret2(0), ret3(0) { }
   void finish(int r) {
     // check the correctness of backtrace
     if (r >= 0 && ret3 != -ECANCELED)
       dir->inode->verify_diri_backtrace(btbl, ret3);
     if (r >= 0) r = ret1;
     if (r >= 0) r = ret2;
+    if (paged && r >= 0 &&
+	omap.size() == (size_t)g_conf->mds_dir_keys_per_op) {
+      // there may be more keys; fetch the next batch before applying
+      dir->_omap_fetch_more(hdrbl, omap, fin);
+      return;
+    }
     dir->_omap_fetched(hdrbl, omap, !fin, r);
     if (fin)
       fin->complete(r);
@@ -1518,7 +1560,12 @@ void CDir::_omap_fetch(MDSInternalContextBase *c, const std::set<dentry_key_t>&
   rd.omap_get_header(&fin->hdrbl, &fin->ret1);
   if (keys.empty()) {
     assert(!c);
-    rd.omap_get_vals("", "", (uint64_t)-1, &fin->omap, &fin->ret2);
+    // read the dirfrag in bounded batches rather than in one huge omap
+    // operation, so a giant directory doesn't generate an unbounded osd
+    // read or stall other omap activity on the object
+    fin->paged = true;
+    rd.omap_get_vals("", "", g_conf->mds_dir_keys_per_op,
+		     &fin->omap, &fin->ret2);
   } else {
     assert(c);
     std::set<std::string> str_keys;
@@ -1541,6 +1588,25 @@ void CDir::_omap_fetch(MDSInternalContextBase *c, const std::set<dentry_key_t>&
 			     new C_OnFinisher(fin, cache->mds->finisher));
 }
 
+void CDir::_omap_fetch_more(bufferlist& hdrbl, map<string, bufferlist>& omap,
+			    MDSInternalContextBase *c)
+{
+  // we have more omap keys to fetch!
+  object_t oid = get_ondisk_object();
+  object_locator_t oloc(cache->mds->mdsmap->get_metadata_pool());
+  C_IO_Dir_OMAP_FetchedMore *fin = new C_IO_Dir_OMAP_FetchedMore(this, c);
+  fin->hdrbl.claim(hdrbl);
+  fin->omap.swap(omap);
+  ObjectOperation rd;
+  rd.omap_get_vals(fin->omap.rbegin()->first,
+		   "", /* filter prefix */
+		   g_conf->mds_dir_keys_per_op,
+		   &fin->omap_more,
+		   &fin->ret);
+  cache->mds->objecter->read(oid, oloc, rd, CEPH_NOSNAP, NULL, 0,
+			     new C_OnFinisher(fin, cache->mds->finisher));
+}
+
 CDentry *CDir::_load_dentry(
     const std::string &key,
     const std::string &dname,
@@ -2028,10 +2094,27 @@ void CDir::_omap_commit(int op_prio)
     stale_items.clear();
   }
 
-  for (map_t::iterator p = items.begin();
-      p != items.end(); ) {
-    CDentry *dn = p->second;
-    ++p;
+  // snap purges and fragmenting need to look at every dentry; otherwise
+  // only the dentries dirtied since the last commit matter, which for a
+  // huge fragment with a few changed entries is a tiny fraction
+  bool walk_all = snaps || state_test(CDir::STATE_FRAGMENTING);
+
+  map_t::iterator ip = items.begin();
+  elist<CDentry*>::iterator dp = dirty_dentries.begin();
+
+  while (true) {
+    CDentry *dn;
+    if (walk_all) {
+      if (ip == items.end())
+	break;
+      dn = ip->second;
+      ++ip;
+    } else {
+      if (dp.end())
+	break;
+      dn = *dp;
+      ++dp;
+    }
 
     string key;
     dn->key().encode(key);
@@ -347,6 +347,10 @@ protected:
 
   int num_dirty;
 
+  // dentries dirtied since the last commit, so _omap_commit can walk
+  // just the delta instead of every dentry in the fragment
+  elist<CDentry*> dirty_dentries;
+
   // state
   version_t committing_version;
   version_t committed_version;
@@ -382,6 +386,7 @@ protected:
 
   // friends
   friend class Migrator;
+  friend class CDentry;
   friend class CInode;
   friend class MDCache;
   friend class MDiscover;
@@ -391,6 +396,7 @@ protected:
   friend class CDirExport;
   friend class C_IO_Dir_TMAP_Fetched;
   friend class C_IO_Dir_OMAP_Fetched;
+  friend class C_IO_Dir_OMAP_FetchedMore;
   friend class C_IO_Dir_Committed;
 
   bloom_filter *bloom;
@@ -605,6 +611,10 @@ protected:
   compact_set<string> wanted_items;
 
   void _omap_fetch(MDSInternalContextBase *fin, const std::set<dentry_key_t>& keys);
+  void _omap_fetch_more(
+      bufferlist& hdrbl,
+      std::map<std::string, bufferlist>& omap,
+      MDSInternalContextBase *fin);
   CDentry *_load_dentry(
       const std::string &key,
       const std::string &dname,
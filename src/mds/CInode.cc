@@ -2768,6 +2768,8 @@ Capability *CInode::add_client_cap(client_t client, Session *session, SnapRealm
       containing_realm = find_snaprealm();
     containing_realm->inodes_with_caps.push_back(&item_caps);
     dout(10) << "add_client_cap first cap, joining realm " << *containing_realm << dendl;
+
+    mdcache->open_file_table.add_inode(this);
   }
 
   mdcache->num_caps++;
@@ -2777,6 +2779,7 @@ Capability *CInode::add_client_cap(client_t client, Session *session, SnapRealm
   Capability *cap = new Capability(this, ++mdcache->last_cap_id, client);
   assert(client_caps.count(client) == 0);
   client_caps[client] = cap;
+  invalidate_caps_wanted();
 
   session->add_cap(cap);
   if (session->is_stale())
@@ -2804,6 +2807,7 @@ void CInode::remove_client_cap(client_t client)
 
   delete cap;
   client_caps.erase(client);
+  invalidate_caps_wanted();
   if (client_caps.empty()) {
     dout(10) << "remove_client_cap last cap, leaving realm " << *containing_realm << dendl;
     put(PIN_CAPS);
@@ -2811,6 +2815,7 @@ void CInode::remove_client_cap(client_t client)
     containing_realm = NULL;
     item_open_file.remove_myself();  // unpin logsegment
     mdcache->num_inodes_with_caps--;
+    mdcache->open_file_table.remove_inode(this);
   }
   mdcache->num_caps--;
 
@@ -2988,6 +2993,18 @@ bool CInode::is_any_caps_wanted() const
 
 int CInode::get_caps_wanted(int *ploner, int *pother, int shift, int mask) const
 {
+  // eval of each lock asks the same question; reuse the cached aggregate
+  // if nothing changed it.  (loner_cap can flip without notice, so it is
+  // snapshotted; caching is skipped while other mds's want caps, which
+  // adds an is_auth() dependency we'd otherwise have to track.)
+  if (caps_wanted_valid &&
+      cached_caps_wanted_loner == loner_cap &&
+      mds_caps_wanted.empty()) {
+    if (ploner) *ploner = (cached_loner_caps_wanted >> shift) & mask;
+    if (pother) *pother = (cached_other_caps_wanted >> shift) & mask;
+    return (cached_caps_wanted >> shift) & mask;
+  }
+
   int w = 0;
   int loner = 0, other = 0;
   for (map<client_t,Capability*>::const_iterator it = client_caps.begin();
@@ -2999,7 +3016,7 @@ int CInode::get_caps_wanted(int *ploner, int *pother, int shift, int mask) const
       if (it->first == loner_cap)
 	loner |= t;
       else
-	other |= t;	
+	other |= t;
     }
     //cout << " get_caps_wanted client " << it->first << " " << cap_string(it->second.wanted()) << endl;
   }
@@ -3011,6 +3028,13 @@ int CInode::get_caps_wanted(int *ploner, int *pother, int shift, int mask) const
       other |= it->second;
       //cout << " get_caps_wanted mds " << it->first << " " << cap_string(it->second) << endl;
     }
+  if (mds_caps_wanted.empty()) {
+    cached_caps_wanted = w;
+    cached_loner_caps_wanted = loner;
+    cached_other_caps_wanted = other;
+    cached_caps_wanted_loner = loner_cap;
+    caps_wanted_valid = true;
+  }
   if (ploner) *ploner = (loner >> shift) & mask;
   if (pother) *pother = (other >> shift) & mask;
   return (w >> shift) & mask;
@@ -3774,6 +3798,29 @@ void CInode::validate_disk_state(CInode::validated_data *results,
       C_OnFinisher *conf = new C_OnFinisher(get_io_callback(BACKTRACE),
                                             in->mdcache->mds->finisher);
 
+      if (in->scrub_infop && in->scrub_infop->backtrace_prefetched) {
+        // the ScrubStack already read this backtrace as part of a bulk
+        // fetch; skip the per-inode getxattr and just write the tag
+        results->backtrace.ondisk_read_retval = in->scrub_infop->backtrace_rval;
+        bl = in->scrub_infop->backtrace_bl;
+        if (in->scrub_infop->header &&
+            !in->scrub_infop->header->tag.empty()) {
+          const int64_t pool = in->get_backtrace_pool();
+          object_t oid = CInode::get_object_name(in->ino(), frag_t(), "");
+          ObjectOperation scrub_tag;
+          bufferlist tag_bl;
+          ::encode(in->scrub_infop->header->tag, tag_bl);
+          scrub_tag.setxattr("scrub_tag", tag_bl);
+          SnapContext snapc;
+          in->mdcache->mds->objecter->mutate(oid, object_locator_t(pool),
+                                             scrub_tag, snapc,
+                                             ceph::real_clock::now(g_ceph_context),
+                                             0, NULL, NULL);
+        }
+        conf->complete(0);
+        return false;
+      }
+
       // Whether we have a tag to apply depends on ScrubHeader (if one is
       // present)
       if (in->scrub_infop && in->scrub_infop->header) {
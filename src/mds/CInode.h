@@ -278,10 +278,18 @@ public:
 
     ScrubHeaderRefConst header;
 
+    /// backtrace read in bulk by the ScrubStack ahead of validation
+    bool backtrace_fetching;
+    bool backtrace_prefetched;
+    int backtrace_rval;
+    bufferlist backtrace_bl;
+
     scrub_info_t() : scrub_stamp_info_t(),
 	scrub_parent(NULL), on_finish(NULL),
 	last_scrub_dirty(false), scrub_in_progress(false),
-	children_scrubbed(false) {}
+	children_scrubbed(false),
+	backtrace_fetching(false), backtrace_prefetched(false),
+	backtrace_rval(0) {}
   };
 
   const scrub_info_t *scrub_info() const{
@@ -345,6 +353,23 @@ public:
     assert(!scrub_infop->on_finish);
     scrub_infop->on_finish = c;
   }
+  bool scrub_is_backtrace_fetching() const {
+    return scrub_infop && scrub_infop->backtrace_fetching;
+  }
+  bool scrub_is_backtrace_prefetched() const {
+    return scrub_infop && scrub_infop->backtrace_prefetched;
+  }
+  void scrub_backtrace_fetch_start() {
+    assert(scrub_infop);
+    scrub_infop->backtrace_fetching = true;
+  }
+  void scrub_backtrace_fetched(int r, bufferlist& bl) {
+    assert(scrub_infop);
+    scrub_infop->backtrace_fetching = false;
+    scrub_infop->backtrace_prefetched = true;
+    scrub_infop->backtrace_rval = r;
+    scrub_infop->backtrace_bl.claim(bl);
+  }
 
 private:
   /**
@@ -643,6 +668,7 @@ public:
   friend class Migrator;
   friend class MDCache;
   friend class StrayManager;
+  friend class ScrubStack;
   friend class CDir;
   friend class CInodeExport;
 
@@ -677,7 +703,10 @@ public:
     nestlock(this, &nestlock_type),
     flocklock(this, &flocklock_type),
     policylock(this, &policylock_type),
-    loner_cap(-1), want_loner_cap(-1)
+    loner_cap(-1), want_loner_cap(-1),
+    cached_caps_wanted(0), cached_loner_caps_wanted(0),
+    cached_other_caps_wanted(0), cached_caps_wanted_loner(-1),
+    caps_wanted_valid(false)
   {
     g_num_ino++;
     g_num_inoa++;
@@ -920,6 +949,18 @@ public:
   // client caps
   client_t loner_cap, want_loner_cap;
 
+  /* cached aggregate of the clients' wanted bits, so the lock eval paths
+   * don't walk client_caps over and over; see get_caps_wanted().  Only
+   * valid while no cap's wanted/stale state changes (the Capability
+   * mutators and [add|remove]_client_cap invalidate it). */
+  mutable int cached_caps_wanted;
+  mutable int cached_loner_caps_wanted;
+  mutable int cached_other_caps_wanted;
+  mutable client_t cached_caps_wanted_loner;
+  mutable bool caps_wanted_valid;
+
+  void invalidate_caps_wanted() { caps_wanted_valid = false; }
+
   client_t get_loner() const { return loner_cap; }
   client_t get_wanted_loner() const { return want_loner_cap; }
 
@@ -13,6 +13,7 @@
  */
 
 #include "Capability.h"
+#include "CInode.h"
 
 #include "common/Formatter.h"
 
@@ -141,6 +142,28 @@ void Capability::revoke_info::generate_test_instances(list<Capability::revoke_in
  * Capability
  */
 
+void Capability::set_wanted(int w)
+{
+  if (_wanted != w && inode)
+    inode->invalidate_caps_wanted();
+  _wanted = w;
+  //check_rdcaps_list();
+}
+
+void Capability::mark_stale()
+{
+  if (!is_stale() && inode)
+    inode->invalidate_caps_wanted();
+  state |= STATE_STALE;
+}
+
+void Capability::clear_stale()
+{
+  if (is_stale() && inode)
+    inode->invalidate_caps_wanted();
+  state &= ~STATE_STALE;
+}
+
 void Capability::encode(bufferlist& bl) const
 {
   ENCODE_START(2, 2, bl)
@@ -159,11 +182,13 @@ void Capability::decode(bufferlist::iterator &bl)
   ::decode(last_sent, bl);
   ::decode(last_issue_stamp, bl);
 
-  ::decode(_wanted, bl);
+  __u32 new_wanted;
+  ::decode(new_wanted, bl);
+  set_wanted(new_wanted);
   ::decode(_pending, bl);
   ::decode(_revokes, bl);
   DECODE_FINISH(bl);
-  
+
   _calc_issued();
 }
 
@@ -827,6 +827,8 @@ void MDBalancer::find_exports(CDir *dir,
   list<CDir*> bigger_rep, bigger_unrep;
   multimap<double, CDir*> smaller;
 
+  uint64_t size_limit = g_conf->mds_bal_max_export_size;
+
   double dir_pop = dir->pop_auth_subtree.meta_load(rebalance_time, mds->mdcache->decayrate);
   dout(7) << " find_exports in " << dir_pop << " " << *dir << " need " << need << " (" << needmin << " - " << needmax << ")" << dendl;
 
@@ -856,15 +858,23 @@ void MDBalancer::find_exports(CDir *dir,
 
       if (pop < minchunk) continue;
 
+      // too many entries to freeze and migrate in one go?  descend and
+      // pick out the hot fragments instead of moving the whole subtree.
+      bool too_big = (size_limit > 0 &&
+		      (uint64_t)subdir->fnode.rstat.rsize() > size_limit);
+      if (too_big)
+	dout(15) << "   too big (" << subdir->fnode.rstat.rsize()
+		 << " entries) " << *subdir << dendl;
+
       // lucky find?
-      if (pop > needmin && pop < needmax) {
+      if (!too_big && pop > needmin && pop < needmax) {
 	exports.push_back(subdir);
 	already_exporting.insert(subdir);
 	have += pop;
 	return;
       }
 
-      if (pop > need) {
+      if (pop > need || too_big) {
 	if (subdir->is_rep())
 	  bigger_rep.push_back(subdir);
 	else
@@ -169,6 +169,7 @@ MDCache::MDCache(MDSRank *m) :
   mds(m),
   logger(0),
   filer(m->objecter, m->finisher),
+  open_file_table(m),
   rejoin_done(NULL),
   resolve_done(NULL),
   recovery_queue(m),
@@ -7716,6 +7717,64 @@ MDSInternalContextBase *MDCache::_get_waiter(MDRequestRef& mdr, Message *req, MD
   }
 }
 
+class C_MDC_TraversePrefetch : public MDCacheContext {
+  CDir *dir;
+  filepath want;
+  MDSInternalContextBase *fin;
+public:
+  C_MDC_TraversePrefetch(MDCache *c, CDir *d, const filepath& w,
+			 MDSInternalContextBase *f=NULL) :
+    MDCacheContext(c), dir(d), want(w), fin(f) {}
+  void finish(int r) {
+    if (r == 0)
+      mdcache->prefetch_traverse_path(dir, want);
+    if (fin)
+      fin->complete(r);
+  }
+};
+
+void MDCache::prefetch_traverse_path(CDir *dir, const filepath& path)
+{
+  CDir *curdir = dir;
+  unsigned depth = 0;
+  while (depth < path.depth()) {
+    CDentry *dn = curdir->lookup(path[depth]);
+    if (!dn)
+      break;
+    CDentry::linkage_t *dnl = dn->get_linkage();
+    if (!dnl->is_primary())
+      break;
+    CInode *in = dnl->get_inode();
+    if (!in->is_dir() || !in->is_auth() || in->is_frozen())
+      break;
+
+    depth++;
+    if (depth == path.depth())
+      break;  // nothing left to look up
+
+    frag_t fg = in->pick_dirfrag(path[depth]);
+    curdir = in->get_or_open_dirfrag(this, fg);
+    if (curdir->is_complete())
+      continue;  // next component is answerable from cache
+
+    // worth (and safe to) fetch?
+    if (!curdir->is_auth() ||
+	!curdir->can_auth_pin() ||
+	curdir->state_test(CDir::STATE_FETCHING) ||
+	(curdir->has_bloom() && !curdir->is_in_bloom(path[depth])) ||
+	mds->damage_table.is_dirfrag_damaged(curdir))
+      break;
+
+    dout(10) << "prefetch_traverse_path fetching '" << path[depth]
+	     << "' in " << *curdir << dendl;
+    curdir->fetch(new C_MDC_TraversePrefetch(this, curdir,
+					     path.postfixpath(depth)),
+		  path[depth]);
+    if (mds->logger) mds->logger->inc(l_mds_traverse_dir_fetch);
+    return;
+  }
+}
+
 int MDCache::path_traverse(MDRequestRef& mdr, Message *req, MDSInternalContextBase *fin,     // who
 			   const filepath& path,                   // what
                            vector<CDentry*> *pdnvec,         // result
@@ -7979,7 +8038,15 @@ int MDCache::path_traverse(MDRequestRef& mdr, Message *req, MDSInternalContextBa
 	// directory isn't complete; reload
         dout(7) << "traverse: incomplete dir contents for " << *cur << ", fetching" << dendl;
         touch_inode(cur);
-        curdir->fetch(_get_waiter(mdr, req, fin), path[depth]);
+	MDSInternalContextBase *c = _get_waiter(mdr, req, fin);
+	if (g_conf->mds_traverse_prefetch &&
+	    snapid == CEPH_NOSNAP && depth + 1 < path.depth()) {
+	  // start pulling in the rest of the path as soon as this fetch
+	  // lands, ahead of the request retry re-traversing to it
+	  c = new C_MDC_TraversePrefetch(this, curdir,
+					 path.postfixpath(depth), c);
+	}
+        curdir->fetch(c, path[depth]);
 	if (mds->logger) mds->logger->inc(l_mds_traverse_dir_fetch);
         return 1;
       }
@@ -9400,6 +9467,45 @@ void MDCache::fetch_backtrace(inodeno_t ino, int64_t pool, bufferlist& bl, Conte
   mds->objecter->getxattr(oid, object_locator_t(pool), "parent", CEPH_NOSNAP, &bl, 0, fin);
 }
 
+struct C_MDC_BacktraceRval : public Context {
+  int *prval;
+  Context *fin;
+  C_MDC_BacktraceRval(int *p, Context *f) : prval(p), fin(f) {}
+  void finish(int r) {
+    *prval = r;
+    fin->complete(r);
+  }
+};
+
+/*
+ * Fetch backtraces for a batch of inodes in parallel, invoking fin once
+ * all of them have come back. Per-inode retvals and backtrace blobs land
+ * in *results, which must stay alive until fin fires.
+ */
+void MDCache::fetch_backtraces(const std::vector<std::pair<inodeno_t, int64_t> >& fetches,
+			       std::map<inodeno_t, std::pair<int, bufferlist> > *results,
+			       Context *fin)
+{
+  assert(!fetches.empty());
+
+  // create all the result slots up front; the completions fill them in
+  // from objecter threads and must not touch the map structure itself
+  for (std::vector<std::pair<inodeno_t, int64_t> >::const_iterator p = fetches.begin();
+       p != fetches.end(); ++p)
+    (*results)[p->first].first = 0;
+
+  C_GatherBuilder gather(g_ceph_context, fin);
+  for (std::vector<std::pair<inodeno_t, int64_t> >::const_iterator p = fetches.begin();
+       p != fetches.end(); ++p) {
+    std::pair<int, bufferlist>& slot = (*results)[p->first];
+    object_t oid = CInode::get_object_name(p->first, frag_t(), "");
+    mds->objecter->getxattr(oid, object_locator_t(p->second), "parent",
+			    CEPH_NOSNAP, &slot.second, 0,
+			    new C_MDC_BacktraceRval(&slot.first, gather.new_sub()));
+  }
+  gather.activate();
+}
+
 
 
 
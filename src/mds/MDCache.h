@@ -29,6 +29,7 @@
 #include "events/EMetaBlob.h"
 #include "RecoveryQueue.h"
 #include "StrayManager.h"
+#include "OpenFileTable.h"
 #include "MDSContext.h"
 #include "MDSMap.h"
 
@@ -169,6 +170,8 @@ public:
   int num_inodes_with_caps;
   int num_caps;
 
+  OpenFileTable open_file_table;
+
   unsigned max_dir_commit_size;
 
   static file_layout_t gen_default_file_layout(const MDSMap &mdsmap);
@@ -878,6 +881,19 @@ public:
    */
   int path_traverse(MDRequestRef& mdr, Message *req, MDSInternalContextBase *fin, const filepath& path,
 		    vector<CDentry*> *pdnvec, CInode **pin, int onfail);
+
+  /**
+   * Speculatively pull the dirfrags along a path into cache.  Called
+   * after a dirfrag fetch during traversal completes: walk the remaining
+   * path as far as the cache allows and kick off the fetch of the next
+   * missing dirfrag, chaining further fetches from its completion.  This
+   * overlaps the reads for deep cold paths with request re-dispatch
+   * instead of paying a full retry cycle per component.
+   *
+   * @param dir The dirfrag that was just fetched.
+   * @param path The remaining path; path[0] names a dentry in dir.
+   */
+  void prefetch_traverse_path(CDir *dir, const filepath& path);
   bool path_is_mine(filepath& path);
   bool path_is_mine(string& p) {
     filepath path(p, 1);
@@ -974,6 +990,9 @@ public:
 public:
   void eval_remote(CDentry *dn);
   void fetch_backtrace(inodeno_t ino, int64_t pool, bufferlist& bl, Context *fin);
+  void fetch_backtraces(const std::vector<std::pair<inodeno_t, int64_t> >& fetches,
+			std::map<inodeno_t, std::pair<int, bufferlist> > *results,
+			Context *fin);
   uint64_t get_num_strays() const { return stray_manager.get_num_strays(); }
 
 protected:
@@ -406,9 +406,6 @@ void MDLog::_submit_thread()
       journaler->wait_for_flush(new C_MDL_Flushed(
             this, new_write_pos, data.fin));
 
-      if (data.flush)
-	journaler->flush();
-
       if (logger)
 	logger->set(l_mdl_wrpos, ls->end);
 
@@ -416,14 +413,34 @@ void MDLog::_submit_thread()
     } else {
       journaler->wait_for_flush(new C_MDL_Flushed(
             this, journaler->get_write_pos(), data.fin));
-      if (data.flush)
-	journaler->flush();
     }
 
     submit_mutex.Lock();
-    if (data.flush)
-      unflushed = 0;
-    else if (data.le)
+    if (data.flush) {
+      // if more events are already queued behind us, carry the flush
+      // to the back of the queue: a burst of updates (e.g. a client
+      // streaming creates) then shares one journaler flush and their
+      // safe callbacks complete together off that single write
+      bool deferred = false;
+      for (map<uint64_t,list<PendingEvent> >::reverse_iterator p =
+	     pending_events.rbegin();
+	   p != pending_events.rend(); ++p) {
+	if (!p->second.empty()) {
+	  p->second.back().flush = true;
+	  deferred = true;
+	  break;
+	}
+      }
+      if (deferred) {
+	if (data.le)
+	  unflushed++;
+      } else {
+	submit_mutex.Unlock();
+	journaler->flush();
+	submit_mutex.Lock();
+	unflushed = 0;
+      }
+    } else if (data.le)
       unflushed++;
   }
 
@@ -1232,6 +1249,12 @@ void MDLog::_replay_thread()
 {
   dout(10) << "_replay_thread start" << dendl;
 
+  bool pipelined = (g_conf->mds_log_replay_queue_events > 0);
+  if (pipelined) {
+    replay_queue_eof = false;
+    replay_apply_thread.create("md_log_apply");
+  }
+
   // loop
   int r = 0;
   while (1) {
@@ -1364,7 +1387,12 @@ void MDLog::_replay_thread()
       le->_segment->end = journaler->get_read_pos();
       num_events++;
 
-      {
+      if (pipelined) {
+        /* hand the decoded event to the apply thread and go decode the
+         * next one */
+        queue_replay_event(le, pos);
+        le = NULL;
+      } else {
         Mutex::Locker l(mds->mds_lock);
         if (mds->is_daemon_stopping()) {
           return;
@@ -1374,7 +1402,23 @@ void MDLog::_replay_thread()
     }
     delete le;
 
-    logger->set(l_mdl_rdpos, pos);
+    if (!pipelined)
+      logger->set(l_mdl_rdpos, pos);
+
+    if (pipelined && mds->is_daemon_stopping())
+      break;
+  }
+
+  if (pipelined) {
+    // wait for the apply thread to drain the queue
+    replay_queue_lock.Lock();
+    replay_queue_eof = true;
+    replay_queue_cond.Signal();
+    replay_queue_lock.Unlock();
+    replay_apply_thread.join();
+    if (mds->is_daemon_stopping()) {
+      return;
+    }
   }
 
   // done!
@@ -1400,6 +1444,51 @@ void MDLog::_replay_thread()
   dout(10) << "_replay_thread finish" << dendl;
 }
 
+void MDLog::queue_replay_event(LogEvent *le, uint64_t pos)
+{
+  Mutex::Locker l(replay_queue_lock);
+  while ((int)replay_queue.size() >= g_conf->mds_log_replay_queue_events) {
+    replay_queue_cond.Wait(replay_queue_lock);
+  }
+  replay_queue.push_back(make_pair(le, pos));
+  replay_queue_cond.Signal();
+}
+
+void MDLog::_replay_apply_thread()
+{
+  dout(10) << "_replay_apply_thread start" << dendl;
+
+  replay_queue_lock.Lock();
+  while (true) {
+    while (replay_queue.empty() && !replay_queue_eof) {
+      replay_queue_cond.Wait(replay_queue_lock);
+    }
+    if (replay_queue.empty()) {
+      break;
+    }
+    LogEvent *le = replay_queue.front().first;
+    uint64_t pos = replay_queue.front().second;
+    replay_queue.pop_front();
+    replay_queue_cond.Signal();    // wake the decoder if it was throttled
+    replay_queue_lock.Unlock();
+
+    {
+      Mutex::Locker l(mds->mds_lock);
+      if (!mds->is_daemon_stopping()) {
+        le->replay(mds);
+      }
+    }
+    delete le;
+
+    logger->set(l_mdl_rdpos, pos);
+
+    replay_queue_lock.Lock();
+  }
+  replay_queue_lock.Unlock();
+
+  dout(10) << "_replay_apply_thread finish" << dendl;
+}
+
 void MDLog::standby_trim_segments()
 {
   dout(10) << "standby_trim_segments" << dendl;
@@ -95,13 +95,34 @@ protected:
   } replay_thread;
   bool already_replayed;
 
+  /* pipelined replay: _replay_thread reads and decodes journal events
+   * and queues them, while ReplayApplyThread applies them in order under
+   * mds_lock, so decode overlaps with cache application */
+  class ReplayApplyThread : public Thread {
+    MDLog *log;
+  public:
+    explicit ReplayApplyThread(MDLog *l) : log(l) {}
+    void* entry() {
+      log->_replay_apply_thread();
+      return 0;
+    }
+  } replay_apply_thread;
+
+  Mutex replay_queue_lock;
+  Cond replay_queue_cond;
+  list<pair<LogEvent*, uint64_t> > replay_queue;
+  bool replay_queue_eof;
+
   friend class ReplayThread;
   friend class C_MDL_Replay;
+  friend class ReplayApplyThread;
 
   list<MDSInternalContextBase*> waitfor_replay;
 
   void _replay();         // old way
   void _replay_thread();  // new way
+  void _replay_apply_thread();
+  void queue_replay_event(LogEvent *le, uint64_t pos);
 
   // Journal recovery/rewrite logic
   class RecoveryThread : public Thread {
@@ -191,6 +212,9 @@ public:
                       logger(0),
                       replay_thread(this),
                       already_replayed(false),
+                      replay_apply_thread(this),
+                      replay_queue_lock("MDLog::replay_queue_lock"),
+                      replay_queue_eof(false),
                       recovery_thread(this),
                       event_seq(0), expiring_events(0), expired_events(0),
                       submit_mutex("MDLog::submit_mutex"),
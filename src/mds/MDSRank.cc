@@ -947,6 +947,9 @@ void MDSRank::boot_start(BootStep step, int r)
         sessionmap.set_rank(whoami);
         sessionmap.load(gather.new_sub());
 
+        dout(2) << "boot_start " << step << ": opening open file table" << dendl;
+        mdcache->open_file_table.load(gather.new_sub());
+
         dout(2) << "boot_start " << step << ": opening mds log" << dendl;
         mdlog->open(gather.new_sub());
 
@@ -1198,6 +1201,11 @@ void MDSRank::reconnect_start()
     reopen_log();
   }
 
+  // start opening the inodes listed in the open file table while we wait
+  // for clients to reconnect; by the time rejoin processes the reconnected
+  // caps most of them should already be in cache
+  mdcache->open_file_table.prefetch_inodes();
+
   server->reconnect_clients(new C_MDS_VoidFn(this, &MDSRank::reconnect_done));
   finish_contexts(g_ceph_context, waiting_for_reconnect);
 }
@@ -1280,6 +1288,7 @@ void MDSRank::active_start()
 
   mdcache->clean_open_file_lists();
   mdcache->export_remaining_imported_caps();
+  mdcache->open_file_table.recovery_done();
   finish_contexts(g_ceph_context, waiting_for_replay);  // kick waiters
   mdcache->start_files_to_recover();
 
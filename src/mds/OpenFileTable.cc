@@ -0,0 +1,379 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "MDSRank.h"
+#include "MDCache.h"
+#include "CInode.h"
+#include "OpenFileTable.h"
+#include "osdc/Objecter.h"
+#include "common/Finisher.h"
+
+#include "common/config.h"
+#include "common/errno.h"
+#include "include/assert.h"
+
+#define dout_subsys ceph_subsys_mds
+#undef dout_prefix
+#define dout_prefix *_dout << "mds." << mds->get_nodeid() << ".openfiles "
+
+/* keys per omap read/write op; large batches keep the op count down
+ * without building oversized transactions */
+static const uint32_t OFT_KEYS_PER_OP = 4096;
+
+class OpenFileTableIOContext : public MDSIOContextBase
+{
+protected:
+  OpenFileTable *oft;
+  MDSRank *get_mds() { return oft->mds; }
+public:
+  explicit OpenFileTableIOContext(OpenFileTable *oft_) : oft(oft_) {
+    assert(oft != NULL);
+  }
+};
+
+object_t OpenFileTable::get_object_name() const
+{
+  char s[30];
+  snprintf(s, sizeof(s), "mds%d_openfiles", int(mds->get_nodeid()));
+  return object_t(s);
+}
+
+static string ino_key(inodeno_t ino)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%llx", (unsigned long long)ino.val);
+  return string(buf);
+}
+
+void OpenFileTable::_encode_header(bufferlist *bl)
+{
+  ENCODE_START(1, 1, *bl);
+  ::encode(version, *bl);
+  ENCODE_FINISH(*bl);
+}
+
+void OpenFileTable::_decode_header(bufferlist& bl)
+{
+  bufferlist::iterator p = bl.begin();
+  DECODE_START(1, p);
+  ::decode(version, p);
+  DECODE_FINISH(p);
+}
+
+void OpenFileTable::add_inode(CInode *in)
+{
+  if (in->last != CEPH_NOSNAP)
+    return;
+
+  inodeno_t ino = in->ino();
+  int64_t pool;
+  if (in->is_dir())
+    pool = mds->mdsmap->get_metadata_pool();
+  else
+    pool = in->inode.layout.pool_id;
+
+  map<inodeno_t, int64_t>::iterator p = opened.find(ino);
+  if (p != opened.end() && p->second == pool)
+    return;
+
+  dout(15) << "add_inode " << ino << " pool " << pool << dendl;
+  opened[ino] = pool;
+
+  map<inodeno_t, int64_t>::iterator q = loaded_inos.find(ino);
+  if (q != loaded_inos.end() && q->second == pool) {
+    /* the entry survived the failover; already persisted as is */
+    return;
+  }
+
+  dirty_items[ino] = pool;
+  null_items.erase(ino);
+}
+
+void OpenFileTable::remove_inode(CInode *in)
+{
+  if (in->last != CEPH_NOSNAP)
+    return;
+
+  inodeno_t ino = in->ino();
+  map<inodeno_t, int64_t>::iterator p = opened.find(ino);
+  if (p == opened.end())
+    return;
+
+  dout(15) << "remove_inode " << ino << dendl;
+  opened.erase(p);
+  dirty_items.erase(ino);
+  null_items.insert(ino);
+}
+
+// ----------------
+// LOAD
+
+class C_IO_OFT_Load : public OpenFileTableIOContext {
+public:
+  const bool first;
+  int header_r;
+  int values_r;
+  bufferlist header_bl;
+  std::map<std::string, bufferlist> vals;
+
+  C_IO_OFT_Load(OpenFileTable *oft_, bool f)
+    : OpenFileTableIOContext(oft_), first(f), header_r(0), values_r(0) {}
+
+  void finish(int r) {
+    oft->_load_finish(r, header_r, values_r, first, header_bl, vals);
+  }
+};
+
+void OpenFileTable::load(MDSInternalContextBase *onload)
+{
+  dout(10) << "load" << dendl;
+  assert(!load_done);
+
+  if (onload)
+    waiting_for_load.push_back(onload);
+
+  C_IO_OFT_Load *c = new C_IO_OFT_Load(this, true);
+  object_t oid = get_object_name();
+  object_locator_t oloc(mds->mdsmap->get_metadata_pool());
+
+  ObjectOperation op;
+  op.omap_get_header(&c->header_bl, &c->header_r);
+  op.omap_get_vals("", "", OFT_KEYS_PER_OP, &c->vals, &c->values_r);
+
+  mds->objecter->read(oid, oloc, op, CEPH_NOSNAP, NULL, 0,
+		      new C_OnFinisher(c, mds->finisher));
+}
+
+void OpenFileTable::_load_finish(int r, int header_r, int values_r, bool first,
+				 bufferlist& header_bl,
+				 std::map<std::string, bufferlist>& vals)
+{
+  if (r == -ENOENT) {
+    /* fresh rank, no table yet */
+    dout(10) << __func__ << ": no table object, starting empty" << dendl;
+    load_done = true;
+    finish_contexts(g_ceph_context, waiting_for_load);
+    return;
+  }
+  if (r < 0 || header_r < 0 || values_r < 0) {
+    derr << __func__ << ": failed to load open file table: r=" << r
+	 << " header_r=" << header_r << " values_r=" << values_r << dendl;
+    /* the table is only an optimization; an unreadable one shouldn't keep
+     * the rank from coming up. rejoin falls back to per-cap discovery. */
+    loaded_inos.clear();
+    load_done = true;
+    finish_contexts(g_ceph_context, waiting_for_load);
+    return;
+  }
+
+  if (first) {
+    try {
+      _decode_header(header_bl);
+    } catch (buffer::error &e) {
+      derr << __func__ << ": corrupt header, starting empty: " << e.what() << dendl;
+      load_done = true;
+      finish_contexts(g_ceph_context, waiting_for_load);
+      return;
+    }
+  }
+
+  for (std::map<std::string, bufferlist>::iterator i = vals.begin();
+       i != vals.end(); ++i) {
+    inodeno_t ino = strtoull(i->first.c_str(), NULL, 16);
+    int64_t pool;
+    try {
+      bufferlist::iterator q = i->second.begin();
+      DECODE_START(1, q);
+      ::decode(pool, q);
+      DECODE_FINISH(q);
+    } catch (buffer::error &e) {
+      derr << __func__ << ": corrupt entry for ino " << ino << ", skipping" << dendl;
+      continue;
+    }
+    loaded_inos[ino] = pool;
+  }
+
+  if (vals.size() == OFT_KEYS_PER_OP) {
+    const std::string last_key = vals.rbegin()->first;
+    dout(10) << __func__ << ": continue omap load from '" << last_key << "'" << dendl;
+    object_t oid = get_object_name();
+    object_locator_t oloc(mds->mdsmap->get_metadata_pool());
+    C_IO_OFT_Load *c = new C_IO_OFT_Load(this, false);
+    ObjectOperation op;
+    op.omap_get_vals(last_key, "", OFT_KEYS_PER_OP, &c->vals, &c->values_r);
+    mds->objecter->read(oid, oloc, op, CEPH_NOSNAP, NULL, 0,
+			new C_OnFinisher(c, mds->finisher));
+    return;
+  }
+
+  dout(10) << __func__ << ": v " << version << ", "
+	   << loaded_inos.size() << " open inodes" << dendl;
+  committing = committed = version;
+  load_done = true;
+  finish_contexts(g_ceph_context, waiting_for_load);
+}
+
+// ----------------
+// SAVE
+
+class C_IO_OFT_Save : public OpenFileTableIOContext {
+  version_t version;
+public:
+  C_IO_OFT_Save(OpenFileTable *oft_, version_t v)
+    : OpenFileTableIOContext(oft_), version(v) {}
+  void finish(int r) {
+    assert(r == 0);
+    oft->_save_finish(version);
+  }
+};
+
+void OpenFileTable::commit(MDSInternalContextBase *c)
+{
+  dout(10) << "commit: " << dirty_items.size() << " dirty, "
+	   << null_items.size() << " removed" << dendl;
+  assert(load_done);
+
+  version++;
+  committing = version;
+  if (c)
+    commit_waiters[version].push_back(c);
+
+  SnapContext snapc;
+  object_t oid = get_object_name();
+  object_locator_t oloc(mds->mdsmap->get_metadata_pool());
+
+  C_GatherBuilder gather(g_ceph_context,
+			 new C_OnFinisher(new C_IO_OFT_Save(this, version),
+					  mds->finisher));
+
+  map<string, bufferlist> to_set;
+  for (map<inodeno_t, int64_t>::iterator p = dirty_items.begin();
+       p != dirty_items.end(); ++p) {
+    bufferlist bl;
+    ENCODE_START(1, 1, bl);
+    ::encode(p->second, bl);
+    ENCODE_FINISH(bl);
+    to_set[ino_key(p->first)] = bl;
+
+    if (to_set.size() >= OFT_KEYS_PER_OP) {
+      ObjectOperation op;
+      op.omap_set(to_set);
+      mds->objecter->mutate(oid, oloc, op, snapc,
+			    ceph::real_clock::now(g_ceph_context),
+			    0, NULL, gather.new_sub());
+      to_set.clear();
+    }
+  }
+
+  set<string> to_remove;
+  for (set<inodeno_t>::iterator p = null_items.begin();
+       p != null_items.end(); ++p) {
+    to_remove.insert(ino_key(*p));
+
+    if (to_remove.size() >= OFT_KEYS_PER_OP) {
+      ObjectOperation op;
+      op.omap_rm_keys(to_remove);
+      mds->objecter->mutate(oid, oloc, op, snapc,
+			    ceph::real_clock::now(g_ceph_context),
+			    0, NULL, gather.new_sub());
+      to_remove.clear();
+    }
+  }
+
+  /* the final op carries the remaining keys plus the version header */
+  ObjectOperation op;
+  bufferlist header_bl;
+  _encode_header(&header_bl);
+  op.omap_set_header(header_bl);
+  if (!to_set.empty())
+    op.omap_set(to_set);
+  if (!to_remove.empty())
+    op.omap_rm_keys(to_remove);
+  mds->objecter->mutate(oid, oloc, op, snapc,
+			ceph::real_clock::now(g_ceph_context),
+			0, NULL, gather.new_sub());
+
+  dirty_items.clear();
+  null_items.clear();
+
+  gather.activate();
+}
+
+void OpenFileTable::_save_finish(version_t v)
+{
+  dout(10) << "_save_finish v" << v << dendl;
+  committed = v;
+
+  finish_contexts(g_ceph_context, commit_waiters[v]);
+  commit_waiters.erase(v);
+}
+
+// ----------------
+// RECOVERY
+
+class C_OFT_PrefetchDone : public MDSInternalContext {
+  utime_t start;
+  size_t count;
+public:
+  C_OFT_PrefetchDone(MDSRank *mds_, size_t count_)
+    : MDSInternalContext(mds_), start(ceph_clock_now(g_ceph_context)), count(count_) {}
+  void finish(int r) {
+    utime_t duration = ceph_clock_now(g_ceph_context) - start;
+    dout(5) << "open file table prefetch of " << count << " inodes done in "
+	    << duration << dendl;
+  }
+};
+
+void OpenFileTable::prefetch_inodes()
+{
+  assert(load_done);
+  if (prefetch_started)
+    return;
+  prefetch_started = true;
+
+  size_t count = 0;
+  MDSGatherBuilder gather(g_ceph_context);
+
+  for (map<inodeno_t, int64_t>::iterator p = loaded_inos.begin();
+       p != loaded_inos.end(); ++p) {
+    if (mds->mdcache->get_inode(p->first))
+      continue;
+    mds->mdcache->open_ino(p->first, p->second, gather.new_sub(), false);
+    count++;
+  }
+
+  dout(10) << "prefetch_inodes: opening " << count << " of "
+	   << loaded_inos.size() << " open inodes" << dendl;
+
+  if (gather.has_subs()) {
+    gather.set_finisher(new C_OFT_PrefetchDone(mds, count));
+    gather.activate();
+  }
+}
+
+void OpenFileTable::recovery_done()
+{
+  /* entries whose caps were never reconnected are gone for good; drop
+   * them so the table doesn't accumulate stale inos across failovers */
+  size_t stale = 0;
+  for (map<inodeno_t, int64_t>::iterator p = loaded_inos.begin();
+       p != loaded_inos.end(); ++p) {
+    if (opened.count(p->first))
+      continue;
+    null_items.insert(p->first);
+    dirty_items.erase(p->first);
+    stale++;
+  }
+  loaded_inos.clear();
+
+  dout(10) << "recovery_done: " << stale << " stale entries to remove" << dendl;
+}
@@ -0,0 +1,98 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MDS_OPENFILETABLE_H
+#define CEPH_MDS_OPENFILETABLE_H
+
+#include "mdstypes.h"
+#include "MDSContext.h"
+
+class CInode;
+class MDSRank;
+
+/*
+ * Persistent table of inodes with client caps, kept as omap entries on a
+ * per-rank object in the metadata pool. A recovering rank loads the table
+ * at boot and prefetches all listed inodes in bulk (parallel backtrace
+ * fetches and dirfrag reads) instead of discovering them one by one when
+ * clients reconnect their caps, which dominates failover time on large
+ * working sets.
+ *
+ * Updates are batched: dirty entries accumulate in memory and are written
+ * in one omap operation when a log segment is expired. The table may
+ * therefore lag the journal by up to a segment; that only costs the
+ * prefetch for the missed inodes, the rejoin logic itself doesn't depend
+ * on the table being complete.
+ */
+class OpenFileTable {
+public:
+  explicit OpenFileTable(MDSRank *m) :
+    mds(m), version(0), committing(0), committed(0),
+    load_done(false), prefetch_started(false) {}
+
+  /* track caps; called when an inode gains its first client cap and when
+   * it drops its last one */
+  void add_inode(CInode *in);
+  void remove_inode(CInode *in);
+
+  bool is_any_dirty() const {
+    return !dirty_items.empty() || !null_items.empty();
+  }
+  void commit(MDSInternalContextBase *c);
+
+  void load(MDSInternalContextBase *onload);
+  bool is_loaded() const { return load_done; }
+
+  /* open all inodes that were listed in the table at boot; fire and
+   * forget, the rejoin state machine doesn't wait for this */
+  void prefetch_inodes();
+
+  /* drop table entries whose caps were never reconnected; called once
+   * the rank is active again */
+  void recovery_done();
+
+  friend class OpenFileTableIOContext;
+  friend class C_IO_OFT_Load;
+  friend class C_IO_OFT_Save;
+
+protected:
+  MDSRank *mds;
+
+  /* ino -> pool to fetch the backtrace from */
+  std::map<inodeno_t, int64_t> opened;
+  std::map<inodeno_t, int64_t> loaded_inos;
+
+  std::map<inodeno_t, int64_t> dirty_items;
+  std::set<inodeno_t> null_items;
+
+  version_t version;
+  version_t committing;
+  version_t committed;
+
+  bool load_done;
+  bool prefetch_started;
+
+  std::list<MDSInternalContextBase*> waiting_for_load;
+  std::map<version_t, std::list<MDSInternalContextBase*> > commit_waiters;
+
+  object_t get_object_name() const;
+
+  void _load_finish(int r, int header_r, int values_r, bool first,
+		    bufferlist& header_bl,
+		    std::map<std::string, bufferlist>& vals);
+  void _save_finish(version_t v);
+
+  void _encode_header(bufferlist *bl);
+  void _decode_header(bufferlist& bl);
+};
+
+#endif
@@ -93,6 +93,21 @@ void ScrubStack::kick_off_scrubs()
 
     if (!curi->is_dir()) {
       // it's a regular file, symlink, or hard link
+      if (!curi->is_symlink() && !curi->scrub_is_backtrace_prefetched()) {
+	// batch up the backtrace read; the inode stays on the stack
+	// until the bulk fetch hands it back to us
+	if (!curi->scrub_is_backtrace_fetching()) {
+	  curi->scrub_info();  // make sure scrub_infop exists
+	  curi->scrub_backtrace_fetch_start();
+	  bt_fetch_batch.push_back(curi);
+	  if ((int)bt_fetch_batch.size() >=
+	      g_conf->mds_scrub_backtrace_fetch_batch)
+	    break;
+	}
+	can_continue = true;
+	continue;
+      }
+
       pop_inode(curi); // we only touch it this once, so remove from stack
 
       if (!curi->scrub_info()->on_finish) {
@@ -120,6 +135,54 @@ void ScrubStack::kick_off_scrubs()
       can_continue = progress || terminal || completed;
     }
   }
+
+  flush_backtrace_fetches();
+}
+
+class C_IO_SS_BacktracesFetched : public MDSIOContextBase {
+  ScrubStack *stack;
+  MDSRank *get_mds() { return stack->mdcache->mds; }
+public:
+  std::vector<CInode*> inodes;
+  std::map<inodeno_t, std::pair<int, bufferlist> > results;
+  explicit C_IO_SS_BacktracesFetched(ScrubStack *s) : stack(s) {}
+  void finish(int r) {
+    stack->_backtraces_fetched(inodes, results);
+  }
+};
+
+void ScrubStack::flush_backtrace_fetches()
+{
+  if (bt_fetch_batch.empty())
+    return;
+
+  C_IO_SS_BacktracesFetched *fin = new C_IO_SS_BacktracesFetched(this);
+  fin->inodes.swap(bt_fetch_batch);
+
+  std::vector<std::pair<inodeno_t, int64_t> > fetches;
+  fetches.reserve(fin->inodes.size());
+  for (std::vector<CInode*>::iterator i = fin->inodes.begin();
+       i != fin->inodes.end(); ++i)
+    fetches.push_back(std::make_pair((*i)->ino(), (*i)->get_backtrace_pool()));
+
+  dout(10) << __func__ << " fetching " << fetches.size()
+	   << " backtraces in one batch" << dendl;
+  mdcache->fetch_backtraces(fetches, &fin->results,
+			    new C_OnFinisher(fin, mdcache->mds->finisher));
+}
+
+void ScrubStack::_backtraces_fetched(
+    std::vector<CInode*>& inodes,
+    std::map<inodeno_t, std::pair<int, bufferlist> >& results)
+{
+  dout(10) << __func__ << " " << inodes.size() << " backtraces" << dendl;
+  for (std::vector<CInode*>::iterator i = inodes.begin();
+       i != inodes.end(); ++i) {
+    CInode *in = *i;
+    std::pair<int, bufferlist>& result = results[in->ino()];
+    in->scrub_backtrace_fetched(result.first, result.second);
+  }
+  kick_off_scrubs();
 }
 
 void ScrubStack::scrub_dir_inode(CInode *in,
@@ -51,6 +51,9 @@ protected:
   };
   C_KickOffScrubs scrub_kick;
 
+  /// file inodes waiting for their next bulk backtrace fetch
+  std::vector<CInode*> bt_fetch_batch;
+
 public:
   MDCache *mdcache;
   ScrubStack(MDCache *mdc, Finisher *finisher_) :
@@ -128,6 +131,18 @@ private:
 			    const CInode::validated_data &result);
   friend class C_InodeValidated;
 
+  /**
+   * Issue one bulk backtrace fetch for everything accumulated in
+   * bt_fetch_batch, so validation doesn't pay a round trip per inode.
+   */
+  void flush_backtrace_fetches();
+  /**
+   * Deliver bulk-fetched backtraces to their inodes and resume scrubbing.
+   */
+  void _backtraces_fetched(std::vector<CInode*>& inodes,
+			   std::map<inodeno_t, std::pair<int, bufferlist> >& results);
+  friend class C_IO_SS_BacktracesFetched;
+
   /**
    * Make progress on scrubbing a directory-representing dirfrag and
    * its children..
@@ -321,7 +321,8 @@ public:
   }
 };
 
-void SessionMap::save(MDSInternalContextBase *onsave, version_t needv)
+void SessionMap::save(MDSInternalContextBase *onsave, version_t needv,
+		      std::set<entity_name_t> *extra_sessions)
 {
   dout(10) << __func__ << ": needv " << needv << ", v " << version << dendl;
  
@@ -382,6 +383,37 @@ void SessionMap::save(MDSInternalContextBase *onsave, version_t needv)
       dout(20) << "  " << name << " (ignoring)" << dendl;
     }
   }
+  if (extra_sessions) {
+    // Sessions whose only change is to completed_requests can ride along
+    // in the same OMAP operation instead of being written separately by
+    // save_if_dirty() afterwards.  Respect the keys_per_op limit; any
+    // leftovers keep their dirty flag and are picked up by save_if_dirty.
+    for (std::set<entity_name_t>::const_iterator i = extra_sessions->begin();
+	 i != extra_sessions->end() &&
+	   to_set.size() < g_conf->mds_sessionmap_keys_per_op; ++i) {
+      const entity_name_t name = *i;
+      if (session_map.count(name) == 0 ||
+	  dirty_sessions.count(name)) {
+	// Gone, or already serialized above
+	continue;
+      }
+      Session *session = session_map[name];
+      if (!session->has_dirty_completed_requests()) {
+	continue;
+      }
+      dout(20) << "  " << name << " (completed_requests)" << dendl;
+
+      std::ostringstream k;
+      k << name;
+
+      bufferlist bl;
+      session->info.encode(bl, mds->mdsmap->get_up_features());
+      to_set[k.str()] = bl;
+
+      session->clear_dirty_completed_requests();
+    }
+  }
+
   if (!to_set.empty()) {
     op.omap_set(to_set);
   }
@@ -583,7 +583,8 @@ public:
   void load_legacy();
   void _load_legacy_finish(int r, bufferlist &bl);
 
-  void save(MDSInternalContextBase *onsave, version_t needv=0);
+  void save(MDSInternalContextBase *onsave, version_t needv=0,
+	    std::set<entity_name_t> *extra_sessions=NULL);
   void _save_finish(version_t v);
 
 protected:
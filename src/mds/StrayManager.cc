@@ -363,9 +363,11 @@ void StrayManager::_advance()
 {
   std::map<CDir*, std::set<dentry_key_t> > to_fetch;
 
+  QueuedStray *blocked = NULL;
+
   for (auto p = ready_for_purge.begin();
        p != ready_for_purge.end();) {
-    const QueuedStray &qs = *p;
+    QueuedStray &qs = *p;
     auto q = p++;
     CDentry *dn = qs.dir->lookup_exact_snap(qs.name, CEPH_NOSNAP);
     if (!dn) {
@@ -373,7 +375,7 @@ void StrayManager::_advance()
       if (fetching_strays.size() >= g_conf->mds_max_purge_files) {
 	break;
       }
-      
+
       dout(10) << __func__ << ": fetching stray dentry " << qs.name << dendl;
 
       auto it = fetching_strays.insert(qs);
@@ -383,10 +385,23 @@ void StrayManager::_advance()
       continue;
     }
 
+    // if an entry is stuck waiting for the ops budget (e.g. a large
+    // file), let a bounded number of smaller purges behind it run ahead
+    // of it, so a backlog of big truncates doesn't starve new strays.
+    // the bound guarantees the stuck entry eventually drains the budget.
+    if (blocked && blocked->bypassed >= g_conf->mds_max_purge_bypass)
+      break;
+
     const bool consumed = _consume(dn, qs.trunc, qs.ops_required);
     if (!consumed) {
-      break;
+      if (files_purging >= g_conf->mds_max_purge_files)
+	break;   // out of file slots; nothing further can run either
+      if (!blocked)
+	blocked = &qs;
+      continue;
     }
+    if (blocked)
+      blocked->bypassed++;
     ready_for_purge.erase(q);
   }
 
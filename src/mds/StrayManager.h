@@ -32,9 +32,12 @@ class StrayManager
     std::string name;
     bool trunc;
     uint32_t ops_required;
+    // how many later (smaller) entries have run ahead of this one while
+    // it was blocked on the ops budget
+    uint32_t bypassed;
     QueuedStray(CDentry *dn, bool t, uint32_t ops)
       : dir(dn->get_dir()), name(dn->name),
-	trunc(t), ops_required(ops) {}
+	trunc(t), ops_required(ops), bypassed(0) {}
     bool operator<(const QueuedStray& o) const {
       return (name < o.name);
     }
@@ -239,17 +239,31 @@ void LogSegment::try_to_expire(MDSRank *mds, MDSGatherBuilder &gather_bld, int o
 
   // sessionmap
   if (sessionmapv > mds->sessionmap.get_committed()) {
-    dout(10) << "try_to_expire saving sessionmap, need " << sessionmapv 
+    dout(10) << "try_to_expire saving sessionmap, need " << sessionmapv
 	      << ", committed is " << mds->sessionmap.get_committed()
 	      << " (" << mds->sessionmap.get_committing() << ")"
 	      << dendl;
-    mds->sessionmap.save(gather_bld.new_sub(), sessionmapv);
+    if (sessionmapv > mds->sessionmap.get_committing()) {
+      // a write is going out anyway; fold the completed_requests updates
+      // for this segment's sessions into the same OMAP operation rather
+      // than issuing separate writes for them below
+      mds->sessionmap.save(gather_bld.new_sub(), sessionmapv,
+			   &touched_sessions);
+    } else {
+      mds->sessionmap.save(gather_bld.new_sub(), sessionmapv);
+    }
   }
 
   // updates to sessions for completed_requests
   mds->sessionmap.save_if_dirty(touched_sessions, &gather_bld);
   touched_sessions.clear();
 
+  // open file table
+  if (mds->mdcache->open_file_table.is_any_dirty()) {
+    dout(10) << "try_to_expire committing open file table" << dendl;
+    mds->mdcache->open_file_table.commit(gather_bld.new_sub());
+  }
+
   // pending commit atids
   for (map<int, ceph::unordered_set<version_t> >::iterator p = pending_commit_tids.begin();
        p != pending_commit_tids.end();
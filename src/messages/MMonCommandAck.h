@@ -18,14 +18,20 @@
 #include "messages/PaxosServiceMessage.h"
 
 class MMonCommandAck : public PaxosServiceMessage {
+  static const int HEAD_VERSION = 2;
+
  public:
   vector<string> cmd;
   errorcode32_t r;
   string rs;
-  
-  MMonCommandAck() : PaxosServiceMessage(MSG_MON_COMMAND_ACK, 0) {}
-  MMonCommandAck(vector<string>& c, int _r, string s, version_t v) : 
-    PaxosServiceMessage(MSG_MON_COMMAND_ACK, v),
+  // how stale the replying mon's view may be; zero when the leader
+  // (or a singleton quorum) serviced the command, bounded by the
+  // paxos lease when a peon serviced it locally
+  utime_t staleness_bound;
+
+  MMonCommandAck() : PaxosServiceMessage(MSG_MON_COMMAND_ACK, 0, HEAD_VERSION) {}
+  MMonCommandAck(vector<string>& c, int _r, string s, version_t v) :
+    PaxosServiceMessage(MSG_MON_COMMAND_ACK, v, HEAD_VERSION),
     cmd(c), r(_r), rs(s) { }
 private:
   ~MMonCommandAck() {}
@@ -33,14 +39,18 @@ private:
 public:
   const char *get_type_name() const { return "mon_command"; }
   void print(ostream& o) const {
-    o << "mon_command_ack(" << cmd << "=" << r << " " << rs << " v" << version << ")";
+    o << "mon_command_ack(" << cmd << "=" << r << " " << rs << " v" << version;
+    if (staleness_bound != utime_t())
+      o << " stale<=" << staleness_bound;
+    o << ")";
   }
-  
+
   void encode_payload(uint64_t features) {
     paxos_encode();
     ::encode(r, payload);
     ::encode(rs, payload);
     ::encode(cmd, payload);
+    ::encode(staleness_bound, payload);
   }
   void decode_payload() {
     bufferlist::iterator p = payload.begin();
@@ -48,6 +58,8 @@ public:
     ::decode(r, p);
     ::decode(rs, p);
     ::decode(cmd, p);
+    if (header.version >= 2)
+      ::decode(staleness_bound, p);
   }
 };
 
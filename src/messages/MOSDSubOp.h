@@ -74,7 +74,7 @@ public:
 
   bool first, complete;
 
-  interval_set<uint64_t> data_included;
+  flat_interval_set<uint64_t> data_included;
   ObjectRecoveryInfo recovery_info;
 
   // reflects result of current push
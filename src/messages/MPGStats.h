@@ -19,16 +19,21 @@
 #include "messages/PaxosServiceMessage.h"
 
 class MPGStats : public PaxosServiceMessage {
+  static const int HEAD_VERSION = 2;
+
 public:
   uuid_d fsid;
   map<pg_t,pg_stat_t> pg_stat;
+  // stats expressed as deltas against the last report the mon acked;
+  // only sent when osd_mon_pg_stat_deltas is enabled
+  map<pg_t,pg_stat_delta_t> pg_stat_delta;
   osd_stat_t osd_stat;
   epoch_t epoch;
   utime_t had_map_for;
-  
-  MPGStats() : PaxosServiceMessage(MSG_PGSTATS, 0) {}
+
+  MPGStats() : PaxosServiceMessage(MSG_PGSTATS, 0, HEAD_VERSION) {}
   MPGStats(const uuid_d& f, epoch_t e, utime_t had)
-    : PaxosServiceMessage(MSG_PGSTATS, 0),
+    : PaxosServiceMessage(MSG_PGSTATS, 0, HEAD_VERSION),
       fsid(f),
       epoch(e),
       had_map_for(had)
@@ -40,7 +45,10 @@ private:
 public:
   const char *get_type_name() const { return "pg_stats"; }
   void print(ostream& out) const {
-    out << "pg_stats(" << pg_stat.size() << " pgs tid " << get_tid() << " v " << version << ")";
+    out << "pg_stats(" << pg_stat.size() << " pgs";
+    if (!pg_stat_delta.empty())
+      out << " + " << pg_stat_delta.size() << " deltas";
+    out << " tid " << get_tid() << " v " << version << ")";
   }
 
   void encode_payload(uint64_t features) {
@@ -50,6 +58,7 @@ public:
     ::encode(pg_stat, payload);
     ::encode(epoch, payload);
     ::encode(had_map_for, payload);
+    ::encode(pg_stat_delta, payload);
   }
   void decode_payload() {
     bufferlist::iterator p = payload.begin();
@@ -59,6 +68,8 @@ public:
     ::decode(pg_stat, p);
     ::decode(epoch, p);
     ::decode(had_map_for, p);
+    if (header.version >= 2)
+      ::decode(pg_stat_delta, p);
   }
 };
 
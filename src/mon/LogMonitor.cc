@@ -204,6 +204,11 @@ void LogMonitor::create_pending()
 {
   pending_log.clear();
   pending_summary = summary;
+  pending_log_bytes = 0;
+  pending_dup_key.clear();
+  pending_dup_msg.clear();
+  pending_dup_count = 0;
+  pending_dup_entry = pending_log.end();
   dout(10) << "create_pending v " << (get_last_committed() + 1) << dendl;
 }
 
@@ -320,24 +325,60 @@ bool LogMonitor::prepare_log(MonOpRequestRef op)
   dout(10) << "prepare_log " << *m << " from " << m->get_orig_source() << dendl;
 
   if (m->fsid != mon->monmap->fsid) {
-    dout(0) << "handle_log on fsid " << m->fsid << " != " << mon->monmap->fsid 
+    dout(0) << "handle_log on fsid " << m->fsid << " != " << mon->monmap->fsid
 	    << dendl;
     return false;
   }
 
+  if (g_conf->mon_max_log_bytes_per_event > 0 &&
+      pending_log_bytes >= (uint64_t)g_conf->mon_max_log_bytes_per_event) {
+    // this round is full; retry once the current proposal commits so
+    // log traffic can't crowd map updates out of a single commit
+    dout(10) << __func__ << " pending log bytes " << pending_log_bytes
+	     << " over budget, deferring to next proposal" << dendl;
+    wait_for_finished_proposal(op, new C_RetryMessage(this, op));
+    return true;
+  }
+
   for (deque<LogEntry>::iterator p = m->entries.begin();
        p != m->entries.end();
        ++p) {
     dout(10) << " logging " << *p << dendl;
     if (!pending_summary.contains(p->key())) {
       pending_summary.add(*p);
-      pending_log.insert(pair<utime_t,LogEntry>(p->stamp, *p));
+      _add_pending_log(*p);
     }
   }
   wait_for_finished_proposal(op, new C_Log(this, op));
   return true;
 }
 
+void LogMonitor::_add_pending_log(const LogEntry& e)
+{
+  if (g_conf->mon_log_summarize_duplicates) {
+    ostringstream dss;
+    dss << e.who << " " << e.channel << " " << (int)e.prio << " " << e.msg;
+    string dup_key = dss.str();
+    if (dup_key == pending_dup_key) {
+      // collapse a run of identical messages into its first entry
+      ++pending_dup_count;
+      ostringstream mss;
+      mss << pending_dup_msg << " [repeated " << (pending_dup_count + 1)
+	  << " times]";
+      pending_dup_entry->second.msg = mss.str();
+      return;
+    }
+    pending_dup_key = dup_key;
+    pending_dup_msg = e.msg;
+    pending_dup_count = 0;
+    pending_dup_entry = pending_log.insert(pair<utime_t,LogEntry>(e.stamp, e));
+    pending_log_bytes += e.msg.length() + 64;  // rough encoded size
+    return;
+  }
+  pending_log.insert(pair<utime_t,LogEntry>(e.stamp, e));
+  pending_log_bytes += e.msg.length() + 64;
+}
+
 void LogMonitor::_updated_log(MonOpRequestRef op)
 {
   MLog *m = static_cast<MLog*>(op->get_req());
@@ -351,6 +392,9 @@ bool LogMonitor::should_propose(double& delay)
   if (g_conf->mon_max_log_entries_per_event > 0 &&
       pending_log.size() >= (unsigned)g_conf->mon_max_log_entries_per_event)
     return true;
+  if (g_conf->mon_max_log_bytes_per_event > 0 &&
+      pending_log_bytes >= (uint64_t)g_conf->mon_max_log_bytes_per_event)
+    return true;
 
   // otherwise fall back to generic policy
   return PaxosService::should_propose(delay);
@@ -409,7 +453,7 @@ bool LogMonitor::prepare_command(MonOpRequestRef op)
     le.prio = CLOG_INFO;
     le.msg = str_join(logtext, " ");
     pending_summary.add(le);
-    pending_log.insert(pair<utime_t,LogEntry>(le.stamp, le));
+    _add_pending_log(le);
     wait_for_finished_proposal(op, new Monitor::C_Command(
           mon, op, 0, string(), get_last_committed() + 1));
     return true;
@@ -42,6 +42,16 @@ private:
   multimap<utime_t,LogEntry> pending_log;
   LogSummary pending_summary, summary;
 
+  // rough encoded size of pending_log, to budget log bytes per commit
+  uint64_t pending_log_bytes = 0;
+
+  // most recently added pending entry, for collapsing runs of
+  // duplicate messages into a single "[repeated N times]" entry
+  string pending_dup_key;
+  string pending_dup_msg;
+  uint64_t pending_dup_count = 0;
+  multimap<utime_t,LogEntry>::iterator pending_dup_entry;
+
   struct log_channel_info {
 
     map<string,string> log_to_syslog;
@@ -142,6 +152,7 @@ private:
 
   bool preprocess_log(MonOpRequestRef op);
   bool prepare_log(MonOpRequestRef op);
+  void _add_pending_log(const LogEntry& e);
   void _updated_log(MonOpRequestRef op);
 
   bool should_propose(double& delay);
@@ -3107,6 +3107,9 @@ void Monitor::reply_command(MonOpRequestRef op, int rc, const string &rs,
   MMonCommandAck *reply = new MMonCommandAck(m->cmd, rc, rs, version);
   reply->set_tid(m->get_tid());
   reply->set_data(rdata);
+  // peons service read-only commands locally within the lease window;
+  // tell the client how stale that view might be
+  reply->staleness_bound = paxos->get_read_staleness_bound();
   send_reply(op, reply);
 }
 
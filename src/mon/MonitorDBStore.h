@@ -284,6 +284,7 @@ class MonitorDBStore
 	break;
       case Transaction::OP_ERASE:
 	dbt->rmkey(op.prefix, op.key);
+	++pending_tombstones[op.prefix].count;
 	break;
       case Transaction::OP_COMPACT:
 	compact.push_back(make_pair(op.prefix, make_pair(op.key, op.endkey)));
@@ -298,10 +299,14 @@ class MonitorDBStore
     if (r >= 0) {
       while (!compact.empty()) {
 	if (compact.front().second.first == string() &&
-	    compact.front().second.second == string())
+	    compact.front().second.second == string()) {
 	  db->compact_prefix_async(compact.front().first);
-	else
-	  db->compact_range_async(compact.front().first, compact.front().second.first, compact.front().second.second);
+	  pending_tombstones.erase(compact.front().first);
+	} else {
+	  defer_range_compact(compact.front().first,
+			      compact.front().second.first,
+			      compact.front().second.second);
+	}
 	compact.pop_front();
       }
     } else {
@@ -310,6 +315,38 @@ class MonitorDBStore
     return r;
   }
 
+  /**
+   * Tombstones accumulated for a prefix since we last queued a
+   * compaction for it, along with the merged range of any compact
+   * requests we have deferred in the meantime.
+   */
+  struct TombstoneInfo {
+    uint64_t count;
+    string start, end;
+    TombstoneInfo() : count(0) {}
+  };
+  map<string, TombstoneInfo> pending_tombstones;
+
+  /**
+   * Queue a range compaction only once enough keys have been erased
+   * from the prefix to make it worthwhile; until then merge the
+   * requested ranges so the eventual compaction covers every deferred
+   * trim.  Keeps frequent small paxos/service trims from thrashing the
+   * backend's compaction thread.
+   */
+  void defer_range_compact(const string& prefix, const string& start,
+			   const string& end) {
+    TombstoneInfo& ti = pending_tombstones[prefix];
+    if (ti.start.empty() || start < ti.start)
+      ti.start = start;
+    if (ti.end.empty() || end > ti.end)
+      ti.end = end;
+    if (ti.count < (uint64_t)g_conf->mon_compact_min_tombstones)
+      return;
+    db->compact_range_async(prefix, ti.start, ti.end);
+    pending_tombstones.erase(prefix);
+  }
+
   struct C_DoTransaction : public Context {
     MonitorDBStore *store;
     MonitorDBStore::TransactionRef t;
@@ -78,6 +78,8 @@ OSDMonitor::OSDMonitor(CephContext *cct, Monitor *mn, Paxos *p, const string& se
  : PaxosService(mn, p, service_name),
    inc_osd_cache(g_conf->mon_osd_cache_size),
    full_osd_cache(g_conf->mon_osd_cache_size),
+   inc_osd_reencode_cache(g_conf->mon_osd_cache_size),
+   full_osd_reencode_cache(g_conf->mon_osd_cache_size),
    thrash_map(0), thrash_last_up_osd(-1),
    op_tracker(cct, true, 1)
 {}
@@ -1322,7 +1324,8 @@ void OSDMonitor::share_map_with_random_osd()
 
   dout(10) << "committed, telling random " << s->inst << " all about it" << dendl;
   // whatev, they'll request more if they need it
-  MOSDMap *m = build_incremental(osdmap.get_epoch() - 1, osdmap.get_epoch());
+  MOSDMap *m = build_incremental(osdmap.get_epoch() - 1, osdmap.get_epoch(),
+				 s->get_con_features());
   s->con->send_message(m);
   // NOTE: do *not* record osd has up to this epoch (as we do
   // elsewhere) as they may still need to request older values.
@@ -1470,16 +1473,17 @@ bool OSDMonitor::preprocess_get_osdmap(MonOpRequestRef op)
   epoch_t first = get_first_committed();
   epoch_t last = osdmap.get_epoch();
   int max = g_conf->osd_map_message_max;
+  uint64_t features = op->get_session()->get_con_features();
   for (epoch_t e = MAX(first, m->get_full_first());
        e <= MIN(last, m->get_full_last()) && max > 0;
        ++e, --max) {
-    int r = get_version_full(e, reply->maps[e]);
+    int r = get_version_full(e, features, reply->maps[e]);
     assert(r >= 0);
   }
   for (epoch_t e = MAX(first, m->get_inc_first());
        e <= MIN(last, m->get_inc_last()) && max > 0;
        ++e, --max) {
-    int r = get_version(e, reply->incremental_maps[e]);
+    int r = get_version(e, features, reply->incremental_maps[e]);
     assert(r >= 0);
   }
   reply->oldest_map = get_first_committed();
@@ -2534,25 +2538,27 @@ void OSDMonitor::send_latest(MonOpRequestRef op, epoch_t start)
 }
 
 
-MOSDMap *OSDMonitor::build_latest_full()
+MOSDMap *OSDMonitor::build_latest_full(uint64_t features)
 {
   MOSDMap *r = new MOSDMap(mon->monmap->fsid);
-  get_version_full(osdmap.get_epoch(), r->maps[osdmap.get_epoch()]);
+  get_version_full(osdmap.get_epoch(), features, r->maps[osdmap.get_epoch()]);
   r->oldest_map = get_first_committed();
   r->newest_map = osdmap.get_epoch();
   return r;
 }
 
-MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to)
+MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to,
+				       uint64_t features)
 {
-  dout(10) << "build_incremental [" << from << ".." << to << "]" << dendl;
+  dout(10) << "build_incremental [" << from << ".." << to << "]"
+	   << " with features " << std::hex << features << std::dec << dendl;
   MOSDMap *m = new MOSDMap(mon->monmap->fsid);
   m->oldest_map = get_first_committed();
   m->newest_map = osdmap.get_epoch();
 
   for (epoch_t e = to; e >= from && e > 0; e--) {
     bufferlist bl;
-    int err = get_version(e, bl);
+    int err = get_version(e, features, bl);
     if (err == 0) {
       assert(bl.length());
       // if (get_version(e, bl) > 0) {
@@ -2562,7 +2568,7 @@ MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to)
     } else {
       assert(err == -ENOENT);
       assert(!bl.length());
-      get_version_full(e, bl);
+      get_version_full(e, features, bl);
       if (bl.length() > 0) {
       //else if (get_version("full", e, bl) > 0) {
       dout(20) << "build_incremental   full " << e << " "
@@ -2580,7 +2586,7 @@ void OSDMonitor::send_full(MonOpRequestRef op)
 {
   op->mark_osdmon_event(__func__);
   dout(5) << "send_full to " << op->get_req()->get_orig_source_inst() << dendl;
-  mon->send_reply(op, build_latest_full());
+  mon->send_reply(op, build_latest_full(op->get_session()->get_con_features()));
 }
 
 void OSDMonitor::send_incremental(MonOpRequestRef op, epoch_t first)
@@ -2613,6 +2619,8 @@ void OSDMonitor::send_incremental(epoch_t first,
   dout(5) << "send_incremental [" << first << ".." << osdmap.get_epoch() << "]"
 	  << " to " << session->inst << dendl;
 
+  uint64_t features = session->get_con_features();
+
   if (first <= session->osd_epoch) {
     dout(10) << __func__ << session->inst << " should already have epoch "
 	     << session->osd_epoch << dendl;
@@ -2622,7 +2630,7 @@ void OSDMonitor::send_incremental(epoch_t first,
   if (first < get_first_committed()) {
     first = get_first_committed();
     bufferlist bl;
-    int err = get_version_full(first, bl);
+    int err = get_version_full(first, features, bl);
     assert(err == 0);
     assert(bl.length());
 
@@ -2648,7 +2656,7 @@ void OSDMonitor::send_incremental(epoch_t first,
   while (first <= osdmap.get_epoch()) {
     epoch_t last = MIN(first + g_conf->osd_map_message_max - 1,
 		       osdmap.get_epoch());
-    MOSDMap *m = build_incremental(first, last);
+    MOSDMap *m = build_incremental(first, last, features);
 
     if (req) {
       // send some maps.  it may not be all of them, but it will get them
@@ -2678,6 +2686,46 @@ int OSDMonitor::get_version(version_t ver, bufferlist& bl)
     return ret;
 }
 
+// the stored blobs are encoded with every feature we know about; only
+// the handful of bits that actually change the encoding matter for
+// sharing reencoded copies, so collapse them into a small cache key
+uint64_t OSDMonitor::reencode_cache_key(version_t ver, uint64_t features)
+{
+  uint64_t sig = 0;
+  if (features & CEPH_FEATURE_PGID64)
+    sig |= 1;
+  if (features & CEPH_FEATURE_OSDENC)
+    sig |= 2;
+  if (features & CEPH_FEATURE_OSDMAP_ENC)
+    sig |= 4;
+  return (ver << 3) | sig;
+}
+
+int OSDMonitor::get_version(version_t ver, uint64_t features, bufferlist& bl)
+{
+  if (OSDMap::get_significant_features(features) == OSDMap::SIGNIFICANT_FEATURES)
+    return get_version(ver, bl);
+
+  uint64_t key = reencode_cache_key(ver, features);
+  if (inc_osd_reencode_cache.lookup(key, &bl)) {
+    return 0;
+  }
+  bufferlist onwire;
+  int ret = get_version(ver, onwire);
+  if (ret) {
+    return ret;
+  }
+  dout(10) << __func__ << " " << ver << " reencoding for features "
+	   << std::hex << features << std::dec << dendl;
+  OSDMap::Incremental inc;
+  bufferlist::iterator q = onwire.begin();
+  inc.decode(q);
+  // see OSDMap::Incremental::encode; we are a legitimate re-encoder
+  inc.encode(bl, features | CEPH_FEATURE_RESERVED);
+  inc_osd_reencode_cache.add(key, bl);
+  return 0;
+}
+
 int OSDMonitor::get_version_full(version_t ver, bufferlist& bl)
 {
     if (full_osd_cache.lookup(ver, &bl)) {
@@ -2690,6 +2738,30 @@ int OSDMonitor::get_version_full(version_t ver, bufferlist& bl)
     return ret;
 }
 
+int OSDMonitor::get_version_full(version_t ver, uint64_t features,
+				 bufferlist& bl)
+{
+  if (OSDMap::get_significant_features(features) == OSDMap::SIGNIFICANT_FEATURES)
+    return get_version_full(ver, bl);
+
+  uint64_t key = reencode_cache_key(ver, features);
+  if (full_osd_reencode_cache.lookup(key, &bl)) {
+    return 0;
+  }
+  bufferlist onwire;
+  int ret = get_version_full(ver, onwire);
+  if (ret) {
+    return ret;
+  }
+  dout(10) << __func__ << " " << ver << " reencoding for features "
+	   << std::hex << features << std::dec << dendl;
+  OSDMap m;
+  m.decode(onwire);
+  m.encode(bl, features | CEPH_FEATURE_RESERVED);
+  full_osd_reencode_cache.add(key, bl);
+  return 0;
+}
+
 epoch_t OSDMonitor::blacklist(const entity_addr_t& a, utime_t until)
 {
   dout(10) << "blacklist " << a << " until " << until << dendl;
@@ -2720,7 +2792,8 @@ void OSDMonitor::check_sub(Subscription *sub)
     if (sub->next >= 1)
       send_incremental(sub->next, sub->session, sub->incremental_onetime);
     else
-      sub->session->con->send_message(build_latest_full());
+      sub->session->con->send_message(
+	build_latest_full(sub->session->get_con_features()));
     if (sub->onetime)
       mon->session_map.remove_sub(sub);
     else
@@ -5179,6 +5252,10 @@ int OSDMonitor::prepare_command_pool_set(map<string,cmd_vartype> &cmdmap,
 	BloomHitSet::Params *bsp = new BloomHitSet::Params;
 	bsp->set_fpp(g_conf->osd_pool_default_hit_set_bloom_fpp);
 	p.hit_set_params = HitSet::Params(bsp);
+      } else if (val == "blocked_bloom") {
+	BlockedBloomHitSet::Params *bsp = new BlockedBloomHitSet::Params;
+	bsp->set_fpp(g_conf->osd_pool_default_hit_set_bloom_fpp);
+	p.hit_set_params = HitSet::Params(bsp);
       } else if (val == "explicit_hash")
 	p.hit_set_params = HitSet::Params(new ExplicitHashHitSet::Params);
       else if (val == "explicit_object")
@@ -7550,6 +7627,10 @@ done:
       BloomHitSet::Params *bsp = new BloomHitSet::Params;
       bsp->set_fpp(g_conf->osd_pool_default_hit_set_bloom_fpp);
       hsp = HitSet::Params(bsp);
+    } else if (g_conf->osd_tier_default_cache_hit_set_type == "blocked_bloom") {
+      BlockedBloomHitSet::Params *bsp = new BlockedBloomHitSet::Params;
+      bsp->set_fpp(g_conf->osd_pool_default_hit_set_bloom_fpp);
+      hsp = HitSet::Params(bsp);
     } else if (g_conf->osd_tier_default_cache_hit_set_type == "explicit_hash") {
       hsp = HitSet::Params(new ExplicitHashHitSet::Params);
     }
@@ -127,6 +127,13 @@ private:
 
   SimpleLRU<version_t, bufferlist> inc_osd_cache;
   SimpleLRU<version_t, bufferlist> full_osd_cache;
+  // stored blobs reencoded for down-level peers, keyed on epoch plus
+  // a feature signature, so a subscription storm reencodes each epoch
+  // once per distinct feature set rather than once per subscriber
+  SimpleLRU<uint64_t, bufferlist> inc_osd_reencode_cache;
+  SimpleLRU<uint64_t, bufferlist> full_osd_reencode_cache;
+
+  static uint64_t reencode_cache_key(version_t ver, uint64_t features);
 
   bool check_failures(utime_t now);
   bool check_failure(utime_t now, int target_osd, failure_info_t& fi);
@@ -211,8 +218,8 @@ private:
   bool can_mark_in(int o);
 
   // ...
-  MOSDMap *build_latest_full();
-  MOSDMap *build_incremental(epoch_t first, epoch_t last);
+  MOSDMap *build_latest_full(uint64_t features);
+  MOSDMap *build_incremental(epoch_t first, epoch_t last, uint64_t features);
   void send_full(MonOpRequestRef op);
   void send_incremental(MonOpRequestRef op, epoch_t first);
 public:
@@ -422,6 +429,9 @@ private:
 
   int get_version(version_t ver, bufferlist& bl) override;
   int get_version_full(version_t ver, bufferlist& bl) override;
+  /// as above, but reencoded (and cached) for peers missing map features
+  int get_version(version_t ver, uint64_t features, bufferlist& bl);
+  int get_version_full(version_t ver, uint64_t features, bufferlist& bl);
 
   epoch_t blacklist(const entity_addr_t& a, utime_t until);
 
@@ -338,6 +338,7 @@ void PGMap::calc_stats()
   pg_sum = pool_stat_t();
   osd_sum = osd_stat_t();
   pg_by_osd.clear();
+  stuck_candidate_pgs.clear();
 
   for (ceph::unordered_map<pg_t,pg_stat_t>::iterator p = pg_stat.begin();
        p != pg_stat.end();
@@ -436,6 +437,15 @@ void PGMap::remove_osd(int osd)
   }
 }
 
+// matches the set of states get_stuck_stats() can report on
+static bool pg_may_be_stuck(int state)
+{
+  return
+    (state & (PG_STATE_ACTIVE|PG_STATE_CLEAN)) !=
+      (PG_STATE_ACTIVE|PG_STATE_CLEAN) ||
+    (state & (PG_STATE_DEGRADED|PG_STATE_UNDERSIZED|PG_STATE_STALE)) != 0;
+}
+
 void PGMap::stat_pg_add(const pg_t &pgid, const pg_stat_t &s,
                         bool sameosds)
 {
@@ -445,6 +455,9 @@ void PGMap::stat_pg_add(const pg_t &pgid, const pg_stat_t &s,
   num_pg++;
   num_pg_by_state[s.state]++;
 
+  if (pg_may_be_stuck(s.state))
+    stuck_candidate_pgs.insert(pgid);
+
   if ((s.state & PG_STATE_CREATING) &&
       s.parent_split_bits == 0) {
     creating_pgs.insert(pgid);
@@ -483,6 +496,9 @@ void PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
   if (end == 0)
     num_pg_by_state.erase(s.state);
 
+  if (pg_may_be_stuck(s.state))
+    stuck_candidate_pgs.erase(pgid);
+
   if ((s.state & PG_STATE_CREATING) &&
       s.parent_split_bits == 0) {
     creating_pgs.erase(pgid);
@@ -996,9 +1012,12 @@ void PGMap::get_stuck_stats(int types, const utime_t cutoff,
                             ceph::unordered_map<pg_t, pg_stat_t>& stuck_pgs) const
 {
   assert(types != 0);
-  for (ceph::unordered_map<pg_t, pg_stat_t>::const_iterator i = pg_stat.begin();
-       i != pg_stat.end();
-       ++i) {
+  // only pgs in stuck_candidate_pgs can match any of the checks below
+  for (set<pg_t>::const_iterator p = stuck_candidate_pgs.begin();
+       p != stuck_candidate_pgs.end();
+       ++p) {
+    ceph::unordered_map<pg_t, pg_stat_t>::const_iterator i = pg_stat.find(*p);
+    assert(i != pg_stat.end());
     utime_t val = cutoff; // don't care about >= cutoff so that is infinity
 
     if ((types & STUCK_INACTIVE) && !(i->second.state & PG_STATE_ACTIVE)) {
@@ -1041,9 +1060,11 @@ bool PGMap::get_stuck_counts(const utime_t cutoff, map<string, int>& note) const
   int undersized = 0;
   int stale = 0;
 
-  for (ceph::unordered_map<pg_t, pg_stat_t>::const_iterator i = pg_stat.begin();
-       i != pg_stat.end();
-       ++i) {
+  for (set<pg_t>::const_iterator p = stuck_candidate_pgs.begin();
+       p != stuck_candidate_pgs.end();
+       ++p) {
+    ceph::unordered_map<pg_t, pg_stat_t>::const_iterator i = pg_stat.find(*p);
+    assert(i != pg_stat.end());
 
     if (! (i->second.state & PG_STATE_ACTIVE)) {
       if (i->second.last_active < cutoff)
@@ -119,6 +119,12 @@ public:
   mutable epoch_t min_last_epoch_clean;
   ceph::unordered_map<int,int> blocked_by_sum;
   ceph::unordered_map<int,set<pg_t> > pg_by_osd;
+  /**
+   * pgs that could show up in get_stuck_stats(), i.e. anything not both
+   * active and clean, so the health checks don't have to walk every pg.
+   * empty on a healthy cluster.
+   */
+  set<pg_t> stuck_candidate_pgs;
 
   utime_t stamp;
 
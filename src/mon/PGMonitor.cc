@@ -737,6 +737,17 @@ bool PGMonitor::pg_stats_have_changed(int from, const MPGStats *stats) const
       return true;
   }
 
+  for (map<pg_t,pg_stat_delta_t>::const_iterator p = stats->pg_stat_delta.begin();
+       p != stats->pg_stat_delta.end(); ++p) {
+    ceph::unordered_map<pg_t,pg_stat_t>::const_iterator t = pg_map.pg_stat.find(p->first);
+    if (t == pg_map.pg_stat.end())
+      return true;
+
+    if (t->second.reported_epoch != p->second.reported_epoch ||
+        t->second.reported_seq != p->second.reported_seq)
+      return true;
+  }
+
   return false;
 }
 
@@ -770,6 +781,11 @@ bool PGMonitor::prepare_pg_stats(MonOpRequestRef op)
          ++p) {
       ack->pg_stat[p->first] = make_pair(p->second.reported_seq, p->second.reported_epoch);
     }
+    for (map<pg_t,pg_stat_delta_t>::const_iterator p = stats->pg_stat_delta.begin();
+         p != stats->pg_stat_delta.end();
+         ++p) {
+      ack->pg_stat[p->first] = make_pair(p->second.reported_seq, p->second.reported_epoch);
+    }
     mon->send_reply(op, ack);
     return false;
   }
@@ -826,6 +842,48 @@ bool PGMonitor::prepare_pg_stats(MonOpRequestRef op)
     pending_inc.pg_stat_updates[pgid] = p->second;
   }
 
+  // delta-encoded stats apply on top of the exact report we already
+  // have; if ours does not match the delta's base, ack with what we do
+  // have so the osd falls back to a full report
+  for (map<pg_t,pg_stat_delta_t>::iterator p = stats->pg_stat_delta.begin();
+       p != stats->pg_stat_delta.end();
+       ++p) {
+    pg_t pgid = p->first;
+    const pg_stat_t *base = NULL;
+    if (pending_inc.pg_stat_updates.count(pgid))
+      base = &pending_inc.pg_stat_updates[pgid];
+    else if (pg_map.pg_stat.count(pgid))
+      base = &pg_map.pg_stat[pgid];
+
+    if (!base || base->reported_seq != p->second.base_seq) {
+      dout(15) << " got delta for " << pgid << " against "
+               << p->second.base_seq << " but have "
+               << (base ? base->reported_seq : 0) << "; need full stats"
+               << dendl;
+      if (base)
+        ack->pg_stat[pgid] = make_pair(base->reported_seq,
+                                       base->reported_epoch);
+      else
+        ack->pg_stat[pgid] = make_pair(0, 0);
+      continue;
+    }
+    if (base->reported_seq >= p->second.reported_seq) {
+      dout(15) << " had " << pgid << " from " << base->reported_epoch << ":"
+               << base->reported_seq << dendl;
+      ack->pg_stat[pgid] = make_pair(base->reported_seq,
+                                     base->reported_epoch);
+      continue;
+    }
+
+    dout(15) << " got delta for " << pgid
+             << " reported at " << p->second.reported_epoch << ":"
+             << p->second.reported_seq << dendl;
+    pg_stat_t next = *base;
+    p->second.apply_to(&next);
+    ack->pg_stat[pgid] = make_pair(next.reported_seq, next.reported_epoch);
+    pending_inc.pg_stat_updates[pgid] = next;
+  }
+
   wait_for_finished_proposal(op, new C_Stats(this, op, ack_op));
   return true;
 }
@@ -580,6 +580,18 @@ void Paxos::collect_timeout()
 
 
 // leader
+struct C_Written : public Context {
+  Paxos *paxos;
+  version_t v;
+  version_t pn;
+  C_Written(Paxos *p, version_t v, version_t pn) : paxos(p), v(v), pn(pn) {}
+  void finish(int r) {
+    assert(r >= 0);
+    Mutex::Locker l(paxos->mon->lock);
+    paxos->begin_write_finish(v, pn);
+  }
+};
+
 void Paxos::begin(bufferlist& v)
 {
   dout(10) << "begin for " << last_committed+1 << " " 
@@ -596,9 +608,9 @@ void Paxos::begin(bufferlist& v)
   // and no value, yet.
   assert(new_value.length() == 0);
 
-  // accept it ourselves
+  // accept it ourselves; our acceptance only counts once the pending
+  // value is durable, see begin_write_finish()
   accepted.clear();
-  accepted.insert(mon->rank);
   new_value = v;
 
   if (last_committed == 0) {
@@ -637,18 +649,21 @@ void Paxos::begin(bufferlist& v)
   logger->inc(l_paxos_begin);
   logger->inc(l_paxos_begin_keys, t->get_keys());
   logger->inc(l_paxos_begin_bytes, t->get_bytes());
-  utime_t start = ceph_clock_now(NULL);
+  begin_start_stamp = ceph_clock_now(NULL);
 
-  get_store()->apply_transaction(t);
-
-  utime_t end = ceph_clock_now(NULL);
-  logger->tinc(l_paxos_begin_latency, end - start);
+  // queue the write and ask the others to accept right away, so our
+  // commit to disk proceeds in parallel with the peons'.  our own
+  // acceptance is recorded by begin_write_finish() once the value is
+  // durable, and the commit cannot start before that since it requires
+  // the full quorum to have accepted.
+  get_store()->queue_transaction(t, new C_Written(this, last_committed + 1,
+						  accepted_pn));
+  begin_write_inflight = true;
 
   assert(g_conf->paxos_kill_at != 3);
 
   if (mon->get_quorum().size() == 1) {
-    // we're alone, take it easy
-    commit_start();
+    // we're alone; just wait for our own write to land
     return;
   }
 
@@ -676,6 +691,35 @@ void Paxos::begin(bufferlist& v)
 }
 
 // peon
+void Paxos::begin_write_finish(version_t v, version_t pn)
+{
+  begin_write_inflight = false;
+
+  utime_t end = ceph_clock_now(NULL);
+  logger->tinc(l_paxos_begin_latency, end - begin_start_stamp);
+
+  if (pn != accepted_pn ||
+      v != last_committed + 1 ||
+      (!is_updating() && !is_updating_previous())) {
+    dout(10) << __func__ << " v " << v << " pn " << pn
+	     << " is no longer the current round, ignoring" << dendl;
+    return;
+  }
+
+  dout(10) << __func__ << " v " << v << " pn " << pn << dendl;
+
+  assert(mon->is_leader());
+  assert(accepted.count(mon->rank) == 0);
+  accepted.insert(mon->rank);
+  dout(10) << " now " << accepted << " have accepted" << dendl;
+
+  if (accepted == mon->get_quorum()) {
+    // everyone else accepted while our write was in flight
+    dout(10) << " got all acceptances, committing, done with update" << dendl;
+    commit_start();
+  }
+}
+
 void Paxos::handle_begin(MonOpRequestRef op)
 {
   op->mark_paxos_event("handle_begin");
@@ -1332,7 +1376,10 @@ void Paxos::restart()
   cancel_events();
   new_value.clear();
 
-  if (is_writing() || is_writing_previous()) {
+  if (is_writing() || is_writing_previous() || begin_write_inflight) {
+    // make sure any queued begin transaction hits disk before anything
+    // a new round writes synchronously, or a stale pending_v could
+    // clobber a newer one
     dout(10) << __func__ << " flushing" << dendl;
     mon->lock.Unlock();
     mon->store->flush();
@@ -1454,6 +1501,20 @@ bool Paxos::is_lease_valid()
       || (ceph_clock_now(g_ceph_context) < lease_expire));
 }
 
+utime_t Paxos::get_read_staleness_bound() const
+{
+  utime_t bound;
+  if (mon->is_leader() || mon->get_quorum().size() == 1)
+    return bound;
+  // the lease was granted mon_lease before it expires
+  utime_t granted = lease_expire;
+  granted -= g_conf->mon_lease;
+  utime_t now = ceph_clock_now(g_ceph_context);
+  if (now > granted)
+    bound = now - granted;
+  return bound;
+}
+
 // -- WRITE --
 
 bool Paxos::is_writeable()
@@ -912,6 +912,22 @@ private:
    */
 
 
+  utime_t begin_start_stamp;
+  /// a leader-side begin transaction has been queued but is not yet durable
+  bool begin_write_inflight;
+  friend struct C_Written;
+
+  /**
+   * Our own accept of the proposed value: called once the pending value
+   * is durable on our store, so that our acceptance may count towards
+   * the quorum.  Starts the commit if everyone else accepted while our
+   * write was still in flight.
+   *
+   * @param v the version the write was for
+   * @param pn the proposal number the write was for
+   */
+  void begin_write_finish(version_t v, version_t pn);
+
   utime_t commit_start_stamp;
   friend struct C_Committed;
 
@@ -1102,7 +1118,8 @@ public:
 		   lease_timeout_event(0),
 		   accept_timeout_event(0),
 		   clock_drift_warned(0),
-		   trimming(false) { }
+		   trimming(false),
+		   begin_write_inflight(false) { }
 
   const string get_name() const {
     return paxos_name;
@@ -1321,6 +1338,18 @@ public:
    * @returns true if the lease is still valid; false otherwise.
    */
   bool is_lease_valid();
+  /**
+   * Bound on how stale locally-read committed state may be, relative to
+   * the leader.
+   *
+   * The leader always serves current data.  A peon is guaranteed to
+   * have applied every commit that preceded its current lease grant, so
+   * anything it reads can be stale by at most the age of that grant.
+   *
+   * @returns zero on the leader (or a singleton quorum); otherwise the
+   *	      elapsed time since our lease was granted.
+   */
+  utime_t get_read_staleness_bound() const;
   // write
   /**
    * @defgroup Paxos_h_write_funcs Write-related functions
@@ -17,6 +17,7 @@
 
 #include "include/xlist.h"
 #include "msg/msg_types.h"
+#include "msg/Connection.h"
 
 #include "auth/AuthServiceHandler.h"
 #include "osd/OSDMap.h"
@@ -76,6 +77,10 @@ struct MonSession : public RefCountedObject {
     delete auth_handler;
   }
 
+  uint64_t get_con_features() const {
+    return con ? con->get_features() : CEPH_FEATURES_ALL;
+  }
+
   bool is_capable(string service, int mask) {
     map<string,string> args;
     return caps.is_capable(g_ceph_context,
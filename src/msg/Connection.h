@@ -117,6 +117,26 @@ public:
    * @return 0 on success, or -errno on failure.
    */
   virtual int send_message(Message *m) = 0;
+  /**
+   * Queue a batch of Messages, in order, on the given Connection.
+   * The list is consumed.  The default implementation just sends them
+   * one by one; a transport can override it to take its queue lock
+   * once and wake its writer once for the whole train.
+   *
+   * @param msgs The Messages to send; one reference each is consumed.
+   *
+   * @return 0 on success, or -errno on failure.
+   */
+  virtual int send_messages(std::list<Message*>& msgs) {
+    while (!msgs.empty()) {
+      Message *m = msgs.front();
+      msgs.pop_front();
+      int r = send_message(m);
+      if (r < 0)
+	return r;
+    }
+    return 0;
+  }
   /**
    * Send a "keepalive" ping along the given Connection, if it's working.
    * If the underlying connection has broken, this function does nothing.
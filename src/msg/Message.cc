@@ -189,6 +189,15 @@ void Message::encode(uint64_t features, int crcflags)
     // is incompatible.
     if (header.compat_version == 0)
       header.compat_version = header.version;
+  } else if (crcflags == encoded_crcflags) {
+    // the envelope and front/data crcs from the previous encode of
+    // this payload are still valid (requeue after a connection reset,
+    // fan-out with matching features); only the header may have
+    // changed since (seq is bumped per send), so refresh its crc and
+    // skip the passes over front, middle and data
+    if (crcflags & MSG_CRC_HEADER)
+      calc_header_crc();
+    return;
   }
   if (crcflags & MSG_CRC_HEADER)
     calc_front_crc();
@@ -245,6 +254,7 @@ void Message::encode(uint64_t features, int crcflags)
   } else {
     footer.flags = (unsigned)footer.flags | CEPH_MSG_FOOTER_NOCRC;
   }
+  encoded_crcflags = crcflags;
 }
 
 void Message::dump(Formatter *f) const
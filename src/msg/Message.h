@@ -225,6 +225,11 @@ protected:
 
   uint32_t magic = 0;
 
+  /* crcflags the envelope and crcs were last computed with, or -1 if
+   * they are stale; lets encode() skip the crc passes when the message
+   * is sent again with the same flags (requeue after reset, fan-out) */
+  int encoded_crcflags = -1;
+
   bi::list_member_hook<> dispatch_q;
 
 public:
@@ -327,6 +332,7 @@ public:
       byte_throttler->put(payload.length() + middle.length());
     payload.clear();
     middle.clear();
+    encoded_crcflags = -1;
   }
 
   virtual void clear_buffers() {}
@@ -350,6 +356,7 @@ public:
     payload.claim(bl, buffer::list::CLAIM_ALLOW_NONSHAREABLE);
     if (byte_throttler)
       byte_throttler->take(payload.length());
+    encoded_crcflags = -1;
   }
 
   void set_middle(bufferlist& bl) {
@@ -358,6 +365,7 @@ public:
     middle.claim(bl, buffer::list::CLAIM_ALLOW_NONSHAREABLE);
     if (byte_throttler)
       byte_throttler->take(payload.length());
+    encoded_crcflags = -1;
   }
   bufferlist& get_middle() { return middle; }
 
@@ -367,6 +375,7 @@ public:
     data.share(bl);
     if (byte_throttler)
       byte_throttler->take(data.length());
+    encoded_crcflags = -1;
   }
 
   bufferlist& get_data() { return data; }
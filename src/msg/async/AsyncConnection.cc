@@ -46,6 +46,15 @@ ostream& AsyncConnection::_conn_prefix(std::ostream *_dout) {
 
 const int AsyncConnection::TCP_PREFETCH_MIN_SIZE = 512;
 const int ASYNC_COALESCE_THRESHOLD = 256;
+// gather this much queued message data into outcoming_bl before issuing
+// a sendmsg, so draining a backlog costs one syscall per batch instead
+// of one per message
+const unsigned ASYNC_SEND_BATCH_THRESHOLD = 128 * 1024;
+// yield the write lock after committing this many bytes in one
+// handle_write pass, so senders of higher priority messages (maps,
+// peering traffic behind bulk recovery pushes) are not head-of-line
+// blocked on enqueueing for the whole drain
+const uint64_t ASYNC_WRITE_PASS_BUDGET = 1024 * 1024;
 
 class C_time_wakeup : public EventCallback {
   AsyncConnectionRef conn;
@@ -97,15 +106,29 @@ class C_tick_wakeup : public EventCallback {
   }
 };
 
+class C_cork_flush : public EventCallback {
+  AsyncConnectionRef conn;
+
+ public:
+  explicit C_cork_flush(AsyncConnectionRef c): conn(c) {}
+  void do_request(int fd_or_id) {
+    conn->cork_flush(fd_or_id);
+  }
+};
+
 static void alloc_aligned_buffer(bufferlist& data, unsigned len, unsigned off)
 {
-  // create a buffer to read into that matches the data alignment
+  // create a buffer to read into that matches the data alignment.
+  // the head and tail pieces are necessarily shorter than a page, but
+  // allocating them page aligned too means a later rebuild_aligned on
+  // the payload never trips on their memory alignment, only on their
+  // (unavoidable) sub-block lengths
   unsigned left = len;
   if (off & ~CEPH_PAGE_MASK) {
     // head
     unsigned head = 0;
     head = MIN(CEPH_PAGE_SIZE - (off & ~CEPH_PAGE_MASK), left);
-    data.push_back(buffer::create(head));
+    data.push_back(buffer::create_page_aligned(head));
     left -= head;
   }
   unsigned middle = left & CEPH_PAGE_MASK;
@@ -114,7 +137,7 @@ static void alloc_aligned_buffer(bufferlist& data, unsigned len, unsigned off)
     left -= middle;
   }
   if (left) {
-    data.push_back(buffer::create(left));
+    data.push_back(buffer::create_page_aligned(left));
   }
 }
 
@@ -128,6 +151,7 @@ AsyncConnection::AsyncConnection(CephContext *cct, AsyncMessenger *m, DispatchQu
     recv_max_prefetch(MAX(msgr->cct->_conf->ms_tcp_prefetch_max_size, TCP_PREFETCH_MIN_SIZE)),
     recv_start(0), recv_end(0),
     last_active(ceph::coarse_mono_clock::now()),
+    last_write_stamp(last_active),
     inactive_timeout_us(cct->_conf->ms_tcp_read_timeout*1000*1000),
     got_bad_auth(false), authorizer(NULL), replacing(false),
     is_reset_from_peer(false), once_ready(false), state_buffer(NULL), state_offset(0), net(cct),
@@ -137,6 +161,7 @@ AsyncConnection::AsyncConnection(CephContext *cct, AsyncMessenger *m, DispatchQu
   write_handler = new C_handle_write(this);
   wakeup_handler = new C_time_wakeup(this);
   tick_handler = new C_tick_wakeup(this);
+  cork_flush_handler = new C_cork_flush(this);
   memset(msgvec, 0, sizeof(msgvec));
   // double recv_max_prefetch see "read_until"
   recv_buf = new char[2*recv_max_prefetch];
@@ -764,7 +789,7 @@ void AsyncConnection::process()
               data_buf = p->second.first;
               // make sure it's big enough
               if (data_buf.length() < data_len)
-                data_buf.push_back(buffer::create(data_len - data_buf.length()));
+                data_buf.push_back(buffer::create_page_aligned(data_len - data_buf.length()));
               data_blp = data_buf.begin();
             } else {
               ldout(async_msgr->cct,20) << __func__ << " allocating new rx buffer at offset " << data_off << dendl;
@@ -838,6 +863,13 @@ void AsyncConnection::process()
             goto fail;
           }
 
+          if (footer.flags & CEPH_MSG_FOOTER_DATA_COMPRESSED) {
+            if (decompress_incoming_data(current_header, footer, data) < 0) {
+              ldout(async_msgr->cct, 1) << __func__ << " failed to decompress data segment" << dendl;
+              goto fail;
+            }
+          }
+
           ldout(async_msgr->cct, 20) << __func__ << " got " << front.length() << " + " << middle.length()
                               << " + " << data.length() << " byte message" << dendl;
           Message *message = decode_message(async_msgr->cct, async_msgr->crcflags, current_header, footer, front, middle, data);
@@ -2092,6 +2124,44 @@ int AsyncConnection::send_message(Message *m)
   return 0;
 }
 
+int AsyncConnection::send_messages(std::list<Message*>& msgs)
+{
+  if (msgs.empty())
+    return 0;
+
+  // loopback delivery is per message anyway; keep it on the simple path
+  if (async_msgr->get_myaddr() == get_peer_addr())
+    return Connection::send_messages(msgs);
+
+  // queue the whole train under one lock hold and wake the writer
+  // once; encoding happens in the write path, same as the non-inline
+  // branch of send_message
+  std::lock_guard<std::mutex> l(write_lock);
+  if (can_write == WriteStatus::CLOSED) {
+    ldout(async_msgr->cct, 10) << __func__ << " connection closed."
+                               << " Drop " << msgs.size() << " messages" << dendl;
+    while (!msgs.empty()) {
+      msgs.front()->put();
+      msgs.pop_front();
+    }
+    return 0;
+  }
+  while (!msgs.empty()) {
+    Message *m = msgs.front();
+    msgs.pop_front();
+    ldout(async_msgr->cct, 1) << " == tx == " << m << " " << *m << dendl;
+    if (!m->get_priority())
+      m->set_priority(async_msgr->get_default_send_priority());
+    m->get_header().src = async_msgr->get_myname();
+    m->set_connection(this);
+    logger->inc(l_msgr_send_messages);
+    out_q[m->get_priority()].emplace_back(bufferlist(), m);
+  }
+  if (can_write != WriteStatus::REPLACING)
+    center->dispatch_event_external(write_handler);
+  return 0;
+}
+
 void AsyncConnection::requeue_sent()
 {
   if (sent.empty())
@@ -2311,11 +2381,142 @@ void AsyncConnection::prepare_send_message(uint64_t features, Message *m, buffer
   // encode and copy out of *m
   m->encode(features, msgr->crcflags);
 
+  if (has_feature(CEPH_FEATURE_MSG_DATA_COMPRESS)) {
+    if (async_msgr->cct->_conf->ms_compress_data &&
+        !(m->get_footer().flags & CEPH_MSG_FOOTER_DATA_COMPRESSED) &&
+        m->get_data().length() >= async_msgr->cct->_conf->ms_compress_data_min_size)
+      compress_message_data(m);
+  } else if (m->get_footer().flags & CEPH_MSG_FOOTER_DATA_COMPRESSED) {
+    // requeued from a connection that compressed it, but this peer can't
+    // decompress; put the original data back
+    if (!uncompress_message_data(m))
+      ldout(async_msgr->cct, 0) << __func__
+                                << " failed to uncompress data for peer without"
+                                << " MSG_DATA_COMPRESS" << dendl;
+  }
+
   bl.append(m->get_payload());
   bl.append(m->get_middle());
   bl.append(m->get_data());
 }
 
+bool AsyncConnection::compress_message_data(Message *m)
+{
+  const string &type = async_msgr->cct->_conf->ms_compress_data_type;
+  if (!tx_compressor) {
+    tx_compressor = Compressor::create(async_msgr->cct, type);
+    if (!tx_compressor) {
+      ldout(async_msgr->cct, 0) << __func__ << " cannot load compressor plugin "
+                                << type << dendl;
+      return false;
+    }
+  }
+
+  bufferlist out;
+  ::encode(type, out);  // tells the peer how to inflate it
+  bufferlist compressed;
+  if (tx_compressor->compress(m->get_data(), compressed) < 0) {
+    ldout(async_msgr->cct, 1) << __func__ << " compress failed on " << *m << dendl;
+    return false;
+  }
+  if (out.length() + compressed.length() >= m->get_data().length()) {
+    ldout(async_msgr->cct, 20) << __func__ << " data is incompressible, sending raw" << dendl;
+    return false;
+  }
+  out.claim_append(compressed);
+
+  unsigned saved = m->get_data().length() - out.length();
+  ceph_msg_header& header = m->get_header();
+  ceph_msg_footer& footer = m->get_footer();
+  m->set_data(out);
+  header.data_len = out.length();
+  if (msgr->crcflags & MSG_CRC_DATA)
+    m->calc_data_crc();
+  footer.flags = (unsigned)footer.flags | CEPH_MSG_FOOTER_DATA_COMPRESSED;
+  logger->inc(l_msgr_compressed_msgs_sent);
+  logger->inc(l_msgr_compressed_bytes_saved, saved);
+  ldout(async_msgr->cct, 20) << __func__ << " data " << out.length() + saved
+                             << " -> " << out.length() << " bytes" << dendl;
+  return true;
+}
+
+bool AsyncConnection::uncompress_message_data(Message *m)
+{
+  bufferlist out;
+  try {
+    bufferlist::iterator p = m->get_data().begin();
+    string type;
+    ::decode(type, p);
+    if (!rx_compressor || rx_compressor_type != type) {
+      rx_compressor = Compressor::create(async_msgr->cct, type);
+      rx_compressor_type = type;
+    }
+    if (!rx_compressor)
+      return false;
+    if (rx_compressor->decompress(p, m->get_data().length() - p.get_off(), out) < 0)
+      return false;
+  } catch (const buffer::error &e) {
+    return false;
+  }
+  ceph_msg_header& header = m->get_header();
+  ceph_msg_footer& footer = m->get_footer();
+  m->set_data(out);
+  header.data_len = out.length();
+  if (msgr->crcflags & MSG_CRC_DATA)
+    m->calc_data_crc();
+  footer.flags = (unsigned)footer.flags & ~CEPH_MSG_FOOTER_DATA_COMPRESSED;
+  return true;
+}
+
+int AsyncConnection::decompress_incoming_data(ceph_msg_header &header,
+                                              ceph_msg_footer &footer,
+                                              bufferlist &data)
+{
+  // the sender's data crc covers the wire (compressed) bytes; check it
+  // here and tell decode_message not to check it again over the
+  // inflated data.  the footer crc fields themselves stay untouched so
+  // the signature check still sees what the sender signed.
+  if ((msgr->crcflags & MSG_CRC_DATA) &&
+      !(footer.flags & CEPH_MSG_FOOTER_NOCRC)) {
+    __u32 data_crc = data.crc32c(0);
+    if (data_crc != footer.data_crc) {
+      ldout(async_msgr->cct, 0) << __func__ << " bad crc in compressed data "
+                                << data_crc << " != exp " << footer.data_crc << dendl;
+      return -EIO;
+    }
+    footer.flags = (unsigned)footer.flags | CEPH_MSG_FOOTER_NOCRC;
+  }
+
+  bufferlist out;
+  try {
+    bufferlist::iterator p = data.begin();
+    string type;
+    ::decode(type, p);
+    if (!rx_compressor || rx_compressor_type != type) {
+      rx_compressor = Compressor::create(async_msgr->cct, type);
+      rx_compressor_type = type;
+    }
+    if (!rx_compressor) {
+      ldout(async_msgr->cct, 0) << __func__ << " cannot load compressor plugin "
+                                << type << dendl;
+      return -EIO;
+    }
+    if (rx_compressor->decompress(p, data.length() - p.get_off(), out) < 0) {
+      ldout(async_msgr->cct, 0) << __func__ << " decompress failed" << dendl;
+      return -EIO;
+    }
+  } catch (const buffer::error &e) {
+    ldout(async_msgr->cct, 0) << __func__ << " corrupt compressed data envelope" << dendl;
+    return -EIO;
+  }
+
+  data.swap(out);
+  header.data_len = data.length();
+  footer.flags = (unsigned)footer.flags & ~CEPH_MSG_FOOTER_DATA_COMPRESSED;
+  logger->inc(l_msgr_compressed_msgs_recv);
+  return 0;
+}
+
 ssize_t AsyncConnection::write_message(Message *m, bufferlist& bl, bool more)
 {
   assert(can_write == WriteStatus::CANWRITE);
@@ -2404,6 +2605,16 @@ ssize_t AsyncConnection::write_message(Message *m, bufferlist& bl, bool more)
   logger->inc(l_msgr_send_bytes, outcoming_bl.length() - original_bl_len);
   ldout(async_msgr->cct, 20) << __func__ << " sending " << m->get_seq()
                              << " " << m << dendl;
+  if (more && outcoming_bl.length() < ASYNC_SEND_BATCH_THRESHOLD) {
+    // more messages are queued behind us and the batch is still small:
+    // keep gathering into outcoming_bl and let the caller flush the
+    // whole batch with a single sendmsg.  handle_write always finishes
+    // with a _try_send covering anything left queued.
+    ldout(async_msgr->cct, 20) << __func__ << " batching " << m
+                               << ", pending " << outcoming_bl.length() << dendl;
+    m->put();
+    return 0;
+  }
   ssize_t rc = _try_send(more);
   if (rc < 0) {
     ldout(async_msgr->cct, 1) << __func__ << " error sending " << m << ", "
@@ -2571,6 +2782,7 @@ void AsyncConnection::handle_write()
       keepalive = false;
     }
 
+    uint64_t sent_in_pass = 0;
     while (1) {
       bufferlist data;
       Message *m = _get_next_outgoing(&data);
@@ -2581,6 +2793,7 @@ void AsyncConnection::handle_write()
       if (!data.length())
         prepare_send_message(get_features(), m, data);
 
+      sent_in_pass += data.length();
       r = write_message(m, data, _has_next_outgoing());
       if (r < 0) {
         ldout(async_msgr->cct, 1) << __func__ << " send msg failed" << dendl;
@@ -2589,6 +2802,12 @@ void AsyncConnection::handle_write()
       } else if (r > 0) {
         break;
       }
+      if (sent_in_pass >= ASYNC_WRITE_PASS_BUDGET && _has_next_outgoing()) {
+        // let waiting senders enqueue; anything of higher priority they
+        // queue goes out ahead of the rest of this backlog next pass
+        center->dispatch_event_external(write_handler);
+        break;
+      }
     }
 
     uint64_t left = ack_left.read();
@@ -2599,10 +2818,30 @@ void AsyncConnection::handle_write()
       outcoming_bl.append((char*)&s, sizeof(s));
       ldout(async_msgr->cct, 10) << __func__ << " try send msg ack, acked " << left << " messages" << dendl;
       ack_left.sub(left);
-      left = ack_left.read();
-      r = _try_send(left);
-    } else if (is_queued()) {
-      r = _try_send();
+    }
+
+    if (is_queued()) {
+      auto now = ceph::coarse_mono_clock::now();
+      uint64_t cork_us = async_msgr->cct->_conf->ms_async_send_cork_us;
+      if (cork_us &&
+          outcoming_bl.length() < ASYNC_SEND_BATCH_THRESHOLD &&
+          now - last_write_stamp <= std::chrono::microseconds(cork_us)) {
+        // writes are arriving back to back: hold this small flush so
+        // the next message or ack shares the same sendmsg.  The time
+        // event bounds the added latency to cork_us even if nothing
+        // else shows up.
+        if (!cork_time_id)
+          cork_time_id = center->create_time_event(cork_us, cork_flush_handler);
+        ldout(async_msgr->cct, 20) << __func__ << " corking "
+                                   << outcoming_bl.length() << " bytes" << dendl;
+      } else {
+        if (cork_time_id) {
+          center->delete_time_event(cork_time_id);
+          cork_time_id = 0;
+        }
+        r = _try_send(ack_left.read() > 0);
+      }
+      last_write_stamp = now;
     }
 
     write_lock.unlock();
@@ -2639,6 +2878,26 @@ void AsyncConnection::handle_write()
   lock.unlock();
 }
 
+void AsyncConnection::cork_flush(uint64_t id)
+{
+  ssize_t r = 0;
+  write_lock.lock();
+  if (cork_time_id == id)
+    cork_time_id = 0;
+  if (can_write == WriteStatus::CANWRITE && is_queued()) {
+    ldout(async_msgr->cct, 20) << __func__ << " flushing "
+                               << outcoming_bl.length() << " corked bytes" << dendl;
+    r = _try_send();
+  }
+  write_lock.unlock();
+  if (r < 0) {
+    ldout(async_msgr->cct, 1) << __func__ << " send corked data failed" << dendl;
+    lock.lock();
+    fault();
+    lock.unlock();
+  }
+}
+
 void AsyncConnection::wakeup_from(uint64_t id)
 {
   lock.lock();
@@ -27,6 +27,7 @@
 using namespace std;
 
 #include "auth/AuthSessionHandler.h"
+#include "compressor/Compressor.h"
 #include "common/ceph_time.h"
 #include "common/perf_counters.h"
 #include "include/buffer.h"
@@ -64,6 +65,10 @@ class AsyncConnection : public Connection {
   ssize_t _try_send(bool more=false);
   ssize_t _send(Message *m);
   void prepare_send_message(uint64_t features, Message *m, bufferlist &bl);
+  bool compress_message_data(Message *m);
+  bool uncompress_message_data(Message *m);
+  int decompress_incoming_data(ceph_msg_header &header, ceph_msg_footer &footer,
+			       bufferlist &data);
   ssize_t read_until(unsigned needed, char *p);
   ssize_t _process_connection();
   void _connect();
@@ -106,6 +111,10 @@ class AsyncConnection : public Connection {
     for (auto &&t : register_time_events)
       center->delete_time_event(t);
     register_time_events.clear();
+    if (cork_time_id) {
+      center->delete_time_event(cork_time_id);
+      cork_time_id = 0;
+    }
     if (last_tick_id) {
       center->delete_time_event(last_tick_id);
       last_tick_id = 0;
@@ -211,6 +220,7 @@ class AsyncConnection : public Connection {
   // Only call when AsyncConnection first construct
   void accept(int sd);
   int send_message(Message *m) override;
+  int send_messages(std::list<Message*>& msgs) override;
 
   void send_keepalive() override;
   void mark_down() override;
@@ -329,6 +339,7 @@ class AsyncConnection : public Connection {
   EventCallbackRef write_handler;
   EventCallbackRef wakeup_handler;
   EventCallbackRef tick_handler;
+  EventCallbackRef cork_flush_handler;
   struct iovec msgvec[ASYNC_IOV_MAX];
   char *recv_buf;
   uint32_t recv_max_prefetch;
@@ -336,6 +347,11 @@ class AsyncConnection : public Connection {
   uint32_t recv_end;
   set<uint64_t> register_time_events; // need to delete it if stop
   ceph::coarse_mono_clock::time_point last_active;
+  // transmit corking: stamp of the last handle_write pass that queued
+  // data, and the pending flush time event (0 = none).  Both are
+  // touched under write_lock from the center thread only.
+  ceph::coarse_mono_clock::time_point last_write_stamp;
+  uint64_t cork_time_id = 0;
   uint64_t last_tick_id = 0;
   const uint64_t inactive_timeout_us;
 
@@ -376,6 +392,9 @@ class AsyncConnection : public Connection {
   Worker *worker;
   EventCenter *center;
   ceph::shared_ptr<AuthSessionHandler> session_security;
+  CompressorRef tx_compressor;        ///< lazily created from ms_compress_data_type
+  CompressorRef rx_compressor;        ///< cached decompressor for the last rx type
+  string rx_compressor_type;
 
 #if !defined(MSG_NOSIGNAL) && !defined(SO_NOSIGPIPE)
   sigset_t sigpipe_mask;
@@ -386,6 +405,7 @@ class AsyncConnection : public Connection {
  public:
   // used by eventcallback
   void handle_write();
+  void cork_flush(uint64_t id);
   void process();
   void wakeup_from(uint64_t id);
   void tick(uint64_t id);
@@ -404,6 +424,7 @@ class AsyncConnection : public Connection {
     delete write_handler;
     delete wakeup_handler;
     delete tick_handler;
+    delete cork_flush_handler;
     if (delay_state) {
       delete delay_state;
       delay_state = NULL;
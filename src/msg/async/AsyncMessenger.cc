@@ -315,6 +315,8 @@ class WorkerPool {
   Cond barrier_cond;
   atomic_t barrier_count;
   simple_spinlock_t pool_spin = SIMPLE_SPINLOCK_INITIALIZER;
+  // when per-worker traffic rates were last refreshed (under pool_spin)
+  ceph::coarse_mono_clock::time_point last_rate_sample;
 
   class C_barrier : public EventCallback {
     WorkerPool *pool;
@@ -357,16 +359,38 @@ void *Worker::entry()
 
   center.set_owner();
   pool->pending--;
+  uint64_t busy_poll_us = cct->_conf->ms_async_busy_poll_us;
+  auto last_active = ceph::coarse_mono_clock::now();
   while (!done) {
     ldout(cct, 20) << __func__ << " calling event process" << dendl;
 
-    int r = center.process_events(EventMaxWaitUs);
+    int r;
+    if (busy_poll_us) {
+      // Polled mode: spin on zero-timeout waits so ready events and
+      // external dispatches are picked up without epoll_wait sleeps or
+      // notify pipe writes on the latency path.  Once the loop has been
+      // idle for the configured window, drop back to a blocking wait;
+      // wakeup() only writes the pipe while we are not polling.
+      center.set_polling(true);
+      r = center.process_events(0);
+      auto now = ceph::coarse_mono_clock::now();
+      if (r > 0) {
+        last_active = now;
+      } else if (now - last_active > std::chrono::microseconds(busy_poll_us)) {
+        center.set_polling(false);
+        r = center.process_events(EventMaxWaitUs);
+        last_active = ceph::coarse_mono_clock::now();
+      }
+    } else {
+      r = center.process_events(EventMaxWaitUs);
+    }
     if (r < 0) {
       ldout(cct, 20) << __func__ << " process events failed: "
           << cpp_strerror(errno) << dendl;
       // TODO do something?
     }
   }
+  center.set_polling(false);
 
   return 0;
 }
@@ -432,13 +456,34 @@ Worker* WorkerPool::get_worker()
   unsigned min_load = std::numeric_limits<int>::max();
   Worker* current_best = nullptr;
 
+  uint64_t bytes_per_conn = cct->_conf->ms_async_worker_bytes_per_conn;
   simple_spin_lock(&pool_spin);
-  // find worker with least references
+  // refresh per-worker traffic rates at most once a second; placements
+  // in between reuse the cached rates
+  if (bytes_per_conn) {
+    auto now = ceph::coarse_mono_clock::now();
+    uint64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - last_rate_sample).count();
+    if (elapsed_ms >= 1000) {
+      for (auto p = workers.begin(); p != workers.end(); ++p) {
+        uint64_t cur = (*p)->get_traffic_bytes();
+        (*p)->traffic_rate = (cur - (*p)->prev_traffic_bytes) * 1000 / elapsed_ms;
+        (*p)->prev_traffic_bytes = cur;
+      }
+      last_rate_sample = now;
+    }
+  }
+  // find worker with least load: each connection counts one, and recent
+  // traffic counts extra so one or two hot connections don't keep
+  // attracting new peers to an already saturated worker.
   // tempting case is returning on references == 0, but in reality
   // this will happen so rarely that there's no need for special case.
   for (auto p = workers.begin(); p != workers.end(); ++p) {
     unsigned worker_load = (*p)->references.load();
-    ldout(cct, 20) << __func__ << " Worker " << *p << " load: " << worker_load << dendl;
+    if (bytes_per_conn)
+      worker_load += (*p)->traffic_rate / bytes_per_conn;
+    ldout(cct, 20) << __func__ << " Worker " << *p << " load: " << worker_load
+                   << " rate: " << (*p)->traffic_rate << dendl;
     if (worker_load < min_load) {
       current_best = *p;
       min_load = worker_load;
@@ -51,6 +51,10 @@ enum {
   l_msgr_send_bytes,
   l_msgr_created_connections,
   l_msgr_active_connections,
+  l_msgr_compressed_msgs_sent,
+  l_msgr_compressed_bytes_saved,
+  l_msgr_compressed_msgs_recv,
+  l_msgr_external_event_lat,
   l_msgr_last,
 };
 
@@ -82,9 +86,14 @@ class Worker : public Thread {
     plb.add_u64_counter(l_msgr_send_bytes, "msgr_send_bytes", "Network received bytes");
     plb.add_u64_counter(l_msgr_created_connections, "msgr_created_connections", "Created connection number");
     plb.add_u64_counter(l_msgr_active_connections, "msgr_active_connections", "Active connection number");
+    plb.add_u64_counter(l_msgr_compressed_msgs_sent, "msgr_compressed_msgs_sent", "Messages sent with a compressed data segment");
+    plb.add_u64_counter(l_msgr_compressed_bytes_saved, "msgr_compressed_bytes_saved", "Wire bytes saved by data compression");
+    plb.add_u64_counter(l_msgr_compressed_msgs_recv, "msgr_compressed_msgs_recv", "Messages received with a compressed data segment");
+    plb.add_time_avg(l_msgr_external_event_lat, "msgr_external_event_latency", "Time external events spend queued before dispatch");
 
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
+    center.set_external_perf(perf_logger, l_msgr_external_event_lat);
   }
   ~Worker() {
     if (perf_logger) {
@@ -95,6 +104,13 @@ class Worker : public Thread {
   void *entry();
   void stop();
   PerfCounters *get_perf_counter() { return perf_logger; }
+  uint64_t get_traffic_bytes() {
+    return perf_logger->get(l_msgr_recv_bytes) +
+        perf_logger->get(l_msgr_send_bytes);
+  }
+  // placement bookkeeping, only touched under WorkerPool::pool_spin
+  uint64_t prev_traffic_bytes = 0;
+  uint64_t traffic_rate = 0;    // bytes/sec over the last sample window
   void release_worker() {
     int oldref = references.fetch_sub(1);
     assert(oldref > 0);
@@ -15,6 +15,7 @@
  */
 
 #include "common/errno.h"
+#include "common/perf_counters.h"
 #include "Event.h"
 
 #ifdef HAVE_EPOLL
@@ -111,15 +112,12 @@ int EventCenter::init(int n, unsigned i)
 
 EventCenter::~EventCenter()
 {
-  {
-    std::lock_guard<std::mutex> l(external_lock);
-    while (!external_events.empty()) {
-      EventCallbackRef e = external_events.front();
-      if (e)
-        e->do_request(0);
-      external_events.pop_front();
-    }
+  // no producers are left by now; run anything still queued
+  while (ExternalEvent *ev = pop_external()) {
+    if (ev->cb)
+      ev->cb->do_request(0);
   }
+  delete external_tail;   // the remaining stub node
   assert(time_events.empty());
 
   if (notify_receive_fd >= 0)
@@ -260,9 +258,20 @@ void EventCenter::delete_time_event(uint64_t id)
 
 void EventCenter::wakeup()
 {
-    ldout(cct, 1) << __func__ << dendl;
-    already_wakeup.compare_and_swap(0, 1);
+    // The owner is spinning on zero-timeout waits, the next pass of the
+    // spin picks up whatever we queued.  The seq_cst ordering between
+    // this load, external_num_events and the owner clearing the flag
+    // before a blocking wait guarantees no dispatch is slept over.
+    if (polling.load())
+      return ;
+
+    // coalesce: only the submitter that flips the flag writes to the
+    // pipe; C_handle_notify clears the flag before draining, so a
+    // raised flag always has its own byte in flight
+    if (!already_wakeup.compare_and_swap(0, 1))
+      return ;
 
+    ldout(cct, 1) << __func__ << dendl;
     char buf[1];
     buf[0] = 'c';
     // wake up "event_wait"
@@ -271,6 +280,27 @@ void EventCenter::wakeup()
     assert(n == 1);
 }
 
+EventCenter::ExternalEvent *EventCenter::pop_external()
+{
+  // single consumer: advance the tail cursor over the stub node.  The
+  // returned node becomes the new stub, so its payload stays valid
+  // until the next pop.
+  ExternalEvent *tail = external_tail;
+  ExternalEvent *next = tail->next.load();
+  if (!next) {
+    if (external_head.load() == tail)
+      return NULL;  // truly empty
+    // a producer has swung external_head but not linked yet, spin for
+    // the (two instruction) window to close
+    do {
+      next = tail->next.load();
+    } while (!next);
+  }
+  external_tail = next;
+  delete tail;
+  return next;
+}
+
 int EventCenter::process_time_events()
 {
   int processed = 0;
@@ -359,33 +389,34 @@ int EventCenter::process_events(int timeout_microseconds)
   if (trigger_time)
     numevents += process_time_events();
 
-  if (external_num_events.load()) {
-    external_lock.lock();
-    if (external_events.empty()) {
-      external_lock.unlock();
-    } else {
-      deque<EventCallbackRef> cur_process;
-      cur_process.swap(external_events);
-      external_num_events.store(0);
-      external_lock.unlock();
-      while (!cur_process.empty()) {
-        EventCallbackRef e = cur_process.front();
-        if (e)
-          e->do_request(0);
-        cur_process.pop_front();
-        numevents++;
-      }
-    }
+  // drain only the events counted so far; callbacks may queue more and
+  // we don't want to starve file/time events behind an endless stream
+  uint64_t external = external_num_events.exchange(0);
+  while (external > 0) {
+    ExternalEvent *ev = pop_external();
+    if (!ev)
+      break;
+    if (external_logger)
+      external_logger->tinc(l_external_lat,
+                            std::chrono::duration_cast<ceph::timespan>(
+                                clock_type::now() - ev->queued_at));
+    if (ev->cb)
+      ev->cb->do_request(0);
+    external--;
+    numevents++;
   }
   return numevents;
 }
 
 void EventCenter::dispatch_event_external(EventCallbackRef e)
 {
-  external_lock.lock();
-  external_events.push_back(e);
+  ExternalEvent *node = new ExternalEvent(e, clock_type::now());
+  // wait-free push: claim the head with one exchange, then link the
+  // predecessor to us.  pop_external() copes with the tiny unlinked
+  // window.
+  ExternalEvent *prev = external_head.exchange(node);
+  prev->next.store(node);
   uint64_t num = ++external_num_events;
-  external_lock.unlock();
   if (!in_thread())
     wakeup();
 
@@ -50,6 +50,7 @@
 #define EVENT_WRITABLE 2
 
 class EventCenter;
+class PerfCounters;
 
 class EventCallback {
 
@@ -110,13 +111,28 @@ class EventCenter {
     TimeEvent(): id(0), time_cb(NULL) {}
   };
 
+  /// node of the external event queue: a Vyukov-style unbounded MPSC
+  /// list, so producers (dispatch threads submitting cross-thread
+  /// work) enqueue with a single atomic exchange instead of fighting
+  /// over a mutex; only the owner thread pops.  queued_at feeds the
+  /// external-event latency counter.
+  struct ExternalEvent {
+    EventCallbackRef cb;
+    ceph::coarse_mono_clock::time_point queued_at;
+    std::atomic<ExternalEvent*> next;
+    ExternalEvent(EventCallbackRef c, ceph::coarse_mono_clock::time_point t)
+      : cb(c), queued_at(t), next(nullptr) {}
+  };
+
   CephContext *cct;
   int nevent;
   // Used only to external event
   pthread_t owner;
-  std::mutex external_lock;
+  std::atomic<ExternalEvent*> external_head;  ///< most recently pushed
+  ExternalEvent *external_tail;               ///< consumer cursor (stub node)
   std::atomic_ulong external_num_events;
-  deque<EventCallbackRef> external_events;
+  PerfCounters *external_logger;  ///< owned by our Worker, may be NULL
+  int l_external_lat;             ///< index of the latency counter
   vector<FileEvent> file_events;
   EventDriver *driver;
   std::multimap<clock_type::time_point, TimeEvent> time_events;
@@ -124,12 +140,17 @@ class EventCenter {
   uint64_t time_event_next_id;
   int notify_receive_fd;
   int notify_send_fd;
+  // owner thread is busy-polling with zero timeout; external dispatches
+  // will be picked up by the spin itself, so wakeup() can skip the
+  // notify pipe write (see Worker::entry)
+  std::atomic_bool polling;
   NetHandler net;
   EventCallbackRef notify_handler;
   unsigned idx = 10000;
   AssociatedCenters *global_centers;
 
   int process_time_events();
+  ExternalEvent *pop_external();
   FileEvent *_get_file_event(int fd) {
     assert(fd < nevent);
     return &file_events[fd];
@@ -141,10 +162,13 @@ class EventCenter {
   explicit EventCenter(CephContext *c):
     cct(c), nevent(0),
     external_num_events(0),
+    external_logger(NULL), l_external_lat(0),
     driver(NULL), time_event_next_id(1),
-    notify_receive_fd(-1), notify_send_fd(-1), net(c),
+    notify_receive_fd(-1), notify_send_fd(-1), polling(false), net(c),
     notify_handler(NULL),
     already_wakeup(0) {
+    external_tail = new ExternalEvent(NULL, ceph::coarse_mono_clock::now());
+    external_head.store(external_tail);
   }
   ~EventCenter();
   ostream& _event_prefix(std::ostream *_dout);
@@ -152,6 +176,12 @@ class EventCenter {
   int init(int nevent, unsigned idx);
   void set_owner();
   unsigned get_id() const { return idx; }
+  /// wire up the owning Worker's perf counters; l_lat is the index of
+  /// a time-avg counter fed with the queue wait of each external event
+  void set_external_perf(PerfCounters *logger, int l_lat) {
+    external_logger = logger;
+    l_external_lat = l_lat;
+  }
 
   // Used by internal thread
   int create_file_event(int fd, int mask, EventCallbackRef ctxt);
@@ -159,6 +189,7 @@ class EventCenter {
   void delete_file_event(int fd, int mask);
   void delete_time_event(uint64_t id);
   int process_events(int timeout_microseconds);
+  void set_polling(bool p) { polling = p; }
   void wakeup();
 
   // Used by external thread
@@ -234,7 +234,10 @@ static const int SM_IOV_MAX = (IOV_MAX >= 1024 ? IOV_MAX / 4 : IOV_MAX);
 
     int read_message(Message **pm,
 		     AuthSessionHandler *session_security_copy);
-    int write_message(const ceph_msg_header& h, const ceph_msg_footer& f, bufferlist& body);
+    // if ack_seq is non-zero an ack for it is prepended to the same
+    // sendmsg, saving the separate write_ack syscall
+    int write_message(const ceph_msg_header& h, const ceph_msg_footer& f, bufferlist& body,
+		      uint64_t ack_seq=0);
     /**
      * Write the given data (of length len) to the Pipe's socket. This function
      * will loop until all passed data has been written out.
@@ -12,11 +12,15 @@
  * 
  */
 #include <ctype.h>
+#include <fcntl.h>
 #include <sstream>
 #include "include/memory.h"
+#include "include/compat.h"
 #include "ObjectStore.h"
 #include "common/Formatter.h"
+#include "common/errno.h"
 #include "common/safe_io.h"
+#include "global/global_context.h"
 
 #include "filestore/FileStore.h"
 #include "memstore/MemStore.h"
@@ -66,23 +70,77 @@ ObjectStore *ObjectStore::create(CephContext *cct,
 				 const string& journal,
 			         osflagbits_t flags)
 {
+  ObjectStore *os = NULL;
   if (type == "filestore") {
-    return new FileStore(data, journal, flags);
+    os = new FileStore(data, journal, flags);
+  } else if (type == "memstore") {
+    os = new MemStore(cct, data);
+#if defined(HAVE_LIBAIO)
+  } else if (type == "bluestore" &&
+	     cct->check_experimental_feature_enabled("bluestore")) {
+    os = new BlueStore(cct, data);
+#endif
+  } else if (type == "kstore" &&
+	     cct->check_experimental_feature_enabled("kstore")) {
+    os = new KStore(cct, data);
   }
-  if (type == "memstore") {
-    return new MemStore(cct, data);
+  if (os && cct->_conf->osd_objectstore_trace_file.length()) {
+    int r = os->trace_start(cct->_conf->osd_objectstore_trace_file);
+    if (r < 0)
+      lgeneric_derr(cct) << __func__ << " unable to open transaction trace "
+			 << cct->_conf->osd_objectstore_trace_file << ": "
+			 << cpp_strerror(r) << dendl;
   }
-#if defined(HAVE_LIBAIO)
-  if (type == "bluestore" &&
-      cct->check_experimental_feature_enabled("bluestore")) {
-    return new BlueStore(cct, data);
+  return os;
+}
+
+int ObjectStore::trace_start(const string& file)
+{
+  Mutex::Locker l(trace_lock);
+  if (trace_fd >= 0) {
+    VOID_TEMP_FAILURE_RETRY(::close(trace_fd));
+    trace_fd = -1;
   }
-#endif
-  if (type == "kstore" &&
-      cct->check_experimental_feature_enabled("kstore")) {
-    return new KStore(cct, data);
+  int fd = TEMP_FAILURE_RETRY(::open(file.c_str(),
+				     O_CREAT|O_TRUNC|O_WRONLY, 0644));
+  if (fd < 0)
+    return -errno;
+  trace_fd = fd;
+  return 0;
+}
+
+void ObjectStore::trace_stop()
+{
+  Mutex::Locker l(trace_lock);
+  if (trace_fd >= 0) {
+    VOID_TEMP_FAILURE_RETRY(::close(trace_fd));
+    trace_fd = -1;
+  }
+}
+
+void ObjectStore::trace_transactions(Sequencer *osr, vector<Transaction>& tls)
+{
+  // encode outside the lock; only the actual append is serialized
+  bufferlist bl;
+  ENCODE_START(1, 1, bl);
+  utime_t stamp = ceph_clock_now(g_ceph_context);
+  ::encode(stamp, bl);
+  string name = osr ? osr->get_name() : string();
+  ::encode(name, bl);
+  ::encode(tls, bl);
+  ENCODE_FINISH(bl);
+
+  Mutex::Locker l(trace_lock);
+  if (trace_fd < 0)
+    return;
+  int r = bl.write_fd(trace_fd);
+  if (r < 0) {
+    lgeneric_derr(g_ceph_context) << __func__ << " write failed: "
+				  << cpp_strerror(r)
+				  << ", stopping trace" << dendl;
+    VOID_TEMP_FAILURE_RETRY(::close(trace_fd));
+    trace_fd = -1;
   }
-  return NULL;
 }
 
 int ObjectStore::probe_block_device_fsid(
@@ -192,3 +250,25 @@ int ObjectStore::queue_transactions(
   return queue_transactions(osr, tls, _onreadable, _oncommit,
 			    onreadable_sync, op);
 }
+
+int ObjectStore::omap_get_range(
+  const coll_t& c,
+  const ghobject_t &oid,
+  const string &after,
+  unsigned max_return,
+  map<string, bufferlist> *out,
+  bool *more)
+{
+  ObjectMap::ObjectMapIterator iter = get_omap_iterator(c, oid);
+  if (!iter)
+    return -ENOENT;
+  for (iter->upper_bound(after);
+       iter->valid() && max_return > 0;
+       iter->next()) {
+    out->insert(make_pair(iter->key(), iter->value()));
+    --max_return;
+  }
+  if (more)
+    *more = iter->valid();
+  return 0;
+}
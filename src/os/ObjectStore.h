@@ -95,6 +95,10 @@ class ObjectStore {
 protected:
   string path;
 
+  // binary transaction trace (see trace_start)
+  Mutex trace_lock;
+  int trace_fd;
+
 public:
   /**
    * create - create an ObjectStore instance.
@@ -817,6 +821,53 @@ public:
       data_bl.append(other.data_bl);
     }
 
+    /// Destructive variant of append: other's op buffer is patched in
+    /// place and its buffers are claimed rather than copied, and other
+    /// is left empty.  Only safe when other exclusively owns its
+    /// buffers, i.e. it was built locally and is not sharing memory
+    /// with a decoded message or another transaction.
+    void claim_append(Transaction& other) {
+      assert(use_tbl == other.use_tbl);
+
+      data.ops += other.data.ops;
+      if (other.data.largest_data_len > data.largest_data_len) {
+	data.largest_data_len = other.data.largest_data_len;
+	data.largest_data_off = other.data.largest_data_off;
+	data.largest_data_off_in_tbl = tbl.length() + other.data.largest_data_off_in_tbl;
+      }
+      data.fadvise_flags |= other.data.fadvise_flags;
+      tbl.claim_append(other.tbl);
+      on_applied.splice(on_applied.end(), other.on_applied);
+      on_commit.splice(on_commit.end(), other.on_commit);
+      on_applied_sync.splice(on_applied_sync.end(), other.on_applied_sync);
+
+      //append coll_index & object_index
+      vector<__le32> cm(other.coll_index.size());
+      map<coll_t, __le32>::iterator coll_index_p;
+      for (coll_index_p = other.coll_index.begin();
+           coll_index_p != other.coll_index.end();
+           ++coll_index_p) {
+        cm[coll_index_p->second] = _get_coll_id(coll_index_p->first);
+      }
+
+      vector<__le32> om(other.object_index.size());
+      map<ghobject_t, __le32, ghobject_t::BitwiseComparator>::iterator object_index_p;
+      for (object_index_p = other.object_index.begin();
+           object_index_p != other.object_index.end();
+           ++object_index_p) {
+        om[object_index_p->second] = _get_object_id(object_index_p->first);
+      }
+
+      //update the indices directly in other's op_bl; we are about to
+      //claim its buffers, so there is no later user to preserve them for
+      _update_op_bl(other.op_bl, cm, om);
+
+      //claim op_bl and data_bl
+      op_bl.claim_append(other.op_bl);
+      data_bl.claim_append(other.data_bl);
+      other = Transaction();
+    }
+
     /** Inquires about the Transaction as a whole. */
 
     /// How big is the encoded Transaction buffer?
@@ -1850,9 +1901,31 @@ public:
       osr, tls, onreadable, oncommit, onreadable_sync, oncomplete, op);
   }
 
+  /**
+   * trace_start - start appending a binary transaction trace to file
+   *
+   * Each record carries a timestamp, the sequencer name and the encoded
+   * transaction vector, so a capture taken on a live osd (via
+   * osd_objectstore_trace_file) can later be replayed and re-timed
+   * against another store build with ceph_objectstore_tracereplay.
+   */
+  int trace_start(const string& file);
+  void trace_stop();
+  bool tracing() const {
+    return trace_fd >= 0;
+  }
+  void trace_transactions(Sequencer *osr, vector<Transaction>& tls);
+
  public:
-  explicit ObjectStore(const std::string& path_) : path(path_), logger(NULL) {}
-  virtual ~ObjectStore() {}
+  explicit ObjectStore(const std::string& path_)
+    : path(path_),
+      trace_lock("ObjectStore::trace_lock"),
+      trace_fd(-1),
+      logger(NULL) {}
+  virtual ~ObjectStore() {
+    if (trace_fd >= 0)
+      ::close(trace_fd);
+  }
 
   // no copying
   explicit ObjectStore(const ObjectStore& o);
@@ -2262,6 +2335,34 @@ public:
     return omap_get_values(c->get_cid(), oid, keys, out);
   }
 
+  /**
+   * Bulk-fetch a range of omap keys and values
+   *
+   * Returns up to max_return key/value pairs sorting after the given
+   * key in a single call, so range scans (e.g. the rgw bucket index)
+   * pay one backend round trip per batch instead of per key.  The
+   * generic implementation walks get_omap_iterator; backends with a
+   * native sorted store should override it.
+   */
+  virtual int omap_get_range(
+    const coll_t& c,             ///< [in] Collection containing oid
+    const ghobject_t &oid,       ///< [in] Object containing omap
+    const string &after,         ///< [in] return keys > this value
+    unsigned max_return,         ///< [in] return no more than this many
+    map<string, bufferlist> *out,///< [out] returned keys and values
+    bool *more                   ///< [out] true if more keys remain
+    );
+  virtual int omap_get_range(
+    CollectionHandle &c,         ///< [in] Collection containing oid
+    const ghobject_t &oid,       ///< [in] Object containing omap
+    const string &after,         ///< [in] return keys > this value
+    unsigned max_return,         ///< [in] return no more than this many
+    map<string, bufferlist> *out,///< [out] returned keys and values
+    bool *more                   ///< [out] true if more keys remain
+    ) {
+    return omap_get_range(c->get_cid(), oid, after, max_return, out, more);
+  }
+
   /// Filters keys into out which are defined on oid
   virtual int omap_check_keys(
     const coll_t& c,                ///< [in] Collection containing oid
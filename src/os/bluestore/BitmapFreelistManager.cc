@@ -3,6 +3,7 @@
 
 #include "BitmapFreelistManager.h"
 #include "kv/KeyValueDB.h"
+#include "kv/MergeOperators.h"
 #include "kv.h"
 
 #include "common/debug.h"
@@ -17,28 +18,6 @@ void make_offset_key(uint64_t offset, std::string *key)
   _key_encode_u64(offset, key);
 }
 
-struct XorMergeOperator : public KeyValueDB::MergeOperator {
-  virtual void merge_nonexistent(
-    const char *rdata, size_t rlen, std::string *new_value) override {
-    *new_value = std::string(rdata, rlen);
-  }
-  virtual void merge(
-    const char *ldata, size_t llen,
-    const char *rdata, size_t rlen,
-    std::string *new_value) {
-    assert(llen == rlen);
-    *new_value = std::string(ldata, llen);
-    for (size_t i = 0; i < rlen; ++i) {
-      (*new_value)[i] ^= rdata[i];
-    }
-  }
-  // We use each operator name and each prefix to construct the
-  // overall RocksDB operator name for consistency check at open time.
-  virtual string name() const {
-    return "bitwise_xor";
-  }
-};
-
 void BitmapFreelistManager::setup_merge_operator(KeyValueDB *db, string prefix)
 {
   ceph::shared_ptr<XorMergeOperator> merge_op(new XorMergeOperator);
@@ -471,6 +450,79 @@ void BitmapFreelistManager::release(
   _xor(offset, length, txn);
 }
 
+void BitmapFreelistManager::apply(
+  const interval_set<uint64_t>& allocated,
+  const interval_set<uint64_t>& released,
+  KeyValueDB::Transaction txn)
+{
+  dout(10) << __func__ << std::hex
+	   << " allocated 0x" << allocated
+	   << " released 0x" << released
+	   << std::dec << dendl;
+  if (g_conf->bluestore_debug_freelist) {
+    for (auto p = allocated.begin(); p != allocated.end(); ++p) {
+      _verify_range(p.get_start(), p.get_len(), 0);
+    }
+    for (auto p = released.begin(); p != released.end(); ++p) {
+      _verify_range(p.get_start(), p.get_len(), 1);
+    }
+  }
+
+  // the bitmap updates are pure xors, so both directions can share one
+  // accumulator; ranges that touch the same key collapse into a single
+  // merge instead of one per range.
+  std::map<uint64_t,bufferptr> deltas;
+  for (auto p = allocated.begin(); p != allocated.end(); ++p) {
+    _xor_accumulate(p.get_start(), p.get_len(), deltas);
+  }
+  for (auto p = released.begin(); p != released.end(); ++p) {
+    _xor_accumulate(p.get_start(), p.get_len(), deltas);
+  }
+
+  for (auto& d : deltas) {
+    string k;
+    make_offset_key(d.first, &k);
+    bufferlist bl;
+    bl.append(d.second);
+    dout(30) << __func__ << " 0x" << std::hex << d.first << std::dec << ": ";
+    bl.hexdump(*_dout, false);
+    *_dout << dendl;
+    txn->merge(bitmap_prefix, k, bl);
+  }
+}
+
+void BitmapFreelistManager::_xor_accumulate(
+  uint64_t offset, uint64_t length,
+  std::map<uint64_t,bufferptr>& deltas)
+{
+  // must be block aligned
+  assert((offset & block_mask) == offset);
+  assert((length & block_mask) == length);
+
+  uint64_t first_key = offset & key_mask;
+  uint64_t last_key = (offset + length - 1) & key_mask;
+  dout(20) << __func__ << " first_key 0x" << std::hex << first_key
+	   << " last_key 0x" << last_key << std::dec << dendl;
+
+  for (uint64_t key = first_key; key <= last_key; key += bytes_per_key) {
+    auto it = deltas.find(key);
+    if (it == deltas.end()) {
+      bufferptr z(blocks_per_key >> 3);
+      z.zero();
+      it = deltas.insert(std::make_pair(key, z)).first;
+    }
+    bufferptr& p = it->second;
+    unsigned s = (key == first_key) ?
+      (offset & ~key_mask) / bytes_per_block : 0;
+    unsigned e = (key == last_key) ?
+      ((offset + length - 1) & ~key_mask) / bytes_per_block :
+      blocks_per_key - 1;
+    for (unsigned i = s; i <= e; ++i) {
+      p[i >> 3] ^= 1ull << (i & 7);
+    }
+  }
+}
+
 void BitmapFreelistManager::_xor(
   uint64_t offset, uint64_t length,
   KeyValueDB::Transaction txn)
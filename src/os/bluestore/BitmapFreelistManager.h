@@ -44,6 +44,9 @@ class BitmapFreelistManager : public FreelistManager {
   void _xor(
     uint64_t offset, uint64_t length,
     KeyValueDB::Transaction txn);
+  void _xor_accumulate(
+    uint64_t offset, uint64_t length,
+    std::map<uint64_t,bufferptr>& deltas);
 
 public:
   BitmapFreelistManager(KeyValueDB *db, string meta_prefix,
@@ -67,6 +70,11 @@ public:
   void release(
     uint64_t offset, uint64_t length,
     KeyValueDB::Transaction txn) override;
+
+  void apply(
+    const interval_set<uint64_t>& allocated,
+    const interval_set<uint64_t>& released,
+    KeyValueDB::Transaction txn) override;
 };
 
 #endif
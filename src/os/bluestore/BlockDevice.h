@@ -22,6 +22,7 @@
 #include <mutex>
 
 #include "acconfig.h"
+#include "include/interval_set.h"
 #include "os/fs/FS.h"
 
 #define SPDK_PREFIX "spdk:"
@@ -80,6 +81,8 @@ public:
   BlockDevice() = default;
   virtual ~BlockDevice() = default;
   typedef void (*aio_callback_t)(void *handle, void *aio);
+  typedef void (*discard_callback_t)(void *handle,
+				     interval_set<uint64_t>& released);
 
   static BlockDevice *create(
       const string& path, aio_callback_t cb, void *cbpriv);
@@ -100,6 +103,16 @@ public:
 		IOContext *ioc, bool buffered) = 0;
   virtual int flush() = 0;
 
+  /// called from the discard thread once the device has zapped extents
+  virtual void set_discard_callback(discard_callback_t cb, void *cbpriv) {}
+  /// queue extents for async discard; on success the extents are handed
+  /// back through the discard callback once the device is done with them
+  virtual int queue_discard(interval_set<uint64_t>& to_release) {
+    return -EOPNOTSUPP;
+  }
+  /// wait for all queued discards to be issued and called back
+  virtual void discard_drain() {}
+
   void queue_reap_ioc(IOContext *ioc);
   void reap_ioc();
 
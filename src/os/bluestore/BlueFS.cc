@@ -77,6 +77,12 @@ void BlueFS::_init_logger()
 		    "Bytes written to WAL");
   b.add_u64_counter(l_bluefs_bytes_written_sst, "bytes_written_sst",
 		    "Bytes written to SSTs");
+  b.add_u64_counter(l_bluefs_files_promoted, "files_promoted",
+		    "Files migrated to a faster device");
+  b.add_u64_counter(l_bluefs_files_demoted, "files_demoted",
+		    "Files migrated to a slower device");
+  b.add_u64_counter(l_bluefs_bytes_migrated, "bytes_migrated",
+		    "Bytes copied by file migration");
   logger = b.create_perf_counters();
   g_ceph_context->get_perfcounters_collection()->add(logger);
 }
@@ -557,6 +563,33 @@ int BlueFS::_replay()
 	}
 	break;
 
+      case bluefs_transaction_t::OP_JUMP:
+        {
+	  uint64_t next_seq;
+	  uint64_t offset;
+	  ::decode(next_seq, p);
+	  ::decode(offset, p);
+	  dout(20) << __func__ << " 0x" << std::hex << pos << std::dec
+		   << ":  op_jump seq " << next_seq
+		   << " offset 0x" << std::hex << offset << std::dec << dendl;
+	  assert(next_seq >= log_seq);
+	  log_seq = next_seq - 1; // we will increment it below
+	  uint64_t skip = offset - (pos + bl.length());
+	  if (skip) {
+	    bufferlist junk;
+	    int r = _read(log_reader, &log_reader->buf, pos + bl.length(),
+			  skip, &junk, NULL);
+	    if (r != (int)skip) {
+	      dout(10) << __func__ << " 0x" << std::hex << pos + bl.length()
+		       << ": stop: failed to skip to " << offset
+		       << std::dec << dendl;
+	      delete log_reader;
+	      return -EIO;
+	    }
+	  }
+	}
+	break;
+
       case bluefs_transaction_t::OP_ALLOC_ADD:
         {
 	  __u8 id;
@@ -761,6 +794,7 @@ int BlueFS::_read_random(
 	   << " from " << h->file->fnode << dendl;
 
   ++h->file->num_reading;
+  ++h->file->num_reads;
 
   if (!h->ignore_eof &&
       off + len > h->file->fnode.size) {
@@ -811,6 +845,7 @@ int BlueFS::_read(
 	   << " from " << h->file->fnode << dendl;
 
   ++h->file->num_reading;
+  ++h->file->num_reads;
 
   if (!h->ignore_eof &&
       off + len > h->file->fnode.size) {
@@ -918,8 +953,12 @@ uint64_t BlueFS::_estimate_log_size()
   return ROUND_UP_TO(size, super.block_size);
 }
 
-void BlueFS::_maybe_compact_log()
+void BlueFS::_maybe_compact_log(std::unique_lock<std::mutex>& l)
 {
+  if (new_log_writer) {
+    dout(10) << __func__ << " already compacting" << dendl;
+    return;
+  }
   uint64_t current = log_writer->file->fnode.size;
   uint64_t expected = _estimate_log_size();
   float ratio = (float)current / (float)expected;
@@ -929,52 +968,188 @@ void BlueFS::_maybe_compact_log()
   if (current < g_conf->bluefs_log_compact_min_size ||
       ratio < g_conf->bluefs_log_compact_min_ratio)
     return;
-  _compact_log();
+  if (g_conf->bluefs_compact_log_sync)
+    _compact_log_sync();
+  else
+    _compact_log_async(l);
   dout(20) << __func__ << " done, actual " << log_writer->file->fnode.size
 	   << " vs expected " << expected << dendl;
 }
 
-void BlueFS::_compact_log()
+int BlueFS::_migrate_file(FileRef f, unsigned dev)
 {
-  // FIXME: we currently hold the lock while writing out the compacted log,
-  // which may mean a latency spike.  we could drop the lock while writing out
-  // the big compacted log, while continuing to log at the end of the old log
-  // file, and once it's done swap out the old log extents for the new ones.
-  dout(10) << __func__ << dendl;
-  File *log_file = log_writer->file.get();
+  dout(10) << __func__ << " " << f->fnode << " to bdev " << dev << dendl;
+  assert(!f->deleted);
+  assert(f->fnode.ino != 1);
+  assert(f->num_writers.load() == 0);
+  assert(f->num_readers.load() == 0);
 
-  // clear out log (be careful who calls us!!!)
-  log_t.clear();
+  vector<bluefs_extent_t> old_extents;
+  old_extents.swap(f->fnode.extents);
+  int r = _allocate(dev, f->fnode.get_allocated(), &f->fnode.extents);
+  if (r < 0) {
+    derr << __func__ << " failed to allocate 0x" << std::hex
+	 << f->fnode.get_allocated() << std::dec << " on bdev " << dev << dendl;
+    f->fnode.extents.swap(old_extents);
+    return r;
+  }
 
-  bluefs_transaction_t t;
-  t.seq = 1;
-  t.uuid = super.uuid;
+  // copy data; extents are multiples of bluefs_alloc_size, so the i/o is
+  // naturally block aligned.
+  auto p = old_extents.begin();
+  uint64_t p_off = 0;
+  auto q = f->fnode.extents.begin();
+  uint64_t q_off = 0;
+  uint64_t left = f->fnode.get_allocated();
+  while (left > 0) {
+    assert(p != old_extents.end());
+    assert(q != f->fnode.extents.end());
+    uint64_t l = MIN(p->length - p_off, q->length - q_off);
+    bufferlist bl;
+    r = bdev[p->bdev]->read(p->offset + p_off, l, &bl, ioc[p->bdev], false);
+    assert(r == 0);
+    bdev[q->bdev]->aio_write(q->offset + q_off, bl, ioc[q->bdev], false);
+    p_off += l;
+    if (p_off == p->length) {
+      ++p;
+      p_off = 0;
+    }
+    q_off += l;
+    if (q_off == q->length) {
+      ++q;
+      q_off = 0;
+    }
+    left -= l;
+  }
+  for (unsigned id = 0; id < MAX_BDEV; ++id) {
+    if (bdev[id] && ioc[id]->has_aios()) {
+      bdev[id]->aio_submit(ioc[id]);
+    }
+  }
+  for (unsigned id = 0; id < MAX_BDEV; ++id) {
+    if (bdev[id]) {
+      ioc[id]->aio_wait();
+    }
+  }
+  flush_bdev();
+
+  log_t.op_file_update(f->fnode);
+  for (auto& e : old_extents) {
+    alloc[e.bdev]->release(e.offset, e.length);
+  }
+  logger->inc(l_bluefs_bytes_migrated, f->fnode.get_allocated());
+  dout(10) << __func__ << " now " << f->fnode << dendl;
+  return 0;
+}
+
+void BlueFS::_maybe_migrate_files()
+{
+  if (!g_conf->bluefs_migrate_files)
+    return;
+  if (!bdev[BDEV_DB] || !bdev[BDEV_SLOW])
+    return;
+
+  // find the hottest file with data stranded on the slow device, and the
+  // coldest clean file resident on the db device.
+  FileRef hot, cold;
+  for (auto& p : file_map) {
+    FileRef f = p.second;
+    // readers walk fnode.extents without taking our lock, so only touch
+    // files with no open handles; handles are only created under the lock.
+    if (f->fnode.ino == 1 ||
+	f->deleted ||
+	f->fnode.prefer_bdev != BDEV_DB ||
+	f->num_writers.load() ||
+	f->num_readers.load() ||
+	f->fnode.get_allocated() == 0)
+      continue;
+    bool on_slow = false;
+    for (auto& e : f->fnode.extents) {
+      if (e.bdev == BDEV_SLOW) {
+	on_slow = true;
+	break;
+      }
+    }
+    if (on_slow) {
+      if (!hot || f->num_reads.load() > hot->num_reads.load())
+	hot = f;
+    } else {
+      if (!cold || f->num_reads.load() < cold->num_reads.load())
+	cold = f;
+    }
+  }
+
+  uint64_t db_free = alloc[BDEV_DB] ? alloc[BDEV_DB]->get_free() : 0;
+  uint64_t db_min_free =
+    block_total[BDEV_DB] * g_conf->bluefs_migrate_db_min_free_ratio;
+
+  // demote first: promotion is pointless if the db device is about to
+  // spill over again anyway.
+  if (db_free < db_min_free && cold) {
+    dout(10) << __func__ << " db free 0x" << std::hex << db_free
+	     << " < min 0x" << db_min_free << std::dec
+	     << ", demoting " << cold->fnode << dendl;
+    if (_migrate_file(cold, BDEV_SLOW) == 0) {
+      cold->num_reads = 0;
+      logger->inc(l_bluefs_files_demoted);
+    }
+    return;
+  }
+
+  if (hot &&
+      hot->num_reads.load() >= g_conf->bluefs_migrate_hot_read_count &&
+      db_free > db_min_free + hot->fnode.get_allocated()) {
+    dout(10) << __func__ << " promoting " << hot->fnode
+	     << " reads " << hot->num_reads.load() << dendl;
+    if (_migrate_file(hot, BDEV_DB) == 0) {
+      hot->num_reads = 0;
+      logger->inc(l_bluefs_files_promoted);
+    }
+  }
+}
+
+void BlueFS::_compact_log_dump_metadata(bluefs_transaction_t *t)
+{
+  t->seq = 1;
+  t->uuid = super.uuid;
   dout(20) << __func__ << " op_init" << dendl;
-  t.op_init();
+  t->op_init();
   for (unsigned bdev = 0; bdev < MAX_BDEV; ++bdev) {
     interval_set<uint64_t>& p = block_all[bdev];
     for (interval_set<uint64_t>::iterator q = p.begin(); q != p.end(); ++q) {
       dout(20) << __func__ << " op_alloc_add " << bdev << " 0x"
                << std::hex << q.get_start() << "~" << q.get_len() << std::dec
                << dendl;
-      t.op_alloc_add(bdev, q.get_start(), q.get_len());
+      t->op_alloc_add(bdev, q.get_start(), q.get_len());
     }
   }
   for (auto& p : file_map) {
     if (p.first == 1)
       continue;
     dout(20) << __func__ << " op_file_update " << p.second->fnode << dendl;
-    t.op_file_update(p.second->fnode);
+    t->op_file_update(p.second->fnode);
   }
   for (auto& p : dir_map) {
     dout(20) << __func__ << " op_dir_create " << p.first << dendl;
-    t.op_dir_create(p.first);
+    t->op_dir_create(p.first);
     for (auto& q : p.second->file_map) {
       dout(20) << __func__ << " op_dir_link " << p.first << "/" << q.first
 	       << " to " << q.second->fnode.ino << dendl;
-      t.op_dir_link(p.first, q.first, q.second->fnode.ino);
+      t->op_dir_link(p.first, q.first, q.second->fnode.ino);
     }
   }
+}
+
+void BlueFS::_compact_log_sync()
+{
+  dout(10) << __func__ << dendl;
+  File *log_file = log_writer->file.get();
+
+  // clear out log (be careful who calls us!!!)
+  log_t.clear();
+
+  bluefs_transaction_t t;
+  _compact_log_dump_metadata(&t);
   dout(20) << __func__ << " op_jump_seq " << log_seq << dendl;
   t.op_jump_seq(log_seq);
 
@@ -1017,6 +1192,146 @@ void BlueFS::_compact_log()
   logger->inc(l_bluefs_log_compactions);
 }
 
+/*
+ * Compact the log in the background, double-buffered: keep logging to
+ * the tail of the current log while the compacted metadata snapshot is
+ * written to freshly allocated extents, then atomically switch over.
+ *
+ * 1. Allocate a new extent to continue the log, and then log an event
+ *    that jumps the log write position to the new extent.  At this point, the
+ *    old extent(s) won't be written to, and reflect everything to compact.
+ *    New events will be written to the new region that we'll keep.
+ *
+ * 2. While still holding the lock, encode a bufferlist that dumps all of the
+ *    in-memory fnodes and names.  This will become the new beginning of the
+ *    log.  The last event will jump to the log continuation extent from #1.
+ *
+ * 3. Queue a write to a new extent for the new beginning of the log.
+ *
+ * 4. Drop lock and wait.
+ *
+ * 5. Retake the lock.
+ *
+ * 6. Update the log_fnode to splice in the new beginning.
+ *
+ * 7. Write the new superblock.
+ *
+ * 8. Release the old log space.
+ */
+void BlueFS::_compact_log_async(std::unique_lock<std::mutex>& l)
+{
+  dout(10) << __func__ << dendl;
+  File *log_file = log_writer->file.get();
+  assert(!new_log);
+  assert(!new_log_writer);
+
+  // 1. allocate new log space and jump to it.
+  old_log_jump_to = log_file->fnode.get_allocated();
+  uint64_t need = old_log_jump_to + g_conf->bluefs_max_log_runway;
+  dout(10) << __func__ << " old_log_jump_to 0x" << std::hex << old_log_jump_to
+           << " need 0x" << need << std::dec << dendl;
+  while (log_file->fnode.get_allocated() < need) {
+    int r = _allocate(log_file->fnode.prefer_bdev,
+		      need - log_file->fnode.get_allocated(),
+		      &log_file->fnode.extents);
+    assert(r == 0);
+  }
+
+  // update the log file change and log a jump to the offset where we want to
+  // write the new entries
+  log_t.op_file_update(log_file->fnode);
+  log_t.op_jump(log_seq, old_log_jump_to);
+  _flush_and_sync_log(l, 0, old_log_jump_to);
+
+  // 2. prepare compacted log
+  bluefs_transaction_t t;
+  _compact_log_dump_metadata(&t);
+
+  // conservative estimate for final encoded size
+  new_log_jump_to = ROUND_UP_TO(t.op_bl.length() + super.block_size * 2,
+                                g_conf->bluefs_alloc_size);
+  t.op_jump(log_seq, new_log_jump_to);
+
+  bufferlist bl;
+  ::encode(t, bl);
+  _pad_bl(bl);
+
+  dout(10) << __func__ << " new_log_jump_to 0x" << std::hex << new_log_jump_to
+	   << std::dec << dendl;
+
+  // create a new log [writer]
+  new_log = new File;
+  new_log->fnode.ino = 0;   // replay will skip it
+  int r = _allocate(BDEV_DB, new_log_jump_to, &new_log->fnode.extents);
+  assert(r == 0);
+  new_log_writer = _create_writer(new_log);
+  new_log_writer->append(bl);
+
+  // 3. flush
+  r = _flush(new_log_writer, true);
+  assert(r == 0);
+
+  // 4. wait for the io to land, without blocking other log appends
+  l.unlock();
+  wait_for_aio(new_log_writer);
+  flush_bdev();
+  l.lock();
+
+  // 5. update our log fnode: discard the old log extents up to
+  // old_log_jump_to and splice in the new log's extents in front of the
+  // retained tail.
+  vector<bluefs_extent_t> old_extents;
+  uint64_t discarded = 0;
+  while (discarded < old_log_jump_to) {
+    assert(!log_file->fnode.extents.empty());
+    bluefs_extent_t& e = log_file->fnode.extents.front();
+    bluefs_extent_t temp = e;
+    if (discarded + e.length <= old_log_jump_to) {
+      dout(10) << __func__ << " remove old log extent " << e << dendl;
+      discarded += e.length;
+      log_file->fnode.extents.erase(log_file->fnode.extents.begin());
+    } else {
+      dout(10) << __func__ << " remove front of old log extent " << e << dendl;
+      uint64_t drop = old_log_jump_to - discarded;
+      temp.length = drop;
+      e.offset += drop;
+      e.length -= drop;
+      discarded += drop;
+    }
+    old_extents.push_back(temp);
+  }
+  for (auto& e : log_file->fnode.extents) {
+    new_log->fnode.extents.push_back(e);
+  }
+  log_file->fnode.extents.swap(new_log->fnode.extents);
+  new_log->fnode.extents.clear();
+
+  // we will write it to super
+  log_file->fnode.size =
+    log_writer->pos - old_log_jump_to + new_log_jump_to;
+  log_writer->pos = log_file->fnode.size;
+
+  // 6. write the super block to reflect the changes
+  dout(10) << __func__ << " writing super" << dendl;
+  super.log_fnode = log_file->fnode;
+  ++super.version;
+  _write_super();
+  flush_bdev();
+
+  // 7. release old space
+  dout(10) << __func__ << " release old log extents " << old_extents << dendl;
+  for (auto& r : old_extents) {
+    alloc[r.bdev]->release(r.offset, r.length);
+  }
+
+  _close_writer(new_log_writer);
+  new_log_writer = NULL;
+  new_log = NULL;
+  log_cond.notify_all();
+
+  logger->inc(l_bluefs_log_compactions);
+}
+
 void BlueFS::_pad_bl(bufferlist& bl)
 {
   uint64_t partial = bl.length() % super.block_size;
@@ -1028,7 +1343,8 @@ void BlueFS::_pad_bl(bufferlist& bl)
 }
 
 int BlueFS::_flush_and_sync_log(std::unique_lock<std::mutex>& l,
-				uint64_t want_seq)
+				uint64_t want_seq,
+				uint64_t jump_to)
 {
   while (log_flushing) {
     dout(10) << __func__ << " want_seq " << want_seq
@@ -1089,6 +1405,13 @@ int BlueFS::_flush_and_sync_log(std::unique_lock<std::mutex>& l,
   log_flushing = false;
   log_cond.notify_all();
 
+  if (jump_to) {
+    dout(10) << __func__ << " jumping log offset to 0x" << std::hex << jump_to
+	     << std::dec << dendl;
+    log_writer->pos = jump_to;
+    log_writer->file->fnode.size = jump_to;
+  }
+
   // clean dirty files
   if (seq > log_seq_stable) {
     log_seq_stable = seq;
@@ -1150,10 +1473,10 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
   }
   if (h->file->fnode.size < offset + length) {
     h->file->fnode.size = offset + length;
-    if (h->file->fnode.ino != 1) {
-      // we do not need to dirty the log file when the file size
-      // changes because replay is smart enough to discover it on its
-      // own.
+    if (h->file->fnode.ino > 1) {
+      // we do not need to dirty the log file (or it's compacting
+      // replacement) when the file size changes because replay is
+      // smart enough to discover it on its own.
       must_dirty = true;
     }
   }
@@ -1442,13 +1765,14 @@ void BlueFS::sync_metadata()
       p->commit_start();
     }
   }
+  _maybe_migrate_files();
   _flush_and_sync_log(l);
   for (auto p : alloc) {
     if (p) {
       p->commit_finish();
     }
   }
-  _maybe_compact_log();
+  _maybe_compact_log(l);
   utime_t end = ceph_clock_now(NULL);
   utime_t dur = end - start;
   dout(10) << __func__ << " done in " << dur << dendl;
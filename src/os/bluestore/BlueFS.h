@@ -35,6 +35,9 @@ enum {
   l_bluefs_files_written_sst,
   l_bluefs_bytes_written_wal,
   l_bluefs_bytes_written_sst,
+  l_bluefs_files_promoted,
+  l_bluefs_files_demoted,
+  l_bluefs_bytes_migrated,
   l_bluefs_last,
 };
 
@@ -62,6 +65,8 @@ public:
     std::atomic_int num_readers, num_writers;
     std::atomic_int num_reading;
 
+    std::atomic<uint64_t> num_reads;  ///< read heat, for migration policy
+
     File()
       : RefCountedObject(NULL, 0),
 	refs(0),
@@ -70,7 +75,8 @@ public:
 	deleted(false),
 	num_readers(0),
 	num_writers(0),
-	num_reading(0)
+	num_reading(0),
+	num_reads(0)
       {}
     ~File() {
       assert(num_readers.load() == 0);
@@ -207,6 +213,11 @@ private:
   bool log_flushing = false;  ///< true while flushing the log
   std::condition_variable log_cond;
 
+  FileWriter *new_log_writer = nullptr; ///< writer for new compacted log
+  FileRef new_log;                      ///< new log for async compaction
+  uint64_t new_log_jump_to = 0;
+  uint64_t old_log_jump_to = 0;
+
   /*
    * There are up to 3 block devices:
    *
@@ -239,10 +250,16 @@ private:
   int _fsync(FileWriter *h, std::unique_lock<std::mutex>& l);
 
   int _flush_and_sync_log(std::unique_lock<std::mutex>& l,
-			  uint64_t want_seq = 0);
+			  uint64_t want_seq = 0,
+			  uint64_t jump_to = 0);
   uint64_t _estimate_log_size();
-  void _maybe_compact_log();
-  void _compact_log();
+  void _maybe_compact_log(std::unique_lock<std::mutex>& l);
+
+  int _migrate_file(FileRef f, unsigned dev);
+  void _maybe_migrate_files();
+  void _compact_log_dump_metadata(bluefs_transaction_t *t);
+  void _compact_log_sync();
+  void _compact_log_async(std::unique_lock<std::mutex>& l);
 
   //void _aio_finish(void *priv);
 
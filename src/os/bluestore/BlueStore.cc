@@ -21,11 +21,13 @@
 
 #include "BlueStore.h"
 #include "kv.h"
+#include "kv/MergeOperators.h"
 #include "include/compat.h"
 #include "include/intarith.h"
 #include "include/stringify.h"
 #include "common/errno.h"
 #include "common/safe_io.h"
+#include "compressor/AsyncCompressor.h"
 #include "Allocator.h"
 #include "FreelistManager.h"
 #include "BlueFS.h"
@@ -434,35 +436,6 @@ static void get_wal_key(uint64_t seq, string *out)
 }
 
 
-// merge operators
-
-struct Int64ArrayMergeOperator : public KeyValueDB::MergeOperator {
-  virtual void merge_nonexistent(
-    const char *rdata, size_t rlen, std::string *new_value) override {
-    *new_value = std::string(rdata, rlen);
-  }
-  virtual void merge(
-    const char *ldata, size_t llen,
-    const char *rdata, size_t rlen,
-    std::string *new_value) {
-    assert(llen == rlen);
-    assert((rlen % 8) == 0);
-    new_value->resize(rlen);
-    const __le64* lv = (const __le64*)ldata;
-    const __le64* rv = (const __le64*)rdata;
-    __le64* nv = &(__le64&)new_value->at(0);
-    for (size_t i = 0; i < rlen >> 3; ++i) {
-      nv[i] = lv[i] + rv[i];
-    }
-  }
-  // We use each operator name and each prefix to construct the
-  // overall RocksDB operator name for consistency check at open time.
-  virtual string name() const {
-    return "int64_array";
-  }
-};
-
-
 // Buffer
 
 ostream& operator<<(ostream& out, const BlueStore::Buffer& b)
@@ -598,9 +571,18 @@ void BlueStore::LRUCache::_audit(const char *when)
 
 void BlueStore::TwoQCache::_touch_onode(OnodeRef& o)
 {
-  auto p = onode_lru.iterator_to(*o);
-  onode_lru.erase(p);
-  onode_lru.push_front(*o);
+  if (o->cache_private == ONODE_HOT) {
+    auto p = onode_hot.iterator_to(*o);
+    onode_hot.erase(p);
+    onode_hot.push_front(*o);
+  } else {
+    // second access promotes to hot; a single scan pass stays in warm
+    // and ages out without displacing the hot working set
+    auto p = onode_warm.iterator_to(*o);
+    onode_warm.erase(p);
+    o->cache_private = ONODE_HOT;
+    onode_hot.push_front(*o);
+  }
 }
 
 void BlueStore::TwoQCache::_add_buffer(Buffer *b, int level, Buffer *near)
@@ -696,7 +678,8 @@ void BlueStore::TwoQCache::trim(uint64_t onode_max, uint64_t buffer_max)
 {
   std::lock_guard<std::mutex> l(lock);
 
-  dout(20) << __func__ << " onodes " << onode_lru.size() << " / " << onode_max
+  dout(20) << __func__ << " onodes " << onode_warm.size() << " warm + "
+	   << onode_hot.size() << " hot / " << onode_max
 	   << " buffers " << buffer_bytes << " / " << buffer_max
 	   << dendl;
 
@@ -791,34 +774,33 @@ void BlueStore::TwoQCache::trim(uint64_t onode_max, uint64_t buffer_max)
     }
   }
 
-  // onodes
-  int num = onode_lru.size() - onode_max;
+  // onodes: evict from warm first so a scan cannot displace the hot
+  // working set
+  int num = onode_warm.size() + onode_hot.size() - onode_max;
   if (num <= 0)
     return; // don't even try
 
-  auto p = onode_lru.end();
-  assert(p != onode_lru.begin());
-  --p;
-  while (num > 0) {
-    Onode *o = &*p;
-    int refs = o->nref.load();
-    if (refs > 1) {
-      dout(20) << __func__ << "  " << o->oid << " has " << refs
-	       << " refs; stopping with " << num << " left to trim" << dendl;
-      break;
-    }
-    dout(30) << __func__ << "  trim " << o->oid << dendl;
-    if (p != onode_lru.begin()) {
-      onode_lru.erase(p--);
-    } else {
-      onode_lru.erase(p);
-      assert(num == 1);
+  onode_lru_list_t *lists[2] = { &onode_warm, &onode_hot };
+  for (unsigned i = 0; i < 2 && num > 0; ++i) {
+    onode_lru_list_t& lru = *lists[i];
+    while (num > 0 && !lru.empty()) {
+      auto p = lru.end();
+      --p;
+      Onode *o = &*p;
+      int refs = o->nref.load();
+      if (refs > 1) {
+	dout(20) << __func__ << "  " << o->oid << " has " << refs
+		 << " refs; stopping with " << num << " left to trim" << dendl;
+	break;
+      }
+      dout(30) << __func__ << "  trim " << o->oid << dendl;
+      lru.erase(p);
+      o->get();  // paranoia
+      o->space->onode_map.erase(o->oid);
+      o->blob_map._clear();    // clear blobs and their buffers, too
+      o->put();
+      --num;
     }
-    o->get();  // paranoia
-    o->space->onode_map.erase(o->oid);
-    o->blob_map._clear();    // clear blobs and their buffers, too
-    o->put();
-    --num;
   }
 }
 
@@ -868,13 +850,15 @@ void BlueStore::TwoQCache::_audit(const char *when)
     uint64_t lc = 0, oc = 0;
     set<OnodeSpace*> spaces;
 
-    for (auto i = onode_lru.begin(); i != onode_lru.end(); ++i) {
-      assert(i->space->onode_map.count(i->oid));
-      if (spaces.count(i->space) == 0) {
-	spaces.insert(i->space);
-	oc += i->space->onode_map.size();
+    for (auto list : { &onode_warm, &onode_hot }) {
+      for (auto i = list->begin(); i != list->end(); ++i) {
+	assert(i->space->onode_map.count(i->oid));
+	if (spaces.count(i->space) == 0) {
+	  spaces.insert(i->space);
+	  oc += i->space->onode_map.size();
+	}
+	++lc;
       }
-      ++lc;
     }
 
     if (lc != oc) {
@@ -971,6 +955,8 @@ void BlueStore::BufferSpace::read(
 {
   std::lock_guard<std::mutex> l(cache->lock);
   res.clear();
+  uint64_t want_bytes = length;
+  uint64_t hit_bytes = 0;
   uint64_t end = offset + length;
   for (auto i = _data_lower_bound(offset);
        i != buffer_map.end() && offset < end && i->first < end;
@@ -983,6 +969,7 @@ void BlueStore::BufferSpace::read(
 	uint64_t l = MIN(length, b->length - skip);
 	res[offset].substr_of(b->data, skip, l);
 	res_intervals.insert(offset, l);
+	hit_bytes += l;
 	offset += l;
 	length -= l;
 	if (!b->is_writing()) {
@@ -1004,10 +991,12 @@ void BlueStore::BufferSpace::read(
       if (b->length > length) {
 	res[offset].substr_of(b->data, 0, length);
 	res_intervals.insert(offset, length);
+	hit_bytes += length;
         break;
       } else {
 	res[offset].append(b->data);
 	res_intervals.insert(offset, b->length);
+	hit_bytes += b->length;
         if (b->length == length)
           break;
 	offset += b->length;
@@ -1015,6 +1004,8 @@ void BlueStore::BufferSpace::read(
       }
     }
   }
+  cache->buffer_hit_bytes += hit_bytes;
+  cache->buffer_miss_bytes += want_bytes - hit_bytes;
 }
 
 void BlueStore::BufferSpace::finish_write(uint64_t seq)
@@ -1070,9 +1061,11 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
   ceph::unordered_map<ghobject_t,OnodeRef>::iterator p = onode_map.find(oid);
   if (p == onode_map.end()) {
     dout(30) << __func__ << " " << oid << " miss" << dendl;
+    ++cache->onode_misses;
     return OnodeRef();
   }
   dout(30) << __func__ << " " << oid << " hit " << p->second << dendl;
+  ++cache->onode_hits;
   cache->_touch_onode(p->second);
   return p->second;
 }
@@ -1347,6 +1340,12 @@ static void aio_cb(void *priv, void *priv2)
   store->_txc_aio_finish(priv2);
 }
 
+static void discard_cb(void *priv, interval_set<uint64_t>& released)
+{
+  BlueStore *store = static_cast<BlueStore*>(priv);
+  store->handle_discard(released);
+}
+
 BlueStore::BlueStore(CephContext *cct, const string& path)
   : ObjectStore(path),
     cct(cct),
@@ -1383,6 +1382,10 @@ BlueStore::BlueStore(CephContext *cct, const string& path)
     finisher(cct),
     kv_sync_thread(this),
     kv_stop(false),
+    kv_finalize_thread(this),
+    kv_finalize_stop(false),
+    cache_trim_thread(this),
+    cache_trim_stop(false),
     logger(NULL),
     csum_type(bluestore_blob_t::CSUM_CRC32C),
     sync_wal_apply(cct->_conf->bluestore_sync_wal_apply)
@@ -1401,6 +1404,11 @@ BlueStore::~BlueStore()
   assert(bluefs == NULL);
   assert(fsid_fd < 0);
   assert(path_fd < 0);
+  if (async_compressor) {
+    async_compressor->terminate();
+    delete async_compressor;
+    async_compressor = nullptr;
+  }
   for (auto i : cache_shards) {
     delete i;
   }
@@ -1416,6 +1424,7 @@ const char **BlueStore::get_tracked_conf_keys() const
     "bluestore_compression_algorithm",
     "bluestore_compression_min_blob_size",
     "bluestore_compression_max_blob_size",
+    "bluestore_compression_async",
     NULL
   };
   return KEYS;
@@ -1431,7 +1440,8 @@ void BlueStore::handle_conf_change(const struct md_config_t *conf,
   if (changed.count("bluestore_compression") ||
       changed.count("bluestore_compression_algorithm") ||
       changed.count("bluestore_compression_min_blob_size") ||
-      changed.count("bluestore_compression_max_blob_size")) {
+      changed.count("bluestore_compression_max_blob_size") ||
+      changed.count("bluestore_compression_async")) {
     _set_compression();
   }
 }
@@ -1476,15 +1486,26 @@ void BlueStore::_set_compression()
       compressor = Compressor::create(cct, alg);
       if (!compressor) {
         derr << __func__ << " unable to initialize " << alg << " compressor"
-             << ", reverting compression mode to 'none'" 
+             << ", reverting compression mode to 'none'"
 	     << dendl;
         comp_mode = COMP_NONE;
       }
     }
   }
- 
+
+  if (async_compressor) {
+    async_compressor->terminate();
+    delete async_compressor;
+    async_compressor = nullptr;
+  }
+  if (compressor && g_conf->bluestore_compression_async) {
+    async_compressor = new AsyncCompressor(cct, compressor);
+    async_compressor->init();
+  }
+
   dout(10) << __func__ << " mode " << get_comp_mode_name(comp_mode)
 	   << " alg " << (compressor ? compressor->get_type() : "(none)")
+	   << " async " << (async_compressor ? 1 : 0)
 	   << dendl;
 }
 
@@ -1524,6 +1545,14 @@ void BlueStore::_init_logger()
   b.add_u64(l_bluestore_wal_write_ops, "wal_write_ops", "Sum for wal write op");
   b.add_u64(l_bluestore_wal_write_bytes, "wal_write_bytes", "Sum for wal write bytes");
   b.add_u64(l_bluestore_write_penalty_read_ops, " write_penalty_read_ops", "Sum for write penalty read ops");
+  b.add_u64(l_bluestore_onodes, "bluestore_onodes", "Number of onodes in cache");
+  b.add_u64(l_bluestore_onode_hits, "bluestore_onode_hits", "Sum for onode-lookups hit in the cache");
+  b.add_u64(l_bluestore_onode_misses, "bluestore_onode_misses", "Sum for onode-lookups missed in the cache");
+  b.add_u64(l_bluestore_buffer_bytes, "bluestore_buffer_bytes", "Number of buffer bytes in cache");
+  b.add_u64(l_bluestore_buffer_hit_bytes, "bluestore_buffer_hit_bytes", "Sum for bytes of read hit in the cache");
+  b.add_u64(l_bluestore_buffer_miss_bytes, "bluestore_buffer_miss_bytes", "Sum for bytes of read missed in the cache");
+  b.add_u64(l_bluestore_discard_queued_bytes, "bluestore_discard_queued_bytes", "Sum for bytes queued for discard");
+  b.add_u64(l_bluestore_discard_backlog_bytes, "bluestore_discard_backlog_bytes", "Bytes queued for discard but not yet issued");
   logger = b.create_perf_counters();
   g_ceph_context->get_perfcounters_collection()->add(logger);
 }
@@ -1691,6 +1720,7 @@ int BlueStore::_open_bdev(bool create)
   assert(bdev == NULL);
   string p = path + "/block";
   bdev = BlockDevice::create(p, aio_cb, static_cast<void*>(this));
+  bdev->set_discard_callback(discard_cb, static_cast<void*>(this));
   int r = bdev->open(p);
   if (r < 0)
     goto fail;
@@ -1845,12 +1875,28 @@ int BlueStore::_open_alloc()
 
 void BlueStore::_close_alloc()
 {
+  assert(bdev);
+  // flush any queued discards first; their callback releases into alloc
+  bdev->discard_drain();
+
   assert(alloc);
   alloc->shutdown();
   delete alloc;
   alloc = NULL;
 }
 
+void BlueStore::handle_discard(interval_set<uint64_t>& released)
+{
+  dout(10) << __func__ << " 0x" << std::hex << released << std::dec << dendl;
+  assert(alloc);
+  for (interval_set<uint64_t>::iterator p = released.begin();
+       p != released.end();
+       ++p) {
+    alloc->release(p.get_start(), p.get_len());
+  }
+  logger->dec(l_bluestore_discard_backlog_bytes, released.size());
+}
+
 int BlueStore::_open_fsid(bool create)
 {
   assert(fsid_fd < 0);
@@ -2765,6 +2811,8 @@ int BlueStore::mount()
   finisher.start();
   wal_tp.start();
   kv_sync_thread.create("bstore_kv_sync");
+  kv_finalize_thread.create("bstore_kv_final");
+  cache_trim_thread.create("bstore_trim");
 
   r = _wal_replay();
   if (r < 0)
@@ -2777,6 +2825,7 @@ int BlueStore::mount()
   return 0;
 
  out_stop:
+  _cache_trim_stop();
   _kv_stop();
   wal_wq.drain();
   wal_tp.stop();
@@ -2808,6 +2857,8 @@ int BlueStore::umount()
   _reap_collections();
   coll_map.clear();
 
+  dout(20) << __func__ << " stopping cache trim thread" << dendl;
+  _cache_trim_stop();
   dout(20) << __func__ << " stopping kv thread" << dendl;
   _kv_stop();
   dout(20) << __func__ << " draining wal_wq" << dendl;
@@ -3064,6 +3115,7 @@ int BlueStore::fsck()
 	// lextents
 	map<int64_t,bluestore_extent_ref_map_t> local_blobs;
 	uint64_t lext_next_offset = 0, lext_prev_offset = 0;
+	o->onode.maybe_decode_extent_map();
 	for (auto& l : o->onode.extent_map) {
 	  if(l.first < lext_next_offset) {
 	    derr << " " << oid << " lextent at 0x" 
@@ -3429,9 +3481,6 @@ bool BlueStore::exists(CollectionHandle &c_, const ghobject_t& oid)
     return false;
   RWLock::RLocker l(c->lock);
   OnodeRef o = c->get_onode(oid, false);
-  c->cache->trim(
-    g_conf->bluestore_onode_cache_size,
-    g_conf->bluestore_buffer_cache_size);
   if (!o || !o->exists)
     return false;
   return true;
@@ -3467,9 +3516,6 @@ int BlueStore::stat(
   st->st_blksize = 4096;
   st->st_blocks = (st->st_size + st->st_blksize - 1) / st->st_blksize;
   st->st_nlink = 1;
-  c->cache->trim(
-    g_conf->bluestore_onode_cache_size,
-    g_conf->bluestore_buffer_cache_size);
   return 0;
 }
 
@@ -3522,9 +3568,6 @@ int BlueStore::read(
   r = _do_read(c, o, offset, length, bl, op_flags);
 
  out:
-  c->cache->trim(
-    g_conf->bluestore_onode_cache_size,
-    g_conf->bluestore_buffer_cache_size);
   dout(10) << __func__ << " " << cid << " " << oid
 	   << " 0x" << std::hex << offset << "~" << length << std::dec
 	   << " = " << r << dendl;
@@ -3665,7 +3708,17 @@ int BlueStore::_do_read(
 	  raw_bl, i.blob_xoffset, i.length);
       }
     } else {
+      struct region_read {
+	region_t reg;
+	uint64_t r_off = 0;
+	unsigned front = 0;
+	bufferlist bl;
+	explicit region_read(const region_t& r) : reg(r) {}
+      };
+      list<region_read> reads;
       for (auto reg : b2r_it->second) {
+	reads.emplace_back(reg);
+	region_read& rr = reads.back();
 	// determine how much of the blob to read
 	uint64_t chunk_size = bptr->blob.get_chunk_size(block_size);
 	uint64_t r_off = reg.blob_xoffset;
@@ -3687,23 +3740,34 @@ int BlueStore::_do_read(
 
 	// read it
 	IOContext ioc(NULL);  // FIXME?
-	bufferlist bl;
 	bptr->blob.map(r_off, r_len, [&](uint64_t offset, uint64_t length) {
 	    bufferlist t;
 	    int r = bdev->read(offset, length, &t, &ioc, false);
 	    assert(r == 0);
-	    bl.claim_append(t);
+	    rr.bl.claim_append(t);
 	  });
-	int r = _verify_csum(o, &bptr->blob, r_off, bl);
-	if (r < 0) {
-	  return -EIO;
-	}
+	rr.r_off = r_off;
+	rr.front = front;
+      }
+
+      // verify all of the blob's chunks in a single pass
+      vector<std::pair<size_t, const bufferlist*>> csum_extents;
+      csum_extents.reserve(reads.size());
+      for (auto& rr : reads) {
+	csum_extents.emplace_back(rr.r_off, &rr.bl);
+      }
+      int r = _verify_csum_extents(o, &bptr->blob, csum_extents);
+      if (r < 0) {
+	return -EIO;
+      }
+
+      for (auto& rr : reads) {
 	if (buffered) {
-	  bptr->bc.did_read(r_off, bl);
+	  bptr->bc.did_read(rr.r_off, rr.bl);
 	}
-
 	// prune and keep result
-	ready_regions[reg.logical_offset].substr_of(bl, front, reg.length);
+	ready_regions[rr.reg.logical_offset].substr_of(
+	  rr.bl, rr.front, rr.reg.length);
       }
     }
     ++b2r_it;
@@ -3770,6 +3834,35 @@ int BlueStore::_verify_csum(OnodeRef& o,
   }
 }
 
+int BlueStore::_verify_csum_extents(
+  OnodeRef& o,
+  const bluestore_blob_t* blob,
+  const vector<std::pair<size_t, const bufferlist*>>& extents) const
+{
+  int bad;
+  int r = blob->verify_csum_extents(extents, &bad);
+  if (r < 0) {
+    if (r == -1) {
+      vector<bluestore_pextent_t> pex;
+      blob->map(
+	bad,
+	blob->get_csum_chunk_size(),
+	[&](uint64_t offset, uint64_t length) {
+	  pex.emplace_back(bluestore_pextent_t(offset, length));
+	});
+      derr << __func__ << " bad " << blob->get_csum_type_string(blob->csum_type)
+	   << "/0x" << std::hex << blob->get_csum_chunk_size()
+	   << " checksum at blob offset 0x" << bad << std::dec
+	   << ", device location " << pex
+	   << ", object " << o->oid << dendl;
+    } else {
+      derr << __func__ << " failed with exit code: " << cpp_strerror(r) << dendl;
+    }
+    return r;
+  }
+  return 0;
+}
+
 int BlueStore::_decompress(bufferlist& source, bufferlist* result)
 {
   int r = 0;
@@ -3871,9 +3964,6 @@ int BlueStore::fiemap(
   }
 
  out:
-  c->cache->trim(
-    g_conf->bluestore_onode_cache_size,
-    g_conf->bluestore_buffer_cache_size);
   ::encode(m, bl);
   dout(20) << __func__ << " 0x" << std::hex << offset << "~" << length
 	   << " size = 0 (" << m << ")" << std::dec << dendl;
@@ -3919,9 +4009,6 @@ int BlueStore::getattr(
   value = o->onode.attrs[k];
   r = 0;
  out:
-  c->cache->trim(
-    g_conf->bluestore_onode_cache_size,
-    g_conf->bluestore_buffer_cache_size);
   dout(10) << __func__ << " " << c->cid << " " << oid << " " << name
 	   << " = " << r << dendl;
   return r;
@@ -3959,9 +4046,6 @@ int BlueStore::getattrs(
   aset = o->onode.attrs;
   r = 0;
  out:
-  c->cache->trim(
-    g_conf->bluestore_onode_cache_size,
-    g_conf->bluestore_buffer_cache_size);
   dout(10) << __func__ << " " << c->cid << " " << oid
 	   << " = " << r << dendl;
   return r;
@@ -4134,9 +4218,6 @@ int BlueStore::collection_list(
     *pnext = ghobject_t::get_max();
   }
  out:
-  c->cache->trim(
-    g_conf->bluestore_onode_cache_size,
-    g_conf->bluestore_buffer_cache_size);
   dout(10) << __func__ << " " << c->cid
 	   << " start " << start << " end " << end << " max " << max
 	   << " = " << r << ", ls.size() = " << ls->size()
@@ -4454,6 +4535,75 @@ int BlueStore::omap_get_values(
   return r;
 }
 
+int BlueStore::omap_get_range(
+  const coll_t& cid,           ///< [in] Collection containing oid
+  const ghobject_t &oid,       ///< [in] Object containing omap
+  const string &after,         ///< [in] return keys > this value
+  unsigned max_return,         ///< [in] return no more than this many
+  map<string, bufferlist> *out,///< [out] returned keys and values
+  bool *more                   ///< [out] true if more keys remain
+  )
+{
+  CollectionHandle c = _get_collection(cid);
+  if (!c)
+    return -ENOENT;
+  return omap_get_range(c, oid, after, max_return, out, more);
+}
+
+int BlueStore::omap_get_range(
+  CollectionHandle &c_,        ///< [in] Collection containing oid
+  const ghobject_t &oid,       ///< [in] Object containing omap
+  const string &after,         ///< [in] return keys > this value
+  unsigned max_return,         ///< [in] return no more than this many
+  map<string, bufferlist> *out,///< [out] returned keys and values
+  bool *more                   ///< [out] true if more keys remain
+  )
+{
+  Collection *c = static_cast<Collection*>(c_.get());
+  dout(15) << __func__ << " " << c->get_cid() << " oid " << oid
+	   << " after " << after << " max " << max_return << dendl;
+  if (!c->exists)
+    return -ENOENT;
+  RWLock::RLocker l(c->lock);
+  int r = 0;
+  if (more)
+    *more = false;
+  OnodeRef o = c->get_onode(oid, false);
+  if (!o || !o->exists) {
+    r = -ENOENT;
+    goto out;
+  }
+  if (!o->onode.omap_head)
+    goto out;
+  o->flush();
+  {
+    KeyValueDB::Iterator it = db->get_iterator(PREFIX_OMAP);
+    string key, tail;
+    get_omap_key(o->onode.omap_head, after, &key);
+    get_omap_tail(o->onode.omap_head, &tail);
+    it->upper_bound(key);
+    while (it->valid() && max_return > 0) {
+      if (it->key() >= tail) {
+	dout(30) << __func__ << "  reached tail" << dendl;
+	break;
+      }
+      string user_key;
+      decode_omap_key(it->key(), &user_key);
+      dout(30) << __func__ << "  got " << pretty_binary_string(it->key())
+	       << " -> " << user_key << dendl;
+      (*out)[user_key] = it->value();
+      --max_return;
+      it->next();
+    }
+    if (more)
+      *more = it->valid() && it->key() < tail;
+  }
+ out:
+  dout(10) << __func__ << " " << c->get_cid() << " oid " << oid << " = " << r
+	   << dendl;
+  return r;
+}
+
 int BlueStore::omap_check_keys(
   const coll_t& cid,                ///< [in] Collection containing oid
   const ghobject_t &oid,   ///< [in] Object containing omap
@@ -4548,11 +4698,15 @@ ObjectMap::ObjectMapIterator BlueStore::get_omap_iterator(
 
 int BlueStore::_open_super_meta()
 {
+  // fetch everything in one batch
+  std::vector<string> keys = {"nid_max", "freelist_type", "bluefs_extents"};
+  std::vector<bufferlist> values;
+  db->get(PREFIX_SUPER, keys, &values);
+
   // nid
   {
     nid_max = 0;
-    bufferlist bl;
-    db->get(PREFIX_SUPER, "nid_max", &bl);
+    bufferlist& bl = values[0];
     bufferlist::iterator p = bl.begin();
     try {
       ::decode(nid_max, p);
@@ -4564,8 +4718,7 @@ int BlueStore::_open_super_meta()
 
   // freelist
   {
-    bufferlist bl;
-    db->get(PREFIX_SUPER, "freelist_type", &bl);
+    bufferlist& bl = values[1];
     if (bl.length()) {
       freelist_type = std::string(bl.c_str(), bl.length());
       dout(10) << __func__ << " freelist_type " << freelist_type << dendl;
@@ -4579,8 +4732,7 @@ int BlueStore::_open_super_meta()
   // bluefs alloc
   {
     bluefs_extents.clear();
-    bufferlist bl;
-    db->get(PREFIX_SUPER, "bluefs_extents", &bl);
+    bufferlist& bl = values[2];
     bufferlist::iterator p = bl.begin();
     try {
       ::decode(bluefs_extents, p);
@@ -4876,7 +5028,6 @@ void BlueStore::_osr_reap_done(OpSequencer *osr)
 {
   std::lock_guard<std::mutex> l(osr->qlock);
   dout(20) << __func__ << " osr " << osr << dendl;
-  CollectionRef c;
   while (!osr->q.empty()) {
     TransContext *txc = &osr->q.front();
     dout(20) << __func__ << "  txc " << txc << " " << txc->get_state_name()
@@ -4885,10 +5036,6 @@ void BlueStore::_osr_reap_done(OpSequencer *osr)
       break;
     }
 
-    if (!c && txc->first_collection) {
-      c = txc->first_collection;
-    }
-
     osr->q.pop_front();
     txc->log_state_latency(logger, l_bluestore_state_done_lat);
     delete txc;
@@ -4896,11 +5043,6 @@ void BlueStore::_osr_reap_done(OpSequencer *osr)
     if (osr->q.empty())
       dout(20) << __func__ << " osr " << osr << " q now empty" << dendl;
   }
-  if (c) {
-    c->cache->trim(
-      g_conf->bluestore_onode_cache_size,
-      g_conf->bluestore_buffer_cache_size);
-  }
 }
 
 void BlueStore::_txc_finalize_kv(TransContext *txc, KeyValueDB::Transaction t)
@@ -4932,26 +5074,24 @@ void BlueStore::_txc_finalize_kv(TransContext *txc, KeyValueDB::Transaction t)
     preleased = &tmp_released;
   }
 
-  // update freelist with non-overlap sets
-  for (interval_set<uint64_t>::iterator p = pallocated->begin();
-       p != pallocated->end();
-       ++p) {
-    fm->allocate(p.get_start(), p.get_len(), t);
-  }
-  for (interval_set<uint64_t>::iterator p = preleased->begin();
-       p != preleased->end();
-       ++p) {
-    dout(20) << __func__ << " release 0x" << std::hex << p.get_start()
-	     << "~" << p.get_len() << std::dec << dendl;
-    fm->release(p.get_start(), p.get_len(), t);
-  }
+  // update freelist with non-overlap sets; apply() lets the
+  // implementation batch the per-key updates for the whole transaction
+  fm->apply(*pallocated, *preleased, t);
 
   // update allocator with full released set
   if (!g_conf->bluestore_debug_no_reuse_blocks) {
-    for (interval_set<uint64_t>::iterator p = txc->released.begin();
-	 p != txc->released.end();
-	 ++p) {
-      alloc->release(p.get_start(), p.get_len());
+    if (!txc->released.empty() &&
+	bdev->queue_discard(txc->released) == 0) {
+      // the extents go back to the allocator from handle_discard()
+      // once the device has zapped them
+      logger->inc(l_bluestore_discard_queued_bytes, txc->released.size());
+      logger->inc(l_bluestore_discard_backlog_bytes, txc->released.size());
+    } else {
+      for (interval_set<uint64_t>::iterator p = txc->released.begin();
+	   p != txc->released.end();
+	   ++p) {
+	alloc->release(p.get_start(), p.get_len());
+      }
     }
   }
 
@@ -5041,15 +5181,32 @@ void BlueStore::_kv_sync_thread()
       dout(20) << __func__ << " committed " << kv_committing.size()
 	       << " cleaned " << wal_cleaning.size()
 	       << " in " << dur << dendl;
-      while (!kv_committing.empty()) {
-	TransContext *txc = kv_committing.front();
-	_txc_state_proc(txc);
-	kv_committing.pop_front();
-      }
-      while (!wal_cleaning.empty()) {
-	TransContext *txc = wal_cleaning.front();
-	_txc_state_proc(txc);
-	wal_cleaning.pop_front();
+
+      // hand the committed txcs to the finalize thread; it advances
+      // their state machines (queueing wal replays across the wal_tp
+      // and completions to the finisher) while we start on the next
+      // commit batch.
+      {
+	std::unique_lock<std::mutex> m(kv_finalize_lock);
+	if (kv_committing_to_finalize.empty()) {
+	  kv_committing_to_finalize.swap(kv_committing);
+	} else {
+	  kv_committing_to_finalize.insert(
+	    kv_committing_to_finalize.end(),
+	    kv_committing.begin(),
+	    kv_committing.end());
+	  kv_committing.clear();
+	}
+	if (wal_cleaning_to_finalize.empty()) {
+	  wal_cleaning_to_finalize.swap(wal_cleaning);
+	} else {
+	  wal_cleaning_to_finalize.insert(
+	    wal_cleaning_to_finalize.end(),
+	    wal_cleaning.begin(),
+	    wal_cleaning.end());
+	  wal_cleaning.clear();
+	}
+	kv_finalize_cond.notify_one();
       }
 
       alloc->commit_finish();
@@ -5069,6 +5226,152 @@ void BlueStore::_kv_sync_thread()
   dout(10) << __func__ << " finish" << dendl;
 }
 
+void BlueStore::_kv_finalize_thread()
+{
+  dout(10) << __func__ << " start" << dendl;
+  deque<TransContext*> kv_committed;
+  deque<TransContext*> wal_cleaned;
+  std::unique_lock<std::mutex> l(kv_finalize_lock);
+  while (true) {
+    assert(kv_committed.empty());
+    assert(wal_cleaned.empty());
+    if (kv_committing_to_finalize.empty() &&
+	wal_cleaning_to_finalize.empty()) {
+      if (kv_finalize_stop)
+	break;
+      dout(20) << __func__ << " sleep" << dendl;
+      kv_finalize_cond.wait(l);
+      dout(20) << __func__ << " wake" << dendl;
+    } else {
+      kv_committed.swap(kv_committing_to_finalize);
+      wal_cleaned.swap(wal_cleaning_to_finalize);
+      l.unlock();
+      dout(20) << __func__ << " kv_committed " << kv_committed << dendl;
+      dout(20) << __func__ << " wal_cleaned " << wal_cleaned << dendl;
+
+      while (!kv_committed.empty()) {
+	TransContext *txc = kv_committed.front();
+	_txc_state_proc(txc);
+	kv_committed.pop_front();
+      }
+
+      while (!wal_cleaned.empty()) {
+	TransContext *txc = wal_cleaned.front();
+	_txc_state_proc(txc);
+	wal_cleaned.pop_front();
+      }
+
+      l.lock();
+    }
+  }
+  dout(10) << __func__ << " finish" << dendl;
+}
+
+void BlueStore::_cache_trim_thread()
+{
+  dout(10) << __func__ << " start" << dendl;
+  std::unique_lock<std::mutex> l(cache_trim_lock);
+  while (!cache_trim_stop) {
+    l.unlock();
+    uint64_t onodes = 0, buffer_bytes = 0;
+    uint64_t onode_hits = 0, onode_misses = 0;
+    uint64_t buffer_hit_bytes = 0, buffer_miss_bytes = 0;
+    for (auto i : cache_shards) {
+      onodes += i->get_num_onodes();
+      buffer_bytes += i->get_buffer_bytes();
+      onode_hits += i->onode_hits;
+      onode_misses += i->onode_misses;
+      buffer_hit_bytes += i->buffer_hit_bytes;
+      buffer_miss_bytes += i->buffer_miss_bytes;
+    }
+    if (logger) {
+      logger->set(l_bluestore_onodes, onodes);
+      logger->set(l_bluestore_buffer_bytes, buffer_bytes);
+      logger->set(l_bluestore_onode_hits, onode_hits);
+      logger->set(l_bluestore_onode_misses, onode_misses);
+      logger->set(l_bluestore_buffer_hit_bytes, buffer_hit_bytes);
+      logger->set(l_bluestore_buffer_miss_bytes, buffer_miss_bytes);
+    }
+    uint64_t onode_max = g_conf->bluestore_onode_cache_size;
+    uint64_t buffer_max = g_conf->bluestore_buffer_cache_size;
+    if (g_conf->bluestore_cache_autotune) {
+      _cache_autotune(onode_hits, onode_misses,
+		      buffer_hit_bytes, buffer_miss_bytes,
+		      &onode_max, &buffer_max);
+    }
+    // split the global quotas evenly across the shards; trimming here
+    // instead of inline in the read path keeps the shard locks cool for
+    // concurrent lookups.
+    size_t num = cache_shards.size();
+    for (auto i : cache_shards) {
+      i->trim(onode_max / num, buffer_max / num);
+    }
+    l.lock();
+    if (cache_trim_stop)
+      break;
+    cache_trim_cond.wait_for(
+      l, std::chrono::milliseconds(
+	(int64_t)(g_conf->bluestore_cache_trim_interval * 1000)));
+  }
+  dout(10) << __func__ << " finish" << dendl;
+}
+
+void BlueStore::_cache_autotune(uint64_t onode_hits, uint64_t onode_misses,
+				uint64_t buffer_hit_bytes,
+				uint64_t buffer_miss_bytes,
+				uint64_t *onode_max, uint64_t *buffer_max)
+{
+  if (autotune_onode_max == 0) {
+    // first pass: start from the configured split
+    autotune_onode_max = *onode_max;
+    autotune_buffer_max = *buffer_max;
+  }
+
+  // work on the deltas since the last pass so we react to the current
+  // workload, not the lifetime average
+  uint64_t oh = onode_hits - autotune_onode_hits;
+  uint64_t om = onode_misses - autotune_onode_misses;
+  uint64_t bh = buffer_hit_bytes - autotune_buffer_hit_bytes;
+  uint64_t bm = buffer_miss_bytes - autotune_buffer_miss_bytes;
+  autotune_onode_hits = onode_hits;
+  autotune_onode_misses = onode_misses;
+  autotune_buffer_hit_bytes = buffer_hit_bytes;
+  autotune_buffer_miss_bytes = buffer_miss_bytes;
+
+  if (oh + om == 0 || bh + bm == 0) {
+    // not enough traffic on one of the caches to compare miss rates
+    *onode_max = autotune_onode_max;
+    *buffer_max = autotune_buffer_max;
+    return;
+  }
+
+  double onode_miss_rate = (double)om / (double)(oh + om);
+  double buffer_miss_rate = (double)bm / (double)(bh + bm);
+  uint64_t chunk = g_conf->bluestore_cache_autotune_chunk;
+  uint64_t onode_cost = g_conf->bluestore_cache_autotune_onode_cost;
+
+  // never shrink either cache below a quarter of its configured size
+  uint64_t onode_floor = g_conf->bluestore_onode_cache_size / 4;
+  uint64_t buffer_floor = g_conf->bluestore_buffer_cache_size / 4;
+
+  if (onode_miss_rate > buffer_miss_rate &&
+      autotune_buffer_max >= buffer_floor + chunk) {
+    autotune_buffer_max -= chunk;
+    autotune_onode_max += chunk / onode_cost;
+  } else if (buffer_miss_rate > onode_miss_rate &&
+	     autotune_onode_max >= onode_floor + chunk / onode_cost) {
+    autotune_onode_max -= chunk / onode_cost;
+    autotune_buffer_max += chunk;
+  }
+
+  dout(20) << __func__ << " onode miss rate " << onode_miss_rate
+	   << " buffer miss rate " << buffer_miss_rate
+	   << " -> onode_max " << autotune_onode_max
+	   << " buffer_max " << autotune_buffer_max << dendl;
+  *onode_max = autotune_onode_max;
+  *buffer_max = autotune_buffer_max;
+}
+
 bluestore_wal_op_t *BlueStore::_get_wal_op(TransContext *txc, OnodeRef o)
 {
   if (!txc->wal_txn) {
@@ -5192,6 +5495,9 @@ int BlueStore::queue_transactions(
     TrackedOpRef op,
     ThreadPool::TPHandle *handle)
 {
+  if (tracing())
+    trace_transactions(posr, tls);
+
   Context *onreadable;
   Context *ondisk;
   Context *onreadable_sync;
@@ -5665,6 +5971,7 @@ void BlueStore::_dump_onode(OnodeRef o, int log_level)
 		    << " len " << p->second.length() << dendl;
   }
   uint64_t pos = 0;
+  o->onode.maybe_decode_extent_map();
   for (auto& p : o->onode.extent_map) {
     dout(log_level) << __func__ << "  lextent 0x" << std::hex << p.first
 		    << std::dec << ": " << p.second
@@ -6009,12 +6316,39 @@ void BlueStore::_do_write_big(
 
 int BlueStore::_do_alloc_write(
   TransContext *txc,
+  OnodeRef o,
   WriteContext *wctx)
 {
   dout(20) << __func__ << " txc " << txc
 	   << " " << wctx->writes.size() << " blobs"
 	   << dendl;
 
+  // skip compression entirely once enough consecutive blobs on this
+  // object have failed to meet the required ratio; an already-compressed
+  // rbd image would otherwise pay full compression cost on every write
+  bool try_compress = wctx->compress && compressor;
+  if (try_compress && o &&
+      o->compress_rejects >= g_conf->bluestore_compression_max_rejects) {
+    dout(20) << __func__ << " " << o->oid << " looks incompressible ("
+	     << o->compress_rejects << " rejects), not compressing" << dendl;
+    try_compress = false;
+  }
+
+  // hand candidate payloads to the compressor thread pool up front so
+  // compression of later blobs overlaps with allocation and checksums of
+  // earlier ones; we join per blob in the loop below, before queueing io
+  vector<uint64_t> comp_ids;
+  if (try_compress && async_compressor) {
+    comp_ids.resize(wctx->writes.size(), 0);
+    unsigned idx = 0;
+    for (auto& wi : wctx->writes) {
+      if (wi.blob_length > min_alloc_size) {
+	comp_ids[idx] = async_compressor->async_compress(wi.bl);
+      }
+      ++idx;
+    }
+  }
+
   uint64_t need = 0;
   for (auto &wi : wctx->writes) {
     need += wi.blob_length;
@@ -6027,6 +6361,7 @@ int BlueStore::_do_alloc_write(
   }
 
   uint64_t hint = 0;
+  unsigned wi_idx = 0;
   for (auto& wi : wctx->writes) {
     Blob *b = wi.b;
     uint64_t b_off = wi.b_off;
@@ -6037,7 +6372,8 @@ int BlueStore::_do_alloc_write(
     bufferlist compressed_bl;
     CompressorRef c;
     bool compressed = false;
-    if (wctx->compress &&
+    unsigned idx = wi_idx++;
+    if (try_compress &&
 	wi.blob_length > min_alloc_size &&
 	(c = compressor) != nullptr) {
       // compress
@@ -6047,7 +6383,19 @@ int BlueStore::_do_alloc_write(
       chdr.type = bluestore_blob_t::get_comp_alg_type(c->get_type());
       // FIXME: memory alignment here is bad
       bufferlist t;
-      c->compress(*l, t);
+      if (!comp_ids.empty() && comp_ids[idx]) {
+	bool finished = false;
+	int cr = async_compressor->get_compress_data(comp_ids[idx], t,
+						     true, &finished);
+	if (cr < 0 || !finished) {
+	  dout(10) << __func__ << " async compress failed with "
+		   << cpp_strerror(cr) << ", compressing inline" << dendl;
+	  t.clear();
+	  c->compress(*l, t);
+	}
+      } else {
+	c->compress(*l, t);
+      }
       chdr.length = t.length();
       ::encode(chdr, compressed_bl);
       compressed_bl.claim_append(t);
@@ -6074,12 +6422,18 @@ int BlueStore::_do_alloc_write(
 	csum_order = ctz(newlen);
 	b->blob.set_compressed(wi.blob_length, rawlen);
 	compressed = true;
+	if (o) {
+	  o->compress_rejects = 0;
+	}
       } else {
 	dout(20) << __func__ << hex << "  compressed 0x" << l->length()
                  << " -> 0x" << rawlen << " with " << chdr.type
                  << ", which is more than required 0x" << dstlen
                  << ", leaving uncompressed"
                  << dec << dendl;
+	if (o) {
+	  ++o->compress_rejects;
+	}
       }
     }
     if (!compressed) {
@@ -6291,7 +6645,7 @@ int BlueStore::_do_write(
     }
   }
 
-  r = _do_alloc_write(txc, &wctx);
+  r = _do_alloc_write(txc, o, &wctx);
   if (r < 0) {
     derr << __func__ << " _do_alloc_write failed with " << cpp_strerror(r)
 	 << dendl;
@@ -6723,6 +7077,9 @@ int BlueStore::_clone(TransContext *txc,
   if (r < 0)
     goto out;
 
+  oldo->onode.maybe_decode_extent_map();
+  newo->onode.maybe_decode_extent_map();
+
   if (g_conf->bluestore_clone_cow) {
     if (!oldo->onode.extent_map.empty()) {
       if (!oldo->bnode) {
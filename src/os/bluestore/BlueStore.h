@@ -39,6 +39,7 @@
 #include "bluestore_types.h"
 #include "BlockDevice.h"
 class Allocator;
+class AsyncCompressor;
 class FreelistManager;
 class BlueFS;
 
@@ -62,6 +63,14 @@ enum {
   l_bluestore_wal_write_ops,
   l_bluestore_wal_write_bytes,
   l_bluestore_write_penalty_read_ops,
+  l_bluestore_onodes,
+  l_bluestore_onode_hits,
+  l_bluestore_onode_misses,
+  l_bluestore_buffer_bytes,
+  l_bluestore_buffer_hit_bytes,
+  l_bluestore_buffer_miss_bytes,
+  l_bluestore_discard_queued_bytes,
+  l_bluestore_discard_backlog_bytes,
   l_bluestore_last
 };
 
@@ -478,12 +487,17 @@ public:
 
     OnodeSpace *space;    ///< containing OnodeSpace
     boost::intrusive::list_member_hook<> lru_item;
+    uint16_t cache_private = 0; ///< opaque (to us) value used by Cache impl
 
     BnodeRef bnode;  ///< ref to Bnode [optional]
 
     bluestore_onode_t onode;  ///< metadata stored as value in kv store
     bool exists;
 
+    /// consecutive blobs whose compressed form was rejected as too large;
+    /// in-memory only, used to bypass compression on incompressible objects
+    uint16_t compress_rejects = 0;
+
     BlobMap blob_map;       ///< local blobs (this onode onode)
 
     std::mutex flush_lock;  ///< protect flush_txns
@@ -521,6 +535,11 @@ public:
   struct Cache {
     std::mutex lock;                ///< protect lru and other structures
 
+    std::atomic<uint64_t> onode_hits = {0};
+    std::atomic<uint64_t> onode_misses = {0};
+    std::atomic<uint64_t> buffer_hit_bytes = {0};
+    std::atomic<uint64_t> buffer_miss_bytes = {0};
+
     static Cache *create(string type);
 
     virtual ~Cache() {}
@@ -536,6 +555,18 @@ public:
 
     virtual void trim(uint64_t onode_max, uint64_t buffer_max) = 0;
 
+    virtual uint64_t _get_num_onodes() = 0;
+    virtual uint64_t _get_buffer_bytes() = 0;
+
+    uint64_t get_num_onodes() {
+      std::lock_guard<std::mutex> l(lock);
+      return _get_num_onodes();
+    }
+    uint64_t get_buffer_bytes() {
+      std::lock_guard<std::mutex> l(lock);
+      return _get_buffer_bytes();
+    }
+
 #ifdef DEBUG_CACHE
     virtual void _audit(const char *s) = 0;
 #else
@@ -607,15 +638,21 @@ public:
 
     void trim(uint64_t onode_max, uint64_t buffer_max) override;
 
+    uint64_t _get_num_onodes() override {
+      return onode_lru.size();
+    }
+    uint64_t _get_buffer_bytes() override {
+      return buffer_size;
+    }
+
 #ifdef DEBUG_CACHE
     void _audit(const char *s) override;
 #endif
   };
 
-  // 2Q cache for buffers, LRU for onodes
+  // 2Q cache for buffers and onodes
   struct TwoQCache : public Cache {
   private:
-    // stick with LRU for onodes for now (fixme?)
     typedef boost::intrusive::list<
       Onode,
       boost::intrusive::member_hook<
@@ -629,7 +666,8 @@ public:
 	boost::intrusive::list_member_hook<>,
 	&Buffer::lru_item> > buffer_list_t;
 
-    onode_lru_list_t onode_lru;
+    onode_lru_list_t onode_hot;    //< onodes touched more than once
+    onode_lru_list_t onode_warm;   //< newly admitted onodes
 
     buffer_list_t buffer_hot;      //< "Am" hot buffers
     buffer_list_t buffer_warm_in;  //< "A1in" newly warm buffers
@@ -644,18 +682,27 @@ public:
       BUFFER_TYPE_MAX
     };
 
+    enum {
+      ONODE_WARM = 0,   ///< in onode_warm
+      ONODE_HOT,        ///< in onode_hot
+    };
+
     uint64_t buffer_list_bytes[BUFFER_TYPE_MAX] = {0}; ///< bytes per type
 
   public:
     void _add_onode(OnodeRef& o, int level) override {
+      o->cache_private = ONODE_WARM;
       if (level > 0)
-	onode_lru.push_front(*o);
+	onode_warm.push_front(*o);
       else
-	onode_lru.push_back(*o);
+	onode_warm.push_back(*o);
     }
     void _rm_onode(OnodeRef& o) override {
-      auto q = onode_lru.iterator_to(*o);
-      onode_lru.erase(q);
+      if (o->cache_private == ONODE_HOT) {
+	onode_hot.erase(onode_hot.iterator_to(*o));
+      } else {
+	onode_warm.erase(onode_warm.iterator_to(*o));
+      }
     }
     void _touch_onode(OnodeRef& o) override;
 
@@ -682,6 +729,13 @@ public:
 
     void trim(uint64_t onode_max, uint64_t buffer_max) override;
 
+    uint64_t _get_num_onodes() override {
+      return onode_warm.size() + onode_hot.size();
+    }
+    uint64_t _get_buffer_bytes() override {
+      return buffer_bytes;
+    }
+
 #ifdef DEBUG_CACHE
     void _audit(const char *s) override;
 #endif
@@ -1104,6 +1158,24 @@ public:
     }
   };
 
+  struct KVFinalizeThread : public Thread {
+    BlueStore *store;
+    explicit KVFinalizeThread(BlueStore *s) : store(s) {}
+    void *entry() {
+      store->_kv_finalize_thread();
+      return NULL;
+    }
+  };
+
+  struct CacheTrimThread : public Thread {
+    BlueStore *store;
+    explicit CacheTrimThread(BlueStore *s) : store(s) {}
+    void *entry() {
+      store->_cache_trim_thread();
+      return NULL;
+    }
+  };
+
   // --------------------------------------------------------
   // members
 private:
@@ -1145,9 +1217,28 @@ private:
   std::mutex kv_lock;
   std::condition_variable kv_cond, kv_sync_cond;
   bool kv_stop;
+
   deque<TransContext*> kv_queue, kv_committing;
   deque<TransContext*> wal_cleanup_queue, wal_cleaning;
 
+  KVFinalizeThread kv_finalize_thread;
+  std::mutex kv_finalize_lock;
+  std::condition_variable kv_finalize_cond;
+  bool kv_finalize_stop;
+  deque<TransContext*> kv_committing_to_finalize;
+  deque<TransContext*> wal_cleaning_to_finalize;
+
+  CacheTrimThread cache_trim_thread;
+  std::mutex cache_trim_lock;
+  std::condition_variable cache_trim_cond;
+  bool cache_trim_stop;
+
+  // cache auto-sizing state, touched only by the trim thread
+  uint64_t autotune_onode_max = 0;   ///< current onode cache quota
+  uint64_t autotune_buffer_max = 0;  ///< current buffer cache quota
+  uint64_t autotune_onode_hits = 0, autotune_onode_misses = 0;
+  uint64_t autotune_buffer_hit_bytes = 0, autotune_buffer_miss_bytes = 0;
+
   PerfCounters *logger;
 
   std::mutex reap_lock;
@@ -1184,6 +1275,7 @@ private:
   }
   CompressionMode comp_mode = COMP_NONE;      ///< compression mode
   CompressorRef compressor;
+  AsyncCompressor *async_compressor = nullptr; ///< optional compression tp
   uint64_t comp_min_blob_size = 0;
   uint64_t comp_max_blob_size = 0;
 
@@ -1249,6 +1341,7 @@ public:
   void _txc_aio_finish(void *p) {
     _txc_state_proc(static_cast<TransContext*>(p));
   }
+  void handle_discard(interval_set<uint64_t>& released);
 private:
   void _txc_finish_io(TransContext *txc);
   void _txc_finish_kv(TransContext *txc);
@@ -1265,7 +1358,29 @@ private:
     }
     kv_sync_thread.join();
     kv_stop = false;
+    {
+      std::lock_guard<std::mutex> l(kv_finalize_lock);
+      kv_finalize_stop = true;
+      kv_finalize_cond.notify_all();
+    }
+    kv_finalize_thread.join();
+    kv_finalize_stop = false;
   }
+  void _kv_finalize_thread();
+
+  void _cache_trim_thread();
+  void _cache_trim_stop() {
+    {
+      std::lock_guard<std::mutex> l(cache_trim_lock);
+      cache_trim_stop = true;
+      cache_trim_cond.notify_all();
+    }
+    cache_trim_thread.join();
+    cache_trim_stop = false;
+  }
+  void _cache_autotune(uint64_t onode_hits, uint64_t onode_misses,
+		       uint64_t buffer_hit_bytes, uint64_t buffer_miss_bytes,
+		       uint64_t *onode_max, uint64_t *buffer_max);
 
   bluestore_wal_op_t *_get_wal_op(TransContext *txc, OnodeRef o);
   int _wal_apply(TransContext *txc);
@@ -1439,6 +1554,24 @@ public:
     map<string, bufferlist> *out ///< [out] Returned keys and values
     ) override;
 
+  /// Bulk-fetch a range of omap keys and values
+  int omap_get_range(
+    const coll_t& cid,           ///< [in] Collection containing oid
+    const ghobject_t &oid,       ///< [in] Object containing omap
+    const string &after,         ///< [in] return keys > this value
+    unsigned max_return,         ///< [in] return no more than this many
+    map<string, bufferlist> *out,///< [out] returned keys and values
+    bool *more                   ///< [out] true if more keys remain
+    ) override;
+  int omap_get_range(
+    CollectionHandle &c,         ///< [in] Collection containing oid
+    const ghobject_t &oid,       ///< [in] Object containing omap
+    const string &after,         ///< [in] return keys > this value
+    unsigned max_return,         ///< [in] return no more than this many
+    map<string, bufferlist> *out,///< [out] returned keys and values
+    bool *more                   ///< [out] true if more keys remain
+    ) override;
+
   /// Filters keys into out which are defined on oid
   int omap_check_keys(
     const coll_t& cid,                ///< [in] Collection containing oid
@@ -1491,6 +1624,10 @@ private:
 		   const bluestore_blob_t* blob,
 		   uint64_t blob_xoffset,
 		   const bufferlist& bl) const;
+  int _verify_csum_extents(
+    OnodeRef& o,
+    const bluestore_blob_t* blob,
+    const vector<std::pair<size_t, const bufferlist*>>& extents) const;
   int _decompress(bufferlist& source, bufferlist* result);
 
 
@@ -1539,6 +1676,7 @@ private:
     WriteContext *wctx);
   int _do_alloc_write(
     TransContext *txc,
+    OnodeRef o,
     WriteContext *wctx);
   void _wctx_finish(
     TransContext *txc,
@@ -8,6 +8,7 @@
 #include <map>
 #include <mutex>
 #include <ostream>
+#include "include/interval_set.h"
 #include "kv/KeyValueDB.h"
 
 class FreelistManager {
@@ -41,6 +42,20 @@ public:
   virtual void release(
     uint64_t offset, uint64_t length,
     KeyValueDB::Transaction txn) = 0;
+
+  /// apply all state changes for one transaction; implementations may
+  /// batch the updates more efficiently than per-range allocate/release
+  virtual void apply(
+    const interval_set<uint64_t>& allocated,
+    const interval_set<uint64_t>& released,
+    KeyValueDB::Transaction txn) {
+    for (auto p = allocated.begin(); p != allocated.end(); ++p) {
+      allocate(p.get_start(), p.get_len(), txn);
+    }
+    for (auto p = released.begin(); p != released.end(); ++p) {
+      release(p.get_start(), p.get_len(), txn);
+    }
+  }
 };
 
 
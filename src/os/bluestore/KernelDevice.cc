@@ -42,7 +42,14 @@ KernelDevice::KernelDevice(aio_callback_t cb, void *cbpriv)
     aio_callback(cb),
     aio_callback_priv(cbpriv),
     aio_stop(false),
+    support_discard(false),
+    discard_lock("KernelDevice::discard_lock"),
+    discard_stop(false),
+    discard_running(false),
+    discard_callback(NULL),
+    discard_callback_priv(NULL),
     aio_thread(this),
+    discard_thread(this),
     injecting_crash(0)
 {
   zeros = buffer::create_page_aligned(1048576);
@@ -119,6 +126,8 @@ int KernelDevice::open(string p)
     }
 
     rotational = block_device_is_rotational(path.c_str());
+    if (g_conf->bdev_enable_discard)
+      support_discard = block_device_support_discard(path.c_str());
     size = s;
   } else {
     size = st.st_size;
@@ -142,6 +151,10 @@ int KernelDevice::open(string p)
 
   r = _aio_start();
   assert(r == 0);
+  if (support_discard) {
+    r = _discard_start();
+    assert(r == 0);
+  }
 
   dout(1) << __func__
 	  << " size " << size
@@ -150,6 +163,7 @@ int KernelDevice::open(string p)
 	  << " block_size " << block_size
 	  << " (" << pretty_si_t(block_size) << "B)"
 	  << " " << (rotational ? "rotational" : "non-rotational")
+	  << " " << (support_discard ? "discard" : "no-discard")
 	  << dendl;
   return 0;
 
@@ -165,6 +179,8 @@ int KernelDevice::open(string p)
 void KernelDevice::close()
 {
   dout(1) << __func__ << dendl;
+  if (support_discard)
+    _discard_stop();
   _aio_stop();
 
   assert(fs);
@@ -238,16 +254,121 @@ void KernelDevice::_aio_stop()
   }
 }
 
+int KernelDevice::_discard_start()
+{
+  dout(10) << __func__ << dendl;
+  discard_thread.create("bstore_discard");
+  return 0;
+}
+
+void KernelDevice::_discard_stop()
+{
+  dout(10) << __func__ << dendl;
+  {
+    Mutex::Locker l(discard_lock);
+    discard_stop = true;
+    discard_cond.Signal();
+  }
+  discard_thread.join();
+  discard_stop = false;
+}
+
+void KernelDevice::discard_drain()
+{
+  dout(10) << __func__ << dendl;
+  Mutex::Locker l(discard_lock);
+  while (!discard_queued.empty() || discard_running)
+    discard_cond.Wait(discard_lock);
+}
+
+int KernelDevice::_discard(uint64_t offset, uint64_t len)
+{
+  dout(10) << __func__ << " 0x" << std::hex << offset << "~" << len
+	   << std::dec << dendl;
+  int r = block_device_discard(fd_direct, offset, len);
+  if (r < 0) {
+    r = -errno;
+    derr << __func__ << " 0x" << std::hex << offset << "~" << len << std::dec
+	 << " failed: " << cpp_strerror(r) << dendl;
+  }
+  return r;
+}
+
+void KernelDevice::_discard_thread()
+{
+  uint64_t max_bytes = g_conf->bdev_discard_max_bytes;
+  utime_t sleep_interval;
+  sleep_interval.set_from_double(g_conf->bdev_discard_sleep);
+
+  Mutex::Locker l(discard_lock);
+  dout(10) << __func__ << " start" << dendl;
+  while (true) {
+    if (discard_queued.empty()) {
+      if (discard_stop)
+	break;
+      discard_cond.Wait(discard_lock);
+      continue;
+    }
+
+    // take the whole backlog; interval_set has already coalesced
+    // adjacent extents for us
+    interval_set<uint64_t> finishing;
+    finishing.swap(discard_queued);
+    discard_running = true;
+    discard_lock.Unlock();
+
+    dout(20) << __func__ << " discarding 0x" << std::hex << finishing
+	     << std::dec << dendl;
+    for (interval_set<uint64_t>::iterator p = finishing.begin();
+	 p != finishing.end();
+	 ++p) {
+      // split big extents and optionally sleep between the pieces so a
+      // large backlog can't monopolize the device
+      uint64_t off = p.get_start();
+      uint64_t left = p.get_len();
+      while (left > 0) {
+	uint64_t l = max_bytes ? MIN(left, max_bytes) : left;
+	_discard(off, l);
+	off += l;
+	left -= l;
+	if (left > 0 && !sleep_interval.is_zero())
+	  sleep_interval.sleep();
+      }
+      if (!sleep_interval.is_zero())
+	sleep_interval.sleep();
+    }
+    if (discard_callback)
+      discard_callback(discard_callback_priv, finishing);
+
+    discard_lock.Lock();
+    discard_running = false;
+    discard_cond.Signal();  // wake any drainers
+  }
+  dout(10) << __func__ << " finish" << dendl;
+}
+
+int KernelDevice::queue_discard(interval_set<uint64_t>& to_release)
+{
+  if (!support_discard || !discard_callback)
+    return -EOPNOTSUPP;
+  if (to_release.empty())
+    return 0;
+  Mutex::Locker l(discard_lock);
+  discard_queued.insert(to_release);
+  discard_cond.Signal();
+  return 0;
+}
+
 void KernelDevice::_aio_thread()
 {
   dout(10) << __func__ << " start" << dendl;
   int inject_crash_count = 0;
+  int poll_ms = g_conf->bdev_aio_poll_ms;
   while (!aio_stop) {
     dout(40) << __func__ << " polling" << dendl;
     int max = 16;
     FS::aio_t *aio[max];
-    int r = aio_queue.get_next_completed(g_conf->bdev_aio_poll_ms,
-					 aio, max);
+    int r = aio_queue.get_next_completed(poll_ms, aio, max);
     if (r < 0) {
       derr << __func__ << " got " << cpp_strerror(r) << dendl;
     }
@@ -272,6 +393,10 @@ void KernelDevice::_aio_thread()
 	}
       }
     }
+    // while completions are arriving, poll again without blocking; only
+    // fall back to the blocking io_getevents timeout once a pass comes
+    // up empty.
+    poll_ms = r > 0 ? 0 : g_conf->bdev_aio_poll_ms;
     reap_ioc();
     if (g_conf->bdev_inject_crash) {
       ++inject_crash_count;
@@ -338,34 +463,28 @@ void KernelDevice::aio_submit(IOContext *ioc)
   ioc->num_pending -= pending;
   assert(ioc->num_pending.load() == 0);  // we should be only thread doing this
 
-  bool done = false;
-  while (!done) {
-    FS::aio_t& aio = *p;
+  for (list<FS::aio_t>::iterator q = p; q != e; ++q) {
+    FS::aio_t& aio = *q;
     aio.priv = static_cast<void*>(ioc);
     dout(20) << __func__ << "  aio " << &aio << " fd " << aio.fd
 	     << " 0x" << std::hex << aio.offset << "~" << aio.length
 	     << std::dec << dendl;
-    for (vector<iovec>::iterator q = aio.iov.begin(); q != aio.iov.end(); ++q)
-      dout(30) << __func__ << "   iov " << (void*)q->iov_base
-	       << " len " << q->iov_len << dendl;
-
-    // be careful: as soon as we submit aio we race with completion.
-    // since we are holding a ref take care not to dereference txc at
-    // all after that point.
-    list<FS::aio_t>::iterator cur = p;
-    ++p;
-    done = (p == e);
-
-    // do not dereference txc (or it's contents) after we submit (if
-    // done == true and we don't loop)
-    int retries = 0;
-    int r = aio_queue.submit(*cur, &retries);
-    if (retries)
-      derr << __func__ << " retries " << retries << dendl;
-    if (r) {
-      derr << " aio submit got " << cpp_strerror(r) << dendl;
-      assert(r == 0);
-    }
+    for (vector<iovec>::iterator v = aio.iov.begin(); v != aio.iov.end(); ++v)
+      dout(30) << __func__ << "   iov " << (void*)v->iov_base
+	       << " len " << v->iov_len << dendl;
+  }
+
+  // be careful: as soon as we submit aio we race with completion.
+  // since we are holding a ref take care not to dereference txc at
+  // all after that point.  submitting the whole batch with a single
+  // io_submit(2) amortizes the syscall cost across the queued ios.
+  int retries = 0;
+  int r = aio_queue.submit_batch(p, e, pending, &retries);
+  if (retries)
+    derr << __func__ << " retries " << retries << dendl;
+  if (r < 0) {
+    derr << " aio submit got " << cpp_strerror(r) << dendl;
+    assert(r >= 0);
   }
 }
 
@@ -19,6 +19,7 @@
 
 #include "os/fs/FS.h"
 #include "include/interval_set.h"
+#include "common/Cond.h"
 
 #include "BlockDevice.h"
 
@@ -42,6 +43,15 @@ class KernelDevice : public BlockDevice {
   void *aio_callback_priv;
   bool aio_stop;
 
+  bool support_discard;
+  Mutex discard_lock;
+  Cond discard_cond;
+  bool discard_stop;
+  bool discard_running;                   ///< thread is issuing discards
+  interval_set<uint64_t> discard_queued;  ///< backlog of extents to discard
+  discard_callback_t discard_callback;
+  void *discard_callback_priv;
+
   struct AioCompletionThread : public Thread {
     KernelDevice *bdev;
     explicit AioCompletionThread(KernelDevice *b) : bdev(b) {}
@@ -51,12 +61,26 @@ class KernelDevice : public BlockDevice {
     }
   } aio_thread;
 
+  struct DiscardThread : public Thread {
+    KernelDevice *bdev;
+    explicit DiscardThread(KernelDevice *b) : bdev(b) {}
+    void *entry() {
+      bdev->_discard_thread();
+      return NULL;
+    }
+  } discard_thread;
+
   std::atomic_int injecting_crash;
 
   void _aio_thread();
   int _aio_start();
   void _aio_stop();
 
+  void _discard_thread();
+  int _discard_start();
+  void _discard_stop();
+  int _discard(uint64_t offset, uint64_t len);
+
   void _aio_log_start(IOContext *ioc, uint64_t offset, uint64_t length);
   void _aio_log_finish(IOContext *ioc, uint64_t offset, uint64_t length);
 
@@ -86,6 +110,13 @@ public:
 		bool buffered) override;
   int flush() override;
 
+  void set_discard_callback(discard_callback_t cb, void *cbpriv) override {
+    discard_callback = cb;
+    discard_callback_priv = cbpriv;
+  }
+  int queue_discard(interval_set<uint64_t>& to_release) override;
+  void discard_drain() override;
+
   // for managing buffered readers/writers
   int invalidate_cache(uint64_t off, uint64_t len) override;
   int open(string path) override;
@@ -386,8 +386,9 @@ void SharedDriverData::_aio_thread()
   }
 
   Task *t = nullptr;
+  std::queue<Task*> local_queue;
   int r = 0;
-  const int max = 4;
+  const int max = g_conf->bdev_nvme_poll_max_completions;
   uint64_t lba_off, lba_count;
   ceph::coarse_real_clock::time_point cur, start = ceph::coarse_real_clock::now(g_ceph_context);
   while (true) {
@@ -472,12 +473,19 @@ void SharedDriverData::_aio_thread()
       }
     }
 
-    if (!queue_empty.load()) {
+    if (!local_queue.empty()) {
+      t = local_queue.front();
+      local_queue.pop();
+    } else if (!queue_empty.load()) {
       Mutex::Locker l(queue_lock);
       if (!task_queue.empty()) {
-        t = task_queue.front();
-        task_queue.pop();
-        logger->set(l_bluestore_nvmedevice_queue_ops, task_queue.size());
+        // drain the whole submit queue under one lock acquisition rather
+        // than paying a lock round-trip per task; submitters only take the
+        // lock to push, so contention stays off the fast path
+        task_queue.swap(local_queue);
+        t = local_queue.front();
+        local_queue.pop();
+        logger->set(l_bluestore_nvmedevice_queue_ops, local_queue.size());
       }
       if (!t)
         queue_empty = true;
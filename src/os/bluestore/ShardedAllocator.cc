@@ -0,0 +1,190 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "ShardedAllocator.h"
+#include "bluestore_types.h"
+#include "include/intarith.h"
+#include "common/debug.h"
+
+#define dout_subsys ceph_subsys_bluestore
+#undef dout_prefix
+#define dout_prefix *_dout << "shardedalloc "
+
+ShardedAllocator::ShardedAllocator(int64_t size, int64_t block_size)
+  : device_size(size)
+{
+  unsigned num = MAX(1, g_conf->bluestore_sharded_alloc_regions);
+  // do not shard so finely that a region cannot hold a reasonable
+  // number of allocation units
+  while (num > 1 && size / num < block_size * 1024)
+    num /= 2;
+  region_size = P2ROUNDUP(size / num, (uint64_t)block_size);
+  if (region_size == 0)
+    region_size = block_size;
+  for (unsigned i = 0; i < num; ++i)
+    shards.push_back(new StupidAllocator);
+  dout(10) << __func__ << " size " << size << " regions " << num
+	   << " region_size " << region_size << dendl;
+}
+
+ShardedAllocator::~ShardedAllocator()
+{
+  for (auto a : shards)
+    delete a;
+}
+
+int ShardedAllocator::reserve(uint64_t need)
+{
+  dout(10) << __func__ << " need " << need
+	   << " num_reserved " << num_reserved.load() << dendl;
+  if ((int64_t)need > (int64_t)get_free() - num_reserved.load())
+    return -ENOSPC;
+  num_reserved += need;
+  return 0;
+}
+
+void ShardedAllocator::unreserve(uint64_t unused)
+{
+  dout(10) << __func__ << " unused " << unused
+	   << " num_reserved " << num_reserved.load() << dendl;
+  num_reserved -= unused;
+  assert(num_reserved.load() >= 0);
+}
+
+int ShardedAllocator::allocate(
+  uint64_t want_size, uint64_t alloc_unit, int64_t hint,
+  uint64_t *offset, uint32_t *length)
+{
+  dout(10) << __func__ << " want_size " << want_size
+	   << " alloc_unit " << alloc_unit
+	   << " hint " << hint
+	   << dendl;
+  uint64_t want = MAX(alloc_unit, want_size);
+  unsigned start;
+  if (hint)
+    start = _shard_of(hint);
+  else
+    start = cursor++ % shards.size();
+
+  // stay in the hinted region if it can satisfy us; otherwise walk the
+  // other regions rather than failing the allocation.
+  for (unsigned i = 0; i < shards.size(); ++i) {
+    unsigned s = (start + i) % shards.size();
+    StupidAllocator *a = shards[s];
+    if (a->reserve(want) < 0)
+      continue;
+    int64_t h = (hint && _shard_of(hint) == s) ? hint : 0;
+    int r = a->allocate(want_size, alloc_unit, h, offset, length);
+    if (r < 0) {
+      a->unreserve(want);
+      continue;
+    }
+    if (*length < want)
+      a->unreserve(want - *length);
+    num_reserved -= *length;
+    assert(num_reserved.load() >= 0);
+    dout(30) << __func__ << " got " << *offset << "~" << *length
+	     << " from region " << s << dendl;
+    return 0;
+  }
+  return -ENOSPC;
+}
+
+int ShardedAllocator::alloc_extents(
+  uint64_t want_size, uint64_t alloc_unit, uint64_t max_alloc_size,
+  int64_t hint, std::vector<AllocExtent> *extents, int *count)
+{
+  uint64_t allocated_size = 0;
+  uint64_t offset = 0;
+  uint32_t length = 0;
+  int res = 0;
+
+  if (max_alloc_size == 0) {
+    max_alloc_size = want_size;
+  }
+
+  ExtentList block_list = ExtentList(extents, 1, max_alloc_size);
+
+  while (allocated_size < want_size) {
+    res = allocate(MIN(max_alloc_size, (want_size - allocated_size)),
+       alloc_unit, hint, &offset, &length);
+    if (res != 0) {
+      break;
+    }
+    block_list.add_extents(offset, length);
+    allocated_size += length;
+    hint = offset + length;
+  }
+
+  *count = block_list.get_extent_count();
+  if (want_size - allocated_size > 0) {
+    release_extents(extents, *count);
+    return -ENOSPC;
+  }
+
+  return 0;
+}
+
+int ShardedAllocator::release(
+  uint64_t offset, uint64_t length)
+{
+  dout(10) << __func__ << " " << offset << "~" << length << dendl;
+  _for_each_region(offset, length,
+		   [](StupidAllocator *a, uint64_t off, uint64_t len) {
+		     a->release(off, len);
+		   });
+  return 0;
+}
+
+uint64_t ShardedAllocator::get_free()
+{
+  uint64_t total = 0;
+  for (auto a : shards)
+    total += a->get_free();
+  return total;
+}
+
+void ShardedAllocator::dump(ostream& out)
+{
+  for (unsigned s = 0; s < shards.size(); ++s) {
+    dout(30) << __func__ << " region " << s << dendl;
+    shards[s]->dump(out);
+  }
+}
+
+void ShardedAllocator::init_add_free(uint64_t offset, uint64_t length)
+{
+  dout(10) << __func__ << " " << offset << "~" << length << dendl;
+  _for_each_region(offset, length,
+		   [](StupidAllocator *a, uint64_t off, uint64_t len) {
+		     a->init_add_free(off, len);
+		   });
+}
+
+void ShardedAllocator::init_rm_free(uint64_t offset, uint64_t length)
+{
+  dout(10) << __func__ << " " << offset << "~" << length << dendl;
+  _for_each_region(offset, length,
+		   [](StupidAllocator *a, uint64_t off, uint64_t len) {
+		     a->init_rm_free(off, len);
+		   });
+}
+
+void ShardedAllocator::commit_start()
+{
+  for (auto a : shards)
+    a->commit_start();
+}
+
+void ShardedAllocator::commit_finish()
+{
+  for (auto a : shards)
+    a->commit_finish();
+}
+
+void ShardedAllocator::shutdown()
+{
+  dout(1) << __func__ << dendl;
+  for (auto a : shards)
+    a->shutdown();
+}
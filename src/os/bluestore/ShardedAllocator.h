@@ -0,0 +1,79 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_OS_BLUESTORE_SHARDEDALLOCATOR_H
+#define CEPH_OS_BLUESTORE_SHARDEDALLOCATOR_H
+
+#include <atomic>
+#include <vector>
+
+#include "Allocator.h"
+#include "StupidAllocator.h"
+#include "os/bluestore/bluestore_types.h"
+
+/// Allocator that shards the device into fixed regions, each backed by
+/// its own StupidAllocator (and thus its own lock and extent trees), so
+/// concurrent TransContexts allocating in different regions do not
+/// serialize on a single mutex.  Hints keep callers sticky to a region;
+/// hintless allocations are spread round-robin.
+class ShardedAllocator : public Allocator {
+  int64_t device_size;
+  uint64_t region_size;
+  std::vector<StupidAllocator*> shards;
+
+  std::atomic<int64_t> num_reserved = {0};
+  std::atomic<uint64_t> cursor = {0};      ///< round-robin start shard
+
+  unsigned _shard_of(uint64_t offset) {
+    unsigned s = offset / region_size;
+    if (s >= shards.size())
+      s = shards.size() - 1;
+    return s;
+  }
+  /// split [offset,length) on region boundaries and apply f per shard
+  template<typename F>
+  void _for_each_region(uint64_t offset, uint64_t length, F f) {
+    while (length > 0) {
+      unsigned s = _shard_of(offset);
+      uint64_t end = (uint64_t)(s + 1) * region_size;
+      uint64_t l = length;
+      if (s < shards.size() - 1 && offset + l > end)
+	l = end - offset;
+      f(shards[s], offset, l);
+      offset += l;
+      length -= l;
+    }
+  }
+
+public:
+  ShardedAllocator(int64_t size, int64_t block_size);
+  ~ShardedAllocator();
+
+  int reserve(uint64_t need);
+  void unreserve(uint64_t unused);
+
+  int allocate(
+    uint64_t want_size, uint64_t alloc_unit, int64_t hint,
+    uint64_t *offset, uint32_t *length);
+
+  int alloc_extents(
+    uint64_t want_size, uint64_t alloc_unit, uint64_t max_alloc_size,
+    int64_t hint, std::vector<AllocExtent> *extents, int *count);
+
+  int release(
+    uint64_t offset, uint64_t length);
+
+  void commit_start();
+  void commit_finish();
+
+  uint64_t get_free();
+
+  void dump(std::ostream& out);
+
+  void init_add_free(uint64_t offset, uint64_t length);
+  void init_rm_free(uint64_t offset, uint64_t length);
+
+  void shutdown();
+};
+
+#endif
@@ -788,6 +788,49 @@ int bluestore_blob_t::verify_csum(uint64_t b_off, const bufferlist& bl,
     return 0;
 }
 
+int bluestore_blob_t::verify_csum_extents(
+  const vector<std::pair<size_t, const bufferlist*>>& extents,
+  int* b_bad_off) const
+{
+  int r = 0;
+
+  *b_bad_off = -1;
+  switch (csum_type) {
+  case CSUM_NONE:
+    break;
+  case CSUM_XXHASH32:
+    *b_bad_off = Checksummer::verify_extents<Checksummer::xxhash32>(
+      get_csum_chunk_size(), extents, csum_data);
+    break;
+  case CSUM_XXHASH64:
+    *b_bad_off = Checksummer::verify_extents<Checksummer::xxhash64>(
+      get_csum_chunk_size(), extents, csum_data);
+    break;
+  case CSUM_CRC32C:
+    *b_bad_off = Checksummer::verify_extents<Checksummer::crc32c>(
+      get_csum_chunk_size(), extents, csum_data);
+    break;
+  case CSUM_CRC32C_16:
+    *b_bad_off = Checksummer::verify_extents<Checksummer::crc32c_16>(
+      get_csum_chunk_size(), extents, csum_data);
+    break;
+  case CSUM_CRC32C_8:
+    *b_bad_off = Checksummer::verify_extents<Checksummer::crc32c_8>(
+      get_csum_chunk_size(), extents, csum_data);
+    break;
+  default:
+    r = -EOPNOTSUPP;
+    break;
+  }
+
+  if (r < 0)
+    return r;
+  else if (*b_bad_off >= 0)
+    return -1; // bad checksum
+  else
+    return 0;
+}
+
 // bluestore_lextent_t
 void bluestore_lextent_t::encode(bufferlist& bl) const
 {
@@ -859,13 +902,29 @@ void small_decode(map<uint64_t,bluestore_lextent_t>& extents, bufferlist::iterat
   }
 }
 
+void bluestore_onode_t::maybe_decode_extent_map()
+{
+  if (extent_map_bl.length()) {
+    bufferlist::iterator p = extent_map_bl.begin();
+    small_decode(extent_map, p);
+    extent_map_bl.clear();
+  }
+}
+
 void bluestore_onode_t::encode(bufferlist& bl) const
 {
-  ENCODE_START(1, 1, bl);
+  ENCODE_START(2, 1, bl);
   ::encode(nid, bl);
   ::encode(size, bl);
   ::encode(attrs, bl);
-  small_encode(extent_map, bl);
+  if (extent_map_bl.length()) {
+    // never decoded; pass the original encoding through untouched
+    ::encode(extent_map_bl, bl);
+  } else {
+    bufferlist t;
+    small_encode(extent_map, t);
+    ::encode(t, bl);
+  }
   ::encode(omap_head, bl);
   ::encode(expected_object_size, bl);
   ::encode(expected_write_size, bl);
@@ -875,11 +934,19 @@ void bluestore_onode_t::encode(bufferlist& bl) const
 
 void bluestore_onode_t::decode(bufferlist::iterator& p)
 {
-  DECODE_START(1, p);
+  DECODE_START(2, p);
   ::decode(nid, p);
   ::decode(size, p);
   ::decode(attrs, p);
-  small_decode(extent_map, p);
+  if (struct_v >= 2) {
+    // leave the extent map encoded until someone asks for an extent;
+    // metadata-only lookups never pay for the decode
+    extent_map.clear();
+    ::decode(extent_map_bl, p);
+  } else {
+    extent_map_bl.clear();
+    small_decode(extent_map, p);
+  }
   ::decode(omap_head, p);
   ::decode(expected_object_size, p);
   ::decode(expected_write_size, p);
@@ -889,6 +956,8 @@ void bluestore_onode_t::decode(bufferlist::iterator& p)
 
 void bluestore_onode_t::dump(Formatter *f) const
 {
+  // debug path; force the lazy decode so we can show the extents
+  const_cast<bluestore_onode_t*>(this)->maybe_decode_extent_map();
   f->dump_unsigned("nid", nid);
   f->dump_unsigned("size", size);
   f->open_object_section("attrs");
@@ -933,6 +1002,7 @@ size_t bluestore_onode_t::get_preferred_csum_order() const
 
 int bluestore_onode_t::compress_extent_map()
 {
+  maybe_decode_extent_map();
   if (extent_map.empty())
     return 0;
   int removed = 0;
@@ -568,6 +568,13 @@ struct bluestore_blob_t {
   /// return 0 if all is well.
   int verify_csum(uint64_t b_off, const bufferlist& bl, int* b_bad_off) const;
 
+  /// verify csum over several discontiguous extents of this blob in one
+  /// pass; same return convention as verify_csum.  each extent is
+  /// (blob offset, data).
+  int verify_csum_extents(
+    const vector<std::pair<size_t, const bufferlist*>>& extents,
+    int* b_bad_off) const;
+
 };
 WRITE_CLASS_ENCODER(bluestore_blob_t)
 
@@ -618,6 +625,7 @@ struct bluestore_onode_t {
   uint64_t size;                       ///< object size
   map<string, bufferptr> attrs;        ///< attrs
   map<uint64_t,bluestore_lextent_t> extent_map;  ///< extent refs
+  bufferlist extent_map_bl;            ///< encoded extent_map, not yet decoded
   uint64_t omap_head;                  ///< id for omap root node
 
   uint32_t expected_object_size;
@@ -635,8 +643,15 @@ struct bluestore_onode_t {
   /// get preferred csum chunk size
   size_t get_preferred_csum_order() const;
 
+  /// decode extent_map from extent_map_bl if we have not done so yet.
+  /// decode is deferred at onode load so that metadata-only operations
+  /// (stat, getattr, omap) never pay for it; every extent_map access
+  /// must come through here first.
+  void maybe_decode_extent_map();
+
   /// find a lextent that includes offset
   map<uint64_t,bluestore_lextent_t>::iterator find_lextent(uint64_t offset) {
+    maybe_decode_extent_map();
     map<uint64_t,bluestore_lextent_t>::iterator fp =
       extent_map.lower_bound(offset);
     if (fp != extent_map.begin()) {
@@ -652,6 +667,7 @@ struct bluestore_onode_t {
 
   /// seek to the first lextent including or after offset
   map<uint64_t,bluestore_lextent_t>::iterator seek_lextent(uint64_t offset) {
+    maybe_decode_extent_map();
     map<uint64_t,bluestore_lextent_t>::iterator fp =
       extent_map.lower_bound(offset);
     if (fp != extent_map.begin()) {
@@ -664,6 +680,7 @@ struct bluestore_onode_t {
   }
 
   bool has_any_lextents(uint64_t offset, uint64_t length) {
+    maybe_decode_extent_map();
     map<uint64_t,bluestore_lextent_t>::iterator fp =
       extent_map.lower_bound(offset);
     if (fp != extent_map.begin()) {
@@ -450,6 +450,18 @@ int DBObjectMap::set_keys(const ghobject_t &oid,
   if (check_spos(oid, header, spos))
     return 0;
 
+  // flatten long parent chains so later accesses resolve in one level
+  if (header->parent && g_conf->filestore_omap_flatten_depth > 0) {
+    int depth = get_chain_depth(header);
+    if (depth < 0)
+      return depth;
+    if (depth >= g_conf->filestore_omap_flatten_depth) {
+      int r = flatten(hl, oid, header, t);
+      if (r < 0)
+	return r;
+    }
+  }
+
   t->set(user_prefix(header), set);
 
   return db->submit_transaction(t);
@@ -618,6 +630,61 @@ int DBObjectMap::copy_up_header(Header header,
   return 0;
 }
 
+int DBObjectMap::get_chain_depth(Header header)
+{
+  int depth = 0;
+  Header current = header;
+  while (current->parent) {
+    current = lookup_parent(current);
+    if (!current)
+      return -EINVAL;
+    ++depth;
+  }
+  return depth;
+}
+
+int DBObjectMap::flatten(const MapHeaderLock &hl,
+			 const ghobject_t &oid,
+			 Header header,
+			 KeyValueDB::Transaction t)
+{
+  assert(header->parent);
+  dout(10) << "flatten: " << oid << " seq " << header->seq
+	   << " parent " << header->parent << dendl;
+
+  // copy down every key only visible through the chain; the iterator
+  // must go out of scope before we look up the parent below or it will
+  // hold the parent seq in use
+  map<string, bufferlist> to_write;
+  {
+    DBObjectMapIterator iter = _get_iterator(header);
+    for (iter->seek_to_first(); iter->valid(); iter->next()) {
+      if (iter->status() < 0)
+	return iter->status();
+      if (!iter->on_parent())
+	continue;
+      if (to_write.size() >= (size_t)g_conf->filestore_omap_flatten_max_keys) {
+	dout(10) << "flatten: " << oid
+		 << " chain holds too many keys, leaving as is" << dendl;
+	return 0;
+      }
+      to_write[iter->key()].append(iter->value());
+    }
+  }
+  if (!to_write.empty())
+    t->set(user_prefix(header), to_write);
+  copy_up_header(header, t);
+  Header parent = lookup_parent(header);
+  if (!parent)
+    return -EINVAL;
+  parent->num_children--;
+  _clear(parent, t);
+  header->parent = 0;
+  set_map_header(hl, oid, *header, t);
+  t->rmkeys_by_prefix(complete_prefix(header));
+  return 0;
+}
+
 int DBObjectMap::need_parent(DBObjectMapIterator iter)
 {
   int r = iter->seek_to_first();
@@ -1133,6 +1200,17 @@ DBObjectMap::Header DBObjectMap::lookup_parent(Header input)
   Mutex::Locker l(header_lock);
   while (in_use.count(input->parent))
     header_cond.Wait(header_lock);
+
+  Header header = Header(new _Header(), RemoveOnDelete(this));
+  {
+    Mutex::Locker l(cache_lock);
+    if (parent_caches.lookup(input->parent, header.get())) {
+      assert(header->seq == input->parent);
+      in_use.insert(header->seq);
+      return header;
+    }
+  }
+
   map<string, bufferlist> out;
   set<string> keys;
   keys.insert(HEADER_KEY);
@@ -1149,12 +1227,15 @@ DBObjectMap::Header DBObjectMap::lookup_parent(Header input)
     return Header();
   }
 
-  Header header = Header(new _Header(), RemoveOnDelete(this));
   header->seq = input->parent;
   bufferlist::iterator iter = out.begin()->second.begin();
   header->decode(iter);
   dout(20) << "lookup_parent: parent seq is " << header->seq << " with parent "
        << header->parent << dendl;
+  {
+    Mutex::Locker l(cache_lock);
+    parent_caches.add(header->seq, *header);
+  }
   in_use.insert(header->seq);
   return header;
 }
@@ -1176,6 +1257,10 @@ DBObjectMap::Header DBObjectMap::lookup_create_map_header(
 void DBObjectMap::clear_header(Header header, KeyValueDB::Transaction t)
 {
   dout(20) << "clear_header: clearing seq " << header->seq << dendl;
+  {
+    Mutex::Locker l(cache_lock);
+    parent_caches.clear(header->seq);
+  }
   t->rmkeys_by_prefix(user_prefix(header));
   t->rmkeys_by_prefix(sys_prefix(header));
   t->rmkeys_by_prefix(complete_prefix(header));
@@ -1188,6 +1273,10 @@ void DBObjectMap::clear_header(Header header, KeyValueDB::Transaction t)
 void DBObjectMap::set_header(Header header, KeyValueDB::Transaction t)
 {
   dout(20) << "set_header: setting seq " << header->seq << dendl;
+  {
+    Mutex::Locker l(cache_lock);
+    parent_caches.add(header->seq, *header);
+  }
   map<string, bufferlist> to_write;
   header->encode(to_write[HEADER_KEY]);
   t->set(sys_prefix(header), to_write);
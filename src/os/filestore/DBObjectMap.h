@@ -117,7 +117,8 @@ public:
 
   explicit DBObjectMap(KeyValueDB *db) : db(db), header_lock("DBOBjectMap"),
            	                         cache_lock("DBObjectMap::CacheLock"),
-      	                                 caches(g_conf->filestore_omap_header_cache_size)
+      	                                 caches(g_conf->filestore_omap_header_cache_size),
+      	                                 parent_caches(g_conf->filestore_omap_header_cache_size)
     {}
 
   int set_keys(
@@ -330,6 +331,8 @@ private:
   typedef ceph::shared_ptr<_Header> Header;
   Mutex cache_lock;
   SimpleLRU<ghobject_t, _Header, ghobject_t::BitwiseComparator> caches;
+  /// headers by seq, so resolving parent chains avoids kv reads
+  SimpleLRU<uint64_t, _Header> parent_caches;
 
   string map_header_key(const ghobject_t &oid);
   string header_key(uint64_t seq);
@@ -499,6 +502,15 @@ private:
   /// 0 if the complete set now contains all of key space, < 0 on error, 1 else
   int need_parent(DBObjectMapIterator iter);
 
+  /// Number of ancestor headers behind header, < 0 on error
+  int get_chain_depth(Header header);
+
+  /// Copies parent-visible keys into header and severs the parent link
+  int flatten(const MapHeaderLock &hl,
+	      const ghobject_t &oid,
+	      Header header,
+	      KeyValueDB::Transaction t);
+
   /// Copies header entry from parent @see rm_keys
   int copy_up_header(Header header,
 		     KeyValueDB::Transaction t);
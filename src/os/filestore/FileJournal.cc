@@ -1642,19 +1642,46 @@ int FileJournal::prepare_entry(vector<ObjectStore::Transaction>& tls, bufferlist
        << " (bl alignment " << data_align << ")"
        << dendl;
   bufferlist ebl;
-  // header
-  ebl.append((const char*)&h, sizeof(h));
-  if (h.pre_pad) {
-    ebl.push_back(buffer::create_static(h.pre_pad, zero_buf));
+  if (directio) {
+    // keep the header and pre-pad (and, below, the post-pad and footer)
+    // each in one aligned contiguous segment.  rebuild_aligned() then only
+    // restages the small unaligned runs around the payload; a page-aligned
+    // payload is written in place via the aio iovecs instead of being
+    // memcpy'd into a staging buffer.
+    bufferptr hptr = buffer::create_aligned(head_size + h.pre_pad,
+					    CEPH_DIRECTIO_ALIGNMENT);
+    memcpy(hptr.c_str(), &h, sizeof(h));
+    if (h.pre_pad) {
+      memset(hptr.c_str() + sizeof(h), 0, h.pre_pad);
+    }
+    ebl.push_back(hptr);
+  } else {
+    // header
+    ebl.append((const char*)&h, sizeof(h));
+    if (h.pre_pad) {
+      ebl.push_back(buffer::create_static(h.pre_pad, zero_buf));
+    }
   }
   // payload
   ebl.claim_append(bl, buffer::list::CLAIM_ALLOW_NONSHAREABLE); // potential zero-copy
-  if (h.post_pad) {
-    ebl.push_back(buffer::create_static(h.post_pad, zero_buf));
+  if (directio) {
+    bufferptr fptr = buffer::create_aligned(h.post_pad + head_size,
+					    CEPH_DIRECTIO_ALIGNMENT);
+    if (h.post_pad) {
+      memset(fptr.c_str(), 0, h.post_pad);
+    }
+    memcpy(fptr.c_str() + h.post_pad, &h, sizeof(h));
+    ebl.push_back(fptr);
+    ebl.rebuild_aligned(CEPH_DIRECTIO_ALIGNMENT);
+  } else {
+    if (h.post_pad) {
+      ebl.push_back(buffer::create_static(h.post_pad, zero_buf));
+    }
+    // footer
+    ebl.append((const char*)&h, sizeof(h));
+    // buffered journals write via write_fd() and need no particular
+    // alignment; skip the restaging copy entirely
   }
-  // footer
-  ebl.append((const char*)&h, sizeof(h));
-  ebl.rebuild_aligned(CEPH_DIRECTIO_ALIGNMENT);
   tbl->claim(ebl);
   return h.len;
 }
@@ -467,6 +467,10 @@ private:
   bool should_commit_now() {
     return full_state != FULL_NOTFULL && !write_stop;
   }
+  double get_fill_ratio() override {
+    uint64_t max = throttle.get_max();
+    return max ? (double)throttle.get_current() / (double)max : 0.0;
+  }
 
   void write_header_sync();
 
@@ -532,8 +532,9 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   fdcache(g_ceph_context),
   wbthrottle(g_ceph_context),
   next_osr_id(0),
-  m_disable_wbthrottle(g_conf->filestore_odsync_write || 
+  m_disable_wbthrottle(g_conf->filestore_odsync_write ||
                       !g_conf->filestore_wbthrottle_enable),
+  m_filestore_apply_object_ordering(g_conf->filestore_apply_object_ordering),
   throttle_ops(g_conf->filestore_caller_concurrency),
   throttle_bytes(g_conf->filestore_caller_concurrency),
   m_ondisk_finisher_num(g_conf->filestore_ondisk_finisher_threads),
@@ -550,6 +551,7 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   m_filestore_fiemap_threshold(g_conf->filestore_fiemap_threshold),
   m_filestore_max_sync_interval(g_conf->filestore_max_sync_interval),
   m_filestore_min_sync_interval(g_conf->filestore_min_sync_interval),
+  m_filestore_journal_target_fill(g_conf->filestore_journal_target_fill),
   m_filestore_fail_eio(g_conf->filestore_fail_eio),
   m_filestore_fadvise(g_conf->filestore_fadvise),
   do_update(do_update),
@@ -1933,6 +1935,37 @@ FileStore::Op *FileStore::build_op(vector<Transaction>& tls,
   o->ops = ops;
   o->bytes = bytes;
   o->osd_op = osd_op;
+  o->exclusive = false;
+  o->applying = false;
+  if (m_filestore_apply_object_ordering) {
+    // record the objects this op touches so _do_op can order only
+    // against conflicting ops; collection-level ops order against
+    // everything in the sequencer
+    for (vector<Transaction>::iterator p = o->tls.begin();
+	 p != o->tls.end();
+	 ++p) {
+      Transaction::iterator i = p->begin();
+      o->objects.insert(i.objects.begin(), i.objects.end());
+      while (i.have_op()) {
+	Transaction::Op *top = i.decode_op();
+	switch (top->op) {
+	case Transaction::OP_NOP:
+	  break;
+	case Transaction::OP_MKCOLL:
+	case Transaction::OP_RMCOLL:
+	case Transaction::OP_COLL_SETATTR:
+	case Transaction::OP_COLL_RMATTR:
+	case Transaction::OP_COLL_SETATTRS:
+	case Transaction::OP_COLL_RENAME:
+	case Transaction::OP_COLL_HINT:
+	case Transaction::OP_SPLIT_COLLECTION:
+	case Transaction::OP_SPLIT_COLLECTION2:
+	  o->exclusive = true;
+	  break;
+	}
+      }
+    }
+  }
   return o;
 }
 
@@ -1989,8 +2022,15 @@ void FileStore::_do_op(OpSequencer *osr, ThreadPool::TPHandle &handle)
     dout(5) << "_do_op done stalling" << dendl;
   }
 
-  osr->apply_lock.Lock();
-  Op *o = osr->peek_queue();
+  Op *o;
+  if (m_filestore_apply_object_ordering) {
+    // order only against in-flight ops touching the same object(s);
+    // independent objects in the same sequencer apply concurrently
+    o = osr->start_runnable_op();
+  } else {
+    osr->apply_lock.Lock();
+    o = osr->peek_queue();
+  }
   apply_manager.op_apply_start(o->op);
   dout(5) << "_do_op " << o << " seq " << o->op << " " << *osr << "/" << osr->parent << " start" << dendl;
   int r = _do_transactions(o->tls, o->op, &handle);
@@ -2005,13 +2045,18 @@ void FileStore::_do_op(OpSequencer *osr, ThreadPool::TPHandle &handle)
 void FileStore::_finish_op(OpSequencer *osr)
 {
   list<Context*> to_queue;
-  Op *o = osr->dequeue(&to_queue);
+  Op *o;
+  if (m_filestore_apply_object_ordering)
+    o = osr->dequeue_applied(&to_queue);
+  else
+    o = osr->dequeue(&to_queue);
 
   utime_t lat = ceph_clock_now(g_ceph_context);
   lat -= o->start;
 
   dout(10) << "_finish_op " << o << " seq " << o->op << " " << *osr << "/" << osr->parent << " lat " << lat << dendl;
-  osr->apply_lock.Unlock();  // locked in _do_op
+  if (!m_filestore_apply_object_ordering)
+    osr->apply_lock.Unlock();  // locked in _do_op
 
   // called with tp lock held
   op_queue_release_throttle(o);
@@ -2048,6 +2093,9 @@ int FileStore::queue_transactions(Sequencer *posr, vector<Transaction>& tls,
 				  TrackedOpRef osd_op,
 				  ThreadPool::TPHandle *handle)
 {
+  if (tracing())
+    trace_transactions(posr, tls);
+
   Context *onreadable;
   Context *ondisk;
   Context *onreadable_sync;
@@ -3776,7 +3824,32 @@ void FileStore::sync_entry()
     min_interval.set_from_double(m_filestore_min_sync_interval);
 
     utime_t startwait = ceph_clock_now(g_ceph_context);
-    if (!force_sync) {
+    if (!force_sync && journal && m_filestore_journal_target_fill > 0) {
+      // adaptive: poll the journal fill and commit early once we cross
+      // the target band instead of riding out max_interval and slamming
+      // into the full-journal throttle during bursts
+      utime_t poll_interval;
+      poll_interval.set_from_double(MAX(m_filestore_min_sync_interval, 0.1));
+      utime_t end = startwait;
+      end += max_interval;
+      while (!force_sync && !stop) {
+	utime_t now = ceph_clock_now(g_ceph_context);
+	if (now >= end)
+	  break;
+	double fill = journal->get_fill_ratio();
+	if (fill >= m_filestore_journal_target_fill &&
+	    now - startwait >= min_interval) {
+	  dout(20) << "sync_entry journal fill " << fill << " over target "
+		   << m_filestore_journal_target_fill
+		   << ", committing early" << dendl;
+	  break;
+	}
+	utime_t t = poll_interval;
+	if (end - now < t)
+	  t = end - now;
+	sync_cond.WaitInterval(g_ceph_context, lock, t);
+      }
+    } else if (!force_sync) {
       dout(20) << "sync_entry waiting for max_interval " << max_interval << dendl;
       sync_cond.WaitInterval(g_ceph_context, lock, max_interval);
     } else {
@@ -5474,6 +5547,7 @@ const char** FileStore::get_tracked_conf_keys() const
     "filestore_max_xattr_value_size_other",
     "filestore_min_sync_interval",
     "filestore_max_sync_interval",
+    "filestore_journal_target_fill",
     "filestore_queue_max_ops",
     "filestore_queue_max_bytes",
     "filestore_expected_throughput_bytes",
@@ -5528,6 +5602,7 @@ void FileStore::handle_conf_change(const struct md_config_t *conf,
 
   if (changed.count("filestore_min_sync_interval") ||
       changed.count("filestore_max_sync_interval") ||
+      changed.count("filestore_journal_target_fill") ||
       changed.count("filestore_kill_at") ||
       changed.count("filestore_fail_eio") ||
       changed.count("filestore_sloppy_crc") ||
@@ -5537,6 +5612,7 @@ void FileStore::handle_conf_change(const struct md_config_t *conf,
     Mutex::Locker l(lock);
     m_filestore_min_sync_interval = conf->filestore_min_sync_interval;
     m_filestore_max_sync_interval = conf->filestore_max_sync_interval;
+    m_filestore_journal_target_fill = conf->filestore_journal_target_fill;
     m_filestore_kill_at.set(conf->filestore_kill_at);
     m_filestore_fail_eio = conf->filestore_fail_eio;
     m_filestore_fadvise = conf->filestore_fadvise;
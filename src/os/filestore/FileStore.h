@@ -193,6 +193,10 @@ private:
     Context *onreadable, *onreadable_sync;
     uint64_t ops, bytes;
     TrackedOpRef osd_op;
+    /// objects touched; only populated with filestore_apply_object_ordering
+    set<ghobject_t, ghobject_t::BitwiseComparator> objects;
+    bool exclusive;  ///< contains collection-level op(s); orders vs everything
+    bool applying;   ///< currently being applied by an op_tp thread
   };
   class OpSequencer : public Sequencer_impl {
     Mutex qlock; // to protect q, for benefit of flush (peek/dequeue also protected by lock)
@@ -200,6 +204,39 @@ private:
     list<uint64_t> jq;
     list<pair<uint64_t, Context*> > flush_commit_waiters;
     Cond cond;
+    /// in-flight op per op_tp thread (filestore_apply_object_ordering)
+    map<pthread_t, Op*> applying;
+
+    /// true if two ops must apply in queue order
+    static bool _ops_conflict(Op *a, Op *b) {
+      if (a->exclusive || b->exclusive)
+	return true;
+      // both sets are sorted with the same comparator; walk them in step
+      ghobject_t::BitwiseComparator cmp;
+      set<ghobject_t, ghobject_t::BitwiseComparator>::iterator pa = a->objects.begin();
+      set<ghobject_t, ghobject_t::BitwiseComparator>::iterator pb = b->objects.begin();
+      while (pa != a->objects.end() && pb != b->objects.end()) {
+	if (cmp(*pa, *pb))
+	  ++pa;
+	else if (cmp(*pb, *pa))
+	  ++pb;
+	else
+	  return true;
+      }
+      return false;
+    }
+
+    /// true if an earlier uncompleted op conflicts with c
+    bool _op_blocked(Op *c) {
+      assert(qlock.is_locked());
+      for (list<Op*>::iterator p = q.begin(); p != q.end(); ++p) {
+	if (*p == c)
+	  return false;
+	if (_ops_conflict(*p, c))
+	  return true;
+      }
+      ceph_abort();  // c must be in q
+    }
   public:
     Sequencer *parent;
     Mutex apply_lock;  // for apply mutual exclusion
@@ -286,6 +323,51 @@ private:
       return o;
     }
 
+    /**
+     * claim the oldest op that is not ordered behind an uncompleted
+     * conflicting op, blocking until one becomes runnable.  Used in
+     * place of apply_lock/peek_queue when filestore_apply_object_ordering
+     * is set; ops touching disjoint objects apply concurrently while
+     * ops on the same object (or collection-level ops) keep queue order.
+     */
+    Op *start_runnable_op() {
+      Mutex::Locker l(qlock);
+      while (true) {
+	for (list<Op*>::iterator p = q.begin(); p != q.end(); ++p) {
+	  if ((*p)->applying)
+	    continue;
+	  if (!_op_blocked(*p)) {
+	    (*p)->applying = true;
+	    applying[pthread_self()] = *p;
+	    return *p;
+	  }
+	}
+	// every unstarted op is behind a conflicting in-flight op;
+	// wait for a completion to unblock one
+	cond.Wait(qlock);
+      }
+    }
+
+    /// retire the op this thread claimed via start_runnable_op()
+    Op *dequeue_applied(list<Context*> *to_queue) {
+      assert(to_queue);
+      Mutex::Locker l(qlock);
+      map<pthread_t, Op*>::iterator p = applying.find(pthread_self());
+      assert(p != applying.end());
+      Op *o = p->second;
+      applying.erase(p);
+      for (list<Op*>::iterator i = q.begin(); i != q.end(); ++i) {
+	if (*i == o) {
+	  q.erase(i);
+	  break;
+	}
+      }
+      cond.SignalAll();
+
+      _wake_flush_waiters(to_queue);
+      return o;
+    }
+
     void flush() {
       Mutex::Locker l(qlock);
 
@@ -339,6 +421,7 @@ private:
 
   atomic_t next_osr_id;
   bool m_disable_wbthrottle;
+  bool m_filestore_apply_object_ordering;
   deque<OpSequencer*> op_queue;
   BackoffThrottle throttle_ops, throttle_bytes;
   const int m_ondisk_finisher_num;
@@ -711,6 +794,7 @@ private:
   int m_filestore_fiemap_threshold;
   double m_filestore_max_sync_interval;
   double m_filestore_min_sync_interval;
+  double m_filestore_journal_target_fill;
   bool m_filestore_fail_eio;
   bool m_filestore_fadvise;
   int do_update;
@@ -19,6 +19,7 @@
 
 #include "HashIndex.h"
 
+#include "common/config.h"
 #include "common/debug.h"
 #define dout_subsys ceph_subsys_filestore
 
@@ -293,6 +294,10 @@ int HashIndex::_split(
   uint32_t bits,
   CollectionIndex* dest) {
   assert(collection_version() == dest->collection_version());
+  // col_split creates subdirs in dest and may leave ours emptier; drop
+  // both memoized path caches
+  invalidate_path_cache();
+  static_cast<HashIndex*>(dest)->invalidate_path_cache();
   unsigned mkdirred = 0;
   return col_split_level(
     *this,
@@ -364,6 +369,32 @@ int HashIndex::_lookup(const ghobject_t &oid,
 		       int *hardlink) {
   vector<string> path_comp;
   get_path_components(oid, &path_comp);
+
+  uint64_t cache_size = g_conf->filestore_index_path_cache_size;
+  string cache_key;
+  if (cache_size) {
+    for (vector<string>::iterator i = path_comp.begin();
+	 i != path_comp.end();
+	 ++i)
+      cache_key.append(*i);
+    bool hit = false;
+    unsigned depth = 0;
+    {
+      Mutex::Locker l(path_cache_lock);
+      ceph::unordered_map<string, unsigned>::iterator c =
+	path_cache.find(cache_key);
+      if (c != path_cache.end()) {
+	depth = c->second;
+	hit = true;
+      }
+    }
+    if (hit) {
+      path->insert(path->end(),
+		   path_comp.begin(), path_comp.begin() + depth);
+      return get_mangled_name(*path, oid, mangled_name, hardlink);
+    }
+  }
+
   vector<string>::iterator next = path_comp.begin();
   int exists;
   while (1) {
@@ -380,6 +411,12 @@ int HashIndex::_lookup(const ghobject_t &oid,
       break;
     path->push_back(*(next++));
   }
+  if (cache_size) {
+    Mutex::Locker l(path_cache_lock);
+    if (path_cache.size() >= cache_size)
+      path_cache.clear();  // wholesale eviction; hot entries repopulate fast
+    path_cache[cache_key] = path->size();
+  }
   return get_mangled_name(*path, oid, mangled_name, hardlink);
 }
 
@@ -399,6 +436,7 @@ int HashIndex::_collection_list_partial(const ghobject_t &start,
 }
 
 int HashIndex::prep_delete() {
+  invalidate_path_cache();
   return recursive_remove(vector<string>());
 }
 
@@ -643,6 +681,7 @@ int HashIndex::initiate_merge(const vector<string> &path, subdir_info_s info) {
 }
 
 int HashIndex::complete_merge(const vector<string> &path, subdir_info_s info) {
+  invalidate_path_cache();
   vector<string> dst = path;
   dst.pop_back();
   subdir_info_s dstinfo;
@@ -684,6 +723,7 @@ int HashIndex::initiate_split(const vector<string> &path, subdir_info_s info) {
 }
 
 int HashIndex::complete_split(const vector<string> &path, subdir_info_s info) {
+  invalidate_path_cache();
   int level = info.hash_level;
   map<string, ghobject_t> objects;
   vector<string> dst = path;
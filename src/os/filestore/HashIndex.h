@@ -17,6 +17,8 @@
 
 #include "include/buffer_fwd.h"
 #include "include/encoding.h"
+#include "include/unordered_map.h"
+#include "common/Mutex.h"
 #include "LFNIndex.h"
 
 extern string reverse_hexdigit_bits_string(string l);
@@ -67,6 +69,25 @@ private:
   int merge_threshold;
   int split_multiplier;
 
+  /**
+   * Memoized path resolution (filestore_index_path_cache_size).
+   *
+   * The subdir an object resolves to depends only on its hash and on
+   * the current directory fan-out, so we cache hash -> resolved depth
+   * and skip the per-level stats in _lookup for hot objects.  The
+   * cache must be dropped whenever subdirs are created or removed
+   * (split/merge/col_split); structural changes run under the write
+   * side of access_lock, so they never race a cached lookup.
+   */
+  Mutex path_cache_lock;
+  ceph::unordered_map<string, unsigned> path_cache;
+
+  /// drop all memoized paths; call whenever subdirs are created or removed
+  void invalidate_path_cache() {
+    Mutex::Locker l(path_cache_lock);
+    path_cache.clear();
+  }
+
   /// Encodes current subdir state for determining when to split/merge.
   struct subdir_info_s {
     uint64_t objs;       ///< Objects in subdir.
@@ -142,7 +163,8 @@ public:
     double retry_probability=0) ///< [in] retry probability
     : LFNIndex(collection, base_path, index_version, retry_probability),
       merge_threshold(merge_at),
-      split_multiplier(split_multiple) {}
+      split_multiplier(split_multiple),
+      path_cache_lock("HashIndex::path_cache_lock") {}
 
   /// @see CollectionIndex
   uint32_t collection_version() { return index_version; }
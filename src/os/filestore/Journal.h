@@ -60,6 +60,9 @@ public:
 
   virtual int dump(ostream& out) { return -EOPNOTSUPP; }
 
+  /// fraction of the journal held by entries not yet committed to the fs
+  virtual double get_fill_ratio() { return 0.0; }
+
   void set_wait_on_full(bool b) { wait_on_full = b; }
 
   // writes
@@ -4,9 +4,11 @@
 #include "acconfig.h"
 
 #include "os/filestore/WBThrottle.h"
+#include "common/Clock.h"
 #include "common/perf_counters.h"
 
 WBThrottle::WBThrottle(CephContext *cct) :
+  adaptive(false), target_lat(0), est_lat(0), scale(1.0),
   cur_ios(0), cur_size(0),
   cct(cct),
   logger(NULL),
@@ -28,6 +30,7 @@ WBThrottle::WBThrottle(CephContext *cct) :
   b.add_u64(l_wbthrottle_ios_wb, "ios_wb", "Written operations");
   b.add_u64(l_wbthrottle_inodes_dirtied, "inodes_dirtied", "Entries waiting for write");
   b.add_u64(l_wbthrottle_inodes_wb, "inodes_wb", "Written entries");
+  b.add_time_avg(l_wbthrottle_flush_lat, "flush_lat", "Writeback flush latency");
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
   for (unsigned i = l_wbthrottle_first + 1; i != l_wbthrottle_last; ++i)
@@ -78,6 +81,10 @@ const char** WBThrottle::get_tracked_conf_keys() const
     "filestore_wbthrottle_xfs_ios_hard_limit",
     "filestore_wbthrottle_xfs_inodes_start_flusher",
     "filestore_wbthrottle_xfs_inodes_hard_limit",
+    "filestore_wbthrottle_adaptive",
+    "filestore_wbthrottle_adaptive_target_latency",
+    "filestore_wbthrottle_adaptive_scale_min",
+    "filestore_wbthrottle_adaptive_scale_max",
     NULL
   };
   return KEYS;
@@ -87,37 +94,75 @@ void WBThrottle::set_from_conf()
 {
   assert(lock.is_locked());
   if (fs == BTRFS) {
-    size_limits.first =
+    base_size_limits.first =
       cct->_conf->filestore_wbthrottle_btrfs_bytes_start_flusher;
-    size_limits.second =
+    base_size_limits.second =
       cct->_conf->filestore_wbthrottle_btrfs_bytes_hard_limit;
-    io_limits.first =
+    base_io_limits.first =
       cct->_conf->filestore_wbthrottle_btrfs_ios_start_flusher;
-    io_limits.second =
+    base_io_limits.second =
       cct->_conf->filestore_wbthrottle_btrfs_ios_hard_limit;
-    fd_limits.first =
+    base_fd_limits.first =
       cct->_conf->filestore_wbthrottle_btrfs_inodes_start_flusher;
-    fd_limits.second =
+    base_fd_limits.second =
       cct->_conf->filestore_wbthrottle_btrfs_inodes_hard_limit;
   } else if (fs == XFS) {
-    size_limits.first =
+    base_size_limits.first =
       cct->_conf->filestore_wbthrottle_xfs_bytes_start_flusher;
-    size_limits.second =
+    base_size_limits.second =
       cct->_conf->filestore_wbthrottle_xfs_bytes_hard_limit;
-    io_limits.first =
+    base_io_limits.first =
       cct->_conf->filestore_wbthrottle_xfs_ios_start_flusher;
-    io_limits.second =
+    base_io_limits.second =
       cct->_conf->filestore_wbthrottle_xfs_ios_hard_limit;
-    fd_limits.first =
+    base_fd_limits.first =
       cct->_conf->filestore_wbthrottle_xfs_inodes_start_flusher;
-    fd_limits.second =
+    base_fd_limits.second =
       cct->_conf->filestore_wbthrottle_xfs_inodes_hard_limit;
   } else {
     assert(0 == "invalid value for fs");
   }
+  adaptive = cct->_conf->filestore_wbthrottle_adaptive;
+  target_lat = cct->_conf->filestore_wbthrottle_adaptive_target_latency;
+  if (!adaptive)
+    scale = 1.0;
+  _apply_scale();
   cond.Signal();
 }
 
+void WBThrottle::_apply_scale()
+{
+  assert(lock.is_locked());
+  size_limits.first = base_size_limits.first * scale;
+  size_limits.second = base_size_limits.second * scale;
+  io_limits.first = MAX(base_io_limits.first * scale, (double)1);
+  io_limits.second = MAX(base_io_limits.second * scale, (double)1);
+  fd_limits.first = MAX(base_fd_limits.first * scale, (double)1);
+  fd_limits.second = MAX(base_fd_limits.second * scale, (double)1);
+}
+
+void WBThrottle::_update_scale(double lat)
+{
+  assert(lock.is_locked());
+  // smooth the per-flush service time the way tcp smooths rtt
+  if (est_lat == 0)
+    est_lat = lat;
+  else
+    est_lat = est_lat * .875 + lat * .125;
+
+  double old_scale = scale;
+  if (est_lat > target_lat)
+    scale *= .9;       // device is behind; flush earlier, queue less
+  else if (est_lat < target_lat / 2)
+    scale *= 1.05;     // device has headroom; let more writeback accumulate
+  scale = MIN(MAX(scale, (double)cct->_conf->filestore_wbthrottle_adaptive_scale_min),
+	      (double)cct->_conf->filestore_wbthrottle_adaptive_scale_max);
+  if (scale != old_scale) {
+    _apply_scale();
+    cond.Signal();  // limits may have grown; wake throttled appliers
+  }
+}
+
 void WBThrottle::handle_conf_change(const md_config_t *conf,
 				    const std::set<std::string> &changed)
 {
@@ -165,11 +210,13 @@ void *WBThrottle::entry()
     logger->dec(l_wbthrottle_inodes_dirtied);
     logger->inc(l_wbthrottle_inodes_wb);
     lock.Unlock();
+    utime_t start = ceph_clock_now(cct);
 #ifdef HAVE_FDATASYNC
     ::fdatasync(**wb.get<1>());
 #else
     ::fsync(**wb.get<1>());
 #endif
+    utime_t lat = ceph_clock_now(cct) - start;
 #ifdef HAVE_POSIX_FADVISE
     if (g_conf->filestore_fadvise && wb.get<2>().nocache) {
       int fa_r = posix_fadvise(**wb.get<1>(), 0, 0, POSIX_FADV_DONTNEED);
@@ -177,6 +224,9 @@ void *WBThrottle::entry()
     }
 #endif
     lock.Lock();
+    logger->tinc(l_wbthrottle_flush_lat, lat);
+    if (adaptive)
+      _update_scale((double)lat);
     clearing = ghobject_t();
     cond.Signal();
     wb = boost::tuple<ghobject_t, FDRef, PendingWB>();
@@ -34,6 +34,7 @@ enum {
   l_wbthrottle_ios_wb,
   l_wbthrottle_inodes_dirtied,
   l_wbthrottle_inodes_wb,
+  l_wbthrottle_flush_lat,
   l_wbthrottle_last
 };
 
@@ -57,6 +58,16 @@ class WBThrottle : Thread, public md_config_obs_t {
   /// Limits on unflushed objects
   pair<uint64_t, uint64_t> fd_limits;
 
+  /// Configured limits, before adaptive scaling
+  pair<uint64_t, uint64_t> base_size_limits;
+  pair<uint64_t, uint64_t> base_io_limits;
+  pair<uint64_t, uint64_t> base_fd_limits;
+
+  bool adaptive;      ///< scale limits from measured flush latency
+  double target_lat;  ///< flush latency budget (seconds)
+  double est_lat;     ///< smoothed measured flush latency (seconds)
+  double scale;       ///< current multiplier applied to base limits
+
   uint64_t cur_ios;  /// Currently unflushed IOs
   uint64_t cur_size; /// Currently unflushed bytes
 
@@ -128,6 +139,8 @@ private:
   FS fs;
 
   void set_from_conf();
+  void _apply_scale();
+  void _update_scale(double lat);
   bool beyond_limit() const {
     if (cur_ios < io_limits.first &&
 	pending_wbs.size() < fd_limits.first &&
@@ -131,6 +131,40 @@ public:
       return 0;
     }
 
+    typedef list<aio_t>::iterator aio_iter;
+
+    int submit_batch(aio_iter begin, aio_iter end, int aios_size,
+		     int *retries) {
+      // 2^16 * 125us = ~8 seconds, so max sleep is ~16 seconds
+      int attempts = 16;
+      int delay = 125;
+      iocb *piocb[aios_size];
+      int left = 0;
+      for (aio_iter cur = begin; cur != end; ++cur) {
+	piocb[left++] = &cur->iocb;
+      }
+      assert(left == aios_size);
+      int done = 0;
+      while (left > 0) {
+	int r = io_submit(ctx, left, piocb + done);
+	if (r < 0) {
+	  if (r == -EAGAIN && attempts-- > 0) {
+	    usleep(delay);
+	    delay *= 2;
+	    (*retries)++;
+	    continue;
+	  }
+	  return r;
+	}
+	assert(r > 0);
+	done += r;
+	left -= r;
+	attempts = 16;
+	delay = 125;
+      }
+      return done;
+    }
+
     int get_next_completed(int timeout_ms, aio_t **paio, int max) {
       io_event event[max];
       struct timespec t = {
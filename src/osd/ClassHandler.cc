@@ -41,6 +41,26 @@ int ClassHandler::open_class(const string& cname, ClassData **pcls)
   return 0;
 }
 
+int ClassHandler::open_method(const string& cname, const string& mname,
+			      ClassData **pcls, ClassMethod **pmethod)
+{
+  Mutex::Locker lock(mutex);
+  ClassData *cls = _get_class(cname, true);
+  if (!cls)
+    return -EPERM;
+  if (cls->status != ClassData::CLASS_OPEN) {
+    int r = _load_class(cls);
+    if (r)
+      return r;
+  }
+  ClassMethod *method = cls->_get_method(mname.c_str());
+  if (!method)
+    return -ENOENT;
+  *pcls = cls;
+  *pmethod = method;
+  return 0;
+}
+
 int ClassHandler::open_all_classes()
 {
   dout(10) << __func__ << dendl;
@@ -26,7 +26,8 @@ public:
     void unregister();
 
     int get_flags() {
-      Mutex::Locker l(cls->handler->mutex);
+      // set at registration time (under the handler mutex) and never
+      // changed afterward, so callers can read them unlocked
       return flags;
     }
 
@@ -115,7 +116,20 @@ public:
   int open_all_classes();
 
   int open_class(const string& cname, ClassData **pcls);
-  
+
+  /**
+   * resolve a class and one of its methods in a single lock acquisition
+   *
+   * Each cls call used to take the handler mutex several times (open the
+   * class, look up the method, fetch its flags), which serializes op worker
+   * threads on a global lock; batched call ops pay that for every entry in
+   * the op vector.  Returns -EPERM if the class is not allowed, a load
+   * error, or -ENOENT if the method does not exist.
+   */
+  int open_method(const string& cname, const string& mname,
+		  ClassData **pcls, ClassMethod **pmethod);
+
+
   ClassData *register_class(const char *cname);
   void unregister_class(ClassData *cls);
 
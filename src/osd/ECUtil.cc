@@ -2,6 +2,7 @@
 
 #include <errno.h>
 #include "include/encoding.h"
+#include "erasure-code/ErasureCode.h"
 #include "ECUtil.h"
 
 int ECUtil::decode(
@@ -112,17 +113,101 @@ int ECUtil::encode(
   if (logical_size == 0)
     return 0;
 
-  for (uint64_t i = 0; i < logical_size; i += sinfo.get_stripe_width()) {
+  // One aligned rebuild up front makes every per-stripe data chunk
+  // below a contiguous, aligned slice of the input, so the encode does
+  // not have to copy it.
+  in.rebuild_aligned_size_and_memory(sinfo.get_stripe_width(),
+				     ErasureCode::SIMD_ALIGN);
+
+  unsigned int k = ec_impl->get_data_chunk_count();
+  unsigned int km = ec_impl->get_chunk_count();
+  const vector<int> &mapping = ec_impl->get_chunk_mapping();
+  set<int> coding_shards;
+  for (unsigned int i = k; i < km; ++i)
+    coding_shards.insert(mapping.size() > i ? mapping[i] : (int)i);
+
+  uint64_t stripes = logical_size / sinfo.get_stripe_width();
+  uint64_t chunk_size = sinfo.get_chunk_size();
+
+  // One aligned buffer per coding shard covering every stripe, filled
+  // in place by encode_scatter; each shard of the transaction then
+  // carries a single contiguous buffer instead of one fragment per
+  // stripe, and no intermediate coding chunk copies are made.
+  map<int, bufferptr> coding_bufs;
+  if (chunk_size % ErasureCode::SIMD_ALIGN == 0) {
+    for (set<int>::const_iterator j = coding_shards.begin();
+	 j != coding_shards.end();
+	 ++j)
+      coding_bufs[*j] = bufferptr(
+	buffer::create_aligned(stripes * chunk_size,
+			       ErasureCode::SIMD_ALIGN));
+  }
+
+  if (stripes > 1 && !coding_bufs.empty()) {
+    // Batched path.  The coding buffers above already span every
+    // stripe, and the plugins encode whatever block size they are
+    // handed (the codes are byte-parallel, so a multi-stripe buffer
+    // encodes exactly like its stripes one by one).  Gather each data
+    // shard's strided stripe fragments into one contiguous aligned
+    // buffer and encode the whole operation with a single
+    // encode_chunks call, instead of stripes * (k+m) bufferlist round
+    // trips and as many encoder invocations.  Single-stripe writes
+    // keep the zero-copy path below.
     map<int, bufferlist> encoded;
-    bufferlist buf;
-    buf.substr_of(in, i, sinfo.get_stripe_width());
-    int r = ec_impl->encode(want, buf, &encoded);
+    vector<char*> data_ptr(k);
+    for (unsigned int i = 0; i < k; ++i) {
+      int shard = mapping.size() > i ? mapping[i] : (int)i;
+      bufferptr dbuf(buffer::create_aligned(stripes * chunk_size,
+					    ErasureCode::SIMD_ALIGN));
+      data_ptr[i] = dbuf.c_str();
+      encoded[shard].push_back(dbuf);
+    }
+    bufferlist::iterator it = in.begin();
+    for (uint64_t s = 0; s < stripes; ++s) {
+      for (unsigned int i = 0; i < k; ++i)
+	it.copy(chunk_size, data_ptr[i] + s * chunk_size);
+    }
+    for (set<int>::const_iterator j = coding_shards.begin();
+	 j != coding_shards.end();
+	 ++j)
+      encoded[*j].push_back(coding_bufs[*j]);
+    int r = ec_impl->encode_chunks(want, &encoded);
     assert(r == 0);
-    for (map<int, bufferlist>::iterator i = encoded.begin();
-	 i != encoded.end();
-	 ++i) {
-      assert(i->second.length() == sinfo.get_chunk_size());
-      (*out)[i->first].claim_append(i->second);
+    for (set<int>::const_iterator j = want.begin(); j != want.end(); ++j) {
+      assert(encoded.count(*j));
+      (*out)[*j].claim_append(encoded[*j]);
+    }
+  } else {
+    for (uint64_t i = 0, s = 0; i < logical_size;
+	 i += sinfo.get_stripe_width(), ++s) {
+      map<int, bufferlist> encoded;
+      for (map<int, bufferptr>::iterator j = coding_bufs.begin();
+	   j != coding_bufs.end();
+	   ++j)
+	encoded[j->first].push_back(
+	  bufferptr(j->second, s * chunk_size, chunk_size));
+      bufferlist buf;
+      buf.substr_of(in, i, sinfo.get_stripe_width());
+      int r;
+      if (!coding_bufs.empty())
+	r = ec_impl->encode_scatter(want, buf, &encoded);
+      else
+	r = ec_impl->encode(want, buf, &encoded);
+      assert(r == 0);
+      for (map<int, bufferlist>::iterator j = encoded.begin();
+	   j != encoded.end();
+	   ++j) {
+	assert(j->second.length() == chunk_size);
+	if (coding_bufs.count(j->first) == 0)
+	  (*out)[j->first].claim_append(j->second);
+      }
+    }
+
+    for (map<int, bufferptr>::iterator j = coding_bufs.begin();
+	 j != coding_bufs.end();
+	 ++j) {
+      if (want.count(j->first))
+	(*out)[j->first].push_back(j->second);
     }
   }
 
@@ -124,6 +124,7 @@
 #include "include/color.h"
 #include "perfglue/cpu_profiler.h"
 #include "perfglue/heap_profiler.h"
+#include "perfglue/stack_sampler.h"
 
 #include "osd/OpRequest.h"
 
@@ -261,9 +262,12 @@ OSDService::OSDService(OSD *osd) :
   recovery_ops_reserved(0),
   recovery_paused(false),
   map_cache_lock("OSDService::map_cache_lock"),
-  map_cache(cct, cct->_conf->osd_map_cache_size),
+  map_cache(cct, cct->_conf->osd_map_cache_size,
+	    cct->_conf->osd_map_cache_shards),
   map_bl_cache(cct->_conf->osd_map_cache_size),
   map_bl_inc_cache(cct->_conf->osd_map_cache_size),
+  map_bl_reencode_cache(cct->_conf->osd_map_cache_size),
+  map_bl_inc_reencode_cache(cct->_conf->osd_map_cache_size),
   in_progress_split_lock("OSDService::in_progress_split_lock"),
   stat_lock("OSDService::stat_lock"),
   full_status_lock("OSDService::full_status_lock"),
@@ -278,6 +282,7 @@ OSDService::OSDService(OSD *osd) :
 #endif
 {
   objecter->init();
+  refresh_op_limits();
 }
 
 OSDService::~OSDService()
@@ -285,6 +290,19 @@ OSDService::~OSDService()
   delete objecter;
 }
 
+void OSDService::refresh_op_limits()
+{
+  // take the generation first so a concurrent change makes the
+  // snapshot look stale rather than current
+  op_limits.config_gen = cct->_conf->get_generation();
+  op_limits.max_object_size = cct->_conf->osd_max_object_size;
+  op_limits.max_object_name_len = cct->_conf->osd_max_object_name_len;
+  op_limits.max_object_namespace_len = cct->_conf->osd_max_object_namespace_len;
+  op_limits.max_attr_name_len = cct->_conf->osd_max_attr_name_len;
+  op_limits.max_attr_size = cct->_conf->osd_max_attr_size;
+  op_limits.max_write_size = cct->_conf->osd_max_write_size;
+}
+
 void OSDService::_start_split(spg_t parent, const set<spg_t> &children)
 {
   for (set<spg_t>::const_iterator i = children.begin();
@@ -620,6 +638,21 @@ void OSDService::promote_throttle_recalibrate()
   uint64_t target_obj_sec = g_conf->osd_tier_promote_max_objects_sec;
   uint64_t target_bytes_sec = g_conf->osd_tier_promote_max_bytes_sec;
 
+  // back off when the base tier looks loaded: if proxied reads are
+  // taking longer than the configured knee, scale the rate targets
+  // down proportionally so promotions don't pile more work onto a
+  // base tier that is already behind.
+  double base_lat_ms = (double)proxy_read_lat_usec / 1000.0;
+  double knee_ms = g_conf->osd_tier_promote_base_read_lat_ms;
+  if (knee_ms > 0 && base_lat_ms > knee_ms) {
+    double scale = knee_ms / base_lat_ms;
+    target_obj_sec = (double)target_obj_sec * scale;
+    target_bytes_sec = (double)target_bytes_sec * scale;
+    dout(10) << __func__ << "  base tier read latency " << base_lat_ms
+	     << " ms > " << knee_ms << " ms, scaling targets by "
+	     << scale << dendl;
+  }
+
   unsigned min_prob = 1;
 
   uint64_t attempts, obj, bytes;
@@ -1189,18 +1222,102 @@ void OSDService::got_stop_ack()
   }
 }
 
+// true if a peer with these features needs maps reencoded from the
+// stored (full-feature) format
+static bool osdmap_needs_reencode(uint64_t features)
+{
+  return
+    (features & CEPH_FEATURE_PGID64) == 0 ||
+    (features & CEPH_FEATURE_PGPOOL3) == 0 ||
+    (features & CEPH_FEATURE_OSDENC) == 0 ||
+    (features & CEPH_FEATURE_OSDMAP_ENC) == 0;
+}
+
+// only the features above change the encoding; fold them into a
+// nibble beside the epoch to key the reencode caches
+static uint64_t map_bl_reencode_key(epoch_t e, uint64_t features)
+{
+  uint64_t sig = 0;
+  if (features & CEPH_FEATURE_PGID64)
+    sig |= 1;
+  if (features & CEPH_FEATURE_PGPOOL3)
+    sig |= 2;
+  if (features & CEPH_FEATURE_OSDENC)
+    sig |= 4;
+  if (features & CEPH_FEATURE_OSDMAP_ENC)
+    sig |= 8;
+  return ((uint64_t)e << 4) | sig;
+}
+
+bool OSDService::get_map_bl_with_features(epoch_t e, uint64_t features,
+					  bufferlist& bl)
+{
+  if (!osdmap_needs_reencode(features))
+    return get_map_bl(e, bl);
+
+  uint64_t key = map_bl_reencode_key(e, features);
+  if (map_bl_reencode_cache.lookup(key, &bl))
+    return true;
+
+  bufferlist orig;
+  if (!get_map_bl(e, orig))
+    return false;
+  OSDMap m;
+  m.decode(orig);
+  bl.clear();
+  m.encode(bl, features);
+  dout(10) << __func__ << " reencoded " << e << " for features " << features
+	   << ", " << bl.length() << " bytes" << dendl;
+  // racing reencodes of the same epoch are harmless; last one wins
+  map_bl_reencode_cache.add(key, bl);
+  return true;
+}
+
+bool OSDService::get_inc_map_bl_with_features(epoch_t e, uint64_t features,
+					      bufferlist& bl)
+{
+  if (!osdmap_needs_reencode(features))
+    return get_inc_map_bl(e, bl);
+
+  uint64_t key = map_bl_reencode_key(e, features);
+  if (map_bl_inc_reencode_cache.lookup(key, &bl))
+    return true;
+
+  bufferlist orig;
+  if (!get_inc_map_bl(e, orig))
+    return false;
+  OSDMap::Incremental inc;
+  bufferlist::iterator q = orig.begin();
+  inc.decode(q);
+  if (inc.fullmap.length()) {
+    // the embedded full map must be reencoded too
+    OSDMap f;
+    f.decode(inc.fullmap);
+    inc.fullmap.clear();
+    f.encode(inc.fullmap, features);
+  }
+  bl.clear();
+  inc.encode(bl, features);
+  dout(10) << __func__ << " reencoded " << e << " for features " << features
+	   << ", " << bl.length() << " bytes" << dendl;
+  map_bl_inc_reencode_cache.add(key, bl);
+  return true;
+}
+
 MOSDMap *OSDService::build_incremental_map_msg(epoch_t since, epoch_t to,
+                                               uint64_t features,
                                                OSDSuperblock& sblock)
 {
   MOSDMap *m = new MOSDMap(monc->get_fsid());
+  m->maps_pre_encoded = true;
   m->oldest_map = max_oldest_map;
   m->newest_map = sblock.newest_map;
 
   for (epoch_t e = to; e > since; e--) {
     bufferlist bl;
-    if (e > m->oldest_map && get_inc_map_bl(e, bl)) {
+    if (e > m->oldest_map && get_inc_map_bl_with_features(e, features, bl)) {
       m->incremental_maps[e].claim(bl);
-    } else if (get_map_bl(e, bl)) {
+    } else if (get_map_bl_with_features(e, features, bl)) {
       m->maps[e].claim(bl);
       break;
     } else {
@@ -1227,15 +1344,17 @@ void OSDService::send_incremental_map(epoch_t since, Connection *con,
   dout(10) << "send_incremental_map " << since << " -> " << to
            << " to " << con << " " << con->get_peer_addr() << dendl;
 
+  uint64_t features = con->get_features();
   MOSDMap *m = NULL;
   while (!m) {
     OSDSuperblock sblock(get_superblock());
     if (since < sblock.oldest_map) {
       // just send latest full map
       MOSDMap *m = new MOSDMap(monc->get_fsid());
+      m->maps_pre_encoded = true;
       m->oldest_map = max_oldest_map;
       m->newest_map = sblock.newest_map;
-      get_map_bl(to, m->maps[to]);
+      get_map_bl_with_features(to, features, m->maps[to]);
       send_map(m, con);
       return;
     }
@@ -1248,7 +1367,7 @@ void OSDService::send_incremental_map(epoch_t since, Connection *con,
 
     if (to - since > (epoch_t)cct->_conf->osd_map_message_max)
       to = since + cct->_conf->osd_map_message_max;
-    m = build_incremental_map_msg(since, to, sblock);
+    m = build_incremental_map_msg(since, to, features, sblock);
   }
   send_map(m, con);
 }
@@ -1330,7 +1449,8 @@ OSDMapRef OSDService::_add_map(OSDMap *o)
 
 OSDMapRef OSDService::try_get_map(epoch_t epoch)
 {
-  Mutex::Locker l(map_cache_lock);
+  // fast path: the cache shards carry their own locks, so taking a
+  // reference does not need (or contend on) map_cache_lock
   OSDMapRef retval = map_cache.lookup(epoch);
   if (retval) {
     dout(30) << "get_map " << epoch << " -cached" << dendl;
@@ -1339,6 +1459,17 @@ OSDMapRef OSDService::try_get_map(epoch_t epoch)
     }
     return retval;
   }
+
+  Mutex::Locker l(map_cache_lock);
+  // another thread may have loaded it while we took the lock
+  retval = map_cache.lookup(epoch);
+  if (retval) {
+    dout(30) << "get_map " << epoch << " -cached" << dendl;
+    if (logger) {
+      logger->inc(l_osd_map_cache_hit);
+    }
+    return retval;
+  }
   if (logger) {
     logger->inc(l_osd_map_cache_miss);
     epoch_t lb = map_cache.cached_key_lower_bound();
@@ -1655,6 +1786,8 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
   asok_hook(NULL),
   osd_compat(get_osd_compat_set()),
   osd_tp(cct, "OSD::osd_tp", "tp_osd", cct->_conf->osd_op_threads, "osd_op_threads"),
+  peering_tp(cct, "OSD::peering_tp", "tp_peering",
+	     cct->_conf->osd_peering_threads, "osd_peering_threads"),
   osd_op_tp(cct, "OSD::osd_op_tp", "tp_osd_tp",
     cct->_conf->osd_op_num_threads_per_shard * cct->_conf->osd_op_num_shards),
   disk_tp(cct, "OSD::disk_tp", "tp_osd_disk", cct->_conf->osd_disk_threads, "osd_disk_threads"),
@@ -1683,7 +1816,7 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
     this,
     cct->_conf->osd_op_thread_timeout,
     cct->_conf->osd_op_thread_suicide_timeout,
-    &osd_tp),
+    &peering_tp),
   map_lock("OSD::map_lock"),
   pg_map_lock("OSD::pg_map_lock"),
   last_pg_create_epoch(0),
@@ -1713,6 +1846,9 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
                                          cct->_conf->osd_op_log_threshold);
   op_tracker.set_history_size_and_duration(cct->_conf->osd_op_history_size,
                                            cct->_conf->osd_op_history_duration);
+  op_tracker.set_trace_sample_rate_and_size(
+    cct->_conf->osd_op_trace_sample_rate,
+    cct->_conf->osd_op_trace_history_size);
 }
 
 OSD::~OSD()
@@ -1765,6 +1901,12 @@ public:
     out.append(ss);
     return r;
   }
+  bool cacheable(const std::string& command) const {
+    // the heavyweight dumps monitoring agents poll; everything else
+    // either mutates state or is cheap enough to run every time
+    return command == "dump_historic_ops" ||
+      command == "dump_op_traces";
+  }
 };
 
 bool OSD::asok_command(string command, cmdmap_t& cmdmap, string format,
@@ -1797,6 +1939,10 @@ bool OSD::asok_command(string command, cmdmap_t& cmdmap, string format,
       ss << "op_tracker tracking is not enabled now, so no ops are tracked currently, even those get stuck. \
 	Please enable \"osd_enable_op_tracker\", and the tracker will start to track new ops received afterwards.";
     }
+  } else if (command == "dump_op_traces") {
+    if (!op_tracker.dump_op_traces(f)) {
+      ss << "op tracing is not enabled; set osd_op_trace_sample_rate";
+    }
   } else if (command == "dump_historic_ops") {
     if (!op_tracker.dump_historic_ops(f)) {
       ss << "op_tracker tracking is not enabled now, so no ops are tracked currently, even those get stuck. \
@@ -1919,6 +2065,27 @@ bool OSD::asok_command(string command, cmdmap_t& cmdmap, string format,
     f->dump_bool("success", success);
     f->dump_int("value", value);
     f->close_section();
+  } else if (command == "sampler start") {
+    int64_t hz = 100;
+    cmd_getval(cct, cmdmap, "hz", hz);
+    int r = stack_sampler_start(hz);
+    if (r < 0)
+      ss << "sampler: " << cpp_strerror(r);
+    else
+      ss << "sampler: started at " << hz << "hz";
+  } else if (command == "sampler stop") {
+    stack_sampler_stop();
+    ss << "sampler: stopped";
+  } else if (command == "sampler status") {
+    stack_sampler_status(f);
+  } else if (command == "sampler reset") {
+    stack_sampler_reset();
+    ss << "sampler: profile dropped";
+  } else if (command == "sampler dump") {
+    stack_sampler_dump(f);
+  } else if (command == "sampler flamegraph") {
+    // folded plain text, not json; bypass the formatter
+    stack_sampler_dump_flamegraph(ss);
   } else {
     assert(0 == "broken asok registration");
   }
@@ -2184,6 +2351,7 @@ int OSD::init()
   update_log_config();
 
   osd_tp.start();
+  peering_tp.start();
   osd_op_tp.start();
   disk_tp.start();
   command_tp.start();
@@ -2299,6 +2467,10 @@ void OSD::final_init()
 				     asok_hook,
 				     "show slowest recent ops");
   assert(r == 0);
+  r = admin_socket->register_command("dump_op_traces", "dump_op_traces",
+				     asok_hook,
+				     "show sampled per-op event timelines");
+  assert(r == 0);
   r = admin_socket->register_command("dump_op_pq_state", "dump_op_pq_state",
 				     asok_hook,
 				     "dump op priority queue state");
@@ -2337,6 +2509,38 @@ void OSD::final_init()
 				     "get malloc extension heap property");
   assert(r == 0);
 
+  r = admin_socket->register_command("sampler start",
+				     "sampler start " \
+				     "name=hz,type=CephInt,req=false",
+				     asok_hook,
+				     "start the in-process cpu stack sampler");
+  assert(r == 0);
+  r = admin_socket->register_command("sampler stop", "sampler stop",
+				     asok_hook,
+				     "stop the cpu stack sampler, keeping "
+				     "the profile gathered so far");
+  assert(r == 0);
+  r = admin_socket->register_command("sampler status", "sampler status",
+				     asok_hook,
+				     "show cpu stack sampler state and "
+				     "sample counts");
+  assert(r == 0);
+  r = admin_socket->register_command("sampler reset", "sampler reset",
+				     asok_hook,
+				     "drop the sampled profile");
+  assert(r == 0);
+  r = admin_socket->register_command("sampler dump", "sampler dump",
+				     asok_hook,
+				     "dump the sampled profile aggregated "
+				     "per subsystem and hottest stacks");
+  assert(r == 0);
+  r = admin_socket->register_command("sampler flamegraph",
+				     "sampler flamegraph",
+				     asok_hook,
+				     "dump the sampled profile as folded "
+				     "stacks for flamegraph.pl");
+  assert(r == 0);
+
 
   test_ops_hook = new TestOpsSocketHook(&(this->service), this->store);
   // Note: pools are CephString instead of CephPoolname because
@@ -2415,6 +2619,17 @@ void OSD::final_init()
     test_ops_hook,
      "Delay osd recovery by specified seconds");
   assert(r == 0);
+
+  // always-on profiling, if configured
+  if (cct->_conf->osd_stack_sampler_hz > 0) {
+    int ret = stack_sampler_start(cct->_conf->osd_stack_sampler_hz);
+    if (ret < 0)
+      derr << __func__ << " unable to start stack sampler: "
+	   << cpp_strerror(ret) << dendl;
+    else
+      dout(1) << __func__ << " stack sampler running at "
+	      << cct->_conf->osd_stack_sampler_hz << "hz" << dendl;
+  }
 }
 
 void OSD::create_logger()
@@ -2437,6 +2652,12 @@ void OSD::create_logger()
       "Latency of client operations (excluding queue time)");   // client op process latency
   osd_plb.add_time_avg(l_osd_op_prepare_lat, "op_prepare_latency",
       "Latency of client operations (excluding queue time and wait for finished)"); // client op prepare latency
+  osd_plb.add_time_hist(l_osd_op_lat_hist, "op_latency_histogram",
+      "Histogram of client operation latency (including queue time)");
+  osd_plb.add_time_hist(l_osd_op_queue_lat_hist, "op_queue_latency_histogram",
+      "Histogram of time spent queued before processing");
+  osd_plb.add_time_hist(l_osd_op_process_lat_hist, "op_process_latency_histogram",
+      "Histogram of client operation latency (excluding queue time)");
 
   osd_plb.add_u64_counter(l_osd_op_r,      "op_r",
       "Client read operations");        // client reads
@@ -2482,6 +2703,8 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(l_osd_sop_w,     "subop_w", "Replicated writes");          // replicated (client) writes
   osd_plb.add_u64_counter(l_osd_sop_w_inb, "subop_w_in_bytes", "Replicated written data size");      // replicated write in bytes
   osd_plb.add_time_avg(l_osd_sop_w_lat, "subop_w_latency", "Replicated writes latency");      // replicated write latency
+  osd_plb.add_time_hist(l_osd_sop_w_lat_hist, "subop_w_latency_histogram",
+      "Histogram of replicated write latency (queue plus local commit)");
   osd_plb.add_u64_counter(l_osd_sop_pull,     "subop_pull", "Suboperations pull requests");       // pull request
   osd_plb.add_time_avg(l_osd_sop_pull_lat, "subop_pull_latency", "Suboperations pull latency");
   osd_plb.add_u64_counter(l_osd_sop_push,     "subop_push", "Suboperations push messages");       // push (write)
@@ -2501,6 +2724,8 @@ void OSD::create_logger()
   osd_plb.add_u64(l_osd_history_alloc_num, "history_alloc_num");       // total ceph::buffer num in history
   osd_plb.add_u64(l_osd_cached_crc, "cached_crc", "Total number getting crc from crc_cache"); // total ceph::buffer buffer_cached_crc_adjusted
   osd_plb.add_u64(l_osd_cached_crc_adjusted, "cached_crc_adjusted", "Total number getting crc from crc_cache with adjusting"); // total ceph::buffer buffer_cached_crc_adjusted
+  osd_plb.add_u64(l_osd_buf_pool_hit, "buffer_pool_hit", "Aligned buffer allocations recycled from the per-thread pool");
+  osd_plb.add_u64(l_osd_buf_pool_miss, "buffer_pool_miss", "Aligned buffer allocations that went to the heap");
 
   osd_plb.add_u64(l_osd_pg, "numpg", "Placement groups");   // num pgs
   osd_plb.add_u64(l_osd_pg_primary, "numpg_primary", "Placement groups for which this osd is primary"); // num primary pgs
@@ -2515,6 +2740,8 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(l_osd_map_cache_miss, "osd_map_cache_miss", "osdmap cache miss");
   osd_plb.add_u64_counter(l_osd_map_cache_miss_low, "osd_map_cache_miss_low", "osdmap cache miss below cache lower bound");
   osd_plb.add_u64_avg(l_osd_map_cache_miss_low_avg, "osd_map_cache_miss_low_avg", "osdmap cache miss, avg distance below cache lower bound");
+  osd_plb.add_u64(l_osd_crush_cache_hit, "osd_crush_cache_hit", "pg mapping cache hits for the active osdmap");
+  osd_plb.add_u64(l_osd_crush_cache_miss, "osd_crush_cache_miss", "pg mapping cache misses for the active osdmap");
 
   osd_plb.add_u64(l_osd_stat_bytes, "stat_bytes", "OSD size");
   osd_plb.add_u64(l_osd_stat_bytes_used, "stat_bytes_used", "Used space");
@@ -2548,6 +2775,9 @@ void OSD::create_logger()
   osd_plb.add_time_avg(l_osd_tier_promote_lat, "osd_tier_promote_lat", "Object promote latency");
   osd_plb.add_time_avg(l_osd_tier_r_lat, "osd_tier_r_lat", "Object proxy read latency");
 
+  osd_plb.add_u64_counter(l_osd_snap_writes, "snap_writes", "Writes to objects with clones");
+  osd_plb.add_time_avg(l_osd_snap_write_lat, "snap_write_lat", "Snap bookkeeping latency on write");
+
   logger = osd_plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 }
@@ -2644,6 +2874,7 @@ int OSD::shutdown()
   cct->get_admin_socket()->unregister_command("ops");
   cct->get_admin_socket()->unregister_command("dump_blocked_ops");
   cct->get_admin_socket()->unregister_command("dump_historic_ops");
+  cct->get_admin_socket()->unregister_command("dump_op_traces");
   cct->get_admin_socket()->unregister_command("dump_op_pq_state");
   cct->get_admin_socket()->unregister_command("dump_blacklist");
   cct->get_admin_socket()->unregister_command("dump_watchers");
@@ -2651,6 +2882,12 @@ int OSD::shutdown()
   cct->get_admin_socket()->unregister_command("get_latest_osdmap");
   cct->get_admin_socket()->unregister_command("set_heap_property");
   cct->get_admin_socket()->unregister_command("get_heap_property");
+  cct->get_admin_socket()->unregister_command("sampler start");
+  cct->get_admin_socket()->unregister_command("sampler stop");
+  cct->get_admin_socket()->unregister_command("sampler status");
+  cct->get_admin_socket()->unregister_command("sampler reset");
+  cct->get_admin_socket()->unregister_command("sampler dump");
+  cct->get_admin_socket()->unregister_command("sampler flamegraph");
   delete asok_hook;
   asok_hook = NULL;
 
@@ -2673,8 +2910,12 @@ int OSD::shutdown()
   heartbeat_lock.Unlock();
   heartbeat_thread.join();
 
-  osd_tp.drain();
+  peering_tp.drain();
   peering_wq.clear();
+  peering_tp.stop();
+  dout(10) << "peering tp stopped" << dendl;
+
+  osd_tp.drain();
   osd_tp.stop();
   dout(10) << "osd tp stopped" << dendl;
 
@@ -3208,6 +3449,17 @@ PG *OSD::_lookup_lock_pg_with_map_lock_held(spg_t pgid)
   return pg;
 }
 
+void *OSD::PGLoadThread::entry()
+{
+  while (true) {
+    size_t i = (*next)++;
+    if (i >= pgids->size())
+      break;
+    osd->_load_pg((*pgids)[i], has_upgraded);
+  }
+  return NULL;
+}
+
 void OSD::load_pgs()
 {
   assert(osd_lock.is_locked());
@@ -3223,8 +3475,7 @@ void OSD::load_pgs()
     derr << "failed to list pgs: " << cpp_strerror(-r) << dendl;
   }
 
-  bool has_upgraded = false;
-
+  vector<spg_t> pgids;
   for (vector<coll_t>::iterator it = ls.begin();
        it != ls.end();
        ++it) {
@@ -3247,90 +3498,33 @@ void OSD::load_pgs()
       continue;
     }
 
-    dout(10) << "pgid " << pgid << " coll " << coll_t(pgid) << dendl;
-    bufferlist bl;
-    epoch_t map_epoch = 0;
-    int r = PG::peek_map_epoch(store, pgid, &map_epoch, &bl);
-    if (r < 0) {
-      derr << __func__ << " unable to peek at " << pgid << " metadata, skipping"
-	   << dendl;
-      continue;
-    }
+    pgids.push_back(pgid);
+  }
 
-    PG *pg = NULL;
-    if (map_epoch > 0) {
-      OSDMapRef pgosdmap = service.try_get_map(map_epoch);
-      if (!pgosdmap) {
-	if (!osdmap->have_pg_pool(pgid.pool())) {
-	  derr << __func__ << ": could not find map for epoch " << map_epoch
-	       << " on pg " << pgid << ", but the pool is not present in the "
-	       << "current map, so this is probably a result of bug 10617.  "
-	       << "Skipping the pg for now, you can use ceph-objectstore-tool "
-	       << "to clean it up later." << dendl;
-	  continue;
-	} else {
-	  derr << __func__ << ": have pgid " << pgid << " at epoch "
-	       << map_epoch << ", but missing map.  Crashing."
-	       << dendl;
-	  assert(0 == "Missing map in load_pgs");
-	}
-      }
-      pg = _open_lock_pg(pgosdmap, pgid);
-    } else {
-      pg = _open_lock_pg(osdmap, pgid);
+  // load the survivors in parallel; each pg only touches its own
+  // collection plus service state that is already guarded by its own
+  // lock, so the workers just claim pgids off a shared index
+  std::atomic<size_t> next(0);
+  std::atomic<bool> has_upgraded(false);
+  int nthreads = MIN((size_t)MAX(g_conf->osd_pg_load_threads, 1),
+		     pgids.size());
+  if (nthreads <= 1) {
+    for (vector<spg_t>::iterator it = pgids.begin(); it != pgids.end(); ++it)
+      _load_pg(*it, &has_upgraded);
+  } else {
+    dout(1) << "load_pgs loading " << pgids.size() << " pgs with "
+	    << nthreads << " threads" << dendl;
+    list<PGLoadThread*> threads;
+    for (int i = 0; i < nthreads; i++) {
+      PGLoadThread *t = new PGLoadThread(this, &pgids, &next, &has_upgraded);
+      t->create("pg_load");
+      threads.push_back(t);
     }
-    // there can be no waiters here, so we don't call wake_pg_waiters
-
-    pg->ch = store->open_collection(pg->coll);
-
-    // read pg state, log
-    pg->read_state(store, bl);
-
-    if (pg->must_upgrade()) {
-      if (!pg->can_upgrade()) {
-	derr << "PG needs upgrade, but on-disk data is too old; upgrade to"
-	     << " an older version first." << dendl;
-	assert(0 == "PG too old to upgrade");
-      }
-      if (!has_upgraded) {
-	derr << "PGs are upgrading" << dendl;
-	has_upgraded = true;
-      }
-      dout(10) << "PG " << pg->info.pgid
-	       << " must upgrade..." << dendl;
-      pg->upgrade(store);
-    }
-
-    service.init_splits_between(pg->info.pgid, pg->get_osdmap(), osdmap);
-
-    // generate state for PG's current mapping
-    int primary, up_primary;
-    vector<int> acting, up;
-    pg->get_osdmap()->pg_to_up_acting_osds(
-      pgid.pgid, &up, &up_primary, &acting, &primary);
-    pg->init_primary_up_acting(
-      up,
-      acting,
-      up_primary,
-      primary);
-    int role = OSDMap::calc_pg_role(whoami, pg->acting);
-    if (pg->pool.info.is_replicated() || role == pg->pg_whoami.shard)
-      pg->set_role(role);
-    else
-      pg->set_role(-1);
-
-    pg->reg_next_scrub();
-
-    PG::RecoveryCtx rctx(0, 0, 0, 0, 0, 0);
-    pg->handle_loaded(&rctx);
-
-    dout(10) << "load_pgs loaded " << *pg << " " << pg->pg_log.get_log() << dendl;
-    if (pg->pg_log.is_dirty()) {
-      ObjectStore::Transaction t;
-      pg->write_if_dirty(t);
-      store->apply_transaction(pg->osr.get(), std::move(t));
+    while (!threads.empty()) {
+      threads.front()->join();
+      delete threads.front();
+      threads.pop_front();
     }
-    pg->unlock();
   }
   {
     RWLock::RLocker l(pg_map_lock);
@@ -3353,6 +3547,92 @@ void OSD::load_pgs()
   build_past_intervals_parallel();
 }
 
+void OSD::_load_pg(spg_t pgid, std::atomic<bool> *has_upgraded)
+{
+  dout(10) << "pgid " << pgid << " coll " << coll_t(pgid) << dendl;
+  bufferlist bl;
+  epoch_t map_epoch = 0;
+  int r = PG::peek_map_epoch(store, pgid, &map_epoch, &bl);
+  if (r < 0) {
+    derr << __func__ << " unable to peek at " << pgid << " metadata, skipping"
+	 << dendl;
+    return;
+  }
+
+  PG *pg = NULL;
+  if (map_epoch > 0) {
+    OSDMapRef pgosdmap = service.try_get_map(map_epoch);
+    if (!pgosdmap) {
+      if (!osdmap->have_pg_pool(pgid.pool())) {
+	derr << __func__ << ": could not find map for epoch " << map_epoch
+	     << " on pg " << pgid << ", but the pool is not present in the "
+	     << "current map, so this is probably a result of bug 10617.  "
+	     << "Skipping the pg for now, you can use ceph-objectstore-tool "
+	     << "to clean it up later." << dendl;
+	return;
+      } else {
+	derr << __func__ << ": have pgid " << pgid << " at epoch "
+	     << map_epoch << ", but missing map.  Crashing."
+	     << dendl;
+	assert(0 == "Missing map in load_pgs");
+      }
+    }
+    pg = _open_lock_pg(pgosdmap, pgid);
+  } else {
+    pg = _open_lock_pg(osdmap, pgid);
+  }
+  // there can be no waiters here, so we don't call wake_pg_waiters
+
+  pg->ch = store->open_collection(pg->coll);
+
+  // read pg state, log
+  pg->read_state(store, bl);
+
+  if (pg->must_upgrade()) {
+    if (!pg->can_upgrade()) {
+      derr << "PG needs upgrade, but on-disk data is too old; upgrade to"
+	   << " an older version first." << dendl;
+      assert(0 == "PG too old to upgrade");
+    }
+    if (!has_upgraded->exchange(true)) {
+      derr << "PGs are upgrading" << dendl;
+    }
+    dout(10) << "PG " << pg->info.pgid
+	     << " must upgrade..." << dendl;
+    pg->upgrade(store);
+  }
+
+  service.init_splits_between(pg->info.pgid, pg->get_osdmap(), osdmap);
+
+  // generate state for PG's current mapping
+  int primary, up_primary;
+  vector<int> acting, up;
+  pg->get_osdmap()->pg_to_up_acting_osds(
+    pgid.pgid, &up, &up_primary, &acting, &primary);
+  pg->init_primary_up_acting(
+    up,
+    acting,
+    up_primary,
+    primary);
+  int role = OSDMap::calc_pg_role(whoami, pg->acting);
+  if (pg->pool.info.is_replicated() || role == pg->pg_whoami.shard)
+    pg->set_role(role);
+  else
+    pg->set_role(-1);
+
+  pg->reg_next_scrub();
+
+  PG::RecoveryCtx rctx(0, 0, 0, 0, 0, 0);
+  pg->handle_loaded(&rctx);
+
+  dout(10) << "load_pgs loaded " << *pg << " " << pg->pg_log.get_log() << dendl;
+  if (pg->pg_log.is_dirty()) {
+    ObjectStore::Transaction t;
+    pg->write_if_dirty(t);
+    store->apply_transaction(pg->osr.get(), std::move(t));
+  }
+  pg->unlock();
+}
 
 /*
  * build past_intervals efficiently on old, degraded, and buried
@@ -3950,6 +4230,71 @@ void OSD::maybe_update_heartbeat_peers()
     _remove_heartbeat_peer(*p);
   }
 
+  // too many on one host?  liveness info from co-located peers is
+  // largely redundant, so keep only a per-observer subset per remote
+  // host; because each osd keeps a different subset, every peer still
+  // retains failure reporters across the cluster.
+  if (cct->_conf->osd_heartbeat_peers_per_host > 0) {
+    unsigned per_host = cct->_conf->osd_heartbeat_peers_per_host;
+
+    // candidates are the current peers plus anyone we suppressed on an
+    // earlier pass (they come back if their host group shrinks)
+    set<int> candidates;
+    for (map<int,HeartbeatInfo>::iterator p = heartbeat_peers.begin();
+	 p != heartbeat_peers.end();
+	 ++p)
+      candidates.insert(p->first);
+    for (set<int>::iterator p = heartbeat_capped_peers.begin();
+	 p != heartbeat_capped_peers.end();
+	 ++p)
+      if (osdmap->is_up(*p))
+	candidates.insert(*p);
+    heartbeat_capped_peers.clear();
+
+    // group by the peer's hb back address, ignoring the port
+    map<entity_addr_t, vector<int> > by_host;
+    for (set<int>::iterator p = candidates.begin();
+	 p != candidates.end();
+	 ++p) {
+      if (want.count(*p))
+	continue;  // neighbors keep the set fully connected; never cap
+      entity_addr_t host = osdmap->get_hb_back_addr(*p);
+      host.set_port(0);
+      host.nonce = 0;
+      by_host[host].push_back(*p);
+    }
+
+    for (map<entity_addr_t, vector<int> >::iterator h = by_host.begin();
+	 h != by_host.end();
+	 ++h) {
+      vector<int>& group = h->second;
+      if (group.size() > per_host) {
+	// order varies per observer so different osds keep different
+	// representatives of the host
+	vector<pair<unsigned,int> > order;
+	for (vector<int>::iterator p = group.begin(); p != group.end(); ++p)
+	  order.push_back(
+	    make_pair((unsigned)((*p ^ (whoami << 16)) * 2654435761u), *p));
+	std::sort(order.begin(), order.end());
+	group.clear();
+	for (unsigned i = 0; i < order.size(); ++i) {
+	  if (i < per_host) {
+	    group.push_back(order[i].second);
+	  } else {
+	    dout(20) << " capping peer osd." << order[i].second
+		     << " on host " << h->first << dendl;
+	    heartbeat_capped_peers.insert(order[i].second);
+	    if (heartbeat_peers.count(order[i].second))
+	      _remove_heartbeat_peer(order[i].second);
+	  }
+	}
+      }
+      for (vector<int>::iterator p = group.begin(); p != group.end(); ++p)
+	if (!heartbeat_peers.count(*p))
+	  _add_heartbeat_peer(*p);
+    }
+  }
+
   dout(10) << "maybe_update_heartbeat_peers " << heartbeat_peers.size() << " peers, extras " << extras << dendl;
 }
 
@@ -3966,6 +4311,7 @@ void OSD::reset_heartbeat_peers()
     }
     heartbeat_peers.erase(heartbeat_peers.begin());
   }
+  heartbeat_capped_peers.clear();
   failure_queue.clear();
 }
 
@@ -4305,6 +4651,16 @@ void OSD::tick()
   logger->set(l_osd_history_alloc_num, buffer::get_history_alloc_num());
   logger->set(l_osd_cached_crc, buffer::get_cached_crc());
   logger->set(l_osd_cached_crc_adjusted, buffer::get_cached_crc_adjusted());
+  logger->set(l_osd_buf_pool_hit, buffer::get_aligned_pool_hits());
+  logger->set(l_osd_buf_pool_miss, buffer::get_aligned_pool_misses());
+
+  if (osdmap) {
+    // hit/miss totals for the active map's memoized pg mappings
+    uint64_t hits, misses;
+    osdmap->get_mapping_cache_stats(&hits, &misses);
+    logger->set(l_osd_crush_cache_hit, hits);
+    logger->set(l_osd_crush_cache_miss, misses);
+  }
 
   if (is_active() || is_waiting_for_healthy()) {
     maybe_update_heartbeat_peers();
@@ -5135,9 +5491,24 @@ void OSD::send_pg_stats(const utime_t &now)
       }
       pg->pg_stats_publish_lock.Lock();
       if (pg->pg_stats_publish_valid) {
-	m->pg_stat[pg->info.pgid.pgid] = pg->pg_stats_publish;
-	dout(25) << " sending " << pg->info.pgid << " " << pg->pg_stats_publish.reported_epoch << ":"
-		 << pg->pg_stats_publish.reported_seq << dendl;
+	if (cct->_conf->osd_mon_pg_stat_deltas &&
+	    pg->pg_stats_acked_valid &&
+	    pg_stat_delta_t::can_represent(pg->pg_stats_acked,
+					   pg->pg_stats_publish)) {
+	  pg_stat_delta_t& d = m->pg_stat_delta[pg->info.pgid.pgid];
+	  d.base_seq = pg->pg_stats_acked.reported_seq;
+	  d.take_from(pg->pg_stats_publish);
+	  dout(25) << " sending delta " << pg->info.pgid << " "
+		   << pg->pg_stats_publish.reported_epoch << ":"
+		   << pg->pg_stats_publish.reported_seq
+		   << " base " << d.base_seq << dendl;
+	} else {
+	  m->pg_stat[pg->info.pgid.pgid] = pg->pg_stats_publish;
+	  dout(25) << " sending " << pg->info.pgid << " " << pg->pg_stats_publish.reported_epoch << ":"
+		   << pg->pg_stats_publish.reported_seq << dendl;
+	}
+	pg->pg_stats_sent = pg->pg_stats_publish;
+	pg->pg_stats_sent_valid = true;
       } else {
 	dout(25) << " NOT sending " << pg->info.pgid << " " << pg->pg_stats_publish.reported_epoch << ":"
 		 << pg->pg_stats_publish.reported_seq << ", not valid" << dendl;
@@ -5193,6 +5564,18 @@ void OSD::handle_pg_stats_ack(MPGStatsAck *ack)
     if (ack->pg_stat.count(pg->info.pgid.pgid)) {
       pair<version_t,epoch_t> acked = ack->pg_stat[pg->info.pgid.pgid];
       pg->pg_stats_publish_lock.Lock();
+      if (pg->pg_stats_sent_valid &&
+	  acked.first == pg->pg_stats_sent.reported_seq &&
+	  acked.second == pg->pg_stats_sent.reported_epoch) {
+	// the mon applied this report; future reports may be encoded
+	// as deltas against it
+	pg->pg_stats_acked = pg->pg_stats_sent;
+	pg->pg_stats_acked_valid = true;
+      } else {
+	// the mon acked something other than what we last sent (e.g.
+	// it could not apply a delta); start over with a full report
+	pg->pg_stats_acked_valid = false;
+      }
       if (acked.first == pg->pg_stats_publish.reported_seq &&
 	  acked.second == pg->pg_stats_publish.reported_epoch) {
 	dout(25) << " ack on " << pg->info.pgid << " " << pg->pg_stats_publish.reported_epoch
@@ -5940,6 +6323,12 @@ void OSD::ms_fast_dispatch(Message *m)
     m->put();
     return;
   }
+  if (m->get_type() == CEPH_MSG_PING) {
+    // no lock, no state: not worth a dispatch queue round trip
+    dout(10) << "ping from " << m->get_source() << dendl;
+    m->put();
+    return;
+  }
   OpRequestRef op = op_tracker.create_request<OpRequest, Message*>(m);
   {
 #ifdef WITH_LTTNG
@@ -6273,6 +6662,8 @@ void OSD::_dispatch(Message *m)
   logger->set(l_osd_history_alloc_num, buffer::get_history_alloc_num());
   logger->set(l_osd_cached_crc, buffer::get_cached_crc());
   logger->set(l_osd_cached_crc_adjusted, buffer::get_cached_crc_adjusted());
+  logger->set(l_osd_buf_pool_hit, buffer::get_aligned_pool_hits());
+  logger->set(l_osd_buf_pool_miss, buffer::get_aligned_pool_misses());
 
   switch (m->get_type()) {
 
@@ -6750,10 +7141,18 @@ void OSD::handle_osd_map(MOSDMap *m)
 
       OSDMap *o = new OSDMap;
       if (e > 1) {
-	bufferlist obl;
-        bool got = get_map_bl(e - 1, obl);
-        assert(got);
-	o->decode(obl);
+	OSDMapRef prev = service.try_get_map(e - 1);
+	if (prev) {
+	  // share the unchanged sections with the previous epoch
+	  // instead of decoding the full map again; the crc check
+	  // below still validates the result
+	  o->deepish_copy_from(*prev);
+	} else {
+	  bufferlist obl;
+	  bool got = get_map_bl(e - 1, obl);
+	  assert(got);
+	  o->decode(obl);
+	}
       }
 
       OSDMap::Incremental inc;
@@ -7154,7 +7553,8 @@ bool OSD::advance_pg(
   epoch_t osd_epoch, PG *pg,
   ThreadPool::TPHandle &handle,
   PG::RecoveryCtx *rctx,
-  set<boost::intrusive_ptr<PG> > *new_pgs)
+  set<boost::intrusive_ptr<PG> > *new_pgs,
+  map<epoch_t, OSDMapRef> *advance_map_cache)
 {
   assert(pg->is_locked());
   epoch_t next_epoch = pg->get_osdmap()->get_epoch() + 1;
@@ -7175,7 +7575,16 @@ bool OSD::advance_pg(
   for (;
        next_epoch <= osd_epoch && next_epoch <= max;
        ++next_epoch) {
-    OSDMapRef nextmap = service.try_get_map(next_epoch);
+    OSDMapRef nextmap;
+    map<epoch_t, OSDMapRef>::iterator c =
+      advance_map_cache->find(next_epoch);
+    if (c != advance_map_cache->end()) {
+      nextmap = c->second;
+    } else {
+      nextmap = service.try_get_map(next_epoch);
+      if (nextmap)
+	(*advance_map_cache)[next_epoch] = nextmap;
+    }
     if (!nextmap) {
       dout(20) << __func__ << " missing map " << next_epoch << dendl;
       // make sure max is bumped up so that we can get past any
@@ -8701,15 +9110,25 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb )
   ShardData* sdata = shard_list[shard_index];
   assert(NULL != sdata);
   sdata->sdata_op_ordering_lock.Lock();
+  _drain_inbox(sdata);
   if (sdata->pqueue->empty()) {
     sdata->sdata_op_ordering_lock.Unlock();
     osd->cct->get_heartbeat_map()->reset_timeout(hb,
       osd->cct->_conf->threadpool_default_timeout, 0);
-    sdata->sdata_lock.Lock();
-    sdata->sdata_cond.WaitInterval(osd->cct, sdata->sdata_lock,
-      utime_t(osd->cct->_conf->threadpool_empty_queue_max_wait, 0));
-    sdata->sdata_lock.Unlock();
+    if (!_spin_for_work(sdata)) {
+      sdata->sdata_lock.Lock();
+      sdata->waiting_threads++;
+      // recheck after advertising ourselves as asleep: a producer that
+      // published before the increment may not have signalled
+      if (sdata->inbox_head.load() == nullptr) {
+	sdata->sdata_cond.WaitInterval(osd->cct, sdata->sdata_lock,
+	  utime_t(osd->cct->_conf->threadpool_empty_queue_max_wait, 0));
+      }
+      sdata->waiting_threads--;
+      sdata->sdata_lock.Unlock();
+    }
     sdata->sdata_op_ordering_lock.Lock();
+    _drain_inbox(sdata);
     if(sdata->pqueue->empty()) {
       sdata->sdata_op_ordering_lock.Unlock();
       return;
@@ -8775,29 +9194,74 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb )
   (item.first)->unlock();
 }
 
+void OSD::ShardedOpWQ::_drain_inbox(ShardData *sdata)
+{
+  assert(sdata->sdata_op_ordering_lock.is_locked());
+  ShardData::OpItem *head = sdata->inbox_head.exchange(nullptr);
+  if (!head)
+    return;
+  // the chain is newest first; reverse it to restore arrival order
+  ShardData::OpItem *rev = nullptr;
+  while (head) {
+    ShardData::OpItem *next = head->next;
+    head->next = rev;
+    rev = head;
+    head = next;
+  }
+  while (rev) {
+    pair<PGRef, PGQueueable> &item = rev->item;
+    unsigned priority = item.second.get_priority();
+    unsigned cost = item.second.get_cost();
+    if (priority >= osd->op_prio_cutoff)
+      sdata->pqueue->enqueue_strict(
+	item.second.get_owner(), priority, item);
+    else
+      sdata->pqueue->enqueue(
+	item.second.get_owner(),
+	priority, cost, item);
+    ShardData::OpItem *next = rev->next;
+    delete rev;
+    rev = next;
+  }
+}
+
+bool OSD::ShardedOpWQ::_spin_for_work(ShardData *sdata)
+{
+  uint64_t max_spin = osd->cct->_conf->osd_op_wq_max_spin;
+  if (!max_spin)
+    return false;
+  uint64_t limit = std::min(sdata->spin_limit.load(), max_spin);
+  for (uint64_t i = 0; i < limit; ++i) {
+    if (sdata->inbox_head.load() != nullptr) {
+      // hit while polling; reward with a larger budget next time
+      sdata->spin_limit.store(std::min(limit << 1, max_spin));
+      return true;
+    }
+  }
+  sdata->spin_limit.store(std::max(limit >> 1, (uint64_t)1));
+  return false;
+}
+
 void OSD::ShardedOpWQ::_enqueue(pair<PGRef, PGQueueable> item) {
   uint32_t shard_index =
     (item.first)->get_pgid().hash_to_shard(shard_list.size());
 
   ShardData* sdata = shard_list[shard_index];
   assert (NULL != sdata);
-  unsigned priority = item.second.get_priority();
-  unsigned cost = item.second.get_cost();
-  sdata->sdata_op_ordering_lock.Lock();
- 
-  if (priority >= osd->op_prio_cutoff)
-    sdata->pqueue->enqueue_strict(
-      item.second.get_owner(), priority, item);
-  else
-    sdata->pqueue->enqueue(
-      item.second.get_owner(),
-      priority, cost, item);
-  sdata->sdata_op_ordering_lock.Unlock();
 
-  sdata->sdata_lock.Lock();
-  sdata->sdata_cond.SignalOne();
-  sdata->sdata_lock.Unlock();
+  // lock-free fast path: publish onto the shard inbox and only touch
+  // sdata_lock if a worker is actually parked on the cond.  A lost race
+  // with a worker going to sleep is bounded by its WaitInterval timeout.
+  ShardData::OpItem *n = new ShardData::OpItem(std::move(item));
+  n->next = sdata->inbox_head.load();
+  while (!sdata->inbox_head.compare_exchange_weak(n->next, n))
+    ;
 
+  if (sdata->waiting_threads.load()) {
+    sdata->sdata_lock.Lock();
+    sdata->sdata_cond.SignalOne();
+    sdata->sdata_lock.Unlock();
+  }
 }
 
 void OSD::ShardedOpWQ::_enqueue_front(pair<PGRef, PGQueueable> item) {
@@ -8841,6 +9305,7 @@ void OSD::dequeue_op(
   utime_t now = ceph_clock_now(cct);
   op->set_dequeued_time(now);
   utime_t latency = now - op->get_req()->get_recv_stamp();
+  logger->tinc(l_osd_op_queue_lat_hist, latency);
   dout(10) << "dequeue_op " << op << " prio " << op->get_req()->get_priority()
 	   << " cost " << op->get_req()->get_cost()
 	   << " latency " << latency
@@ -8928,6 +9393,9 @@ void OSD::process_peering_events(
   OSDMapRef curmap = service.get_osdmap();
   PG::RecoveryCtx rctx = create_context();
   rctx.handle = &handle;
+  // every PG of the batch walks the same epochs; fetch each map from
+  // the map cache once instead of once per PG
+  map<epoch_t, OSDMapRef> advance_map_cache;
   for (list<PG*>::const_iterator i = pgs.begin();
        i != pgs.end();
        ++i) {
@@ -8939,7 +9407,8 @@ void OSD::process_peering_events(
       pg->unlock();
       continue;
     }
-    if (!advance_pg(curmap->get_epoch(), pg, handle, &rctx, &split_pgs)) {
+    if (!advance_pg(curmap->get_epoch(), pg, handle, &rctx, &split_pgs,
+		    &advance_map_cache)) {
       // we need to requeue the PG explicitly since we didn't actually
       // handle an event
       peering_wq.queue(pg);
@@ -8976,9 +9445,16 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_min_recovery_priority",
     "osd_op_complaint_time", "osd_op_log_threshold",
     "osd_op_history_size", "osd_op_history_duration",
+    "osd_op_trace_sample_rate", "osd_op_trace_history_size",
     "osd_enable_op_tracker",
     "osd_map_cache_size",
     "osd_map_max_advance",
+    "osd_max_object_size",
+    "osd_max_object_name_len",
+    "osd_max_object_namespace_len",
+    "osd_max_attr_name_len",
+    "osd_max_attr_size",
+    "osd_max_write_size",
     "osd_pg_epoch_persisted_max_stale",
     "osd_disk_thread_ioprio_class",
     "osd_disk_thread_ioprio_priority",
@@ -9020,6 +9496,12 @@ void OSD::handle_conf_change(const struct md_config_t *conf,
     op_tracker.set_history_size_and_duration(cct->_conf->osd_op_history_size,
                                              cct->_conf->osd_op_history_duration);
   }
+  if (changed.count("osd_op_trace_sample_rate") ||
+      changed.count("osd_op_trace_history_size")) {
+    op_tracker.set_trace_sample_rate_and_size(
+      cct->_conf->osd_op_trace_sample_rate,
+      cct->_conf->osd_op_trace_history_size);
+  }
   if (changed.count("osd_enable_op_tracker")) {
       op_tracker.set_tracking(cct->_conf->osd_enable_op_tracker);
   }
@@ -9027,6 +9509,14 @@ void OSD::handle_conf_change(const struct md_config_t *conf,
       changed.count("osd_disk_thread_ioprio_priority")) {
     set_disk_tp_priority();
   }
+  if (changed.count("osd_max_object_size") ||
+      changed.count("osd_max_object_name_len") ||
+      changed.count("osd_max_object_namespace_len") ||
+      changed.count("osd_max_attr_name_len") ||
+      changed.count("osd_max_attr_size") ||
+      changed.count("osd_max_write_size")) {
+    service.refresh_op_limits();
+  }
   if (changed.count("osd_map_cache_size")) {
     service.map_cache.set_size(cct->_conf->osd_map_cache_size);
     service.map_bl_cache.set_size(cct->_conf->osd_map_cache_size);
@@ -9202,23 +9692,18 @@ int OSD::init_op_flags(OpRequestRef& op)
 	bp.copy(iter->op.cls.method_len, mname);
 
 	ClassHandler::ClassData *cls;
-	int r = class_handler->open_class(cname, &cls);
+	ClassHandler::ClassMethod *method;
+	int r = class_handler->open_method(cname, mname, &cls, &method);
 	if (r) {
-	  derr << "class " << cname << " open got " << cpp_strerror(r) << dendl;
+	  derr << "class " << cname << " method " << mname << " open got "
+	       << cpp_strerror(r) << dendl;
 	  if (r == -ENOENT)
 	    r = -EOPNOTSUPP;
 	  else if (r != -EPERM) // propgate permission errors
 	    r = -EIO;
 	  return r;
 	}
-	int flags = cls->get_method_flags(mname.c_str());
-	if (flags < 0) {
-	  if (flags == -ENOENT)
-	    r = -EOPNOTSUPP;
-	  else
-	    r = flags;
-	  return r;
-	}
+	int flags = method->get_flags();
 	is_read = flags & CLS_METHOD_RD;
 	is_write = flags & CLS_METHOD_WR;
         bool is_promote = flags & CLS_METHOD_PROMOTE;
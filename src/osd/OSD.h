@@ -47,6 +47,7 @@ using namespace std;
 #include "common/sharedptr_registry.hpp"
 #include "common/WeightedPriorityQueue.h"
 #include "common/PrioritizedQueue.h"
+#include "common/MClockQueue.h"
 #include "messages/MOSDOp.h"
 #include "include/Spinlock.h"
 
@@ -62,6 +63,9 @@ enum {
   l_osd_op_lat,
   l_osd_op_process_lat,
   l_osd_op_prepare_lat,
+  l_osd_op_lat_hist,
+  l_osd_op_queue_lat_hist,
+  l_osd_op_process_lat_hist,
   l_osd_op_r,
   l_osd_op_r_outb,
   l_osd_op_r_lat,
@@ -87,6 +91,7 @@ enum {
   l_osd_sop_w,
   l_osd_sop_w_inb,
   l_osd_sop_w_lat,
+  l_osd_sop_w_lat_hist,
   l_osd_sop_pull,
   l_osd_sop_pull_lat,
   l_osd_sop_push,
@@ -105,6 +110,8 @@ enum {
   l_osd_history_alloc_num,
   l_osd_cached_crc,
   l_osd_cached_crc_adjusted,
+  l_osd_buf_pool_hit,
+  l_osd_buf_pool_miss,
 
   l_osd_pg,
   l_osd_pg_primary,
@@ -122,6 +129,9 @@ enum {
   l_osd_map_cache_miss_low,
   l_osd_map_cache_miss_low_avg,
 
+  l_osd_crush_cache_hit,
+  l_osd_crush_cache_miss,
+
   l_osd_stat_bytes,
   l_osd_stat_bytes_used,
   l_osd_stat_bytes_avail,
@@ -154,6 +164,9 @@ enum {
   l_osd_tier_promote_lat,
   l_osd_tier_r_lat,
 
+  l_osd_snap_writes,
+  l_osd_snap_write_lat,
+
   l_osd_last,
 };
 
@@ -409,6 +422,23 @@ public:
     RunVis v(osd, pg, handle);
     boost::apply_visitor(v, qvariant);
   }
+  /// scheduling class buckets for QoS-aware op queues
+  enum {
+    opclass_client = 0,
+    opclass_recovery,
+    opclass_scrub,
+    opclass_snaptrim,
+    opclass_max
+  };
+  unsigned get_scheduling_class() const {
+    if (boost::get<PGRecovery>(&qvariant))
+      return opclass_recovery;
+    if (boost::get<PGScrub>(&qvariant))
+      return opclass_scrub;
+    if (boost::get<PGSnapTrim>(&qvariant))
+      return opclass_snaptrim;
+    return opclass_client;
+  }
   unsigned get_priority() const { return priority; }
   int get_cost() const { return cost; }
   utime_t get_start_time() const { return start_time; }
@@ -442,6 +472,20 @@ public:
 
   void dequeue_pg(PG *pg, list<OpRequestRef> *dequeued);
 
+  // -- per-op limit snapshot --
+  // refreshed from the config observer (and at startup) so the op path
+  // reads one local struct instead of scattered md_config_t fields
+  struct {
+    uint64_t max_object_size;
+    uint32_t max_object_name_len;
+    uint32_t max_object_namespace_len;
+    uint32_t max_attr_name_len;
+    uint64_t max_attr_size;
+    int max_write_size;       ///< in MB
+    uint64_t config_gen;      ///< md_config_t generation of this snapshot
+  } op_limits;
+  void refresh_op_limits();
+
 private:
   // -- map epoch lower bound --
   Mutex pg_epoch_lock;
@@ -591,6 +635,7 @@ public:
   void send_map(class MOSDMap *m, Connection *con);
   void send_incremental_map(epoch_t since, Connection *con, OSDMapRef& osdmap);
   MOSDMap *build_incremental_map_msg(epoch_t from, epoch_t to,
+                                       uint64_t features,
                                        OSDSuperblock& superblock);
   bool should_share_map(entity_name_t name, Connection *con, epoch_t epoch,
                         const OSDMapRef& osdmap, const epoch_t *sent_epoch_p);
@@ -821,6 +866,7 @@ private:
   PromoteCounter promote_counter;
   utime_t last_recalibrate;
   unsigned long promote_max_objects, promote_max_bytes;
+  std::atomic<uint64_t> proxy_read_lat_usec{0}; ///< decayed avg proxy read latency
 
 public:
   bool promote_throttle() {
@@ -839,6 +885,11 @@ public:
   void promote_finish(uint64_t bytes) {
     promote_counter.finish(bytes);
   }
+  void record_proxy_read_latency(const utime_t& lat) {
+    // NOTE: lockless!  a torn update just perturbs the decayed average.
+    uint64_t cur = proxy_read_lat_usec;
+    proxy_read_lat_usec = (cur * 7 + lat.to_nsec() / 1000) / 8;
+  }
   void promote_throttle_recalibrate();
 
   // -- Objecter, for tiering reads/writes from/to other OSDs --
@@ -848,7 +899,7 @@ public:
 
   // -- Watch --
   Mutex watch_lock;
-  SafeTimer watch_timer;
+  TimerWheel watch_timer;
   uint64_t next_notif_id;
   uint64_t get_next_id(epoch_t cur_epoch) {
     Mutex::Locker l(watch_lock);
@@ -987,11 +1038,18 @@ public:
     op_wq.queue(to_queue);
   }
 
-  // osd map cache (past osd maps)
+  // osd map cache (past osd maps).  the cache itself is sharded and
+  // internally locked; map_cache_lock only serializes the miss path
+  // and the (non-thread-safe) encoded-map caches below
   Mutex map_cache_lock;
-  SharedLRU<epoch_t, const OSDMap> map_cache;
+  ShardedSharedLRU<epoch_t, const OSDMap> map_cache;
   SimpleLRU<epoch_t, bufferlist> map_bl_cache;
   SimpleLRU<epoch_t, bufferlist> map_bl_inc_cache;
+  // encodings for peers missing (some of) the significant osdmap
+  // encoding features, keyed on epoch + feature signature so each
+  // down-level format is reencoded once and then shared zero-copy
+  SimpleLRU<uint64_t, bufferlist> map_bl_reencode_cache;
+  SimpleLRU<uint64_t, bufferlist> map_bl_inc_reencode_cache;
 
   OSDMapRef try_get_map(epoch_t e);
   OSDMapRef get_map(epoch_t e) {
@@ -1025,6 +1083,12 @@ public:
   void _add_map_inc_bl(epoch_t e, bufferlist& bl);
   bool get_inc_map_bl(epoch_t e, bufferlist& bl);
 
+  /// like get_map_bl, but reencoded (and cached) for down-level peers
+  bool get_map_bl_with_features(epoch_t e, uint64_t features, bufferlist& bl);
+  /// like get_inc_map_bl, but reencoded (and cached) for down-level peers
+  bool get_inc_map_bl_with_features(epoch_t e, uint64_t features,
+				    bufferlist& bl);
+
   void clear_map_bl_cache_pins(epoch_t e);
 
   void need_heartbeat_peer_update();
@@ -1368,6 +1432,7 @@ public:
 private:
 
   ThreadPool osd_tp;
+  ThreadPool peering_tp;
   ShardedThreadPool osd_op_tp;
   ThreadPool disk_tp;
   ThreadPool command_tp;
@@ -1632,6 +1697,7 @@ private:
   Mutex heartbeat_update_lock; // orders under heartbeat_lock
   bool heartbeat_need_update;   ///< true if we need to refresh our heartbeat peers
   map<int,HeartbeatInfo> heartbeat_peers;  ///< map of osd id to HeartbeatInfo
+  set<int> heartbeat_capped_peers;  ///< peers suppressed by osd_heartbeat_peers_per_host
   utime_t last_mon_heartbeat;
   Messenger *hbclient_messenger;
   Messenger *hb_front_server_messenger;
@@ -1731,7 +1797,8 @@ private:
   // -- op queue --
   enum io_queue {
     prioritized,
-    weightedpriority};
+    weightedpriority,
+    mclock};
   const io_queue op_queue;
   const unsigned int op_prio_cutoff;
 
@@ -1742,6 +1809,25 @@ private:
       Mutex sdata_lock;
       Cond sdata_cond;
       Mutex sdata_op_ordering_lock;
+
+      /// lock-free MPSC inbox: producers publish a newly queued op with a
+      /// single compare-and-swap and never take a shard lock.  The chain is
+      /// LIFO; consumers take the whole thing at once under
+      /// sdata_op_ordering_lock (which makes them the single consumer),
+      /// restore arrival order and batch it into pqueue.
+      struct OpItem {
+	pair<PGRef, PGQueueable> item;
+	OpItem *next;
+	explicit OpItem(pair<PGRef, PGQueueable> &&i)
+	  : item(std::move(i)), next(nullptr) {}
+      };
+      std::atomic<OpItem*> inbox_head;
+      /// workers parked on sdata_cond; producers only signal when nonzero
+      std::atomic<uint32_t> waiting_threads;
+      /// adaptive busy-poll budget, grown on hits and shrunk on misses,
+      /// capped by osd_op_wq_max_spin
+      std::atomic<uint64_t> spin_limit;
+
       map<PG*, list<PGQueueable> > pg_for_processing;
       std::unique_ptr<OpQueue< pair<PGRef, PGQueueable>, entity_inst_t>> pqueue;
       ShardData(
@@ -1749,7 +1835,8 @@ private:
 	uint64_t max_tok_per_prio, uint64_t min_cost, CephContext *cct,
 	io_queue opqueue)
 	: sdata_lock(lock_name.c_str(), false, true, false, cct),
-	  sdata_op_ordering_lock(ordering_lock.c_str(), false, true, false, cct) {
+	  sdata_op_ordering_lock(ordering_lock.c_str(), false, true, false, cct),
+	  inbox_head(nullptr), waiting_threads(0), spin_limit(1) {
 	    if (opqueue == weightedpriority) {
 	      pqueue = std::unique_ptr
 		<WeightedPriorityQueue< pair<PGRef, PGQueueable>, entity_inst_t>>(
@@ -1760,14 +1847,55 @@ private:
 		<PrioritizedQueue< pair<PGRef, PGQueueable>, entity_inst_t>>(
 		  new PrioritizedQueue< pair<PGRef, PGQueueable>, entity_inst_t>(
 		    max_tok_per_prio, min_cost));
+	    } else if (opqueue == mclock) {
+	      // class order must match PGQueueable's scheduling classes
+	      std::vector<mclock_qos_spec> specs(PGQueueable::opclass_max);
+	      specs[PGQueueable::opclass_client] = mclock_qos_spec{
+		cct->_conf->osd_op_queue_mclock_client_res,
+		cct->_conf->osd_op_queue_mclock_client_wgt,
+		cct->_conf->osd_op_queue_mclock_client_lim};
+	      specs[PGQueueable::opclass_recovery] = mclock_qos_spec{
+		cct->_conf->osd_op_queue_mclock_recovery_res,
+		cct->_conf->osd_op_queue_mclock_recovery_wgt,
+		cct->_conf->osd_op_queue_mclock_recovery_lim};
+	      specs[PGQueueable::opclass_scrub] = mclock_qos_spec{
+		cct->_conf->osd_op_queue_mclock_scrub_res,
+		cct->_conf->osd_op_queue_mclock_scrub_wgt,
+		cct->_conf->osd_op_queue_mclock_scrub_lim};
+	      specs[PGQueueable::opclass_snaptrim] = mclock_qos_spec{
+		cct->_conf->osd_op_queue_mclock_snaptrim_res,
+		cct->_conf->osd_op_queue_mclock_snaptrim_wgt,
+		cct->_conf->osd_op_queue_mclock_snaptrim_lim};
+	      pqueue = std::unique_ptr
+		<MClockQueue< pair<PGRef, PGQueueable>, entity_inst_t>>(
+		  new MClockQueue< pair<PGRef, PGQueueable>, entity_inst_t>(
+		    specs,
+		    [](const pair<PGRef, PGQueueable> &item) {
+		      return item.second.get_scheduling_class();
+		    }));
 	    }
 	  }
+      ~ShardData() {
+	OpItem *p = inbox_head.load();
+	while (p) {
+	  OpItem *next = p->next;
+	  delete p;
+	  p = next;
+	}
+      }
     };
     
     vector<ShardData*> shard_list;
     OSD *osd;
     uint32_t num_shards;
 
+    /// move everything in the shard's inbox into pqueue, oldest first;
+    /// caller must hold sdata_op_ordering_lock
+    void _drain_inbox(ShardData *sdata);
+    /// busy-poll the inbox for up to the shard's adaptive spin budget;
+    /// returns true if work arrived while spinning
+    bool _spin_for_work(ShardData *sdata);
+
   public:
     ShardedOpWQ(uint32_t pnum_shards, OSD *o, time_t ti, time_t si, ShardedThreadPool* tp):
       ShardedThreadPool::ShardedWQ < pair <PGRef, PGQueueable> >(ti, si, tp),
@@ -1864,6 +1992,9 @@ private:
 
       Pred f(pg, dequeued);
 
+      // pull any not-yet-drained arrivals in so the filter sees them too
+      _drain_inbox(sdata);
+
       // items in pqueue are behind items in pg_for_processing
       sdata->pqueue->remove_by_filter(f);
 
@@ -1887,7 +2018,7 @@ private:
       ShardData* sdata = shard_list[shard_index];
       assert(NULL != sdata);
       Mutex::Locker l(sdata->sdata_op_ordering_lock);
-      return sdata->pqueue->empty();
+      return sdata->pqueue->empty() && sdata->inbox_head.load() == nullptr;
     }
   } op_shardedwq;
 
@@ -1987,7 +2118,8 @@ private:
     epoch_t advance_to, PG *pg,
     ThreadPool::TPHandle &handle,
     PG::RecoveryCtx *rctx,
-    set<boost::intrusive_ptr<PG> > *split_pgs
+    set<boost::intrusive_ptr<PG> > *split_pgs,
+    map<epoch_t, OSDMapRef> *advance_map_cache ///< shared by a peering batch
   );
   void consume_map();
   void activate_map();
@@ -2069,6 +2201,20 @@ protected:
     PG::CephPeeringEvtRef evt);
   
   void load_pgs();
+  void _load_pg(spg_t pgid, std::atomic<bool> *has_upgraded);
+
+  /// worker loading pgs at startup; claims pgids off a shared index
+  struct PGLoadThread : public Thread {
+    OSD *osd;
+    const vector<spg_t> *pgids;
+    std::atomic<size_t> *next;
+    std::atomic<bool> *has_upgraded;
+    PGLoadThread(OSD *o, const vector<spg_t> *p, std::atomic<size_t> *n,
+		 std::atomic<bool> *u)
+      : osd(o), pgids(p), next(n), has_upgraded(u) {}
+    void *entry();
+  };
+
   void build_past_intervals_parallel();
 
   /// project pg history from from to now
@@ -2363,6 +2509,7 @@ protected:
   bool ms_can_fast_dispatch_any() const { return true; }
   bool ms_can_fast_dispatch(Message *m) const {
     switch (m->get_type()) {
+    case CEPH_MSG_PING:
     case CEPH_MSG_OSD_OP:
     case MSG_OSD_SUBOP:
     case MSG_OSD_REPOP:
@@ -2404,6 +2551,8 @@ protected:
       return (rand() % 2 < 1) ? prioritized : weightedpriority;
     } else if (cct->_conf->osd_op_queue == "wpq") {
       return weightedpriority;
+    } else if (cct->_conf->osd_op_queue == "mclock") {
+      return mclock;
     } else {
       return prioritized;
     }
@@ -415,7 +415,7 @@ void OSDMap::Incremental::encode(bufferlist& bl, uint64_t features) const
   ENCODE_START(8, 7, bl);
 
   {
-    ENCODE_START(3, 1, bl); // client-usable data
+    ENCODE_START(4, 1, bl); // client-usable data
     ::encode(fsid, bl);
     ::encode(epoch, bl);
     ::encode(modified, bl);
@@ -436,6 +436,7 @@ void OSDMap::Incremental::encode(bufferlist& bl, uint64_t features) const
     ::encode(new_primary_affinity, bl);
     ::encode(new_erasure_code_profiles, bl);
     ::encode(old_erasure_code_profiles, bl);
+    ::encode(new_pg_upmap, bl);
     ENCODE_FINISH(bl); // client-usable data
   }
 
@@ -597,7 +598,7 @@ void OSDMap::Incremental::decode(bufferlist::iterator& bl)
     return;
   }
   {
-    DECODE_START(3, bl); // client-usable data
+    DECODE_START(4, bl); // client-usable data
     ::decode(fsid, bl);
     ::decode(epoch, bl);
     ::decode(modified, bl);
@@ -626,6 +627,10 @@ void OSDMap::Incremental::decode(bufferlist::iterator& bl)
       new_erasure_code_profiles.clear();
       old_erasure_code_profiles.clear();
     }
+    if (struct_v >= 4)
+      ::decode(new_pg_upmap, bl);
+    else
+      new_pg_upmap.clear();
     DECODE_FINISH(bl); // client-usable data
   }
 
@@ -789,6 +794,22 @@ void OSDMap::Incremental::dump(Formatter *f) const
   }
   f->close_section(); // primary_temp
 
+  f->open_array_section("new_pg_upmap");
+  for (map<pg_t,vector<int32_t> >::const_iterator p = new_pg_upmap.begin();
+       p != new_pg_upmap.end();
+       ++p) {
+    f->open_object_section("pg");
+    f->dump_stream("pgid") << p->first;
+    f->open_array_section("osds");
+    for (vector<int32_t>::const_iterator q = p->second.begin();
+	 q != p->second.end();
+	 ++q)
+      f->dump_int("osd", *q);
+    f->close_section();
+    f->close_section();
+  }
+  f->close_section();
+
   f->open_array_section("new_up_thru");
   for (map<int32_t,uint32_t>::const_iterator p = new_up_thru.begin(); p != new_up_thru.end(); ++p) {
     f->open_object_section("osd");
@@ -910,6 +931,10 @@ void OSDMap::get_blacklist(list<pair<entity_addr_t,utime_t> > *bl) const
 
 void OSDMap::set_max_osd(int m)
 {
+  _cow_osd_addrs();
+  _cow_osd_uuid();
+  _cow_osd_primary_affinity();
+  _reset_mapping_cache();
   int o = max_osd;
   max_osd = m;
   osd_state.resize(m);
@@ -1119,58 +1144,73 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
 
   int diff = 0;
 
-  // do addrs match?
-  if (o->max_osd != n->max_osd)
-    diff++;
-  for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
-    if ( n->osd_addrs->client_addr[i] &&  o->osd_addrs->client_addr[i] &&
-	*n->osd_addrs->client_addr[i] == *o->osd_addrs->client_addr[i])
-      n->osd_addrs->client_addr[i] = o->osd_addrs->client_addr[i];
-    else
+  // do addrs match?  (sections left untouched by a CoW incremental
+  // apply are already pointer-equal; skip the deep comparisons)
+  if (n->osd_addrs != o->osd_addrs) {
+    if (o->max_osd != n->max_osd)
       diff++;
-    if ( n->osd_addrs->cluster_addr[i] &&  o->osd_addrs->cluster_addr[i] &&
-	*n->osd_addrs->cluster_addr[i] == *o->osd_addrs->cluster_addr[i])
-      n->osd_addrs->cluster_addr[i] = o->osd_addrs->cluster_addr[i];
-    else
-      diff++;
-    if ( n->osd_addrs->hb_back_addr[i] &&  o->osd_addrs->hb_back_addr[i] &&
-	*n->osd_addrs->hb_back_addr[i] == *o->osd_addrs->hb_back_addr[i])
-      n->osd_addrs->hb_back_addr[i] = o->osd_addrs->hb_back_addr[i];
-    else
-      diff++;
-    if ( n->osd_addrs->hb_front_addr[i] &&  o->osd_addrs->hb_front_addr[i] &&
-	*n->osd_addrs->hb_front_addr[i] == *o->osd_addrs->hb_front_addr[i])
-      n->osd_addrs->hb_front_addr[i] = o->osd_addrs->hb_front_addr[i];
-    else
-      diff++;
-  }
-  if (diff == 0) {
-    // zoinks, no differences at all!
-    n->osd_addrs = o->osd_addrs;
+    for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
+      if ( n->osd_addrs->client_addr[i] &&  o->osd_addrs->client_addr[i] &&
+	  *n->osd_addrs->client_addr[i] == *o->osd_addrs->client_addr[i])
+	n->osd_addrs->client_addr[i] = o->osd_addrs->client_addr[i];
+      else
+	diff++;
+      if ( n->osd_addrs->cluster_addr[i] &&  o->osd_addrs->cluster_addr[i] &&
+	  *n->osd_addrs->cluster_addr[i] == *o->osd_addrs->cluster_addr[i])
+	n->osd_addrs->cluster_addr[i] = o->osd_addrs->cluster_addr[i];
+      else
+	diff++;
+      if ( n->osd_addrs->hb_back_addr[i] &&  o->osd_addrs->hb_back_addr[i] &&
+	  *n->osd_addrs->hb_back_addr[i] == *o->osd_addrs->hb_back_addr[i])
+	n->osd_addrs->hb_back_addr[i] = o->osd_addrs->hb_back_addr[i];
+      else
+	diff++;
+      if ( n->osd_addrs->hb_front_addr[i] &&  o->osd_addrs->hb_front_addr[i] &&
+	  *n->osd_addrs->hb_front_addr[i] == *o->osd_addrs->hb_front_addr[i])
+	n->osd_addrs->hb_front_addr[i] = o->osd_addrs->hb_front_addr[i];
+      else
+	diff++;
+    }
+    if (diff == 0) {
+      // zoinks, no differences at all!
+      n->osd_addrs = o->osd_addrs;
+    }
   }
 
   // does crush match?
-  bufferlist oc, nc;
-  ::encode(*o->crush, oc);
-  ::encode(*n->crush, nc);
-  if (oc.contents_equal(nc)) {
-    n->crush = o->crush;
+  if (n->crush != o->crush) {
+    bufferlist oc, nc;
+    ::encode(*o->crush, oc);
+    ::encode(*n->crush, nc);
+    if (oc.contents_equal(nc)) {
+      n->crush = o->crush;
+    }
   }
 
   // does pg_temp match?
-  if (o->pg_temp->size() == n->pg_temp->size()) {
+  if (n->pg_temp != o->pg_temp &&
+      o->pg_temp->size() == n->pg_temp->size()) {
     if (*o->pg_temp == *n->pg_temp)
       n->pg_temp = o->pg_temp;
   }
 
   // does primary_temp match?
-  if (o->primary_temp->size() == n->primary_temp->size()) {
+  if (n->primary_temp != o->primary_temp &&
+      o->primary_temp->size() == n->primary_temp->size()) {
     if (*o->primary_temp == *n->primary_temp)
       n->primary_temp = o->primary_temp;
   }
 
+  // does pg_upmap match?
+  if (n->pg_upmap != o->pg_upmap &&
+      o->pg_upmap->size() == n->pg_upmap->size()) {
+    if (*o->pg_upmap == *n->pg_upmap)
+      n->pg_upmap = o->pg_upmap;
+  }
+
   // do uuids match?
-  if (o->osd_uuid->size() == n->osd_uuid->size() &&
+  if (n->osd_uuid != o->osd_uuid &&
+      o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
     n->osd_uuid = o->osd_uuid;
 }
@@ -1183,6 +1223,7 @@ void OSDMap::clean_temps(CephContext *cct,
   tmpmap.deepish_copy_from(osdmap);
   tmpmap.apply_incremental(*pending_inc);
 
+  vector<pg_t> check_pgs;
   for (map<pg_t,vector<int32_t> >::iterator p = tmpmap.pg_temp->begin();
        p != tmpmap.pg_temp->end();
        ++p) {
@@ -1209,17 +1250,24 @@ void OSDMap::clean_temps(CephContext *cct,
       pending_inc->new_pg_temp[p->first].clear();
       continue;
     }
-    // redundant pg_temp?
-    vector<int> raw_up;
-    int primary;
-    tmpmap.pg_to_raw_up(p->first, &raw_up, &primary);
-    if (raw_up == p->second) {
-      ldout(cct, 10) << __func__ << "  removing pg_temp " << p->first << " "
-		     << p->second << " that matches raw_up mapping" << dendl;
-      if (osdmap.pg_temp->count(p->first))
-	pending_inc->new_pg_temp[p->first].clear();
+    // candidate for the redundant-pg_temp check below
+    check_pgs.push_back(p->first);
+  }
+
+  // redundant pg_temps?  the candidates are sorted by pool, so each
+  // pool's crush rule is evaluated in a single batched pass.
+  vector<vector<int> > raw_ups;
+  vector<int> raw_primaries;
+  tmpmap.pg_to_raw_up_batch(check_pgs, &raw_ups, &raw_primaries);
+  for (unsigned i = 0; i < check_pgs.size(); ++i) {
+    pg_t pgid = check_pgs[i];
+    if (raw_ups[i] == (*tmpmap.pg_temp)[pgid]) {
+      ldout(cct, 10) << __func__ << "  removing pg_temp " << pgid << " "
+		     << raw_ups[i] << " that matches raw_up mapping" << dendl;
+      if (osdmap.pg_temp->count(pgid))
+	pending_inc->new_pg_temp[pgid].clear();
       else
-	pending_inc->new_pg_temp.erase(p->first);
+	pending_inc->new_pg_temp.erase(pgid);
     }
   }
   for (map<pg_t,int32_t>::iterator p = tmpmap.primary_temp->begin();
@@ -1250,6 +1298,131 @@ void OSDMap::clean_temps(CephContext *cct,
   }
 }
 
+int OSDMap::calc_pg_upmaps(CephContext *cct, int max,
+			   const set<int64_t>& pools,
+			   Incremental *pending_inc)
+{
+  ldout(cct, 10) << __func__ << " max " << max << dendl;
+
+  OSDMap tmp;
+  tmp.deepish_copy_from(*this);
+
+  // current placements per osd; every existing+in osd is a candidate
+  // target even if it currently holds nothing
+  map<int,set<pg_t> > pgs_by_osd;
+  unsigned total = 0;
+  for (int o = 0; o < tmp.get_max_osd(); ++o) {
+    if (tmp.exists(o) && tmp.is_in(o))
+      pgs_by_osd[o];
+  }
+  for (map<int64_t,pg_pool_t>::const_iterator p = tmp.pools.begin();
+       p != tmp.pools.end();
+       ++p) {
+    if (!pools.empty() && !pools.count(p->first))
+      continue;
+    for (unsigned ps = 0; ps < p->second.get_pg_num(); ++ps) {
+      pg_t pg(ps, p->first);
+      vector<int> up;
+      int primary;
+      tmp.pg_to_raw_up(pg, &up, &primary);
+      for (vector<int>::iterator q = up.begin(); q != up.end(); ++q) {
+	if (*q != CRUSH_ITEM_NONE) {
+	  pgs_by_osd[*q].insert(pg);
+	  ++total;
+	}
+      }
+    }
+  }
+  if (pgs_by_osd.empty() || total == 0)
+    return 0;
+
+  int num = 0;
+  while (num < max) {
+    // fullest and emptiest osds
+    int over = -1, under = -1;
+    size_t over_n = 0, under_n = total;
+    for (map<int,set<pg_t> >::iterator p = pgs_by_osd.begin();
+	 p != pgs_by_osd.end();
+	 ++p) {
+      if (over < 0 || p->second.size() > over_n) {
+	over = p->first;
+	over_n = p->second.size();
+      }
+      if (under < 0 || p->second.size() < under_n) {
+	under = p->first;
+	under_n = p->second.size();
+      }
+    }
+    if (over < 0 || under < 0 || over_n <= under_n + 1)
+      break;  // balanced (or as close as a single move can get)
+
+    int uparent;
+    if (tmp.crush->get_immediate_parent_id(under, &uparent) < 0)
+      break;
+
+    // move one of over's pgs to under
+    bool moved = false;
+    for (set<pg_t>::iterator q = pgs_by_osd[over].begin();
+	 q != pgs_by_osd[over].end();
+	 ++q) {
+      pg_t pg = *q;
+      if (tmp.pg_upmap->count(pg))
+	continue;  // one override per pg keeps the set minimal
+      vector<int> up;
+      int primary;
+      tmp.pg_to_raw_up(pg, &up, &primary);
+      // keep failure domains disjoint: under must not share its
+      // immediate crush parent with any remaining member of the pg.
+      // (if over and under are in the same parent the swap cannot
+      // reduce separation, so the other members need no check.)
+      int oparent = -1;
+      tmp.crush->get_immediate_parent_id(over, &oparent);
+      bool collide = false;
+      vector<int32_t> newmap;
+      for (vector<int>::iterator r = up.begin(); r != up.end(); ++r) {
+	if (*r == over) {
+	  newmap.push_back(under);
+	  continue;
+	}
+	newmap.push_back(*r);
+	if (*r == CRUSH_ITEM_NONE)
+	  continue;
+	if (*r == under) {
+	  collide = true;
+	  break;
+	}
+	if (oparent == uparent)
+	  continue;
+	int rparent;
+	if (tmp.crush->get_immediate_parent_id(*r, &rparent) == 0 &&
+	    rparent == uparent) {
+	  collide = true;
+	  break;
+	}
+      }
+      if (collide)
+	continue;
+      ldout(cct, 10) << __func__ << " pg_upmap " << pg << " "
+		     << up << " -> " << newmap
+		     << " (osd." << over << " -> osd." << under << ")"
+		     << dendl;
+      pending_inc->new_pg_upmap[pg] = newmap;
+      tmp._cow_pg_upmap();
+      (*tmp.pg_upmap)[pg] = newmap;
+      tmp._reset_mapping_cache();
+      pgs_by_osd[over].erase(pg);
+      pgs_by_osd[under].insert(pg);
+      ++num;
+      moved = true;
+      break;
+    }
+    if (!moved)
+      break;  // nothing on the fullest osd can move safely
+  }
+  ldout(cct, 10) << __func__ << " added " << num << " overrides" << dendl;
+  return num;
+}
+
 int OSDMap::apply_incremental(const Incremental &inc)
 {
   new_blacklist_entries = false;
@@ -1263,6 +1436,10 @@ int OSDMap::apply_incremental(const Incremental &inc)
   epoch++;
   modified = inc.modified;
 
+  // mappings memoized for the previous epoch no longer apply; older
+  // copies sharing the cache keep it
+  _reset_mapping_cache();
+
   // full map?
   if (inc.fullmap.length()) {
     bufferlist bl(inc.fullmap);
@@ -1334,6 +1511,15 @@ int OSDMap::apply_incremental(const Incremental &inc)
     set_erasure_code_profile(i->first, i->second);
   }
   
+  // clone the shared sections we are about to write to (see
+  // deepish_copy_from); untouched sections stay shared with the
+  // previous epoch
+  if (!inc.new_state.empty() || !inc.new_up_client.empty() ||
+      !inc.new_up_cluster.empty())
+    _cow_osd_addrs();
+  if (!inc.new_state.empty() || !inc.new_uuid.empty())
+    _cow_osd_uuid();
+
   // up/down
   for (map<int32_t,uint8_t>::const_iterator i = inc.new_state.begin();
        i != inc.new_state.end();
@@ -1407,6 +1593,8 @@ int OSDMap::apply_incremental(const Incremental &inc)
     (*osd_uuid)[p->first] = p->second;
 
   // pg rebuild
+  if (!inc.new_pg_temp.empty())
+    _cow_pg_temp();
   for (map<pg_t, vector<int> >::const_iterator p = inc.new_pg_temp.begin(); p != inc.new_pg_temp.end(); ++p) {
     if (p->second.empty())
       pg_temp->erase(p->first);
@@ -1414,6 +1602,19 @@ int OSDMap::apply_incremental(const Incremental &inc)
       (*pg_temp)[p->first] = p->second;
   }
 
+  if (!inc.new_pg_upmap.empty())
+    _cow_pg_upmap();
+  for (map<pg_t,vector<int32_t> >::const_iterator p = inc.new_pg_upmap.begin();
+       p != inc.new_pg_upmap.end();
+       ++p) {
+    if (p->second.empty())
+      pg_upmap->erase(p->first);
+    else
+      (*pg_upmap)[p->first] = p->second;
+  }
+
+  if (!inc.new_primary_temp.empty())
+    _cow_primary_temp();
   for (map<pg_t,int32_t>::const_iterator p = inc.new_primary_temp.begin();
       p != inc.new_primary_temp.end();
       ++p) {
@@ -1545,6 +1746,17 @@ int OSDMap::_pg_to_raw_osds(
   return osds->size();
 }
 
+void OSDMap::_apply_upmap(const pg_pool_t& pool, pg_t pg,
+			  vector<int> *raw) const
+{
+  map<pg_t,vector<int32_t> >::const_iterator p = pg_upmap->find(pg);
+  if (p == pg_upmap->end())
+    return;
+  raw->assign(p->second.begin(), p->second.end());
+  // an override may name osds that have since been removed
+  _remove_nonexistent_osds(pool, *raw);
+}
+
 // pg -> (up osd list)
 void OSDMap::_raw_to_up_osds(const pg_pool_t& pool, const vector<int>& raw,
                              vector<int> *up, int *primary) const
@@ -1684,10 +1896,58 @@ void OSDMap::pg_to_raw_up(pg_t pg, vector<int> *up, int *primary) const
   vector<int> raw;
   ps_t pps;
   _pg_to_raw_osds(*pool, pg, &raw, primary, &pps);
+  _apply_upmap(*pool, pg, &raw);
   _raw_to_up_osds(*pool, raw, up, primary);
   _apply_primary_affinity(pps, *pool, up, primary);
 }
-  
+
+void OSDMap::pg_to_raw_up_batch(const vector<pg_t>& pgs,
+				vector<vector<int> > *ups,
+				vector<int> *primaries) const
+{
+  ups->resize(pgs.size());
+  primaries->resize(pgs.size());
+  unsigned i = 0;
+  while (i < pgs.size()) {
+    const pg_pool_t *pool = get_pg_pool(pgs[i].pool());
+    if (!pool) {
+      (*ups)[i].clear();
+      (*primaries)[i] = -1;
+      ++i;
+      continue;
+    }
+
+    // gather the run of pgs from the same pool
+    unsigned end = i + 1;
+    while (end < pgs.size() && pgs[end].pool() == pgs[i].pool())
+      ++end;
+
+    unsigned size = pool->get_size();
+    int ruleno = crush->find_rule(pool->get_crush_ruleset(),
+				  pool->get_type(), size);
+    vector<int> ppss(end - i);
+    for (unsigned j = i; j < end; ++j)
+      ppss[j - i] = pool->raw_pg_to_pps(pgs[j]);
+
+    vector<vector<int> > raws;
+    if (ruleno >= 0)
+      crush->do_rule_batch(ruleno, ppss, &raws, size, osd_weight);
+    else
+      raws.resize(end - i);
+
+    for (unsigned j = i; j < end; ++j) {
+      vector<int>& raw = raws[j - i];
+      _remove_nonexistent_osds(*pool, raw);
+      _apply_upmap(*pool, pgs[j], &raw);
+      int primary = -1;
+      _raw_to_up_osds(*pool, raw, &(*ups)[j], &primary);
+      _apply_primary_affinity(ppss[j - i], *pool, &(*ups)[j], &primary);
+      (*primaries)[j] = primary;
+    }
+    i = end;
+  }
+}
+
 void OSDMap::_pg_to_up_acting_osds(const pg_t& pg, vector<int> *up, int *up_primary,
                                    vector<int> *acting, int *acting_primary) const
 {
@@ -1703,6 +1963,29 @@ void OSDMap::_pg_to_up_acting_osds(const pg_t& pg, vector<int> *up, int *up_prim
       *acting_primary = -1;
     return;
   }
+  MappingCache *cache = mapping_cache.get();
+  unsigned slot = 0;
+  if (cache) {
+    slot = (unsigned)(pg.ps() ^ (pg.pool() << 1)) % MappingCache::ENTRIES;
+    Spinlock::Locker l(cache->lock);
+    if (!cache->table.empty()) {
+      MappingCache::Entry &e = cache->table[slot];
+      if (e.valid && e.pg == pg) {
+	cache->hits++;
+	if (up)
+	  *up = e.up;
+	if (up_primary)
+	  *up_primary = e.up_primary;
+	if (acting)
+	  *acting = e.acting;
+	if (acting_primary)
+	  *acting_primary = e.acting_primary;
+	return;
+      }
+    }
+    cache->misses++;
+  }
+
   vector<int> raw;
   vector<int> _up;
   vector<int> _acting;
@@ -1710,6 +1993,7 @@ void OSDMap::_pg_to_up_acting_osds(const pg_t& pg, vector<int> *up, int *up_prim
   int _acting_primary;
   ps_t pps;
   _pg_to_raw_osds(*pool, pg, &raw, &_up_primary, &pps);
+  _apply_upmap(*pool, pg, &raw);
   _raw_to_up_osds(*pool, raw, &_up, &_up_primary);
   _apply_primary_affinity(pps, *pool, &_up, &_up_primary);
   _get_temp_osds(*pool, pg, &_acting, &_acting_primary);
@@ -1719,6 +2003,20 @@ void OSDMap::_pg_to_up_acting_osds(const pg_t& pg, vector<int> *up, int *up_prim
       _acting_primary = _up_primary;
     }
   }
+
+  if (cache) {
+    Spinlock::Locker l(cache->lock);
+    if (cache->table.empty())
+      cache->table.resize(MappingCache::ENTRIES);
+    MappingCache::Entry &e = cache->table[slot];
+    e.pg = pg;
+    e.up = _up;
+    e.acting = _acting;
+    e.up_primary = _up_primary;
+    e.acting_primary = _acting_primary;
+    e.valid = true;
+  }
+
   if (up)
     up->swap(_up);
   if (up_primary)
@@ -1895,7 +2193,7 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
   ENCODE_START(8, 7, bl);
 
   {
-    ENCODE_START(3, 1, bl); // client-usable data
+    ENCODE_START(4, 1, bl); // client-usable data
     // base
     ::encode(fsid, bl);
     ::encode(epoch, bl);
@@ -1927,6 +2225,7 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
     crush->encode(cbl);
     ::encode(cbl, bl);
     ::encode(erasure_code_profiles, bl);
+    ::encode(*pg_upmap, bl);
     ENCODE_FINISH(bl); // client-usable data
   }
 
@@ -2093,6 +2392,10 @@ void OSDMap::decode_classic(bufferlist::iterator& p)
 
 void OSDMap::decode(bufferlist::iterator& bl)
 {
+  // we decode through the shared sections below; make sure they are
+  // not shared with another epoch first
+  _detach_shared();
+
   /**
    * Older encodings of the OSDMap had a single struct_v which
    * covered the whole encoding, and was prior to our modern
@@ -2115,7 +2418,7 @@ void OSDMap::decode(bufferlist::iterator& bl)
    * Since we made it past that hurdle, we can use our normal paths.
    */
   {
-    DECODE_START(3, bl); // client-usable data
+    DECODE_START(4, bl); // client-usable data
     // base
     ::decode(fsid, bl);
     ::decode(epoch, bl);
@@ -2154,6 +2457,8 @@ void OSDMap::decode(bufferlist::iterator& bl)
     } else {
       erasure_code_profiles.clear();
     }
+    if (struct_v >= 4)
+      ::decode(*pg_upmap, bl);
     DECODE_FINISH(bl); // client-usable data
   }
 
@@ -2319,6 +2624,22 @@ void OSDMap::dump(Formatter *f) const
   }
   f->close_section(); // primary_temp
 
+  f->open_array_section("pg_upmap");
+  for (map<pg_t,vector<int32_t> >::const_iterator p = pg_upmap->begin();
+       p != pg_upmap->end();
+       ++p) {
+    f->open_object_section("osds");
+    f->dump_stream("pgid") << p->first;
+    f->open_array_section("osds");
+    for (vector<int32_t>::const_iterator q = p->second.begin();
+	 q != p->second.end();
+	 ++q)
+      f->dump_int("osd", *q);
+    f->close_section();
+    f->close_section();
+  }
+  f->close_section();
+
   f->open_object_section("blacklist");
   for (ceph::unordered_map<entity_addr_t,utime_t>::const_iterator p = blacklist.begin();
        p != blacklist.end();
@@ -2467,6 +2788,11 @@ void OSDMap::print(ostream& out) const
       ++p)
     out << "primary_temp " << p->first << " " << p->second << "\n";
 
+  for (map<pg_t,vector<int32_t> >::const_iterator p = pg_upmap->begin();
+       p != pg_upmap->end();
+       ++p)
+    out << "pg_upmap " << p->first << " " << p->second << "\n";
+
   for (ceph::unordered_map<entity_addr_t,utime_t>::const_iterator p = blacklist.begin();
        p != blacklist.end();
        ++p)
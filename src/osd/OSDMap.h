@@ -25,6 +25,7 @@
  *
  */
 #include "include/types.h"
+#include "include/Spinlock.h"
 #include "osd_types.h"
 
 //#include "include/ceph_features.h"
@@ -134,6 +135,7 @@ public:
     map<int32_t,uint32_t> new_weight;
     map<pg_t,vector<int32_t> > new_pg_temp;     // [] to remove
     map<pg_t, int32_t> new_primary_temp;            // [-1] to remove
+    map<pg_t,vector<int32_t> > new_pg_upmap;    // [] to remove
     map<int32_t,uint32_t> new_primary_affinity;
     map<int32_t,epoch_t> new_up_thru;
     map<int32_t,pair<epoch_t,epoch_t> > new_last_clean_interval;
@@ -225,6 +227,7 @@ private:
   vector<osd_info_t> osd_info;
   ceph::shared_ptr< map<pg_t,vector<int32_t> > > pg_temp;  // temp pg mapping (e.g. while we rebuild)
   ceph::shared_ptr< map<pg_t,int32_t > > primary_temp;  // temp primary mapping (e.g. while we rebuild)
+  ceph::shared_ptr< map<pg_t,vector<int32_t> > > pg_upmap; // explicit mapping overrides (balancer)
   ceph::shared_ptr< vector<__u32> > osd_primary_affinity; ///< 16.16 fixed point, 0x10000 = baseline
 
   map<int64_t,pg_pool_t> pools;
@@ -248,6 +251,81 @@ private:
 
   void _calc_up_osd_features();
 
+  /*
+   * The sections held by shared_ptr above are shared between epochs
+   * (see deepish_copy_from).  Mutators must call the matching _cow_*
+   * helper before writing so that older maps still referencing the
+   * section are not affected.
+   */
+  void _cow_osd_addrs() {
+    if (!osd_addrs.unique())
+      osd_addrs.reset(new addrs_s(*osd_addrs));
+  }
+  void _cow_pg_temp() {
+    if (!pg_temp.unique())
+      pg_temp.reset(new map<pg_t,vector<int32_t> >(*pg_temp));
+  }
+  void _cow_primary_temp() {
+    if (!primary_temp.unique())
+      primary_temp.reset(new map<pg_t,int32_t>(*primary_temp));
+  }
+  void _cow_pg_upmap() {
+    if (!pg_upmap.unique())
+      pg_upmap.reset(new map<pg_t,vector<int32_t> >(*pg_upmap));
+  }
+  void _cow_osd_uuid() {
+    if (!osd_uuid.unique())
+      osd_uuid.reset(new vector<uuid_d>(*osd_uuid));
+  }
+  void _cow_osd_primary_affinity() {
+    if (osd_primary_affinity && !osd_primary_affinity.unique())
+      osd_primary_affinity.reset(new vector<__u32>(*osd_primary_affinity));
+  }
+
+  /**
+   * Memoized pg -> up/acting mappings
+   *
+   * A mapping is deterministic within a single epoch, so each map
+   * carries a small lossy hash table of pg_to_up_acting_osds results,
+   * shared by reference between copies like the sections above.  Any
+   * mutator that can change mappings must call _reset_mapping_cache()
+   * so older copies keep their results and this map starts empty.
+   */
+  struct MappingCache {
+    enum { ENTRIES = 1024 };
+    struct Entry {
+      pg_t pg;
+      vector<int> up;
+      vector<int> acting;
+      int up_primary;
+      int acting_primary;
+      bool valid;
+      Entry() : up_primary(-1), acting_primary(-1), valid(false) {}
+    };
+    Spinlock lock;
+    vector<Entry> table;    ///< allocated on first store
+    uint64_t hits, misses;  ///< protected by lock
+    MappingCache() : hits(0), misses(0) {}
+  };
+  ceph::shared_ptr<MappingCache> mapping_cache;
+
+  void _reset_mapping_cache() {
+    mapping_cache.reset(new MappingCache);
+  }
+
+  /// give this map private (empty) copies of every shared section, so
+  /// that decoding into it cannot clobber state shared with other epochs
+  void _detach_shared() {
+    osd_addrs.reset(new addrs_s);
+    pg_temp.reset(new map<pg_t,vector<int32_t> >);
+    primary_temp.reset(new map<pg_t,int32_t>);
+    pg_upmap.reset(new map<pg_t,vector<int32_t> >);
+    osd_uuid.reset(new vector<uuid_d>);
+    osd_primary_affinity.reset();
+    crush.reset(new CrushWrapper);
+    _reset_mapping_cache();
+  }
+
  public:
   bool have_crc() const { return crc_defined; }
   uint32_t get_crc() const { return crc; }
@@ -266,11 +344,13 @@ private:
 	     osd_addrs(std::make_shared<addrs_s>()),
 	     pg_temp(std::make_shared<map<pg_t,vector<int32_t>>>()),
 	     primary_temp(std::make_shared<map<pg_t,int32_t>>()),
+	     pg_upmap(std::make_shared<map<pg_t,vector<int32_t>>>()),
 	     osd_uuid(std::make_shared<vector<uuid_d>>()),
 	     cluster_snapshot_epoch(0),
 	     new_blacklist_entries(false),
 	     cached_up_osd_features(0),
 	     crc_defined(false), crc(0),
+	     mapping_cache(std::make_shared<MappingCache>()),
 	     crush(std::make_shared<CrushWrapper>()) {
     memset(&fsid, 0, sizeof(fsid));
   }
@@ -285,18 +365,11 @@ public:
 
   void deepish_copy_from(const OSDMap& o) {
     *this = o;
-    primary_temp.reset(new map<pg_t,int32_t>(*o.primary_temp));
-    pg_temp.reset(new map<pg_t,vector<int32_t> >(*o.pg_temp));
-    osd_uuid.reset(new vector<uuid_d>(*o.osd_uuid));
-
-    if (o.osd_primary_affinity)
-      osd_primary_affinity.reset(new vector<__u32>(*o.osd_primary_affinity));
-
-    // NOTE: this still references shared entity_addr_t's.
-    osd_addrs.reset(new addrs_s(*o.osd_addrs));
-
-    // NOTE: we do not copy crush.  note that apply_incremental will
-    // allocate a new CrushWrapper, though.
+    // NOTE: pg_temp, primary_temp, pg_upmap, osd_uuid,
+    // osd_primary_affinity, osd_addrs and crush remain shared with
+    // o.  The mutators clone a
+    // section on first write (see the _cow_* helpers), so applying an
+    // incremental that leaves a section untouched does not copy it.
   }
 
   // map info
@@ -343,6 +416,9 @@ public:
   unsigned get_num_pg_temp() const {
     return pg_temp->size();
   }
+  const map<pg_t,vector<int32_t> >& get_pg_upmap() const {
+    return *pg_upmap;
+  }
 
   int get_flags() const { return flags; }
   bool test_flag(int f) const { return flags & f; }
@@ -364,12 +440,14 @@ public:
   void set_state(int o, unsigned s) {
     assert(o < max_osd);
     osd_state[o] = s;
+    _reset_mapping_cache();
   }
   void set_weight(int o, unsigned w) {
     assert(o < max_osd);
     osd_weight[o] = w;
     if (w)
       osd_state[o] |= CEPH_OSD_EXISTS;
+    _reset_mapping_cache();
   }
   unsigned get_weight(int o) const {
     assert(o < max_osd);
@@ -385,7 +463,10 @@ public:
     if (!osd_primary_affinity)
       osd_primary_affinity.reset(new vector<__u32>(max_osd,
 						   CEPH_OSD_DEFAULT_PRIMARY_AFFINITY));
+    else
+      _cow_osd_primary_affinity();
     (*osd_primary_affinity)[o] = w;
+    _reset_mapping_cache();
   }
   unsigned get_primary_affinity(int o) const {
     assert(o < max_osd);
@@ -571,6 +652,17 @@ public:
   static void clean_temps(CephContext *cct, const OSDMap& osdmap,
 			  Incremental *pending_inc);
 
+  /**
+   * Propose pg_upmap overrides that equalize per-osd pg counts for
+   * the given pools without touching crush weights.  Up to max
+   * overrides are appended to pending_inc; returns how many were
+   * added.  Replacement osds are only drawn from outside the crush
+   * parent buckets of the other members of a pg, so simple
+   * host-separated rules stay separated.
+   */
+  int calc_pg_upmaps(CephContext *cct, int max, const set<int64_t>& pools,
+		     Incremental *pending_inc);
+
   // serialize, unserialize
 private:
   void encode_client_old(bufferlist& bl) const;
@@ -578,6 +670,14 @@ private:
   void decode_classic(bufferlist::iterator& p);
   void post_decode();
 public:
+  /// the feature bits that alter how a map (or incremental) is encoded
+  static const uint64_t SIGNIFICANT_FEATURES =
+    CEPH_FEATURE_PGID64 |
+    CEPH_FEATURE_OSDENC |
+    CEPH_FEATURE_OSDMAP_ENC;
+  static uint64_t get_significant_features(uint64_t features) {
+    return SIGNIFICANT_FEATURES & features;
+  }
   void encode(bufferlist& bl, uint64_t features=CEPH_FEATURES_ALL) const;
   void decode(bufferlist& bl);
   void decode(bufferlist::iterator& bl);
@@ -618,6 +718,9 @@ private:
     ps_t *ppps) const;
   void _remove_nonexistent_osds(const pg_pool_t& pool, vector<int>& osds) const;
 
+  /// replace the raw mapping with the pg_upmap override, if one exists
+  void _apply_upmap(const pg_pool_t& pool, pg_t pg, vector<int> *raw) const;
+
   void _apply_primary_affinity(ps_t seed, const pg_pool_t& pool,
 			       vector<int> *osds, int *primary) const;
 
@@ -662,6 +765,14 @@ public:
    * by anybody for data mapping purposes. Specify both pointers.
    */
   void pg_to_raw_up(pg_t pg, vector<int> *up, int *primary) const;
+  /**
+   * batch form of pg_to_raw_up(); runs of pgs from the same pool are
+   * evaluated with a single pass over the crush rule.  Output vectors
+   * are resized to match pgs.
+   */
+  void pg_to_raw_up_batch(const vector<pg_t>& pgs,
+			  vector<vector<int> > *ups,
+			  vector<int> *primaries) const;
   /**
    * map a pg to its acting set as well as its up set. You must use
    * the acting set for data mapping purposes, but some users will
@@ -677,6 +788,14 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+  /// hit/miss totals for this map's memoized pg mappings
+  void get_mapping_cache_stats(uint64_t *hits, uint64_t *misses) const {
+    Spinlock::Locker l(mapping_cache->lock);
+    if (hits)
+      *hits = mapping_cache->hits;
+    if (misses)
+      *misses = mapping_cache->misses;
+  }
   bool pg_is_ec(pg_t pg) const {
     map<int64_t, pg_pool_t>::const_iterator i = pools.find(pg.pool());
     assert(i != pools.end());
@@ -836,8 +955,11 @@ public:
   bool crush_ruleset_in_use(int ruleset) const;
 
   void clear_temp() {
-    pg_temp->clear();
-    primary_temp->clear();
+    // fresh maps rather than _cow_* + clear: no point copying the
+    // contents just to throw them away
+    pg_temp.reset(new map<pg_t,vector<int32_t> >);
+    primary_temp.reset(new map<pg_t,int32_t>);
+    _reset_mapping_cache();
   }
 
 private:
@@ -73,6 +73,26 @@ void OpRequest::_dump(utime_t now, Formatter *f) const
   }
 }
 
+uint64_t OpRequest::get_trace_id(std::string *desc) const
+{
+  // only ops carrying a client reqid have a cross-daemon identity:
+  // the same reqid travels in the MOSDOp to the primary and in the
+  // MOSDRepOp/MOSDSubOp to the replicas
+  if (reqid.name == entity_name_t() && reqid.tid == 0)
+    return 0;
+  if (desc) {
+    ostringstream ss;
+    ss << reqid;
+    *desc = ss.str();
+  }
+  // deterministic in the reqid alone, so every daemon a sampled op
+  // touches makes the same 1-in-N decision without any extra wire state
+  uint64_t h = reqid.name._num;
+  h = h * 0x9e3779b97f4a7c15ull + reqid.tid;
+  h = h * 0x9e3779b97f4a7c15ull + reqid.inc;
+  return h ? h : 1;
+}
+
 void OpRequest::_dump_op_descriptor_unlocked(ostream& stream) const
 {
   get_req()->print(stream);
@@ -185,6 +185,8 @@ public:
     return reqid;
   }
 
+  uint64_t get_trace_id(std::string *desc = NULL) const;
+
   typedef ceph::shared_ptr<OpRequest> Ref;
 
 private:
@@ -234,6 +234,8 @@ PG::PG(OSDService *o, OSDMapRef curmap,
   flushes_in_progress(0),
   pg_stats_publish_lock("PG::pg_stats_publish_lock"),
   pg_stats_publish_valid(false),
+  pg_stats_sent_valid(false),
+  pg_stats_acked_valid(false),
   osr(osd->osr_registry.lookup_or_create(p, (stringify(p)))),
   finish_sync_event(NULL),
   scrub_after_recovery(false),
@@ -969,6 +971,7 @@ PG::Scrubber::Scrubber()
    must_scrub(false), must_deep_scrub(false), must_repair(false),
    auto_repair(false),
    num_digest_updates_pending(0),
+   preempted(false), preempt_left(0),
    state(INACTIVE),
    deep(false),
    seed(0)
@@ -2670,6 +2673,8 @@ void PG::clear_publish_stats()
   dout(15) << "clear_stats" << dendl;
   pg_stats_publish_lock.Lock();
   pg_stats_publish_valid = false;
+  pg_stats_sent_valid = false;
+  pg_stats_acked_valid = false;
   pg_stats_publish_lock.Unlock();
 
   osd->pg_stat_queue_dequeue(this);
@@ -4028,6 +4033,8 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
         publish_stats_to_osd();
         scrubber.epoch_start = info.history.same_interval_since;
         scrubber.active = true;
+	scrubber.preempted = false;
+	scrubber.preempt_left = cct->_conf->osd_scrub_max_preemptions;
 
 	osd->inc_scrubs_active(scrubber.reserved);
 	if (scrubber.reserved) {
@@ -4211,6 +4218,19 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
         assert(last_update_applied >= scrubber.subset_last_update);
         assert(scrubber.waiting_on == 0);
 
+	if (scrubber.preempted) {
+	  // a write was let into this chunk, so the maps we gathered
+	  // may disagree for perfectly healthy objects.  toss them and
+	  // redo the chunk from the same offset.
+	  dout(10) << __func__ << " chunk preempted by a write, "
+		   << scrubber.preempt_left << " preemptions left" << dendl;
+	  scrubber.preempted = false;
+	  scrubber.state = PG::Scrubber::NEW_CHUNK;
+	  requeue_scrub();
+	  done = true;
+	  break;
+	}
+
         scrub_compare_maps();
 	scrubber.start = scrubber.end;
 	scrubber.run_callbacks();
@@ -857,6 +857,13 @@ protected:
   bool pg_stats_publish_valid;
   pg_stat_t pg_stats_publish;
 
+  // what we last put on the wire, and the last report the mon acked;
+  // the latter is the base future reports may be delta-encoded against
+  bool pg_stats_sent_valid;
+  pg_stat_t pg_stats_sent;
+  bool pg_stats_acked_valid;
+  pg_stat_t pg_stats_acked;
+
   // for ordering writes
   ceph::shared_ptr<ObjectStore::Sequencer> osr;
 
@@ -1173,6 +1180,10 @@ public:
     hobject_t start, end;
     eversion_t subset_last_update;
 
+    // chunk preemption
+    bool preempted;     ///< a write wants the chunk redone
+    int preempt_left;   ///< remaining preemptions before writes block
+
     // chunky scrub state
     enum State {
       INACTIVE,
@@ -1228,9 +1239,19 @@ public:
     // chunky scrubs only block writes to a range
     bool write_blocked_by_scrub(const hobject_t &soid, bool sort_bitwise) {
       if (cmp(soid, start, sort_bitwise) >= 0 &&
-	  cmp(soid, end, sort_bitwise) < 0)
+	  cmp(soid, end, sort_bitwise) < 0) {
+	// let the write through and redo the chunk instead, as long as
+	// we have preemptions left; the half-built maps for this chunk
+	// are discarded in COMPARE_MAPS.
+	if (preempt_left > 0) {
+	  if (!preempted) {
+	    preempted = true;
+	    --preempt_left;
+	  }
+	  return false;
+	}
 	return true;
-
+      }
       return false;
     }
 
@@ -1254,6 +1275,8 @@ public:
       start = hobject_t();
       end = hobject_t();
       subset_last_update = eversion_t();
+      preempted = false;
+      preempt_left = 0;
       shallow_errors = 0;
       deep_errors = 0;
       fixed = 0;
@@ -87,7 +87,7 @@ void PGBackend::rollback(
   assert(desc.can_rollback());
   RollbackVisitor vis(hoid, this);
   desc.visit(&vis);
-  t->append(vis.t);
+  t->claim_append(vis.t);
 }
 
 
@@ -344,7 +344,21 @@ void PGLog::rewind_divergent_log(ObjectStore::Transaction& t, eversion_t newhead
   if (log.rollback_info_trimmed_to > newhead)
     log.rollback_info_trimmed_to = newhead;
 
-  log.index();
+  // unindex the entries we rewound past and restore any older entries
+  // for the same keys instead of rebuilding the whole index
+  set<hobject_t, hobject_t::BitwiseComparator> divergent_soids;
+  set<osd_reqid_t> divergent_reqids;
+  for (list<pg_log_entry_t>::iterator i = divergent.begin();
+       i != divergent.end();
+       ++i) {
+    log.unindex(*i);
+    divergent_soids.insert(i->soid);
+    if (i->reqid_is_indexed())
+      divergent_reqids.insert(i->reqid);
+  }
+  if (!divergent.empty())
+    log.reindex_removed_keys(divergent_soids, divergent_reqids);
+  log.reset_rollback_info_trimmed_to_riter();
 
   _merge_divergent_entries(
     log,
@@ -452,6 +466,8 @@ void PGLog::merge_log(ObjectStore::Transaction& t,
 
     // move aside divergent items
     list<pg_log_entry_t> divergent;
+    set<hobject_t, hobject_t::BitwiseComparator> divergent_soids;
+    set<osd_reqid_t> divergent_reqids;
     while (!log.empty()) {
       pg_log_entry_t &oe = *log.log.rbegin();
       /*
@@ -465,6 +481,10 @@ void PGLog::merge_log(ObjectStore::Transaction& t,
       if (oe.version.version <= lower_bound.version)
 	break;
       dout(10) << "merge_log divergent " << oe << dendl;
+      log.unindex(oe);
+      divergent_soids.insert(oe.soid);
+      if (oe.reqid_is_indexed())
+	divergent_reqids.insert(oe.reqid);
       divergent.push_front(oe);
       log.log.pop_back();
     }
@@ -479,7 +499,10 @@ void PGLog::merge_log(ObjectStore::Transaction& t,
       missing,
       rollbacker,
       this);
-    log.index();   
+    // the appended entries were indexed as they were added; just
+    // restore any keys whose newest entry was divergent
+    if (!divergent.empty())
+      log.reindex_removed_keys(divergent_soids, divergent_reqids);
 
     info.last_update = log.head = olog.head;
 
@@ -559,6 +582,8 @@ void PGLog::write_log_and_missing(
       !touched_log,
       require_rollback,
       clear_divergent_priors,
+      &log_segments,
+      cct ? cct->_conf->osd_pg_log_segment_entries : 0,
       (pg_log_debug ? &log_keys_debug : 0));
     undirty();
   } else {
@@ -597,7 +622,7 @@ void PGLog::write_log_and_missing(
     eversion_t(),
     set<eversion_t>(),
     missing,
-    true, require_rollback, false, 0);
+    true, require_rollback, false, 0, 0, 0);
 }
 
 void PGLog::_write_log_and_missing_wo_missing(
@@ -682,10 +707,51 @@ void PGLog::_write_log_and_missing_wo_missing(
   ::encode(log.rollback_info_trimmed_to, (*km)["rollback_info_trimmed_to"]);
   }
 
+  if (dirty_to == eversion_t::max()) {
+    // full rewrite in the unpacked format; drop any stale segment index
+    to_remove.insert("_log_segments");
+  }
+
   if (!to_remove.empty())
     t.omap_rmkeys(coll, log_oid, to_remove);
 }
 
+/// write a run of entries, packing them segment_entries at a time when enabled
+static void _write_entry_run(
+  const vector<const pg_log_entry_t*> &run,
+  map<string,bufferlist> *km,
+  map<eversion_t, eversion_t> *log_segments,
+  unsigned segment_entries,
+  bool *segments_changed)
+{
+  if (log_segments && segment_entries >= 2) {
+    for (unsigned i = 0; i < run.size(); i += segment_entries) {
+      unsigned n = MIN((unsigned)(run.size() - i), segment_entries);
+      if (n < 2) {
+	bufferlist bl;
+	run[i]->encode_with_checksum(bl);
+	(*km)[run[i]->get_key_name()].claim(bl);
+	continue;
+      }
+      bufferlist bl;
+      ::encode((__u32)n, bl);
+      for (unsigned j = i; j < i + n; ++j)
+	run[j]->encode_with_checksum(bl);
+      (*km)[run[i]->get_key_name()].claim(bl);
+      (*log_segments)[run[i]->version] = run[i + n - 1]->version;
+      *segments_changed = true;
+    }
+  } else {
+    for (vector<const pg_log_entry_t*>::const_iterator p = run.begin();
+	 p != run.end();
+	 ++p) {
+      bufferlist bl;
+      (*p)->encode_with_checksum(bl);
+      (*km)[(*p)->get_key_name()].claim(bl);
+    }
+  }
+}
+
 void PGLog::_write_log_and_missing(
   ObjectStore::Transaction& t,
   map<string,bufferlist>* km,
@@ -699,26 +765,64 @@ void PGLog::_write_log_and_missing(
   bool touch_log,
   bool require_rollback,
   bool clear_divergent_priors,
+  map<eversion_t, eversion_t> *log_segments,
+  unsigned segment_entries,
   set<string> *log_keys_debug
   ) {
   set<string> to_remove;
+  bool segments_changed = false;
+
+  // drop packed segments that have been trimmed away entirely; a
+  // partially trimmed segment keeps its key (the read path ignores
+  // entries at or below the log tail) until the whole run is gone
+  if (log_segments) {
+    while (!log_segments->empty() &&
+	   log_segments->begin()->second <= log.tail) {
+      to_remove.insert(log_segments->begin()->first.get_key_name());
+      log_segments->erase(log_segments->begin());
+      segments_changed = true;
+    }
+  }
+
   for (set<eversion_t>::const_iterator i = trimmed.begin();
        i != trimmed.end();
        ++i) {
-    to_remove.insert(i->get_key_name());
     if (log_keys_debug) {
       assert(log_keys_debug->count(i->get_key_name()));
       log_keys_debug->erase(i->get_key_name());
     }
+    if (log_segments) {
+      map<eversion_t, eversion_t>::iterator s = log_segments->find(*i);
+      if (s != log_segments->end() && s->second > log.tail)
+	continue;  // segment start with live entries behind it
+    }
+    to_remove.insert(i->get_key_name());
   }
 
   if (touch_log)
     t.touch(coll, log_oid);
+  eversion_t rewrite_to = dirty_to;
+  eversion_t rewrite_from = dirty_from;
   if (dirty_to != eversion_t()) {
     t.omap_rmkeyrange(
       coll, log_oid,
       eversion_t().get_key_name(), dirty_to.get_key_name());
     clear_up_to(log_keys_debug, dirty_to.get_key_name());
+    if (log_segments && !log_segments->empty()) {
+      // every segment key below dirty_to is removed with the range; if
+      // the last of them straddled dirty_to, its surviving entries must
+      // be rewritten as well
+      map<eversion_t, eversion_t>::iterator s =
+	log_segments->lower_bound(dirty_to);
+      if (s != log_segments->begin()) {
+	map<eversion_t, eversion_t>::iterator p = s;
+	--p;
+	if (p->second >= dirty_to)
+	  rewrite_to = p->second;
+	log_segments->erase(log_segments->begin(), s);
+	segments_changed = true;
+      }
+    }
   }
   if (dirty_to != eversion_t::max() && dirty_from != eversion_t::max()) {
     //   dout(10) << "write_log_and_missing, clearing from " << dirty_from << dendl;
@@ -726,25 +830,53 @@ void PGLog::_write_log_and_missing(
       coll, log_oid,
       dirty_from.get_key_name(), eversion_t::max().get_key_name());
     clear_after(log_keys_debug, dirty_from.get_key_name());
+    if (log_segments && !log_segments->empty()) {
+      map<eversion_t, eversion_t>::iterator s =
+	log_segments->lower_bound(dirty_from);
+      if (s != log_segments->begin()) {
+	map<eversion_t, eversion_t>::iterator p = s;
+	--p;
+	if (p->second >= dirty_from) {
+	  // stale entries would survive inside this segment's value;
+	  // rewrite the whole run so its key gets replaced
+	  rewrite_from = p->first;
+	  s = p;
+	}
+      }
+      if (s != log_segments->end()) {
+	log_segments->erase(s, log_segments->end());
+	segments_changed = true;
+      }
+    }
   }
-
-  for (list<pg_log_entry_t>::iterator p = log.log.begin();
-       p != log.log.end() && p->version <= dirty_to;
-       ++p) {
-    bufferlist bl(sizeof(*p) * 2);
-    p->encode_with_checksum(bl);
-    (*km)[p->get_key_name()].claim(bl);
+  if (rewrite_to > dirty_to) {
+    clear_up_to(log_keys_debug, rewrite_to.get_key_name());
+    if (log_keys_debug)
+      log_keys_debug->erase(rewrite_to.get_key_name());
   }
+  if (rewrite_from < dirty_from)
+    clear_after(log_keys_debug, rewrite_from.get_key_name());
 
+  vector<const pg_log_entry_t*> run;
+  for (list<pg_log_entry_t>::iterator p = log.log.begin();
+       p != log.log.end() && p->version <= rewrite_to;
+       ++p)
+    run.push_back(&*p);
+  _write_entry_run(run, km,
+		   log_keys_debug ? NULL : log_segments, segment_entries,
+		   &segments_changed);
+
+  run.clear();
   for (list<pg_log_entry_t>::reverse_iterator p = log.log.rbegin();
        p != log.log.rend() &&
-	 (p->version >= dirty_from || p->version >= writeout_from) &&
-	 p->version >= dirty_to;
-       ++p) {
-    bufferlist bl(sizeof(*p) * 2);
-    p->encode_with_checksum(bl);
-    (*km)[p->get_key_name()].claim(bl);
-  }
+	 (p->version >= rewrite_from || p->version >= writeout_from) &&
+	 p->version > rewrite_to;
+       ++p)
+    run.push_back(&*p);
+  std::reverse(run.begin(), run.end());
+  _write_entry_run(run, km,
+		   log_keys_debug ? NULL : log_segments, segment_entries,
+		   &segments_changed);
 
   if (log_keys_debug) {
     for (map<string, bufferlist>::iterator i = (*km).begin();
@@ -776,6 +908,18 @@ void PGLog::_write_log_and_missing(
     ::encode(log.rollback_info_trimmed_to, (*km)["rollback_info_trimmed_to"]);
   }
 
+  if (log_segments) {
+    if (segments_changed) {
+      if (log_segments->empty())
+	to_remove.insert("_log_segments");
+      else
+	::encode(*log_segments, (*km)["_log_segments"]);
+    }
+  } else if (dirty_to == eversion_t::max()) {
+    // full rewrite in the unpacked format; drop any stale segment index
+    to_remove.insert("_log_segments");
+  }
+
   if (!to_remove.empty())
     t.omap_rmkeys(coll, log_oid, to_remove);
 }
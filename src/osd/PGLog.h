@@ -106,6 +106,29 @@ struct PGLog : DoutPrefixProvider {
       rollback_info_trimmed_to_riter(log.rbegin())
       {}
 
+    // a default copy would duplicate the index maps, whose pointers
+    // (and the recovery/rollback iterators) would still refer into the
+    // source's list; reset them and let the index rebuild lazily
+    IndexedLog(const IndexedLog &rhs) :
+      pg_log_t(rhs),
+      complete_to(log.end()),
+      last_requested(rhs.last_requested),
+      indexed_data(0),
+      rollback_info_trimmed_to_riter(log.rbegin()) {
+      reset_rollback_info_trimmed_to_riter();
+    }
+
+    IndexedLog &operator=(const IndexedLog &rhs) {
+      if (this != &rhs) {
+	pg_log_t::operator=(rhs);
+	unindex();
+	complete_to = log.end();
+	last_requested = rhs.last_requested;
+	reset_rollback_info_trimmed_to_riter();
+      }
+      return *this;
+    }
+
     void claim_log_and_clear_rollback_info(const pg_log_t& o) {
       // we must have already trimmed the old entries
       assert(rollback_info_trimmed_to == head);
@@ -245,6 +268,10 @@ struct PGLog : DoutPrefixProvider {
       objects.clear();
       caller_ops.clear();
       extra_caller_ops.clear();
+      // presize the buckets so a big log doesn't rehash repeatedly
+      // while we fill in
+      objects.rehash(log.size());
+      caller_ops.rehash(log.size());
       for (list<pg_log_entry_t>::iterator i = log.begin();
              i != log.end();
              ++i) {
@@ -271,6 +298,7 @@ struct PGLog : DoutPrefixProvider {
 
     void index_objects() const {
       objects.clear();
+      objects.rehash(log.size());
       for (list<pg_log_entry_t>::const_iterator i = log.begin();
             i != log.end();
             ++i) {
@@ -284,6 +312,7 @@ struct PGLog : DoutPrefixProvider {
 
     void index_caller_ops() const {
       caller_ops.clear();
+      caller_ops.rehash(log.size());
       for (list<pg_log_entry_t>::const_iterator i = log.begin();
              i != log.end();
              ++i) {
@@ -372,6 +401,54 @@ struct PGLog : DoutPrefixProvider {
       }
     }
 
+    /**
+     * Repair the index after entries have been removed from the _head_
+     * of the log (divergent entries in merge_log or
+     * rewind_divergent_log).  unindex(e) only drops the mappings that
+     * pointed at the removed entry, so a key whose newest entry was
+     * removed may still have an older entry in the log that belongs
+     * back in the index.  Walk backwards from the head and restore the
+     * newest remaining entry for each affected key; much cheaper than
+     * a full index() when few keys are affected, and a no-op for keys
+     * already re-covered by newly appended entries.  extra_caller_ops
+     * needs no repair: it holds one mapping per entry and unindex(e)
+     * removed only the removed entry's.
+     */
+    void reindex_removed_keys(
+      const set<hobject_t, hobject_t::BitwiseComparator> &soids,
+      const set<osd_reqid_t> &reqids) {
+      set<hobject_t, hobject_t::BitwiseComparator> pending_soids;
+      set<osd_reqid_t> pending_reqids;
+      if (!(indexed_data & PGLOG_INDEXED_OBJECTS)) {
+	// _merge_object_divergent_entries consults objects directly;
+	// the removed entries are already gone from the log, so a
+	// fresh build is correct
+	index_objects();
+      } else {
+	for (set<hobject_t, hobject_t::BitwiseComparator>::const_iterator i =
+	       soids.begin(); i != soids.end(); ++i) {
+	  if (!objects.count(*i))
+	    pending_soids.insert(*i);
+	}
+      }
+      if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
+	for (set<osd_reqid_t>::const_iterator i = reqids.begin();
+	     i != reqids.end(); ++i) {
+	  if (!caller_ops.count(*i))
+	    pending_reqids.insert(*i);
+	}
+      }
+      for (list<pg_log_entry_t>::reverse_iterator i = log.rbegin();
+	   i != log.rend() &&
+	     !(pending_soids.empty() && pending_reqids.empty());
+	   ++i) {
+	if (i->object_is_indexed() && pending_soids.erase(i->soid))
+	  objects[i->soid] = &(*i);
+	if (i->reqid_is_indexed() && pending_reqids.erase(i->reqid))
+	  caller_ops[i->reqid] = &(*i);
+      }
+    }
+
     // actors
     void add(const pg_log_entry_t& e) {
       // add to log
@@ -432,6 +509,8 @@ protected:
   eversion_t dirty_from;       ///< must clear/writeout all keys >= dirty_from
   eversion_t writeout_from;    ///< must writout keys >= writeout_from
   set<eversion_t> trimmed;     ///< must clear keys in trimmed
+  /// packed omap segments on disk: first entry version -> last entry version
+  map<eversion_t, eversion_t> log_segments;
   CephContext *cct;
   bool pg_log_debug;
   /// Log is clean on [dirty_to, dirty_from)
@@ -1018,6 +1097,8 @@ public:
     bool touch_log,
     bool require_rollback,
     bool clear_divergent_priors,
+    map<eversion_t, eversion_t> *log_segments,
+    unsigned segment_entries,
     set<string> *log_keys_debug
     );
 
@@ -1034,7 +1115,8 @@ public:
       &clear_divergent_priors,
       this,
       (pg_log_debug ? &log_keys_debug : 0),
-      debug_verify_stored_missing);
+      debug_verify_stored_missing,
+      &log_segments);
   }
 
   template <typename missing_type>
@@ -1046,7 +1128,8 @@ public:
     bool *clear_divergent_priors = NULL,
     const DoutPrefixProvider *dpp = NULL,
     set<string> *log_keys_debug = 0,
-    bool debug_verify_stored_missing = false
+    bool debug_verify_stored_missing = false,
+    map<eversion_t, eversion_t> *log_segments = 0
     ) {
     ldpp_dout(dpp, 20) << "read_log_and_missing coll " << pg_coll
 		       << " log_oid " << log_oid << dendl;
@@ -1064,6 +1147,40 @@ public:
     ObjectMap::ObjectMapIterator p = store->get_omap_iterator(log_coll, log_oid);
     map<eversion_t, hobject_t> divergent_priors;
     bool has_divergent_priors = false;
+
+    // load the packed segment index, if any, so we know which keys hold
+    // runs of entries rather than a single one
+    map<string, eversion_t> segment_starts;
+    {
+      set<string> ikeys;
+      ikeys.insert("_log_segments");
+      map<string, bufferlist> ivals;
+      store->omap_get_values(log_coll, log_oid, ikeys, &ivals);
+      if (!ivals.empty()) {
+	map<eversion_t, eversion_t> segments;
+	bufferlist::iterator ip = ivals.begin()->second.begin();
+	::decode(segments, ip);
+	for (map<eversion_t, eversion_t>::iterator i = segments.begin();
+	     i != segments.end();
+	     ++i)
+	  segment_starts[i->first.get_key_name()] = i->second;
+	if (log_segments)
+	  log_segments->swap(segments);
+      }
+    }
+
+    auto add_log_entry = [&](pg_log_entry_t &e) {
+      ldpp_dout(dpp, 20) << "read_log_and_missing " << e << dendl;
+      if (!log.log.empty()) {
+	pg_log_entry_t last_e(log.log.back());
+	assert(last_e.version.version < e.version.version);
+	assert(last_e.version.epoch <= e.version.epoch);
+      }
+      log.log.push_back(e);
+      log.head = e.version;
+      if (log_keys_debug)
+	log_keys_debug->insert(e.get_key_name());
+    };
     if (p) {
       for (p->seek_to_first(); p->valid() ; p->next(false)) {
 	// non-log pgmeta_oid keys are prefixed with _; skip those
@@ -1085,19 +1202,22 @@ public:
 	  pair<hobject_t, pg_missing_item> p;
 	  ::decode(p, bp);
 	  missing.add(p.first, p.second.need, p.second.have);
+	} else if (!segment_starts.empty() &&
+		   segment_starts.count(p->key())) {
+	  // packed run of entries stored under the first entry's key
+	  __u32 n;
+	  ::decode(n, bp);
+	  while (n--) {
+	    pg_log_entry_t e;
+	    e.decode_with_checksum(bp);
+	    if (e.version <= log.tail)
+	      continue;  // trimmed out from under the segment
+	    add_log_entry(e);
+	  }
 	} else {
 	  pg_log_entry_t e;
 	  e.decode_with_checksum(bp);
-	  ldpp_dout(dpp, 20) << "read_log_and_missing " << e << dendl;
-	  if (!log.log.empty()) {
-	    pg_log_entry_t last_e(log.log.back());
-	    assert(last_e.version.version < e.version.version);
-	    assert(last_e.version.epoch <= e.version.epoch);
-	  }
-	  log.log.push_back(e);
-	  log.head = e.version;
-	  if (log_keys_debug)
-	    log_keys_debug->insert(e.get_key_name());
+	  add_log_entry(e);
 	}
       }
     }
@@ -49,6 +49,7 @@ static void log_subop_stats(
     if (subop == l_osd_sop_w) {
       logger->inc(l_osd_sop_w_inb, inb);
       logger->tinc(l_osd_sop_w_lat, latency);
+      logger->tinc(l_osd_sop_w_lat_hist, latency);
     } else if (subop == l_osd_sop_push) {
       logger->inc(l_osd_sop_push_inb, inb);
       logger->tinc(l_osd_sop_push_lat, latency);
@@ -488,7 +489,9 @@ public:
     assert(to_append);
     written += to_append->written;
     to_append->written = 0;
-    t.append((to_append->t));
+    // to_append wraps a locally built transaction that the caller
+    // discards after this, so its buffers can be claimed outright
+    t.claim_append(to_append->t);
     for (set<hobject_t, hobject_t::BitwiseComparator>::iterator i = to_append->temp_added.begin();
 	 i != to_append->temp_added.end();
 	 ++i) {
@@ -667,6 +670,7 @@ void ReplicatedBackend::sub_op_modify_reply(OpRequestRef op)
 {
   MOSDRepOpReply *r = static_cast<MOSDRepOpReply *>(op->get_req());
   r->finish_decode();
+  r->clear_payload();
   assert(r->get_header().type == MSG_OSD_REPOPREPLY);
 
   op->mark_started();
@@ -742,6 +746,42 @@ void ReplicatedBackend::be_deep_scrub(
   ThreadPool::TPHandle &handle)
 {
   dout(10) << __func__ << " " << poid << " seed " << seed << dendl;
+
+  // If the object has not been written since the last deep scrub and
+  // carries whole-object digests from that pass, we can report the
+  // stored digests instead of re-reading every byte.  The stored
+  // digests are only comparable for non-legacy scrubs (seed -1).
+  if (cct->_conf->osd_deep_scrub_skip_unmodified &&
+      seed == (uint32_t)-1) {
+    map<string, bufferptr>::iterator oip = o.attrs.find(OI_ATTR);
+    if (oip != o.attrs.end()) {
+      bufferlist oibl;
+      oibl.push_back(oip->second);
+      object_info_t oi;
+      bool valid = true;
+      try {
+	bufferlist::iterator bliter = oibl.begin();
+	::decode(oi, bliter);
+      } catch (...) {
+	// corrupt oi attr; take the full read path below so the scrub
+	// sees the damage
+	valid = false;
+      }
+      if (valid &&
+	  oi.version <= get_parent()->get_info().history.last_deep_scrub &&
+	  oi.is_data_digest() && oi.is_omap_digest()) {
+	dout(20) << __func__ << " " << poid << " not modified since "
+		 << get_parent()->get_info().history.last_deep_scrub
+		 << ", using stored digests" << dendl;
+	o.digest = oi.data_digest;
+	o.digest_present = true;
+	o.omap_digest = oi.omap_digest;
+	o.omap_digest_present = true;
+	return;
+      }
+    }
+  }
+
   bufferhash h(seed), oh(seed);
   bufferlist bl, hdrbl;
   int r;
@@ -991,10 +1031,10 @@ Message * ReplicatedBackend::generate_subop(
   eversion_t pg_trim_rollback_to,
   hobject_t new_temp_oid,
   hobject_t discard_temp_oid,
-  const vector<pg_log_entry_t> &log_entries,
+  const bufferlist &op_bl,
+  const bufferlist &log_bl,
   boost::optional<pg_hit_set_history_t> &hset_hist,
   InProgressOp *op,
-  ObjectStore::Transaction &op_t,
   pg_shard_t peer,
   const pg_info_t &pinfo)
 {
@@ -1017,10 +1057,10 @@ Message * ReplicatedBackend::generate_subop(
     ObjectStore::Transaction t;
     ::encode(t, wr->get_data());
   } else {
-    ::encode(op_t, wr->get_data());
+    wr->get_data().append(op_bl);  // shares the encoded buffers
   }
 
-  ::encode(log_entries, wr->logbl);
+  wr->logbl = log_bl;
 
   if (pinfo.is_incomplete())
     wr->pg_stats = pinfo.stats;  // reflects backfill progress
@@ -1059,6 +1099,15 @@ void ReplicatedBackend::issue_op(
     if (op->op)
       op->op->mark_sub_op_sent(ss.str());
   }
+
+  // encode the shipped transaction and log entries once; the resulting
+  // bufferlists are shared by reference across the per-peer messages
+  bufferlist op_bl, log_bl;
+  if (parent->get_actingbackfill_shards().size() > 1) {
+    ::encode(op_t, op_bl);
+    ::encode(log_entries, log_bl);
+  }
+
   for (set<pg_shard_t>::const_iterator i =
 	 parent->get_actingbackfill_shards().begin();
        i != parent->get_actingbackfill_shards().end();
@@ -1077,10 +1126,10 @@ void ReplicatedBackend::issue_op(
       pg_trim_rollback_to,
       new_temp_oid,
       discard_temp_oid,
-      log_entries,
+      op_bl,
+      log_bl,
       hset_hist,
       op,
-      op_t,
       peer,
       pinfo);
 
@@ -1094,6 +1143,7 @@ void ReplicatedBackend::sub_op_modify(OpRequestRef op)
 {
   MOSDRepOp *m = static_cast<MOSDRepOp *>(op->get_req());
   m->finish_decode();
+  m->clear_payload();
   int msg_type = m->get_type();
   assert(MSG_OSD_REPOP == msg_type);
 
@@ -1268,8 +1318,8 @@ void ReplicatedBackend::calc_head_subsets(
   ObjectContextRef obc, SnapSet& snapset, const hobject_t& head,
   const pg_missing_t& missing,
   const hobject_t &last_backfill,
-  interval_set<uint64_t>& data_subset,
-  map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets)
+  flat_interval_set<uint64_t>& data_subset,
+  map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets)
 {
   dout(10) << "calc_head_subsets " << head
 	   << " clone_overlap " << snapset.clone_overlap << dendl;
@@ -1289,8 +1339,8 @@ void ReplicatedBackend::calc_head_subsets(
   }
 
 
-  interval_set<uint64_t> cloning;
-  interval_set<uint64_t> prev;
+  flat_interval_set<uint64_t> cloning;
+  flat_interval_set<uint64_t> prev;
   if (size)
     prev.insert(0, size);
 
@@ -1329,8 +1379,8 @@ void ReplicatedBackend::calc_clone_subsets(
   SnapSet& snapset, const hobject_t& soid,
   const pg_missing_t& missing,
   const hobject_t &last_backfill,
-  interval_set<uint64_t>& data_subset,
-  map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets)
+  flat_interval_set<uint64_t>& data_subset,
+  map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets)
 {
   dout(10) << "calc_clone_subsets " << soid
 	   << " clone_overlap " << snapset.clone_overlap << dendl;
@@ -1355,8 +1405,8 @@ void ReplicatedBackend::calc_clone_subsets(
       break;
 
   // any overlap with next older clone?
-  interval_set<uint64_t> cloning;
-  interval_set<uint64_t> prev;
+  flat_interval_set<uint64_t> cloning;
+  flat_interval_set<uint64_t> prev;
   if (size)
     prev.insert(0, size);
   for (int j=i-1; j>=0; j--) {
@@ -1376,7 +1426,7 @@ void ReplicatedBackend::calc_clone_subsets(
   }
 
   // overlap with next newest?
-  interval_set<uint64_t> next;
+  flat_interval_set<uint64_t> next;
   if (size)
     next.insert(0, size);
   for (unsigned j=i+1; j<snapset.clones.size(); j++) {
@@ -1520,8 +1570,8 @@ void ReplicatedBackend::prep_push_to_replica(
   dout(10) << __func__ << ": " << soid << " v" << oi.version
 	   << " size " << size << " to osd." << peer << dendl;
 
-  map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator> clone_subsets;
-  interval_set<uint64_t> data_subset;
+  map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator> clone_subsets;
+  flat_interval_set<uint64_t> data_subset;
 
   // are we doing a clone on the replica?
   if (soid.snap && soid.snap < CEPH_NOSNAP) {
@@ -1575,10 +1625,10 @@ void ReplicatedBackend::prep_push(ObjectContextRef obc,
 			     const hobject_t& soid, pg_shard_t peer,
 			     PushOp *pop, bool cache_dont_need)
 {
-  interval_set<uint64_t> data_subset;
+  flat_interval_set<uint64_t> data_subset;
   if (obc->obs.oi.size)
     data_subset.insert(0, obc->obs.oi.size);
-  map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator> clone_subsets;
+  map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator> clone_subsets;
 
   prep_push(obc, soid, peer,
 	    obc->obs.oi.version, data_subset, clone_subsets,
@@ -1589,8 +1639,8 @@ void ReplicatedBackend::prep_push(
   ObjectContextRef obc,
   const hobject_t& soid, pg_shard_t peer,
   eversion_t version,
-  interval_set<uint64_t> &data_subset,
-  map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets,
+  flat_interval_set<uint64_t> &data_subset,
+  map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets,
   PushOp *pop,
   bool cache_dont_need)
 {
@@ -1608,6 +1658,7 @@ void ReplicatedBackend::prep_push(
   pi.recovery_progress.data_recovered_to = 0;
   pi.recovery_progress.data_complete = 0;
   pi.recovery_progress.omap_complete = 0;
+  pi.cache_dont_need = cache_dont_need;
 
   ObjectRecoveryProgress new_progress;
   int r = build_push_op(pi.recovery_info,
@@ -1617,6 +1668,27 @@ void ReplicatedBackend::prep_push(
 			&(pi.stat), cache_dont_need);
   assert(r == 0);
   pi.recovery_progress = new_progress;
+
+  // read the next chunk while the first one is on the wire
+  prefetch_push_chunk(&pi);
+}
+
+void ReplicatedBackend::prefetch_push_chunk(PushInfo *pi)
+{
+  if (!cct->_conf->osd_recovery_push_readahead)
+    return;
+  if (pi->recovery_progress.data_complete)
+    return;
+  dout(20) << __func__ << " " << pi->recovery_info.soid
+	   << " from " << pi->recovery_progress.data_recovered_to << dendl;
+  pi->next_op = PushOp();
+  int r = build_push_op(pi->recovery_info,
+			pi->recovery_progress,
+			&pi->next_progress,
+			&pi->next_op,
+			&(pi->stat), pi->cache_dont_need);
+  assert(r == 0);
+  pi->have_next = true;
 }
 
 int ReplicatedBackend::send_pull_legacy(int prio, pg_shard_t peer,
@@ -1659,7 +1731,7 @@ void ReplicatedBackend::submit_push_data(
   bool first,
   bool complete,
   bool cache_dont_need,
-  const interval_set<uint64_t> &intervals_included,
+  const flat_interval_set<uint64_t> &intervals_included,
   bufferlist data_included,
   bufferlist omap_header,
   map<string, bufferlist> &attrs,
@@ -1696,7 +1768,7 @@ void ReplicatedBackend::submit_push_data(
   uint32_t fadvise_flags = CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL;
   if (cache_dont_need)
     fadvise_flags |= CEPH_OSD_OP_FLAG_FADVISE_DONTNEED;
-  for (interval_set<uint64_t>::const_iterator p = intervals_included.begin();
+  for (flat_interval_set<uint64_t>::const_iterator p = intervals_included.begin();
        p != intervals_included.end();
        ++p) {
     bufferlist bit;
@@ -1728,11 +1800,11 @@ void ReplicatedBackend::submit_push_data(
 void ReplicatedBackend::submit_push_complete(ObjectRecoveryInfo &recovery_info,
 					     ObjectStore::Transaction *t)
 {
-  for (map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator>::const_iterator p =
+  for (map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator>::const_iterator p =
 	 recovery_info.clone_subset.begin();
        p != recovery_info.clone_subset.end();
        ++p) {
-    for (interval_set<uint64_t>::const_iterator q = p->second.begin();
+    for (flat_interval_set<uint64_t>::const_iterator q = p->second.begin();
 	 q != p->second.end();
 	 ++q) {
       dout(15) << " clone_range " << p->first << " "
@@ -1765,7 +1837,7 @@ bool ReplicatedBackend::handle_pull_response(
   ObjectStore::Transaction *t
   )
 {
-  interval_set<uint64_t> data_included = pop.data_included;
+  flat_interval_set<uint64_t> data_included = pop.data_included;
   bufferlist data;
   data.claim(pop.data);
   dout(10) << "handle_pull_response "
@@ -1812,7 +1884,7 @@ bool ReplicatedBackend::handle_pull_response(
   }
 
 
-  interval_set<uint64_t> usable_intervals;
+  flat_interval_set<uint64_t> usable_intervals;
   bufferlist usable_data;
   trim_pushed_data(pi.recovery_info.copy_subset,
 		   data_included,
@@ -2027,21 +2099,28 @@ int ReplicatedBackend::build_push_op(const ObjectRecoveryInfo &recovery_info,
 
   if (available > 0) {
     if (!recovery_info.copy_subset.empty()) {
-      interval_set<uint64_t> copy_subset = recovery_info.copy_subset;
-      bufferlist bl;
-      int r = store->fiemap(ch, ghobject_t(recovery_info.soid), 0,
-                            copy_subset.range_end(), bl);
-      if (r >= 0)  {
-        interval_set<uint64_t> fiemap_included;
-        map<uint64_t, uint64_t> m;
-        bufferlist::iterator iter = bl.begin();
-        ::decode(m, iter);
-        map<uint64_t, uint64_t>::iterator miter;
-        for (miter = m.begin(); miter != m.end(); ++miter) {
-          fiemap_included.insert(miter->first, miter->second);
+      flat_interval_set<uint64_t> copy_subset = recovery_info.copy_subset;
+      // only map the extents we might send in this chunk; everything
+      // before data_recovered_to has already gone out, and rescanning
+      // it for every chunk of a large push adds up
+      uint64_t scan_from = progress.data_recovered_to;
+      uint64_t scan_end = copy_subset.range_end();
+      if (scan_from < scan_end) {
+        bufferlist bl;
+        int r = store->fiemap(ch, ghobject_t(recovery_info.soid), scan_from,
+                              scan_end - scan_from, bl);
+        if (r >= 0)  {
+          flat_interval_set<uint64_t> fiemap_included;
+          map<uint64_t, uint64_t> m;
+          bufferlist::iterator iter = bl.begin();
+          ::decode(m, iter);
+          map<uint64_t, uint64_t>::iterator miter;
+          for (miter = m.begin(); miter != m.end(); ++miter) {
+            fiemap_included.insert(miter->first, miter->second);
+          }
+
+          copy_subset.intersection_of(fiemap_included);
         }
-
-        copy_subset.intersection_of(fiemap_included);
       }
       out_op->data_included.span_of(copy_subset, progress.data_recovered_to,
                                     available);
@@ -2054,9 +2133,9 @@ int ReplicatedBackend::build_push_op(const ObjectRecoveryInfo &recovery_info,
     out_op->data_included.clear();
   }
 
-  for (interval_set<uint64_t>::iterator p = out_op->data_included.begin();
+  for (flat_interval_set<uint64_t>::iterator p = out_op->data_included.begin();
        p != out_op->data_included.end();
-       ++p) {
+       ) {
     bufferlist bit;
     store->read(ch, ghobject_t(recovery_info.soid),
 		p.get_start(), p.get_len(), bit,
@@ -2065,21 +2144,21 @@ int ReplicatedBackend::build_push_op(const ObjectRecoveryInfo &recovery_info,
       dout(10) << " extent " << p.get_start() << "~" << p.get_len()
 	       << " is actually " << p.get_start() << "~" << bit.length()
 	       << dendl;
-      interval_set<uint64_t>::iterator save = p++;
-      if (bit.length() == 0)
-        out_op->data_included.erase(save);     //Remove this empty interval
-      else
-        save.set_len(bit.length());
-      // Remove any other intervals present
-      while (p != out_op->data_included.end()) {
-        interval_set<uint64_t>::iterator save = p++;
-        out_op->data_included.erase(save);
+      if (bit.length() == 0) {
+        p = out_op->data_included.erase(p);    //Remove this empty interval
+      } else {
+        p.set_len(bit.length());
+        ++p;
       }
+      // Remove any other intervals present
+      while (p != out_op->data_included.end())
+        p = out_op->data_included.erase(p);
       new_progress.data_complete = true;
       out_op->data.claim_append(bit);
       break;
     }
     out_op->data.claim_append(bit);
+    ++p;
   }
 
   if (new_progress.is_complete(recovery_info)) {
@@ -2177,12 +2256,21 @@ bool ReplicatedBackend::handle_push_reply(pg_shard_t peer, PushReplyOp &op, Push
 	       << pi->recovery_progress.data_recovered_to
 	       << " of " << pi->recovery_info.copy_subset << dendl;
       ObjectRecoveryProgress new_progress;
-      int r = build_push_op(
-	pi->recovery_info,
-	pi->recovery_progress, &new_progress, reply,
-	&(pi->stat));
-      assert(r == 0);
+      if (pi->have_next) {
+	// consume the chunk we read ahead while waiting for this ack
+	*reply = pi->next_op;
+	new_progress = pi->next_progress;
+	pi->have_next = false;
+      } else {
+	int r = build_push_op(
+	  pi->recovery_info,
+	  pi->recovery_progress, &new_progress, reply,
+	  &(pi->stat));
+	assert(r == 0);
+      }
       pi->recovery_progress = new_progress;
+      // overlap the next read with this chunk's network round trip
+      prefetch_push_chunk(pi);
       return true;
     } else {
       // done!
@@ -2283,10 +2371,10 @@ void ReplicatedBackend::handle_pull(pg_shard_t peer, PullOp &op, PushOp *reply)
  * @param data_usable matching data we want to keep
  */
 void ReplicatedBackend::trim_pushed_data(
-  const interval_set<uint64_t> &copy_subset,
-  const interval_set<uint64_t> &intervals_received,
+  const flat_interval_set<uint64_t> &copy_subset,
+  const flat_interval_set<uint64_t> &intervals_received,
   bufferlist data_received,
-  interval_set<uint64_t> *intervals_usable,
+  flat_interval_set<uint64_t> *intervals_usable,
   bufferlist *data_usable)
 {
   if (intervals_received.subset_of(copy_subset)) {
@@ -2299,13 +2387,13 @@ void ReplicatedBackend::trim_pushed_data(
 				    intervals_received);
 
   uint64_t off = 0;
-  for (interval_set<uint64_t>::const_iterator p = intervals_received.begin();
+  for (flat_interval_set<uint64_t>::const_iterator p = intervals_received.begin();
        p != intervals_received.end();
        ++p) {
-    interval_set<uint64_t> x;
+    flat_interval_set<uint64_t> x;
     x.insert(p.get_start(), p.get_len());
     x.intersection_of(copy_subset);
-    for (interval_set<uint64_t>::const_iterator q = x.begin();
+    for (flat_interval_set<uint64_t>::const_iterator q = x.begin();
 	 q != x.end();
 	 ++q) {
       bufferlist sub;
@@ -169,6 +169,14 @@ private:
     ObjectRecoveryInfo recovery_info;
     ObjectContextRef obc;
     object_stat_sum_t stat;
+    bool cache_dont_need;
+
+    /// next chunk, read ahead while the previous one is on the wire
+    PushOp next_op;
+    ObjectRecoveryProgress next_progress;
+    bool have_next;
+
+    PushInfo() : cache_dont_need(true), have_next(false) {}
 
     void dump(Formatter *f) const {
       {
@@ -242,10 +250,10 @@ private:
   void handle_push(pg_shard_t from, PushOp &op, PushReplyOp *response,
 		   ObjectStore::Transaction *t);
 
-  static void trim_pushed_data(const interval_set<uint64_t> &copy_subset,
-			       const interval_set<uint64_t> &intervals_received,
+  static void trim_pushed_data(const flat_interval_set<uint64_t> &copy_subset,
+			       const flat_interval_set<uint64_t> &intervals_received,
 			       bufferlist data_received,
-			       interval_set<uint64_t> *intervals_usable,
+			       flat_interval_set<uint64_t> *intervals_usable,
 			       bufferlist *data_usable);
   void _failed_push(pg_shard_t from, const hobject_t &soid);
 
@@ -270,7 +278,7 @@ private:
 			bool first,
 			bool complete,
 			bool cache_dont_need,
-			const interval_set<uint64_t> &intervals_included,
+			const flat_interval_set<uint64_t> &intervals_included,
 			bufferlist data_included,
 			bufferlist omap_header,
 			map<string, bufferlist> &attrs,
@@ -282,8 +290,8 @@ private:
   void calc_clone_subsets(
     SnapSet& snapset, const hobject_t& poid, const pg_missing_t& missing,
     const hobject_t &last_backfill,
-    interval_set<uint64_t>& data_subset,
-    map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets);
+    flat_interval_set<uint64_t>& data_subset,
+    map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets);
   void prepare_pull(
     eversion_t v,
     const hobject_t& soid,
@@ -303,15 +311,16 @@ private:
   void prep_push(ObjectContextRef obc,
 		 const hobject_t& soid, pg_shard_t peer,
 		 eversion_t version,
-		 interval_set<uint64_t> &data_subset,
-		 map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets,
+		 flat_interval_set<uint64_t> &data_subset,
+		 map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets,
 		 PushOp *op,
                  bool cache = false);
+  void prefetch_push_chunk(PushInfo *pi);
   void calc_head_subsets(ObjectContextRef obc, SnapSet& snapset, const hobject_t& head,
 			 const pg_missing_t& missing,
 			 const hobject_t &last_backfill,
-			 interval_set<uint64_t>& data_subset,
-			 map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets);
+			 flat_interval_set<uint64_t>& data_subset,
+			 map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator>& clone_subsets);
   ObjectRecoveryInfo recalc_subsets(
     const ObjectRecoveryInfo& recovery_info,
     SnapSetContext *ssc
@@ -369,10 +378,10 @@ private:
     eversion_t pg_trim_rollback_to,
     hobject_t new_temp_oid,
     hobject_t discard_temp_oid,
-    const vector<pg_log_entry_t> &log_entries,
+    const bufferlist &op_bl,
+    const bufferlist &log_bl,
     boost::optional<pg_hit_set_history_t> &hset_history,
     InProgressOp *op,
-    ObjectStore::Transaction &op_t,
     pg_shard_t peer,
     const pg_info_t &pinfo);
   void issue_op(
@@ -1402,7 +1402,8 @@ ReplicatedPG::ReplicatedPG(OSDService *o, OSDMapRef curmap,
   pgbackend(
     PGBackend::build_pg_backend(
       _pool.info, curmap, this, coll_t(p), ch, o->store, cct)),
-  object_contexts(o->cct, g_conf->osd_pg_object_context_cache_count),
+  object_contexts(o->cct, g_conf->osd_pg_object_context_cache_count,
+		  g_conf->osd_pg_object_context_cache_shards),
   snapset_contexts_lock("ReplicatedPG::snapset_contexts_lock"),
   backfills_in_flight(hobject_t::Comparator(true)),
   pending_backfill_updates(hobject_t::Comparator(true)),
@@ -1621,24 +1622,24 @@ void ReplicatedPG::do_op(OpRequestRef& op)
 		 info.pgid.pool(), m->get_object_locator().nspace);
 
   // object name too long?
-  if (m->get_oid().name.size() > g_conf->osd_max_object_name_len) {
+  if (m->get_oid().name.size() > osd->op_limits.max_object_name_len) {
     dout(4) << "do_op name is longer than "
-            << g_conf->osd_max_object_name_len
+            << osd->op_limits.max_object_name_len
 	    << " bytes" << dendl;
     osd->reply_op_error(op, -ENAMETOOLONG);
     return;
   }
-  if (m->get_object_locator().key.size() > g_conf->osd_max_object_name_len) {
+  if (m->get_object_locator().key.size() > osd->op_limits.max_object_name_len) {
     dout(4) << "do_op locator is longer than "
-            << g_conf->osd_max_object_name_len
+            << osd->op_limits.max_object_name_len
 	    << " bytes" << dendl;
     osd->reply_op_error(op, -ENAMETOOLONG);
     return;
   }
   if (m->get_object_locator().nspace.size() >
-      g_conf->osd_max_object_namespace_len) {
+      osd->op_limits.max_object_namespace_len) {
     dout(4) << "do_op namespace is longer than "
-            << g_conf->osd_max_object_namespace_len
+            << osd->op_limits.max_object_namespace_len
 	    << " bytes" << dendl;
     osd->reply_op_error(op, -ENAMETOOLONG);
     return;
@@ -1698,11 +1699,11 @@ void ReplicatedPG::do_op(OpRequestRef& op)
     }
 
     // too big?
-    if (cct->_conf->osd_max_write_size &&
-        m->get_data_len() > cct->_conf->osd_max_write_size << 20) {
+    if (osd->op_limits.max_write_size &&
+        m->get_data_len() > osd->op_limits.max_write_size << 20) {
       // journal can't hold commit!
       derr << "do_op msg data len " << m->get_data_len()
-           << " > osd_max_write_size " << (cct->_conf->osd_max_write_size << 20)
+           << " > osd_max_write_size " << (osd->op_limits.max_write_size << 20)
            << " on " << *m << dendl;
       osd->reply_op_error(op, -OSD_WRITETOOBIG);
       return;
@@ -2486,7 +2487,9 @@ struct C_ProxyRead : public Context {
     }
     if (last_peering_reset == pg->get_last_peering_reset()) {
       pg->finish_proxy_read(oid, tid, r);
-      pg->osd->logger->tinc(l_osd_tier_r_lat, ceph_clock_now(NULL) - start);
+      utime_t lat = ceph_clock_now(NULL) - start;
+      pg->osd->logger->tinc(l_osd_tier_r_lat, lat);
+      pg->osd->record_proxy_read_latency(lat);
     }
     pg->unlock();
   }
@@ -3180,6 +3183,8 @@ void ReplicatedPG::log_op_stats(OpContext *ctx)
   osd->logger->inc(l_osd_op_inb, inb);
   osd->logger->tinc(l_osd_op_lat, latency);
   osd->logger->tinc(l_osd_op_process_lat, process_latency);
+  osd->logger->tinc(l_osd_op_lat_hist, latency);
+  osd->logger->tinc(l_osd_op_process_lat_hist, process_latency);
 
   if (op->may_read() && op->may_write()) {
     osd->logger->inc(l_osd_op_rw);
@@ -4234,9 +4239,9 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
     // munge ZERO -> TRUNCATE?  (don't munge to DELETE or we risk hosing attributes)
     if (op.op == CEPH_OSD_OP_ZERO &&
 	obs.exists &&
-	op.extent.offset < cct->_conf->osd_max_object_size &&
+	op.extent.offset < osd->op_limits.max_object_size &&
 	op.extent.length >= 1 &&
-	op.extent.length <= cct->_conf->osd_max_object_size &&
+	op.extent.length <= osd->op_limits.max_object_size &&
 	op.extent.offset + op.extent.length >= oi.size) {
       if (op.extent.offset >= oi.size) {
         // no-op
@@ -4494,11 +4499,10 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	tracepoint(osd, do_osd_op_pre_call, soid.oid.name.c_str(), soid.snap.val, cname.c_str(), mname.c_str());
 
 	ClassHandler::ClassData *cls;
-	result = osd->class_handler->open_class(cname, &cls);
-	assert(result == 0);   // init_op_flags() already verified this works.
-
-	ClassHandler::ClassMethod *method = cls->get_method(mname.c_str());
-	if (!method) {
+	ClassHandler::ClassMethod *method;
+	result = osd->class_handler->open_method(cname, mname, &cls, &method);
+	assert(result == 0 || result == -ENOENT);  // init_op_flags() already verified the class loads.
+	if (result == -ENOENT) {
 	  dout(10) << "call method " << cname << "." << mname << " does not exist" << dendl;
 	  result = -EOPNOTSUPP;
 	  break;
@@ -5087,7 +5091,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	    oi.truncate_size = op.extent.truncate_size;
 	  }
 	}
-	result = check_offset_and_length(op.extent.offset, op.extent.length, cct->_conf->osd_max_object_size);
+	result = check_offset_and_length(op.extent.offset, op.extent.length, osd->op_limits.max_object_size);
 	if (result < 0)
 	  break;
 	if (pool.info.require_rollback()) {
@@ -5118,7 +5122,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	  result = -EINVAL;
 	  break;
 	}
-	result = check_offset_and_length(0, op.extent.length, cct->_conf->osd_max_object_size);
+	result = check_offset_and_length(0, op.extent.length, osd->op_limits.max_object_size);
 	if (result < 0)
 	  break;
 
@@ -5186,7 +5190,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
       }
       ++ctx->num_write;
       { // zero
-	result = check_offset_and_length(op.extent.offset, op.extent.length, cct->_conf->osd_max_object_size);
+	result = check_offset_and_length(op.extent.offset, op.extent.length, osd->op_limits.max_object_size);
 	if (result < 0)
 	  break;
 	assert(op.extent.length);
@@ -5257,7 +5261,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	  break;
 	}
 
-	if (op.extent.offset > cct->_conf->osd_max_object_size) {
+	if (op.extent.offset > osd->op_limits.max_object_size) {
 	  result = -EFBIG;
 	  break;
 	}
@@ -5459,14 +5463,14 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
     case CEPH_OSD_OP_SETXATTR:
       ++ctx->num_write;
       {
-	if (cct->_conf->osd_max_attr_size > 0 &&
-	    op.xattr.value_len > cct->_conf->osd_max_attr_size) {
+	if (osd->op_limits.max_attr_size > 0 &&
+	    op.xattr.value_len > osd->op_limits.max_attr_size) {
 	  tracepoint(osd, do_osd_op_pre_setxattr, soid.oid.name.c_str(), soid.snap.val, "???");
 	  result = -EFBIG;
 	  break;
 	}
 	unsigned max_name_len = MIN(osd->store->get_max_attr_name_length(),
-				    cct->_conf->osd_max_attr_name_len);
+				    osd->op_limits.max_attr_name_len);
 	if (op.xattr.name_len > max_name_len) {
 	  result = -ENAMETOOLONG;
 	  break;
@@ -5859,7 +5863,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	  goto fail;
 	}
 	tracepoint(osd, do_osd_op_pre_omapsetvals, soid.oid.name.c_str(), soid.snap.val);
-	if (g_ceph_context->_conf->subsys.should_gather(dout_subsys, 20)) {
+	if (g_ceph_context->_conf->subsys.should_gather<dout_subsys, 20>()) {
 	  dout(20) << "setting vals: " << dendl;
 	  map<string,bufferlist> to_set;
 	  bufferlist::iterator pt = to_set_bl.begin();
@@ -6343,6 +6347,7 @@ void ReplicatedPG::make_writeable(OpContext *ctx)
 {
   const hobject_t& soid = ctx->obs->oi.soid;
   SnapContext& snapc = ctx->snapc;
+  utime_t start = ceph_clock_now(NULL);
 
   // clone?
   assert(soid.snap == CEPH_NOSNAP);
@@ -6495,6 +6500,12 @@ void ReplicatedPG::make_writeable(OpContext *ctx)
   ctx->new_snapset.seq = snapc.seq;
   ctx->new_snapset.snaps = snapc.snaps;
   ctx->new_snapset.head_exists = ctx->new_obs.exists;
+
+  // account for the per-write cost of maintaining snap metadata
+  if (!ctx->new_snapset.clones.empty()) {
+    osd->logger->inc(l_osd_snap_writes);
+    osd->logger->tinc(l_osd_snap_write_lat, ceph_clock_now(NULL) - start);
+  }
   dout(20) << "make_writeable " << soid << " done, snapset=" << ctx->new_snapset << dendl;
 }
 
@@ -13108,10 +13119,14 @@ boost::statechart::result ReplicatedPG::TrimmingObjects::react(const SnapTrim&)
 
   dout(10) << "TrimmingObjects: trimming snap " << snap_to_trim << dendl;
 
-  while (in_flight.size() < g_conf->osd_pg_max_concurrent_snap_trims) {
-    // Get next
-    hobject_t old_pos = pos;
-    int r = pg->snap_mapper.get_next_object_to_trim(snap_to_trim, &pos);
+  unsigned max_trims = g_conf->osd_pg_max_concurrent_snap_trims;
+  while (in_flight.size() < max_trims) {
+    // Get the next batch in one mapper query instead of one query per
+    // clone; mappings for in-flight clones are still present, so skip
+    // those below.
+    vector<hobject_t> to_trim;
+    int r = pg->snap_mapper.get_next_objects_to_trim(
+      snap_to_trim, max_trims, &to_trim);
     if (r != 0 && r != -ENOENT) {
       derr << __func__ << ": get_next returned " << cpp_strerror(r) << dendl;
       assert(0);
@@ -13122,26 +13137,39 @@ boost::statechart::result ReplicatedPG::TrimmingObjects::react(const SnapTrim&)
       return transit< WaitingOnReplicas >();
     }
 
-    dout(10) << "TrimmingObjects react trimming " << pos << dendl;
-    OpContextUPtr ctx = pg->trim_object(pos);
-    if (!ctx) {
-      dout(10) << __func__ << " could not get write lock on obj "
-	       << pos << dendl;
-      pos = old_pos;
+    bool submitted = false;
+    for (vector<hobject_t>::iterator i = to_trim.begin();
+	 i != to_trim.end() && in_flight.size() < max_trims;
+	 ++i) {
+      if (in_flight.count(*i))
+	continue;
+      pos = *i;
+      dout(10) << "TrimmingObjects react trimming " << pos << dendl;
+      OpContextUPtr ctx = pg->trim_object(pos);
+      if (!ctx) {
+	dout(10) << __func__ << " could not get write lock on obj "
+		 << pos << dendl;
+	return discard_event();
+      }
+      assert(ctx);
+      hobject_t to_remove = pos;
+      ctx->register_on_success(
+	[pg, to_remove, &in_flight]() {
+	  in_flight.erase(to_remove);
+	  pg->queue_snap_trim();
+	});
+
+      pg->apply_ctx_stats(ctx.get());
+
+      in_flight.insert(pos);
+      pg->simple_opc_submit(std::move(ctx));
+      submitted = true;
+    }
+    if (!submitted) {
+      // everything the mapper returned is already in flight; wait for
+      // some of it to complete
       return discard_event();
     }
-    assert(ctx);
-    hobject_t to_remove = pos;
-    ctx->register_on_success(
-      [pg, to_remove, &in_flight]() {
-	in_flight.erase(to_remove);
-	pg->queue_snap_trim();
-      });
-
-    pg->apply_ctx_stats(ctx.get());
-
-    in_flight.insert(pos);
-    pg->simple_opc_submit(std::move(ctx));
   }
   return discard_event();
 }
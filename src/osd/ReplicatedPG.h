@@ -1001,8 +1001,9 @@ protected:
     return true;
   }
 
-  // projected object info
-  SharedLRU<hobject_t, ObjectContext, hobject_t::ComparatorWithDefault> object_contexts;
+  // projected object info, hash-sharded so obc lookups and ref-drop
+  // cleanups on different objects do not contend on one cache mutex
+  ShardedSharedLRU<hobject_t, ObjectContext, hobject_t::ComparatorWithDefault> object_contexts;
   // map from oid.snapdir() to SnapSetContext *
   map<hobject_t, SnapSetContext*, hobject_t::BitwiseComparator> snapset_contexts;
   Mutex snapset_contexts_lock;
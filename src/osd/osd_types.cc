@@ -2288,8 +2288,33 @@ void pg_stat_t::dump_brief(Formatter *f) const
   f->dump_int("acting_primary", acting_primary);
 }
 
+size_t pg_stat_t::estimate_encoded_size() const
+{
+  const size_t eversion_size = sizeof(version_t) + sizeof(epoch_t);
+  const size_t pg_t_size = sizeof(__u8) + 8 + 4 + 4;
+  return ENCODE_HEADER_SIZE +
+    3 * eversion_size +          // version, log_start, ondisk_log_start
+    2 * eversion_size +          // last_scrub, last_deep_scrub
+    sizeof(uint64_t) +           // reported_seq
+    4 * sizeof(epoch_t) +        // reported_epoch, created, last_epoch_clean,
+				 // mapping_epoch
+    sizeof(uint32_t) +           // state
+    pg_t_size +                  // parent
+    sizeof(__u32) +              // parent_split_bits
+    13 * sizeof(utime_t) +       // the last_* stamps
+    (ENCODE_HEADER_SIZE +        // stats (object_stat_collection_t)
+     ENCODE_HEADER_SIZE + sizeof(object_stat_sum_t) +
+     sizeof(__u32)) +
+    2 * sizeof(int64_t) +        // log_size, ondisk_log_size
+    3 * (sizeof(__u32)) +        // up, acting, blocked_by vector counts
+    (up.size() + acting.size() + blocked_by.size()) * sizeof(int32_t) +
+    2 * sizeof(int32_t) +        // up_primary, acting_primary
+    6 * sizeof(__u8);            // the *_invalid bools
+}
+
 void pg_stat_t::encode(bufferlist &bl) const
 {
+  bl.reserve(estimate_encoded_size());
   ENCODE_START(22, 8, bl);
   ::encode(version, bl);
   ::encode(reported_seq, bl);
@@ -2580,6 +2605,132 @@ bool operator==(const pg_stat_t& l, const pg_stat_t& r)
     l.pin_stats_invalid == r.pin_stats_invalid;
 }
 
+// -- pg_stat_delta_t --
+
+bool pg_stat_delta_t::can_represent(const pg_stat_t& base, const pg_stat_t& cur)
+{
+  pg_stat_t t(cur);
+  t.reported_seq = base.reported_seq;
+  t.reported_epoch = base.reported_epoch;
+  t.state = base.state;
+  t.last_fresh = base.last_fresh;
+  t.last_change = base.last_change;
+  t.last_active = base.last_active;
+  t.last_peered = base.last_peered;
+  t.last_clean = base.last_clean;
+  t.last_unstale = base.last_unstale;
+  t.last_undegraded = base.last_undegraded;
+  t.last_fullsized = base.last_fullsized;
+  t.last_became_active = base.last_became_active;
+  t.last_became_peered = base.last_became_peered;
+  return t == base;
+}
+
+void pg_stat_delta_t::take_from(const pg_stat_t& cur)
+{
+  reported_seq = cur.reported_seq;
+  reported_epoch = cur.reported_epoch;
+  state = cur.state;
+  last_fresh = cur.last_fresh;
+  last_change = cur.last_change;
+  last_active = cur.last_active;
+  last_peered = cur.last_peered;
+  last_clean = cur.last_clean;
+  last_unstale = cur.last_unstale;
+  last_undegraded = cur.last_undegraded;
+  last_fullsized = cur.last_fullsized;
+  last_became_active = cur.last_became_active;
+  last_became_peered = cur.last_became_peered;
+}
+
+void pg_stat_delta_t::apply_to(pg_stat_t *s) const
+{
+  s->reported_seq = reported_seq;
+  s->reported_epoch = reported_epoch;
+  s->state = state;
+  s->last_fresh = last_fresh;
+  s->last_change = last_change;
+  s->last_active = last_active;
+  s->last_peered = last_peered;
+  s->last_clean = last_clean;
+  s->last_unstale = last_unstale;
+  s->last_undegraded = last_undegraded;
+  s->last_fullsized = last_fullsized;
+  s->last_became_active = last_became_active;
+  s->last_became_peered = last_became_peered;
+}
+
+void pg_stat_delta_t::dump(Formatter *f) const
+{
+  f->dump_unsigned("base_seq", base_seq);
+  f->dump_unsigned("reported_seq", reported_seq);
+  f->dump_unsigned("reported_epoch", reported_epoch);
+  f->dump_string("state", pg_state_string(state));
+  f->dump_stream("last_fresh") << last_fresh;
+  f->dump_stream("last_change") << last_change;
+  f->dump_stream("last_active") << last_active;
+  f->dump_stream("last_peered") << last_peered;
+  f->dump_stream("last_clean") << last_clean;
+  f->dump_stream("last_unstale") << last_unstale;
+  f->dump_stream("last_undegraded") << last_undegraded;
+  f->dump_stream("last_fullsized") << last_fullsized;
+  f->dump_stream("last_became_active") << last_became_active;
+  f->dump_stream("last_became_peered") << last_became_peered;
+}
+
+void pg_stat_delta_t::encode(bufferlist &bl) const
+{
+  ENCODE_START(1, 1, bl);
+  ::encode(base_seq, bl);
+  ::encode(reported_seq, bl);
+  ::encode(reported_epoch, bl);
+  ::encode(state, bl);
+  ::encode(last_fresh, bl);
+  ::encode(last_change, bl);
+  ::encode(last_active, bl);
+  ::encode(last_peered, bl);
+  ::encode(last_clean, bl);
+  ::encode(last_unstale, bl);
+  ::encode(last_undegraded, bl);
+  ::encode(last_fullsized, bl);
+  ::encode(last_became_active, bl);
+  ::encode(last_became_peered, bl);
+  ENCODE_FINISH(bl);
+}
+
+void pg_stat_delta_t::decode(bufferlist::iterator &bl)
+{
+  DECODE_START(1, bl);
+  ::decode(base_seq, bl);
+  ::decode(reported_seq, bl);
+  ::decode(reported_epoch, bl);
+  ::decode(state, bl);
+  ::decode(last_fresh, bl);
+  ::decode(last_change, bl);
+  ::decode(last_active, bl);
+  ::decode(last_peered, bl);
+  ::decode(last_clean, bl);
+  ::decode(last_unstale, bl);
+  ::decode(last_undegraded, bl);
+  ::decode(last_fullsized, bl);
+  ::decode(last_became_active, bl);
+  ::decode(last_became_peered, bl);
+  DECODE_FINISH(bl);
+}
+
+void pg_stat_delta_t::generate_test_instances(list<pg_stat_delta_t*>& o)
+{
+  o.push_back(new pg_stat_delta_t);
+  pg_stat_delta_t a;
+  a.base_seq = 1;
+  a.reported_seq = 2;
+  a.reported_epoch = 3;
+  a.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+  a.last_fresh = utime_t(4, 5);
+  a.last_clean = utime_t(6, 7);
+  o.push_back(new pg_stat_delta_t(a));
+}
+
 // -- pool_stat_t --
 
 void pool_stat_t::dump(Formatter *f) const
@@ -3412,7 +3563,7 @@ string pg_log_entry_t::get_key_name() const
 
 void pg_log_entry_t::encode_with_checksum(bufferlist& bl) const
 {
-  bufferlist ebl(sizeof(*this)*2);
+  bufferlist ebl(estimate_encoded_size());
   encode(ebl);
   __u32 crc = ebl.crc32c(0);
   ::encode(ebl, bl);
@@ -3431,8 +3582,30 @@ void pg_log_entry_t::decode_with_checksum(bufferlist::iterator& p)
   decode(q);
 }
 
+size_t pg_log_entry_t::estimate_encoded_size() const
+{
+  const size_t eversion_size = sizeof(version_t) + sizeof(epoch_t);
+  const size_t reqid_size = ENCODE_HEADER_SIZE +
+    9 +                          // entity_name_t (type + num)
+    sizeof(ceph_tid_t) +
+    sizeof(int32_t);             // inc
+  return ENCODE_HEADER_SIZE +
+    sizeof(__s32) +              // op
+    soid.estimate_encoded_size() +
+    3 * eversion_size +          // version, prior_version, reverting_to
+    reqid_size +
+    sizeof(utime_t) +            // mtime
+    ::estimate_encoded_size(snaps) +
+    sizeof(version_t) +          // user_version
+    mod_desc.estimate_encoded_size() +
+    sizeof(__u32) +
+    extra_reqids.size() * (reqid_size + sizeof(version_t)) +
+    sizeof(int32_t);             // return_code
+}
+
 void pg_log_entry_t::encode(bufferlist &bl) const
 {
+  bl.reserve(estimate_encoded_size());
   ENCODE_START(11, 4, bl);
   ::encode(op, bl);
   ::encode(soid, bl);
@@ -4483,8 +4656,39 @@ ps_t object_info_t::legacy_object_locator_to_ps(const object_t &oid,
   return ps;
 }
 
+size_t object_info_t::estimate_encoded_size() const
+{
+  const size_t eversion_size = sizeof(version_t) + sizeof(epoch_t);
+  const size_t reqid_size = ENCODE_HEADER_SIZE + 9 +
+    sizeof(ceph_tid_t) + sizeof(int32_t);
+  // per-watcher bound: map key (cookie + entity_name_t) plus
+  // watch_info_t (cookie, timeout and an entity_addr_t)
+  const size_t watcher_size = 8 + 9 +
+    ENCODE_HEADER_SIZE + 8 + 4 + 136;
+  const size_t oloc_size = ENCODE_HEADER_SIZE + 8 + 4 + 8 +
+    ::estimate_encoded_size(soid.get_key()) +
+    ::estimate_encoded_size(soid.nspace);
+  return ENCODE_HEADER_SIZE +
+    soid.estimate_encoded_size() +
+    oloc_size +
+    sizeof(__u32) +              // old category
+    3 * eversion_size +          // version, prior_version, user_eversion
+    2 * reqid_size +             // last_reqid, wrlock_by placeholder
+    sizeof(uint64_t) +           // size
+    2 * sizeof(utime_t) +        // mtime, local_mtime
+    sizeof(__u32) + snaps.size() * sizeof(snapid_t) +
+    2 * sizeof(uint64_t) +       // truncate_seq, truncate_size
+    2 * sizeof(__u8) +           // lost, uses_tmap
+    2 * (sizeof(__u32) + watchers.size() * watcher_size) +
+    sizeof(__u32) +              // flags
+    2 * sizeof(__u32) +          // data_digest, omap_digest
+    2 * sizeof(uint64_t) +       // expected_object_size, expected_write_size
+    sizeof(uint32_t);            // alloc_hint_flags
+}
+
 void object_info_t::encode(bufferlist& bl, uint64_t features) const
 {
+  bl.reserve(estimate_encoded_size());
   object_locator_t myoloc(soid);
   map<entity_name_t, watch_info_t> old_watchers;
   for (map<pair<uint64_t, entity_name_t>, watch_info_t>::const_iterator i =
@@ -4775,9 +4979,9 @@ void ObjectRecoveryInfo::decode(bufferlist::iterator &bl,
   if (struct_v < 2) {
     if (!soid.is_max() && soid.pool == -1)
       soid.pool = pool;
-    map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator> tmp;
+    map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator> tmp;
     tmp.swap(clone_subset);
-    for (map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator>::iterator i = tmp.begin();
+    for (map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator>::iterator i = tmp.begin();
 	 i != tmp.end();
 	 ++i) {
       hobject_t first(i->first);
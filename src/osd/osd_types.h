@@ -33,6 +33,7 @@
 #include "include/CompatSet.h"
 #include "common/histogram.h"
 #include "include/interval_set.h"
+#include "include/flat_interval_set.h"
 #include "include/inline_memory.h"
 #include "common/Formatter.h"
 #include "common/bloom_filter.hpp"
@@ -1895,6 +1896,7 @@ struct pg_stat_t {
   bool is_acting_osd(int32_t osd, bool primary) const;
   void dump(Formatter *f) const;
   void dump_brief(Formatter *f) const;
+  size_t estimate_encoded_size() const;
   void encode(bufferlist &bl) const;
   void decode(bufferlist::iterator &bl);
   static void generate_test_instances(list<pg_stat_t*>& o);
@@ -1903,6 +1905,49 @@ WRITE_CLASS_ENCODER(pg_stat_t)
 
 bool operator==(const pg_stat_t& l, const pg_stat_t& r);
 
+/**
+ * delta against a previously reported pg_stat_t
+ *
+ * During steady state only the report sequence, state, and freshness
+ * timestamps of a pg's stats move; everything else (object sums, log
+ * bounds, mappings, ...) is unchanged from the last report the mon
+ * acknowledged.  This carries just those hot fields plus the sequence
+ * number of the report it applies on top of, so an idle-but-healthy
+ * osd can report without shipping the whole pg_stat_t.
+ */
+struct pg_stat_delta_t {
+  version_t base_seq;      ///< reported_seq this delta applies on top of
+  version_t reported_seq;
+  epoch_t reported_epoch;
+  __u32 state;
+  utime_t last_fresh;
+  utime_t last_change;
+  utime_t last_active;
+  utime_t last_peered;
+  utime_t last_clean;
+  utime_t last_unstale;
+  utime_t last_undegraded;
+  utime_t last_fullsized;
+  utime_t last_became_active;
+  utime_t last_became_peered;
+
+  pg_stat_delta_t()
+    : base_seq(0), reported_seq(0), reported_epoch(0), state(0)
+  { }
+
+  /// can cur be expressed as a delta against base?
+  static bool can_represent(const pg_stat_t& base, const pg_stat_t& cur);
+
+  void take_from(const pg_stat_t& cur);
+  void apply_to(pg_stat_t *s) const;
+
+  void dump(Formatter *f) const;
+  void encode(bufferlist &bl) const;
+  void decode(bufferlist::iterator &bl);
+  static void generate_test_instances(list<pg_stat_delta_t*>& o);
+};
+WRITE_CLASS_ENCODER(pg_stat_delta_t)
+
 /*
  * summation over an entire pool
  */
@@ -2518,6 +2563,10 @@ public:
     if (bl.length() > 0)
       bl.rebuild();
   }
+  size_t estimate_encoded_size() const {
+    return ENCODE_HEADER_SIZE + 2 * sizeof(__u8) +
+      ::estimate_encoded_size(bl);
+  }
   void encode(bufferlist &bl) const;
   void decode(bufferlist::iterator &bl);
   void dump(Formatter *f) const;
@@ -2637,6 +2686,7 @@ struct pg_log_entry_t {
   void encode_with_checksum(bufferlist& bl) const;
   void decode_with_checksum(bufferlist::iterator& p);
 
+  size_t estimate_encoded_size() const;
   void encode(bufferlist &bl) const;
   void decode(bufferlist::iterator &bl);
   void dump(Formatter *f) const;
@@ -3717,6 +3767,7 @@ struct object_info_t {
     set_omap_digest(-1);
   }
 
+  size_t estimate_encoded_size() const;
   void encode(bufferlist& bl, uint64_t features) const;
   void decode(bufferlist::iterator& bl);
   void decode(bufferlist& bl) {
@@ -4273,8 +4324,8 @@ struct ObjectRecoveryInfo {
   uint64_t size;
   object_info_t oi;
   SnapSet ss;
-  interval_set<uint64_t> copy_subset;
-  map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator> clone_subset;
+  flat_interval_set<uint64_t> copy_subset;
+  map<hobject_t, flat_interval_set<uint64_t>, hobject_t::BitwiseComparator> clone_subset;
 
   ObjectRecoveryInfo() : size(0) { }
 
@@ -4350,7 +4401,7 @@ struct PushOp {
   hobject_t soid;
   eversion_t version;
   bufferlist data;
-  interval_set<uint64_t> data_included;
+  flat_interval_set<uint64_t> data_included;
   bufferlist omap_header;
   map<string, bufferlist> omap_entries;
   map<string, bufferlist> attrset;
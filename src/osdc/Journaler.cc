@@ -606,6 +606,7 @@ void Journaler::_do_flush(unsigned amount)
 		     << " already too close to prezero_pos " << prezero_pos
 		     << ", zeroing first" << dendl;
       waiting_for_zero = true;
+      _widen_prezero_window();
       return;
     }
     if (newlen < len) {
@@ -613,11 +614,19 @@ void Journaler::_do_flush(unsigned amount)
 		     << " but hit prezero_pos " << prezero_pos
 		     << ", will do " << flush_pos << "~" << newlen << dendl;
       len = newlen;
+      _widen_prezero_window();
     } else {
       waiting_for_zero = false;
     }
   } else {
     waiting_for_zero = false;
+
+    // the window is keeping up; slowly decay it back towards the
+    // configured size if zeroing is still comfortably ahead
+    uint64_t min_periods = MAX(2, cct->_conf->journaler_prezero_periods);
+    if (prezero_periods > min_periods &&
+	prezero_pos >= write_pos + (prezero_periods - 1) * period)
+      prezero_periods--;
   }
   ldout(cct, 10) << "_do_flush flushing " << flush_pos << "~" << len << dendl;
 
@@ -709,7 +718,15 @@ void Journaler::_flush(C_OnFinisher *onsafe)
     }
   } else {
     // maybe buffer
-    if (write_buf.length() < cct->_conf->journaler_batch_max) {
+    uint64_t batch_max = cct->_conf->journaler_batch_max;
+    if (batch_max == 0 && !pending_safe.empty()) {
+      // a flush is already in flight, so anything we send now just
+      // queues up behind it at the osd; coalesce into larger appends,
+      // up to a full stripe period, instead of issuing another small
+      // write per entry
+      batch_max = get_layout_period();
+    }
+    if (write_buf.length() < batch_max) {
       // delay!  schedule an event.
       ldout(cct, 20) << "flush delaying flush" << dendl;
       if (delay_flush_event) {
@@ -745,13 +762,25 @@ struct C_Journaler_Prezero : public Context {
   }
 };
 
+void Journaler::_widen_prezero_window()
+{
+  // the writer outran the zeroing window; double it (bounded) so
+  // sustained bursts stop stalling behind prezero round trips
+  uint64_t max_periods = cct->_conf->journaler_prezero_periods_max;
+  if (prezero_periods < max_periods) {
+    prezero_periods = MIN(prezero_periods * 2, max_periods);
+    ldout(cct, 10) << "_widen_prezero_window to " << prezero_periods
+		   << " periods" << dendl;
+  }
+}
+
 void Journaler::_issue_prezero()
 {
   assert(prezeroing_pos >= flush_pos);
 
   // we need to zero at least two periods, minimum, to ensure that we
   // have a full empty object/period in front of us.
-  uint64_t num_periods = MAX(2, cct->_conf->journaler_prezero_periods);
+  uint64_t num_periods = MAX(2, prezero_periods);
 
   /*
    * issue zero requests based on write_pos, even though the invariant
@@ -306,6 +306,10 @@ private:
 			///  write_buf.length() == write_pos.
 
   bool waiting_for_zero;
+  uint64_t prezero_periods; ///< current zeroing window, in layout
+			    //   periods; grows when flushes stall
+			    //   behind prezero and decays when the
+			    //   window is comfortably ahead
   interval_set<uint64_t> pending_zero;  // non-contig bits we've zeroed
   std::set<uint64_t> pending_safe;
   // when safe through given offset
@@ -356,6 +360,7 @@ private:
   class C_Trim;
   friend class C_Trim;
 
+  void _widen_prezero_window();
   void _issue_prezero();
   void _finish_prezero(int r, uint64_t from, uint64_t len);
   friend struct C_Journaler_Prezero;
@@ -401,6 +406,7 @@ public:
     state(STATE_UNDEF), error(0),
     prezeroing_pos(0), prezero_pos(0), write_pos(0), flush_pos(0), safe_pos(0),
     waiting_for_zero(false),
+    prezero_periods(cct->_conf->journaler_prezero_periods),
     read_pos(0), requested_pos(0), received_pos(0),
     fetch_len(0), temp_fetch_len(0),
     on_readable(0), on_write_error(NULL), called_write_error(false),
@@ -437,6 +443,7 @@ public:
     trimming_pos = 0;
     trimmed_pos = 0;
     waiting_for_zero = false;
+    prezero_periods = cct->_conf->journaler_prezero_periods;
   }
 
   // Asynchronous operations
@@ -994,6 +994,62 @@ void ObjectCacher::bh_write_scattered(list<BufferHead*>& blist)
     perfcounter->inc(l_objectcacher_data_flushed, total_len);
 }
 
+static bool bh_can_merge_dirty(ObjectCacher::BufferHead *left,
+			       ObjectCacher::BufferHead *right,
+			       ceph::real_time cutoff)
+{
+  return left->end() == right->start() &&
+    left->is_dirty() && right->is_dirty() &&
+    left->last_write <= cutoff && right->last_write <= cutoff &&
+    left->can_merge_journal(right) &&
+    left->snapc.seq == right->snapc.seq &&
+    left->snapc.snaps == right->snapc.snaps;
+}
+
+/*
+ * Coalesce the run of contiguous dirty buffers around bh into one
+ * buffer and start writeback on it with a single osd op.  This is the
+ * non-scattered counterpart of bh_write_adjacencies(): handlers that
+ * cannot do a scattered write (e.g. librbd) still get one op per
+ * contiguous dirty run instead of one per BufferHead, and the merged
+ * run collapses to a single entry in the object's map.
+ *
+ * Returns the number of bytes started on writeback.
+ */
+loff_t ObjectCacher::bh_write_adjacent_merge(BufferHead *bh,
+					     ceph::real_time cutoff)
+{
+  assert(lock.is_locked());
+  Object *ob = bh->ob;
+
+  // find the head of the contiguous mergeable run
+  map<loff_t,BufferHead*>::iterator p = ob->data.find(bh->start());
+  assert(p != ob->data.end());
+  assert(p->second == bh);
+  while (p != ob->data.begin()) {
+    map<loff_t,BufferHead*>::iterator prev = p;
+    --prev;
+    if (!bh_can_merge_dirty(prev->second, p->second, cutoff))
+      break;
+    p = prev;
+  }
+
+  // pull everything mergeable to its right into the head
+  BufferHead *head = p->second;
+  map<loff_t,BufferHead*>::iterator next = p;
+  ++next;
+  while (next != ob->data.end() &&
+	 bh_can_merge_dirty(head, next->second, cutoff)) {
+    ob->merge_left(head, next->second);
+    next = p;
+    ++next;
+  }
+
+  loff_t len = head->length();
+  bh_write(head);
+  return len;
+}
+
 void ObjectCacher::bh_write(BufferHead *bh)
 {
   assert(lock.is_locked());
@@ -1161,8 +1217,7 @@ void ObjectCacher::flush(loff_t amount)
     if (scattered_write) {
       bh_write_adjacencies(bh, cutoff, amount > 0 ? &left : NULL, NULL);
     } else {
-      left -= bh->length();
-      bh_write(bh);
+      left -= bh_write_adjacent_merge(bh, cutoff);
     }
   }    
 }
@@ -1784,7 +1839,7 @@ void ObjectCacher::flusher_entry()
 	if (scattered_write) {
 	  bh_write_adjacencies(bh, cutoff, NULL, &max);
         } else {
-	  bh_write(bh);
+	  bh_write_adjacent_merge(bh, cutoff);
 	  --max;
 	}
       }
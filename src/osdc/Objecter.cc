@@ -464,15 +464,18 @@ void Objecter::shutdown()
     lop->put();
   }
 
-  while(!homeless_session->ops.empty()) {
-    std::map<ceph_tid_t, Op*>::iterator i = homeless_session->ops.begin();
-    ldout(cct, 10) << " op " << i->first << dendl;
-    Op *op = i->second;
-    {
-      OSDSession::unique_lock swl(homeless_session->lock);
-      _session_op_remove(homeless_session, op);
+  for (int i = 0; i < homeless_session->num_op_shards; ++i) {
+    OSDSession::OpShard& shard = homeless_session->op_shards[i];
+    while (!shard.ops.empty()) {
+      std::map<ceph_tid_t, Op*>::iterator p = shard.ops.begin();
+      ldout(cct, 10) << " op " << p->first << dendl;
+      Op *op = p->second;
+      {
+	OSDSession::unique_lock swl(homeless_session->lock);
+	_session_op_remove(homeless_session, op);
+      }
+      op->put();
     }
-    op->put();
   }
 
   while(!homeless_session->command_ops.empty()) {
@@ -519,7 +522,7 @@ void Objecter::_send_linger(LingerOp *info,
 {
   assert(sul.owns_lock() && sul.mutex() == &rwlock);
 
-  vector<OSDOp> opv;
+  osdc_opvec opv;
   Context *oncommit = NULL;
   LingerOp::shared_lock watchl(info->watch_lock);
   bufferlist *poutbl = NULL;
@@ -563,8 +566,9 @@ void Objecter::_send_linger(LingerOp *info,
   if (info->register_tid) {
     // repeat send.  cancel old registeration op, if any.
     OSDSession::unique_lock sl(info->session->lock);
-    if (info->session->ops.count(info->register_tid)) {
-      Op *o = info->session->ops[info->register_tid];
+    OSDSession::OpShard& shard = info->session->op_shard(info->register_tid);
+    if (shard.ops.count(info->register_tid)) {
+      Op *o = shard.ops[info->register_tid];
       _op_cancel_map_check(o);
       _cancel_linger_op(o);
     }
@@ -674,7 +678,7 @@ void Objecter::_send_linger_ping(LingerOp *info)
   ldout(cct, 10) << __func__ << " " << info->linger_id << " now " << now
 		 << dendl;
 
-  vector<OSDOp> opv(1);
+  osdc_opvec opv(1);
   opv[0].op.op = CEPH_OSD_OP_WATCH;
   opv[0].op.watch.cookie = info->get_cookie();
   opv[0].op.watch.op = CEPH_OSD_WATCH_OP_PING;
@@ -1050,32 +1054,34 @@ void Objecter::_scan_requests(OSDSession *s,
   }
 
   // check for changed request mappings
-  map<ceph_tid_t,Op*>::iterator p = s->ops.begin();
-  while (p != s->ops.end()) {
-    Op *op = p->second;
-    ++p;   // check_op_pool_dne() may touch ops; prevent iterator invalidation
-    ldout(cct, 10) << " checking op " << op->tid << dendl;
-    bool force_resend_writes = cluster_full;
-    if (pool_full_map)
-      force_resend_writes = force_resend_writes ||
-	(*pool_full_map)[op->target.base_oloc.pool];
-    int r = _calc_target(&op->target, &op->last_force_resend);
-    switch (r) {
-    case RECALC_OP_TARGET_NO_ACTION:
-      if (!force_resend &&
-	  (!force_resend_writes || !(op->target.flags & CEPH_OSD_FLAG_WRITE)))
+  for (int i = 0; i < s->num_op_shards; ++i) {
+    map<ceph_tid_t,Op*>::iterator p = s->op_shards[i].ops.begin();
+    while (p != s->op_shards[i].ops.end()) {
+      Op *op = p->second;
+      ++p;   // check_op_pool_dne() may touch ops; prevent iterator invalidation
+      ldout(cct, 10) << " checking op " << op->tid << dendl;
+      bool force_resend_writes = cluster_full;
+      if (pool_full_map)
+	force_resend_writes = force_resend_writes ||
+	  (*pool_full_map)[op->target.base_oloc.pool];
+      int r = _calc_target(&op->target, &op->last_force_resend);
+      switch (r) {
+      case RECALC_OP_TARGET_NO_ACTION:
+	if (!force_resend &&
+	    (!force_resend_writes || !(op->target.flags & CEPH_OSD_FLAG_WRITE)))
+	  break;
+	// -- fall-thru --
+      case RECALC_OP_TARGET_NEED_RESEND:
+	if (op->session) {
+	  _session_op_remove(op->session, op);
+	}
+	need_resend[op->tid] = op;
+	_op_cancel_map_check(op);
+	break;
+      case RECALC_OP_TARGET_POOL_DNE:
+	_check_op_pool_dne(op, sl);
 	break;
-      // -- fall-thru --
-    case RECALC_OP_TARGET_NEED_RESEND:
-      if (op->session) {
-	_session_op_remove(op->session, op);
       }
-      need_resend[op->tid] = op;
-      _op_cancel_map_check(op);
-      break;
-    case RECALC_OP_TARGET_POOL_DNE:
-      _check_op_pool_dne(op, sl);
-      break;
     }
   }
 
@@ -1757,11 +1763,14 @@ void Objecter::close_session(OSDSession *s)
     _session_linger_op_remove(s, i->second);
   }
 
-  while (!s->ops.empty()) {
-    std::map<ceph_tid_t, Op*>::iterator i = s->ops.begin();
-    ldout(cct, 10) << " op " << i->first << dendl;
-    homeless_ops.push_back(i->second);
-    _session_op_remove(s, i->second);
+  for (int i = 0; i < s->num_op_shards; ++i) {
+    OSDSession::OpShard& shard = s->op_shards[i];
+    while (!shard.ops.empty()) {
+      std::map<ceph_tid_t, Op*>::iterator p = shard.ops.begin();
+      ldout(cct, 10) << " op " << p->first << dendl;
+      homeless_ops.push_back(p->second);
+      _session_op_remove(s, p->second);
+    }
   }
 
   while (!s->command_ops.empty()) {
@@ -1947,24 +1956,31 @@ void Objecter::_kick_requests(OSDSession *session,
 
   // resend ops
   map<ceph_tid_t,Op*> resend;  // resend in tid order
-  for (map<ceph_tid_t, Op*>::iterator p = session->ops.begin();
-       p != session->ops.end();) {
-    Op *op = p->second;
-    ++p;
-    logger->inc(l_osdc_op_resend);
-    if (op->should_resend) {
-      if (!op->target.paused)
-	resend[op->tid] = op;
-    } else {
-      _op_cancel_map_check(op);
-      _cancel_linger_op(op);
+  for (int i = 0; i < session->num_op_shards; ++i) {
+    for (map<ceph_tid_t, Op*>::iterator p = session->op_shards[i].ops.begin();
+	 p != session->op_shards[i].ops.end();) {
+      Op *op = p->second;
+      ++p;
+      logger->inc(l_osdc_op_resend);
+      if (op->should_resend) {
+	if (!op->target.paused)
+	  resend[op->tid] = op;
+      } else {
+	_op_cancel_map_check(op);
+	_cancel_linger_op(op);
+      }
     }
   }
 
+  // all of these go to the one osd, so stage them into a single train
+  // and push it through the messenger with one flush
+  std::list<Message*> batch;
   while (!resend.empty()) {
-    _send_op(resend.begin()->second);
+    _send_op(resend.begin()->second, NULL, &batch);
     resend.erase(resend.begin());
   }
+  if (!batch.empty())
+    session->con->send_messages(batch);
 
   // resend lingers
   for (map<ceph_tid_t, LingerOp*>::iterator j = session->linger_ops.begin();
@@ -2042,16 +2058,18 @@ void Objecter::tick()
     OSDSession *s = siter->second;
     OSDSession::lock_guard l(s->lock);
     bool found = false;
-    for (map<ceph_tid_t,Op*>::iterator p = s->ops.begin();
-	p != s->ops.end();
-	++p) {
-      Op *op = p->second;
-      assert(op->session);
-      if (op->stamp < cutoff) {
-	ldout(cct, 2) << " tid " << p->first << " on osd." << op->session->osd
-		      << " is laggy" << dendl;
-	found = true;
-	++laggy_ops;
+    for (int i = 0; i < s->num_op_shards; ++i) {
+      for (map<ceph_tid_t,Op*>::iterator p = s->op_shards[i].ops.begin();
+	   p != s->op_shards[i].ops.end();
+	   ++p) {
+	Op *op = p->second;
+	assert(op->session);
+	if (op->stamp < cutoff) {
+	  ldout(cct, 2) << " tid " << p->first << " on osd." << op->session->osd
+			<< " is laggy" << dendl;
+	  found = true;
+	  ++laggy_ops;
+	}
       }
     }
     for (map<uint64_t,LingerOp*>::iterator p = s->linger_ops.begin();
@@ -2189,7 +2207,7 @@ void Objecter::_op_submit_with_budget(Op *op, shunique_lock& sul,
     if (op->tid == 0)
       op->tid = last_tid.inc();
     auto tid = op->tid;
-    op->ontimeout = timer.add_event(osd_timeout,
+    op->ontimeout = op_timeout_timer.add_event(osd_timeout,
 				    [this, tid]() {
 				      op_cancel(tid, -ETIMEDOUT); });
   }
@@ -2227,7 +2245,7 @@ void Objecter::_send_op_account(Op *op)
   if (op->target.flags & CEPH_OSD_FLAG_PGOP)
     logger->inc(l_osdc_op_pg);
 
-  for (vector<OSDOp>::iterator p = op->ops.begin(); p != op->ops.end(); ++p) {
+  for (osdc_opvec::iterator p = op->ops.begin(); p != op->ops.end(); ++p) {
     int code = l_osdc_osdop_other;
     switch (p->op.op) {
     case CEPH_OSD_OP_STAT: code = l_osdc_osdop_stat; break;
@@ -2387,8 +2405,9 @@ int Objecter::op_cancel(OSDSession *s, ceph_tid_t tid, int r)
 
   OSDSession::unique_lock sl(s->lock);
 
-  map<ceph_tid_t, Op*>::iterator p = s->ops.find(tid);
-  if (p == s->ops.end()) {
+  map<ceph_tid_t, Op*>& shard_ops = s->op_shard(tid).ops;
+  map<ceph_tid_t, Op*>::iterator p = shard_ops.find(tid);
+  if (p == shard_ops.end()) {
     ldout(cct, 10) << __func__ << " tid " << tid << " dne in session "
 		   << s->osd << dendl;
     return -ENOENT;
@@ -2448,7 +2467,10 @@ start:
        siter != osd_sessions.end(); ++siter) {
     OSDSession *s = siter->second;
     OSDSession::shared_lock sl(s->lock);
-    if (s->ops.find(tid) != s->ops.end()) {
+    OSDSession::unique_shard_lock shl(s->op_shard(tid).lock);
+    bool here = s->op_shard(tid).ops.count(tid);
+    shl.unlock();
+    if (here) {
       sl.unlock();
       ret = op_cancel(s, tid, r);
       if (ret == -ENOENT) {
@@ -2464,7 +2486,10 @@ start:
 
   // Handle case where the op is in homeless session
   OSDSession::shared_lock sl(homeless_session->lock);
-  if (homeless_session->ops.find(tid) != homeless_session->ops.end()) {
+  OSDSession::unique_shard_lock shl(homeless_session->op_shard(tid).lock);
+  bool here = homeless_session->op_shard(tid).ops.count(tid);
+  shl.unlock();
+  if (here) {
     sl.unlock();
     ret = op_cancel(homeless_session, tid, r);
     if (ret == -ENOENT) {
@@ -2495,11 +2520,14 @@ epoch_t Objecter::op_cancel_writes(int r, int64_t pool)
        siter != osd_sessions.end(); ++siter) {
     OSDSession *s = siter->second;
     OSDSession::shared_lock sl(s->lock);
-    for (map<ceph_tid_t, Op*>::iterator op_i = s->ops.begin();
-	 op_i != s->ops.end(); ++op_i) {
-      if (op_i->second->target.flags & CEPH_OSD_FLAG_WRITE
-	  && (pool == -1 || op_i->second->target.target_oloc.pool == pool)) {
-	to_cancel.push_back(op_i->first);
+    for (int i = 0; i < s->num_op_shards; ++i) {
+      OSDSession::unique_shard_lock shl(s->op_shards[i].lock);
+      for (map<ceph_tid_t, Op*>::iterator op_i = s->op_shards[i].ops.begin();
+	   op_i != s->op_shards[i].ops.end(); ++op_i) {
+	if (op_i->second->target.flags & CEPH_OSD_FLAG_WRITE
+	    && (pool == -1 || op_i->second->target.target_oloc.pool == pool)) {
+	  to_cancel.push_back(op_i->first);
+	}
       }
     }
     sl.unlock();
@@ -2836,7 +2864,7 @@ void Objecter::_session_op_assign(OSDSession *to, Op *op)
 
   get_session(to);
   op->session = to;
-  to->ops[op->tid] = op;
+  to->op_shard(op->tid).ops[op->tid] = op;
 
   if (to->is_homeless()) {
     num_homeless_ops.inc();
@@ -2854,7 +2882,7 @@ void Objecter::_session_op_remove(OSDSession *from, Op *op)
     num_homeless_ops.dec();
   }
 
-  from->ops.erase(op->tid);
+  from->op_shard(op->tid).ops.erase(op->tid);
   put_session(from);
   op->session = NULL;
 
@@ -2982,13 +3010,14 @@ void Objecter::_finish_op(Op *op, int r)
 {
   ldout(cct, 15) << "finish_op " << op->tid << dendl;
 
-  // op->session->lock is locked unique
+  // op->session->lock is locked unique, or (from the reply path)
+  // locked shared with the op's shard lock held
 
   if (!op->ctx_budgeted && op->budgeted)
     put_op_budget(op);
 
   if (op->ontimeout && r != -ETIMEDOUT)
-    timer.cancel_event(op->ontimeout);
+    op_timeout_timer.cancel_event(op->ontimeout);
 
   _session_op_remove(op->session, op);
 
@@ -3008,8 +3037,9 @@ void Objecter::finish_op(OSDSession *session, ceph_tid_t tid)
 
   OSDSession::unique_lock wl(session->lock);
 
-  map<ceph_tid_t, Op *>::iterator iter = session->ops.find(tid);
-  if (iter == session->ops.end())
+  map<ceph_tid_t, Op *>& shard_ops = session->op_shard(tid).ops;
+  map<ceph_tid_t, Op *>::iterator iter = shard_ops.find(tid);
+  if (iter == shard_ops.end())
     return;
 
   Op *op = iter->second;
@@ -3044,7 +3074,7 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
   m->set_snap_seq(op->snapc.seq);
   m->set_snaps(op->snapc.snaps);
 
-  m->ops = op->ops;
+  m->ops.assign(op->ops.begin(), op->ops.end());
   m->set_mtime(op->mtime);
   m->set_retry_attempt(op->attempts++);
 
@@ -3066,7 +3096,7 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
   return m;
 }
 
-void Objecter::_send_op(Op *op, MOSDOp *m)
+void Objecter::_send_op(Op *op, MOSDOp *m, std::list<Message*> *msg_batch)
 {
   // rwlock is locked
   // op->session->lock is locked
@@ -3101,13 +3131,16 @@ void Objecter::_send_op(Op *op, MOSDOp *m)
 
   m->set_tid(op->tid);
 
-  op->session->con->send_message(m);
+  if (msg_batch)
+    msg_batch->push_back(m);   // caller flushes the train in one go
+  else
+    op->session->con->send_message(m);
 }
 
 int Objecter::calc_op_budget(Op *op)
 {
   int op_budget = 0;
-  for (vector<OSDOp>::iterator i = op->ops.begin();
+  for (osdc_opvec::iterator i = op->ops.begin();
        i != op->ops.end();
        ++i) {
     if (i->op.op & CEPH_OSD_OP_MODE_WR) {
@@ -3154,7 +3187,7 @@ void Objecter::_throttle_op(Op *op,
 void Objecter::unregister_op(Op *op)
 {
   OSDSession::unique_lock sl(op->session->lock);
-  op->session->ops.erase(op->tid);
+  op->session->op_shard(op->tid).ops.erase(op->tid);
   sl.unlock();
   put_session(op->session);
   op->session = NULL;
@@ -3191,14 +3224,21 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   OSDSession *s = siter->second;
   get_session(s);
 
-  OSDSession::unique_lock sl(s->lock);
+  // replies lock only their tid's shard (plus the session lock
+  // shared), so completions for different ops on the same session
+  // proceed in parallel; the rare restaging branches below retake the
+  // session lock unique instead
+  OSDSession::shared_lock sl(s->lock);
+  OSDSession::OpShard& shard = s->op_shard(tid);
+  OSDSession::unique_shard_lock shl(shard.lock);
 
-  map<ceph_tid_t, Op *>::iterator iter = s->ops.find(tid);
-  if (iter == s->ops.end()) {
+  map<ceph_tid_t, Op *>::iterator iter = shard.ops.find(tid);
+  if (iter == shard.ops.end()) {
     ldout(cct, 7) << "handle_osd_op_reply " << tid
 		  << (m->is_ondisk() ? " ondisk" : (m->is_onnvram() ?
 						    " onnvram" : " ack"))
 		  << " ... stray" << dendl;
+    shl.unlock();
     sl.unlock();
     put_session(s);
     m->put();
@@ -3215,20 +3255,87 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
 		<< dendl;
   Op *op = iter->second;
 
-  if (retry_writes_after_first_reply && op->attempts == 1 &&
-      (op->target.flags & CEPH_OSD_FLAG_WRITE)) {
-    ldout(cct, 7) << "retrying write after first reply: " << tid << dendl;
-    if (op->onack) {
-      num_unacked.dec();
+  int rc = m->get_result();
+
+  bool retry_write = retry_writes_after_first_reply && op->attempts == 1 &&
+    (op->target.flags & CEPH_OSD_FLAG_WRITE);
+  if (retry_write || m->is_redirect_reply() || rc == -EAGAIN) {
+    // restaging paths need the session lock unique; drop our shared
+    // locks and revalidate in case we raced with a cancel or a kick
+    shl.unlock();
+    sl.unlock();
+    OSDSession::unique_lock usl(s->lock);
+    iter = shard.ops.find(tid);
+    if (iter == shard.ops.end() || iter->second != op) {
+      ldout(cct, 7) << "handle_osd_op_reply " << tid
+		    << " ... stray (raced with cancel)" << dendl;
+      usl.unlock();
+      put_session(s);
+      m->put();
+      return;
     }
-    if (op->oncommit || op->oncommit_sync) {
-      num_uncommitted.dec();
+
+    if (retry_write) {
+      ldout(cct, 7) << "retrying write after first reply: " << tid << dendl;
+      if (op->onack) {
+	num_unacked.dec();
+      }
+      if (op->oncommit || op->oncommit_sync) {
+	num_uncommitted.dec();
+      }
+      _session_op_remove(s, op);
+      usl.unlock();
+      put_session(s);
+
+      _op_submit(op, sul, NULL);
+      m->put();
+      return;
     }
-    _session_op_remove(s, op);
-    sl.unlock();
-    put_session(s);
 
-    _op_submit(op, sul, NULL);
+    if (m->get_retry_attempt() >= 0 &&
+	m->get_retry_attempt() != (op->attempts - 1)) {
+      ldout(cct, 7) << " ignoring reply from attempt "
+		    << m->get_retry_attempt()
+		    << " from " << m->get_source_inst()
+		    << "; last attempt " << (op->attempts - 1) << " sent to "
+		    << op->session->con->get_peer_addr() << dendl;
+      m->put();
+      usl.unlock();
+      put_session(s);
+      return;
+    }
+
+    if (m->is_redirect_reply()) {
+      ldout(cct, 5) << " got redirect reply; redirecting" << dendl;
+      if (op->onack)
+	num_unacked.dec();
+      if (op->oncommit || op->oncommit_sync)
+	num_uncommitted.dec();
+      _session_op_remove(s, op);
+      usl.unlock();
+      put_session(s);
+
+      // FIXME: two redirects could race and reorder
+
+      op->tid = 0;
+      m->get_redirect().combine_with_locator(op->target.target_oloc,
+					     op->target.target_oid.name);
+      op->target.flags |= CEPH_OSD_FLAG_REDIRECTED;
+      _op_submit(op, sul, NULL);
+      m->put();
+      return;
+    }
+
+    // rc == -EAGAIN
+    ldout(cct, 7) << " got -EAGAIN, resubmitting" << dendl;
+
+    // new tid
+    shard.ops.erase(op->tid);
+    op->tid = last_tid.inc();
+
+    _send_op(op);
+    usl.unlock();
+    put_session(s);
     m->put();
     return;
   }
@@ -3241,6 +3348,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
 		    << "; last attempt " << (op->attempts - 1) << " sent to "
 		    << op->session->con->get_peer_addr() << dendl;
       m->put();
+      shl.unlock();
       sl.unlock();
       put_session(s);
       return;
@@ -3254,43 +3362,6 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   Context *onack = 0;
   Context *oncommit = 0;
 
-  int rc = m->get_result();
-
-  if (m->is_redirect_reply()) {
-    ldout(cct, 5) << " got redirect reply; redirecting" << dendl;
-    if (op->onack)
-      num_unacked.dec();
-    if (op->oncommit || op->oncommit_sync)
-      num_uncommitted.dec();
-    _session_op_remove(s, op);
-    sl.unlock();
-    put_session(s);
-
-    // FIXME: two redirects could race and reorder
-
-    op->tid = 0;
-    m->get_redirect().combine_with_locator(op->target.target_oloc,
-					   op->target.target_oid.name);
-    op->target.flags |= CEPH_OSD_FLAG_REDIRECTED;
-    _op_submit(op, sul, NULL);
-    m->put();
-    return;
-  }
-
-  if (rc == -EAGAIN) {
-    ldout(cct, 7) << " got -EAGAIN, resubmitting" << dendl;
-
-    // new tid
-    s->ops.erase(op->tid);
-    op->tid = last_tid.inc();
-
-    _send_op(op);
-    sl.unlock();
-    put_session(s);
-    m->put();
-    return;
-  }
-
   sul.unlock();
 
   if (op->objver)
@@ -3317,9 +3388,9 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
 		  << " != request ops " << op->ops
 		  << " from " << m->get_source_inst() << dendl;
 
-  vector<bufferlist*>::iterator pb = op->out_bl.begin();
-  vector<int*>::iterator pr = op->out_rval.begin();
-  vector<Context*>::iterator ph = op->out_handler.begin();
+  auto pb = op->out_bl.begin();
+  auto pr = op->out_rval.begin();
+  auto ph = op->out_handler.begin();
   assert(op->out_bl.size() == op->out_rval.size());
   assert(op->out_bl.size() == op->out_handler.size());
   vector<OSDOp>::iterator p = out_ops.begin();
@@ -3383,6 +3454,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   if (completion_lock.mutex()) {
     completion_lock.lock();
   }
+  shl.unlock();
   sl.unlock();
 
   // do callbacks
@@ -3917,7 +3989,7 @@ void Objecter::pool_op_submit(PoolOp *op)
 {
   // rwlock is locked
   if (mon_timeout > timespan(0)) {
-    op->ontimeout = timer.add_event(mon_timeout,
+    op->ontimeout = op_timeout_timer.add_event(mon_timeout,
 				    [this, op]() {
 				      pool_op_cancel(op->tid, -ETIMEDOUT); });
   }
@@ -4040,7 +4112,7 @@ void Objecter::_finish_pool_op(PoolOp *op, int r)
   logger->set(l_osdc_poolop_active, pool_ops.size());
 
   if (op->ontimeout && r != -ETIMEDOUT) {
-    timer.cancel_event(op->ontimeout);
+    op_timeout_timer.cancel_event(op->ontimeout);
   }
 
   delete op;
@@ -4060,7 +4132,7 @@ void Objecter::get_pool_stats(list<string>& pools,
   op->pool_stats = result;
   op->onfinish = onfinish;
   if (mon_timeout > timespan(0)) {
-    op->ontimeout = timer.add_event(mon_timeout,
+    op->ontimeout = op_timeout_timer.add_event(mon_timeout,
 				    [this, op]() {
 				      pool_stat_op_cancel(op->tid,
 							  -ETIMEDOUT); });
@@ -4145,7 +4217,7 @@ void Objecter::_finish_pool_stat_op(PoolStatOp *op, int r)
   logger->set(l_osdc_poolstat_active, poolstat_ops.size());
 
   if (op->ontimeout && r != -ETIMEDOUT)
-    timer.cancel_event(op->ontimeout);
+    op_timeout_timer.cancel_event(op->ontimeout);
 
   delete op;
 }
@@ -4160,7 +4232,7 @@ void Objecter::get_fs_stats(ceph_statfs& result, Context *onfinish)
   op->stats = &result;
   op->onfinish = onfinish;
   if (mon_timeout > timespan(0)) {
-    op->ontimeout = timer.add_event(mon_timeout,
+    op->ontimeout = op_timeout_timer.add_event(mon_timeout,
 				    [this, op]() {
 				      statfs_op_cancel(op->tid,
 						       -ETIMEDOUT); });
@@ -4241,7 +4313,7 @@ void Objecter::_finish_statfs_op(StatfsOp *op, int r)
   logger->set(l_osdc_statfs_active, statfs_ops.size());
 
   if (op->ontimeout && r != -ETIMEDOUT)
-    timer.cancel_event(op->ontimeout);
+    op_timeout_timer.cancel_event(op->ontimeout);
 
   delete op;
 }
@@ -4362,14 +4434,17 @@ void Objecter::op_target_t::dump(Formatter *f) const
 
 void Objecter::_dump_active(OSDSession *s)
 {
-  for (map<ceph_tid_t,Op*>::iterator p = s->ops.begin();
-       p != s->ops.end();
-       ++p) {
-    Op *op = p->second;
-    ldout(cct, 20) << op->tid << "\t" << op->target.pgid
-		   << "\tosd." << (op->session ? op->session->osd : -1)
-		   << "\t" << op->target.base_oid
-		   << "\t" << op->ops << dendl;
+  for (int i = 0; i < s->num_op_shards; ++i) {
+    OSDSession::unique_shard_lock shl(s->op_shards[i].lock);
+    for (map<ceph_tid_t,Op*>::iterator p = s->op_shards[i].ops.begin();
+	 p != s->op_shards[i].ops.end();
+	 ++p) {
+      Op *op = p->second;
+      ldout(cct, 20) << op->tid << "\t" << op->target.pgid
+		     << "\tosd." << (op->session ? op->session->osd : -1)
+		     << "\t" << op->target.base_oid
+		     << "\t" << op->ops << dendl;
+    }
   }
 }
 
@@ -4409,28 +4484,31 @@ void Objecter::dump_requests(Formatter *fmt)
 
 void Objecter::_dump_ops(const OSDSession *s, Formatter *fmt)
 {
-  for (map<ceph_tid_t,Op*>::const_iterator p = s->ops.begin();
-       p != s->ops.end();
-       ++p) {
-    Op *op = p->second;
-    fmt->open_object_section("op");
-    fmt->dump_unsigned("tid", op->tid);
-    op->target.dump(fmt);
-    fmt->dump_stream("last_sent") << op->stamp;
-    fmt->dump_int("attempts", op->attempts);
-    fmt->dump_stream("snapid") << op->snapid;
-    fmt->dump_stream("snap_context") << op->snapc;
-    fmt->dump_stream("mtime") << op->mtime;
+  for (int i = 0; i < s->num_op_shards; ++i) {
+    OSDSession::unique_shard_lock shl(s->op_shards[i].lock);
+    for (map<ceph_tid_t,Op*>::const_iterator p = s->op_shards[i].ops.begin();
+	 p != s->op_shards[i].ops.end();
+	 ++p) {
+      Op *op = p->second;
+      fmt->open_object_section("op");
+      fmt->dump_unsigned("tid", op->tid);
+      op->target.dump(fmt);
+      fmt->dump_stream("last_sent") << op->stamp;
+      fmt->dump_int("attempts", op->attempts);
+      fmt->dump_stream("snapid") << op->snapid;
+      fmt->dump_stream("snap_context") << op->snapc;
+      fmt->dump_stream("mtime") << op->mtime;
+
+      fmt->open_array_section("osd_ops");
+      for (osdc_opvec::const_iterator it = op->ops.begin();
+	   it != op->ops.end();
+	   ++it) {
+	fmt->dump_stream("osd_op") << *it;
+      }
+      fmt->close_section(); // osd_ops array
 
-    fmt->open_array_section("osd_ops");
-    for (vector<OSDOp>::const_iterator it = op->ops.begin();
-	 it != op->ops.end();
-	 ++it) {
-      fmt->dump_stream("osd_op") << *it;
+      fmt->close_section(); // op object
     }
-    fmt->close_section(); // osd_ops array
-
-    fmt->close_section(); // op object
   }
 }
 
@@ -4681,7 +4759,7 @@ int Objecter::submit_command(CommandOp *c, ceph_tid_t *ptid)
   _calc_command_target(c, sul);
   _assign_command_session(c, sul);
   if (osd_timeout > timespan(0)) {
-    c->ontimeout = timer.add_event(osd_timeout,
+    c->ontimeout = op_timeout_timer.add_event(osd_timeout,
 				   [this, c, tid]() {
 				     command_op_cancel(c->session, tid,
 						       -ETIMEDOUT); });
@@ -4814,7 +4892,7 @@ void Objecter::_finish_command(CommandOp *c, int r, string rs)
     c->onfinish->complete(r);
 
   if (c->ontimeout && r != -ETIMEDOUT)
-    timer.cancel_event(c->ontimeout);
+    op_timeout_timer.cancel_event(c->ontimeout);
 
   OSDSession *s = c->session;
   OSDSession::unique_lock sl(s->lock);
@@ -4830,7 +4908,7 @@ Objecter::OSDSession::~OSDSession()
 {
   // Caller is responsible for re-assigning or
   // destroying any ops that were assigned to us
-  assert(ops.empty());
+  assert(ops_empty());
   assert(linger_ops.empty());
   assert(command_ops.empty());
 }
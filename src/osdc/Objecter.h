@@ -27,6 +27,7 @@
 
 #include "include/assert.h"
 #include "include/buffer.h"
+#include "include/small_vector.h"
 #include "include/types.h"
 #include "include/rados/rados_types.hpp"
 
@@ -60,14 +61,18 @@ class PerfCounters;
 
 // -----------------------------------------
 
+// most rados operations carry only one or two OSDOps; keep that many
+// inline so building and submitting an operation allocates nothing
+typedef small_vector<OSDOp, 3> osdc_opvec;
+
 struct ObjectOperation {
-  vector<OSDOp> ops;
+  osdc_opvec ops;
   int flags;
   int priority;
 
-  vector<bufferlist*> out_bl;
-  vector<Context*> out_handler;
-  vector<int*> out_rval;
+  small_vector<bufferlist*, 3> out_bl;
+  small_vector<Context*, 3> out_handler;
+  small_vector<int*, 3> out_rval;
 
   ObjectOperation() : flags(0), priority(0) {}
   ~ObjectOperation() {
@@ -1072,7 +1077,7 @@ struct ObjectOperation {
   }
 
   void dup(vector<OSDOp>& sops) {
-    ops = sops;
+    ops.assign(sops.begin(), sops.end());
     out_bl.resize(sops.size());
     out_handler.resize(sops.size());
     out_rval.resize(sops.size());
@@ -1144,6 +1149,9 @@ private:
   using shared_lock = boost::shared_lock<decltype(rwlock)>;
   using shunique_lock = ceph::shunique_lock<decltype(rwlock)>;
   ceph::timer<ceph::mono_clock> timer;
+  // per-op timeouts are armed and cancelled at op frequency; the
+  // coarse wheel keeps them O(1) and off the tick timer's lock
+  ceph::wheel_timer<ceph::mono_clock> op_timeout_timer;
 
   PerfCounters *logger;
 
@@ -1226,16 +1234,16 @@ public:
     ConnectionRef con;  // for rx buffer only
     uint64_t features;  // explicitly specified op features
 
-    vector<OSDOp> ops;
+    osdc_opvec ops;
 
     snapid_t snapid;
     SnapContext snapc;
     ceph::real_time mtime;
 
     bufferlist *outbl;
-    vector<bufferlist*> out_bl;
-    vector<Context*> out_handler;
-    vector<int*> out_rval;
+    small_vector<bufferlist*, 3> out_bl;
+    small_vector<Context*, 3> out_handler;
+    small_vector<int*, 3> out_rval;
 
     int priority;
     Context *onack, *oncommit;
@@ -1270,7 +1278,7 @@ public:
 
     osd_reqid_t reqid; // explicitly setting reqid
 
-    Op(const object_t& o, const object_locator_t& ol, vector<OSDOp>& op,
+    Op(const object_t& o, const object_locator_t& ol, osdc_opvec& op,
        int f, Context *ac, Context *co, version_t *ov, int *offset = NULL) :
       session(NULL), incarnation(0),
       target(o, ol, f),
@@ -1609,7 +1617,7 @@ public:
     SnapContext snapc;
     ceph::real_time mtime;
 
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     bufferlist inbl;
     bufferlist *poutbl;
     version_t *pobjver;
@@ -1752,8 +1760,20 @@ public:
     using shared_lock = boost::shared_lock<decltype(lock)>;
     using shunique_lcok = ceph::shunique_lock<decltype(lock)>;
 
-    // pending ops
-    map<ceph_tid_t,Op*> ops;
+    // pending ops, sharded by tid so that concurrent replies contend
+    // only for their shard.  To touch a shard's map (or the
+    // reply-mutable fields of an Op found through it), hold the
+    // session lock unique, or hold it shared plus that shard's lock;
+    // the unique session lock alone excludes all shard-locking
+    // readers, so existing unique-lock paths need no shard locks.
+    struct OpShard {
+      mutable std::mutex lock;
+      map<ceph_tid_t,Op*> ops;
+    };
+    int num_op_shards;
+    std::unique_ptr<OpShard[]> op_shards;
+    using unique_shard_lock = std::unique_lock<std::mutex>;
+
     map<uint64_t, LingerOp*> linger_ops;
     map<ceph_tid_t,CommandOp*> command_ops;
 
@@ -1767,6 +1787,8 @@ public:
 
 
     OSDSession(CephContext *cct, int o) :
+      num_op_shards(cct->_conf->objecter_session_op_shards),
+      op_shards(new OpShard[num_op_shards]),
       osd(o), incarnation(0), con(NULL),
       num_locks(cct->_conf->objecter_completion_locks_per_session),
       completion_locks(new std::mutex[num_locks]) {}
@@ -1775,6 +1797,19 @@ public:
 
     bool is_homeless() { return (osd == -1); }
 
+    OpShard& op_shard(ceph_tid_t tid) {
+      return op_shards[tid % num_op_shards];
+    }
+    const OpShard& op_shard(ceph_tid_t tid) const {
+      return op_shards[tid % num_op_shards];
+    }
+    bool ops_empty() const {
+      for (int i = 0; i < num_op_shards; ++i)
+	if (!op_shards[i].ops.empty())
+	  return false;
+      return true;
+    }
+
     unique_completion_lock get_lock(object_t& oid);
   };
   map<int,OSDSession*> osd_sessions;
@@ -1817,7 +1852,7 @@ public:
   ceph::timespan osd_timeout;
 
   MOSDOp *_prepare_osd_op(Op *op);
-  void _send_op(Op *op, MOSDOp *m = NULL);
+  void _send_op(Op *op, MOSDOp *m = NULL, std::list<Message*> *msg_batch = NULL);
   void _send_op_account(Op *op);
   void _cancel_linger_op(Op *op);
   void finish_op(OSDSession *session, ceph_tid_t tid);
@@ -2283,7 +2318,7 @@ public:
    * @param extra_ops pointer to [array of] initial op[s]
    * @return index of final op (for caller to fill in)
    */
-  int init_ops(vector<OSDOp>& ops, int ops_count, ObjectOperation *extra_ops) {
+  int init_ops(osdc_opvec& ops, int ops_count, ObjectOperation *extra_ops) {
     int i;
     int extra = 0;
 
@@ -2306,7 +2341,7 @@ public:
     snapid_t snap, uint64_t *psize, ceph::real_time *pmtime,
     int flags, Context *onfinish, version_t *objver = NULL,
     ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_STAT;
     C_Stat *fin = new C_Stat(psize, pmtime, onfinish);
@@ -2333,7 +2368,7 @@ public:
     uint64_t off, uint64_t len, snapid_t snap, bufferlist *pbl,
     int flags, Context *onfinish, version_t *objver = NULL,
     ObjectOperation *extra_ops = NULL, int op_flags = 0) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_READ;
     ops[i].op.extent.offset = off;
@@ -2365,7 +2400,7 @@ public:
 			__u32 trunc_seq, Context *onfinish,
 			version_t *objver = NULL,
 			ObjectOperation *extra_ops = NULL, int op_flags = 0) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_READ;
     ops[i].op.extent.offset = off;
@@ -2385,7 +2420,7 @@ public:
 		    uint64_t off, uint64_t len, snapid_t snap, bufferlist *pbl,
 		    int flags, Context *onfinish, version_t *objver = NULL,
 		    ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_MAPEXT;
     ops[i].op.extent.offset = off;
@@ -2404,7 +2439,7 @@ public:
 	     const char *name, snapid_t snap, bufferlist *pbl, int flags,
 	     Context *onfinish,
 	     version_t *objver = NULL, ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_GETXATTR;
     ops[i].op.xattr.name_len = (name ? strlen(name) : 0);
@@ -2424,7 +2459,7 @@ public:
 		       snapid_t snap, map<string,bufferlist>& attrset,
 		       int flags, Context *onfinish, version_t *objver = NULL,
 		       ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_GETXATTRS;
     C_GetAttrs *fin = new C_GetAttrs(attrset, onfinish);
@@ -2448,7 +2483,7 @@ public:
 
   // writes
   ceph_tid_t _modify(const object_t& oid, const object_locator_t& oloc,
-		     vector<OSDOp>& ops, ceph::real_time mtime,
+		     osdc_opvec& ops, ceph::real_time mtime,
 		     const SnapContext& snapc, int flags,
 		     Context *onack, Context *oncommit,
 		     version_t *objver = NULL) {
@@ -2466,7 +2501,7 @@ public:
     const bufferlist &bl, ceph::real_time mtime, int flags,
     Context *onack, Context *oncommit, version_t *objver = NULL,
     ObjectOperation *extra_ops = NULL, int op_flags = 0) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_WRITE;
     ops[i].op.extent.offset = off;
@@ -2500,7 +2535,7 @@ public:
     Context *onack, Context *oncommit,
     version_t *objver = NULL,
     ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_APPEND;
     ops[i].op.extent.offset = 0;
@@ -2534,7 +2569,7 @@ public:
 			 Context *onack, Context *oncommit,
 			 version_t *objver = NULL,
 			 ObjectOperation *extra_ops = NULL, int op_flags = 0) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_WRITE;
     ops[i].op.extent.offset = off;
@@ -2557,7 +2592,7 @@ public:
     ceph::real_time mtime, int flags, Context *onack,
     Context *oncommit, version_t *objver = NULL,
     ObjectOperation *extra_ops = NULL, int op_flags = 0) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_WRITEFULL;
     ops[i].op.extent.offset = 0;
@@ -2590,7 +2625,7 @@ public:
     Context *oncommit, version_t *objver = NULL,
     ObjectOperation *extra_ops = NULL, int op_flags = 0) {
 
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_WRITESAME;
     ops[i].op.writesame.offset = off;
@@ -2625,7 +2660,7 @@ public:
 		   uint64_t trunc_size, __u32 trunc_seq, Context *onack,
 		   Context *oncommit, version_t *objver = NULL,
 		   ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_TRUNCATE;
     ops[i].op.extent.offset = trunc_size;
@@ -2643,7 +2678,7 @@ public:
 		  uint64_t off, uint64_t len, const SnapContext& snapc,
 		  ceph::real_time mtime, int flags, Context *onack, Context *oncommit,
 	     version_t *objver = NULL, ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_ZERO;
     ops[i].op.extent.offset = off;
@@ -2661,7 +2696,7 @@ public:
 			     ceph::real_time mtime, Context *onack, Context *oncommit,
 			     version_t *objver = NULL,
 			     ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_ROLLBACK;
     ops[i].op.snap.snapid = snapid;
@@ -2678,7 +2713,7 @@ public:
 		    int create_flags, Context *onack, Context *oncommit,
 		    version_t *objver = NULL,
 		    ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_CREATE;
     ops[i].op.flags = create_flags;
@@ -2695,7 +2730,7 @@ public:
     const SnapContext& snapc, ceph::real_time mtime, int flags,
     Context *onack, Context *oncommit,
     version_t *objver = NULL, ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_DELETE;
     Op *o = new Op(oid, oloc, ops, flags | global_op_flags.read() |
@@ -2721,7 +2756,7 @@ public:
 	      ceph::real_time mtime, int flags,
 	      Context *onack, Context *oncommit,
 	      version_t *objver = NULL, ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_SETXATTR;
     ops[i].op.xattr.name_len = (name ? strlen(name) : 0);
@@ -2742,7 +2777,7 @@ public:
 	      ceph::real_time mtime, int flags,
 	      Context *onack, Context *oncommit,
 	      version_t *objver = NULL, ObjectOperation *extra_ops = NULL) {
-    vector<OSDOp> ops;
+    osdc_opvec ops;
     int i = init_ops(ops, 1, extra_ops);
     ops[i].op.op = CEPH_OSD_OP_RMXATTR;
     ops[i].op.xattr.name_len = (name ? strlen(name) : 0);
@@ -0,0 +1,283 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <cxxabi.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "common/Formatter.h"
+#include "common/Mutex.h"
+#include "perfglue/stack_sampler.h"
+
+#define SAMPLER_MAX_DEPTH 32
+#define SAMPLER_RING_SIZE 16384
+// the signal trampoline and the handler itself lead every capture
+#define SAMPLER_SKIP_FRAMES 2
+// cap on stacks listed by the dump command; the flamegraph output is
+// always complete
+#define SAMPLER_DUMP_STACKS 50
+
+namespace {
+
+struct Sample {
+  int depth;
+  void *frames[SAMPLER_MAX_DEPTH];
+
+  bool operator<(const Sample& o) const {
+    if (depth != o.depth)
+      return depth < o.depth;
+    return memcmp(frames, o.frames, depth * sizeof(void*)) < 0;
+  }
+};
+
+// the handler only touches the ring and these counters; everything else
+// is guarded by sampler_lock
+Sample ring[SAMPLER_RING_SIZE];
+volatile uint64_t ring_head = 0;
+volatile uint64_t ring_tail = 0;
+volatile uint64_t lost = 0;
+volatile sig_atomic_t sampler_active = 0;
+
+Mutex sampler_lock("stack_sampler::lock");
+int sampler_hz = 0;
+uint64_t sampled = 0;
+std::map<Sample, uint64_t> stacks;
+
+void sampler_handler(int signum)
+{
+  if (!sampler_active)
+    return;
+  // SIGPROF is delivered to one running thread at a time, so the ring
+  // effectively has a single writer; in the rare case two threads do
+  // race here the damage is one torn sample, which an aggregated
+  // profile tolerates
+  uint64_t head = ring_head;
+  if (head - ring_tail >= SAMPLER_RING_SIZE) {
+    lost++;
+    return;
+  }
+  Sample *s = &ring[head % SAMPLER_RING_SIZE];
+  s->depth = backtrace(s->frames, SAMPLER_MAX_DEPTH);
+  ring_head = head + 1;
+}
+
+// fold the ring into the aggregated stack map; called with sampler_lock
+void sampler_drain()
+{
+  uint64_t head = ring_head;
+  while (ring_tail < head) {
+    Sample s = ring[ring_tail % SAMPLER_RING_SIZE];
+    if (s.depth > SAMPLER_SKIP_FRAMES) {
+      s.depth -= SAMPLER_SKIP_FRAMES;
+      memmove(s.frames, s.frames + SAMPLER_SKIP_FRAMES,
+	      s.depth * sizeof(void*));
+      memset(s.frames + s.depth, 0,
+	     (SAMPLER_MAX_DEPTH - s.depth) * sizeof(void*));
+      stacks[s]++;
+      sampled++;
+    }
+    ring_tail = ring_tail + 1;
+  }
+}
+
+std::string sampler_frame_name(void *addr)
+{
+  char **sym = backtrace_symbols(&addr, 1);
+  if (!sym)
+    return "??";
+  std::string s(sym[0]);
+  free(sym);
+  // "binary(_ZN...+0x1a) [0xdeadbeef]" -> demangled function name
+  size_t open = s.find('(');
+  size_t plus = (open == std::string::npos) ? std::string::npos
+					    : s.find('+', open);
+  if (open != std::string::npos && plus != std::string::npos &&
+      plus > open + 1) {
+    std::string mangled = s.substr(open + 1, plus - open - 1);
+    int status = 0;
+    char *d = abi::__cxa_demangle(mangled.c_str(), NULL, NULL, &status);
+    if (d) {
+      std::string name(d);
+      free(d);
+      return name;
+    }
+    return mangled;
+  }
+  return s;
+}
+
+// the class or namespace owning a frame; used for the coarse
+// per-subsystem rollup
+std::string sampler_subsystem(const std::string& frame)
+{
+  size_t sep = frame.find("::");
+  size_t paren = frame.find('(');
+  if (sep != std::string::npos &&
+      (paren == std::string::npos || sep < paren))
+    return frame.substr(0, sep);
+  return "other";
+}
+
+struct StackCountDesc {
+  bool operator()(const std::pair<const Sample*, uint64_t>& a,
+		  const std::pair<const Sample*, uint64_t>& b) const {
+    return a.second > b.second;
+  }
+};
+
+} // anonymous namespace
+
+int stack_sampler_start(int hz)
+{
+  if (hz <= 0)
+    return -EINVAL;
+  Mutex::Locker l(sampler_lock);
+  if (sampler_active)
+    return -EBUSY;
+
+  // warm up backtrace so the first call from signal context doesn't
+  // take the dynamic loader lock
+  void *warm[SAMPLER_MAX_DEPTH];
+  backtrace(warm, SAMPLER_MAX_DEPTH);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = sampler_handler;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  if (sigaction(SIGPROF, &sa, NULL) < 0)
+    return -errno;
+
+  sampler_hz = hz;
+  sampler_active = 1;
+
+  struct itimerval tv;
+  memset(&tv, 0, sizeof(tv));
+  tv.it_interval.tv_sec = 1 / hz;
+  tv.it_interval.tv_usec = (1000000 / hz) % 1000000;
+  tv.it_value = tv.it_interval;
+  if (setitimer(ITIMER_PROF, &tv, NULL) < 0) {
+    sampler_active = 0;
+    return -errno;
+  }
+  return 0;
+}
+
+void stack_sampler_stop()
+{
+  Mutex::Locker l(sampler_lock);
+  if (!sampler_active)
+    return;
+  sampler_active = 0;
+  struct itimerval tv;
+  memset(&tv, 0, sizeof(tv));
+  setitimer(ITIMER_PROF, &tv, NULL);
+  sampler_drain();
+}
+
+bool stack_sampler_running()
+{
+  return sampler_active;
+}
+
+void stack_sampler_reset()
+{
+  Mutex::Locker l(sampler_lock);
+  sampler_drain();
+  stacks.clear();
+  sampled = 0;
+  lost = 0;
+}
+
+void stack_sampler_status(ceph::Formatter *f)
+{
+  Mutex::Locker l(sampler_lock);
+  sampler_drain();
+  f->open_object_section("stack_sampler");
+  f->dump_string("state", sampler_active ? "running" : "stopped");
+  f->dump_int("hz", sampler_hz);
+  f->dump_unsigned("samples", sampled);
+  f->dump_unsigned("lost", lost);
+  f->dump_unsigned("unique_stacks", stacks.size());
+  f->close_section();
+}
+
+void stack_sampler_dump(ceph::Formatter *f)
+{
+  Mutex::Locker l(sampler_lock);
+  sampler_drain();
+
+  std::map<std::string, uint64_t> subsystems;
+  std::vector<std::pair<const Sample*, uint64_t> > by_count;
+  for (std::map<Sample, uint64_t>::const_iterator p = stacks.begin();
+       p != stacks.end();
+       ++p) {
+    subsystems[sampler_subsystem(
+	sampler_frame_name(p->first.frames[0]))] += p->second;
+    by_count.push_back(std::make_pair(&p->first, p->second));
+  }
+  std::sort(by_count.begin(), by_count.end(), StackCountDesc());
+
+  f->open_object_section("stack_sampler");
+  f->dump_unsigned("samples", sampled);
+  f->dump_unsigned("lost", lost);
+  f->open_object_section("subsystems");
+  for (std::map<std::string, uint64_t>::const_iterator p = subsystems.begin();
+       p != subsystems.end();
+       ++p)
+    f->dump_unsigned(p->first.c_str(), p->second);
+  f->close_section();
+  f->open_array_section("stacks");
+  unsigned n = 0;
+  for (std::vector<std::pair<const Sample*, uint64_t> >::const_iterator
+	 p = by_count.begin();
+       p != by_count.end() && n < SAMPLER_DUMP_STACKS;
+       ++p, ++n) {
+    f->open_object_section("stack");
+    f->dump_unsigned("count", p->second);
+    f->open_array_section("frames");
+    for (int i = 0; i < p->first->depth; ++i)
+      f->dump_string("frame", sampler_frame_name(p->first->frames[i]));
+    f->close_section();
+    f->close_section();
+  }
+  f->close_section();
+  f->close_section();
+}
+
+void stack_sampler_dump_flamegraph(std::ostream& out)
+{
+  Mutex::Locker l(sampler_lock);
+  sampler_drain();
+  for (std::map<Sample, uint64_t>::const_iterator p = stacks.begin();
+       p != stacks.end();
+       ++p) {
+    // flamegraph wants root first, backtrace gives leaf first
+    for (int i = p->first.depth - 1; i >= 0; --i) {
+      out << sampler_frame_name(p->first.frames[i]);
+      if (i)
+	out << ";";
+    }
+    out << " " << p->second << "\n";
+  }
+}
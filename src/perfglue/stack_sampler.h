@@ -0,0 +1,48 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+#ifndef CEPH_PERFGLUE_STACK_SAMPLER
+#define CEPH_PERFGLUE_STACK_SAMPLER
+
+/*
+ * Always-on, low-frequency in-process stack sampler.
+ *
+ * Unlike the gperftools glue in cpu_profiler.cc this has no external
+ * dependency and is cheap enough to leave running in production, so a
+ * latency event can be diagnosed after the fact from the aggregated
+ * profile instead of attaching a profiler to a live daemon.
+ *
+ * Note: the sampler drives SIGPROF via ITIMER_PROF, which is also what
+ * the gperftools CPU profiler uses; do not run both at once.
+ */
+
+#include <iosfwd>
+#include <string>
+
+namespace ceph {
+  class Formatter;
+}
+
+/// start sampling at hz samples per second of consumed cpu time
+int stack_sampler_start(int hz);
+/// stop sampling; the aggregated profile is kept for later dumps
+void stack_sampler_stop();
+bool stack_sampler_running();
+/// drop the aggregated profile and counters
+void stack_sampler_reset();
+/// sampling state and counters
+void stack_sampler_status(ceph::Formatter *f);
+/// per-subsystem aggregation plus the hottest sampled stacks
+void stack_sampler_dump(ceph::Formatter *f);
+/// folded stacks ("root;...;leaf count" per line) for flamegraph.pl
+void stack_sampler_dump_flamegraph(std::ostream& out);
+
+#endif
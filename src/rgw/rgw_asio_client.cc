@@ -0,0 +1,408 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <string.h>
+#include <limits.h>
+
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include "rgw_asio_client.h"
+
+#define dout_subsys ceph_subsys_rgw
+
+#define ASIO_TIME_BUF_SIZE 128
+
+void RGWAsioRequestEnv::clear()
+{
+  request_method.clear();
+  uri.clear();
+  query_string.clear();
+  http_version.clear();
+  headers.clear();
+  content_length = 0;
+  has_content_length = false;
+  chunked = false;
+  keepalive = false;
+  expect_continue = false;
+}
+
+static void trim_whitespace(const char **s, const char **e)
+{
+  while (*s < *e && isspace(**s))
+    (*s)++;
+  while (*e > *s && isspace(*((*e) - 1)))
+    (*e)--;
+}
+
+int RGWAsioRequestEnv::parse(const char *header, size_t header_len)
+{
+  const char *p = header;
+  const char *end = header + header_len;
+
+  /* request line: METHOD SP URI SP HTTP/x.y */
+  const char *eol = std::find(p, end, '\r');
+  const char *sp1 = std::find(p, eol, ' ');
+  if (sp1 == eol) {
+    return -EINVAL;
+  }
+  const char *sp2 = std::find(sp1 + 1, eol, ' ');
+  if (sp2 == eol) {
+    return -EINVAL;
+  }
+  request_method.assign(p, sp1);
+  http_version.assign(sp2 + 1, eol);
+
+  const char *q = std::find(sp1 + 1, sp2, '?');
+  uri.assign(sp1 + 1, q);
+  if (q != sp2) {
+    query_string.assign(q + 1, sp2);
+  }
+
+  /* 1.1 defaults to keep-alive, 1.0 requires an explicit request */
+  bool http_1_1 = (http_version == "HTTP/1.1");
+  keepalive = http_1_1;
+
+  p = (eol == end ? end : eol + 2);
+  while (p < end) {
+    eol = std::find(p, end, '\r');
+    const char *colon = std::find(p, eol, ':');
+    if (colon == eol) {
+      /* folded headers are obsolete (RFC 7230); reject them */
+      return -EINVAL;
+    }
+    const char *name = p;
+    const char *name_end = colon;
+    const char *val = colon + 1;
+    const char *val_end = eol;
+    trim_whitespace(&name, &name_end);
+    trim_whitespace(&val, &val_end);
+
+    string value(val, val_end);
+    size_t name_len = name_end - name;
+
+    if (name_len == strlen("content-length") &&
+        strncasecmp(name, "content-length", name_len) == 0) {
+      char *e = nullptr;
+      content_length = strtoull(value.c_str(), &e, 10);
+      if (e == nullptr || *e != '\0') {
+        return -EINVAL;
+      }
+      has_content_length = true;
+      headers["CONTENT_LENGTH"] = value;
+    } else if (name_len == strlen("content-type") &&
+               strncasecmp(name, "content-type", name_len) == 0) {
+      headers["CONTENT_TYPE"] = value;
+    } else {
+      if (name_len == strlen("connection") &&
+          strncasecmp(name, "connection", name_len) == 0) {
+        if (strcasecmp(value.c_str(), "keep-alive") == 0) {
+          keepalive = true;
+        } else if (strcasecmp(value.c_str(), "close") == 0) {
+          keepalive = false;
+        }
+      } else if (name_len == strlen("transfer-encoding") &&
+                 strncasecmp(name, "transfer-encoding", name_len) == 0) {
+        chunked = (strcasecmp(value.c_str(), "chunked") == 0);
+      } else if (name_len == strlen("expect") &&
+                 strncasecmp(name, "expect", name_len) == 0) {
+        expect_continue = (strcasecmp(value.c_str(), "100-continue") == 0);
+      }
+
+      string cgi_name("HTTP_");
+      for (const char *c = name; c < name_end; c++) {
+        cgi_name.push_back(*c == '-' ? '_' : toupper(*c));
+      }
+      headers[cgi_name] = value;
+    }
+
+    p = (eol == end ? end : eol + 2);
+  }
+
+  /* a chunked body overrides any content-length header */
+  if (chunked) {
+    has_content_length = false;
+  }
+  return 0;
+}
+
+RGWAsioClientIO::RGWAsioClientIO(boost::asio::ip::tcp::socket *_sock,
+                                 RGWAsioRequestEnv *_req,
+                                 string&& _pre_read, int _port)
+  : sock(_sock), req(_req), pre_read(std::move(_pre_read)), pre_read_off(0),
+    port(_port), status_num(0), header_done(false), sent_header(false),
+    has_content_length(false), body_remaining(req->content_length),
+    chunk_remaining(0), chunks_done(false), conn_error(false)
+{
+}
+
+int RGWAsioClientIO::read_raw(char *buf, int len)
+{
+  if (pre_read_off < pre_read.size()) {
+    int l = MIN((size_t)len, pre_read.size() - pre_read_off);
+    memcpy(buf, pre_read.data() + pre_read_off, l);
+    pre_read_off += l;
+    return l;
+  }
+
+  boost::system::error_code ec;
+  size_t r = sock->read_some(boost::asio::buffer(buf, len), ec);
+  if (ec == boost::asio::error::eof) {
+    return 0;
+  } else if (ec) {
+    conn_error = true;
+    return -EIO;
+  }
+  return r;
+}
+
+int RGWAsioClientIO::read_line(string *line)
+{
+  line->clear();
+  char c;
+  for (;;) {
+    int r = read_raw(&c, 1);
+    if (r < 0) {
+      return r;
+    } else if (r == 0) {
+      return -EIO;
+    }
+    if (c == '\n') {
+      if (!line->empty() && (*line)[line->size() - 1] == '\r') {
+        line->erase(line->size() - 1);
+      }
+      return 0;
+    }
+    if (line->size() >= 1024) {
+      return -EINVAL;
+    }
+    line->push_back(c);
+  }
+}
+
+int RGWAsioClientIO::read_chunked(char *buf, int len)
+{
+  if (chunks_done) {
+    return 0;
+  }
+
+  if (chunk_remaining == 0) {
+    string line;
+    int r = read_line(&line);
+    if (r < 0) {
+      return r;
+    }
+    char *e = nullptr;
+    chunk_remaining = strtoull(line.c_str(), &e, 16);
+    if (e == line.c_str()) {
+      conn_error = true;
+      return -EINVAL;
+    }
+    if (chunk_remaining == 0) {
+      /* consume the trailer up to the final empty line */
+      do {
+        r = read_line(&line);
+        if (r < 0) {
+          return r;
+        }
+      } while (!line.empty());
+      chunks_done = true;
+      return 0;
+    }
+  }
+
+  int l = MIN((uint64_t)len, chunk_remaining);
+  int r = read_raw(buf, l);
+  if (r <= 0) {
+    conn_error = true;
+    return (r < 0 ? r : -EIO);
+  }
+  chunk_remaining -= r;
+  if (chunk_remaining == 0) {
+    /* trailing CRLF after the chunk data */
+    string crlf;
+    int ret = read_line(&crlf);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  return r;
+}
+
+int RGWAsioClientIO::read_data(char *buf, int len)
+{
+  if (req->chunked) {
+    return read_chunked(buf, len);
+  }
+  if (body_remaining == 0) {
+    return 0;
+  }
+  int l = MIN((uint64_t)len, body_remaining);
+  int r = read_raw(buf, l);
+  if (r < 0) {
+    return r;
+  }
+  body_remaining -= r;
+  return r;
+}
+
+int RGWAsioClientIO::write_raw(const char *buf, int len)
+{
+  boost::system::error_code ec;
+  boost::asio::write(*sock, boost::asio::buffer(buf, len), ec);
+  if (ec) {
+    conn_error = true;
+    return -EIO;
+  }
+  return len;
+}
+
+int RGWAsioClientIO::write_data(const char *buf, int len)
+{
+  if (!header_done) {
+    header_data.append(buf, len);
+    return len;
+  }
+  if (!sent_header) {
+    data.append(buf, len);
+    return len;
+  }
+  return write_raw(buf, len);
+}
+
+void RGWAsioClientIO::flush()
+{
+}
+
+int RGWAsioClientIO::complete_request()
+{
+  if (!sent_header) {
+    if (!has_content_length) {
+      header_done = false; /* let's go back to writing the header */
+
+      /* status 204 and 304 must not include a content-length header
+       * (RFC 7230) */
+      if (status_num == 204 || status_num == 304) {
+        has_content_length = true;
+      } else {
+        int r = send_content_length(data.length());
+        if (r < 0)
+          return r;
+      }
+    }
+
+    complete_header();
+  }
+
+  if (data.length()) {
+    int r = write_data(data.c_str(), data.length());
+    if (r < 0)
+      return r;
+    data.clear();
+  }
+
+  /* drain any unread body so the next request on the connection starts
+   * at the right offset */
+  if (req->keepalive && !conn_error) {
+    char buf[4096];
+    int r;
+    do {
+      r = read_data(buf, sizeof(buf));
+    } while (r > 0);
+    if (r < 0) {
+      conn_error = true;
+    }
+  }
+
+  return 0;
+}
+
+void RGWAsioClientIO::init_env(CephContext *cct)
+{
+  env.init(cct);
+
+  for (map<string, string>::iterator iter = req->headers.begin();
+       iter != req->headers.end(); ++iter) {
+    env.set(iter->first.c_str(), iter->second.c_str());
+  }
+
+  env.set("REQUEST_METHOD", req->request_method.c_str());
+  env.set("REQUEST_URI", req->uri.c_str());
+  env.set("QUERY_STRING", req->query_string.c_str());
+  env.set("SCRIPT_URI", req->uri.c_str()); /* FIXME */
+
+  char port_buf[16];
+  snprintf(port_buf, sizeof(port_buf), "%d", port);
+  env.set("SERVER_PORT", port_buf);
+}
+
+int RGWAsioClientIO::send_status(int status, const char *status_name)
+{
+  char buf[128];
+
+  if (!status_name)
+    status_name = "";
+
+  snprintf(buf, sizeof(buf), "HTTP/1.1 %d %s\r\n", status, status_name);
+
+  bufferlist bl;
+  bl.append(buf);
+  bl.append(header_data);
+  header_data = bl;
+
+  status_num = status;
+
+  return 0;
+}
+
+int RGWAsioClientIO::send_100_continue()
+{
+  const char buf[] = "HTTP/1.1 100 CONTINUE\r\n\r\n";
+
+  return write_raw(buf, sizeof(buf) - 1);
+}
+
+static void dump_date_header(bufferlist &out)
+{
+  char timestr[ASIO_TIME_BUF_SIZE];
+  const time_t gtime = time(NULL);
+  struct tm result;
+  struct tm const * const tmp = gmtime_r(&gtime, &result);
+
+  if (tmp == NULL)
+    return;
+
+  if (strftime(timestr, sizeof(timestr),
+	       "Date: %a, %d %b %Y %H:%M:%S %Z\r\n", tmp))
+    out.append(timestr);
+}
+
+int RGWAsioClientIO::complete_header()
+{
+  header_done = true;
+
+  if (!has_content_length) {
+    return 0;
+  }
+
+  dump_date_header(header_data);
+
+  if (req->keepalive)
+    header_data.append("Connection: Keep-Alive\r\n");
+  else
+    header_data.append("Connection: close\r\n");
+
+  header_data.append("\r\n");
+
+  sent_header = true;
+
+  return write_data(header_data.c_str(), header_data.length());
+}
+
+int RGWAsioClientIO::send_content_length(uint64_t len)
+{
+  has_content_length = true;
+  char buf[21];
+  snprintf(buf, sizeof(buf), "%" PRIu64, len);
+  return print("Content-Length: %s\r\n", buf);
+}
@@ -0,0 +1,96 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_RGW_ASIO_CLIENT_H
+#define CEPH_RGW_ASIO_CLIENT_H
+
+#include <boost/asio/ip/tcp.hpp>
+
+#include "rgw_client_io.h"
+
+/* parsed request header for a single http request on an asio connection;
+ * header names are stored in their CGI form (HTTP_*) so that they can be
+ * copied directly into RGWEnv */
+struct RGWAsioRequestEnv {
+  string request_method;
+  string uri;
+  string query_string;
+  string http_version;
+
+  map<string, string> headers;
+
+  uint64_t content_length;
+  bool has_content_length;
+  bool chunked;
+  bool keepalive;
+  bool expect_continue;
+
+  RGWAsioRequestEnv() : content_length(0), has_content_length(false),
+                        chunked(false), keepalive(false),
+                        expect_continue(false) {}
+
+  void clear();
+
+  /* parse a complete request header block (up to but not including the
+   * terminating empty line).  returns 0 on success, negative error code
+   * on malformed input */
+  int parse(const char *header, size_t header_len);
+};
+
+class RGWAsioClientIO : public RGWStreamIO
+{
+  boost::asio::ip::tcp::socket *sock;
+  RGWAsioRequestEnv *req;
+
+  /* bytes read past the end of the request header */
+  string pre_read;
+  size_t pre_read_off;
+
+  bufferlist header_data;
+  bufferlist data;
+
+  int port;
+  int status_num;
+
+  bool header_done;
+  bool sent_header;
+  bool has_content_length;
+
+  uint64_t body_remaining;
+  uint64_t chunk_remaining;
+  bool chunks_done;
+  bool conn_error;
+
+  int read_raw(char *buf, int len);
+  int read_line(string *line);
+  int read_chunked(char *buf, int len);
+  int write_raw(const char *buf, int len);
+
+public:
+  void init_env(CephContext *cct);
+
+  int write_data(const char *buf, int len);
+  int read_data(char *buf, int len);
+
+  int send_status(int status, const char *status_name);
+  int send_100_continue();
+  int complete_header();
+  int complete_request();
+  int send_content_length(uint64_t len);
+
+  RGWAsioClientIO(boost::asio::ip::tcp::socket *_sock,
+                  RGWAsioRequestEnv *_req, string&& _pre_read, int _port);
+  void flush();
+
+  /* true if the connection can no longer be reused for keep-alive */
+  bool get_conn_error() const { return conn_error; }
+
+  /* return any bytes read past the end of this request (pipelining) */
+  string take_leftover() {
+    pre_read.erase(0, pre_read_off);
+    pre_read_off = 0;
+    return std::move(pre_read);
+  }
+};
+
+#endif /* CEPH_RGW_ASIO_CLIENT_H */
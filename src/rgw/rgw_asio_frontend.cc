@@ -0,0 +1,260 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <memory>
+
+#include <boost/asio.hpp>
+
+#include "common/errno.h"
+#include "common/Throttle.h"
+#include "common/WorkQueue.h"
+
+#include "rgw_rados.h"
+#include "rgw_rest.h"
+#include "rgw_frontend.h"
+#include "rgw_request.h"
+#include "rgw_process.h"
+#include "rgw_client_io.h"
+#include "rgw_asio_client.h"
+#include "rgw_asio_frontend.h"
+
+#define dout_subsys ceph_subsys_rgw
+
+using boost::asio::ip::tcp;
+
+class RGWAsioConnection;
+
+struct RGWAsioRequest : public RGWRequest {
+  std::shared_ptr<RGWAsioConnection> conn;
+
+  RGWAsioRequest(uint64_t req_id, std::shared_ptr<RGWAsioConnection> _conn)
+    : RGWRequest(req_id), conn(std::move(_conn)) {}
+};
+
+class RGWAsioProcess : public RGWProcess {
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor;
+  int port;
+
+  void start_accept();
+
+public:
+  RGWAsioProcess(CephContext* cct, RGWProcessEnv* pe, int num_threads,
+		 RGWFrontendConfig* _conf)
+    : RGWProcess(cct, pe, num_threads, _conf), acceptor(io_service),
+      port(pe->port) {}
+
+  void run() override;
+  void handle_request(RGWRequest* req) override;
+
+  /* hand a connection with a complete request header over to the
+   * worker pool */
+  void queue_connection(std::shared_ptr<RGWAsioConnection> conn);
+
+  void stop_io() {
+    io_service.stop();
+  }
+}; /* RGWAsioProcess */
+
+/* one accepted connection; waits for request headers on the event loop
+ * and bounces between the event loop (header wait) and the worker pool
+ * (request execution) until the peer hangs up */
+class RGWAsioConnection : public std::enable_shared_from_this<RGWAsioConnection> {
+  static const size_t MAX_HEADER_SIZE = 16 * 1024;
+
+  RGWAsioProcess* process;
+  tcp::socket socket_;
+
+  string header_buf;
+  string leftover;
+  RGWAsioRequestEnv env;
+
+  char rbuf[4096];
+
+  void read_some() {
+    auto self = shared_from_this();
+    socket_.async_read_some(boost::asio::buffer(rbuf, sizeof(rbuf)),
+	[self](const boost::system::error_code& ec, size_t bytes) {
+	  self->handle_read(ec, bytes);
+	});
+  }
+
+  void handle_read(const boost::system::error_code& ec, size_t bytes) {
+    if (ec) {
+      /* eof or connection error */
+      close();
+      return;
+    }
+    header_buf.append(rbuf, bytes);
+    if (!check_header_complete()) {
+      if (header_buf.size() > MAX_HEADER_SIZE) {
+	dout(5) << "request header exceeds " << MAX_HEADER_SIZE
+		<< " bytes, closing connection" << dendl;
+	close();
+	return;
+      }
+      read_some();
+    }
+  }
+
+  /* if a complete header block has arrived, parse it and queue the
+   * request; returns false if more data is needed */
+  bool check_header_complete() {
+    /* tolerate stray CRLFs between requests */
+    size_t start = 0;
+    while (header_buf.compare(start, 2, "\r\n") == 0) {
+      start += 2;
+    }
+    if (start > 0) {
+      header_buf.erase(0, start);
+    }
+
+    size_t pos = header_buf.find("\r\n\r\n");
+    if (pos == string::npos) {
+      return false;
+    }
+
+    leftover = header_buf.substr(pos + 4);
+    int r = env.parse(header_buf.c_str(), pos);
+    header_buf.clear();
+    if (r < 0) {
+      dout(5) << "failed to parse request header: " << cpp_strerror(r)
+	      << dendl;
+      close();
+      return true;
+    }
+
+    process->queue_connection(shared_from_this());
+    return true;
+  }
+
+public:
+  RGWAsioConnection(RGWAsioProcess* p, boost::asio::io_service& io_service)
+    : process(p), socket_(io_service) {}
+
+  tcp::socket& socket() {
+    return socket_;
+  }
+
+  RGWAsioRequestEnv* get_env() {
+    return &env;
+  }
+
+  string take_leftover() {
+    return std::move(leftover);
+  }
+
+  void set_leftover(string&& _leftover) {
+    leftover = std::move(_leftover);
+  }
+
+  /* begin waiting for the next request; pipelined data that was read
+   * beyond the previous request is inspected first */
+  void read_request() {
+    env.clear();
+    header_buf = std::move(leftover);
+    leftover.clear();
+    if (!check_header_complete()) {
+      read_some();
+    }
+  }
+
+  void close() {
+    boost::system::error_code ec;
+    socket_.close(ec);
+  }
+}; /* RGWAsioConnection */
+
+void RGWAsioProcess::start_accept()
+{
+  auto conn = std::make_shared<RGWAsioConnection>(this, io_service);
+  acceptor.async_accept(conn->socket(),
+      [this, conn](const boost::system::error_code& ec) {
+	if (!ec) {
+	  boost::system::error_code no_delay_ec;
+	  conn->socket().set_option(tcp::no_delay(true), no_delay_ec);
+	  conn->read_request();
+	}
+	if (ec != boost::asio::error::operation_aborted) {
+	  start_accept();
+	}
+      });
+}
+
+void RGWAsioProcess::queue_connection(std::shared_ptr<RGWAsioConnection> conn)
+{
+  RGWAsioRequest* req = new RGWAsioRequest(store->get_new_req_id(),
+					   std::move(conn));
+  dout(10) << "allocated request req=" << hex << req << dec << dendl;
+  req_throttle.get(1);
+  req_wq.queue(req);
+}
+
+void RGWAsioProcess::run()
+{
+  tcp::endpoint ep(tcp::v4(), port);
+  boost::system::error_code ec;
+
+  acceptor.open(ep.protocol(), ec);
+  if (!ec) {
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+    acceptor.bind(ep, ec);
+  }
+  if (!ec) {
+    acceptor.listen(boost::asio::socket_base::max_connections, ec);
+  }
+  if (ec) {
+    derr << "asio frontend failed to listen on port " << port << ": "
+	 << ec.message() << dendl;
+    return;
+  }
+
+  m_tp.start(); /* start request worker pool */
+  start_accept();
+
+  dout(1) << "asio frontend listening on port " << port << dendl;
+  io_service.run();
+
+  m_tp.drain(&req_wq);
+  m_tp.stop();
+}
+
+void RGWAsioProcess::handle_request(RGWRequest* r)
+{
+  RGWAsioRequest* req = static_cast<RGWAsioRequest*>(r);
+  std::shared_ptr<RGWAsioConnection> conn = req->conn;
+
+  RGWAsioClientIO client_io(&conn->socket(), conn->get_env(),
+			    conn->take_leftover(), port);
+
+  int ret = process_request(store, rest, req, &client_io, olog);
+  if (ret < 0) {
+    /* we don't really care about return code */
+    dout(20) << "process_request() returned " << ret << dendl;
+  }
+
+  if (conn->get_env()->keepalive && !client_io.get_conn_error()) {
+    /* park the connection back on the event loop until the next
+     * request arrives */
+    conn->set_leftover(client_io.take_leftover());
+    conn->read_request();
+  } else {
+    conn->close();
+  }
+
+  delete req;
+}
+
+int RGWAsioFrontend::init()
+{
+  int num_threads;
+  conf->get_val("num_threads", g_conf->rgw_thread_pool_size, &num_threads);
+  asio_process = new RGWAsioProcess(g_ceph_context, &env, num_threads, conf);
+  pprocess = asio_process;
+  return 0;
+}
+
+void RGWAsioFrontend::stop()
+{
+  asio_process->stop_io();
+}
@@ -0,0 +1,25 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_RGW_ASIO_FRONTEND_H
+#define CEPH_RGW_ASIO_FRONTEND_H
+
+#include "rgw_frontend.h"
+
+class RGWAsioProcess;
+
+/* async frontend: a single event loop multiplexes all connections and
+ * parses request headers, so idle keep-alive connections don't hold a
+ * thread; only requests that are actually executing occupy one of the
+ * worker pool threads */
+class RGWAsioFrontend : public RGWProcessFrontend {
+  RGWAsioProcess* asio_process; /* alias of pprocess */
+public:
+  RGWAsioFrontend(RGWProcessEnv& pe, RGWFrontendConfig* _conf)
+    : RGWProcessFrontend(pe, _conf), asio_process(nullptr) {}
+
+  int init() override;
+  void stop() override;
+}; /* RGWAsioFrontend */
+
+#endif /* CEPH_RGW_ASIO_FRONTEND_H */
@@ -467,17 +467,33 @@ RGWAuthApplier::aplptr_t RGWKeystoneAuthEngine::authenticate() const
                                             get_creds_info(t, roles.admin));
   }
 
+  /* Was this token rejected recently? Negative caching saves a round trip
+   * to Keystone when a client retries with bad credentials under burst. */
+  if (RGWKeystoneTokenCache::get_instance().find_invalid(token_id)) {
+    ldout(cct, 5) << "rejecting negatively cached token_id=" << token_id
+                  << dendl;
+    return nullptr;
+  }
+
   /* Retrieve token. */
-  if (rgw_is_pki_token(token)) {
-    try {
-      t = decode_pki_token(token);
-    } catch (...) {
-      /* Last resort. */
+  try {
+    if (rgw_is_pki_token(token)) {
+      try {
+        t = decode_pki_token(token);
+      } catch (...) {
+        /* Last resort. */
+        t = get_from_keystone(token);
+      }
+    } else {
+      /* Can't decode, just go to the Keystone server for validation. */
       t = get_from_keystone(token);
     }
-  } else {
-    /* Can't decode, just go to the Keystone server for validation. */
-    t = get_from_keystone(token);
+  } catch (const int err) {
+    if (err == -EACCES) {
+      /* Keystone rejected the token - remember that for a while. */
+      RGWKeystoneTokenCache::get_instance().add_invalid(token_id);
+    }
+    throw;
   }
 
   /* Verify expiration. */
@@ -503,6 +519,7 @@ RGWAuthApplier::aplptr_t RGWKeystoneAuthEngine::authenticate() const
 
   ldout(cct, 0) << "user does not hold a matching role; required roles: "
                 << g_conf->rgw_keystone_accepted_roles << dendl;
+  RGWKeystoneTokenCache::get_instance().add_invalid(token_id);
 
   return nullptr;
 }
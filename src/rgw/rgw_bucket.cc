@@ -518,6 +518,137 @@ int rgw_remove_object(RGWRados *store, RGWBucketInfo& bucket_info, rgw_bucket& b
   return store->delete_obj(rctx, bucket_info, obj, bucket_info.versioning_status());
 }
 
+RGWParallelObjDeleter::RGWParallelObjDeleter(RGWRados *_store, RGWBucketInfo& _bucket_info,
+                                             const rgw_user& _bucket_owner, const ACLOwner& _obj_owner,
+                                             int _versioning_status, int num_threads)
+  : store(_store), bucket_info(_bucket_info), bucket_owner(_bucket_owner),
+    obj_owner(_obj_owner), versioning_status(_versioning_status),
+    lock("RGWParallelObjDeleter"), in_flight(0), eof(false)
+{
+  if (num_threads < 1)
+    num_threads = 1;
+  for (int i = 0; i < num_threads; i++) {
+    DelWorker *w = new DelWorker(this);
+    w->create("rgw_obj_del");
+    workers.push_back(w);
+  }
+}
+
+RGWParallelObjDeleter::~RGWParallelObjDeleter()
+{
+  {
+    Mutex::Locker l(lock);
+    eof = true;
+    in_cond.SignalAll();
+  }
+  for (vector<DelWorker *>::iterator iter = workers.begin(); iter != workers.end(); ++iter) {
+    (*iter)->join();
+    delete *iter;
+  }
+}
+
+void RGWParallelObjDeleter::submit(const rgw_obj_key& key)
+{
+  del_job job;
+  job.key = key;
+  Mutex::Locker l(lock);
+  jobs.push_back(job);
+  in_cond.Signal();
+}
+
+void RGWParallelObjDeleter::submit(const rgw_obj_key& key, const ceph::real_time& expected_mtime)
+{
+  del_job job;
+  job.key = key;
+  job.check_mtime = true;
+  job.mtime = expected_mtime;
+  Mutex::Locker l(lock);
+  jobs.push_back(job);
+  in_cond.Signal();
+}
+
+void RGWParallelObjDeleter::worker()
+{
+  lock.Lock();
+  while (true) {
+    while (jobs.empty() && !eof) {
+      in_cond.Wait(lock);
+    }
+    if (jobs.empty())
+      break;
+    del_job job = jobs.front();
+    jobs.pop_front();
+    in_flight++;
+    lock.Unlock();
+
+    rgw_obj_del_result res;
+    res.key = job.key;
+    process(job, &res);
+
+    lock.Lock();
+    in_flight--;
+    results.push_back(res);
+    out_cond.Signal();
+  }
+  lock.Unlock();
+}
+
+void RGWParallelObjDeleter::process(del_job& job, rgw_obj_del_result *res)
+{
+  /* each worker carries its own obj ctx, same as the async removal path
+   * of the sync machinery does */
+  RGWObjectCtx obj_ctx(store);
+  rgw_obj obj(bucket_info.bucket, job.key);
+
+  if (job.check_mtime) {
+    rgw_obj state_obj = obj;
+    if (state_obj.get_instance() == "null") {
+      state_obj.clear_instance();
+    }
+    RGWObjState *state;
+    int ret = store->get_obj_state(&obj_ctx, state_obj, &state, false);
+    if (ret < 0) {
+      res->ret = ret;
+      return;
+    }
+    /* don't remove an object that was written over since we looked */
+    if (state->mtime != job.mtime) {
+      res->ret = -ECANCELED;
+      return;
+    }
+  }
+
+  obj_ctx.set_atomic(obj);
+
+  RGWRados::Object del_target(store, bucket_info, obj_ctx, obj);
+  RGWRados::Object::Delete del_op(&del_target);
+
+  del_op.params.bucket_owner = bucket_owner;
+  del_op.params.versioning_status = versioning_status;
+  del_op.params.obj_owner = obj_owner;
+
+  int ret = del_op.delete_obj();
+  if (ret == -ENOENT) {
+    ret = 0;
+  }
+  res->ret = ret;
+  res->delete_marker = del_op.result.delete_marker;
+  res->version_id = del_op.result.version_id;
+}
+
+bool RGWParallelObjDeleter::wait_result(rgw_obj_del_result *result)
+{
+  Mutex::Locker l(lock);
+  while (results.empty() && (!jobs.empty() || in_flight > 0)) {
+    out_cond.Wait(lock);
+  }
+  if (results.empty())
+    return false;
+  *result = results.front();
+  results.pop_front();
+  return true;
+}
+
 int rgw_remove_bucket(RGWRados *store, rgw_bucket& bucket, bool delete_children)
 {
   int ret;
@@ -6,6 +6,7 @@
 
 #include <string>
 #include <memory>
+#include <deque>
 
 #include "include/types.h"
 #include "rgw_common.h"
@@ -18,6 +19,9 @@
 #include "common/Formatter.h"
 #include "common/lru_map.h"
 #include "common/ceph_time.h"
+#include "common/Mutex.h"
+#include "common/Cond.h"
+#include "common/Thread.h"
 #include "rgw_formats.h"
 
 
@@ -180,6 +184,71 @@ extern int rgw_remove_object(RGWRados *store, RGWBucketInfo& bucket_info, rgw_bu
 extern int rgw_remove_bucket(RGWRados *store, rgw_bucket& bucket, bool delete_children);
 extern int rgw_remove_bucket_bypass_gc(RGWRados *store, rgw_bucket& bucket, int concurrent_max);
 
+struct rgw_obj_del_result {
+  rgw_obj_key key;
+  bool delete_marker;
+  string version_id;
+  int ret;
+
+  rgw_obj_del_result() : delete_marker(false), ret(0) {}
+};
+
+/* fans object removals out over a set of worker threads, each of them running
+ * the full RGWRados::Object::Delete path (versioning, bilog and atomicity
+ * guards included), so one slow rados op doesn't serialize a whole bulk
+ * delete.  Feed keys in with submit(), reap per-key outcomes with
+ * wait_result(); results come back in completion order. */
+class RGWParallelObjDeleter {
+  struct DelWorker : public Thread {
+    RGWParallelObjDeleter *deleter;
+    explicit DelWorker(RGWParallelObjDeleter *_deleter) : deleter(_deleter) {}
+    void *entry() {
+      deleter->worker();
+      return NULL;
+    }
+  };
+
+  struct del_job {
+    rgw_obj_key key;
+    bool check_mtime;
+    ceph::real_time mtime;
+
+    del_job() : check_mtime(false) {}
+  };
+
+  RGWRados *store;
+  RGWBucketInfo bucket_info;
+  rgw_user bucket_owner;
+  ACLOwner obj_owner;
+  int versioning_status;
+
+  Mutex lock;
+  Cond in_cond;
+  Cond out_cond;
+  std::deque<del_job> jobs;
+  std::list<rgw_obj_del_result> results;
+  unsigned in_flight;
+  bool eof;
+
+  vector<DelWorker *> workers;
+
+  void worker();
+  void process(del_job& job, rgw_obj_del_result *res);
+
+public:
+  RGWParallelObjDeleter(RGWRados *_store, RGWBucketInfo& _bucket_info,
+                        const rgw_user& _bucket_owner, const ACLOwner& _obj_owner,
+                        int _versioning_status, int num_threads);
+  ~RGWParallelObjDeleter();
+
+  void submit(const rgw_obj_key& key);
+  /* only remove the object if its mtime still matches, otherwise skip it
+   * and report -ECANCELED */
+  void submit(const rgw_obj_key& key, const ceph::real_time& expected_mtime);
+  /* returns false once every submitted key has been reaped */
+  bool wait_result(rgw_obj_del_result *result);
+};
+
 extern int rgw_bucket_set_attrs(RGWRados *store, RGWBucketInfo& bucket_info,
                                 map<string, bufferlist>& attrs,
                                 RGWObjVersionTracker *objv_tracker);
@@ -11,14 +11,15 @@ using namespace std;
 
 int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cache_entry_info *cache_info)
 {
-  RWLock::RLocker l(lock);
+  Shard& shard = get_shard(name);
+  RWLock::RLocker l(shard.lock);
 
   if (!enabled) {
     return -ENOENT;
   }
 
-  map<string, ObjectCacheEntry>::iterator iter = cache_map.find(name);
-  if (iter == cache_map.end()) {
+  map<string, ObjectCacheEntry>::iterator iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end()) {
     ldout(cct, 10) << "cache get: name=" << name << " : miss" << dendl;
     if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
     return -ENOENT;
@@ -26,14 +27,14 @@ int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cac
 
   ObjectCacheEntry *entry = &iter->second;
 
-  if (lru_counter - entry->lru_promotion_ts > lru_window) {
-    ldout(cct, 20) << "cache get: touching lru, lru_counter=" << lru_counter << " promotion_ts=" << entry->lru_promotion_ts << dendl;
-    lock.unlock();
-    lock.get_write(); /* promote lock to writer */
+  if (shard.lru_counter - entry->lru_promotion_ts > lru_window) {
+    ldout(cct, 20) << "cache get: touching lru, lru_counter=" << shard.lru_counter << " promotion_ts=" << entry->lru_promotion_ts << dendl;
+    shard.lock.unlock();
+    shard.lock.get_write(); /* promote lock to writer */
 
     /* need to redo this because entry might have dropped off the cache */
-    iter = cache_map.find(name);
-    if (iter == cache_map.end()) {
+    iter = shard.cache_map.find(name);
+    if (iter == shard.cache_map.end()) {
       ldout(cct, 10) << "lost race! cache get: name=" << name << " : miss" << dendl;
       if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
       return -ENOENT;
@@ -41,8 +42,8 @@ int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cac
 
     entry = &iter->second;
     /* check again, we might have lost a race here */
-    if (lru_counter - entry->lru_promotion_ts > lru_window) {
-      touch_lru(name, *entry, iter->second.lru_iter);
+    if (shard.lru_counter - entry->lru_promotion_ts > lru_window) {
+      touch_lru(shard, name, *entry, iter->second.lru_iter);
     }
   }
 
@@ -66,66 +67,86 @@ int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cac
 
 bool ObjectCache::chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry)
 {
-  RWLock::WLocker l(lock);
-
-  if (!enabled) {
-    return false;
+  /* entries may live in different shards; take the affected shard locks
+   * in index order to avoid deadlocking against other chainers */
+  std::set<int> shard_ids;
+  for (list<rgw_cache_entry_info *>::iterator citer = cache_info_entries.begin();
+       citer != cache_info_entries.end(); ++citer) {
+    const string& name = (*citer)->cache_locator;
+    shard_ids.insert(ceph_str_hash_linux(name.c_str(), name.size()) % num_shards);
+  }
+  for (std::set<int>::iterator siter = shard_ids.begin();
+       siter != shard_ids.end(); ++siter) {
+    shards[*siter].lock.get_write();
   }
 
-  list<rgw_cache_entry_info *>::iterator citer;
+  bool ret = false;
 
-  list<ObjectCacheEntry *> cache_entry_list;
+  if (enabled) {
+    list<rgw_cache_entry_info *>::iterator citer;
 
-  /* first verify that all entries are still valid */
-  for (citer = cache_info_entries.begin(); citer != cache_info_entries.end(); ++citer) {
-    rgw_cache_entry_info *cache_info = *citer;
+    list<ObjectCacheEntry *> cache_entry_list;
 
-    ldout(cct, 10) << "chain_cache_entry: cache_locator=" << cache_info->cache_locator << dendl;
-    map<string, ObjectCacheEntry>::iterator iter = cache_map.find(cache_info->cache_locator);
-    if (iter == cache_map.end()) {
-      ldout(cct, 20) << "chain_cache_entry: couldn't find cachce locator" << dendl;
-      return false;
-    }
+    /* first verify that all entries are still valid */
+    for (citer = cache_info_entries.begin(); citer != cache_info_entries.end(); ++citer) {
+      rgw_cache_entry_info *cache_info = *citer;
+
+      ldout(cct, 10) << "chain_cache_entry: cache_locator=" << cache_info->cache_locator << dendl;
+      Shard& shard = get_shard(cache_info->cache_locator);
+      map<string, ObjectCacheEntry>::iterator iter = shard.cache_map.find(cache_info->cache_locator);
+      if (iter == shard.cache_map.end()) {
+        ldout(cct, 20) << "chain_cache_entry: couldn't find cachce locator" << dendl;
+        goto done;
+      }
 
-    ObjectCacheEntry *entry = &iter->second;
+      ObjectCacheEntry *entry = &iter->second;
 
-    if (entry->gen != cache_info->gen) {
-      ldout(cct, 20) << "chain_cache_entry: entry.gen (" << entry->gen << ") != cache_info.gen (" << cache_info->gen << ")" << dendl;
-      return false;
+      if (entry->gen != cache_info->gen) {
+        ldout(cct, 20) << "chain_cache_entry: entry.gen (" << entry->gen << ") != cache_info.gen (" << cache_info->gen << ")" << dendl;
+        goto done;
+      }
+
+      cache_entry_list.push_back(entry);
     }
 
-    cache_entry_list.push_back(entry);
-  }
 
+    chained_entry->cache->chain_cb(chained_entry->key, chained_entry->data);
 
-  chained_entry->cache->chain_cb(chained_entry->key, chained_entry->data);
+    list<ObjectCacheEntry *>::iterator liter;
 
-  list<ObjectCacheEntry *>::iterator liter;
+    for (liter = cache_entry_list.begin(); liter != cache_entry_list.end(); ++liter) {
+      ObjectCacheEntry *entry = *liter;
 
-  for (liter = cache_entry_list.begin(); liter != cache_entry_list.end(); ++liter) {
-    ObjectCacheEntry *entry = *liter;
+      entry->chained_entries.push_back(make_pair(chained_entry->cache, chained_entry->key));
+    }
 
-    entry->chained_entries.push_back(make_pair(chained_entry->cache, chained_entry->key));
+    ret = true;
   }
 
-  return true;
+done:
+  for (std::set<int>::reverse_iterator siter = shard_ids.rbegin();
+       siter != shard_ids.rend(); ++siter) {
+    shards[*siter].lock.unlock();
+  }
+  return ret;
 }
 
 void ObjectCache::put(string& name, ObjectCacheInfo& info, rgw_cache_entry_info *cache_info)
 {
-  RWLock::WLocker l(lock);
+  Shard& shard = get_shard(name);
+  RWLock::WLocker l(shard.lock);
 
   if (!enabled) {
     return;
   }
 
   ldout(cct, 10) << "cache put: name=" << name << " info.flags=" << info.flags << dendl;
-  map<string, ObjectCacheEntry>::iterator iter = cache_map.find(name);
-  if (iter == cache_map.end()) {
+  map<string, ObjectCacheEntry>::iterator iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end()) {
     ObjectCacheEntry entry;
-    entry.lru_iter = lru.end();
-    cache_map.insert(pair<string, ObjectCacheEntry>(name, entry));
-    iter = cache_map.find(name);
+    entry.lru_iter = shard.lru.end();
+    shard.cache_map.insert(pair<string, ObjectCacheEntry>(name, entry));
+    iter = shard.cache_map.find(name);
   }
   ObjectCacheEntry& entry = iter->second;
   ObjectCacheInfo& target = entry.info;
@@ -139,7 +160,7 @@ void ObjectCache::put(string& name, ObjectCacheInfo& info, rgw_cache_entry_info
   entry.chained_entries.clear();
   entry.gen++;
 
-  touch_lru(name, entry, entry.lru_iter);
+  touch_lru(shard, name, entry, entry.lru_iter);
 
   target.status = info.status;
 
@@ -189,14 +210,15 @@ void ObjectCache::put(string& name, ObjectCacheInfo& info, rgw_cache_entry_info
 
 void ObjectCache::remove(string& name)
 {
-  RWLock::WLocker l(lock);
+  Shard& shard = get_shard(name);
+  RWLock::WLocker l(shard.lock);
 
   if (!enabled) {
     return;
   }
 
-  map<string, ObjectCacheEntry>::iterator iter = cache_map.find(name);
-  if (iter == cache_map.end())
+  map<string, ObjectCacheEntry>::iterator iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end())
     return;
 
   ldout(cct, 10) << "removing " << name << " from cache" << dendl;
@@ -208,14 +230,15 @@ void ObjectCache::remove(string& name)
     chained_cache->invalidate(iiter->second);
   }
 
-  remove_lru(name, iter->second.lru_iter);
-  cache_map.erase(iter);
+  remove_lru(shard, name, iter->second.lru_iter);
+  shard.cache_map.erase(iter);
 }
 
-void ObjectCache::touch_lru(string& name, ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter)
+void ObjectCache::touch_lru(Shard& shard, string& name, ObjectCacheEntry& entry,
+			    std::list<string>::iterator& lru_iter)
 {
-  while (lru_size > (size_t)cct->_conf->rgw_cache_lru_size) {
-    list<string>::iterator iter = lru.begin();
+  while (shard.lru_size > shard_lru_size) {
+    list<string>::iterator iter = shard.lru.begin();
     if ((*iter).compare(name) == 0) {
       /*
        * if the entry we're touching happens to be at the lru end, don't remove it,
@@ -223,67 +246,82 @@ void ObjectCache::touch_lru(string& name, ObjectCacheEntry& entry, std::list<str
        */
       break;
     }
-    map<string, ObjectCacheEntry>::iterator map_iter = cache_map.find(*iter);
+    map<string, ObjectCacheEntry>::iterator map_iter = shard.cache_map.find(*iter);
     ldout(cct, 10) << "removing entry: name=" << *iter << " from cache LRU" << dendl;
-    if (map_iter != cache_map.end())
-      cache_map.erase(map_iter);
-    lru.pop_front();
-    lru_size--;
+    if (map_iter != shard.cache_map.end())
+      shard.cache_map.erase(map_iter);
+    shard.lru.pop_front();
+    shard.lru_size--;
   }
 
-  if (lru_iter == lru.end()) {
-    lru.push_back(name);
-    lru_size++;
+  if (lru_iter == shard.lru.end()) {
+    shard.lru.push_back(name);
+    shard.lru_size++;
     lru_iter--;
     ldout(cct, 10) << "adding " << name << " to cache LRU end" << dendl;
   } else {
     ldout(cct, 10) << "moving " << name << " to cache LRU end" << dendl;
-    lru.erase(lru_iter);
-    lru.push_back(name);
-    lru_iter = lru.end();
+    shard.lru.erase(lru_iter);
+    shard.lru.push_back(name);
+    lru_iter = shard.lru.end();
     --lru_iter;
   }
 
-  lru_counter++;
-  entry.lru_promotion_ts = lru_counter;
+  shard.lru_counter++;
+  entry.lru_promotion_ts = shard.lru_counter;
 }
 
-void ObjectCache::remove_lru(string& name, std::list<string>::iterator& lru_iter)
+void ObjectCache::remove_lru(Shard& shard, string& name,
+			     std::list<string>::iterator& lru_iter)
 {
-  if (lru_iter == lru.end())
+  if (lru_iter == shard.lru.end())
     return;
 
-  lru.erase(lru_iter);
-  lru_size--;
-  lru_iter = lru.end();
+  shard.lru.erase(lru_iter);
+  shard.lru_size--;
+  lru_iter = shard.lru.end();
 }
 
 void ObjectCache::set_enabled(bool status)
 {
-  RWLock::WLocker l(lock);
+  for (int i = 0; i < num_shards; i++) {
+    shards[i].lock.get_write();
+  }
 
   enabled = status;
 
   if (!enabled) {
     do_invalidate_all();
   }
+
+  for (int i = num_shards - 1; i >= 0; i--) {
+    shards[i].lock.unlock();
+  }
 }
 
 void ObjectCache::invalidate_all()
 {
-  RWLock::WLocker l(lock);
+  for (int i = 0; i < num_shards; i++) {
+    shards[i].lock.get_write();
+  }
 
   do_invalidate_all();
+
+  for (int i = num_shards - 1; i >= 0; i--) {
+    shards[i].lock.unlock();
+  }
 }
 
 void ObjectCache::do_invalidate_all()
 {
-  cache_map.clear();
-  lru.clear();
+  for (int i = 0; i < num_shards; i++) {
+    Shard& shard = shards[i];
+    shard.cache_map.clear();
+    shard.lru.clear();
 
-  lru_size = 0;
-  lru_counter = 0;
-  lru_window = 0;
+    shard.lru_size = 0;
+    shard.lru_counter = 0;
+  }
 
   for (list<RGWChainedCache *>::iterator iter = chained_cache.begin(); iter != chained_cache.end(); ++iter) {
     (*iter)->invalidate_all();
@@ -291,7 +329,71 @@ void ObjectCache::do_invalidate_all()
 }
 
 void ObjectCache::chain_cache(RGWChainedCache *cache) {
-  RWLock::WLocker l(lock);
+  for (int i = 0; i < num_shards; i++) {
+    shards[i].lock.get_write();
+  }
   chained_cache.push_back(cache);
+  for (int i = num_shards - 1; i >= 0; i--) {
+    shards[i].lock.unlock();
+  }
 }
 
+
+bool RGWDataChunkCache::get(const string& key, bufferlist& bl)
+{
+  Shard& shard = get_shard(key);
+  Mutex::Locker l(shard.lock);
+
+  map<string, Entry>::iterator iter = shard.chunks.find(key);
+  if (iter == shard.chunks.end()) {
+    ldout(cct, 20) << "data chunk cache get: key=" << key << " : miss" << dendl;
+    return false;
+  }
+
+  Entry& entry = iter->second;
+  shard.lru.erase(entry.lru_iter);
+  shard.lru.push_front(key);
+  entry.lru_iter = shard.lru.begin();
+
+  bl = entry.data;
+  ldout(cct, 20) << "data chunk cache get: key=" << key << " : hit" << dendl;
+  return true;
+}
+
+void RGWDataChunkCache::put(const string& key, bufferlist& bl)
+{
+  uint64_t len = bl.length();
+  if (len > shard_max_size) {
+    return;
+  }
+
+  Shard& shard = get_shard(key);
+  Mutex::Locker l(shard.lock);
+
+  map<string, Entry>::iterator iter = shard.chunks.find(key);
+  if (iter != shard.chunks.end()) {
+    /* already cached; just promote it */
+    Entry& entry = iter->second;
+    shard.lru.erase(entry.lru_iter);
+    shard.lru.push_front(key);
+    entry.lru_iter = shard.lru.begin();
+    return;
+  }
+
+  while (shard.size + len > shard_max_size) {
+    string& victim = shard.lru.back();
+    map<string, Entry>::iterator viter = shard.chunks.find(victim);
+    assert(viter != shard.chunks.end());
+    ldout(cct, 20) << "data chunk cache evict: key=" << victim << dendl;
+    shard.size -= viter->second.data.length();
+    shard.chunks.erase(viter);
+    shard.lru.pop_back();
+  }
+
+  ldout(cct, 20) << "data chunk cache put: key=" << key << " len=" << len << dendl;
+  Entry& entry = shard.chunks[key];
+  entry.data = bl;
+  shard.lru.push_front(key);
+  entry.lru_iter = shard.lru.begin();
+  shard.size += len;
+}
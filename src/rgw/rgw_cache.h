@@ -7,9 +7,11 @@
 #include "rgw_rados.h"
 #include <string>
 #include <map>
+#include <memory>
 #include "include/types.h"
 #include "include/utime.h"
 #include "include/assert.h"
+#include "include/ceph_hash.h"
 #include "common/RWLock.h"
 
 enum {
@@ -135,30 +137,52 @@ struct ObjectCacheEntry {
 };
 
 class ObjectCache {
-  std::map<string, ObjectCacheEntry> cache_map;
-  std::list<string> lru;
-  unsigned long lru_size;
-  unsigned long lru_counter;
+  /* the cache is sharded by a hash of the entry name; each shard has its
+   * own lock and lru so that concurrent lookups of unrelated entries
+   * don't contend on a single lock */
+  struct Shard {
+    std::map<string, ObjectCacheEntry> cache_map;
+    std::list<string> lru;
+    unsigned long lru_size;
+    unsigned long lru_counter;
+    RWLock lock;
+
+    Shard() : lru_size(0), lru_counter(0), lock("ObjectCache::Shard") {}
+  };
+
+  std::unique_ptr<Shard[]> shards;
+  int num_shards;
+  unsigned long shard_lru_size;
   unsigned long lru_window;
-  RWLock lock;
   CephContext *cct;
 
   list<RGWChainedCache *> chained_cache;
 
   bool enabled;
 
-  void touch_lru(string& name, ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter);
-  void remove_lru(string& name, std::list<string>::iterator& lru_iter);
+  Shard& get_shard(const string& name) {
+    return shards[ceph_str_hash_linux(name.c_str(), name.size()) % num_shards];
+  }
+
+  void touch_lru(Shard& shard, string& name, ObjectCacheEntry& entry,
+                 std::list<string>::iterator& lru_iter);
+  void remove_lru(Shard& shard, string& name,
+                  std::list<string>::iterator& lru_iter);
 
+  /* callers must hold all shard locks for write */
   void do_invalidate_all();
 public:
-  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), lock("ObjectCache"), cct(NULL), enabled(false) { }
+  ObjectCache() : num_shards(0), shard_lru_size(0), lru_window(0), cct(NULL),
+                  enabled(false) { }
   int get(std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
   void put(std::string& name, ObjectCacheInfo& bl, rgw_cache_entry_info *cache_info);
   void remove(std::string& name);
   void set_ctx(CephContext *_cct) {
     cct = _cct;
-    lru_window = cct->_conf->rgw_cache_lru_size / 2;
+    num_shards = MAX(cct->_conf->rgw_cache_shards, 1);
+    shards.reset(new Shard[num_shards]);
+    shard_lru_size = MAX(cct->_conf->rgw_cache_lru_size / num_shards, 1);
+    lru_window = shard_lru_size / 2;
   }
   bool chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry);
 
@@ -168,6 +192,62 @@ public:
   void invalidate_all();
 };
 
+/*
+ * Gateway-local cache of immutable object data chunks, used to serve hot
+ * GETs from memory instead of re-reading rados. Entries are keyed by the
+ * raw rados oid plus read range; tail oids embed the object's write tag,
+ * so an overwrite produces different keys and stale chunks simply age out
+ * of the lru. That also means no invalidation traffic is needed, unlike
+ * the metadata cache above.
+ */
+class RGWDataChunkCache {
+  struct Entry {
+    bufferlist data;
+    std::list<string>::iterator lru_iter;
+  };
+
+  struct Shard {
+    std::map<string, Entry> chunks;
+    std::list<string> lru;
+    uint64_t size;
+    Mutex lock;
+
+    Shard() : size(0), lock("RGWDataChunkCache::Shard") {}
+  };
+
+  std::unique_ptr<Shard[]> shards;
+  int num_shards;
+  uint64_t shard_max_size;
+  CephContext *cct;
+
+  Shard& get_shard(const string& key) {
+    return shards[ceph_str_hash_linux(key.c_str(), key.size()) % num_shards];
+  }
+
+public:
+  RGWDataChunkCache() : num_shards(0), shard_max_size(0), cct(NULL) {}
+
+  void init(CephContext *_cct) {
+    cct = _cct;
+    num_shards = MAX(cct->_conf->rgw_cache_shards, 1);
+    shards.reset(new Shard[num_shards]);
+    shard_max_size = cct->_conf->rgw_obj_data_cache_size / num_shards;
+  }
+
+  bool enabled() {
+    return shard_max_size > 0;
+  }
+
+  static string chunk_key(const string& oid, off_t ofs, off_t len) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "+%lld+%lld", (long long)ofs, (long long)len);
+    return oid + buf;
+  }
+
+  bool get(const string& key, bufferlist& bl);
+  void put(const string& key, bufferlist& bl);
+};
+
 template <class T>
 class RGWCache  : public T
 {
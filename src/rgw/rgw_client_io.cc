@@ -69,6 +69,26 @@ int RGWStreamIO::write(const char *buf, int len)
   return 0;
 }
 
+int RGWStreamIO::write(bufferlist& bl, unsigned int ofs, unsigned int len)
+{
+  for (std::list<bufferptr>::const_iterator it = bl.buffers().begin();
+       it != bl.buffers().end() && len > 0; ++it) {
+    const bufferptr& bp = *it;
+    if (ofs >= bp.length()) {
+      ofs -= bp.length();
+      continue;
+    }
+    unsigned int l = MIN(len, bp.length() - ofs);
+    int ret = write(bp.c_str() + ofs, l);
+    if (ret < 0)
+      return ret;
+    ofs = 0;
+    len -= l;
+  }
+
+  return 0;
+}
+
 int RGWStreamIO::read(char *buf, int max, int *actual, bool hash /* = false */)
 {
   int ret = read_data(buf, max);
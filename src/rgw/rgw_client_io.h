@@ -56,6 +56,10 @@ public:
 
   int print(const char *format, ...);
   int write(const char *buf, int len);
+  /* write a range of a bufferlist segment by segment, without first
+   * rebuilding it into one contiguous buffer; this keeps GET payloads
+   * from being copied on their way from rados to the client socket */
+  int write(bufferlist& bl, unsigned int ofs, unsigned int len);
   virtual void flush() = 0;
   int read(char *buf, int max, int *actual, bool hash = false);
 
@@ -106,8 +106,6 @@ using ceph::crypto::MD5;
 
 #define RGW_BUCKETS_OBJ_SUFFIX ".buckets"
 
-#define RGW_MAX_PENDING_CHUNKS  16
-
 #define RGW_FORMAT_PLAIN        0
 #define RGW_FORMAT_XML          1
 #define RGW_FORMAT_JSON         2
@@ -1208,6 +1206,7 @@ struct rgw_obj_key {
     DECODE_FINISH(bl);
   }
   void dump(Formatter *f) const;
+  void decode_json(JSONObj *obj);
 };
 WRITE_CLASS_ENCODER(rgw_obj_key)
 
@@ -1801,11 +1800,13 @@ inline ostream& operator<<(ostream& out, const rgw_obj &o) {
 
 static inline void buf_to_hex(const unsigned char *buf, int len, char *str)
 {
+  static const char hex[] = "0123456789abcdef";
   int i;
-  str[0] = '\0';
   for (i = 0; i < len; i++) {
-    sprintf(&str[i*2], "%02x", (int)buf[i]);
+    str[i*2] = hex[buf[i] >> 4];
+    str[i*2+1] = hex[buf[i] & 0xf];
   }
+  str[len*2] = '\0';
 }
 
 static inline int hexdigit(char c)
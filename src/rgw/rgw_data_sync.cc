@@ -251,9 +251,13 @@ public:
       yield {
 	char buf[16];
 	snprintf(buf, sizeof(buf), "%d", shard_id);
+	char max_entries_buf[16];
+	snprintf(max_entries_buf, sizeof(max_entries_buf), "%d",
+	         (int)sync_env->cct->_conf->rgw_sync_log_fetch_entries);
         rgw_http_param_pair pairs[] = { { "type" , "data" },
 	                                { "id", buf },
 	                                { "marker", pmarker->c_str() },
+	                                { "max-entries", max_entries_buf },
 	                                { "extra-info", "true" },
 	                                { NULL, NULL } };
 
@@ -940,7 +944,6 @@ public:
   }
 };
 
-#define BUCKET_SHARD_SYNC_SPAWN_WINDOW 20
 #define DATA_SYNC_MAX_ERR_ENTRIES 10
 
 class RGWDataSyncShardCR : public RGWCoroutine {
@@ -1013,7 +1016,7 @@ public:
 						      shard_id(_shard_id),
 						      sync_marker(_marker),
                                                       marker_tracker(NULL), truncated(false), inc_lock("RGWDataSyncShardCR::inc_lock"),
-                                                      total_entries(0), spawn_window(BUCKET_SHARD_SYNC_SPAWN_WINDOW), reset_backoff(NULL),
+                                                      total_entries(0), spawn_window(_sync_env->cct->_conf->rgw_data_sync_spawn_window), reset_backoff(NULL),
                                                       lease_cr(nullptr), lease_stack(nullptr), error_repo(nullptr), max_error_entries(DATA_SYNC_MAX_ERR_ENTRIES),
                                                       retry_backoff_secs(RETRY_BACKOFF_SECS_DEFAULT) {
     set_description() << "data sync shard source_zone=" << sync_env->source_zone << " shard_id=" << shard_id;
@@ -1932,10 +1935,14 @@ public:
   int operate() {
     reenter(this) {
       yield {
+	char max_entries_buf[16];
+	snprintf(max_entries_buf, sizeof(max_entries_buf), "%d",
+	         (int)sync_env->cct->_conf->rgw_sync_log_fetch_entries);
         rgw_http_param_pair pairs[] = { { "bucket-instance", instance_key.c_str() },
 					{ "format" , "json" },
 					{ "marker" , marker.c_str() },
 					{ "type", "bucket-index" },
+					{ "max-entries", max_entries_buf },
 	                                { NULL, NULL } };
 
         call(new RGWReadRESTResourceCR<list<rgw_bi_log_entry> >(sync_env->cct, sync_env->conn, sync_env->http_manager, "/admin/log", pairs, result));
@@ -2184,8 +2191,6 @@ done:
   }
 };
 
-#define BUCKET_SYNC_SPAWN_WINDOW 20
-
 class RGWBucketShardFullSyncCR : public RGWCoroutine {
   RGWDataSyncEnv *sync_env;
   const rgw_bucket_shard& bs;
@@ -2216,7 +2221,7 @@ public:
                                                                             bs(bs),
                                                                             bucket_info(_bucket_info),
                                                                             full_marker(_full_marker), marker_tracker(NULL),
-                                                                            spawn_window(BUCKET_SYNC_SPAWN_WINDOW), entry(NULL),
+                                                                            spawn_window(_sync_env->cct->_conf->rgw_bucket_sync_spawn_window), entry(NULL),
                                                                             op(CLS_RGW_OP_ADD),
                                                                             total_entries(0), lease_cr(nullptr), lease_stack(nullptr) {
     status_oid = RGWBucketSyncStatusManager::status_oid(sync_env->source_zone, bs);
@@ -2361,7 +2366,7 @@ class RGWBucketShardIncrementalSyncCR : public RGWCoroutine {
   rgw_obj_key key;
   rgw_bi_log_entry *entry{nullptr};
   RGWBucketIncSyncShardMarkerTrack *marker_tracker{nullptr};
-  const int spawn_window{BUCKET_SYNC_SPAWN_WINDOW};
+  const int spawn_window;
   bool updated_status{false};
   RGWContinuousLeaseCR *lease_cr{nullptr};
   RGWCoroutinesStack *lease_stack{nullptr};
@@ -2384,6 +2389,7 @@ public:
                                   rgw_bucket_shard_inc_sync_marker& _inc_marker)
     : RGWCoroutine(_sync_env->cct), sync_env(_sync_env), bs(bs),
       bucket_info(_bucket_info), inc_marker(_inc_marker),
+      spawn_window(_sync_env->cct->_conf->rgw_bucket_sync_spawn_window),
       status_oid(RGWBucketSyncStatusManager::status_oid(sync_env->source_zone, bs)) {
     set_description() << "bucket shard incremental sync bucket="
         << bucket_shard_str{bs};
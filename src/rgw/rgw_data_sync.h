@@ -302,6 +302,11 @@ struct rgw_bucket_shard_full_sync_marker {
     encode_json("position", position, f);
     encode_json("count", count, f);
   }
+
+  void decode_json(JSONObj *obj) {
+    JSONDecoder::decode_json("position", position, obj);
+    JSONDecoder::decode_json("count", count, obj);
+  }
 };
 WRITE_CLASS_ENCODER(rgw_bucket_shard_full_sync_marker)
 
@@ -328,6 +333,10 @@ struct rgw_bucket_shard_inc_sync_marker {
     encode_json("position", position, f);
   }
 
+  void decode_json(JSONObj *obj) {
+    JSONDecoder::decode_json("position", position, obj);
+  }
+
   bool operator<(const rgw_bucket_shard_inc_sync_marker& m) const {
     return (position < m.position);
   }
@@ -386,6 +395,20 @@ struct rgw_bucket_shard_sync_info {
     encode_json("inc_marker", inc_marker, f);
   }
 
+  void decode_json(JSONObj *obj) {
+    std::string s;
+    JSONDecoder::decode_json("status", s, obj);
+    if (s == "full-sync") {
+      state = StateFullSync;
+    } else if (s == "incremental-sync") {
+      state = StateIncrementalSync;
+    } else {
+      state = StateInit;
+    }
+    JSONDecoder::decode_json("full_marker", full_marker, obj);
+    JSONDecoder::decode_json("inc_marker", inc_marker, obj);
+  }
+
   rgw_bucket_shard_sync_info() : state((int)StateInit) {}
 
 };
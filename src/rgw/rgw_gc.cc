@@ -21,6 +21,32 @@ static string gc_index_lock_name = "gc_process";
 
 #define HASH_PRIME 7877
 
+struct gc_removal_io {
+  AioCompletion *c;
+  string pool;
+  string oid;
+  string loc;
+};
+
+/* reap the oldest outstanding removal; returns < 0 if it failed in a way
+ * that should keep the chain's tag around for a retry */
+static int gc_wait_removal(std::list<gc_removal_io>& ios)
+{
+  gc_removal_io io = ios.front();
+  ios.pop_front();
+
+  io.c->wait_for_complete();
+  int ret = io.c->get_return_value();
+  io.c->release();
+
+  if (ret == -ENOENT)
+    ret = 0;
+  if (ret < 0) {
+    dout(0) << "failed to remove " << io.pool << ":" << io.oid << "@" << io.loc << dendl;
+  }
+  return ret;
+}
+
 void RGWGC::initialize(CephContext *_cct, RGWRados *_store) {
   cct = _cct;
   store = _store;
@@ -155,7 +181,11 @@ int RGWGC::process(int index, int max_secs)
 
   string marker;
   bool truncated;
-  IoCtx *ctx = new IoCtx;
+  std::map<string, IoCtx> pool_ctxs;
+  std::list<gc_removal_io> ios;
+  int max_aio = cct->_conf->rgw_gc_max_concurrent_io;
+  if (max_aio < 1)
+    max_aio = 1;
   do {
     int max = 100;
     std::list<cls_rgw_gc_obj_info> entries;
@@ -167,7 +197,6 @@ int RGWGC::process(int index, int max_secs)
     if (ret < 0)
       goto done;
 
-    string last_pool;
     std::list<cls_rgw_gc_obj_info>::iterator iter;
     for (iter = entries.begin(); iter != entries.end(); ++iter) {
       bool remove_tag;
@@ -183,15 +212,18 @@ int RGWGC::process(int index, int max_secs)
       for (liter = chain.objs.begin(); liter != chain.objs.end(); ++liter) {
         cls_rgw_obj& obj = *liter;
 
-        if (obj.pool != last_pool) {
-          delete ctx;
-          ctx = new IoCtx;
+        IoCtx *ctx;
+        std::map<string, IoCtx>::iterator citer = pool_ctxs.find(obj.pool);
+        if (citer != pool_ctxs.end()) {
+          ctx = &citer->second;
+        } else {
+          ctx = &pool_ctxs[obj.pool];
 	  ret = store->get_rados_handle()->ioctx_create(obj.pool.c_str(), *ctx);
 	  if (ret < 0) {
 	    dout(0) << "ERROR: failed to create ioctx pool=" << obj.pool << dendl;
+	    pool_ctxs.erase(obj.pool);
 	    continue;
 	  }
-          last_pool = obj.pool;
         }
 
         ctx->locator_set_key(obj.loc);
@@ -202,17 +234,37 @@ int RGWGC::process(int index, int max_secs)
 	dout(0) << "gc::process: removing " << obj.pool << ":" << key_obj.get_object() << dendl;
 	ObjectWriteOperation op;
 	cls_refcount_put(op, info.tag, true);
-        ret = ctx->operate(key_obj.get_object(), &op);
-	if (ret == -ENOENT)
-	  ret = 0;
+
+        gc_removal_io io;
+        io.pool = obj.pool;
+        io.oid = key_obj.get_object();
+        io.loc = obj.loc;
+        io.c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+        ret = ctx->aio_operate(io.oid, io.c, &op);
         if (ret < 0) {
+          io.c->release();
           remove_tag = false;
-          dout(0) << "failed to remove " << obj.pool << ":" << key_obj.get_object() << "@" << obj.loc << dendl;
+          dout(0) << "failed to remove " << io.pool << ":" << io.oid << "@" << io.loc << dendl;
+        } else {
+          ios.push_back(io);
+        }
+
+        while ((int)ios.size() >= max_aio) {
+          if (gc_wait_removal(ios) < 0)
+            remove_tag = false;
         }
 
         if (going_down()) // leave early, even if tag isn't removed, it's ok
           goto done;
       }
+
+      /* collect every removal of this chain before deciding whether its tag
+       * can go; a failure on one of them must keep the chain for a retry */
+      while (!ios.empty()) {
+        if (gc_wait_removal(ios) < 0)
+          remove_tag = false;
+      }
+
       if (remove_tag) {
         remove_tags.push_back(info.tag);
 #define MAX_REMOVE_CHUNK 16
@@ -225,10 +277,12 @@ int RGWGC::process(int index, int max_secs)
   } while (truncated);
 
 done:
+  while (!ios.empty()) {
+    gc_wait_removal(ios);
+  }
   if (!remove_tags.empty())
     RGWGC::remove(index, remove_tags);
   l.unlock(&store->gc_pool_ctx, obj_names[index]);
-  delete ctx;
   return 0;
 }
 
@@ -258,19 +312,27 @@ bool RGWGC::going_down()
 
 void RGWGC::start_processor()
 {
-  worker = new GCWorker(cct, this);
-  worker->create("rgw_gc");
+  int num_threads = cct->_conf->rgw_gc_processor_threads;
+  if (num_threads < 1)
+    num_threads = 1;
+  for (int i = 0; i < num_threads; i++) {
+    GCWorker *worker = new GCWorker(cct, this);
+    worker->create("rgw_gc");
+    workers.push_back(worker);
+  }
 }
 
 void RGWGC::stop_processor()
 {
   down_flag.set(1);
-  if (worker) {
-    worker->stop();
-    worker->join();
+  for (vector<GCWorker *>::iterator iter = workers.begin(); iter != workers.end(); ++iter) {
+    (*iter)->stop();
+  }
+  for (vector<GCWorker *>::iterator iter = workers.begin(); iter != workers.end(); ++iter) {
+    (*iter)->join();
+    delete *iter;
   }
-  delete worker;
-  worker = NULL;
+  workers.clear();
 }
 
 void *RGWGC::GCWorker::entry() {
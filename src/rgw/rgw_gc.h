@@ -36,9 +36,11 @@ class RGWGC {
     void stop();
   };
 
-  GCWorker *worker;
+  /* each worker competes for the per-shard cls locks, so several of them
+   * (and several radosgw instances) drain different shards in parallel */
+  vector<GCWorker *> workers;
 public:
-  RGWGC() : cct(NULL), store(NULL), max_objs(0), obj_names(NULL), worker(NULL) {}
+  RGWGC() : cct(NULL), store(NULL), max_objs(0), obj_names(NULL) {}
   ~RGWGC() {
     stop_processor();
     finalize();
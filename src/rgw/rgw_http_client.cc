@@ -18,6 +18,72 @@
 
 #define dout_subsys ceph_subsys_rgw
 
+/*
+ * pool of curl easy handles, reused across requests so that keepalive
+ * connections (and negotiated TLS sessions) to remote endpoints stay
+ * warm instead of being torn down with every request
+ */
+class RGWCurlHandles {
+  Mutex lock;
+  vector<CURL *> saved;
+
+public:
+  RGWCurlHandles() : lock("RGWCurlHandles::lock") {}
+
+  CURL *get_handle();
+  void release_handle(CURL *handle);
+  void flush();
+};
+
+static RGWCurlHandles curl_handles;
+
+CURL *RGWCurlHandles::get_handle()
+{
+  {
+    Mutex::Locker l(lock);
+    if (!saved.empty()) {
+      CURL *handle = saved.back();
+      saved.pop_back();
+      return handle;
+    }
+  }
+  return curl_easy_init();
+}
+
+void RGWCurlHandles::release_handle(CURL *handle)
+{
+  /* drop callbacks and per-request state, but keep the handle's connection
+   * cache intact */
+  curl_easy_reset(handle);
+
+  size_t max_saved = 0;
+  if (g_ceph_context) {
+    max_saved = g_ceph_context->_conf->rgw_curl_handle_pool_size;
+  }
+  {
+    Mutex::Locker l(lock);
+    if (saved.size() < max_saved) {
+      saved.push_back(handle);
+      return;
+    }
+  }
+  curl_easy_cleanup(handle);
+}
+
+void RGWCurlHandles::flush()
+{
+  Mutex::Locker l(lock);
+  for (vector<CURL *>::iterator iter = saved.begin(); iter != saved.end(); ++iter) {
+    curl_easy_cleanup(*iter);
+  }
+  saved.clear();
+}
+
+void rgw_release_all_curl_handles()
+{
+  curl_handles.flush();
+}
+
 struct rgw_http_req_data : public RefCountedObject {
   CURL *easy_handle;
   curl_slist *h;
@@ -50,7 +116,7 @@ struct rgw_http_req_data : public RefCountedObject {
     Mutex::Locker l(lock);
     ret = r;
     if (easy_handle)
-      curl_easy_cleanup(easy_handle);
+      curl_handles.release_handle(easy_handle);
 
     if (h)
       curl_slist_free_all(h);
@@ -240,7 +306,7 @@ int RGWHTTPClient::process(const char *method, const char *url)
   last_method = (method ? method : "");
   last_url = (url ? url : "");
 
-  curl_handle = curl_easy_init();
+  curl_handle = curl_handles.get_handle();
 
   dout(20) << "sending request to " << url << dendl;
 
@@ -269,6 +335,9 @@ int RGWHTTPClient::process(const char *method, const char *url)
     curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0L);
     dout(20) << "ssl verification is set to off" << dendl;
   }
+#if LIBCURL_VERSION_NUM >= 0x071900
+  curl_easy_setopt(curl_handle, CURLOPT_TCP_KEEPALIVE, 1L);
+#endif
 
   CURLcode status = curl_easy_perform(curl_handle);
   if (status) {
@@ -276,7 +345,7 @@ int RGWHTTPClient::process(const char *method, const char *url)
     ret = -EINVAL;
   }
   curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &http_status);
-  curl_easy_cleanup(curl_handle);
+  curl_handles.release_handle(curl_handle);
   curl_slist_free_all(h);
 
   return ret;
@@ -309,7 +378,7 @@ int RGWHTTPClient::init_request(const char *method, const char *url, rgw_http_re
 
   CURL *easy_handle;
 
-  easy_handle = curl_easy_init();
+  easy_handle = curl_handles.get_handle();
 
   req_data->easy_handle = easy_handle;
 
@@ -341,6 +410,9 @@ int RGWHTTPClient::init_request(const char *method, const char *url, rgw_http_re
     curl_easy_setopt(easy_handle, CURLOPT_INFILESIZE, (void *)send_len); 
   }
   curl_easy_setopt(easy_handle, CURLOPT_PRIVATE, (void *)req_data);
+#if LIBCURL_VERSION_NUM >= 0x071900
+  curl_easy_setopt(easy_handle, CURLOPT_TCP_KEEPALIVE, 1L);
+#endif
 
   return 0;
 }
@@ -520,6 +592,16 @@ RGWHTTPManager::RGWHTTPManager(CephContext *_cct, RGWCompletionManager *_cm) : c
                                                     reqs_thread(NULL)
 {
   multi_handle = (void *)curl_multi_init();
+#if LIBCURL_VERSION_NUM >= 0x071003
+  /* keep finished connections around for reuse instead of closing them */
+  curl_multi_setopt((CURLM *)multi_handle, CURLMOPT_MAXCONNECTS,
+                    (long)cct->_conf->rgw_curl_max_cached_connections);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x071000
+  if (cct->_conf->rgw_curl_pipelining) {
+    curl_multi_setopt((CURLM *)multi_handle, CURLMOPT_PIPELINING, 1L);
+  }
+#endif
   thread_pipe[0] = -1;
   thread_pipe[1] = -1;
 }
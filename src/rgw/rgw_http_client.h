@@ -15,6 +15,10 @@ using param_vec_t = vector<param_pair_t>;
 
 struct rgw_http_req_data;
 
+/* release all curl easy handles kept warm for connection reuse; call
+ * before curl_global_cleanup() */
+void rgw_release_all_curl_handles();
+
 class RGWHTTPClient
 {
   friend class RGWHTTPManager;
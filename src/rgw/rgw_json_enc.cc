@@ -727,6 +727,12 @@ void rgw_obj_key::dump(Formatter *f) const
   encode_json("instance", instance, f);
 }
 
+void rgw_obj_key::decode_json(JSONObj *obj)
+{
+  JSONDecoder::decode_json("name", name, obj);
+  JSONDecoder::decode_json("instance", instance, obj);
+}
+
 void RGWObjEnt::dump(Formatter *f) const
 {
   encode_json("name", key.name, f);
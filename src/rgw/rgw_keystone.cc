@@ -318,6 +318,15 @@ bool RGWKeystoneTokenCache::find(const string& token_id, KeystoneToken& token)
     if (perfcounter) perfcounter->inc(l_rgw_keystone_token_cache_hit);
     return false;
   }
+
+  if (entry.invalid) {
+    /* negative entry, let find_invalid() report it */
+    tokens_lru.push_front(token_id);
+    entry.lru_iter = tokens_lru.begin();
+    lock.Unlock();
+    if (perfcounter) perfcounter->inc(l_rgw_keystone_token_cache_miss);
+    return false;
+  }
   token = entry.token;
 
   tokens_lru.push_front(token_id);
@@ -329,6 +338,32 @@ bool RGWKeystoneTokenCache::find(const string& token_id, KeystoneToken& token)
   return true;
 }
 
+bool RGWKeystoneTokenCache::find_invalid(const string& token_id)
+{
+  Mutex::Locker l(lock);
+  map<string, token_entry>::iterator iter = tokens.find(token_id);
+  if (iter == tokens.end()) {
+    return false;
+  }
+
+  token_entry& entry = iter->second;
+  if (!entry.invalid) {
+    return false;
+  }
+
+  tokens_lru.erase(entry.lru_iter);
+
+  if (entry.token.expired()) {
+    tokens.erase(iter);
+    return false;
+  }
+
+  tokens_lru.push_front(token_id);
+  entry.lru_iter = tokens_lru.begin();
+
+  return true;
+}
+
 bool RGWKeystoneTokenCache::find_admin(KeystoneToken& token)
 {
   Mutex::Locker l(lock);
@@ -336,8 +371,9 @@ bool RGWKeystoneTokenCache::find_admin(KeystoneToken& token)
   return find(admin_token_id, token);
 }
 
-void RGWKeystoneTokenCache::add(const string& token_id,
-                                const KeystoneToken& token)
+void RGWKeystoneTokenCache::add_entry(const string& token_id,
+                                      const KeystoneToken& token,
+                                      bool invalid)
 {
   lock.Lock();
   map<string, token_entry>::iterator iter = tokens.find(token_id);
@@ -349,6 +385,7 @@ void RGWKeystoneTokenCache::add(const string& token_id,
   tokens_lru.push_front(token_id);
   token_entry& entry = tokens[token_id];
   entry.token = token;
+  entry.invalid = invalid;
   entry.lru_iter = tokens_lru.begin();
 
   while (tokens_lru.size() > max) {
@@ -362,6 +399,27 @@ void RGWKeystoneTokenCache::add(const string& token_id,
   lock.Unlock();
 }
 
+void RGWKeystoneTokenCache::add(const string& token_id,
+                                const KeystoneToken& token)
+{
+  add_entry(token_id, token, false);
+}
+
+void RGWKeystoneTokenCache::add_invalid(const string& token_id)
+{
+  const int ttl = cct->_conf->rgw_keystone_token_cache_negative_ttl;
+  if (ttl <= 0) {
+    return;
+  }
+
+  ldout(cct, 10) << "caching rejected token id=" << token_id
+                 << " for " << ttl << "s" << dendl;
+
+  KeystoneToken token;
+  token.token.expires = ceph_clock_now(cct).sec() + ttl;
+  add_entry(token_id, token, true);
+}
+
 void RGWKeystoneTokenCache::add_admin(const KeystoneToken& token)
 {
   Mutex::Locker l(lock);
@@ -383,6 +441,29 @@ void RGWKeystoneTokenCache::invalidate(const string& token_id)
   tokens.erase(iter);
 }
 
+bool RGWKeystoneTokenCache::expire_admin_token(const uint32_t window)
+{
+  Mutex::Locker l(lock);
+  if (admin_token_id.empty()) {
+    return false;
+  }
+
+  map<string, token_entry>::iterator iter = tokens.find(admin_token_id);
+  if (iter == tokens.end()) {
+    return false;
+  }
+
+  uint64_t now = ceph_clock_now(cct).sec();
+  if ((uint64_t)iter->second.token.get_expires() > now + window) {
+    return false;
+  }
+
+  ldout(cct, 10) << "cached admin token is about to expire, dropping it for refresh" << dendl;
+  tokens_lru.erase(iter->second.lru_iter);
+  tokens.erase(iter);
+  return true;
+}
+
 int RGWKeystoneTokenCache::RevokeThread::check_revoked()
 {
   std::string url;
@@ -500,6 +581,18 @@ void * RGWKeystoneTokenCache::RevokeThread::entry()
       break;
     }
 
+    /* refresh the cached admin token off the request path when it's about
+     * to expire, so that client requests don't pay for the round trip */
+    uint32_t interval = cct->_conf->rgw_keystone_revocation_interval;
+    if (cache->expire_admin_token(interval * 2)) {
+      std::string token;
+      r = KeystoneService::get_keystone_admin_token(cct, token);
+      if (r < 0) {
+        ldout(cct, 0) << "ERROR: keystone admin token refresh returned error r="
+                      << r << dendl;
+      }
+    }
+
     lock.Lock();
     cond.WaitInterval(cct, lock,
                       utime_t(cct->_conf->rgw_keystone_revocation_interval, 0));
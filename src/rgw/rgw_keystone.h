@@ -136,6 +136,7 @@ public:
 class RGWKeystoneTokenCache {
   struct token_entry {
     KeystoneToken token;
+    bool invalid;               /* negative entry for a rejected token */
     list<string>::iterator lru_iter;
   };
 
@@ -170,6 +171,10 @@ class RGWKeystoneTokenCache {
 
   const size_t max;
 
+  void add_entry(const std::string& token_id,
+                 const KeystoneToken& token,
+                 bool invalid);
+
   RGWKeystoneTokenCache()
     : revocator(g_ceph_context, this),
       cct(g_ceph_context),
@@ -192,10 +197,15 @@ public:
   static RGWKeystoneTokenCache& get_instance();
 
   bool find(const string& token_id, KeystoneToken& token);
+  bool find_invalid(const string& token_id);
   bool find_admin(KeystoneToken& token);
   void add(const string& token_id, const KeystoneToken& token);
+  void add_invalid(const string& token_id);
   void add_admin(const KeystoneToken& token);
   void invalidate(const string& token_id);
+  /* drop the cached admin token if it expires within the next window
+   * seconds; returns true if a refresh should be issued */
+  bool expire_admin_token(uint32_t window);
   bool going_down() const;
 };
 
@@ -151,6 +151,23 @@ int RGWLC::bucket_lc_prepare(int index)
   return 0;
 }
 
+static void drain_deleter_results(RGWParallelObjDeleter& deleter, CephContext *cct,
+                                  const string& bucket_name)
+{
+  rgw_obj_del_result res;
+  while (deleter.wait_result(&res)) {
+    if (res.ret == -ECANCELED) {
+      /* object was updated under us, skipped */
+      continue;
+    }
+    if (res.ret < 0) {
+      ldout(cct, 0) << "ERROR: failed to remove " << bucket_name << ":" << res.key.name << " ret=" << res.ret << dendl;
+    } else {
+      ldout(cct, 10) << "DELETED:" << bucket_name << ":" << res.key.name << dendl;
+    }
+  }
+}
+
 int RGWLC::bucket_lc_process(string& shard_id)
 {
   RGWLifecycleConfiguration  config(cct);
@@ -193,6 +210,10 @@ int RGWLC::bucket_lc_process(string& shard_id)
   if (aiter == bucket_attrs.end())
     return 0;
 
+  RGWParallelObjDeleter deleter(store, bucket_info, bucket_info.owner, ACLOwner(),
+                                bucket_info.versioning_status(),
+                                cct->_conf->rgw_lc_del_threads);
+
   bufferlist::iterator iter(&aiter->second);
   try {
       config.decode(iter);
@@ -252,23 +273,16 @@ int RGWLC::bucket_lc_process(string& shard_id)
           continue;
         }
         if (now - ceph::real_clock::to_time_t((*obj_iter).mtime) >= days*24*60*60) {
-          RGWObjectCtx rctx(store);
-          rgw_obj obj(bucket_info.bucket, (*obj_iter).key.name);
-          RGWObjState *state;
-          int ret = store->get_obj_state(&rctx, obj, &state, false);
-          if (ret < 0) {
-            return ret;
-          }
-          if (state->mtime != (*obj_iter).mtime) //Check mtime again to avoid delete a recently update object as much as possible
-            continue;
-          ret = rgw_remove_object(store, bucket_info, bucket_info.bucket, (*obj_iter).key);
-          if (ret < 0) {
-            ldout(cct, 0) << "ERROR: rgw_remove_object " << dendl;
-          } else {
-            ldout(cct, 10) << "DELETED:" << bucket_name << ":" << (*obj_iter).key.name <<dendl;
+          rgw_obj_key key = (*obj_iter).key;
+          if (key.instance.empty()) {
+            key.instance = "null";
           }
+          /* the workers re-check the mtime to avoid deleting a recently
+           * updated object as much as possible */
+          deleter.submit(key, (*obj_iter).mtime);
         }
       }
+      drain_deleter_results(deleter, cct, bucket_name);
     } while (is_truncated);
   } else {
     for(map<string, int>::iterator prefix_iter = prefix_map.begin(); prefix_iter != prefix_map.end();  prefix_iter++) {
@@ -296,23 +310,14 @@ int RGWLC::bucket_lc_process(string& shard_id)
 
         for (obj_iter = objs.begin(); obj_iter != objs.end(); obj_iter++) {
           if (now - ceph::real_clock::to_time_t((*obj_iter).mtime) >= days*24*60*60) {
-            RGWObjectCtx rctx(store);
-            rgw_obj obj(bucket_info.bucket, (*obj_iter).key.name);
-            RGWObjState *state;
-            int ret = store->get_obj_state(&rctx, obj, &state, false);
-            if (ret < 0) {
-              return ret;
-            }
-            if (state->mtime != (*obj_iter).mtime)//Check mtime again to avoid delete a recently update object as much as possible
-              continue;
-            ret = rgw_remove_object(store, bucket_info, bucket_info.bucket, (*obj_iter).key);
-            if (ret < 0) {
-              ldout(cct, 0) << "ERROR: rgw_remove_object " << dendl;
-            } else {
-              ldout(cct, 10) << "DELETED:" << bucket_name << ":" << (*obj_iter).key.name << dendl;
+            rgw_obj_key key = (*obj_iter).key;
+            if (key.instance.empty()) {
+              key.instance = "null";
             }
+            deleter.submit(key, (*obj_iter).mtime);
           }
         }
+        drain_deleter_results(deleter, cct, bucket_name);
       } while (is_truncated);
     }
   }
@@ -4832,7 +4832,6 @@ void RGWDeleteMultiObj::execute()
   vector<rgw_obj_key>::iterator iter;
   RGWMultiDelXMLParser parser;
   int num_processed = 0;
-  RGWObjectCtx *obj_ctx = static_cast<RGWObjectCtx *>(s->obj_ctx);
 
   op_ret = get_params();
   if (op_ret < 0) {
@@ -4868,27 +4867,26 @@ void RGWDeleteMultiObj::execute()
     goto done;
   }
 
-  for (iter = multi_delete->objects.begin();
-        iter != multi_delete->objects.end() && num_processed < max_to_delete;
-        ++iter, num_processed++) {
-    rgw_obj obj(bucket, *iter);
-
-    obj_ctx->set_atomic(obj);
-
-    RGWRados::Object del_target(store, s->bucket_info, *obj_ctx, obj);
-    RGWRados::Object::Delete del_op(&del_target);
-
-    del_op.params.bucket_owner = s->bucket_owner.get_id();
-    del_op.params.versioning_status = s->bucket_info.versioning_status();
-    del_op.params.obj_owner = s->owner;
+  {
+    int num_threads = s->cct->_conf->rgw_multi_obj_del_threads;
+    if (num_threads > (int)multi_delete->objects.size()) {
+      num_threads = multi_delete->objects.size();
+    }
+    RGWParallelObjDeleter deleter(store, s->bucket_info, s->bucket_owner.get_id(),
+                                  s->owner, s->bucket_info.versioning_status(),
+                                  num_threads);
 
-    op_ret = del_op.delete_obj();
-    if (op_ret == -ENOENT) {
-      op_ret = 0;
+    for (iter = multi_delete->objects.begin();
+          iter != multi_delete->objects.end() && num_processed < max_to_delete;
+          ++iter, num_processed++) {
+      deleter.submit(*iter);
     }
 
-    send_partial_response(*iter, del_op.result.delete_marker,
-			  del_op.result.version_id, op_ret);
+    /* stream results back as the deletions complete */
+    rgw_obj_del_result res;
+    while (deleter.wait_result(&res)) {
+      send_partial_response(res.key, res.delete_marker, res.version_id, res.ret);
+    }
   }
 
   /*  set the return code to zero, errors at this point will be
@@ -1460,11 +1460,13 @@ static inline int put_data_and_throttle(RGWPutObjProcessor *processor,
     void *handle;
     rgw_obj obj;
 
+    uint64_t size = data.length();
+
     int ret = processor->handle_data(data, ofs, hash, &handle, &obj, &again);
     if (ret < 0)
       return ret;
 
-    ret = processor->throttle_data(handle, obj, need_to_wait);
+    ret = processor->throttle_data(handle, obj, size, need_to_wait);
     if (ret < 0)
       return ret;
 
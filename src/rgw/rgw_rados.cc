@@ -61,6 +61,7 @@ using namespace librados;
 
 #include "rgw_gc.h"
 #include "rgw_lc.h"
+#include "rgw_reshard.h"
 
 #include "rgw_object_expirer_core.h"
 #include "rgw_sync.h"
@@ -2234,11 +2235,21 @@ int RGWPutObjProcessor_Aio::handle_obj_data(rgw_obj& obj, bufferlist& bl, off_t
   return store->aio_put_obj_data(NULL, obj, bl, ((ofs != 0) ? ofs : -1), exclusive, phandle);
 }
 
+int RGWPutObjProcessor_Aio::prepare(RGWRados *store, string *oid_rand)
+{
+  RGWPutObjProcessor::prepare(store, oid_rand);
+
+  window_size = store->ctx()->_conf->rgw_put_obj_min_window_size;
+
+  return 0;
+}
+
 struct put_obj_aio_info RGWPutObjProcessor_Aio::pop_pending()
 {
   struct put_obj_aio_info info;
   info = pending.front();
   pending.pop_front();
+  pending_size -= info.size;
   return info;
 }
 
@@ -2277,7 +2288,7 @@ int RGWPutObjProcessor_Aio::drain_pending()
   return ret;
 }
 
-int RGWPutObjProcessor_Aio::throttle_data(void *handle, const rgw_obj& obj, bool need_to_wait)
+int RGWPutObjProcessor_Aio::throttle_data(void *handle, const rgw_obj& obj, uint64_t size, bool need_to_wait)
 {
   bool _wait = need_to_wait;
 
@@ -2285,9 +2296,12 @@ int RGWPutObjProcessor_Aio::throttle_data(void *handle, const rgw_obj& obj, bool
     struct put_obj_aio_info info;
     info.handle = handle;
     info.obj = obj;
+    info.size = size;
+    pending_size += size;
     pending.push_back(info);
   }
-  size_t orig_size = pending.size();
+
+  uint64_t orig_size = pending_size;
 
   /* first drain complete IOs */
   while (pending_has_completed()) {
@@ -2299,12 +2313,16 @@ int RGWPutObjProcessor_Aio::throttle_data(void *handle, const rgw_obj& obj, bool
   }
 
   /* resize window in case messages are draining too fast */
-  if (orig_size - pending.size() >= max_chunks) {
-    max_chunks++;
+  if (orig_size - pending_size >= window_size) {
+    window_size += store->ctx()->_conf->rgw_max_chunk_size;
+    uint64_t max_window_size = store->ctx()->_conf->rgw_put_obj_max_window_size;
+    if (window_size > max_window_size) {
+      window_size = max_window_size;
+    }
   }
 
   /* now throttle. Note that need_to_wait should only affect the first IO operation */
-  if (pending.size() > max_chunks || _wait) {
+  if (pending_size > window_size || _wait) {
     int r = wait_pending_front();
     if (r < 0)
       return r;
@@ -2326,6 +2344,79 @@ int RGWPutObjProcessor_Atomic::write_data(bufferlist& bl, off_t ofs, void **phan
   return RGWPutObjProcessor_Aio::handle_obj_data(cur_obj, bl, ofs - cur_part_ofs, ofs, phandle, exclusive);
 }
 
+RGWPutObjProcessor_Atomic::~RGWPutObjProcessor_Atomic()
+{
+  if (digest_worker) {
+    digest_lock.Lock();
+    digest_stopping = true;
+    digest_cond.Signal();
+    digest_lock.Unlock();
+    digest_worker->join();
+    delete digest_worker;
+  }
+}
+
+void RGWPutObjProcessor_Atomic::digest_entry()
+{
+  digest_lock.Lock();
+  while (true) {
+    while (digest_queue.empty() && !digest_stopping) {
+      digest_cond.Wait(digest_lock);
+    }
+    if (digest_queue.empty()) {
+      break;
+    }
+    bufferlist bl;
+    bl.claim(digest_queue.front());
+    digest_queue.pop_front();
+    digest_inflight = true;
+    digest_lock.Unlock();
+
+    for (std::list<bufferptr>::const_iterator it = bl.buffers().begin();
+         it != bl.buffers().end(); ++it) {
+      if (it->length() > 0) {
+        digest_hash->Update((const byte *)it->c_str(), it->length());
+      }
+    }
+
+    digest_lock.Lock();
+    digest_inflight = false;
+    digest_drain_cond.Signal();
+  }
+  digest_lock.Unlock();
+}
+
+void RGWPutObjProcessor_Atomic::digest_update(MD5 *hash, bufferlist& bl)
+{
+  if (!digest_worker && !store->ctx()->_conf->rgw_put_obj_digest_thread) {
+    for (std::list<bufferptr>::const_iterator it = bl.buffers().begin();
+         it != bl.buffers().end(); ++it) {
+      if (it->length() > 0) {
+        hash->Update((const byte *)it->c_str(), it->length());
+      }
+    }
+    return;
+  }
+
+  Mutex::Locker l(digest_lock);
+  if (!digest_worker) {
+    digest_hash = hash;
+    digest_worker = new DigestWorker(this);
+    digest_worker->create("rgw_obj_md5");
+  }
+  assert(hash == digest_hash);
+  digest_queue.push_back(bl); /* shallow copy, the caller is free to clear bl */
+  digest_cond.Signal();
+}
+
+void RGWPutObjProcessor_Atomic::digest_drain()
+{
+  Mutex::Locker l(digest_lock);
+  while (!digest_queue.empty() || digest_inflight) {
+    digest_drain_cond.Wait(digest_lock);
+  }
+}
+
 int RGWPutObjProcessor_Atomic::handle_data(bufferlist& bl, off_t ofs, MD5 *hash, void **phandle, rgw_obj *pobj, bool *again)
 {
   *again = false;
@@ -2361,7 +2452,7 @@ int RGWPutObjProcessor_Atomic::handle_data(bufferlist& bl, off_t ofs, MD5 *hash,
     first_chunk.claim(bl);
     obj_len = (uint64_t)first_chunk.length();
     if (hash) {
-      hash->Update((const byte *)first_chunk.c_str(), obj_len);
+      digest_update(hash, first_chunk);
     }
     int r = prepare_next_part(obj_len);
     if (r < 0) {
@@ -2378,7 +2469,7 @@ int RGWPutObjProcessor_Atomic::handle_data(bufferlist& bl, off_t ofs, MD5 *hash,
   int ret = write_data(bl, write_ofs, phandle, pobj, exclusive);
   if (ret >= 0) { /* we might return, need to clear bl as it was already sent */
     if (hash) {
-      hash->Update((const byte *)bl.c_str(), bl.length());
+      digest_update(hash, bl);
     }
     bl.clear();
   }
@@ -2387,13 +2478,22 @@ int RGWPutObjProcessor_Atomic::handle_data(bufferlist& bl, off_t ofs, MD5 *hash,
 
 void RGWPutObjProcessor_Atomic::complete_hash(MD5 *hash)
 {
-  hash->Update((const byte *)pending_data_bl.c_str(), pending_data_bl.length());
+  if (!digest_worker) {
+    /* nothing went through the digest thread (small object, or offload
+     * disabled), hash whatever is pending inline */
+    hash->Update((const byte *)pending_data_bl.c_str(), pending_data_bl.length());
+    return;
+  }
+  if (pending_data_bl.length() > 0) {
+    digest_update(hash, pending_data_bl);
+  }
+  digest_drain();
 }
 
 
 int RGWPutObjProcessor_Atomic::prepare_init(RGWRados *store, string *oid_rand)
 {
-  RGWPutObjProcessor::prepare(store, oid_rand);
+  RGWPutObjProcessor_Aio::prepare(store, oid_rand);
 
   int r = store->get_max_chunk_size(bucket, &max_chunk_size);
   if (r < 0) {
@@ -2476,7 +2576,7 @@ int RGWPutObjProcessor_Atomic::complete_writing_data()
       return r;
     }
     data_ofs += bl.length();
-    r = throttle_data(handle, obj, false);
+    r = throttle_data(handle, obj, bl.length(), false);
     if (r < 0) {
       ldout(store->ctx(), 0) << "ERROR: throttle_data() returned " << r << dendl;
       return r;
@@ -3032,6 +3132,133 @@ public:
   }
 };
 
+/*
+ * Background bucket index log trimmer. Walks the bucket instances, asks
+ * every peer zone for its bucket sync status through the admin log api,
+ * and trims the bilog entries that all peers have already processed, so
+ * that index shard omaps stay bounded without periodic radosgw-admin
+ * invocations.
+ */
+class RGWBILogTrimThread : public RGWRadosThread {
+  uint64_t interval_msec() {
+    return cct->_conf->rgw_bilog_trim_interval * 1000;
+  }
+
+  int trim_bucket(const string& bucket_instance);
+public:
+  explicit RGWBILogTrimThread(RGWRados *_store) : RGWRadosThread(_store) {}
+
+  int process();
+};
+
+int RGWBILogTrimThread::process()
+{
+  void *handle;
+  list<string> keys;
+  bool truncated;
+
+  string section = "bucket.instance";
+  int ret = store->meta_mgr->list_keys_init(section, &handle);
+  if (ret < 0) {
+    ldout(cct, 0) << "ERROR: bilog trim failed to list bucket instances: "
+                  << cpp_strerror(-ret) << dendl;
+    return ret;
+  }
+
+  do {
+    keys.clear();
+#define BILOG_TRIM_MAX_KEYS 1000
+    ret = store->meta_mgr->list_keys_next(handle, BILOG_TRIM_MAX_KEYS, keys, &truncated);
+    if (ret < 0) {
+      break;
+    }
+    for (list<string>::iterator iter = keys.begin();
+         iter != keys.end() && !going_down(); ++iter) {
+      int r = trim_bucket(*iter);
+      if (r < 0 && r != -ENOENT) {
+        ldout(cct, 10) << "failed to trim bilog for bucket instance " << *iter
+                       << ": " << cpp_strerror(-r) << dendl;
+      }
+    }
+  } while (truncated && !going_down());
+
+  store->meta_mgr->list_keys_complete(handle);
+  return ret;
+}
+
+int RGWBILogTrimThread::trim_bucket(const string& bucket_instance)
+{
+  RGWObjectCtx obj_ctx(store);
+  RGWBucketInfo bucket_info;
+  int ret = store->get_bucket_instance_info(obj_ctx, bucket_instance, bucket_info, NULL, NULL);
+  if (ret < 0) {
+    return ret;
+  }
+
+  const string& zone_id = store->get_zone_params().get_id();
+
+  int num_shards = (bucket_info.num_shards ? bucket_info.num_shards : 1);
+
+  /* lowest position each shard has been synced to, across all peers */
+  vector<string> min_markers(num_shards);
+
+  map<string, RGWRESTConn *>::iterator ziter;
+  for (ziter = store->zone_conn_map.begin(); ziter != store->zone_conn_map.end(); ++ziter) {
+    map<int, rgw_bucket_shard_sync_info> status;
+    rgw_http_param_pair pairs[] = { { "type", "bucket-index" },
+                                    { "sync-status", NULL },
+                                    { "bucket-instance", bucket_instance.c_str() },
+                                    { "source-zone", zone_id.c_str() },
+                                    { NULL, NULL } };
+
+    ret = ziter->second->get_json_resource("/admin/log/", pairs, status);
+    if (ret < 0) {
+      ldout(cct, 10) << "failed to fetch bucket sync status for " << bucket_instance
+                     << " from zone " << ziter->first << ": " << cpp_strerror(-ret) << dendl;
+      return ret;
+    }
+
+    for (int i = 0; i < num_shards; i++) {
+      map<int, rgw_bucket_shard_sync_info>::iterator siter = status.find(i);
+      if (siter == status.end() ||
+          siter->second.state != rgw_bucket_shard_sync_info::StateIncrementalSync ||
+          siter->second.inc_marker.position.empty()) {
+        /* this peer hasn't caught up on this shard yet, don't trim */
+        return 0;
+      }
+      const string& pos = siter->second.inc_marker.position;
+      if (min_markers[i].empty() || pos < min_markers[i]) {
+        min_markers[i] = pos;
+      }
+    }
+  }
+
+  if (min_markers.empty() || min_markers[0].empty()) {
+    return 0;
+  }
+
+  string start_marker; /* trim from the beginning */
+  string end_marker;
+  if (bucket_info.num_shards > 0) {
+    BucketIndexShardsManager markers_mgr;
+    for (int i = 0; i < num_shards; i++) {
+      markers_mgr.add(i, min_markers[i]);
+    }
+    markers_mgr.to_string(&end_marker);
+  } else {
+    end_marker = min_markers[0];
+  }
+
+  ldout(cct, 20) << "trimming bilog of bucket instance " << bucket_instance
+                 << " to " << end_marker << dendl;
+
+  ret = store->trim_bi_log_entries(bucket_info.bucket, -1, start_marker, end_marker);
+  if (ret == -ENODATA || ret == -ENOENT) {
+    ret = 0;
+  }
+  return ret;
+}
+
 void RGWRados::wakeup_meta_sync_shards(set<int>& shard_ids)
 {
   Mutex::Locker l(meta_sync_thread_lock);
@@ -3164,6 +3391,11 @@ void RGWRados::finalize()
     data_notifier->stop();
     delete data_notifier;
   }
+  if (bilog_trim_thread) {
+    bilog_trim_thread->stop();
+    delete bilog_trim_thread;
+    bilog_trim_thread = NULL;
+  }
   delete meta_mgr;
   delete data_log;
   if (async_rados) {
@@ -3182,6 +3414,15 @@ void RGWRados::finalize()
   delete lc;
   lc = NULL;
 
+  if (reshard) {
+    reshard->stop_processor();
+  }
+  delete reshard;
+  reshard = NULL;
+
+  delete data_cache;
+  data_cache = NULL;
+
   delete obj_expirer;
   obj_expirer = NULL;
 
@@ -3828,12 +4069,31 @@ int RGWRados::init_complete()
   data_notifier = new RGWDataNotifier(this);
   data_notifier->start();
 
+  if (!zone_conn_map.empty() && cct->_conf->rgw_bilog_trim_interval > 0) {
+    bilog_trim_thread = new RGWBILogTrimThread(this);
+    bilog_trim_thread->start();
+  }
+
   lc = new RGWLC();
   lc->initialize(cct, this);
-  
+
   if (use_lc_thread)
     lc->start_processor();
-  
+
+  if (cct->_conf->rgw_obj_data_cache_size > 0) {
+    data_cache = new RGWDataChunkCache();
+    data_cache->init(cct);
+  }
+
+  reshard = new RGWReshard();
+  reshard->initialize(cct, this);
+
+  /* the reshard worker only makes sense where the other maintenance
+   * threads run, i.e. in radosgw itself */
+  if (use_gc_thread && cct->_conf->rgw_dynamic_resharding)
+    reshard->start_processor();
+
+
   quota_handler = RGWQuotaHandler::generate_handler(this, quota_threads);
 
   bucket_index_max_shards = (cct->_conf->rgw_override_bucket_index_max_shards ? cct->_conf->rgw_override_bucket_index_max_shards :
@@ -6178,11 +6438,38 @@ int RGWRados::Object::Write::write_meta(uint64_t size,
   }
 
 
-  r = index_op.prepare(CLS_RGW_OP_ADD);
+  bool overlap_prepare = store->ctx()->_conf->rgw_bucket_index_overlap_prepare;
+
+  if (overlap_prepare) {
+    /* let the index prepare ride alongside the head object write instead of
+     * serializing in front of it; the pending entry only needs to be in
+     * place by the time we ack the op */
+    r = index_op.prepare_start(CLS_RGW_OP_ADD);
+  } else {
+    r = index_op.prepare(CLS_RGW_OP_ADD);
+  }
   if (r < 0)
     return r;
 
   r = ref.ioctx.operate(ref.oid, &op);
+
+  if (overlap_prepare) {
+    int pr = index_op.prepare_wait();
+    if (pr < 0) {
+      if (r >= 0) {
+        /* the head object was written but the index shard never got its
+         * pending entry; retry the prepare so that the complete below can
+         * bring the index in line with what's now on disk */
+        pr = index_op.prepare(CLS_RGW_OP_ADD);
+      }
+      if (pr < 0) {
+        ldout(store->ctx(), 0) << "ERROR: index prepare failed obj=" << obj << " r=" << pr
+                               << " (index entry may be stale until the bucket is checked)" << dendl;
+        r = pr;
+      }
+    }
+  }
+
   if (r < 0) { /* we can expect to get -ECANCELED if object was replaced under,
                 or -ENOENT if was removed, or -EEXIST if it did not exist
                 before and now it does */
@@ -6466,6 +6753,7 @@ public:
     do {
       void *handle;
       rgw_obj obj;
+      uint64_t size = bl.length();
       int ret = processor->handle_data(bl, ofs, NULL, &handle, &obj, &again);
       if (ret < 0)
         return ret;
@@ -6477,7 +6765,7 @@ public:
         ret = opstate->renew_state();
         if (ret < 0) {
           ldout(processor->ctx(), 0) << "ERROR: RGWRadosPutObj::handle_data(): failed to renew op state ret=" << ret << dendl;
-          int r = processor->throttle_data(handle, obj, false);
+          int r = processor->throttle_data(handle, obj, size, false);
           if (r < 0) {
             ldout(processor->ctx(), 0) << "ERROR: RGWRadosPutObj::handle_data(): processor->throttle_data() returned " << r << dendl;
           }
@@ -6488,7 +6776,7 @@ public:
         need_opstate = false;
       }
 
-      ret = processor->throttle_data(handle, obj, false);
+      ret = processor->throttle_data(handle, obj, size, false);
       if (ret < 0)
         return ret;
     } while (again);
@@ -7241,11 +7529,12 @@ int RGWRados::copy_obj_data(RGWObjectCtx& obj_ctx,
       void *handle;
       rgw_obj obj;
 
+      uint64_t size = bl.length();
       ret = processor.handle_data(bl, ofs, NULL, &handle, &obj, &again);
       if (ret < 0) {
         return ret;
       }
-      ret = processor.throttle_data(handle, obj, false);
+      ret = processor.throttle_data(handle, obj, size, false);
       if (ret < 0)
         return ret;
     } while (again);
@@ -8838,7 +9127,87 @@ int RGWRados::Bucket::UpdateIndex::prepare(RGWModifyOp op)
     }
   }
 
-  return store->cls_obj_prepare_op(*bs, op, optag, obj, bilog_flags);
+  ret = store->cls_obj_prepare_op(*bs, op, optag, obj, bilog_flags);
+  if (ret == -CLS_RGW_ERR_BUSY_RESHARDING) {
+    ret = handle_busy_resharding(&bs);
+    if (ret < 0) {
+      return ret;
+    }
+    ret = store->cls_obj_prepare_op(*bs, op, optag, obj, bilog_flags);
+  }
+  return ret;
+}
+
+/* the shard is fenced for a reshard in flight; wait for the new index to
+ * be linked, then point bs at it so the caller can retry */
+int RGWRados::Bucket::UpdateIndex::handle_busy_resharding(BucketShard **pbs)
+{
+  RGWRados *store = target->get_store();
+
+  int ret = store->block_while_resharding(target->get_bucket_info());
+  if (ret < 0) {
+    ldout(store->ctx(), 0) << "ERROR: bucket shard is blocked on an unfinished reshard: ret=" << ret << dendl;
+    return ret;
+  }
+
+  bs_initialized = false;
+  return get_bucket_shard(pbs);
+}
+
+int RGWRados::Bucket::UpdateIndex::prepare_start(RGWModifyOp op)
+{
+  if (blind) {
+    return 0;
+  }
+  RGWRados *store = target->get_store();
+  BucketShard *bs;
+  int ret = get_bucket_shard(&bs);
+  if (ret < 0) {
+    ldout(store->ctx(), 5) << "failed to get BucketShard object: ret=" << ret << dendl;
+    return ret;
+  }
+
+  if (obj_state && obj_state->write_tag.length()) {
+    optag = string(obj_state->write_tag.c_str(), obj_state->write_tag.length());
+  } else {
+    if (optag.empty()) {
+      append_rand_alpha(store->ctx(), optag, optag, 32);
+    }
+  }
+
+  assert(!prepare_c);
+  prepare_op = op;
+  prepare_c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+  ret = store->cls_obj_prepare_op(*bs, op, optag, obj, bilog_flags, prepare_c);
+  if (ret < 0) {
+    prepare_c->release();
+    prepare_c = NULL;
+  }
+  return ret;
+}
+
+int RGWRados::Bucket::UpdateIndex::prepare_wait()
+{
+  if (blind) {
+    return 0;
+  }
+  assert(prepare_c);
+  prepare_c->wait_for_complete();
+  int ret = prepare_c->get_return_value();
+  prepare_c->release();
+  prepare_c = NULL;
+
+  if (ret == -CLS_RGW_ERR_BUSY_RESHARDING) {
+    RGWRados *store = target->get_store();
+    BucketShard *bs;
+    ret = handle_busy_resharding(&bs);
+    if (ret < 0) {
+      return ret;
+    }
+    /* we already collected the async op; retry synchronously */
+    ret = store->cls_obj_prepare_op(*bs, prepare_op, optag, obj, bilog_flags);
+  }
+  return ret;
 }
 
 int RGWRados::Bucket::UpdateIndex::complete(int64_t poolid, uint64_t epoch, uint64_t size,
@@ -8874,6 +9243,8 @@ int RGWRados::Bucket::UpdateIndex::complete(int64_t poolid, uint64_t epoch, uint
 
   ret = store->cls_obj_complete_add(*bs, optag, poolid, epoch, ent, category, remove_objs, bilog_flags);
 
+  store->check_bucket_shards(target->get_bucket_info(), *bs);
+
   int r = store->data_log->add_entry(bs->bucket, bs->shard_id);
   if (r < 0) {
     lderr(store->ctx()) << "ERROR: failed writing data log" << dendl;
@@ -9136,6 +9507,7 @@ struct get_obj_aio_data {
   struct get_obj_data *op_data;
   off_t ofs;
   off_t len;
+  string cache_key; /* data chunk cache key, empty if the chunk isn't cacheable */
 };
 
 struct get_obj_io {
@@ -9210,7 +9582,7 @@ struct get_obj_data : public RefCountedObject {
     return r;
   }
 
-  void add_io(off_t ofs, off_t len, bufferlist **pbl, AioCompletion **pc) {
+  void add_io(off_t ofs, off_t len, const string& cache_key, bufferlist **pbl, AioCompletion **pc) {
     Mutex::Locker l(lock);
 
     get_obj_io& io = io_map[ofs];
@@ -9220,6 +9592,7 @@ struct get_obj_data : public RefCountedObject {
     aio.ofs = ofs;
     aio.len = len;
     aio.op_data = this;
+    aio.cache_key = cache_key;
 
     aio_data.push_back(aio);
 
@@ -9350,6 +9723,16 @@ void RGWRados::get_obj_aio_completion_cb(completion_t c, void *arg)
     goto done;
   }
 
+  if (data_cache && !aio_data->cache_key.empty() && r == len) {
+    /* only full chunks are cached, so that the key's range always matches
+     * the buffer it maps to */
+    Mutex::Locker l(d->lock);
+    map<off_t, get_obj_io>::iterator miter = d->io_map.find(ofs);
+    if (miter != d->io_map.end()) {
+      data_cache->put(aio_data->cache_key, miter->second.bl);
+    }
+  }
+
   d->data_lock.Lock();
 
   r = d->get_complete_ios(ofs, bl_list);
@@ -9443,6 +9826,39 @@ int RGWRados::get_obj_iterate_cb(RGWObjectCtx *ctx, RGWObjState *astate,
 
   get_obj_bucket_and_oid_loc(obj, bucket, oid, key);
 
+  string cache_key;
+  if (data_cache && !is_head_obj) {
+    /* tail objects are written once and never modified in place, so their
+     * chunks can be cached without any invalidation */
+    cache_key = RGWDataChunkCache::chunk_key(oid, read_ofs, len);
+
+    d->lock.Lock();
+    bool no_pending_io = d->completion_map.empty();
+    d->lock.Unlock();
+
+    /* only serve from the cache when nothing is in flight, so that cached
+     * chunks can be handed to the client in order without waiting on rados;
+     * a fully cached (hot) object takes this path for every chunk */
+    bufferlist cache_bl;
+    if (no_pending_io && data_cache->get(cache_key, cache_bl)) {
+      r = flush_read_list(d);
+      if (r < 0)
+        return r;
+
+      d->data_lock.Lock();
+      r = d->client_cb->handle_data(cache_bl, 0, cache_bl.length());
+      d->data_lock.Unlock();
+      if (r < 0)
+        return r;
+
+      d->lock.Lock();
+      d->total_read += len;
+      d->lock.Unlock();
+
+      return 0;
+    }
+  }
+
   d->throttle.get(len);
   if (d->is_cancelled()) {
     return d->get_err_code();
@@ -9451,7 +9867,7 @@ int RGWRados::get_obj_iterate_cb(RGWObjectCtx *ctx, RGWObjState *astate,
   /* add io after we check that we're not cancelled, otherwise we're going to have trouble
    * cleaning up
    */
-  d->add_io(obj_ofs, len, &pbl, &c);
+  d->add_io(obj_ofs, len, cache_key, &pbl, &c);
 
   ldout(cct, 20) << "rados->get_obj_iterate_cb oid=" << oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
   op.read(read_ofs, len, pbl, NULL);
@@ -11259,6 +11675,270 @@ int RGWRados::bi_list(rgw_bucket& bucket, const string& obj_name, const string&
   return 0;
 }
 
+/* the object name a raw bi entry hashes on; needed to rehash entries into
+ * the new shard set during a reshard */
+static int bi_entry_obj_name(rgw_cls_bi_entry& entry, string *name)
+{
+  bufferlist::iterator iter = entry.data.begin();
+  try {
+    switch (entry.type) {
+      case PlainIdx:
+      case InstanceIdx: {
+        rgw_bucket_dir_entry e;
+        ::decode(e, iter);
+        *name = e.key.name;
+        break;
+      }
+      case OLHIdx: {
+        rgw_bucket_olh_entry e;
+        ::decode(e, iter);
+        *name = e.key.name;
+        break;
+      }
+      default:
+        return -EINVAL;
+    }
+  } catch (buffer::error& err) {
+    return -EIO;
+  }
+  return 0;
+}
+
+int RGWRados::reshard_bucket(RGWBucketInfo& bucket_info, map<string, bufferlist>& attrs, int new_num_shards)
+{
+  rgw_bucket& bucket = bucket_info.bucket;
+
+  if (bucket_info.index_type != RGWBIType_Normal) {
+    return -ENOTSUP;
+  }
+  if (new_num_shards <= (int)bucket_info.num_shards) {
+    ldout(cct, 0) << "ERROR: requested shard count " << new_num_shards
+                  << " does not grow the index (current: " << bucket_info.num_shards << ")" << dendl;
+    return -EINVAL;
+  }
+  if (new_num_shards > MAX_BUCKET_INDEX_SHARDS_PRIME) {
+    ldout(cct, 1) << "requested shard count is too large, reset to value: "
+                  << MAX_BUCKET_INDEX_SHARDS_PRIME << dendl;
+    new_num_shards = MAX_BUCKET_INDEX_SHARDS_PRIME;
+  }
+
+  librados::IoCtx index_ctx;
+  int ret = open_bucket_index_ctx(bucket, index_ctx);
+  if (ret < 0)
+    return ret;
+
+  string old_marker = bucket.marker;
+  uint32_t old_num_shards = bucket_info.num_shards;
+
+  map<int, string> old_objs;
+  get_bucket_index_objects(dir_oid_prefix + old_marker, old_num_shards, old_objs);
+
+  /* the new index gets a fresh marker, same scheme as bucket creation;
+   * bucket_id is left alone so the instance metadata object stays put */
+  uint64_t iid = instance_id();
+  uint64_t bid = next_bucket_id();
+  char buf[get_zone_params().get_id().size() + 48];
+  snprintf(buf, sizeof(buf), "%s.%llu.%llu", get_zone_params().get_id().c_str(), (long long)iid, (long long)bid);
+  string new_marker = buf;
+
+  string new_oid_base = dir_oid_prefix + new_marker;
+  map<int, string> new_objs;
+  get_bucket_index_objects(new_oid_base, new_num_shards, new_objs);
+
+  ret = CLSRGWIssueBucketIndexInit(index_ctx, new_objs, cct->_conf->rgw_bucket_index_max_aio)();
+  if (ret < 0) {
+    ldout(cct, 0) << "ERROR: failed to init new index shards for bucket " << bucket.name << dendl;
+    return ret;
+  }
+
+  /* fence off the old shards; in-flight prepare/complete ops now get
+   * -CLS_RGW_ERR_BUSY_RESHARDING and retry against the new index once we
+   * link it below */
+  map<int, string>::iterator oiter;
+  for (oiter = old_objs.begin(); oiter != old_objs.end(); ++oiter) {
+    ret = cls_rgw_set_bucket_resharding(index_ctx, oiter->second, CLS_RGW_RESHARD_IN_PROGRESS);
+    if (ret < 0) {
+      ldout(cct, 0) << "ERROR: failed to set resharding flag on " << oiter->second << dendl;
+      goto unfence;
+    }
+  }
+
+  /* copy all raw index entries, rehashing each into the wider shard set */
+  for (oiter = old_objs.begin(); oiter != old_objs.end(); ++oiter) {
+    string marker;
+    bool truncated = true;
+    while (truncated) {
+      list<rgw_cls_bi_entry> entries;
+      ret = cls_rgw_bi_list(index_ctx, oiter->second, string(), marker, 1000, &entries, &truncated);
+      if (ret < 0 && ret != -ENOENT) {
+        ldout(cct, 0) << "ERROR: bi_list on " << oiter->second << " returned ret=" << ret << dendl;
+        goto unfence;
+      }
+      if (ret == -ENOENT) {
+        break;
+      }
+      for (list<rgw_cls_bi_entry>::iterator eiter = entries.begin(); eiter != entries.end(); ++eiter) {
+        rgw_cls_bi_entry& entry = *eiter;
+        marker = entry.idx;
+
+        string name;
+        ret = bi_entry_obj_name(entry, &name);
+        if (ret < 0) {
+          ldout(cct, 0) << "ERROR: cannot determine object name for bi entry " << entry.idx << dendl;
+          goto unfence;
+        }
+        string new_oid;
+        ret = get_bucket_index_object(new_oid_base, name, new_num_shards,
+                                      (RGWBucketInfo::BIShardsHashType)bucket_info.bucket_index_shard_hash_type,
+                                      &new_oid, NULL);
+        if (ret < 0) {
+          goto unfence;
+        }
+        ret = cls_rgw_bi_put(index_ctx, new_oid, entry);
+        if (ret < 0) {
+          ldout(cct, 0) << "ERROR: bi_put on " << new_oid << " returned ret=" << ret << dendl;
+          goto unfence;
+        }
+      }
+    }
+  }
+
+  /* bi_put doesn't touch the header; recalculate the stats on the new shards */
+  ret = CLSRGWIssueBucketRebuild(index_ctx, new_objs, cct->_conf->rgw_bucket_index_max_aio)();
+  if (ret < 0) {
+    ldout(cct, 0) << "ERROR: failed to rebuild headers on new index shards" << dendl;
+    goto unfence;
+  }
+
+  bucket_info.bucket.marker = new_marker;
+  bucket_info.num_shards = new_num_shards;
+
+  ret = put_bucket_instance_info(bucket_info, false, real_time(), &attrs);
+  if (ret < 0) {
+    ldout(cct, 0) << "ERROR: failed to store updated bucket instance info: " << cpp_strerror(-ret) << dendl;
+    bucket_info.bucket.marker = old_marker;
+    bucket_info.num_shards = old_num_shards;
+    goto unfence;
+  }
+
+  /* the old shard objects are left fenced so that stragglers can't write to
+   * them; they can be removed once no old reader is left */
+  ldout(cct, 1) << "bucket " << bucket.name << " resharded to " << new_num_shards
+                << " shards, old index objects with marker " << old_marker << " can be removed" << dendl;
+  return 0;
+
+unfence:
+  for (map<int, string>::iterator riter = old_objs.begin(); riter != old_objs.end(); ++riter) {
+    int r = cls_rgw_set_bucket_resharding(index_ctx, riter->second, CLS_RGW_RESHARD_NONE);
+    if (r < 0) {
+      ldout(cct, 0) << "ERROR: failed to clear resharding flag on " << riter->second
+                    << ", shard will reject writes until cleared" << dendl;
+    }
+  }
+  return ret;
+}
+
+int RGWRados::block_while_resharding(RGWBucketInfo& bucket_info)
+{
+  const string start_marker = bucket_info.bucket.marker;
+
+  /* poll the bucket instance info until the resharder has swapped in the
+   * new index; bounded by the reshard lock duration, after which the
+   * reshard has failed or stalled and we give up */
+  int max_secs = cct->_conf->rgw_reshard_bucket_lock_duration;
+  for (int i = 0; i < max_secs * 10; i++) {
+    RGWObjectCtx obj_ctx(this);
+    RGWBucketInfo fresh_info;
+    int ret = get_bucket_instance_info(obj_ctx, bucket_info.bucket, fresh_info, NULL, NULL);
+    if (ret < 0) {
+      return ret;
+    }
+    if (fresh_info.bucket.marker != start_marker) {
+      bucket_info = fresh_info;
+      return 0;
+    }
+    usleep(100 * 1000);
+  }
+
+  ldout(cct, 0) << "ERROR: timed out waiting for reshard of bucket " << bucket_info.bucket.name << " to complete" << dendl;
+  return -ERR_SERVICE_UNAVAILABLE;
+}
+
+class RGWCheckBucketShardCB : public RGWGetDirHeader_CB {
+  RGWRados *store;
+  RGWReshardEntry entry;
+  uint32_t num_shards;
+public:
+  RGWCheckBucketShardCB(RGWRados *_store, const RGWBucketInfo& bucket_info) : store(_store) {
+    entry.tenant = bucket_info.bucket.tenant;
+    entry.bucket_name = bucket_info.bucket.name;
+    entry.bucket_id = bucket_info.bucket.bucket_id;
+    entry.old_num_shards = bucket_info.num_shards;
+    num_shards = MAX(bucket_info.num_shards, 1);
+  }
+  void handle_response(int r, rgw_bucket_dir_header& header) {
+    if (r < 0) {
+      return;
+    }
+    if (header.resharding()) {
+      return;
+    }
+    uint64_t shard_entries = 0;
+    for (map<uint8_t, struct rgw_bucket_category_stats>::iterator iter = header.stats.begin();
+         iter != header.stats.end(); ++iter) {
+      shard_entries += iter->second.num_entries;
+    }
+    uint64_t max_objs_per_shard = store->ctx()->_conf->rgw_max_objs_per_shard;
+    if (shard_entries < max_objs_per_shard) {
+      return;
+    }
+    /* assume the shards fill evenly; size the new set for twice the
+     * estimated object count so we don't immediately reshard again */
+    uint64_t want = shard_entries * num_shards * 2 / max_objs_per_shard;
+    if (want > MAX_BUCKET_INDEX_SHARDS_PRIME) {
+      want = MAX_BUCKET_INDEX_SHARDS_PRIME;
+    }
+    if (want <= num_shards) {
+      return;
+    }
+    entry.new_num_shards = want;
+    store->queue_reshard(entry);
+  }
+};
+
+void RGWRados::check_bucket_shards(const RGWBucketInfo& bucket_info, BucketShard& bs)
+{
+  if (!cct->_conf->rgw_dynamic_resharding || !reshard) {
+    return;
+  }
+  if (bucket_info.index_type != RGWBIType_Normal) {
+    return;
+  }
+  /* sample one in 64 index completions; the header fetch below costs an
+   * extra index op, no need to pay it on every write */
+  if (reshard_check_counter.inc() & 0x3f) {
+    return;
+  }
+
+  RGWCheckBucketShardCB *cb = new RGWCheckBucketShardCB(this, bucket_info);
+  int r = cls_rgw_get_dir_header_async(bs.index_ctx, bs.bucket_obj, cb);
+  if (r < 0) {
+    ldout(cct, 5) << "failed to fetch dir header of " << bs.bucket_obj << " r=" << r << dendl;
+  }
+}
+
+void RGWRados::queue_reshard(RGWReshardEntry& entry)
+{
+  /* called from a rados callback context, so queue without blocking */
+  int r = reshard->add_async(entry);
+  if (r < 0) {
+    ldout(cct, 0) << "ERROR: failed to queue reshard of bucket " << entry.bucket_name << " r=" << r << dendl;
+    return;
+  }
+  ldout(cct, 1) << "bucket " << entry.bucket_name << " queued for resharding to "
+                << entry.new_num_shards << " shards" << dendl;
+}
+
 int RGWRados::gc_operate(string& oid, librados::ObjectWriteOperation *op)
 {
   return gc_pool_ctx.operate(oid, op);
@@ -11311,11 +11991,15 @@ int RGWRados::cls_rgw_init_index(librados::IoCtx& index_ctx, librados::ObjectWri
 }
 
 int RGWRados::cls_obj_prepare_op(BucketShard& bs, RGWModifyOp op, string& tag,
-                                 rgw_obj& obj, uint16_t bilog_flags)
+                                 rgw_obj& obj, uint16_t bilog_flags,
+                                 librados::AioCompletion *c)
 {
   ObjectWriteOperation o;
   cls_rgw_obj_key key(obj.get_index_key_name(), obj.get_instance());
   cls_rgw_bucket_prepare_op(o, op, tag, key, obj.get_loc(), get_zone().log_data, bilog_flags);
+  if (c) {
+    return bs.index_ctx.aio_operate(bs.bucket_obj, c, &o);
+  }
   return bs.index_ctx.operate(bs.bucket_obj, &o);
 }
 
@@ -11417,14 +12101,17 @@ int RGWRados::cls_bucket_list(rgw_bucket& bucket, int shard_id, rgw_obj_key& sta
 
   cls_rgw_obj_key start_key(start.name, start.instance);
   r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, num_entries, list_versions,
-                            oids, list_results, cct->_conf->rgw_bucket_index_max_aio)();
+                            oids, list_results, cct->_conf->rgw_bucket_index_list_max_aio)();
   if (r < 0)
     return r;
 
   // Create a list of iterators that are used to iterate each shard
-  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vcurrents(list_results.size());
-  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vends(list_results.size());
-  vector<string> vnames(list_results.size());
+  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vcurrents;
+  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vends;
+  vector<string> vnames;
+  vcurrents.reserve(list_results.size());
+  vends.reserve(list_results.size());
+  vnames.reserve(list_results.size());
   map<int, struct rgw_cls_list_ret>::iterator iter = list_results.begin();
   *is_truncated = false;
   for (; iter != list_results.end(); ++iter) {
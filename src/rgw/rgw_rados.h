@@ -10,6 +10,7 @@
 #include "include/Context.h"
 #include "common/RefCountedObj.h"
 #include "common/RWLock.h"
+#include "common/Thread.h"
 #include "common/ceph_time.h"
 #include "common/lru_map.h"
 #include "rgw_common.h"
@@ -30,9 +31,13 @@ class RGWGC;
 class RGWMetaNotifier;
 class RGWDataNotifier;
 class RGWLC;
+class RGWReshard;
+struct RGWReshardEntry;
+class RGWDataChunkCache;
 class RGWObjectExpirer;
 class RGWMetaSyncProcessorThread;
 class RGWDataSyncProcessorThread;
+class RGWBILogTrimThread;
 class RGWRESTConn;
 
 /* flags for put_obj_meta() */
@@ -1777,6 +1782,9 @@ class RGWRados
 
   RGWGC *gc;
   RGWLC *lc;
+  RGWReshard *reshard;
+  atomic64_t reshard_check_counter;
+  RGWDataChunkCache *data_cache;
   RGWObjectExpirer *obj_expirer;
   bool use_gc_thread;
   bool use_lc_thread;
@@ -1789,6 +1797,7 @@ class RGWRados
   RGWDataNotifier *data_notifier;
   RGWMetaSyncProcessorThread *meta_sync_processor_thread;
   map<string, RGWDataSyncProcessorThread *> data_sync_processor_threads;
+  RGWBILogTrimThread *bilog_trim_thread;
 
   Mutex meta_sync_thread_lock;
   Mutex data_sync_thread_lock;
@@ -1863,9 +1872,10 @@ protected:
   RGWPeriod current_period;
 public:
   RGWRados() : max_req_id(0), lock("rados_timer_lock"), watchers_lock("watchers_lock"), timer(NULL),
-               gc(NULL), lc(NULL), obj_expirer(NULL), use_gc_thread(false), use_lc_thread(false), quota_threads(false),
+               gc(NULL), lc(NULL), reshard(NULL), data_cache(NULL), obj_expirer(NULL), use_gc_thread(false), use_lc_thread(false), quota_threads(false),
                run_sync_thread(false), async_rados(nullptr), meta_notifier(NULL),
                data_notifier(NULL), meta_sync_processor_thread(NULL),
+               bilog_trim_thread(NULL),
                meta_sync_thread_lock("meta_sync_thread_lock"), data_sync_thread_lock("data_sync_thread_lock"),
                num_watchers(0), watchers(NULL),
                watch_initialized(false),
@@ -2375,12 +2385,22 @@ public:
       BucketShard bs;
       bool bs_initialized;
       bool blind;
+      librados::AioCompletion *prepare_c;
+      RGWModifyOp prepare_op;
+
+      int handle_busy_resharding(BucketShard **pbs);
     public:
 
       UpdateIndex(RGWRados::Bucket *_target, rgw_obj& _obj, RGWObjState *_state) : target(_target), obj(_obj), obj_state(_state), bilog_flags(0),
-                                                                                   bs(target->get_store()), bs_initialized(false) {
+                                                                                   bs(target->get_store()), bs_initialized(false),
+                                                                                   prepare_c(NULL), prepare_op(CLS_RGW_OP_UNKNOWN) {
                                                                                      blind = (target->get_bucket_info().index_type == RGWBIType_Indexless);
                                                                                    }
+      ~UpdateIndex() {
+        if (prepare_c) {
+          prepare_c->release();
+        }
+      }
 
       int get_bucket_shard(BucketShard **pbs) {
         if (!bs_initialized) {
@@ -2399,6 +2419,10 @@ public:
       }
 
       int prepare(RGWModifyOp);
+      /* dispatch the prepare op without waiting for it, so that it can ride
+       * alongside the head object write; collect it with prepare_wait() */
+      int prepare_start(RGWModifyOp);
+      int prepare_wait();
       int complete(int64_t poolid, uint64_t epoch, uint64_t size,
                    ceph::real_time& ut, string& etag, string& content_type,
                    bufferlist *acl_bl, RGWObjCategory category,
@@ -2795,7 +2819,8 @@ public:
                                      map<string, bufferlist> *pattrs, bool create_entry_point);
 
   int cls_rgw_init_index(librados::IoCtx& io_ctx, librados::ObjectWriteOperation& op, string& oid);
-  int cls_obj_prepare_op(BucketShard& bs, RGWModifyOp op, string& tag, rgw_obj& obj, uint16_t bilog_flags);
+  int cls_obj_prepare_op(BucketShard& bs, RGWModifyOp op, string& tag, rgw_obj& obj, uint16_t bilog_flags,
+                         librados::AioCompletion *c = NULL);
   int cls_obj_complete_op(BucketShard& bs, RGWModifyOp op, string& tag, int64_t pool, uint64_t epoch,
                           RGWObjEnt& ent, RGWObjCategory category, list<rgw_obj_key> *remove_objs, uint16_t bilog_flags);
   int cls_obj_complete_add(BucketShard& bs, string& tag, int64_t pool, uint64_t epoch, RGWObjEnt& ent,
@@ -2820,6 +2845,17 @@ public:
   int bi_list(rgw_bucket& bucket, const string& obj_name, const string& marker, uint32_t max,
               list<rgw_cls_bi_entry> *entries, bool *is_truncated);
 
+  /* migrate the bucket index to a larger shard set; writes to the old
+   * shards are fenced off for the duration and retried by the callers */
+  int reshard_bucket(RGWBucketInfo& bucket_info, map<string, bufferlist>& attrs, int new_num_shards);
+  /* wait for an in-progress reshard of the bucket to finish and refresh
+   * bucket_info to point at the new index */
+  int block_while_resharding(RGWBucketInfo& bucket_info);
+  /* sampled check of the shard's entry count; queues the bucket for
+   * resharding when it has outgrown rgw_max_objs_per_shard */
+  void check_bucket_shards(const RGWBucketInfo& bucket_info, BucketShard& bs);
+  void queue_reshard(RGWReshardEntry& entry);
+
   int cls_obj_usage_log_add(const string& oid, rgw_usage_log_info& info);
   int cls_obj_usage_log_read(string& oid, string& user, uint64_t start_epoch, uint64_t end_epoch, uint32_t max_entries,
                              string& read_iter, map<rgw_user_bucket, rgw_usage_log_entry>& usage, bool *is_truncated);
@@ -3128,7 +3164,7 @@ public:
     return 0;
   }
   virtual int handle_data(bufferlist& bl, off_t ofs, MD5 *hash, void **phandle, rgw_obj *pobj, bool *again) = 0;
-  virtual int throttle_data(void *handle, const rgw_obj& obj, bool need_to_wait) = 0;
+  virtual int throttle_data(void *handle, const rgw_obj& obj, uint64_t size, bool need_to_wait) = 0;
   virtual void complete_hash(MD5 *hash) {
     assert(0);
   }
@@ -3144,12 +3180,14 @@ public:
 struct put_obj_aio_info {
   void *handle;
   rgw_obj obj;
+  uint64_t size;
 };
 
 class RGWPutObjProcessor_Aio : public RGWPutObjProcessor
 {
   list<struct put_obj_aio_info> pending;
-  size_t max_chunks;
+  uint64_t window_size;
+  uint64_t pending_size;
 
   struct put_obj_aio_info pop_pending();
   int wait_pending_front();
@@ -3170,9 +3208,10 @@ protected:
   int handle_obj_data(rgw_obj& obj, bufferlist& bl, off_t ofs, off_t abs_ofs, void **phandle, bool exclusive);
 
 public:
-  int throttle_data(void *handle, const rgw_obj& obj, bool need_to_wait);
+  virtual int prepare(RGWRados *store, string *oid_rand);
+  int throttle_data(void *handle, const rgw_obj& obj, uint64_t size, bool need_to_wait);
 
-  RGWPutObjProcessor_Aio(RGWObjectCtx& obj_ctx, RGWBucketInfo& bucket_info) : RGWPutObjProcessor(obj_ctx, bucket_info), max_chunks(RGW_MAX_PENDING_CHUNKS), obj_len(0) {}
+  RGWPutObjProcessor_Aio(RGWObjectCtx& obj_ctx, RGWBucketInfo& bucket_info) : RGWPutObjProcessor(obj_ctx, bucket_info), window_size(0), pending_size(0), obj_len(0) {}
   virtual ~RGWPutObjProcessor_Aio();
 }; /* RGWPutObjProcessor_Aio */
 
@@ -3194,6 +3233,31 @@ class RGWPutObjProcessor_Atomic : public RGWPutObjProcessor_Aio
   uint64_t olh_epoch;
   string version_id;
 
+  /* md5 offload: chunks that were already dispatched to rados are hashed on
+   * a separate thread, so that the request thread can keep feeding data in */
+  class DigestWorker : public Thread {
+    RGWPutObjProcessor_Atomic *processor;
+  public:
+    explicit DigestWorker(RGWPutObjProcessor_Atomic *_p) : processor(_p) {}
+    void *entry() {
+      processor->digest_entry();
+      return NULL;
+    }
+  };
+
+  DigestWorker *digest_worker;
+  Mutex digest_lock;
+  Cond digest_cond;
+  Cond digest_drain_cond;
+  std::list<bufferlist> digest_queue;
+  MD5 *digest_hash;
+  bool digest_inflight;
+  bool digest_stopping;
+
+  void digest_update(MD5 *hash, bufferlist& bl);
+  void digest_drain();
+  void digest_entry();
+
 protected:
   rgw_bucket bucket;
   string obj_str;
@@ -3217,7 +3281,7 @@ protected:
   int prepare_init(RGWRados *store, string *oid_rand);
 
 public:
-  ~RGWPutObjProcessor_Atomic() {}
+  ~RGWPutObjProcessor_Atomic();
   RGWPutObjProcessor_Atomic(RGWObjectCtx& obj_ctx, RGWBucketInfo& bucket_info,
                             rgw_bucket& _b, const string& _o, uint64_t _p, const string& _t, bool versioned) :
                                 RGWPutObjProcessor_Aio(obj_ctx, bucket_info),
@@ -3230,6 +3294,11 @@ public:
                                 max_chunk_size(0),
                                 versioned_object(versioned),
                                 olh_epoch(0),
+                                digest_worker(NULL),
+                                digest_lock("RGWPutObjProcessor_Atomic::digest_lock"),
+                                digest_hash(NULL),
+                                digest_inflight(false),
+                                digest_stopping(false),
                                 bucket(_b),
                                 obj_str(_o),
                                 unique_tag(_t) {}
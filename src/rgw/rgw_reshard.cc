@@ -0,0 +1,274 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "rgw_reshard.h"
+#include "rgw_rados.h"
+#include "cls/lock/cls_lock_client.h"
+#include "common/ceph_time.h"
+#include "common/errno.h"
+
+#include "include/assert.h"
+
+#define dout_subsys ceph_subsys_rgw
+
+using namespace std;
+using namespace librados;
+
+static string reshard_oid = "reshard";
+static string reshard_lock_name = "reshard_process";
+
+void RGWReshard::initialize(CephContext *_cct, RGWRados *_store)
+{
+  cct = _cct;
+  store = _store;
+}
+
+int RGWReshard::open_ioctx()
+{
+  if (io_ctx_initialized) {
+    return 0;
+  }
+
+  const char *log_pool = store->get_zone_params().log_pool.name.c_str();
+  librados::Rados *rad = store->get_rados_handle();
+  int r = rad->ioctx_create(log_pool, io_ctx);
+  if (r == -ENOENT) {
+    r = rad->pool_create(log_pool);
+    if (r == -EEXIST)
+      r = 0;
+    if (r < 0)
+      return r;
+
+    r = rad->ioctx_create(log_pool, io_ctx);
+  }
+  if (r < 0)
+    return r;
+
+  io_ctx_initialized = true;
+  return 0;
+}
+
+int RGWReshard::add(RGWReshardEntry& entry)
+{
+  int ret = open_ioctx();
+  if (ret < 0)
+    return ret;
+
+  entry.time = real_clock::now();
+
+  map<string, bufferlist> values;
+  ::encode(entry, values[entry.get_key()]);
+
+  return io_ctx.omap_set(reshard_oid, values);
+}
+
+int RGWReshard::add_async(RGWReshardEntry& entry)
+{
+  int ret = open_ioctx();
+  if (ret < 0)
+    return ret;
+
+  entry.time = real_clock::now();
+
+  map<string, bufferlist> values;
+  ::encode(entry, values[entry.get_key()]);
+
+  ObjectWriteOperation op;
+  op.omap_set(values);
+
+  AioCompletion *c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+  ret = io_ctx.aio_operate(reshard_oid, c, &op);
+  c->release();
+  return ret;
+}
+
+int RGWReshard::list(string& marker, uint32_t max, std::list<RGWReshardEntry>& entries, bool *truncated)
+{
+  int ret = open_ioctx();
+  if (ret < 0)
+    return ret;
+
+  map<string, bufferlist> values;
+  ret = io_ctx.omap_get_vals(reshard_oid, marker, max, &values);
+  if (ret == -ENOENT) {
+    *truncated = false;
+    return 0;
+  }
+  if (ret < 0)
+    return ret;
+
+  for (map<string, bufferlist>::iterator iter = values.begin(); iter != values.end(); ++iter) {
+    RGWReshardEntry entry;
+    bufferlist::iterator biter = iter->second.begin();
+    try {
+      ::decode(entry, biter);
+    } catch (buffer::error& err) {
+      lderr(cct) << "ERROR: failed to decode reshard queue entry, key=" << iter->first << dendl;
+      return -EIO;
+    }
+    entries.push_back(entry);
+    marker = iter->first;
+  }
+
+  *truncated = (values.size() == max);
+  return 0;
+}
+
+int RGWReshard::remove(const string& key)
+{
+  int ret = open_ioctx();
+  if (ret < 0)
+    return ret;
+
+  set<string> keys;
+  keys.insert(key);
+
+  return io_ctx.omap_rm_keys(reshard_oid, keys);
+}
+
+int RGWReshard::process_entry(RGWReshardEntry& entry)
+{
+  RGWObjectCtx obj_ctx(store);
+  RGWBucketInfo bucket_info;
+  map<string, bufferlist> attrs;
+
+  int ret = store->get_bucket_info(obj_ctx, entry.tenant, entry.bucket_name,
+                                   bucket_info, NULL, &attrs);
+  if (ret < 0) {
+    if (ret == -ENOENT) {
+      /* bucket is gone; nothing left to reshard */
+      return 0;
+    }
+    lderr(cct) << "ERROR: failed to read bucket info for "
+               << entry.get_key() << ": " << cpp_strerror(-ret) << dendl;
+    return ret;
+  }
+
+  if (bucket_info.bucket.bucket_id != entry.bucket_id ||
+      bucket_info.num_shards != entry.old_num_shards) {
+    /* already resharded (possibly by another instance); drop the entry */
+    ldout(cct, 10) << "reshard entry for " << entry.get_key()
+                   << " is stale, skipping" << dendl;
+    return 0;
+  }
+
+  ldout(cct, 1) << "resharding bucket " << entry.get_key() << " from "
+                << entry.old_num_shards << " to " << entry.new_num_shards
+                << " shards" << dendl;
+
+  return store->reshard_bucket(bucket_info, attrs, entry.new_num_shards);
+}
+
+int RGWReshard::process()
+{
+  int ret = open_ioctx();
+  if (ret < 0)
+    return ret;
+
+  rados::cls::lock::Lock l(reshard_lock_name);
+  utime_t time(cct->_conf->rgw_reshard_bucket_lock_duration, 0);
+  l.set_duration(time);
+
+  ret = l.lock_exclusive(&io_ctx, reshard_oid);
+  if (ret == -EBUSY) { /* already being processed by another instance */
+    ldout(cct, 5) << "RGWReshard::process() failed to acquire lock on "
+                  << reshard_oid << dendl;
+    return 0;
+  }
+  if (ret < 0)
+    return ret;
+
+  string marker;
+  bool truncated = true;
+
+  while (truncated && !going_down()) {
+    std::list<RGWReshardEntry> entries;
+    ret = list(marker, 32, entries, &truncated);
+    if (ret < 0)
+      break;
+
+    for (std::list<RGWReshardEntry>::iterator iter = entries.begin();
+         iter != entries.end() && !going_down(); ++iter) {
+      RGWReshardEntry& entry = *iter;
+
+      /* resharding a big bucket can take a while; keep the lock alive */
+      ret = l.lock_exclusive(&io_ctx, reshard_oid);
+      if (ret < 0 && ret != -EBUSY)
+        goto done;
+
+      ret = process_entry(entry);
+      if (ret < 0) {
+        lderr(cct) << "ERROR: failed to reshard bucket " << entry.get_key()
+                   << ": " << cpp_strerror(-ret) << ", leaving entry queued" << dendl;
+        continue;
+      }
+
+      ret = remove(entry.get_key());
+      if (ret < 0) {
+        lderr(cct) << "ERROR: failed to remove reshard queue entry for "
+                   << entry.get_key() << dendl;
+      }
+    }
+  }
+
+done:
+  l.unlock(&io_ctx, reshard_oid);
+  return ret;
+}
+
+bool RGWReshard::going_down()
+{
+  return (down_flag.read() != 0);
+}
+
+void RGWReshard::start_processor()
+{
+  worker = new ReshardWorker(cct, this);
+  worker->create("rgw_reshard");
+}
+
+void RGWReshard::stop_processor()
+{
+  down_flag.set(1);
+  if (worker) {
+    worker->stop();
+    worker->join();
+    delete worker;
+    worker = NULL;
+  }
+}
+
+void *RGWReshard::ReshardWorker::entry()
+{
+  do {
+    utime_t start = ceph_clock_now(cct);
+    int r = reshard->process();
+    if (r < 0) {
+      dout(0) << "ERROR: reshard process() returned error r=" << r << dendl;
+    }
+
+    if (reshard->going_down())
+      break;
+
+    utime_t end = ceph_clock_now(cct);
+    end -= start;
+    int secs = cct->_conf->rgw_reshard_thread_interval;
+
+    if (secs <= end.sec())
+      continue; // next round
+
+    secs -= end.sec();
+
+    lock.Lock();
+    cond.WaitInterval(cct, lock, utime_t(secs, 0));
+    lock.Unlock();
+  } while (!reshard->going_down());
+
+  return NULL;
+}
+
+void RGWReshard::ReshardWorker::stop()
+{
+  Mutex::Locker l(lock);
+  cond.Signal();
+}
@@ -0,0 +1,107 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_RGW_RESHARD_H
+#define CEPH_RGW_RESHARD_H
+
+#include "include/types.h"
+#include "include/atomic.h"
+#include "include/rados/librados.hpp"
+#include "common/Mutex.h"
+#include "common/Cond.h"
+#include "common/Thread.h"
+#include "rgw_common.h"
+
+class RGWRados;
+
+struct RGWReshardEntry {
+  string tenant;
+  string bucket_name;
+  string bucket_id;
+  uint32_t old_num_shards;
+  uint32_t new_num_shards;
+  ceph::real_time time;
+
+  RGWReshardEntry() : old_num_shards(0), new_num_shards(0) {}
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(tenant, bl);
+    ::encode(bucket_name, bl);
+    ::encode(bucket_id, bl);
+    ::encode(old_num_shards, bl);
+    ::encode(new_num_shards, bl);
+    ::encode(time, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(1, bl);
+    ::decode(tenant, bl);
+    ::decode(bucket_name, bl);
+    ::decode(bucket_id, bl);
+    ::decode(old_num_shards, bl);
+    ::decode(new_num_shards, bl);
+    ::decode(time, bl);
+    DECODE_FINISH(bl);
+  }
+
+  /* omap key on the reshard queue object */
+  string get_key() const {
+    if (tenant.empty())
+      return bucket_name;
+    return tenant + ":" + bucket_name;
+  }
+};
+WRITE_CLASS_ENCODER(RGWReshardEntry)
+
+/*
+ * Queue of buckets waiting to be resharded, kept as omap entries on a
+ * single control object, plus the background worker that drains it.
+ * Entries are added either by the admin tool or automatically when an
+ * index shard grows past rgw_max_objs_per_shard.
+ */
+class RGWReshard {
+  CephContext *cct;
+  RGWRados *store;
+  librados::IoCtx io_ctx;
+  bool io_ctx_initialized;
+  atomic_t down_flag;
+
+  int open_ioctx();
+  int process_entry(RGWReshardEntry& entry);
+
+  class ReshardWorker : public Thread {
+    CephContext *cct;
+    RGWReshard *reshard;
+    Mutex lock;
+    Cond cond;
+
+  public:
+    ReshardWorker(CephContext *_cct, RGWReshard *_reshard) : cct(_cct), reshard(_reshard), lock("ReshardWorker") {}
+    void *entry();
+    void stop();
+  };
+
+  ReshardWorker *worker;
+public:
+  RGWReshard() : cct(NULL), store(NULL), io_ctx_initialized(false), worker(NULL) {}
+  ~RGWReshard() {
+    stop_processor();
+  }
+
+  void initialize(CephContext *_cct, RGWRados *_store);
+
+  int add(RGWReshardEntry& entry);
+  /* fire-and-forget variant, safe to call from a rados callback context */
+  int add_async(RGWReshardEntry& entry);
+  int list(string& marker, uint32_t max, std::list<RGWReshardEntry>& entries, bool *truncated);
+  int remove(const string& key);
+
+  int process();
+
+  bool going_down();
+  void start_processor();
+  void stop_processor();
+};
+
+#endif
@@ -517,6 +517,73 @@ void RGWOp_BILog_Info::send_response() {
   flusher.flush();
 }
 
+void RGWOp_BILog_SyncStatus::execute() {
+  string source_zone = s->info.args.get("source-zone"),
+         tenant_name = s->info.args.get("tenant"),
+         bucket_name = s->info.args.get("bucket"),
+         bucket_instance = s->info.args.get("bucket-instance");
+  RGWBucketInfo bucket_info;
+
+  RGWObjectCtx& obj_ctx = *static_cast<RGWObjectCtx *>(s->obj_ctx);
+
+  if (source_zone.empty() ||
+      (bucket_name.empty() && bucket_instance.empty())) {
+    dout(5) << "ERROR: both source-zone, and one of bucket and bucket instance are mandatory" << dendl;
+    http_ret = -EINVAL;
+    return;
+  }
+
+  int shard_id;
+  http_ret = rgw_bucket_parse_bucket_instance(bucket_instance, &bucket_instance, &shard_id);
+  if (http_ret < 0) {
+    return;
+  }
+
+  if (!bucket_instance.empty()) {
+    http_ret = store->get_bucket_instance_info(obj_ctx, bucket_instance, bucket_info, NULL, NULL);
+    if (http_ret < 0) {
+      dout(5) << "could not get bucket instance info for bucket instance id=" << bucket_instance << dendl;
+      return;
+    }
+  } else { /* !bucket_name.empty() */
+    http_ret = store->get_bucket_info(obj_ctx, tenant_name, bucket_name, bucket_info, NULL, NULL);
+    if (http_ret < 0) {
+      dout(5) << "could not get bucket info for bucket=" << bucket_name << dendl;
+      return;
+    }
+  }
+
+  RGWBucketSyncStatusManager sync(store, source_zone, bucket_info.bucket);
+
+  http_ret = sync.init();
+  if (http_ret < 0) {
+    dout(5) << "failed to initialize bucket sync status manager: "
+            << cpp_strerror(-http_ret) << dendl;
+    return;
+  }
+
+  http_ret = sync.read_sync_status();
+  if (http_ret < 0) {
+    dout(5) << "failed to read bucket sync status: "
+            << cpp_strerror(-http_ret) << dendl;
+    return;
+  }
+
+  sync_status = sync.get_sync_status();
+}
+
+void RGWOp_BILog_SyncStatus::send_response() {
+  set_req_state_err(s, http_ret);
+  dump_errno(s);
+  end_header(s);
+
+  if (http_ret < 0)
+    return;
+
+  encode_json("sync_status", sync_status, s->formatter);
+  flusher.flush();
+}
+
 void RGWOp_BILog_Delete::execute() {
   string tenant_name = s->info.args.get("tenant"),
          bucket_name = s->info.args.get("bucket"),
@@ -858,6 +925,8 @@ RGWOp *RGWHandler_Log::op_get() {
   } else if (type.compare("bucket-index") == 0) {
     if (s->info.args.exists("info")) {
       return new RGWOp_BILog_Info;
+    } else if (s->info.args.exists("sync-status")) {
+      return new RGWOp_BILog_SyncStatus;
     } else {
       return new RGWOp_BILog_List;
     }
@@ -16,6 +16,8 @@
 #define RGW_REST_LOG_H
 
 #include "rgw_metadata.h"
+#include "rgw_sync.h"
+#include "rgw_data_sync.h"
 
 class RGWOp_BILog_List : public RGWRESTOp {
   bool sent_header;
@@ -59,6 +61,25 @@ public:
   }
 };
 
+class RGWOp_BILog_SyncStatus : public RGWRESTOp {
+  map<int, rgw_bucket_shard_sync_info> sync_status;
+public:
+  RGWOp_BILog_SyncStatus() {}
+  ~RGWOp_BILog_SyncStatus() {}
+
+  int check_caps(RGWUserCaps& caps) {
+    return caps.check_cap("bilog", RGW_CAP_READ);
+  }
+  int verify_permission() {
+    return check_caps(s->user->caps);
+  }
+  virtual void send_response();
+  void execute();
+  virtual const string name() {
+    return "bucket_index_log_sync_status";
+  }
+};
+
 class RGWOp_BILog_Delete : public RGWRESTOp {
 public:
   RGWOp_BILog_Delete() {}
@@ -283,7 +283,7 @@ done:
 
 send_data:
   if (get_data && !op_ret) {
-    int r = STREAM_IO(s)->write(bl.c_str() + bl_ofs, bl_len);
+    int r = STREAM_IO(s)->write(bl, bl_ofs, bl_len);
     if (r < 0)
       return r;
   }
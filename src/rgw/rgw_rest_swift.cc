@@ -1251,7 +1251,7 @@ int RGWGetObj_ObjStore_SWIFT::send_response_data(bufferlist& bl,
 
 send_data:
   if (get_data && !op_ret) {
-    int r = STREAM_IO(s)->write(bl.c_str() + bl_ofs, bl_len);
+    int r = STREAM_IO(s)->write(bl, bl_ofs, bl_len);
     if (r < 0)
       return r;
   }
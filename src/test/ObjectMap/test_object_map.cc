@@ -744,6 +744,50 @@ TEST_F(ObjectMapTest, OddEvenClone) {
   db->clear(hoid2);
 }
 
+TEST_F(ObjectMapTest, FlattenClonedChains) {
+  ghobject_t hoid(hobject_t(sobject_t("foo", CEPH_NOSNAP)));
+  ghobject_t hoid2(hobject_t(sobject_t("foo2", CEPH_NOSNAP)));
+  ghobject_t hoid3(hobject_t(sobject_t("foo3", CEPH_NOSNAP)));
+
+  for (unsigned i = 0; i < 100; ++i) {
+    tester.set_key(hoid, "foo" + num_str(i), "bar" + num_str(i));
+  }
+  db->clone(hoid, hoid2);
+  tester.set_key(hoid2, "baz", "bar");
+  tester.remove_key(hoid2, "foo0");
+  db->clone(hoid2, hoid3);
+
+  // writing at chain depth >= filestore_omap_flatten_depth severs the
+  // parent links
+  tester.set_key(hoid3, "baz2", "bar2");
+
+  string result;
+  int r = tester.get_key(hoid3, "baz2", &result);
+  ASSERT_EQ(1, r);
+  ASSERT_EQ("bar2", result);
+  r = tester.get_key(hoid3, "baz", &result);
+  ASSERT_EQ(1, r);
+  ASSERT_EQ("bar", result);
+  r = tester.get_key(hoid3, "foo0", &result);
+  ASSERT_EQ(0, r);
+  for (unsigned i = 1; i < 100; ++i) {
+    r = tester.get_key(hoid3, "foo" + num_str(i), &result);
+    ASSERT_EQ(1, r);
+    ASSERT_EQ("bar" + num_str(i), result);
+  }
+
+  // ancestors are unaffected
+  r = tester.get_key(hoid, "foo0", &result);
+  ASSERT_EQ(1, r);
+  ASSERT_EQ("bar0", result);
+  r = tester.get_key(hoid2, "baz2", &result);
+  ASSERT_EQ(0, r);
+
+  db->clear(hoid);
+  db->clear(hoid2);
+  db->clear(hoid3);
+}
+
 TEST_F(ObjectMapTest, RandomTest) {
   tester.def_init();
   for (unsigned i = 0; i < 5000; ++i) {
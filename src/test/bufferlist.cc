@@ -2130,6 +2130,30 @@ TEST(BufferList, copy_in) {
   }
 }
 
+TEST(BufferList, reserve) {
+  //
+  // everything appended after a reserve() lands in a single buffer
+  //
+  {
+    bufferlist bl;
+    bl.reserve(CEPH_PAGE_SIZE * 4);
+    for (unsigned i = 0; i < CEPH_PAGE_SIZE * 4; ++i)
+      bl.append('X');
+    EXPECT_EQ(CEPH_PAGE_SIZE * 4, bl.length());
+    EXPECT_EQ((unsigned)1, bl.get_num_buffers());
+  }
+  //
+  // a reserve that fits in the current append_buffer is a no-op
+  //
+  {
+    bufferlist bl(CEPH_PAGE_SIZE);
+    bl.append('A');
+    bl.reserve(CEPH_PAGE_SIZE / 2);
+    bl.append('B');
+    EXPECT_EQ((unsigned)1, bl.get_num_buffers());
+  }
+}
+
 TEST(BufferList, append) {
   //
   // void append(char c);
@@ -2142,6 +2166,17 @@ TEST(BufferList, append) {
     //EXPECT_TRUE(bl.is_aligned(CEPH_BUFFER_APPEND_SIZE));
   }
   //
+  // successive append_buffers double in size, so a long stream of tiny
+  // appends allocates O(log n) buffers rather than one per page
+  //
+  {
+    bufferlist bl;
+    for (unsigned i = 0; i < 16 * CEPH_PAGE_SIZE; ++i)
+      bl.append('X');
+    EXPECT_EQ(16 * CEPH_PAGE_SIZE, bl.length());
+    EXPECT_GE((unsigned)6, bl.get_num_buffers());
+  }
+  //
   // void append(const char *data, unsigned len);
   //
   {
@@ -7,6 +7,14 @@
      --test-map-pgs-dump [--pool <poolid>] map all pgs
      --mark-up-in            mark osds up and in (but do not persist)
      --clear-temp            clear pg_temp and primary_temp
+     --upmap [--pool <poolid>] [--upmap-max <max>]
+                             calculate pg upmap overrides to balance pg counts
+     --test-map-moves [--pool <poolid>] [--moves-domain <type>]
+                      [--moves-threads <n>] [--pg-bytes <bytes>]
+                             compare pg mappings before and after the other
+                             changes requested in this run and report movement
+                             per osd and per failure domain; the modified map
+                             is not written back
      --test-random           do random placements
      --test-map-pg <pgid>    map a pgid to osds
      --test-map-object <objectname> [--pool <poolid>] map an object to osds
@@ -73,6 +73,35 @@ TEST(Readahead, max_size_limit) {
   ASSERT_RA(1140, 50, r.update(1110, 10, Readahead::NO_LIMIT));
 }
 
+TEST(Readahead, multi_stream) {
+  Readahead r;
+  r.set_trigger_requests(2);
+  r.set_max_streams(2);
+  // two interleaved sequential streams are tracked independently
+  ASSERT_RA(0, 0, r.update(1000, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(5000, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(1010, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(5010, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(1030, 20, r.update(1020, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(5030, 20, r.update(5020, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(1050, 40, r.update(1030, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(5050, 40, r.update(5030, 10, Readahead::NO_LIMIT));
+}
+
+TEST(Readahead, stride) {
+  Readahead r;
+  r.set_trigger_requests(2);
+  r.set_max_streams(2);
+  // constant-stride scan: 10 bytes read, 10 byte hole
+  ASSERT_RA(0, 0, r.update(1000, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(1020, 10, Readahead::NO_LIMIT));   // stride seen
+  ASSERT_RA(1050, 20, r.update(1040, 10, Readahead::NO_LIMIT)); // confirmed
+  ASSERT_RA(1070, 40, r.update(1060, 10, Readahead::NO_LIMIT));
+  // an unrelated random read does not disturb the strided stream
+  ASSERT_RA(0, 0, r.update(2000, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(1110, 80, r.update(1080, 10, Readahead::NO_LIMIT));
+}
+
 TEST(Readahead, limit) {
   Readahead r;
   r.set_trigger_requests(2);
@@ -176,6 +176,28 @@ TEST_F(ThrottleTest, get_or_fail) {
   }
 }
 
+TEST_F(ThrottleTest, parent) {
+  int64_t throttle_max = 10;
+  Throttle parent(g_ceph_context, "parent", throttle_max);
+  Throttle child(g_ceph_context, "child", throttle_max / 2, true, &parent);
+
+  // slots are taken from both levels
+  ASSERT_TRUE(child.get_or_fail(throttle_max / 2));
+  ASSERT_EQ(child.get_current(), throttle_max / 2);
+  ASSERT_EQ(parent.get_current(), throttle_max / 2);
+
+  // the child is full even though the parent is not
+  ASSERT_FALSE(child.get_or_fail(1));
+  ASSERT_EQ(child.put(throttle_max / 2), 0);
+  ASSERT_EQ(parent.get_current(), 0);
+
+  // a parent side failure releases the child slots again
+  ASSERT_TRUE(parent.get_or_fail(throttle_max));
+  ASSERT_FALSE(child.get_or_fail(1));
+  ASSERT_EQ(child.get_current(), 0);
+  ASSERT_EQ(parent.put(throttle_max), 0);
+}
+
 TEST_F(ThrottleTest, wait) {
   int64_t throttle_max = 10;
   Throttle throttle(g_ceph_context, "throttle");
@@ -117,6 +117,59 @@ TEST(BloomFilter, SweepInt) {
 }
 
 
+TEST(BloomFilter, BlockedBasic) {
+  blocked_bloom_filter bf(10, .1, 1);
+  bf.insert((uint32_t)1);
+  bf.insert((uint32_t)2);
+
+  ASSERT_TRUE(bf.contains((uint32_t)1));
+  ASSERT_TRUE(bf.contains((uint32_t)2));
+
+  ASSERT_EQ(2U, bf.element_count());
+
+  // round-trips through encode/decode
+  bufferlist bl;
+  ::encode(bf, bl);
+  blocked_bloom_filter bf2;
+  bufferlist::iterator iter = bl.begin();
+  ::decode(bf2, iter);
+  ASSERT_TRUE(bf2.contains((uint32_t)1));
+  ASSERT_TRUE(bf2.contains((uint32_t)2));
+}
+
+TEST(BloomFilter, BlockedSweepInt) {
+  std::cout.setf(std::ios_base::fixed, std::ios_base::floatfield);
+  std::cout.precision(5);
+  std::cout << "# max\tfpp\tactual\tsize\tB/insert" << std::endl;
+  for (int ex = 3; ex < 12; ex += 2) {
+    for (float fpp = .001; fpp < .5; fpp *= 4.0) {
+      int max = 2 << ex;
+      blocked_bloom_filter bf(max, fpp, 1);
+
+      for (int n = 0; n < max; n++)
+	bf.insert(n);
+      for (int n = 0; n < max; n++)
+	ASSERT_TRUE(bf.contains(n));
+
+      int test = max * 100;
+      int hit = 0;
+      for (int n = 0; n < test; n++)
+	if (bf.contains(100000 + n))
+	  hit++;
+
+      double actual = (double)hit / (double)test;
+
+      bufferlist bl;
+      ::encode(bf, bl);
+
+      double byte_per_insert = (double)bl.length() / (double)max;
+
+      std::cout << max << "\t" << fpp << "\t" << actual << "\t" << bl.length() << "\t" << byte_per_insert << std::endl;
+      ASSERT_TRUE(actual < fpp * 10);
+    }
+  }
+}
+
 TEST(BloomFilter, CompressibleSweep) {
   std::cout.setf(std::ios_base::fixed, std::ios_base::floatfield);
   std::cout.precision(5);
@@ -17,6 +17,7 @@
 #include <gtest/gtest.h>
 #include "include/interval_set.h"
 #include "include/btree_interval_set.h"
+#include "include/flat_interval_set.h"
 
 using namespace ceph;
 
@@ -29,7 +30,7 @@ class IntervalSetTest : public ::testing::Test {
   typedef T ISet;
 };
 
-typedef ::testing::Types< interval_set<IntervalValueType> ,  btree_interval_set<IntervalValueType> > IntervalSetTypes;
+typedef ::testing::Types< interval_set<IntervalValueType> ,  btree_interval_set<IntervalValueType> , flat_interval_set<IntervalValueType> > IntervalSetTypes;
 
 TYPED_TEST_CASE(IntervalSetTest, IntervalSetTypes);
 
@@ -561,4 +562,53 @@ TYPED_TEST(IntervalSetTest, span_of) {
   iset1.span_of( iset2, 100, 5 );
   ASSERT_EQ( iset1.num_intervals(), 0);
   ASSERT_EQ( iset1.size(), 0);
-}
\ No newline at end of file
+}
+TYPED_TEST(IntervalSetTest, copy) {
+  typedef typename TestFixture::ISet ISet;
+  ISet iset1;
+
+  iset1.insert(5, 5);
+  iset1.insert(20, 5);
+
+  // copies behave as values: mutating one side must not leak into the
+  // other, even for implementations that share storage internally.
+  ISet iset2(iset1);
+  ASSERT_TRUE( iset1 == iset2 );
+
+  iset2.erase(21, 3);
+  ASSERT_EQ( iset1.size(), 10);
+  ASSERT_EQ( iset2.size(), 7);
+  ASSERT_TRUE( iset1.contains( 20, 5 ));
+  ASSERT_FALSE( iset2.contains( 20, 5 ));
+
+  ISet iset3;
+  iset3 = iset1;
+  iset3.insert(40, 2);
+  iset1.clear();
+  ASSERT_TRUE( iset1.empty() );
+  ASSERT_EQ( iset3.size(), 12);
+  ASSERT_TRUE( iset3.contains( 5, 5 ));
+  ASSERT_TRUE( iset3.contains( 40, 2 ));
+}
+
+TEST(flat_interval_set, encoding_matches_interval_set) {
+  // flat_interval_set must be drop-in replaceable inside encoded
+  // structures, so its encoding has to be byte-identical to the
+  // map-backed interval_set.
+  interval_set<IntervalValueType> mset;
+  flat_interval_set<IntervalValueType> fset;
+  mset.insert(5, 10);
+  mset.insert(30, 1);
+  mset.insert(100, 50);
+  fset.insert(mset);
+
+  bufferlist mbl, fbl;
+  ::encode(mset, mbl);
+  ::encode(fset, fbl);
+  ASSERT_TRUE(mbl.contents_equal(fbl));
+
+  flat_interval_set<IntervalValueType> fset2;
+  bufferlist::iterator p = mbl.begin();
+  ::decode(fset2, p);
+  ASSERT_TRUE(fset == fset2);
+}
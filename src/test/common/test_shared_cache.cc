@@ -393,6 +393,39 @@ TEST(SharedCache_all, lru) {
   ASSERT_TRUE(cache.lookup(0).get());
 }
 
+TEST(ShardedSharedLRU_all, lookup_or_create) {
+  ShardedSharedLRU<unsigned int, int> cache(g_ceph_context, 64, 4);
+  for (unsigned int i = 0; i < 16; ++i) {
+    ceph::shared_ptr<int> ptr = cache.lookup_or_create(i);
+    ASSERT_TRUE(ptr.get());
+    *ptr = (int)i;
+  }
+  for (unsigned int i = 0; i < 16; ++i) {
+    ASSERT_TRUE(cache.lookup(i).get());
+    ASSERT_EQ((int)i, *cache.lookup(i));
+  }
+  ASSERT_FALSE(cache.empty());
+  cache.clear();
+}
+
+TEST(ShardedSharedLRU_all, get_next) {
+  ShardedSharedLRU<unsigned int, int> cache(g_ceph_context, 64, 4);
+  std::list<ceph::shared_ptr<int> > pinned;
+  for (unsigned int i = 0; i < 16; ++i)
+    pinned.push_back(cache.lookup_or_create(i));
+  // keys come back in comparator order even though they live in
+  // different shards
+  unsigned int expected = 0;
+  pair<unsigned int, ceph::shared_ptr<int> > i(0, cache.lookup(0));
+  ASSERT_TRUE(i.second.get());
+  while (cache.get_next(i.first, &i)) {
+    ASSERT_EQ(++expected, i.first);
+  }
+  ASSERT_EQ(15u, expected);
+  pinned.clear();
+  cache.clear();
+}
+
 int main(int argc, char **argv) {
   vector<const char*> args;
   argv_to_vec(argc, (const char **)argv, args);
@@ -2,7 +2,10 @@
 #include <time.h>
 
 #include "include/types.h"
+#include "arch/probe.h"
+#include "arch/intel.h"
 #include "auth/Crypto.h"
+#include "auth/cephx/cephx_sign_aesni.h"
 #include "common/Clock.h"
 #include "common/ceph_crypto.h"
 #include "common/ceph_context.h"
@@ -74,6 +77,41 @@ TEST(AES, Encrypt) {
   ASSERT_EQ(0, err);
 }
 
+TEST(AES, CephxAesniFirstBlock) {
+  // the cephx fast signing path must produce the same first ciphertext
+  // block as the crypto library's CBC stream
+  ceph_arch_probe();
+  if (!cephx_aesni_compiled() || !ceph_arch_intel_aesni) {
+    cout << "no AES-NI, skipping" << std::endl;
+    return;
+  }
+
+  bufferptr k(16);
+  get_random_bytes(k.c_str(), k.length());
+  CryptoKey key(CEPH_CRYPTO_AES, ceph_clock_now(NULL), k);
+
+  bufferptr p(16);
+  get_random_bytes(p.c_str(), p.length());
+  bufferlist plaintext;
+  plaintext.append(p);
+
+  bufferlist cipher;
+  std::string error;
+  int r = key.encrypt(g_ceph_context, plaintext, cipher, &error);
+  ASSERT_EQ(r, 0);
+
+  unsigned char sched[CEPHX_AESNI_SCHED_SIZE];
+  cephx_aesni_expand_key((const unsigned char *)k.c_str(), sched);
+  unsigned char block[16];
+  cephx_aesni_cbc_first_block(sched, (const unsigned char *)CEPH_AES_IV,
+			      (const unsigned char *)p.c_str(), block);
+
+  char first[16];
+  ASSERT_GE(cipher.length(), sizeof(first));
+  cipher.copy(0, sizeof(first), &first[0]);
+  ASSERT_EQ(0, memcmp(first, block, sizeof(block)));
+}
+
 TEST(AES, Decrypt) {
   CryptoHandler *h = g_ceph_context->get_crypto_handler(CEPH_CRYPTO_AES);
   char secret_s[] = {
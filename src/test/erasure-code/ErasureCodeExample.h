@@ -138,6 +138,29 @@ public:
     return 0;
   }
 
+  virtual int encode_scatter(const set<int> &want_to_encode,
+			     const bufferlist &in,
+			     map<int, bufferlist> *encoded) {
+    //
+    // copy-through implementation for the sake of the example: encode
+    // as usual, then fill the coding buffers provided by the caller
+    //
+    map<int, bufferlist> tmp;
+    int r = encode(want_to_encode, in, &tmp);
+    if (r)
+      return r;
+    for (map<int, bufferlist>::iterator i = tmp.begin();
+	 i != tmp.end();
+	 ++i) {
+      map<int, bufferlist>::iterator j = encoded->find(i->first);
+      if (j == encoded->end())
+	(*encoded)[i->first] = i->second;
+      else
+	i->second.copy(0, i->second.length(), j->second.c_str());
+    }
+    return 0;
+  }
+
   virtual int encode_chunks(const set<int> &want_to_encode,
 			    map<int, bufferlist> *encoded) {
     assert(0);
@@ -16,6 +16,7 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "global/global_init.h"
 #include "erasure-code/ErasureCode.h"
@@ -153,6 +154,45 @@ TEST(ErasureCodeTest, encode_misaligned_non_contiguous)
   }
 }
 
+/*
+ * encode_scatter must slice the data chunks out of an aligned,
+ * contiguous input without copying them, and hand the caller provided
+ * coding buffer to encode_chunks so that it is written in place.
+ */
+TEST(ErasureCodeTest, encode_scatter)
+{
+  int k = 3;
+  int m = 1;
+  unsigned chunk_size = ErasureCode::SIMD_ALIGN * 7;
+  ErasureCodeTest erasure_code(k, m, chunk_size);
+
+  set<int> want_to_encode;
+  for (unsigned int i = 0; i < erasure_code.get_chunk_count(); i++)
+    want_to_encode.insert(i);
+  bufferptr ptr(buffer::create_aligned(chunk_size * k,
+				       ErasureCode::SIMD_ALIGN));
+  memset(ptr.c_str(), 'X', chunk_size * k);
+  bufferlist in;
+  in.append(ptr);
+
+  // the coding buffer belongs to the caller, as the data segment of an
+  // outgoing message would
+  bufferptr coding(buffer::create_aligned(chunk_size,
+					  ErasureCode::SIMD_ALIGN));
+  map<int, bufferlist> encoded;
+  encoded[k].push_back(coding);
+
+  ASSERT_EQ(0, erasure_code.encode_scatter(want_to_encode, in, &encoded));
+  // data chunks are zero copy slices of the input
+  for (int i = 0; i < k; i++) {
+    ASSERT_TRUE(encoded[i].is_aligned(ErasureCode::SIMD_ALIGN));
+    ASSERT_EQ(in.c_str() + i * chunk_size, encoded[i].c_str());
+  }
+  // the coding chunk reached encode_chunks in place
+  ASSERT_EQ(coding.c_str(),
+	    erasure_code.encode_chunks_encoded[k].c_str());
+}
+
 int main(int argc, char **argv)
 {
   vector<const char*> args;
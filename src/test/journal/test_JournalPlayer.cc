@@ -63,6 +63,13 @@ public:
                                              max_fetch_bytes);
   }
 
+  journal::JournalMetadataPtr create_metadata(const std::string &oid,
+                                              uint64_t object_fetch_window) {
+    return RadosTestFixture::create_metadata(oid, "client", 0.1,
+                                             max_fetch_bytes,
+                                             object_fetch_window);
+  }
+
   int client_commit(const std::string &oid,
                     journal::JournalPlayer::ObjectSetPosition position) {
     return RadosTestFixture::client_commit(oid, "client", position);
@@ -626,6 +633,47 @@ TYPED_TEST(TestJournalPlayer, PrefetchSkippedObject) {
   ASSERT_EQ(126U, last_tid);
 }
 
+TYPED_TEST(TestJournalPlayer, PrefetchWindow) {
+  std::string oid = this->get_temp_oid();
+
+  cls::journal::ObjectSetPosition commit_position;
+
+  ASSERT_EQ(0, this->create(oid));
+  ASSERT_EQ(0, this->client_register(oid));
+  ASSERT_EQ(0, this->client_commit(oid, commit_position));
+
+  journal::JournalMetadataPtr metadata = this->create_metadata(oid, 2);
+  ASSERT_EQ(0, this->init_metadata(metadata));
+  ASSERT_EQ(0, metadata->set_active_set(3));
+
+  journal::JournalPlayer *player = this->create_player(oid, metadata);
+  BOOST_SCOPE_EXIT_ALL( (player) ) {
+    C_SaferCond unwatch_ctx;
+    player->shut_down(&unwatch_ctx);
+    ASSERT_EQ(0, unwatch_ctx.wait());
+  };
+
+  for (uint64_t i = 0; i < 8; ++i) {
+    ASSERT_EQ(0, this->write_entry(oid, i, 234, 120 + i));
+  }
+
+  player->prefetch();
+
+  Entries entries;
+  ASSERT_TRUE(this->wait_for_entries(player, 8, &entries));
+  ASSERT_TRUE(this->wait_for_complete(player));
+
+  Entries expected_entries;
+  for (uint64_t i = 0; i < 8; ++i) {
+    expected_entries.push_back(this->create_entry(234, 120 + i));
+  }
+  ASSERT_EQ(expected_entries, entries);
+
+  uint64_t last_tid;
+  ASSERT_TRUE(metadata->get_last_allocated_entry_tid(234, &last_tid));
+  ASSERT_EQ(127U, last_tid);
+}
+
 TYPED_TEST(TestJournalPlayer, ImbalancedJournal) {
   std::string oid = this->get_temp_oid();
 
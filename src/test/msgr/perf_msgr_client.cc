@@ -1,4 +1,4 @@
-// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*- 
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 /*
  * Ceph - scalable distributed file system
@@ -16,8 +16,10 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <string>
 #include <unistd.h>
+#include <sys/resource.h>
 #include <iostream>
 
 using namespace std;
@@ -30,6 +32,55 @@ using namespace std;
 #include "msg/Messenger.h"
 #include "messages/MOSDOp.h"
 
+// power-of-two microsecond latency buckets
+#define LAT_BUCKETS 64
+
+struct LatencyHist {
+  uint64_t buckets[LAT_BUCKETS];
+  uint64_t count;
+  double sum;
+  double max;
+
+  LatencyHist() : count(0), sum(0), max(0) {
+    memset(buckets, 0, sizeof(buckets));
+  }
+  void add(double usec) {
+    count++;
+    sum += usec;
+    if (usec > max)
+      max = usec;
+    uint64_t v = (uint64_t)usec;
+    int i = 0;
+    while (v > 1 && i < LAT_BUCKETS - 1) {
+      v >>= 1;
+      i++;
+    }
+    buckets[i]++;
+  }
+  void merge(const LatencyHist& o) {
+    count += o.count;
+    sum += o.sum;
+    if (o.max > max)
+      max = o.max;
+    for (int i = 0; i < LAT_BUCKETS; ++i)
+      buckets[i] += o.buckets[i];
+  }
+  double percentile(double p) const {
+    if (!count)
+      return 0;
+    uint64_t target = (uint64_t)(count * p / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < LAT_BUCKETS; i++) {
+      seen += buckets[i];
+      if (seen > target) {
+	// middle of the [2^i, 2^(i+1)) usec bucket
+	return (double)(3ull << i) / 2.0;
+      }
+    }
+    return max;
+  }
+};
+
 class MessengerClient {
   class ClientThread;
   class ClientDispatcher : public Dispatcher {
@@ -70,7 +121,8 @@ class MessengerClient {
     object_t oid;
     object_locator_t oloc;
     pg_t pgid;
-    int msg_len;
+    int msg_len_min;
+    int msg_len_max;
     bufferlist data;
     int ops;
     ClientDispatcher dispatcher;
@@ -79,24 +131,39 @@ class MessengerClient {
     Mutex lock;
     Cond cond;
     uint64_t inflight;
+    // tid-indexed send timestamps; replies echo the request tid, so the
+    // dispatcher can compute a per-message round trip
+    vector<uint64_t> send_cycles;
+    LatencyHist hist;
+    uint64_t bytes_sent;
 
-    ClientThread(Messenger *m, int c, ConnectionRef con, int len, int ops, int think_time_us):
-        msgr(m), concurrent(c), conn(con), client_inc(0), oid("object-name"), oloc(1, 1), msg_len(len), ops(ops),
-        dispatcher(think_time_us, this), lock("MessengerBenchmark::ClientThread::lock") {
+    ClientThread(Messenger *m, int c, ConnectionRef con, int len_min, int len_max, int ops, int think_time_us):
+        msgr(m), concurrent(c), conn(con), client_inc(0), oid("object-name"), oloc(1, 1),
+        msg_len_min(len_min), msg_len_max(len_max), ops(ops),
+        dispatcher(think_time_us, this), lock("MessengerBenchmark::ClientThread::lock"),
+        inflight(0), send_cycles(ops), bytes_sent(0) {
       m->add_dispatcher_head(&dispatcher);
-      bufferptr ptr(msg_len);
-      memset(ptr.c_str(), 0, msg_len);
+      bufferptr ptr(msg_len_max);
+      memset(ptr.c_str(), 0, msg_len_max);
       data.append(ptr);
     }
     void *entry() {
+      unsigned seed = time(NULL) + (unsigned)(uint64_t)this;
       lock.Lock();
       for (int i = 0; i < ops; ++i) {
         if (inflight > uint64_t(concurrent)) {
           cond.Wait(lock);
         }
-        MOSDOp *m = new MOSDOp(client_inc.read(), 0, oid, oloc, pgid, 0, 0, 0);
-        m->write(0, msg_len, data);
+        int len = msg_len_min;
+        if (msg_len_max > msg_len_min)
+          len += rand_r(&seed) % (msg_len_max - msg_len_min + 1);
+        MOSDOp *m = new MOSDOp(client_inc.read(), i, oid, oloc, pgid, 0, 0, 0);
+        bufferlist msg_data;
+        msg_data.substr_of(data, 0, len);
+        m->write(0, len, msg_data);
+        bytes_sent += len;
         inflight++;
+        send_cycles[i] = Cycles::rdtsc();
         conn->send_message(m);
         //cerr << __func__ << " send m=" << m << std::endl;
       }
@@ -124,7 +191,7 @@ class MessengerClient {
       msgrs[i]->wait();
     }
   }
-  void ready(int c, int jobs, int ops, int msg_len) {
+  void ready(int c, int jobs, int ops, int len_min, int len_max) {
     entity_addr_t addr;
     addr.parse(serveraddr.c_str());
     addr.set_nonce(0);
@@ -133,7 +200,7 @@ class MessengerClient {
       msgr->set_default_policy(Messenger::Policy::lossless_client(0, 0));
       entity_inst_t inst(entity_name_t::OSD(0), addr);
       ConnectionRef conn = msgr->get_connection(inst);
-      ClientThread *t = new ClientThread(msgr, c, conn, msg_len, ops, think_time_us);
+      ClientThread *t = new ClientThread(msgr, c, conn, len_min, len_max, ops, think_time_us);
       msgrs.push_back(msgr);
       clients.push_back(t);
       msgr->start();
@@ -146,12 +213,22 @@ class MessengerClient {
     for (uint64_t i = 0; i < msgrs.size(); ++i)
       msgrs[i]->wait();
   }
+  void collect(LatencyHist *hist, uint64_t *bytes) {
+    for (uint64_t i = 0; i < clients.size(); ++i) {
+      hist->merge(clients[i]->hist);
+      *bytes += clients[i]->bytes_sent;
+    }
+  }
 };
 
 void MessengerClient::ClientDispatcher::ms_fast_dispatch(Message *m) {
+  uint64_t now = Cycles::rdtsc();
+  uint64_t tid = m->get_tid();
   usleep(think_time);
   m->put();
   Mutex::Locker l(thread->lock);
+  if (tid < thread->send_cycles.size())
+    thread->hist.add(Cycles::to_microseconds(now - thread->send_cycles[tid]));
   thread->inflight--;
   thread->cond.Signal();
 }
@@ -160,11 +237,19 @@ void MessengerClient::ClientDispatcher::ms_fast_dispatch(Message *m) {
 void usage(const string &name) {
   cerr << "Usage: " << name << " [server ip:port] [numjobs] [concurrency] [ios] [thinktime us] [msg length]" << std::endl;
   cerr << "       [server ip:port]: connect to the ip:port pair" << std::endl;
-  cerr << "       [numjobs]: how much client threads spawned and do benchmark" << std::endl;
+  cerr << "       [numjobs]: how much client threads spawned and do benchmark;" << std::endl;
+  cerr << "                  a comma-separated list (1,4,16) sweeps the connection count" << std::endl;
   cerr << "       [concurrency]: the max inflight messages(like iodepth in fio)" << std::endl;
   cerr << "       [ios]: how much messages sent for each client" << std::endl;
   cerr << "       [thinktime]: sleep time when do fast dispatching(match client logic)" << std::endl;
-  cerr << "       [msg length]: message data bytes" << std::endl;
+  cerr << "       [msg length]: message data bytes; MIN-MAX picks a uniform random" << std::endl;
+  cerr << "                     length per message" << std::endl;
+  cerr << "       run with --ms-type simple or --ms-type async to compare transports" << std::endl;
+}
+
+static double rusage_usec(const struct rusage& ru) {
+  return (double)ru.ru_utime.tv_sec * 1000000.0 + ru.ru_utime.tv_usec +
+         (double)ru.ru_stime.tv_sec * 1000000.0 + ru.ru_stime.tv_usec;
 }
 
 int main(int argc, char **argv)
@@ -181,26 +266,78 @@ int main(int argc, char **argv)
     return 1;
   }
 
-  int numjobs = atoi(args[1]);
+  vector<int> jobs_sweep;
+  {
+    string jobs_spec(args[1]);
+    size_t off = 0;
+    while (off < jobs_spec.size()) {
+      size_t comma = jobs_spec.find(',', off);
+      if (comma == string::npos)
+        comma = jobs_spec.size();
+      jobs_sweep.push_back(atoi(jobs_spec.substr(off, comma - off).c_str()));
+      off = comma + 1;
+    }
+  }
   int concurrent = atoi(args[2]);
   int ios = atoi(args[3]);
   int think_time = atoi(args[4]);
-  int len = atoi(args[5]);
+  string len_spec(args[5]);
+  int len_min, len_max;
+  size_t dash = len_spec.find('-');
+  if (dash == string::npos) {
+    len_min = len_max = atoi(len_spec.c_str());
+  } else {
+    len_min = atoi(len_spec.substr(0, dash).c_str());
+    len_max = atoi(len_spec.substr(dash + 1).c_str());
+  }
+  if (len_min <= 0 || len_max < len_min || jobs_sweep.empty()) {
+    usage(argv[0]);
+    return 1;
+  }
 
   cerr << " using ms-type " << g_ceph_context->_conf->ms_type << std::endl;
   cerr << "       server ip:port " << args[0] << std::endl;
-  cerr << "       numjobs " << numjobs << std::endl;
+  cerr << "       numjobs " << args[1] << std::endl;
   cerr << "       concurrency " << concurrent << std::endl;
   cerr << "       ios " << ios << std::endl;
   cerr << "       thinktime(us) " << think_time << std::endl;
-  cerr << "       message data bytes " << len << std::endl;
-  MessengerClient client(g_ceph_context->_conf->ms_type, args[0], think_time);
-  client.ready(concurrent, numjobs, ios, len);
+  cerr << "       message data bytes " << len_min << "-" << len_max << std::endl;
+
   Cycles::init();
-  uint64_t start = Cycles::rdtsc();
-  client.start();
-  uint64_t stop = Cycles::rdtsc();
-  cerr << " Total op " << ios << " run time " << Cycles::to_microseconds(stop - start) << "us." << std::endl;
+  for (uint64_t j = 0; j < jobs_sweep.size(); ++j) {
+    int numjobs = jobs_sweep[j];
+    MessengerClient client(g_ceph_context->_conf->ms_type, args[0], think_time);
+    client.ready(concurrent, numjobs, ios, len_min, len_max);
+    struct rusage ru_start, ru_end;
+    getrusage(RUSAGE_SELF, &ru_start);
+    uint64_t start = Cycles::rdtsc();
+    client.start();
+    uint64_t stop = Cycles::rdtsc();
+    getrusage(RUSAGE_SELF, &ru_end);
+
+    LatencyHist hist;
+    uint64_t bytes = 0;
+    client.collect(&hist, &bytes);
+    double elapsed_us = Cycles::to_microseconds(stop - start);
+    uint64_t total_ops = (uint64_t)numjobs * ios;
+    cerr << " jobs " << numjobs
+         << " op " << total_ops
+         << " run time " << elapsed_us << "us"
+         << " iops " << (elapsed_us ? total_ops * 1000000.0 / elapsed_us : 0)
+         << " bw " << (elapsed_us ? bytes / elapsed_us : 0) << "MB/s"
+         << std::endl;
+    cerr << "     latency(us) avg " << (hist.count ? hist.sum / hist.count : 0)
+         << " p50 " << hist.percentile(50)
+         << " p90 " << hist.percentile(90)
+         << " p99 " << hist.percentile(99)
+         << " p99.9 " << hist.percentile(99.9)
+         << " max " << hist.max
+         << std::endl;
+    cerr << "     cpu(us)/msg "
+         << (total_ops ?
+             (rusage_usec(ru_end) - rusage_usec(ru_start)) / total_ops : 0)
+         << std::endl;
+  }
 
   return 0;
 }
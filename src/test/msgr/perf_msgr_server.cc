@@ -32,13 +32,16 @@ using namespace std;
 
 class ServerDispatcher : public Dispatcher {
   uint64_t think_time;
+  bufferlist reply_data;
   ThreadPool op_tp;
   class OpWQ : public ThreadPool::WorkQueue<Message> {
     list<Message*> messages;
+    bufferlist *reply_data;
 
    public:
-    OpWQ(time_t timeout, time_t suicide_timeout, ThreadPool *tp)
-      : ThreadPool::WorkQueue<Message>("ServerDispatcher::OpWQ", timeout, suicide_timeout, tp) {}
+    OpWQ(time_t timeout, time_t suicide_timeout, ThreadPool *tp, bufferlist *rd)
+      : ThreadPool::WorkQueue<Message>("ServerDispatcher::OpWQ", timeout, suicide_timeout, tp),
+	reply_data(rd) {}
 
     bool _enqueue(Message *m) {
       messages.push_back(m);
@@ -60,6 +63,10 @@ class ServerDispatcher : public Dispatcher {
     void _process(Message *m, ThreadPool::TPHandle &handle) override {
       MOSDOp *osd_op = static_cast<MOSDOp*>(m);
       MOSDOpReply *reply = new MOSDOpReply(osd_op, 0, 0, 0, false);
+      // push bytes in the reverse direction too, so the wire carries
+      // simultaneous bidirectional load
+      if (reply_data->length())
+	reply->set_data(*reply_data);
       m->get_connection()->send_message(reply);
       m->put();
     }
@@ -70,9 +77,14 @@ class ServerDispatcher : public Dispatcher {
   } op_wq;
 
  public:
-  ServerDispatcher(int threads, uint64_t delay): Dispatcher(g_ceph_context), think_time(delay),
+  ServerDispatcher(int threads, uint64_t delay, int reply_len): Dispatcher(g_ceph_context), think_time(delay),
     op_tp(g_ceph_context, "ServerDispatcher::op_tp", "tp_serv_disp", threads, "serverdispatcher_op_threads"),
-    op_wq(30, 30, &op_tp) {
+    op_wq(30, 30, &op_tp, &reply_data) {
+    if (reply_len > 0) {
+      bufferptr ptr(reply_len);
+      memset(ptr.c_str(), 0, reply_len);
+      reply_data.append(ptr);
+    }
     op_tp.start();
   }
   ~ServerDispatcher() {
@@ -113,8 +125,8 @@ class MessengerServer {
   ServerDispatcher dispatcher;
 
  public:
-  MessengerServer(string t, string addr, int threads, int delay):
-      msgr(NULL), type(t), bindaddr(addr), dispatcher(threads, delay) {
+  MessengerServer(string t, string addr, int threads, int delay, int reply_len):
+      msgr(NULL), type(t), bindaddr(addr), dispatcher(threads, delay, reply_len) {
     msgr = Messenger::create(g_ceph_context, type, entity_name_t::OSD(0), "server", 0);
     msgr->set_default_policy(Messenger::Policy::stateless_server(0, 0));
   }
@@ -133,10 +145,12 @@ class MessengerServer {
 };
 
 void usage(const string &name) {
-  cerr << "Usage: " << name << " [bind ip:port] [server worker threads] [thinktime us]" << std::endl;
+  cerr << "Usage: " << name << " [bind ip:port] [server worker threads] [thinktime us] [reply data bytes]" << std::endl;
   cerr << "       [bind ip:port]: The ip:port pair to bind, client need to specify this pair to connect" << std::endl;
   cerr << "       [server worker threads]: threads will process incoming messages and reply(matching pg threads)" << std::endl;
   cerr << "       [thinktime]: sleep time when do dispatching(match fast dispatch logic in OSD.cc)" << std::endl;
+  cerr << "       [reply data bytes]: optional payload attached to every reply, for" << std::endl;
+  cerr << "                           simultaneous bidirectional load (default 0)" << std::endl;
 }
 
 int main(int argc, char **argv)
@@ -155,6 +169,7 @@ int main(int argc, char **argv)
 
   int worker_threads = atoi(args[1]);
   int think_time = atoi(args[2]);
+  int reply_len = args.size() > 3 ? atoi(args[3]) : 0;
   cerr << " This tool won't handle connection error alike things, " << std::endl;
   cerr << "please ensure the proper network environment to test." << std::endl;
   cerr << " Or ctrl+c when meeting error and restart tests" << std::endl;
@@ -162,8 +177,9 @@ int main(int argc, char **argv)
   cerr << "       bind ip:port " << args[0] << std::endl;
   cerr << "       worker threads " << worker_threads << std::endl;
   cerr << "       thinktime(us) " << think_time << std::endl;
+  cerr << "       reply data bytes " << reply_len << std::endl;
 
-  MessengerServer server(g_ceph_context->_conf->ms_type, args[0], worker_threads, think_time);
+  MessengerServer server(g_ceph_context->_conf->ms_type, args[0], worker_threads, think_time, reply_len);
   server.start();
 
   return 0;
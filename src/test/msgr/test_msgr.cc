@@ -746,6 +746,60 @@ TEST_P(MessengerTest, MessageTest) {
   client_msgr->wait();
 }
 
+TEST_P(MessengerTest, DataCompressionTest) {
+  g_ceph_context->_conf->set_val("ms_compress_data", "true");
+  g_ceph_context->_conf->set_val("ms_compress_data_min_size", "1024");
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  FakeDispatcher cli_dispatcher(false), srv_dispatcher(true);
+  entity_addr_t bind_addr;
+  bind_addr.parse("127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  ConnectionRef conn = client_msgr->get_connection(server_msgr->get_myinst());
+
+  // 1. highly compressible data above the threshold
+  {
+    bufferlist bl;
+    string s("abcdefghijklmnopqrstuvwxyz");
+    for (int i = 0; i < 1024*30; i++)
+      bl.append(s);
+    MPing *m = new MPing();
+    m->set_data(bl);
+    conn->send_message(m);
+    Mutex::Locker l(cli_dispatcher.lock);
+    while (!cli_dispatcher.got_new)
+      cli_dispatcher.cond.Wait(cli_dispatcher.lock);
+    cli_dispatcher.got_new = false;
+  }
+
+  // 2. data below the threshold goes out raw
+  {
+    bufferlist bl;
+    bl.append("ping");
+    MPing *m = new MPing();
+    m->set_data(bl);
+    conn->send_message(m);
+    Mutex::Locker l(cli_dispatcher.lock);
+    while (!cli_dispatcher.got_new)
+      cli_dispatcher.cond.Wait(cli_dispatcher.lock);
+    cli_dispatcher.got_new = false;
+  }
+
+  server_msgr->shutdown();
+  client_msgr->shutdown();
+  server_msgr->wait();
+  client_msgr->wait();
+
+  g_ceph_context->_conf->set_val("ms_compress_data", "false");
+  g_ceph_context->_conf->set_val("ms_compress_data_min_size", "4096");
+  g_ceph_context->_conf->apply_changes(NULL);
+}
+
 
 class SyntheticWorkload;
 
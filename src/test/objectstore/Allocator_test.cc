@@ -190,7 +190,7 @@ TEST_P(AllocTest, test_alloc_failure)
 INSTANTIATE_TEST_CASE_P(
   Allocator,
   AllocTest,
-  ::testing::Values("stupid", "bitmap"));
+  ::testing::Values("stupid", "bitmap", "sharded"));
 
 #else
 
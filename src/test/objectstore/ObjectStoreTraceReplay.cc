@@ -0,0 +1,379 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Replay a binary transaction trace captured from a live osd (see
+ * osd_objectstore_trace_file) against an ObjectStore instance, and
+ * report per-op-type commit latency distributions.  This lets an
+ * objectstore change be A/B tested against a production workload shape
+ * instead of a synthetic one.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+#include "common/ceph_argparse.h"
+#include "common/debug.h"
+#include "common/errno.h"
+#include "common/Cond.h"
+#include "global/global_init.h"
+#include "os/ObjectStore.h"
+
+// power-of-two microsecond latency buckets
+#define LAT_BUCKETS 64
+
+struct OpTypeStats {
+  uint64_t count;
+  double total;
+  double max;
+  uint64_t buckets[LAT_BUCKETS];
+
+  OpTypeStats() : count(0), total(0), max(0) {
+    memset(buckets, 0, sizeof(buckets));
+  }
+
+  void add(double lat) {
+    count++;
+    total += lat;
+    if (lat > max)
+      max = lat;
+    uint64_t usec = (uint64_t)(lat * 1000000.0);
+    int i = 0;
+    while (usec > 1 && i < LAT_BUCKETS - 1) {
+      usec >>= 1;
+      i++;
+    }
+    buckets[i]++;
+  }
+
+  double percentile(double p) const {
+    if (!count)
+      return 0;
+    uint64_t target = (uint64_t)(count * p / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < LAT_BUCKETS; i++) {
+      seen += buckets[i];
+      if (seen > target) {
+	// middle of the [2^i, 2^(i+1)) usec bucket
+	return (double)(3ull << i) / 2.0 / 1000000.0;
+      }
+    }
+    return max;
+  }
+};
+
+struct ReplayStats {
+  Mutex lock;
+  Cond cond;
+  uint64_t inflight;
+  map<string, OpTypeStats> per_type;
+  OpTypeStats all;
+
+  ReplayStats() : lock("ReplayStats::lock"), inflight(0) {}
+};
+
+class C_ReplayCommit : public Context {
+  ReplayStats *stats;
+  string type;
+  utime_t start;
+ public:
+  C_ReplayCommit(ReplayStats *s, const string& t, utime_t st)
+    : stats(s), type(t), start(st) {}
+  void finish(int r) {
+    double lat = (double)(ceph_clock_now(g_ceph_context) - start);
+    Mutex::Locker l(stats->lock);
+    stats->per_type[type].add(lat);
+    stats->all.add(lat);
+    stats->inflight--;
+    stats->cond.Signal();
+  }
+};
+
+static const char *op_type_name(int op)
+{
+  switch (op) {
+  case ObjectStore::Transaction::OP_NOP: return "nop";
+  case ObjectStore::Transaction::OP_TOUCH: return "touch";
+  case ObjectStore::Transaction::OP_WRITE: return "write";
+  case ObjectStore::Transaction::OP_ZERO: return "zero";
+  case ObjectStore::Transaction::OP_TRUNCATE: return "truncate";
+  case ObjectStore::Transaction::OP_REMOVE: return "remove";
+  case ObjectStore::Transaction::OP_SETATTR: return "setattr";
+  case ObjectStore::Transaction::OP_SETATTRS: return "setattrs";
+  case ObjectStore::Transaction::OP_RMATTR: return "rmattr";
+  case ObjectStore::Transaction::OP_RMATTRS: return "rmattrs";
+  case ObjectStore::Transaction::OP_CLONE: return "clone";
+  case ObjectStore::Transaction::OP_CLONERANGE:
+  case ObjectStore::Transaction::OP_CLONERANGE2: return "clonerange";
+  case ObjectStore::Transaction::OP_MKCOLL: return "mkcoll";
+  case ObjectStore::Transaction::OP_RMCOLL: return "rmcoll";
+  case ObjectStore::Transaction::OP_OMAP_CLEAR: return "omap_clear";
+  case ObjectStore::Transaction::OP_OMAP_SETKEYS: return "omap_setkeys";
+  case ObjectStore::Transaction::OP_OMAP_RMKEYS: return "omap_rmkeys";
+  case ObjectStore::Transaction::OP_OMAP_RMKEYRANGE: return "omap_rmkeyrange";
+  case ObjectStore::Transaction::OP_OMAP_SETHEADER: return "omap_setheader";
+  case ObjectStore::Transaction::OP_SPLIT_COLLECTION:
+  case ObjectStore::Transaction::OP_SPLIT_COLLECTION2: return "split_coll";
+  case ObjectStore::Transaction::OP_COLL_MOVE_RENAME: return "coll_move_rename";
+  case ObjectStore::Transaction::OP_SETALLOCHINT: return "setallochint";
+  default: return "other";
+  }
+}
+
+struct TraceRecord {
+  utime_t stamp;
+  string osr_name;
+  vector<ObjectStore::Transaction> tls;
+};
+
+static void usage(const string &name)
+{
+  cerr << "Usage: " << name
+       << " [--speedup N] [--max-inflight N] [--prepare-objects]"
+       << " <filestore|bluestore|...> <data-path> <journal-path> <trace-file>"
+       << std::endl;
+  cerr << "WARNING: mkfs is run on <data-path>; any existing store there is destroyed"
+       << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  double speedup = 1.0;
+  uint64_t max_inflight = 16;
+  bool prepare_objects = false;
+  string val;
+  for (vector<const char*>::iterator i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--speedup", (char*)NULL)) {
+      speedup = atof(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--max-inflight", (char*)NULL)) {
+      max_inflight = atoll(val.c_str());
+    } else if (ceph_argparse_flag(args, i, "--prepare-objects", (char*)NULL)) {
+      prepare_objects = true;
+    } else {
+      ++i;
+    }
+  }
+  if (args.size() < 4) {
+    usage(argv[0]);
+    return 1;
+  }
+  string type(args[0]);
+  string data_path(args[1]);
+  string journal_path(args[2]);
+  string trace_file(args[3]);
+
+  bufferlist tbl;
+  string error;
+  int r = tbl.read_file(trace_file.c_str(), &error);
+  if (r < 0) {
+    cerr << "unable to read trace " << trace_file << ": " << error << std::endl;
+    return 1;
+  }
+
+  // decode the whole trace up front so decode cost doesn't pollute the
+  // replayed timings
+  vector<TraceRecord> records;
+  try {
+    bufferlist::iterator p = tbl.begin();
+    while (!p.end()) {
+      records.push_back(TraceRecord());
+      TraceRecord &rec = records.back();
+      DECODE_START(1, p);
+      ::decode(rec.stamp, p);
+      ::decode(rec.osr_name, p);
+      ::decode(rec.tls, p);
+      DECODE_FINISH(p);
+    }
+  } catch (buffer::error &e) {
+    cerr << "corrupt trace " << trace_file << ": " << e.what() << std::endl;
+    return 1;
+  }
+  if (records.empty()) {
+    cerr << "trace " << trace_file << " is empty" << std::endl;
+    return 1;
+  }
+  cout << records.size() << " records in trace, spanning "
+       << (double)(records.back().stamp - records.front().stamp)
+       << " seconds" << std::endl;
+
+  ObjectStore *store = ObjectStore::create(g_ceph_context, type,
+					   data_path, journal_path);
+  if (!store) {
+    cerr << "unable to create store of type " << type << std::endl;
+    return 1;
+  }
+  r = store->mkfs();
+  if (r < 0) {
+    cerr << "mkfs failed: " << cpp_strerror(r) << std::endl;
+    return 1;
+  }
+  r = store->mount();
+  if (r < 0) {
+    cerr << "mount failed: " << cpp_strerror(r) << std::endl;
+    return 1;
+  }
+
+  // a trace captured mid-life references collections (and objects) the
+  // osd created long before the capture started.  create the missing
+  // collections so the replay doesn't fault; optionally pre-touch every
+  // object too, for traces whose ops assume the objects already exist.
+  // each object is touched in the first collection its transaction
+  // names, which matches how the osd builds almost all transactions.
+  {
+    set<coll_t> colls;
+    map<coll_t, set<ghobject_t, ghobject_t::BitwiseComparator> > objects;
+    for (vector<TraceRecord>::iterator rp = records.begin();
+	 rp != records.end();
+	 ++rp) {
+      for (vector<ObjectStore::Transaction>::iterator tp = rp->tls.begin();
+	   tp != rp->tls.end();
+	   ++tp) {
+	ObjectStore::Transaction::iterator i = tp->begin();
+	if (i.colls.empty())
+	  continue;
+	colls.insert(i.colls.begin(), i.colls.end());
+	if (prepare_objects)
+	  objects[i.colls.front()].insert(i.objects.begin(), i.objects.end());
+      }
+    }
+    ObjectStore::Sequencer prep_osr("tracereplay::prepare");
+    for (set<coll_t>::iterator cp = colls.begin(); cp != colls.end(); ++cp) {
+      if (store->collection_exists(*cp))
+	continue;
+      ObjectStore::Transaction t;
+      t.create_collection(*cp, 0);
+      store->apply_transaction(&prep_osr, std::move(t));
+    }
+    if (prepare_objects) {
+      for (map<coll_t, set<ghobject_t, ghobject_t::BitwiseComparator> >::iterator cp = objects.begin();
+	   cp != objects.end();
+	   ++cp) {
+	ObjectStore::Transaction t;
+	unsigned n = 0;
+	for (set<ghobject_t, ghobject_t::BitwiseComparator>::iterator op = cp->second.begin();
+	     op != cp->second.end();
+	     ++op) {
+	  t.touch(cp->first, *op);
+	  if (++n == 1000) {
+	    store->apply_transaction(&prep_osr, std::move(t));
+	    t = ObjectStore::Transaction();
+	    n = 0;
+	  }
+	}
+	if (n)
+	  store->apply_transaction(&prep_osr, std::move(t));
+      }
+    }
+    prep_osr.flush();
+  }
+
+  ReplayStats stats;
+  map<string, ObjectStore::Sequencer*> sequencers;
+  utime_t trace_start = records.front().stamp;
+  utime_t replay_start = ceph_clock_now(g_ceph_context);
+
+  for (vector<TraceRecord>::iterator rp = records.begin();
+       rp != records.end();
+       ++rp) {
+    // pace the submission to the captured inter-arrival gaps, scaled by
+    // --speedup; 0 means submit as fast as the inflight cap allows
+    if (speedup > 0) {
+      double offset = (double)(rp->stamp - trace_start) / speedup;
+      while (true) {
+	double elapsed = (double)(ceph_clock_now(g_ceph_context) - replay_start);
+	if (elapsed >= offset)
+	  break;
+	usleep(MIN((uint64_t)((offset - elapsed) * 1000000.0), (uint64_t)100000));
+      }
+    }
+
+    {
+      Mutex::Locker l(stats.lock);
+      while (stats.inflight >= max_inflight)
+	stats.cond.Wait(stats.lock);
+      stats.inflight++;
+    }
+
+    ObjectStore::Sequencer *&osr = sequencers[rp->osr_name];
+    if (!osr)
+      osr = new ObjectStore::Sequencer(rp->osr_name);
+
+    // bucket the record by the lead op of its first transaction, which
+    // is how the osd-side work it came from is usually characterized
+    const char *type_name = "empty";
+    if (!rp->tls.empty()) {
+      ObjectStore::Transaction::iterator i = rp->tls.front().begin();
+      if (i.have_op())
+	type_name = op_type_name(i.decode_op()->op);
+    }
+
+    store->queue_transactions(osr, rp->tls, NULL,
+			      new C_ReplayCommit(&stats, type_name,
+						 ceph_clock_now(g_ceph_context)));
+  }
+
+  {
+    Mutex::Locker l(stats.lock);
+    while (stats.inflight > 0)
+      stats.cond.Wait(stats.lock);
+  }
+  utime_t replay_end = ceph_clock_now(g_ceph_context);
+
+  for (map<string, ObjectStore::Sequencer*>::iterator p = sequencers.begin();
+       p != sequencers.end();
+       ++p) {
+    p->second->flush();
+    delete p->second;
+  }
+  store->umount();
+  delete store;
+
+  double elapsed = (double)(replay_end - replay_start);
+  double captured = (double)(records.back().stamp - trace_start);
+  cout << "replayed " << records.size() << " records ("
+       << stats.all.count << " completions) in " << elapsed << " seconds; "
+       << "capture spanned " << captured << " seconds" << std::endl;
+  cout << "op type            count       avg(s)      p50(s)      p90(s)      p99(s)      max(s)" << std::endl;
+  for (map<string, OpTypeStats>::iterator p = stats.per_type.begin();
+       p != stats.per_type.end();
+       ++p) {
+    OpTypeStats &s = p->second;
+    printf("%-16s %8llu  %10.6f  %10.6f  %10.6f  %10.6f  %10.6f\n",
+	   p->first.c_str(), (unsigned long long)s.count,
+	   s.count ? s.total / s.count : 0.0,
+	   s.percentile(50), s.percentile(90), s.percentile(99), s.max);
+  }
+  OpTypeStats &s = stats.all;
+  printf("%-16s %8llu  %10.6f  %10.6f  %10.6f  %10.6f  %10.6f\n",
+	 "TOTAL", (unsigned long long)s.count,
+	 s.count ? s.total / s.count : 0.0,
+	 s.percentile(50), s.percentile(90), s.percentile(99), s.max);
+
+  return 0;
+}
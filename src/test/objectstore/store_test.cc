@@ -2566,6 +2566,21 @@ TEST_P(StoreTest, OmapSimple) {
     cout << "r: " << r << std::endl;
     ASSERT_EQ(r.size(), km.size());
   }
+  // test bulk range fetch
+  {
+    map<string,bufferlist> res;
+    bool more = true;
+    r = store->omap_get_range(cid, hoid, string(), 1, &res, &more);
+    ASSERT_EQ(r, 0);
+    ASSERT_EQ(res.size(), 1u);
+    ASSERT_EQ(res.begin()->first, string("bar"));
+    ASSERT_TRUE(more);
+    r = store->omap_get_range(cid, hoid, res.rbegin()->first, 10, &res, &more);
+    ASSERT_EQ(r, 0);
+    ASSERT_EQ(res.size(), km.size());
+    ASSERT_FALSE(more);
+    cout << "res: " << res << std::endl;
+  }
   {
     ObjectStore::Transaction t;
     t.remove(cid, hoid);
@@ -566,6 +566,45 @@ TEST(bluestore_blob_t, calc_csum)
   }
 }
 
+TEST(bluestore_blob_t, verify_csum_extents)
+{
+  bufferlist bl;
+  bl.append("asdfghjkqwertyuizxcvbnm,");
+  bufferlist f;
+  f.substr_of(bl, 0, 8);
+  bufferlist m;
+  m.substr_of(bl, 8, 8);
+  bufferlist e;
+  e.substr_of(bl, 16, 8);
+  bufferlist n;
+  n.append("12345678");
+
+  for (unsigned csum_type = 1;
+       csum_type < bluestore_blob_t::CSUM_MAX;
+       ++csum_type) {
+    cout << "csum_type " << bluestore_blob_t::get_csum_type_string(csum_type)
+	 << std::endl;
+
+    bluestore_blob_t b;
+    b.init_csum(csum_type, 3, 24);
+    b.calc_csum(0, bl);
+
+    int bad_off;
+    vector<std::pair<size_t, const bufferlist*>> ex;
+    ex.emplace_back(0, &f);
+    ex.emplace_back(16, &e);
+    ASSERT_EQ(0, b.verify_csum_extents(ex, &bad_off));
+    ASSERT_EQ(-1, bad_off);
+
+    ex.clear();
+    ex.emplace_back(0, &f);
+    ex.emplace_back(8, &n);
+    ex.emplace_back(16, &e);
+    ASSERT_EQ(-1, b.verify_csum_extents(ex, &bad_off));
+    ASSERT_EQ(8, bad_off);
+  }
+}
+
 TEST(bluestore_blob_t, csum_bench)
 {
   bufferlist bl;
@@ -732,6 +771,42 @@ TEST(bluestore_onode_t, has_any_lextents)
   ASSERT_FALSE(on.has_any_lextents(500, 1000));
 }
 
+TEST(bluestore_onode_t, lazy_extent_map_decode)
+{
+  bluestore_onode_t on;
+  on.size = 300;
+  on.extent_map[0] = bluestore_lextent_t(1, 0, 100);
+  on.extent_map[100] = bluestore_lextent_t(2, 0, 100);
+  bufferlist bl;
+  ::encode(on, bl);
+
+  bluestore_onode_t on2;
+  bufferlist::iterator p = bl.begin();
+  ::decode(on2, p);
+  // extents stay encoded until first access
+  ASSERT_EQ(300u, on2.size);
+  ASSERT_EQ(0u, on2.extent_map.size());
+  ASSERT_NE(0u, on2.extent_map_bl.length());
+
+  ASSERT_NE(on2.extent_map.end(), on2.find_lextent(100));
+  ASSERT_EQ(0u, on2.extent_map_bl.length());
+  ASSERT_EQ(2u, on2.extent_map.size());
+  ASSERT_EQ(1, on2.extent_map[0].blob);
+  ASSERT_EQ(2, on2.extent_map[100].blob);
+
+  // re-encoding a still-lazy onode preserves the extent map
+  bluestore_onode_t on3;
+  bufferlist::iterator q = bl.begin();
+  ::decode(on3, q);
+  bufferlist bl2;
+  ::encode(on3, bl2);
+  bluestore_onode_t on4;
+  bufferlist::iterator r = bl2.begin();
+  ::decode(on4, r);
+  ASSERT_NE(on4.extent_map.end(), on4.find_lextent(100));
+  ASSERT_EQ(2u, on4.extent_map.size());
+}
+
 TEST(bluestore_onode_t, compress_extent_map)
 {
   bluestore_onode_t on;
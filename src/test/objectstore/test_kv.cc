@@ -114,6 +114,33 @@ TEST_P(KVTest, OpenWriteRead) {
   fini();
 }
 
+TEST_P(KVTest, BatchedGet) {
+  ASSERT_EQ(0, db->create_and_open(cout));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist value;
+    value.append("value");
+    t->set("prefix", "key", value);
+    value.clear();
+    value.append("value3");
+    t->set("prefix", "key3", value);
+    db->submit_transaction_sync(t);
+
+    std::vector<string> keys = {"key", "key2", "key3"};
+    std::vector<bufferlist> values;
+    ASSERT_EQ(0, db->get("prefix", keys, &values));
+    ASSERT_EQ(values.size(), 3u);
+    ASSERT_EQ(values[0].length(), 5u);
+    (values[0].c_str())[values[0].length()] = 0x0;
+    ASSERT_EQ(std::string(values[0].c_str()), std::string("value"));
+    ASSERT_EQ(values[1].length(), 0u);  // missing key -> empty value
+    ASSERT_EQ(values[2].length(), 6u);
+    (values[2].c_str())[values[2].length()] = 0x0;
+    ASSERT_EQ(std::string(values[2].c_str()), std::string("value3"));
+  }
+  fini();
+}
+
 TEST_P(KVTest, PutReopen) {
   ASSERT_EQ(0, db->create_and_open(cout));
   {
@@ -6,6 +6,7 @@
 #include "global/global_init.h"
 #include "common/common_init.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace std;
@@ -185,6 +186,119 @@ TEST_F(OSDMapTest, MapFunctionsMatch) {
   EXPECT_EQ(acting_osds, acting_osds_two);
 }
 
+TEST_F(OSDMapTest, PGUpmapRespected) {
+  set_up_map();
+
+  pg_t rawpg(0, 0, -1);
+  pg_t pgid = osdmap.raw_pg_to_pg(rawpg);
+  vector<int> up_osds;
+  int up_primary;
+
+  osdmap.pg_to_raw_up(pgid, &up_osds, &up_primary);
+  vector<int> orig_up(up_osds);
+
+  // replace the last member with an osd outside the set
+  vector<int32_t> new_up(up_osds.begin(), up_osds.end());
+  for (int o = 0; o < (int)get_num_osds(); ++o) {
+    if (std::find(up_osds.begin(), up_osds.end(), o) == up_osds.end()) {
+      *new_up.rbegin() = o;
+      break;
+    }
+  }
+
+  OSDMap::Incremental upmap_inc(osdmap.get_epoch() + 1);
+  upmap_inc.new_pg_upmap[pgid] = new_up;
+  osdmap.apply_incremental(upmap_inc);
+
+  osdmap.pg_to_raw_up(pgid, &up_osds, &up_primary);
+  ASSERT_EQ(vector<int>(new_up.begin(), new_up.end()), up_osds);
+
+  // an empty vector removes the override
+  OSDMap::Incremental rm_inc(osdmap.get_epoch() + 1);
+  rm_inc.new_pg_upmap[pgid].clear();
+  osdmap.apply_incremental(rm_inc);
+
+  osdmap.pg_to_raw_up(pgid, &up_osds, &up_primary);
+  ASSERT_EQ(orig_up, up_osds);
+}
+
+TEST_F(OSDMapTest, CalcPGUpmaps) {
+  set_up_map();
+
+  OSDMap::Incremental pending_inc(osdmap.get_epoch() + 1);
+  pending_inc.fsid = osdmap.get_fsid();
+  set<int64_t> pools;
+  int n = osdmap.calc_pg_upmaps(g_ceph_context, 10, pools, &pending_inc);
+  ASSERT_LE(n, 10);
+  ASSERT_EQ((unsigned)n, pending_inc.new_pg_upmap.size());
+  if (n) {
+    osdmap.apply_incremental(pending_inc);
+    // overrides are honored by the mapping path
+    map<pg_t,vector<int32_t> >::const_iterator p =
+      osdmap.get_pg_upmap().begin();
+    vector<int> up;
+    int up_primary;
+    osdmap.pg_to_raw_up(p->first, &up, &up_primary);
+    ASSERT_EQ(vector<int>(p->second.begin(), p->second.end()), up);
+  }
+}
+
+TEST_F(OSDMapTest, MappingCache) {
+  set_up_map();
+
+  pg_t rawpg(0, 0, -1);
+  pg_t pgid = osdmap.raw_pg_to_pg(rawpg);
+  vector<int> up_osds, acting_osds;
+  int up_primary, acting_primary;
+
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+
+  // the second lookup is served from the cache and must match
+  vector<int> up_osds_two, acting_osds_two;
+  int up_primary_two, acting_primary_two;
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds_two, &up_primary_two,
+                              &acting_osds_two, &acting_primary_two);
+  ASSERT_EQ(up_osds, up_osds_two);
+  ASSERT_EQ(acting_osds, acting_osds_two);
+  ASSERT_EQ(up_primary, up_primary_two);
+  ASSERT_EQ(acting_primary, acting_primary_two);
+
+  uint64_t hits, misses;
+  osdmap.get_mapping_cache_stats(&hits, &misses);
+  ASSERT_GE(hits, 1u);
+  ASSERT_GE(misses, 1u);
+
+  // advancing the epoch starts a fresh cache
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  osdmap.apply_incremental(inc);
+  osdmap.get_mapping_cache_stats(&hits, &misses);
+  ASSERT_EQ(0u, hits);
+  ASSERT_EQ(0u, misses);
+}
+
+TEST_F(OSDMapTest, BatchRawUpMatches) {
+  set_up_map();
+
+  vector<pg_t> pgs;
+  for (unsigned ps = 0; ps < 16; ++ps)
+    pgs.push_back(osdmap.raw_pg_to_pg(pg_t(ps, 0, -1)));
+
+  vector<vector<int> > batch_ups;
+  vector<int> batch_primaries;
+  osdmap.pg_to_raw_up_batch(pgs, &batch_ups, &batch_primaries);
+  ASSERT_EQ(pgs.size(), batch_ups.size());
+  ASSERT_EQ(pgs.size(), batch_primaries.size());
+
+  for (unsigned i = 0; i < pgs.size(); ++i) {
+    vector<int> up;
+    int primary;
+    osdmap.pg_to_raw_up(pgs[i], &up, &primary);
+    ASSERT_EQ(up, batch_ups[i]);
+    ASSERT_EQ(primary, batch_primaries[i]);
+  }
+}
+
 /** This test must be removed or modified appropriately when we allow
  * other ways to specify a primary. */
 TEST_F(OSDMapTest, PrimaryIsFirst) {
@@ -228,6 +342,46 @@ TEST_F(OSDMapTest, PGTempRespected) {
   EXPECT_EQ(new_acting_osds, acting_osds);
 }
 
+TEST_F(OSDMapTest, DeepishCopySharesUntouchedSections) {
+  set_up_map();
+
+  pg_t rawpg(0, 0, -1);
+  pg_t pgid = osdmap.raw_pg_to_pg(rawpg);
+  vector<int> up_osds, acting_osds;
+  int up_primary, acting_primary;
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+
+  // the copy shares pg_temp/primary_temp/etc with the original until
+  // they are written
+  OSDMap next;
+  next.deepish_copy_from(osdmap);
+
+  // remap the pg on the copy via pg_temp and primary_temp
+  vector<int> new_acting_osds(acting_osds.rbegin(), acting_osds.rend());
+  OSDMap::Incremental pgtemp_map(next.get_epoch() + 1);
+  pgtemp_map.new_pg_temp[pgid] = new_acting_osds;
+  pgtemp_map.new_primary_temp[pgid] = new_acting_osds[0];
+  next.apply_incremental(pgtemp_map);
+  EXPECT_EQ(1u, next.get_num_pg_temp());
+
+  // the original must not see the remapping through the shared sections
+  EXPECT_EQ(0u, osdmap.get_num_pg_temp());
+  vector<int> acting_now;
+  int primary_now;
+  osdmap.pg_to_acting_osds(pgid, &acting_now, &primary_now);
+  EXPECT_EQ(acting_osds, acting_now);
+  EXPECT_EQ(acting_primary, primary_now);
+
+  // nor a primary affinity change made through the copy
+  OSDMap next2;
+  next2.deepish_copy_from(osdmap);
+  next2.set_primary_affinity(0, 0);
+  EXPECT_EQ(0u, next2.get_primary_affinity(0));
+  EXPECT_EQ((unsigned)CEPH_OSD_DEFAULT_PRIMARY_AFFINITY,
+	    osdmap.get_primary_affinity(0));
+}
+
 TEST_F(OSDMapTest, PrimaryTempRespected) {
   set_up_map();
 
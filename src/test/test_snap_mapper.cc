@@ -543,6 +543,50 @@ public:
     snap_to_hobject.erase(snap);
   }
 
+  void trim_snap_batched() {
+    Mutex::Locker l(lock);
+    if (snap_to_hobject.empty())
+      return;
+    map<snapid_t, set<hobject_t, hobject_t::BitwiseComparator> >::iterator snap =
+      rand_choose(snap_to_hobject);
+    set<hobject_t, hobject_t::BitwiseComparator> hobjects = snap->second;
+
+    vector<hobject_t> to_trim;
+    while (mapper->get_next_objects_to_trim(snap->first, 3, &to_trim) == 0) {
+      for (vector<hobject_t>::iterator i = to_trim.begin();
+	   i != to_trim.end();
+	   ++i) {
+	hobject_t &hoid = *i;
+	assert(!hoid.is_max());
+	assert(hobjects.count(hoid));
+	hobjects.erase(hoid);
+
+	map<hobject_t, set<snapid_t>, hobject_t::BitwiseComparator>::iterator j =
+	  hobject_to_snap.find(hoid);
+	assert(j->second.count(snap->first));
+	set<snapid_t> old_snaps(j->second);
+	j->second.erase(snap->first);
+
+	{
+	  PausyAsyncMap::Transaction t;
+	  mapper->update_snaps(
+	    hoid,
+	    j->second,
+	    &old_snaps,
+	    &t);
+	  driver->submit(&t);
+	}
+	if (j->second.empty()) {
+	  hobject_to_snap.erase(j);
+	}
+      }
+      to_trim.clear();
+    }
+    assert(hobjects.empty());
+
+    snap_to_hobject.erase(snap);
+  }
+
   void remove_oid() {
     Mutex::Locker l(lock);
     if (hobject_to_snap.empty())
@@ -620,7 +664,7 @@ protected:
     for (int i = 0; i < 5000; ++i) {
       if (!(i % 50))
 	std::cout << i << std::endl;
-      switch (rand() % 5) {
+      switch (rand() % 6) {
       case 0:
 	get_tester().create_snap();
 	break;
@@ -636,6 +680,9 @@ protected:
       case 4:
 	get_tester().remove_oid();
 	break;
+      case 5:
+	get_tester().trim_snap_batched();
+	break;
       }
     }
   }
@@ -648,6 +695,14 @@ TEST_F(SnapMapperTest, Simple) {
   get_tester().trim_snap();
 }
 
+TEST_F(SnapMapperTest, BatchedTrim) {
+  init(1);
+  get_tester().create_snap();
+  for (int i = 0; i < 10; ++i)
+    get_tester().create_object();
+  get_tester().trim_snap_batched();
+}
+
 TEST_F(SnapMapperTest, More) {
   init(1);
   run();
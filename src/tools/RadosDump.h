@@ -400,6 +400,26 @@ class RadosDump
       hdr.encode(hbl);
       return hbl.write_fd(fd);
     }
+
+    // Same wire layout as write_section/write_simple, but appended to a
+    // bufferlist so sections can be assembled off the output fd (e.g. by
+    // parallel export workers) and streamed out later in one write.
+    template <typename T>
+      void append_section(sectiontype_t type, const T& obj, bufferlist& out) {
+        bufferlist bl;
+        obj.encode(bl);
+        header hdr(type, bl.length());
+        hdr.encode(out);
+        out.claim_append(bl);
+        footer ft;
+        ft.encode(out);
+      }
+
+    void append_simple(sectiontype_t type, bufferlist& out)
+    {
+      header hdr(type, 0);
+      hdr.encode(out);
+    }
 };
 
 #endif
@@ -19,6 +19,10 @@
 
 #include <stdlib.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "common/Formatter.h"
 #include "common/errno.h"
 #include "common/ceph_argparse.h"
@@ -521,17 +525,22 @@ void get_omap_batch(ObjectMap::ObjectMapIterator &iter, map<string, bufferlist>
   }
 }
 
-int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj)
+int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj,
+				 bufferlist *out)
 {
   struct stat st;
   mysize_t total;
-  footer ft;
 
   int ret = store->stat(cid, obj, &st);
   if (ret < 0)
     return ret;
 
-  cerr << "Read " << obj << std::endl;
+  {
+    // single insertion so parallel workers don't interleave the line
+    ostringstream ss;
+    ss << "Read " << obj << std::endl;
+    cerr << ss.str();
+  }
 
   total = st.st_size;
   if (debug)
@@ -555,9 +564,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
 
   // XXX: Should we be checking for WHITEOUT or LOST in objb.oi.flags and skip?
 
-  ret = write_section(TYPE_OBJECT_BEGIN, objb, file_fd);
-  if (ret < 0)
-    return ret;
+  append_section(TYPE_OBJECT_BEGIN, objb, *out);
 
   uint64_t offset = 0;
   bufferlist rawdatabl;
@@ -580,8 +587,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
     total -= ret;
     offset += ret;
 
-    ret = write_section(TYPE_DATA, dblock, file_fd);
-    if (ret) return ret;
+    append_section(TYPE_DATA, dblock, *out);
   }
 
   //Handle attrs for this object
@@ -589,9 +595,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   ret = store->getattrs(cid, obj, aset);
   if (ret) return ret;
   attr_section as(aset);
-  ret = write_section(TYPE_ATTRS, as, file_fd);
-  if (ret)
-    return ret;
+  append_section(TYPE_ATTRS, as, *out);
 
   if (debug) {
     cerr << "attrs size " << aset.size() << std::endl;
@@ -606,9 +610,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
 
   omap_hdr_section ohs(hdrbuf);
-  ret = write_section(TYPE_OMAP_HDR, ohs, file_fd);
-  if (ret)
-    return ret;
+  append_section(TYPE_OMAP_HDR, ohs, *out);
 
   ObjectMap::ObjectMapIterator iter = store->get_omap_iterator(cid, obj);
   if (!iter) {
@@ -618,51 +620,143 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
   iter->seek_to_first();
   int mapcount = 0;
-  map<string, bufferlist> out;
+  map<string, bufferlist> oset;
   while(iter->valid()) {
-    get_omap_batch(iter, out);
+    get_omap_batch(iter, oset);
 
-    if (out.empty()) break;
+    if (oset.empty()) break;
 
-    mapcount += out.size();
-    omap_section oms(out);
-    ret = write_section(TYPE_OMAP, oms, file_fd);
-    if (ret)
-      return ret;
+    mapcount += oset.size();
+    omap_section oms(oset);
+    append_section(TYPE_OMAP, oms, *out);
   }
   if (debug)
     cerr << "omap map size " << mapcount << std::endl;
 
-  ret = write_simple(TYPE_OBJECT_END, file_fd);
-  if (ret)
-    return ret;
+  append_simple(TYPE_OBJECT_END, *out);
 
   return 0;
 }
 
+// cap on serialized-but-not-yet-written data held by the parallel
+// export pipeline; one oversized object may still exceed it alone
+const uint64_t EXPORT_PIPELINE_BYTES = 256 * 1024 * 1024;
+
 int ObjectStoreTool::export_files(ObjectStore *store, coll_t coll)
 {
+  // list everything up front so workers can claim objects by index and
+  // the writer can stream them out in listing order
+  vector<ghobject_t> objects;
   ghobject_t next;
-
   while (!next.is_max()) {
-    vector<ghobject_t> objects;
+    vector<ghobject_t> more;
     int r = store->collection_list(coll, next, ghobject_t::get_max(), true, 300,
-      &objects, &next);
+      &more, &next);
     if (r < 0)
       return r;
-    for (vector<ghobject_t>::iterator i = objects.begin();
-	 i != objects.end();
+    for (vector<ghobject_t>::iterator i = more.begin();
+	 i != more.end();
 	 ++i) {
       assert(!i->hobj.is_meta());
       if (i->is_pgmeta() || i->hobj.is_temp()) {
 	continue;
       }
-      r = export_file(store, coll, *i);
+      objects.push_back(*i);
+    }
+  }
+
+  if (export_jobs <= 1 || objects.size() <= 1) {
+    // serial path
+    for (vector<ghobject_t>::iterator i = objects.begin();
+	 i != objects.end();
+	 ++i) {
+      bufferlist bl;
+      int r = export_file(store, coll, *i, &bl);
       if (r < 0)
-        return r;
+	return r;
+      if (!dry_run) {
+	r = bl.write_fd(file_fd);
+	if (r < 0)
+	  return r;
+      }
     }
+    return 0;
   }
-  return 0;
+
+  // parallel path: workers read and serialize objects concurrently,
+  // the writer streams completed objects in order under a byte budget
+  std::mutex lock;
+  std::condition_variable cond;
+  size_t next_claim = 0;
+  size_t next_write = 0;
+  uint64_t pending_bytes = 0;
+  map<size_t, bufferlist> ready;
+  int error = 0;
+
+  auto worker = [&]() {
+    while (true) {
+      size_t i;
+      {
+	std::unique_lock<std::mutex> l(lock);
+	while (!error && next_claim < objects.size() &&
+	       pending_bytes >= EXPORT_PIPELINE_BYTES)
+	  cond.wait(l);
+	if (error || next_claim >= objects.size())
+	  return;
+	i = next_claim++;
+      }
+      bufferlist bl;
+      int r = export_file(store, coll, objects[i], &bl);
+      std::lock_guard<std::mutex> l(lock);
+      if (r < 0 && !error)
+	error = r;
+      pending_bytes += bl.length();
+      ready[i].claim(bl);
+      cond.notify_all();
+    }
+  };
+
+  int jobs = std::min<size_t>(export_jobs, objects.size());
+  vector<std::thread> workers;
+  for (int i = 0; i < jobs; i++)
+    workers.push_back(std::thread(worker));
+
+  {
+    std::unique_lock<std::mutex> l(lock);
+    while (next_write < objects.size()) {
+      map<size_t, bufferlist>::iterator p = ready.find(next_write);
+      if (p == ready.end()) {
+	if (error)
+	  break;
+	cond.wait(l);
+	continue;
+      }
+      bufferlist bl;
+      bl.claim(p->second);
+      ready.erase(p);
+      next_write++;
+      l.unlock();
+      int r = 0;
+      if (!dry_run)
+	r = bl.write_fd(file_fd);
+      l.lock();
+      pending_bytes -= bl.length();
+      if (r < 0 && !error)
+	error = r;
+      cond.notify_all();
+      if (error)
+	break;
+    }
+    // make sure any worker parked on the byte budget sees the error
+    cond.notify_all();
+  }
+
+  for (vector<std::thread>::iterator t = workers.begin();
+       t != workers.end();
+       ++t)
+    t->join();
+
+  return error;
 }
 
 int set_inc_osdmap(ObjectStore *store, epoch_t e, bufferlist& bl, bool force,
@@ -2270,6 +2364,7 @@ int main(int argc, char **argv)
   bool force;
   Formatter *formatter;
   bool head;
+  int jobs;
 
   po::options_description desc("Allowed options");
   desc.add_options()
@@ -2300,6 +2395,8 @@ int main(int argc, char **argv)
     ("head", "Find head/snapdir when searching for objects by name")
     ("dry-run", "Don't modify the objectstore")
     ("namespace", po::value<string>(&argnspace), "Specify namespace when searching for objects")
+    ("jobs", po::value<int>(&jobs)->default_value(4),
+     "Number of concurrent object readers for export, 1 disables the pipeline")
     ;
 
   po::options_description positional("Positional options");
@@ -2444,7 +2541,7 @@ int main(int argc, char **argv)
     }
   }
 
-  ObjectStoreTool tool = ObjectStoreTool(file_fd, dry_run);
+  ObjectStoreTool tool = ObjectStoreTool(file_fd, dry_run, jobs);
 
   if (vm.count("file") && file_fd == fd_none && !dry_run) {
     cerr << "--file option only applies to import, export, "
@@ -19,9 +19,11 @@
 
 class ObjectStoreTool : public RadosDump
 {
+    int export_jobs;
+
   public:
-    ObjectStoreTool(int file_fd, bool dry_run)
-      : RadosDump(file_fd, dry_run)
+    ObjectStoreTool(int file_fd, bool dry_run, int export_jobs=1)
+      : RadosDump(file_fd, dry_run), export_jobs(export_jobs)
     {}
 
     int do_import(ObjectStore *store, OSDSuperblock& sb, bool force,
@@ -34,8 +36,10 @@ class ObjectStoreTool : public RadosDump
     int get_object(ObjectStore *store, coll_t coll,
 		   bufferlist &bl, OSDMap &curmap, bool *skipped_objects,
 		   ObjectStore::Sequencer &osr);
+    // serializes the object's sections into *out; the caller streams
+    // them to the fd in listing order
     int export_file(
-        ObjectStore *store, coll_t cid, ghobject_t &obj);
+        ObjectStore *store, coll_t cid, ghobject_t &obj, bufferlist *out);
     int export_files(ObjectStore *store, coll_t coll);
 };
 
@@ -17,6 +17,8 @@
 
 #include "common/ceph_argparse.h"
 #include "common/errno.h"
+#include "common/Clock.h"
+#include "common/Thread.h"
 
 #include "global/global_init.h"
 #include "osd/OSDMap.h"
@@ -32,6 +34,14 @@ void usage()
   cout << "   --test-map-pgs-dump [--pool <poolid>] map all pgs" << std::endl;
   cout << "   --mark-up-in            mark osds up and in (but do not persist)" << std::endl;
   cout << "   --clear-temp            clear pg_temp and primary_temp" << std::endl;
+  cout << "   --upmap [--pool <poolid>] [--upmap-max <max>]" << std::endl;
+  cout << "                           calculate pg upmap overrides to balance pg counts" << std::endl;
+  cout << "   --test-map-moves [--pool <poolid>] [--moves-domain <type>]" << std::endl;
+  cout << "                    [--moves-threads <n>] [--pg-bytes <bytes>]" << std::endl;
+  cout << "                           compare pg mappings before and after the other" << std::endl;
+  cout << "                           changes requested in this run and report movement" << std::endl;
+  cout << "                           per osd and per failure domain; the modified map" << std::endl;
+  cout << "                           is not written back" << std::endl;
   cout << "   --test-random           do random placements" << std::endl;
   cout << "   --test-map-pg <pgid>    map a pgid to osds" << std::endl;
   cout << "   --test-map-object <objectname> [--pool <poolid>] map an object to osds"
@@ -39,6 +49,28 @@ void usage()
   exit(1);
 }
 
+/*
+ * worker for --test-map-moves: maps a contiguous range of pgs against
+ * both maps with the batch crush path.
+ */
+struct MoveMapper : public Thread {
+  const OSDMap *before;
+  const OSDMap *after;
+  const vector<pg_t> *pgs;
+  unsigned begin, end;
+  vector<vector<int> > before_up, after_up;
+  vector<int> before_primary, after_primary;
+
+  MoveMapper() : before(NULL), after(NULL), pgs(NULL), begin(0), end(0) {}
+
+  void *entry() {
+    vector<pg_t> range(pgs->begin() + begin, pgs->begin() + end);
+    before->pg_to_raw_up_batch(range, &before_up, &before_primary);
+    after->pg_to_raw_up_batch(range, &after_up, &after_primary);
+    return NULL;
+  }
+};
+
 int main(int argc, const char **argv)
 {
   vector<const char*> args;
@@ -72,7 +104,13 @@ int main(int argc, const char **argv)
   bool clear_temp = false;
   bool test_map_pgs = false;
   bool test_map_pgs_dump = false;
+  bool test_map_moves = false;
+  std::string moves_domain = "host";
+  int moves_threads = 0;
+  int64_t pg_bytes = 0;
   bool test_random = false;
+  bool upmap = false;
+  int upmap_max = 100;
   int64_t pg_num = -1;
 
   std::string val;
@@ -106,10 +144,33 @@ int main(int argc, const char **argv)
       mark_up_in = true;
     } else if (ceph_argparse_flag(args, i, "--clear-temp", (char*)NULL)) {
       clear_temp = true;
+    } else if (ceph_argparse_flag(args, i, "--upmap", (char*)NULL)) {
+      upmap = true;
+    } else if (ceph_argparse_witharg(args, i, &upmap_max, err, "--upmap-max", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	exit(EXIT_FAILURE);
+      }
     } else if (ceph_argparse_flag(args, i, "--test-map-pgs", (char*)NULL)) {
       test_map_pgs = true;
     } else if (ceph_argparse_flag(args, i, "--test-map-pgs-dump", (char*)NULL)) {
       test_map_pgs_dump = true;
+    } else if (ceph_argparse_flag(args, i, "--test-map-moves", (char*)NULL)) {
+      test_map_moves = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--moves-domain", (char*)NULL)) {
+      moves_domain = val;
+    } else if (ceph_argparse_witharg(args, i, &moves_threads, err, "--moves-threads", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	exit(EXIT_FAILURE);
+      }
+    } else if (ceph_argparse_witharg(args, i, &val, err, "--pg-bytes", (char*)NULL)) {
+      string interr;
+      pg_bytes = strict_strtoll(val.c_str(), 10, &interr);
+      if (interr.length() > 0) {
+	cerr << "error parsing integer value " << interr << std::endl;
+	exit(EXIT_FAILURE);
+      }
     } else if (ceph_argparse_flag(args, i, "--test-random", (char*)NULL)) {
       test_random = true;
     } else if (ceph_argparse_flag(args, i, "--clobber", (char*)NULL)) {
@@ -230,6 +291,15 @@ int main(int argc, const char **argv)
     modified = true;
   }
 
+  OSDMap origmap;
+  if (test_map_moves) {
+    // take a fully deep snapshot; some of the modifiers below edit the
+    // crush map in place, which a deepish copy would share
+    bufferlist obl;
+    osdmap.encode(obl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
+    origmap.decode(obl);
+  }
+
   if (mark_up_in) {
     cout << "marking all OSDs up and in" << std::endl;
     int n = osdmap.get_max_osd();
@@ -243,6 +313,26 @@ int main(int argc, const char **argv)
     cout << "clearing pg/primary temp" << std::endl;
     osdmap.clear_temp();
   }
+  if (upmap) {
+    cout << "calculating pg upmap overrides (max " << upmap_max << ")"
+	 << std::endl;
+    set<int64_t> upmap_pools;
+    if (pool >= 0)
+      upmap_pools.insert(pool);
+    OSDMap::Incremental pending_inc(osdmap.get_epoch() + 1);
+    pending_inc.fsid = osdmap.get_fsid();
+    int n = osdmap.calc_pg_upmaps(g_ceph_context, upmap_max, upmap_pools,
+				  &pending_inc);
+    osdmap.apply_incremental(pending_inc);
+    for (map<pg_t,vector<int32_t> >::const_iterator p =
+	   pending_inc.new_pg_upmap.begin();
+	 p != pending_inc.new_pg_upmap.end();
+	 ++p)
+      cout << "pg_upmap " << p->first << " " << p->second << std::endl;
+    cout << "added " << n << " overrides" << std::endl;
+    if (n)
+      modified = true;
+  }
 
   if (!import_crush.empty()) {
     bufferlist cbl;
@@ -286,6 +376,170 @@ int main(int argc, const char **argv)
     cout << me << ": exported crush map to " << export_crush << std::endl;
   }  
 
+  if (test_map_moves) {
+    if (pool != -1 && !osdmap.have_pg_pool(pool)) {
+      cerr << "There is no pool " << pool << std::endl;
+      exit(1);
+    }
+
+    // collect the pgs that exist in both maps; pgs created by the
+    // change itself have nowhere to move from
+    vector<pg_t> pgs;
+    map<int64_t,bool> positional;  // compare ec mappings shard by shard
+    map<int64_t,pg_pool_t>& pools = osdmap.get_pools();
+    for (map<int64_t,pg_pool_t>::iterator p = pools.begin();
+	 p != pools.end(); ++p) {
+      if (pool != -1 && p->first != pool)
+	continue;
+      if (!origmap.have_pg_pool(p->first)) {
+	cout << "pool " << p->first
+	     << " does not exist in the original map, skipping" << std::endl;
+	continue;
+      }
+      unsigned pg_num = std::min(p->second.get_pg_num(),
+				 origmap.get_pg_pool(p->first)->get_pg_num());
+      positional[p->first] = p->second.is_erasure();
+      for (unsigned i = 0; i < pg_num; ++i)
+	pgs.push_back(pg_t(i, p->first));
+    }
+
+    utime_t start = ceph_clock_now(NULL);
+    unsigned nthread = moves_threads > 0 ? moves_threads : 0;
+    if (nthread == 0) {
+      long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+      nthread = nproc > 0 ? nproc : 1;
+    }
+    if (!pgs.empty() && nthread > pgs.size())
+      nthread = pgs.size();
+
+    vector<MoveMapper*> workers;
+    unsigned per = pgs.empty() ? 0 : (pgs.size() + nthread - 1) / nthread;
+    for (unsigned t = 0; t * per < pgs.size(); ++t) {
+      MoveMapper *w = new MoveMapper;
+      w->before = &origmap;
+      w->after = &osdmap;
+      w->pgs = &pgs;
+      w->begin = t * per;
+      w->end = std::min(pgs.size(), (size_t)(t + 1) * per);
+      w->create("movemapper");
+      workers.push_back(w);
+    }
+    for (unsigned t = 0; t < workers.size(); ++t)
+      workers[t]->join();
+    unsigned nworkers = workers.size();
+
+    int n = osdmap.get_max_osd();
+    vector<uint64_t> pg_in(n, 0), pg_out(n, 0);
+    uint64_t moved = 0;
+    for (unsigned t = 0; t < workers.size(); ++t) {
+      MoveMapper *w = workers[t];
+      for (unsigned i = 0; i < w->end - w->begin; ++i) {
+	const vector<int>& b = w->before_up[i];
+	const vector<int>& a = w->after_up[i];
+	bool changed = false;
+	if (positional[pgs[w->begin + i].pool()]) {
+	  unsigned len = std::max(a.size(), b.size());
+	  for (unsigned j = 0; j < len; ++j) {
+	    int ob = j < b.size() ? b[j] : CRUSH_ITEM_NONE;
+	    int na = j < a.size() ? a[j] : CRUSH_ITEM_NONE;
+	    if (ob == na)
+	      continue;
+	    changed = true;
+	    if (ob >= 0 && ob < n)
+	      pg_out[ob]++;
+	    if (na >= 0 && na < n)
+	      pg_in[na]++;
+	  }
+	} else {
+	  for (unsigned j = 0; j < b.size(); ++j)
+	    if (b[j] >= 0 && b[j] < n &&
+		std::find(a.begin(), a.end(), b[j]) == a.end()) {
+	      changed = true;
+	      pg_out[b[j]]++;
+	    }
+	  for (unsigned j = 0; j < a.size(); ++j)
+	    if (a[j] >= 0 && a[j] < n &&
+		std::find(b.begin(), b.end(), a[j]) == b.end()) {
+	      changed = true;
+	      pg_in[a[j]]++;
+	    }
+	}
+	if (changed)
+	  moved++;
+      }
+      delete w;
+    }
+    utime_t elapsed = ceph_clock_now(NULL) - start;
+
+    uint64_t total_in = 0;
+    for (int i = 0; i < n; ++i)
+      total_in += pg_in[i];
+    cout << "mapped " << pgs.size() << " pgs twice with " << nworkers
+	 << " threads in " << (double)elapsed << "s" << std::endl;
+    cout << " moved " << moved << " / " << pgs.size() << " pgs ("
+	 << (pgs.empty() ? 0.0 : (double)moved * 100.0 / (double)pgs.size())
+	 << "%)";
+    if (pg_bytes)
+      cout << ", ~" << prettybyte_t(total_in * pg_bytes)
+	   << " to copy (at " << prettybyte_t(pg_bytes) << " per pg replica)";
+    cout << std::endl;
+
+    cout << "#osd\tin\tout";
+    if (pg_bytes)
+      cout << "\tbytes_in\tbytes_out";
+    cout << std::endl;
+    for (int i = 0; i < n; ++i) {
+      if (!pg_in[i] && !pg_out[i])
+	continue;
+      cout << "osd." << i << "\t" << pg_in[i] << "\t" << pg_out[i];
+      if (pg_bytes)
+	cout << "\t" << prettybyte_t(pg_in[i] * pg_bytes)
+	     << "\t" << prettybyte_t(pg_out[i] * pg_bytes);
+      cout << std::endl;
+    }
+
+    int domain_type = osdmap.crush->get_type_id(moves_domain);
+    if (domain_type <= 0) {
+      cerr << "unknown crush type '" << moves_domain
+	   << "', skipping failure domain summary" << std::endl;
+    } else {
+      map<int, pair<uint64_t,uint64_t> > domains;  // bucket -> (in, out)
+      for (int i = 0; i < n; ++i) {
+	if (!pg_in[i] && !pg_out[i])
+	  continue;
+	int cur = i, id = INT_MIN;
+	while (true) {
+	  int parent;
+	  if (osdmap.crush->get_immediate_parent_id(cur, &parent) < 0)
+	    break;
+	  if (osdmap.crush->get_bucket_type(parent) == domain_type) {
+	    id = parent;
+	    break;
+	  }
+	  cur = parent;
+	}
+	domains[id].first += pg_in[i];
+	domains[id].second += pg_out[i];
+      }
+      cout << "#" << moves_domain << "\tin\tout";
+      if (pg_bytes)
+	cout << "\tbytes_in\tbytes_out";
+      cout << std::endl;
+      for (map<int, pair<uint64_t,uint64_t> >::iterator d = domains.begin();
+	   d != domains.end(); ++d) {
+	if (d->first == INT_MIN)
+	  cout << "(unknown)";
+	else
+	  cout << osdmap.crush->get_item_name(d->first);
+	cout << "\t" << d->second.first << "\t" << d->second.second;
+	if (pg_bytes)
+	  cout << "\t" << prettybyte_t(d->second.first * pg_bytes)
+	       << "\t" << prettybyte_t(d->second.second * pg_bytes);
+	cout << std::endl;
+      }
+    }
+  }
+
   if (!test_map_object.empty()) {
     object_t oid(test_map_object);
     if (pool == -1) {
@@ -470,7 +724,7 @@ int main(int argc, const char **argv)
   if (!print && !tree && !modified &&
       export_crush.empty() && import_crush.empty() && 
       test_map_pg.empty() && test_map_object.empty() &&
-      !test_map_pgs && !test_map_pgs_dump) {
+      !test_map_pgs && !test_map_pgs_dump && !test_map_moves) {
     cerr << me << ": no action specified?" << std::endl;
     usage();
   }
@@ -500,7 +754,10 @@ int main(int argc, const char **argv)
       osdmap.print_tree(NULL, &cout);
     }
   }
-  if (modified) {
+  if (modified && test_map_moves) {
+    cout << me << ": --test-map-moves is a dry run, not writing the modified map"
+	 << std::endl;
+  } else if (modified) {
     bl.clear();
     osdmap.encode(bl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
 
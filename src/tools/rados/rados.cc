@@ -43,6 +43,9 @@ using namespace libradosstriper;
 #include <climits>
 #include <locale>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include "cls/lock/cls_lock_client.h"
 #include "include/compat.h"
@@ -100,6 +103,7 @@ void usage(ostream& out)
 "\n"
 "   listsnaps <obj-name>             list the snapshots of this object\n"
 "   bench <seconds> write|seq|rand [-t concurrent_operations] [--no-cleanup] [--run-name run_name]\n"
+"        [--rand-dist uniform|zipf|hotspot] [--write-percent N]\n"
 "                                    default is 16 concurrent IOs and 4 MB ops\n"
 "                                    default is to clean up after write benchmark\n"
 "                                    default run-name is 'benchmark_last_metadata'\n"
@@ -194,6 +198,12 @@ void usage(ostream& out)
 "        Use radostriper interface rather than pure rados\n"
 "        Available for stat, get, put, truncate, rm, ls and \n"
 "        all xattr related operations\n"
+"   --parallel=N\n"
+"        Use with ls to list with N PG-striped workers; output is\n"
+"        grouped by PG but unordered across PGs\n"
+"   --start-position=N\n"
+"        Use with ls to start (or resume) listing at PG position N;\n"
+"        on error a parallel listing prints the position to resume from\n"
 "\n"
 "BENCH OPTIONS:\n"
 "   -t N\n"
@@ -203,6 +213,10 @@ void usage(ostream& out)
 "        prefix output with date/time\n"
 "   --no-verify\n"
 "        do not verify contents of read objects\n"
+"   --rand-dist uniform|zipf|hotspot\n"
+"        object selection distribution for the rand benchmark\n"
+"   --write-percent N\n"
+"        issue N% of rand benchmark ops as writes (implies --no-verify)\n"
 "   --write-object\n"
 "        write contents to the objects\n"
 "   --write-omap\n"
@@ -1545,6 +1559,8 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   const char *target_pool_name = NULL;
   string oloc, target_oloc, nspace, target_nspace;
   int concurrent_ios = 16;
+  int parallel_ls = 1;
+  uint32_t ls_start_position = 0;
   unsigned op_size = default_op_size;
   unsigned object_size = 0;
   unsigned max_objects = 0;
@@ -1552,6 +1568,8 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   int bench_write_dest = 0;
   bool cleanup = true;
   bool no_verify = false;
+  std::string rand_dist;
+  int write_percent = 0;
   bool use_striper = false;
   bool with_clones = false;
   const char *snapname = NULL;
@@ -1613,6 +1631,18 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
       return -EINVAL;
     }
   }
+  i = opts.find("parallel");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &parallel_ls)) {
+      return -EINVAL;
+    }
+  }
+  i = opts.find("start-position");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &ls_start_position)) {
+      return -EINVAL;
+    }
+  }
   i = opts.find("run-name");
   if (i != opts.end()) {
     run_name = i->second;
@@ -1745,6 +1775,16 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   if (i != opts.end()) {
     no_verify = true;
   }
+  i = opts.find("rand-dist");
+  if (i != opts.end()) {
+    rand_dist = i->second;
+  }
+  i = opts.find("write-percent");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &write_percent)) {
+      return -EINVAL;
+    }
+  }
   i = opts.find("output");
   if (i != opts.end()) {
     output = i->second.c_str();
@@ -2021,48 +2061,126 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
     {
       if (formatter)
         formatter->open_array_section("objects");
-      try {
-	librados::NObjectIterator i = io_ctx.nobjects_begin();
-	librados::NObjectIterator i_end = io_ctx.nobjects_end();
-	for (; i != i_end; ++i) {
+
+      // print one listing entry; in parallel mode the caller holds the
+      // output lock
+      auto dump_entry = [&](const librados::ListObject &entry) {
+	if (use_striper) {
+	  // in case of --striper option, we only list striped
+	  // objects, so we only display the first object of
+	  // each, without its suffix '.000...000'
+	  size_t l = entry.get_oid().length();
+	  if (l <= 17 ||
+	      (0 != entry.get_oid().compare(l-17, 17,".0000000000000000"))) return;
+	}
+	if (!formatter) {
+	  // Only include namespace in output when wildcard specified
+	  if (wildcard)
+	    *outstream << entry.get_nspace() << "\t";
 	  if (use_striper) {
-	    // in case of --striper option, we only list striped
-	    // objects, so we only display the first object of
-	    // each, without its suffix '.000...000'
-	    size_t l = i->get_oid().length();
-	    if (l <= 17 ||
-		(0 != i->get_oid().compare(l-17, 17,".0000000000000000"))) continue;
+	    *outstream << entry.get_oid().substr(0, entry.get_oid().length()-17);
+	  } else {
+	    *outstream << entry.get_oid();
 	  }
-	  if (!formatter) {
-	    // Only include namespace in output when wildcard specified
-	    if (wildcard)
-	      *outstream << i->get_nspace() << "\t";
-	    if (use_striper) {
-	      *outstream << i->get_oid().substr(0, i->get_oid().length()-17);
-	    } else {
-	      *outstream << i->get_oid();
-	    }
-	    if (i->get_locator().size())
-	      *outstream << "\t" << i->get_locator();
-	    *outstream << std::endl;
+	  if (entry.get_locator().size())
+	    *outstream << "\t" << entry.get_locator();
+	  *outstream << std::endl;
+	} else {
+	  formatter->open_object_section("object");
+	  formatter->dump_string("namespace", entry.get_nspace());
+	  if (use_striper) {
+	    formatter->dump_string("name", entry.get_oid().substr(0, entry.get_oid().length()-17));
 	  } else {
-	    formatter->open_object_section("object");
-	    formatter->dump_string("namespace", i->get_nspace());
-	    if (use_striper) {
-	      formatter->dump_string("name", i->get_oid().substr(0, i->get_oid().length()-17));
-	    } else {
-	      formatter->dump_string("name", i->get_oid());
+	    formatter->dump_string("name", entry.get_oid());
+	  }
+	  if (entry.get_locator().size())
+	    formatter->dump_string("locator", entry.get_locator());
+	  formatter->close_section(); //object
+	}
+      };
+
+      if (parallel_ls > 1) {
+	// PG-striped workers: each claims the next PG position and
+	// pages through it with its own cursor, so pgls ops run against
+	// many PGs at once.  Output is grouped per PG, unordered across
+	// PGs.  The watermark tracks the contiguous prefix of finished
+	// positions so an aborted run can be resumed.
+	std::mutex out_lock;
+	std::atomic<unsigned> next_pos(ls_start_position);
+	std::atomic<bool> done(false), failed(false);
+	std::set<unsigned> completed;
+	unsigned watermark = ls_start_position;
+	string error_msg;
+
+	auto worker = [&]() {
+	  while (!done && !failed) {
+	    unsigned pos = next_pos++;
+	    try {
+	      librados::NObjectIterator it = io_ctx.nobjects_begin(pos);
+	      librados::NObjectIterator it_end = io_ctx.nobjects_end();
+	      if (it == it_end || it.get_pg_hash_position() < pos) {
+		// nothing at or after pos, or the seek wrapped past the
+		// last PG: the pool is exhausted from here on
+		done = true;
+		return;
+	      }
+	      std::list<librados::ListObject> batch;
+	      for (; it != it_end && it.get_pg_hash_position() == pos; ++it) {
+		batch.push_back(*it);
+		if (batch.size() >= 1024) {
+		  std::lock_guard<std::mutex> l(out_lock);
+		  for (std::list<librados::ListObject>::iterator p = batch.begin();
+		       p != batch.end(); ++p)
+		    dump_entry(*p);
+		  batch.clear();
+		}
+	      }
+	      std::lock_guard<std::mutex> l(out_lock);
+	      for (std::list<librados::ListObject>::iterator p = batch.begin();
+		   p != batch.end(); ++p)
+		dump_entry(*p);
+	      completed.insert(pos);
+	      while (completed.erase(watermark))
+		watermark++;
+	    } catch (const std::runtime_error& e) {
+	      std::lock_guard<std::mutex> l(out_lock);
+	      if (!failed)
+		error_msg = e.what();
+	      failed = true;
+	      return;
 	    }
-	    if (i->get_locator().size())
-	      formatter->dump_string("locator", i->get_locator());
-	    formatter->close_section(); //object
 	  }
+	};
+
+	vector<std::thread> workers;
+	for (int n = 0; n < parallel_ls; n++)
+	  workers.push_back(std::thread(worker));
+	for (vector<std::thread>::iterator t = workers.begin();
+	     t != workers.end(); ++t)
+	  t->join();
+
+	if (failed) {
+	  cerr << error_msg << std::endl;
+	  cerr << "listing interrupted; resume with --start-position "
+	       << watermark << " (objects from PGs past the watermark may"
+	       << " repeat)" << std::endl;
+	  ret = -1;
+	  goto out;
+	}
+      } else {
+	try {
+	  librados::NObjectIterator i = ls_start_position ?
+	    io_ctx.nobjects_begin(ls_start_position) : io_ctx.nobjects_begin();
+	  librados::NObjectIterator i_end = io_ctx.nobjects_end();
+	  for (; i != i_end; ++i) {
+	    dump_entry(*i);
+	  }
+	}
+	catch (const std::runtime_error& e) {
+	  cerr << e.what() << std::endl;
+	  ret = -1;
+	  goto out;
 	}
-      }
-      catch (const std::runtime_error& e) {
-	cerr << e.what() << std::endl;
-	ret = -1;
-	goto out;
       }
     }
     if (formatter) {
@@ -2864,6 +2982,20 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
       operation = OP_RAND_READ;
     else
       usage_exit();
+    if (operation != OP_RAND_READ) {
+      if (!rand_dist.empty()) {
+        cerr << "--rand-dist option can be used only with `rand' bench test"
+             << std::endl;
+        ret = -EINVAL;
+        goto out;
+      }
+      if (write_percent != 0) {
+        cerr << "--write-percent option can be used only with `rand' bench test"
+             << std::endl;
+        ret = -EINVAL;
+        goto out;
+      }
+    }
     if (operation != OP_WRITE) {
       if (block_size_specified) {
         cerr << "-b|--block_size option can be used only with `write' bench test"
@@ -2892,6 +3024,18 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
     RadosBencher bencher(g_ceph_context, rados, io_ctx);
     bencher.set_show_time(show_time);
     bencher.set_write_destination(static_cast<OpWriteDest>(bench_write_dest));
+    if (!rand_dist.empty() && bencher.set_rand_dist(rand_dist) < 0) {
+      cerr << "Invalid rand-dist: '" << rand_dist
+           << "' (expected uniform, zipf or hotspot)" << std::endl;
+      ret = -EINVAL;
+      goto out;
+    }
+    if (bencher.set_write_percent(write_percent) < 0) {
+      cerr << "Invalid value for write-percent: '" << write_percent
+           << "' (expected 0-100)" << std::endl;
+      ret = -EINVAL;
+      goto out;
+    }
 
     ostream *outstream = NULL;
     if (formatter) {
@@ -3484,6 +3628,10 @@ int main(int argc, const char **argv)
       opts["no-verify"] = "true";
     } else if (ceph_argparse_witharg(args, i, &val, "--run-name", (char*)NULL)) {
       opts["run-name"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--rand-dist", (char*)NULL)) {
+      opts["rand-dist"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--write-percent", (char*)NULL)) {
+      opts["write-percent"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--prefix", (char*)NULL)) {
       opts["prefix"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "-p", "--pool", (char*)NULL)) {
@@ -3498,6 +3646,10 @@ int main(int argc, const char **argv)
       opts["target_nspace"] = val;
     } else if (ceph_argparse_flag(args, i, "--striper" , (char *)NULL)) {
       opts["striper"] = "true";
+    } else if (ceph_argparse_witharg(args, i, &val, "--parallel", (char*)NULL)) {
+      opts["parallel"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--start-position", (char*)NULL)) {
+      opts["start-position"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "-t", "--concurrent-ios", (char*)NULL)) {
       opts["concurrent-ios"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--block-size", (char*)NULL)) {
@@ -7,10 +7,13 @@
 #include "tools/rbd/Utils.h"
 #include "include/Context.h"
 #include "common/errno.h"
+#include "common/Mutex.h"
 #include "common/Throttle.h"
 #include <iostream>
+#include <map>
 #include <boost/program_options.hpp>
 #include <boost/scope_exit.hpp>
+#include <boost/scoped_ptr.hpp>
 
 namespace rbd {
 namespace action {
@@ -19,15 +22,51 @@ namespace export_full {
 namespace at = argument_types;
 namespace po = boost::program_options;
 
+// Reorders chunks completing out of order back into file order for
+// destinations that cannot seek (stdout).  Chunks are staged until they
+// are contiguous with the current file position, then flushed.
+class ExportWriteQueue
+{
+public:
+  explicit ExportWriteQueue(int fd) :
+    m_lock("rbd::ExportWriteQueue"), m_fd(fd), m_write_offset(0)
+  {
+  }
+
+  int write(uint64_t offset, bufferlist &bl) {
+    Mutex::Locker l(m_lock);
+    m_chunks[offset].claim(bl);
+    while (!m_chunks.empty() &&
+	   m_chunks.begin()->first == m_write_offset) {
+      bufferlist &out = m_chunks.begin()->second;
+      uint64_t len = out.length();
+      int r = out.write_fd(m_fd);
+      if (r < 0) {
+	return r;
+      }
+      m_write_offset += len;
+      m_chunks.erase(m_chunks.begin());
+    }
+    return 0;
+  }
+
+private:
+  Mutex m_lock;
+  int m_fd;
+  uint64_t m_write_offset;
+  std::map<uint64_t, bufferlist> m_chunks;
+};
+
 class C_Export : public Context
 {
 public:
   C_Export(SimpleThrottle &simple_throttle, librbd::Image &image,
-                   uint64_t offset, uint64_t length, int fd)
+                   uint64_t offset, uint64_t length, int fd,
+                   ExportWriteQueue *write_queue)
     : m_aio_completion(
         new librbd::RBD::AioCompletion(this, &utils::aio_context_callback)),
       m_throttle(simple_throttle), m_image(image), m_offset(offset),
-      m_length(length), m_fd(fd)
+      m_length(length), m_fd(fd), m_write_queue(write_queue)
   {
   }
 
@@ -60,18 +99,27 @@ public:
     }
 
     assert(m_bufferlist.length() == static_cast<size_t>(r));
-    if (m_fd != STDOUT_FILENO) {
-      if (m_bufferlist.is_zero()) {
-        return;
-      }
-
-      uint64_t chkret = lseek64(m_fd, m_offset, SEEK_SET);
-      if (chkret != m_offset) {
-        cerr << "rbd: error seeking destination image to offset "
+    if (m_write_queue != NULL) {
+      // non-seekable destination: stage for in-order writeback
+      r = m_write_queue->write(m_offset, m_bufferlist);
+      if (r < 0) {
+        cerr << "rbd: error writing to destination image at offset "
              << m_offset << std::endl;
-        r = -errno;
-        return;
       }
+      return;
+    }
+
+    if (m_bufferlist.is_zero()) {
+      // skip zero runs; the final ftruncate leaves them as holes
+      return;
+    }
+
+    uint64_t chkret = lseek64(m_fd, m_offset, SEEK_SET);
+    if (chkret != m_offset) {
+      cerr << "rbd: error seeking destination image to offset "
+           << m_offset << std::endl;
+      r = -errno;
+      return;
     }
 
     r = m_bufferlist.write_fd(m_fd);
@@ -89,6 +137,7 @@ private:
   uint64_t m_offset;
   uint64_t m_length;
   int m_fd;
+  ExportWriteQueue *m_write_queue;
 };
 
 static int do_export(librbd::Image& image, const char *path, bool no_progress)
@@ -99,13 +148,15 @@ static int do_export(librbd::Image& image, const char *path, bool no_progress)
     return r;
 
   int fd;
-  int max_concurrent_ops;
+  int max_concurrent_ops = max(g_conf->rbd_concurrent_management_ops, 1);
   bool to_stdout = (strcmp(path, "-") == 0);
+  boost::scoped_ptr<ExportWriteQueue> write_queue;
   if (to_stdout) {
     fd = STDOUT_FILENO;
-    max_concurrent_ops = 1;
+    // stdout can't seek, but reads can still run concurrently as long
+    // as completed chunks are written back in file order
+    write_queue.reset(new ExportWriteQueue(fd));
   } else {
-    max_concurrent_ops = max(g_conf->rbd_concurrent_management_ops, 1);
     fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
     if (fd < 0) {
       return -errno;
@@ -125,7 +176,8 @@ static int do_export(librbd::Image& image, const char *path, bool no_progress)
     }
 
     uint64_t length = min(period, info.size - offset);
-    C_Export *ctx = new C_Export(throttle, image, offset, length, fd);
+    C_Export *ctx = new C_Export(throttle, image, offset, length, fd,
+				 write_queue.get());
     ctx->send();
 
     pc.update_progress(offset, info.size);
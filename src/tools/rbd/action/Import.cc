@@ -91,7 +91,11 @@ static int do_import(librbd::RBD &rbd, librados::IoCtx& io_ctx,
   boost::scoped_ptr<SimpleThrottle> throttle;
   bool from_stdin = !strcmp(path, "-");
   if (from_stdin) {
-    throttle.reset(new SimpleThrottle(1, false));
+    // concurrent writes are safe here too: the binary-expansion resize
+    // only ever grows the image and always completes before the write
+    // that needs the new size is issued
+    throttle.reset(new SimpleThrottle(
+      max(g_conf->rbd_concurrent_management_ops, 1), false));
     fd = 0;
     size = 1ULL << order;
   } else {
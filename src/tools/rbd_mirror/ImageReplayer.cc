@@ -5,6 +5,7 @@
 #include "common/Formatter.h"
 #include "common/debug.h"
 #include "common/errno.h"
+#include "common/perf_counters.h"
 #include "include/stringify.h"
 #include "cls/rbd/cls_rbd_client.h"
 #include "common/Timer.h"
@@ -52,6 +53,14 @@ std::ostream &operator<<(std::ostream &os,
 
 namespace {
 
+enum {
+  l_rbd_mirror_first = 27000,
+  l_rbd_mirror_replay,
+  l_rbd_mirror_replay_bytes,
+  l_rbd_mirror_replay_latency,
+  l_rbd_mirror_last,
+};
+
 template <typename I>
 struct ReplayHandler : public ::journal::ReplayHandler {
   ImageReplayer<I> *replayer;
@@ -294,6 +303,7 @@ ImageReplayer<I>::ImageReplayer(Threads *threads,
 
   m_asok_hook = new ImageReplayerAdminSocketHook<I>(g_ceph_context, m_name,
                                                     this);
+  register_perf_counters();
 }
 
 template <typename I>
@@ -312,6 +322,7 @@ ImageReplayer<I>::~ImageReplayer()
 
   delete m_resync_listener;
   delete m_asok_hook;
+  unregister_perf_counters();
 }
 
 template <typename I>
@@ -377,6 +388,9 @@ void ImageReplayer<I>::start(Context *on_finish, bool manual)
   journal::Settings settings;
   settings.commit_interval = cct->_conf->rbd_mirror_journal_commit_age;
   settings.max_fetch_bytes = cct->_conf->rbd_mirror_journal_max_fetch_bytes;
+  settings.object_fetch_window =
+    cct->_conf->rbd_mirror_journal_object_fetch_window;
+  settings.max_prefetch_bytes = cct->_conf->rbd_mirror_journal_max_prefetch_bytes;
 
   m_remote_journaler = new Journaler(m_threads->work_queue,
                                      m_threads->timer,
@@ -468,11 +482,15 @@ void ImageReplayer<I>::handle_bootstrap(int r) {
 	delete m_asok_hook;
 	m_asok_hook = nullptr;
       }
+      unregister_perf_counters();
     }
     if (!m_asok_hook) {
       m_asok_hook = new ImageReplayerAdminSocketHook<I>(g_ceph_context, m_name,
                                                         this);
     }
+    if (!m_perf_counters) {
+      register_perf_counters();
+    }
   }
 
   update_mirror_image_status(false, boost::none);
@@ -1045,7 +1063,8 @@ void ImageReplayer<I>::process_entry() {
 
   Context *on_ready = create_context_callback<
     ImageReplayer, &ImageReplayer<I>::handle_process_entry_ready>(this);
-  Context *on_commit = new C_ReplayCommitted(this, std::move(m_replay_entry));
+  Context *on_commit = new C_ReplayCommitted(this, std::move(m_replay_entry),
+                                             ceph_clock_now(g_ceph_context));
   m_local_replay->process(m_event_entry, on_ready, on_commit);
   m_event_entry = {};
 }
@@ -1061,6 +1080,7 @@ void ImageReplayer<I>::handle_process_entry_ready(int r) {
 
 template <typename I>
 void ImageReplayer<I>::handle_process_entry_safe(const ReplayEntry& replay_entry,
+                                                 const utime_t &replay_start_time,
                                                  int r) {
   dout(20) << "commit_tid=" << replay_entry.get_commit_tid() << ", r=" << r
 	   << dendl;
@@ -1072,6 +1092,14 @@ void ImageReplayer<I>::handle_process_entry_safe(const ReplayEntry& replay_entry
     return;
   }
 
+  if (m_perf_counters) {
+    m_perf_counters->inc(l_rbd_mirror_replay);
+    m_perf_counters->inc(l_rbd_mirror_replay_bytes,
+                         replay_entry.get_data().length());
+    m_perf_counters->tinc(l_rbd_mirror_replay_latency,
+                          ceph_clock_now(g_ceph_context) - replay_start_time);
+  }
+
   if (m_remote_journaler) {
     m_remote_journaler->committed(replay_entry);
   }
@@ -1455,6 +1483,34 @@ std::string ImageReplayer<I>::to_string(const State state) {
   return "Unknown(" + stringify(state) + ")";
 }
 
+template <typename I>
+void ImageReplayer<I>::register_perf_counters() {
+  dout(20) << dendl;
+  assert(m_perf_counters == nullptr);
+
+  PerfCountersBuilder plb(g_ceph_context, "rbd_mirror_" + m_name,
+                          l_rbd_mirror_first, l_rbd_mirror_last);
+  plb.add_u64_counter(l_rbd_mirror_replay, "replay", "Replays");
+  plb.add_u64_counter(l_rbd_mirror_replay_bytes, "replay_bytes",
+                      "Replayed data");
+  plb.add_time_avg(l_rbd_mirror_replay_latency, "replay_latency",
+                   "Replay latency");
+  m_perf_counters = plb.create_perf_counters();
+  g_ceph_context->get_perfcounters_collection()->add(m_perf_counters);
+}
+
+template <typename I>
+void ImageReplayer<I>::unregister_perf_counters() {
+  dout(20) << dendl;
+  if (m_perf_counters == nullptr) {
+    return;
+  }
+
+  g_ceph_context->get_perfcounters_collection()->remove(m_perf_counters);
+  delete m_perf_counters;
+  m_perf_counters = nullptr;
+}
+
 template <typename I>
 void ImageReplayer<I>::resync_image(Context *on_finish) {
   dout(20) << dendl;